@@ -80,6 +80,7 @@ void INSSetArmed(bool armed);
 void INSResetP(const float *PDiag);
 void INSSetState(const float pos[3], const float vel[3], const float q[4], const float gyro_bias[3], const float accel_bias[3]);
 void INSSetPosVelVar(float PosVar, float VelVar, float VertPosVar);
+void INSSetPosVelAge(float pos_age, float vel_age);
 void INSSetGyroBias(const float gyro_bias[3]);
 void INSSetAccelBias(const float gyro_bias[3]);
 void INSSetAccelVar(const float accel_var[3]);
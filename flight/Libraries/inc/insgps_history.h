@@ -0,0 +1,71 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsLibraries Tau Labs Libraries
+ * @{
+ *
+ * @file       insgps_history.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ * @brief      History of predicted INS position and velocity, used to fuse
+ *             delayed GPS measurements at the epoch they were taken
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef INSGPS_HISTORY_H_
+#define INSGPS_HISTORY_H_
+
+#include <stdint.h>
+
+//! Number of past states kept
+#define INS_HISTORY_LEN 32
+
+//! Spacing of the past states, which with INS_HISTORY_LEN covers 320ms
+#define INS_HISTORY_PERIOD_US 10000
+
+//! Position (NED, m) and velocity (NED, m/s), as in the first six states
+#define INS_HISTORY_STATES 6
+
+struct ins_history {
+	uint32_t now_us;	/**< Prediction time accumulated by the filter */
+	uint8_t newest;		/**< Index of the most recently stored state */
+	uint8_t count;		/**< Number of states stored */
+	float pos_age;		/**< Age of the GPS position to fuse next (s) */
+	float vel_age;		/**< Age of the GPS velocity to fuse next (s) */
+	float prior[INS_HISTORY_STATES];	/**< State before the correction */
+	uint32_t time_us[INS_HISTORY_LEN];
+	float state[INS_HISTORY_LEN][INS_HISTORY_STATES];
+};
+
+//! The history of the filter in use; only one is linked into a firmware
+extern struct ins_history insgps_history;
+
+void ins_history_reset(struct ins_history *h);
+void ins_history_store(struct ins_history *h, const float X[INS_HISTORY_STATES], float dT);
+void ins_history_lookup(const struct ins_history *h, const float X[INS_HISTORY_STATES],
+		float age, float past[INS_HISTORY_STATES]);
+void ins_history_shift(struct ins_history *h, const float delta[INS_HISTORY_STATES]);
+void ins_history_begin_correction(struct ins_history *h, const float X[INS_HISTORY_STATES],
+		float Y[INS_HISTORY_STATES], uint16_t SensorsUsed);
+void ins_history_end_correction(struct ins_history *h, const float X[INS_HISTORY_STATES]);
+
+#endif /* INSGPS_HISTORY_H_ */
+
+/**
+ * @}
+ */
@@ -0,0 +1,141 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsLibraries Tau Labs Libraries
+ * @{
+ *
+ * @file       rfm22b_link.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ * @brief      Air data rates, slot timing and adaptive rate selection for
+ *             the RFM22B link, independent of the radio hardware
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef RFM22B_LINK_H_
+#define RFM22B_LINK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Number of air data rates, indexed as HwShared MaxRfSpeed
+#define RFM22B_LINK_NUM_RATES 9
+
+//! The largest packet the RFM22B packet handler can send
+#define RFM22B_LINK_MAX_PACKET_LEN 255
+//! The largest packet older firmware accepts
+#define RFM22B_LINK_LEGACY_PACKET_LEN 64
+
+//! Bytes sent on air per packet besides the data: preamble, sync, header, length
+#define RFM22B_LINK_FRAMING_BYTES (6 + 4 + 4 + 1)
+
+//! Link quality, from 0 (nothing received) to RFM22B_LINK_QUALITY_MAX
+#define RFM22B_LINK_QUALITY_MAX 14
+//! Too few packets seen to judge the link
+#define RFM22B_LINK_QUALITY_UNKNOWN 15
+//! Packets the quality is rated over, so it follows changes in the link
+#define RFM22B_LINK_QUALITY_WINDOW 16
+
+//! How often the coordinator reconsiders the air rate
+#define RFM22B_LINK_EVAL_MS 500
+//! Step down when the worse end of the link is below this quality
+#define RFM22B_LINK_DOWN_QUALITY 12
+//! Step up when both ends are at least at this quality ...
+#define RFM22B_LINK_UP_QUALITY 14
+//! ... for this many evaluations in a row
+#define RFM22B_LINK_UP_EVALS 3
+//! Least number of slots a rate change is announced for before it happens
+#define RFM22B_LINK_SWITCH_SLOTS 8
+//! Hop cycle at every rate of an adaptive link; rate changes happen on its boundaries
+#define RFM22B_LINK_HOP_CYCLE_MS 320
+//! Return to the lowest rate after being disconnected this long
+#define RFM22B_LINK_FALLBACK_MS 2000
+
+/**
+ * How the link uses the air, in the order of HwShared RfLinkMode.  Both ends
+ * of a link must use the same mode.
+ */
+enum rfm22b_link_mode {
+	RFM22B_LINK_LEGACY,	/**< Slots and packets of older firmware */
+	RFM22B_LINK_AGGREGATED,	/**< Slots sized for long packets, fixed rate */
+	RFM22B_LINK_ADAPTIVE,	/**< Long packets, rate follows the link quality */
+};
+
+uint32_t rfm22b_link_bps(uint8_t rate);
+uint8_t rfm22b_link_packet_time(enum rfm22b_link_mode mode, uint8_t rate,
+		bool ppm_mode, bool one_way);
+uint8_t rfm22b_link_num_channels(enum rfm22b_link_mode mode, uint8_t rate);
+uint8_t rfm22b_link_max_packet_len(enum rfm22b_link_mode mode, uint8_t rate,
+		uint8_t packet_time, bool one_way);
+uint8_t rfm22b_link_quality(uint32_t good, uint32_t corrected, uint32_t errors);
+
+enum rfm22b_link_rx {
+	RFM22B_LINK_RX_GOOD,
+	RFM22B_LINK_RX_CORRECTED,
+	RFM22B_LINK_RX_LOST,
+};
+
+/**
+ * Quality of the packets received, rated once every
+ * RFM22B_LINK_QUALITY_WINDOW packets.
+ */
+struct rfm22b_link_quality {
+	uint8_t good;
+	uint8_t corrected;
+	uint8_t lost;
+	uint8_t quality;	/**< Rating of the last full window */
+};
+
+void rfm22b_link_quality_reset(struct rfm22b_link_quality *q);
+void rfm22b_link_quality_add(struct rfm22b_link_quality *q, enum rfm22b_link_rx rx);
+
+/**
+ * Adaptive air rate state.  The coordinator chooses the rate from the link
+ * quality at both ends and announces changes in the control byte of its
+ * packets; the other modem reports its quality in its own control byte.
+ * Times are on the coordinator's clock, which both modems keep.
+ */
+struct rfm22b_link_rate {
+	uint8_t min_rate;	/**< Lowest rate to use, and the rate to fall back to */
+	uint8_t max_rate;	/**< Highest rate to use, as configured */
+	uint8_t rate;		/**< Current rate */
+	uint8_t next_rate;	/**< Rate announced, equal to rate if none */
+	uint32_t switch_ms;	/**< When next_rate takes effect */
+	uint32_t eval_ms;	/**< Last evaluation by the coordinator */
+	uint32_t lost_ms;	/**< When the link was lost */
+	bool lost;		/**< Whether the link is lost */
+	uint8_t good_evals;	/**< Evaluations in a row the link was good */
+	uint8_t peer_quality;	/**< Quality reported by the other modem */
+};
+
+void rfm22b_link_rate_init(struct rfm22b_link_rate *r, uint8_t min_rate,
+		uint8_t max_rate, uint32_t now_ms);
+uint8_t rfm22b_link_rate_tx_control(const struct rfm22b_link_rate *r,
+		bool coordinator, uint8_t own_quality, uint8_t packet_time,
+		uint32_t now_ms);
+void rfm22b_link_rate_rx_control(struct rfm22b_link_rate *r, bool coordinator,
+		uint8_t control, uint8_t packet_time, uint32_t now_ms);
+bool rfm22b_link_rate_update(struct rfm22b_link_rate *r, bool coordinator,
+		bool connected, uint8_t own_quality, uint8_t packet_time,
+		uint32_t now_ms);
+
+#endif /* RFM22B_LINK_H_ */
+
+/**
+ * @}
+ */
@@ -31,6 +31,7 @@
  */
 
 #include "insgps.h"
+#include "insgps_history.h"
 #include "physical_constants.h"
 #include <math.h>
 #include <stdint.h>
@@ -78,6 +79,8 @@ uint16_t ins_get_num_states()
 
 void INSGPSInit()		//pretty much just a place holder for now
 {
+	ins_history_reset(&insgps_history);
+
 	Be[0] = 1.0f;
 	Be[1] = 0;
 	Be[2] = 0;		// local magnetic unit vector
@@ -224,6 +227,8 @@ void INSSetState(const float pos[3], const float vel[3], const float q[4], const
 	X[11] = gyro_bias[1];
 	X[12] = gyro_bias[2];
 	X[13] = accel_bias[2];
+
+	ins_history_reset(&insgps_history);
 }
 
 void INSPosVelReset(const float pos[3], const float vel[3]) 
@@ -244,6 +249,8 @@ void INSPosVelReset(const float pos[3], const float vel[3])
 	X[3] = vel[0];
 	X[4] = vel[1];
 	X[5] = vel[2];	
+
+	ins_history_reset(&insgps_history);
 }
 
 void INSSetPosVelVar(float PosVar, float VelVar, float VertPosVar)
@@ -340,6 +347,7 @@ void INSStatePrediction(const float gyro_data[3], const float accel_data[3], flo
 	// EKF prediction step
 	LinearizeFG(X, U, F, G);
 	RungeKutta(X, U, dT);
+	ins_history_store(&insgps_history, X, dT);
 	qmag = sqrtf(X[6] * X[6] + X[7] * X[7] + X[8] * X[8] + X[9] * X[9]);
 	X[6] /= qmag;
 	X[7] /= qmag;
@@ -399,7 +407,12 @@ void INSCorrection(const float mag_data[3], const float Pos[3], const float Vel[
 	// EKF correction step
 	LinearizeH(X, Be, H);
 	MeasurementEq(X, Be, Y);
+
+	// Form the GPS innovations against the state when they were measured
+	ins_history_begin_correction(&insgps_history, X, Y, SensorsUsed);
 	SerialUpdate(H, R, Z, Y, P, X, SensorsUsed);
+	ins_history_end_correction(&insgps_history, X);
+
 	qmag = sqrtf(X[6] * X[6] + X[7] * X[7] + X[8] * X[8] + X[9] * X[9]);
 	X[6] /= qmag;
 	X[7] /= qmag;
@@ -0,0 +1,195 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsLibraries Tau Labs Libraries
+ * @{
+ *
+ * @file       insgps_history.c
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ * @brief      History of predicted INS position and velocity.
+ *
+ * GPS receivers report a solution 100-200ms after the epoch it describes.
+ * Comparing it against the current state makes the filter pull the estimate
+ * back towards where the vehicle was, which shows up as lag and overshoot
+ * whenever it accelerates.  The filters store their predicted position and
+ * velocity here as they propagate, and form the GPS innovation against the
+ * state at the measurement epoch instead.  The correction is then applied to
+ * the current state, so the output stays current.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "insgps.h"
+#include "insgps_history.h"
+
+struct ins_history insgps_history;
+
+/**
+ * Set how long ago the GPS position and velocity passed to INSCorrection
+ * were measured.  They are then compared against the state predicted for
+ * their epochs rather than against the current state.
+ * @param[in] pos_age The position age (s), or zero to fuse it as current
+ * @param[in] vel_age The velocity age (s), or zero to fuse it as current
+ */
+void INSSetPosVelAge(float pos_age, float vel_age)
+{
+	insgps_history.pos_age = pos_age;
+	insgps_history.vel_age = vel_age;
+}
+
+/**
+ * Forget all stored states and measurement ages, e.g. when the state is reset
+ * @param[in] h The history
+ */
+void ins_history_reset(struct ins_history *h)
+{
+	h->now_us = 0;
+	h->newest = 0;
+	h->count = 0;
+	h->pos_age = 0;
+	h->vel_age = 0;
+}
+
+/**
+ * Advance the history clock and store the state if one period has elapsed
+ * since the last one was stored.  Called after every state prediction.
+ * @param[in] h The history
+ * @param[in] X The predicted position and velocity
+ * @param[in] dT The prediction step (s)
+ */
+void ins_history_store(struct ins_history *h, const float X[INS_HISTORY_STATES], float dT)
+{
+	h->now_us += (uint32_t) (dT * 1e6f + 0.5f);
+
+	if (h->count > 0 && h->now_us - h->time_us[h->newest] < INS_HISTORY_PERIOD_US)
+		return;
+
+	h->newest = (h->newest + 1) % INS_HISTORY_LEN;
+	if (h->count < INS_HISTORY_LEN)
+		h->count++;
+
+	h->time_us[h->newest] = h->now_us;
+	for (int i = 0; i < INS_HISTORY_STATES; i++)
+		h->state[h->newest][i] = X[i];
+}
+
+/**
+ * Estimate the position and velocity at a past epoch by interpolating between
+ * the stored states.  Ages beyond the history are clamped to the oldest state.
+ * @param[in] h The history
+ * @param[in] X The current position and velocity, which has age zero
+ * @param[in] age How long ago the epoch was (s)
+ * @param[out] past The position and velocity at the epoch
+ */
+void ins_history_lookup(const struct ins_history *h, const float X[INS_HISTORY_STATES],
+		float age, float past[INS_HISTORY_STATES])
+{
+	uint32_t age_us = age > 0 ? (uint32_t) (age * 1e6f) : 0;
+
+	// Walk back from the current state, which is newer than anything stored
+	const float *newer = X;
+	uint32_t newer_age = 0;
+
+	for (int n = 0; n < h->count; n++) {
+		int idx = (h->newest + INS_HISTORY_LEN - n) % INS_HISTORY_LEN;
+		const float *older = h->state[idx];
+		uint32_t older_age = h->now_us - h->time_us[idx];
+
+		if (older_age >= age_us) {
+			float span = older_age - newer_age;
+			float frac = span > 0 ? (age_us - newer_age) / span : 0;
+
+			for (int i = 0; i < INS_HISTORY_STATES; i++)
+				past[i] = newer[i] + (older[i] - newer[i]) * frac;
+
+			return;
+		}
+
+		newer = older;
+		newer_age = older_age;
+	}
+
+	for (int i = 0; i < INS_HISTORY_STATES; i++)
+		past[i] = newer[i];
+}
+
+/**
+ * Apply a correction of the current state to the stored states as well, so
+ * that later delayed measurements are not compared against states that the
+ * filter has already corrected away from.
+ * @param[in] h The history
+ * @param[in] delta The change in position and velocity made by the correction
+ */
+void ins_history_shift(struct ins_history *h, const float delta[INS_HISTORY_STATES])
+{
+	for (int n = 0; n < h->count; n++) {
+		int idx = (h->newest + INS_HISTORY_LEN - n) % INS_HISTORY_LEN;
+
+		for (int i = 0; i < INS_HISTORY_STATES; i++)
+			h->state[idx][i] += delta[i];
+	}
+}
+
+/**
+ * Form the predicted GPS measurements from the state at the epochs the
+ * position and velocity were measured, and note the state so that the
+ * correction can be carried back through the history afterwards.
+ * @param[in] h The history
+ * @param[in] X The current position and velocity
+ * @param[in,out] Y The predicted measurements; position and velocity replaced
+ * @param[in] SensorsUsed The measurements being fused
+ */
+void ins_history_begin_correction(struct ins_history *h, const float X[INS_HISTORY_STATES],
+		float Y[INS_HISTORY_STATES], uint16_t SensorsUsed)
+{
+	float past[INS_HISTORY_STATES];
+
+	if ((SensorsUsed & POS_SENSORS) && h->pos_age > 0) {
+		ins_history_lookup(h, X, h->pos_age, past);
+		for (int i = 0; i < 3; i++)
+			Y[i] = past[i];
+	}
+
+	if ((SensorsUsed & (HORIZ_VEL_SENSORS | VERT_VEL_SENSORS)) && h->vel_age > 0) {
+		ins_history_lookup(h, X, h->vel_age, past);
+		for (int i = 3; i < 6; i++)
+			Y[i] = past[i];
+	}
+
+	for (int i = 0; i < INS_HISTORY_STATES; i++)
+		h->prior[i] = X[i];
+}
+
+/**
+ * Apply the correction just made to the current state to the stored states
+ * @param[in] h The history
+ * @param[in] X The corrected position and velocity
+ */
+void ins_history_end_correction(struct ins_history *h, const float X[INS_HISTORY_STATES])
+{
+	float delta[INS_HISTORY_STATES];
+
+	for (int i = 0; i < INS_HISTORY_STATES; i++)
+		delta[i] = X[i] - h->prior[i];
+
+	ins_history_shift(h, delta);
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,409 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsLibraries Tau Labs Libraries
+ * @{
+ *
+ * @file       rfm22b_link.c
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ * @brief      Air data rates, slot timing and adaptive rate selection for
+ *             the RFM22B link.
+ *
+ * The link is time division multiplexed: each modem may transmit one packet
+ * per slot.  Every packet costs the framing bytes, the error correcting code
+ * and a turnaround guard however little data it carries.  The legacy slots
+ * carry at most 64 bytes, as older firmware expects; the aggregated and
+ * adaptive slots are sized to carry close to the largest packet the radio
+ * supports, bounded to keep the latency reasonable.
+ *
+ * On an adaptive link the coordinator steps the air rate between the lowest
+ * rate and the configured one, down when either end loses packets and up when
+ * both have been clean for a while.  Every rate hops through its channels in
+ * the same cycle, so the modems stay synchronized across a change, which is
+ * announced for several slots and made at the start of a hop cycle.  Both
+ * modems start at the configured rate, and a modem that stays disconnected
+ * falls back to the lowest rate, where the two always meet again.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "rfm22b_link.h"
+
+//! Fewest packets the quality is judged from
+#define QUALITY_MIN_SAMPLES 16
+
+// xtal 10 ppm, 434MHz
+static const uint32_t data_rate[RFM22B_LINK_NUM_RATES] = {
+	9600,			// 96 kbps, 433 HMz, 30 khz freq dev
+	19200,			// 19.2 kbps, 433 MHz, 45 khz freq dev
+	32000,			// 32 kbps, 433 MHz, 45 khz freq dev
+	57600,			// 57.6 kbps, 433 MHz, 45 khz freq dev
+	64000,			// 64 kbps, 433 MHz, 45 khz freq dev
+	100000,			// 100 kbps, 433 MHz, 60 khz freq dev
+	128000,			// 128 kbps, 433 MHz, 90 khz freq dev
+	192000,			// 192 kbps, 433 MHz, 128 khz freq dev
+	256000,			// 256 kbps, 433 MHz, 150 khz freq dev
+};
+
+// Time each modem may transmit for, in ms, as in older firmware
+static const uint8_t packet_time_legacy[RFM22B_LINK_NUM_RATES] = {
+	80, 40, 25, 15, 13, 10, 8, 6, 5,
+};
+
+// Long enough for packets of around 200 bytes at the faster rates, but no
+// more than 20ms where the slots used to be shorter, to bound the latency of
+// light traffic.
+static const uint8_t packet_time[RFM22B_LINK_NUM_RATES] = {
+	80, 40, 25, 20, 20, 20, 16, 12, 10,
+};
+
+// PPM is sent every slot, so these stay short to keep the control latency low
+static const uint8_t packet_time_ppm[RFM22B_LINK_NUM_RATES] = {
+	26, 25, 25, 15, 13, 10, 8, 6, 5,
+};
+
+static const uint8_t num_channels[RFM22B_LINK_NUM_RATES] = {
+	4, 4, 4, 6, 8, 8, 10, 12, 16,
+};
+
+// The adaptive slots are close to the aggregated ones, but every rate's two
+// slots times its channels make RFM22B_LINK_HOP_CYCLE_MS.
+static const uint8_t packet_time_adaptive[RFM22B_LINK_NUM_RATES] = {
+	80, 40, 32, 20, 20, 20, 16, 16, 10,
+};
+
+static const uint8_t num_channels_adaptive[RFM22B_LINK_NUM_RATES] = {
+	2, 4, 5, 8, 8, 8, 10, 10, 16,
+};
+
+/**
+ * @param[in] rate The rate index
+ * @return the air data rate in bits per second
+ */
+uint32_t rfm22b_link_bps(uint8_t rate)
+{
+	return data_rate[rate];
+}
+
+/**
+ * Get the slot period, in which both modems transmit once on a two way link
+ * @param[in] mode The link mode
+ * @param[in] rate The rate index
+ * @param[in] ppm_mode Whether PPM is sent in every slot
+ * @param[in] one_way Whether only the coordinator transmits
+ * @return the slot period in ms
+ */
+uint8_t rfm22b_link_packet_time(enum rfm22b_link_mode mode, uint8_t rate,
+		bool ppm_mode, bool one_way)
+{
+	uint8_t t;
+
+	if (ppm_mode) {
+		t = packet_time_ppm[rate];
+	} else if (mode == RFM22B_LINK_LEGACY) {
+		t = packet_time_legacy[rate];
+	} else if (mode == RFM22B_LINK_ADAPTIVE) {
+		t = packet_time_adaptive[rate];
+	} else {
+		t = packet_time[rate];
+	}
+
+	return one_way ? t : 2 * t;
+}
+
+/**
+ * @param[in] mode The link mode
+ * @param[in] rate The rate index
+ * @return the number of channels hopped across
+ */
+uint8_t rfm22b_link_num_channels(enum rfm22b_link_mode mode, uint8_t rate)
+{
+	return mode == RFM22B_LINK_ADAPTIVE ? num_channels_adaptive[rate] :
+		num_channels[rate];
+}
+
+/**
+ * Get the largest packet that can be sent in one modem's share of the slot,
+ * including the error correcting code but not the framing.
+ * @param[in] mode The link mode
+ * @param[in] rate The rate index
+ * @param[in] packet_time The slot period (ms)
+ * @param[in] one_way Whether only the coordinator transmits
+ * @return the packet length
+ */
+uint8_t rfm22b_link_max_packet_len(enum rfm22b_link_mode mode, uint8_t rate,
+		uint8_t packet_time, bool one_way)
+{
+	uint32_t tx_time = one_way ? packet_time : packet_time / 2;
+
+	// Older firmware sizes packets from the whole slot, and relies on the
+	// 64 byte cap to keep them inside their half of it.
+	if (mode == RFM22B_LINK_LEGACY) {
+		uint32_t bytes = data_rate[rate] * (packet_time - 2) / 9000;
+
+		if (bytes <= RFM22B_LINK_FRAMING_BYTES)
+			return 0;
+
+		bytes -= RFM22B_LINK_FRAMING_BYTES;
+
+		return bytes > RFM22B_LINK_LEGACY_PACKET_LEN ?
+			RFM22B_LINK_LEGACY_PACKET_LEN : bytes;
+	}
+
+	// Allow 2ms to turn around, and 9 bits per byte for margin
+	uint32_t bytes = data_rate[rate] * (tx_time - 2) / 9000;
+
+	if (bytes <= RFM22B_LINK_FRAMING_BYTES)
+		return 0;
+
+	bytes -= RFM22B_LINK_FRAMING_BYTES;
+
+	return bytes > RFM22B_LINK_MAX_PACKET_LEN ? RFM22B_LINK_MAX_PACKET_LEN : bytes;
+}
+
+/**
+ * Rate the recent packets.  Corrected packets count half, as they arrived
+ * but show the margin is small.
+ * @param[in] good Packets received intact
+ * @param[in] corrected Packets received with errors that were corrected
+ * @param[in] errors Packets lost or received with uncorrectable errors
+ * @return the quality, or RFM22B_LINK_QUALITY_UNKNOWN if too few were seen
+ */
+uint8_t rfm22b_link_quality(uint32_t good, uint32_t corrected, uint32_t errors)
+{
+	uint32_t total = good + corrected + errors;
+
+	if (total < QUALITY_MIN_SAMPLES)
+		return RFM22B_LINK_QUALITY_UNKNOWN;
+
+	return (RFM22B_LINK_QUALITY_MAX * (2 * good + corrected) + total) / (2 * total);
+}
+
+/**
+ * Forget the packets seen, e.g. after changing rate
+ * @param[in] q The quality window
+ */
+void rfm22b_link_quality_reset(struct rfm22b_link_quality *q)
+{
+	q->good = 0;
+	q->corrected = 0;
+	q->lost = 0;
+	q->quality = RFM22B_LINK_QUALITY_UNKNOWN;
+}
+
+/**
+ * Count a received or lost packet, and rate the window once it is full
+ * @param[in] q The quality window
+ * @param[in] rx What became of the packet
+ */
+void rfm22b_link_quality_add(struct rfm22b_link_quality *q, enum rfm22b_link_rx rx)
+{
+	switch (rx) {
+	case RFM22B_LINK_RX_GOOD:
+		q->good++;
+		break;
+	case RFM22B_LINK_RX_CORRECTED:
+		q->corrected++;
+		break;
+	case RFM22B_LINK_RX_LOST:
+		q->lost++;
+		break;
+	}
+
+	if (q->good + q->corrected + q->lost >= RFM22B_LINK_QUALITY_WINDOW) {
+		q->quality = rfm22b_link_quality(q->good, q->corrected, q->lost);
+		q->good = 0;
+		q->corrected = 0;
+		q->lost = 0;
+	}
+}
+
+static void set_rate(struct rfm22b_link_rate *r, uint8_t rate, uint32_t now_ms)
+{
+	r->rate = rate;
+	r->next_rate = rate;
+	r->eval_ms = now_ms;
+	r->lost = false;
+	r->good_evals = 0;
+	r->peer_quality = RFM22B_LINK_QUALITY_UNKNOWN;
+}
+
+/**
+ * Start at the highest rate, which is where a link that comes up strong
+ * belongs; if the other modem is not there, both fall back to the lowest.
+ * @param[in] r The rate state
+ * @param[in] min_rate The lowest rate to use
+ * @param[in] max_rate The highest rate to use
+ * @param[in] now_ms The current time
+ */
+void rfm22b_link_rate_init(struct rfm22b_link_rate *r, uint8_t min_rate,
+		uint8_t max_rate, uint32_t now_ms)
+{
+	if (max_rate >= RFM22B_LINK_NUM_RATES)
+		max_rate = RFM22B_LINK_NUM_RATES - 1;
+	if (min_rate > max_rate)
+		min_rate = max_rate;
+
+	r->min_rate = min_rate;
+	r->max_rate = max_rate;
+
+	set_rate(r, max_rate, now_ms);
+}
+
+/**
+ * Get the control byte that starts each packet.  The low nibble is the rate:
+ * the coordinator sends the rate it is changing to, the other modem the rate
+ * it is on.  The high nibble is the number of slot boundaries until the change
+ * from the coordinator, 15 meaning at least that many, and the link quality
+ * from the other modem.
+ * @param[in] r The rate state
+ * @param[in] coordinator Whether this modem is the coordinator
+ * @param[in] own_quality The quality of the packets this modem receives
+ * @param[in] packet_time The slot period (ms)
+ * @param[in] now_ms The current time
+ * @return the control byte
+ */
+uint8_t rfm22b_link_rate_tx_control(const struct rfm22b_link_rate *r,
+		bool coordinator, uint8_t own_quality, uint8_t packet_time,
+		uint32_t now_ms)
+{
+	if (!coordinator)
+		return r->rate | (own_quality << 4);
+
+	if (r->next_rate == r->rate)
+		return r->rate;
+
+	uint32_t slots = 0;
+	if ((int32_t) (r->switch_ms - now_ms) > 0)
+		slots = r->switch_ms / packet_time - now_ms / packet_time;
+
+	return r->next_rate | ((slots > 15 ? 15 : slots) << 4);
+}
+
+/**
+ * Handle the control byte of a packet received from the other modem
+ * @param[in] r The rate state
+ * @param[in] coordinator Whether this modem is the coordinator
+ * @param[in] control The control byte
+ * @param[in] packet_time The slot period (ms)
+ * @param[in] now_ms The current time
+ */
+void rfm22b_link_rate_rx_control(struct rfm22b_link_rate *r, bool coordinator,
+		uint8_t control, uint8_t packet_time, uint32_t now_ms)
+{
+	uint8_t rate = control & 0x0f;
+	uint8_t high = control >> 4;
+
+	if (coordinator) {
+		// Only trust the quality of a modem on the same rate
+		if (rate == r->rate)
+			r->peer_quality = high;
+		return;
+	}
+
+	if (rate < r->min_rate || rate > r->max_rate)
+		return;
+
+	if (rate == r->rate) {
+		r->next_rate = rate;
+		return;
+	}
+
+	// The packet arrives in the slot it was sent in, so counting slot
+	// boundaries from here finds the same instant as the coordinator.
+	if (high < 15) {
+		r->next_rate = rate;
+		r->switch_ms = (now_ms / packet_time + high) * packet_time;
+	}
+}
+
+/**
+ * Advance the rate state; called regularly from the radio task
+ * @param[in] r The rate state
+ * @param[in] coordinator Whether this modem is the coordinator
+ * @param[in] connected Whether the link is up
+ * @param[in] own_quality The quality of the packets this modem receives
+ * @param[in] packet_time The slot period (ms) at the current rate
+ * @param[in] now_ms The current time
+ * @return true if the rate changed and the radio must be reconfigured
+ */
+bool rfm22b_link_rate_update(struct rfm22b_link_rate *r, bool coordinator,
+		bool connected, uint8_t own_quality, uint8_t packet_time,
+		uint32_t now_ms)
+{
+	if (r->next_rate != r->rate && (int32_t) (now_ms - r->switch_ms) >= 0) {
+		set_rate(r, r->next_rate, now_ms);
+		return true;
+	}
+
+	if (!connected) {
+		if (!r->lost) {
+			r->lost = true;
+			r->lost_ms = now_ms;
+		} else if (now_ms - r->lost_ms >= RFM22B_LINK_FALLBACK_MS &&
+				r->rate != r->min_rate) {
+			set_rate(r, r->min_rate, now_ms);
+			return true;
+		}
+
+		return false;
+	}
+
+	r->lost = false;
+
+	if (!coordinator || r->next_rate != r->rate ||
+			now_ms - r->eval_ms < RFM22B_LINK_EVAL_MS)
+		return false;
+
+	r->eval_ms = now_ms;
+
+	if (own_quality == RFM22B_LINK_QUALITY_UNKNOWN ||
+			r->peer_quality == RFM22B_LINK_QUALITY_UNKNOWN)
+		return false;
+
+	uint8_t quality = own_quality < r->peer_quality ? own_quality : r->peer_quality;
+	uint8_t next = r->rate;
+
+	if (quality < RFM22B_LINK_DOWN_QUALITY) {
+		r->good_evals = 0;
+		if (r->rate > r->min_rate)
+			next = r->rate - 1;
+	} else if (quality >= RFM22B_LINK_UP_QUALITY) {
+		if (++r->good_evals >= RFM22B_LINK_UP_EVALS && r->rate < r->max_rate) {
+			r->good_evals = 0;
+			next = r->rate + 1;
+		}
+	} else {
+		r->good_evals = 0;
+	}
+
+	// Change at the start of a hop cycle, which every rate shares
+	if (next != r->rate) {
+		uint32_t earliest = now_ms + RFM22B_LINK_SWITCH_SLOTS * packet_time;
+
+		r->next_rate = next;
+		r->switch_ms = (earliest + RFM22B_LINK_HOP_CYCLE_MS - 1) /
+			RFM22B_LINK_HOP_CYCLE_MS * RFM22B_LINK_HOP_CYCLE_MS;
+	}
+
+	return false;
+}
+
+/**
+ * @}
+ */
@@ -38,47 +38,34 @@
 #include <stdio.h>
 #include "ecc.h"
 
-/* The Error Locator Polynomial, also known as Lambda or Sigma. Lambda[0] == 1 */
-static int Lambda[MAXDEG];
-
-/* The Error Evaluator Polynomial */
-static int Omega[MAXDEG];
-
 /* local ANSI declarations */
 static int compute_discrepancy(int lambda[], int S[], int L, int n);
-static void init_gamma(int gamma[]);
-static void compute_modified_omega (void);
+static void init_gamma(int gamma[], int nerasures, const int erasures[]);
+static void compute_modified_omega (struct rs_decoder *dec);
 static void mul_z_poly (int src[]);
 
-/* error locations found using Chien's search*/
-static int ErrorLocs[256];
-static int NErrors;
-
-/* erasure flags */
-static int ErasureLocs[256];
-static int NErasures;
-
-/* From  Cain, Clark, "Error-Correction Coding For Digital Communications", pp. 216. */
-void
-Modified_Berlekamp_Massey (void)
+/* From  Cain, Clark, "Error-Correction Coding For Digital Communications", pp. 216.
+ * Returns the length of the shortest LFSR generating the syndrome. */
+static int
+Modified_Berlekamp_Massey (struct rs_decoder *dec, int nerasures, const int erasures[])
 {	
   int n, L, L2, k, d, i;
   int psi[MAXDEG], psi2[MAXDEG], D[MAXDEG];
   int gamma[MAXDEG];
 	
   /* initialize Gamma, the erasure locator polynomial */
-  init_gamma(gamma);
+  init_gamma(gamma, nerasures, erasures);
 
   /* initialize to z */
   copy_poly(D, gamma);
   mul_z_poly(D);
 	
   copy_poly(psi, gamma);	
-  k = -1; L = NErasures;
+  k = -1; L = nerasures;
 	
-  for (n = NErasures; n < RS_ECC_NPARITY; n++) {
+  for (n = nerasures; n < RS_ECC_NPARITY; n++) {
 	
-    d = compute_discrepancy(psi, synBytes, L, n);
+    d = compute_discrepancy(psi, dec->syndrome, L, n);
 		
     if (d != 0) {
 		
@@ -101,25 +88,25 @@ Modified_Berlekamp_Massey (void)
     mul_z_poly(D);
   }
 	
-  for(i = 0; i < MAXDEG; i++) Lambda[i] = psi[i];
-  compute_modified_omega();
+  for(i = 0; i < MAXDEG; i++) dec->lambda[i] = psi[i];
+  compute_modified_omega(dec);
 
-	
+  return L;
 }
 
-/* given Psi (called Lambda in Modified_Berlekamp_Massey) and synBytes,
+/* given Psi (called Lambda in Modified_Berlekamp_Massey) and the syndrome,
    compute the combined erasure/error evaluator polynomial as 
    Psi*S mod z^4
   */
-void
-compute_modified_omega ()
+static void
+compute_modified_omega (struct rs_decoder *dec)
 {
   int i;
   int product[MAXDEG*2];
 	
-  mult_polys(product, Lambda, synBytes);	
-  zero_poly(Omega);
-  for(i = 0; i < RS_ECC_NPARITY; i++) Omega[i] = product[i];
+  mult_polys(product, dec->lambda, dec->syndrome);	
+  zero_poly(dec->omega);
+  for(i = 0; i < RS_ECC_NPARITY; i++) dec->omega[i] = product[i];
 
 }
 
@@ -149,8 +136,8 @@ mult_polys (int dst[], int p1[], int p2[])
 
 	
 /* gamma = product (1-z*a^Ij) for erasure locs Ij */
-void
-init_gamma (int gamma[])
+static void
+init_gamma (int gamma[], int nerasures, const int erasures[])
 {
   int e, tmp[MAXDEG];
 	
@@ -158,9 +145,9 @@ init_gamma (int gamma[])
   zero_poly(tmp);
   gamma[0] = 1;
 	
-  for (e = 0; e < NErasures; e++) {
+  for (e = 0; e < nerasures; e++) {
     copy_poly(tmp, gamma);
-    scale_poly(gexp[ErasureLocs[e]], tmp);
+    scale_poly(gexp[erasures[e]], tmp);
     mul_z_poly(tmp);
     add_polys(gamma, tmp);
   }
@@ -168,18 +155,7 @@ init_gamma (int gamma[])
 	
 	
 	
-void 
-compute_next_omega (int d, int A[], int dst[], int src[])
-{
-  int i;
-  for ( i = 0; i < MAXDEG;  i++) {
-    dst[i] = src[i] ^ gmult(d, A[i]);
-  }
-}
-	
-
-
-int
+static int
 compute_discrepancy (int lambda[], int S[], int L, int n)
 {
   int i, sum=0;
@@ -226,99 +202,109 @@ static void mul_z_poly (int src[])
 }
 
 
-/* Finds all the roots of an error-locator polynomial with coefficients
- * Lambda[j] by evaluating Lambda at successive values of alpha. 
- * 
- * This can be tested with the decoder's equations case.
+/* Finds the roots of the error-locator polynomial by evaluating
+ * Lambda at a^(-i) for each location i in the codeword (Chien's
+ * search).  Locations past the end of the codeword cannot be errors,
+ * so they are not searched.  The terms are looked up from the logs
+ * of the coefficients, the exponents k*(255-i) kept up to date by
+ * subtracting k at each step.  Both fit a byte, which keeps the
+ * search light on the caller's stack.
+ *
+ * Returns the degree of Lambda, which is how many roots there are
+ * when the errors are correctable.
  */
 
-
-void 
-Find_Roots (void)
+static int
+Find_Roots (struct rs_decoder *dec, int csize)
 {
-  int sum, r, k;	
-  NErrors = 0;
-  
-  for (r = 1; r < 256; r++) {
+  int i, k, deg = 0, sum;
+  uint8_t loglambda[MAXDEG], e[MAXDEG];
+
+  for (k = 0; k < MAXDEG; k++) {
+    if (dec->lambda[k] != 0) deg = k;
+    loglambda[k] = glog[dec->lambda[k]];
+    e[k] = 0;
+  }
+
+  dec->nerrors = 0;
+
+  if (deg == 0 || deg > RS_ECC_NPARITY)
+    return deg;
+
+  if (csize > 255) csize = 255;
+
+  for (i = 0; i < csize && dec->nerrors < deg; i++) {
     sum = 0;
-    /* evaluate lambda at r */
-    for (k = 0; k < RS_ECC_NPARITY+1; k++) {
-      sum ^= gmult(gexp[(k*r)%255], Lambda[k]);
+    for (k = 0; k <= deg; k++) {
+      if (dec->lambda[k] != 0)
+	sum ^= gexp[loglambda[k] + e[k]];
+
+      e[k] = (e[k] >= k) ? e[k] - k : e[k] + 255 - k;
     }
-    if (sum == 0) 
-      { 
-	ErrorLocs[NErrors] = (255-r); NErrors++; 
-	//if (DEBUG) fprintf(stderr, "Root found at r = %d, (255-r) = %d\n", r, (255-r));
-      }
+
+    if (sum == 0)
+      dec->error_locs[dec->nerrors++] = i;
   }
+
+  return deg;
 }
 
 /* Combined Erasure And Error Magnitude Computation 
  * 
  * Pass in the codeword, its size in bytes, as well as
  * an array of any known erasure locations, along the number
- * of these erasures.
+ * of these erasures.  The syndrome must have been computed
+ * into dec by rs_syndrome() first.
  * 
  * Evaluate Omega(actually Psi)/Lambda' at the roots
  * alpha^(-i) for error locs i. 
  *
- * Returns 1 if everything ok, or 0 if an out-of-bounds error is found
+ * Returns 1 if everything ok, or 0 if the codeword cannot be
+ * corrected: there are more errors than the parity can locate, or
+ * Lambda does not have as many roots inside it as its degree.
+ * The codeword is not modified then.
  *
  */
 
 int
-correct_errors_erasures (unsigned char codeword[], 
-			 int csize,
-			 int nerasures,
-			 int erasures[])
+rs_correct (struct rs_decoder *dec,
+	    unsigned char codeword[], 
+	    int csize,
+	    int nerasures,
+	    const int erasures[])
 {
-  int r, i, j, err;
+  int r, i, j, err, deg, L;
 
-  /* If you want to take advantage of erasure correction, be sure to
-     set NErasures and ErasureLocs[] with the locations of erasures. 
+  /* If you want to take advantage of erasure correction, pass the
+     locations of erasures. 
      */
-  NErasures = nerasures;
-  for (i = 0; i < NErasures; i++) ErasureLocs[i] = erasures[i];
-
-  Modified_Berlekamp_Massey();
-  Find_Roots();
-  
-
-  if ((NErrors <= RS_ECC_NPARITY) && NErrors > 0) { 
+  L = Modified_Berlekamp_Massey(dec, nerasures, erasures);
+  deg = Find_Roots(dec, csize);
 
-    /* first check for illegal error locs */
-    for (r = 0; r < NErrors; r++) {
-      if (ErrorLocs[r] >= csize) {
-				//if (DEBUG) fprintf(stderr, "Error loc i=%d outside of codeword length %d\n", i, csize);
-	return(0);
-      }
-    }
+  /* Each error takes two parity bytes, each erasure one */
+  if (dec->nerrors == 0 || dec->nerrors != deg || deg != L ||
+      2 * deg - nerasures > RS_ECC_NPARITY) {
+    return(0);
+  }
 
-    for (r = 0; r < NErrors; r++) {
-      int num, denom;
-      i = ErrorLocs[r];
-      /* evaluate Omega at alpha^(-i) */
+  for (r = 0; r < dec->nerrors; r++) {
+    int num, denom;
+    i = dec->error_locs[r];
+    /* evaluate Omega at alpha^(-i) */
 
-      num = 0;
-      for (j = 0; j < MAXDEG; j++) 
-	num ^= gmult(Omega[j], gexp[((255-i)*j)%255]);
+    num = 0;
+    for (j = 0; j < MAXDEG; j++) 
+      num ^= gmult(dec->omega[j], gexp[((255-i)*j)%255]);
       
-      /* evaluate Lambda' (derivative) at alpha^(-i) ; all odd powers disappear */
-      denom = 0;
-      for (j = 1; j < MAXDEG; j += 2) {
-	denom ^= gmult(Lambda[j], gexp[((255-i)*(j-1)) % 255]);
-      }
+    /* evaluate Lambda' (derivative) at alpha^(-i) ; all odd powers disappear */
+    denom = 0;
+    for (j = 1; j < MAXDEG; j += 2) {
+      denom ^= gmult(dec->lambda[j], gexp[((255-i)*(j-1)) % 255]);
+    }
       
-      err = gmult(num, ginv(denom));
-      //if (DEBUG) fprintf(stderr, "Error magnitude %#x at loc %d\n", err, csize-i);
+    err = gmult(num, ginv(denom));
       
-      codeword[csize-i-1] ^= err;
-    }
-    return(1);
-  }
-  else {
-    //if (DEBUG && NErrors) fprintf(stderr, "Uncorrectable codeword\n");
-    return(0);
+    codeword[csize-i-1] ^= err;
   }
+  return(1);
 }
-
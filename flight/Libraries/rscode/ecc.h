@@ -45,7 +45,11 @@
 /****************************************************************/
 
 
+#ifndef ECC_H
+#define ECC_H
+
 #include <openpilot.h>
+#include <stdint.h>
 
 #if !defined(TRUE) && !defined(FALSE)
 #define TRUE 1
@@ -61,36 +65,43 @@ typedef unsigned short BIT16;
 #define MAXDEG (RS_ECC_NPARITY*2)
 
 /*************************************/
-/* Encoder parity bytes */
-extern int pBytes[MAXDEG];
-
-/* Decoder syndrome bytes */
-extern int synBytes[MAXDEG];
-
-/* print debugging info */
-extern int DEBUG;
-
-/* Reed Solomon encode/decode routines */
+/* State of one decode, so packets can be decoded concurrently.
+ * The syndrome is only NPAR long, the upper half stays zero so it
+ * can be used as a polynomial. */
+struct rs_decoder {
+  int syndrome[MAXDEG];
+  int lambda[MAXDEG];		/* error locator, lambda[0] == 1 */
+  int omega[MAXDEG];		/* error evaluator */
+  int error_locs[RS_ECC_NPARITY];
+  int nerrors;
+};
+
+/* Reed Solomon encode/decode routines.  Everything but
+ * initialize_ecc() only reads shared tables and is reentrant. */
 void initialize_ecc (void);
+void rs_encode (const unsigned char msg[], int nbytes, unsigned char dst[]);
+int rs_syndrome (struct rs_decoder *dec, const unsigned char data[], int nbytes);
+int rs_correct (struct rs_decoder *dec, unsigned char codeword[], int csize,
+		int nerasures, const int erasures[]);
+
+/* Older interface, all sharing one decoder; not reentrant */
 int check_syndrome (void);
 void decode_data (unsigned char data[], int nbytes);
 void encode_data (unsigned char msg[], int nbytes, unsigned char dst[]);
+int correct_errors_erasures (unsigned char codeword[], int csize,int nerasures, int erasures[]);
 
 /* CRC-CCITT checksum generator */
 BIT16 crc_ccitt(unsigned char *msg, int len);
 
-/* galois arithmetic tables */
-extern const int gexp[];
-extern const int glog[];
+/* galois arithmetic tables; gexp[] is doubled so the sum of two
+ * logs can index it without a modulo */
+extern const uint8_t gexp[];
+extern const uint8_t glog[];
 
 void init_galois_tables (void);
 int ginv(int elt); 
 int gmult(int a, int b);
 
-
-/* Error location routines */
-int correct_errors_erasures (unsigned char codeword[], int csize,int nerasures, int erasures[]);
-
 /* polynomial arithmetic */
 void add_polys(int dst[], int src[]) ;
 void scale_poly(int k, int poly[]);
@@ -98,3 +109,5 @@ void mult_polys(int dst[], int p1[], int p2[]);
 
 void copy_poly(int dst[], int src[]);
 void zero_poly(int poly[]);
+
+#endif /* ECC_H */
@@ -29,16 +29,13 @@
 #include <ctype.h>
 #include "ecc.h"
 
-/* Encoder parity bytes */
-int pBytes[MAXDEG];
+/* Logs of the generator polynomial coefficients, less the implicit
+ * leading 1.  None of them is zero for any NPAR up to 32, so the
+ * encoder never has to check them. */
+static uint8_t genLog[RS_ECC_NPARITY];
 
-/* Decoder syndrome bytes */
-int synBytes[MAXDEG];
-
-/* generator polynomial */
-int genPoly[MAXDEG*2];
-
-int DEBUG = FALSE;
+/* Decoder behind the older, non reentrant interface */
+static struct rs_decoder shared_decoder;
 
 static void
 compute_genpoly (int nbytes, int genpoly[]);
@@ -47,87 +44,77 @@ compute_genpoly (int nbytes, int genpoly[]);
 void
 initialize_ecc ()
 {
+  int i, genPoly[MAXDEG*2];
+
   /* Initialize the galois field arithmetic tables */
     init_galois_tables();
 
     /* Compute the encoder generator polynomial */
     compute_genpoly(RS_ECC_NPARITY, genPoly);
-}
 
-void
-zero_fill_from (unsigned char buf[], int from, int to)
-{
-  int i;
-  for (i = from; i < to; i++) buf[i] = 0;
+    for (i = 0; i < RS_ECC_NPARITY; i++)
+      genLog[i] = glog[genPoly[i]];
 }
 
-/* debugging routines */
-void
-print_parity (void)
+/**********************************************************
+ * Reed Solomon Decoder 
+ *
+ * Computes the syndrome of a codeword into dec->syndrome[],
+ * S[j] = sum of data[i] * a^((j+1)*(nbytes-1-i)), working on the
+ * logs: one lookup per nonzero byte, then one per parity byte.
+ *
+ * Returns 1 if the codeword is clean, which is the common case and
+ * needs no further work.
+ */
+
+int
+rs_syndrome (struct rs_decoder *dec, const unsigned char data[], int nbytes)
 {
-#ifdef NEVER
-  int i;
-  printf("Parity Bytes: ");
-  for (i = 0; i < RS_ECC_NPARITY; i++) 
-    printf("[%d]:%x, ",i,pBytes[i]);
-  printf("\n");
-#endif
-}
+  int i, j, l, nz = 0;
+  uint8_t e[RS_ECC_NPARITY], s[RS_ECC_NPARITY];
 
+  for (j = 0; j < RS_ECC_NPARITY; j++) {
+    e[j] = 0;
+    s[j] = 0;
+  }
 
-void
-print_syndrome (void)
-{
-#ifdef NEVER
-  int i;
-  printf("Syndrome Bytes: ");
-  for (i = 0; i < RS_ECC_NPARITY; i++) 
-    printf("[%d]:%x, ",i,synBytes[i]);
-  printf("\n");
-#endif
-}
+  /* e[j] tracks (j+1)*(nbytes-1-i) mod 255, from the last byte back */
+  for (i = nbytes - 1; i >= 0; i--) {
+    if (data[i] != 0) {
+      l = glog[data[i]];
+      for (j = 0; j < RS_ECC_NPARITY; j++)
+	s[j] ^= gexp[l + e[j]];
+    }
 
-/* Append the parity bytes onto the end of the message */
-void
-build_codeword (unsigned char msg[], int nbytes, unsigned char dst[])
-{
-  int i;
-	
-  for (i = 0; i < nbytes; i++) dst[i] = msg[i];
-	
-  for (i = 0; i < RS_ECC_NPARITY; i++) {
-    dst[i+nbytes] = pBytes[RS_ECC_NPARITY-1-i];
+    for (j = 0; j < RS_ECC_NPARITY; j++) {
+      l = e[j] + j + 1;
+      e[j] = (l >= 255) ? l - 255 : l;
+    }
   }
+
+  for (j = 0; j < RS_ECC_NPARITY; j++) {
+    dec->syndrome[j] = s[j];
+    nz |= s[j];
+  }
+  for (; j < MAXDEG; j++)
+    dec->syndrome[j] = 0;
+
+  return (nz == 0);
 }
-	
-/**********************************************************
- * Reed Solomon Decoder 
- *
- * Computes the syndrome of a codeword. Puts the results
- * into the synBytes[] array.
- */
- 
+
 void
 decode_data(unsigned char data[], int nbytes)
 {
-  int i, j, sum;
-  for (j = 0; j < RS_ECC_NPARITY;  j++) {
-    sum	= 0;
-    for (i = 0; i < nbytes; i++) {
-      sum = data[i] ^ gmult(gexp[j+1], sum);
-    }
-    synBytes[j]  = sum;
-  }
+  rs_syndrome(&shared_decoder, data, nbytes);
 }
 
-
 /* Check if the syndrome is zero */
 int
 check_syndrome (void)
 {
  int i, nz = 0;
  for (i =0 ; i < RS_ECC_NPARITY; i++) {
-  if (synBytes[i] != 0) {
+  if (shared_decoder.syndrome[i] != 0) {
       nz = 1;
       break;
   }
@@ -135,18 +122,13 @@ check_syndrome (void)
  return nz;
 }
 
-
-void
-debug_check_syndrome (void)
-{	
-#ifdef NEVER
-  int i;
-	
-  for (i = 0; i < 3; i++) {
-    printf(" inv log S[%d]/S[%d] = %d\n", i, i+1, 
-	   glog[gmult(synBytes[i], ginv(synBytes[i+1]))]);
-  }
-#endif
+int
+correct_errors_erasures (unsigned char codeword[], 
+			 int csize,
+			 int nerasures,
+			 int erasures[])
+{
+  return rs_correct(&shared_decoder, codeword, csize, nerasures, erasures);
 }
 
 
@@ -179,29 +161,43 @@ compute_genpoly (int nbytes, int genpoly[])
 /* Simulate a LFSR with generator polynomial for n byte RS code. 
  * Pass in a pointer to the data array, and amount of data. 
  *
- * The parity bytes are deposited into pBytes[], and the whole message
- * and parity are copied to dest to make a codeword.
- * 
+ * The whole message and the parity bytes are copied to dst to make
+ * a codeword; dst may be msg itself.  The products with the generator
+ * are looked up from its logs, once per byte.
  */
 
 void
-encode_data (unsigned char msg[], int nbytes, unsigned char dst[])
+rs_encode (const unsigned char msg[], int nbytes, unsigned char dst[])
 {
-  int i, LFSR[RS_ECC_NPARITY+1],dbyte, j;
+  int i, j, l;
+  uint8_t LFSR[RS_ECC_NPARITY], dbyte;
 	
-  for(i=0; i < RS_ECC_NPARITY+1; i++) LFSR[i]=0;
+  for (i = 0; i < RS_ECC_NPARITY; i++) LFSR[i] = 0;
 
   for (i = 0; i < nbytes; i++) {
     dbyte = msg[i] ^ LFSR[RS_ECC_NPARITY-1];
-    for (j = RS_ECC_NPARITY-1; j > 0; j--) {
-      LFSR[j] = LFSR[j-1] ^ gmult(genPoly[j], dbyte);
+    if (dbyte == 0) {
+      for (j = RS_ECC_NPARITY-1; j > 0; j--)
+	LFSR[j] = LFSR[j-1];
+      LFSR[0] = 0;
+    } else {
+      l = glog[dbyte];
+      for (j = RS_ECC_NPARITY-1; j > 0; j--)
+	LFSR[j] = LFSR[j-1] ^ gexp[genLog[j] + l];
+      LFSR[0] = gexp[genLog[0] + l];
     }
-    LFSR[0] = gmult(genPoly[0], dbyte);
   }
 
-  for (i = 0; i < RS_ECC_NPARITY; i++) 
-    pBytes[i] = LFSR[i];
-	
-  build_codeword(msg, nbytes, dst);
+  if (dst != msg)
+    for (i = 0; i < nbytes; i++) dst[i] = msg[i];
+
+  for (i = 0; i < RS_ECC_NPARITY; i++)
+    dst[i+nbytes] = LFSR[RS_ECC_NPARITY-1-i];
+}
+
+void
+encode_data (unsigned char msg[], int nbytes, unsigned char dst[])
+{
+  rs_encode(msg, nbytes, dst);
 }
 
@@ -55,6 +55,7 @@
 #include "pios_thread.h"
 #include "pios_queue.h"
 #include "misc_math.h"
+#include "actuator_mixer.h"
 
 // Private constants
 #define MAX_QUEUE_SIZE 2
@@ -68,7 +69,6 @@
 #define TASK_PRIORITY PIOS_THREAD_PRIO_HIGHEST
 #define FAILSAFE_TIMEOUT_MS 100
 #define MAX_MIX_ACTUATORS ACTUATORCOMMAND_CHANNEL_NUMELEM
-#define MULTIROTOR_MIXER_UPPER_BOUND 128
 
 // Private types
 
@@ -87,6 +87,9 @@ static volatile bool mixer_settings_updated = true;
 // The actual mixer settings data, pulled at the top of the actuator thread
 static MixerSettingsData mixerSettings;
 
+// The mixer settings as the loop uses them, rebuilt when they change
+static struct mixer_matrix mixer;
+
 // Ditto, for the actuator settings.
 static ActuatorSettingsData actuatorSettings;
 
@@ -98,13 +101,7 @@ static float throt_curve(const float input, const float* curve, uint8_t num_poin
 static float collective_curve(const float input, const float* curve, uint8_t num_points);
 static bool set_channel(uint8_t mixer_channel, float value);
 static void actuator_set_servo_mode(void);
-float process_mixer(const int index, const float curve1, const float curve2,
-		ActuatorDesiredData *desired);
-static float mix_channel(int ct, ActuatorDesiredData *desired,
-		float curve1, float curve2);
-
-static MixerSettingsMixer1TypeOptions get_mixer_type(int idx);
-static typeof(mixerSettings.Mixer1Vector) *get_mixer_vec(int idx);
+static float mix_channel(int ct);
 
 /**
  * @brief Module initialization
@@ -256,6 +253,7 @@ static void actuator_task(void* parameters)
 		if (mixer_settings_updated) {
 			mixer_settings_updated = false;
 			MixerSettingsGet(&mixerSettings);
+			mixer_matrix_compile(&mixer, &mixerSettings);
 			SystemSettingsAirframeTypeGet(&airframe_type);
 		}
 
@@ -297,14 +295,7 @@ static void actuator_task(void* parameters)
 			manualControlCommandUpdated = false;
 		}
 
-		int nMixers = 0;
-
-		for (int ct = 0; ct < MAX_MIX_ACTUATORS; ct++) {
-			if (get_mixer_type(ct) != MIXERSETTINGS_MIXER1TYPE_DISABLED) {
-				nMixers++;
-			}
-		}
-		if ((nMixers < 2) && !ActuatorCommandReadOnly()) { //Nothing can fly with less than two mixers.
+		if ((mixer.num_enabled < 2) && !ActuatorCommandReadOnly()) { //Nothing can fly with less than two mixers.
 			set_failsafe(); // So that channels like PWM buzzer keep working
 			continue;
 		}
@@ -359,10 +350,24 @@ static void actuator_task(void* parameters)
 		float neg_clip = 0;
 		int num_motors = 0;
 
+		const float inputs[MIXER_NUM_INPUTS] = {
+			[MIXER_INPUT_CURVE1] = curve1,
+			[MIXER_INPUT_CURVE2] = curve2,
+			[MIXER_INPUT_ROLL] = desired.Roll,
+			[MIXER_INPUT_PITCH] = desired.Pitch,
+			[MIXER_INPUT_YAW] = desired.Yaw,
+		};
+
+		// Motors and servos in one pass, then the other channel types
+		mixer_matrix_mix(&mixer, inputs, status);
+
 		for (int ct = 0; ct < MAX_MIX_ACTUATORS; ct++) {
-			status[ct] = mix_channel(ct, &desired, curve1, curve2);
+			if (mixer.type[ct] != MIXERSETTINGS_MIXER1TYPE_MOTOR &&
+					mixer.type[ct] != MIXERSETTINGS_MIXER1TYPE_SERVO) {
+				status[ct] = mix_channel(ct);
+			}
 
-			if (get_mixer_type(ct) == MIXERSETTINGS_MIXER1TYPE_MOTOR) {
+			if (mixer_matrix_is_motor(&mixer, ct)) {
 				min_chan = fminf(min_chan, status[ct]);
 				max_chan = fmaxf(max_chan, status[ct]);
 
@@ -417,7 +422,7 @@ static void actuator_task(void* parameters)
 
 		for (int ct = 0; ct < MAX_MIX_ACTUATORS; ct++) {
 			// Motors have additional protection for when to be on
-			if (get_mixer_type(ct) == MIXERSETTINGS_MIXER1TYPE_MOTOR) {
+			if (mixer_matrix_is_motor(&mixer, ct)) {
 				if (!armed) {
 					status[ct] = -1;  //force min throttle
 				} else if (!stabilize_now) {
@@ -478,25 +483,6 @@ static void actuator_task(void* parameters)
 	}
 }
 
-/**
- *Process mixing for one actuator
- */
-float process_mixer(const int index, const float curve1, const float curve2,
-		ActuatorDesiredData *desired)
-{
-	// Taking the pointer to the array preserves type information so smart compilers
-	// can detect accesses past the end.
-	typeof(mixerSettings.Mixer1Vector) *vector = get_mixer_vec(index);
-
-	float result = (((*vector)[MIXERSETTINGS_MIXER1VECTOR_THROTTLECURVE1] * curve1) +
-			((*vector)[MIXERSETTINGS_MIXER1VECTOR_THROTTLECURVE2] * curve2) +
-			((*vector)[MIXERSETTINGS_MIXER1VECTOR_ROLL] * desired->Roll) +
-			((*vector)[MIXERSETTINGS_MIXER1VECTOR_PITCH] * desired->Pitch) +
-			((*vector)[MIXERSETTINGS_MIXER1VECTOR_YAW] * desired->Yaw)) * (1.0f / MULTIROTOR_MIXER_UPPER_BOUND);
-
-	return (result);
-}
-
 /**
  * Interpolate a throttle curve
  *
@@ -559,7 +545,7 @@ static float scale_channel(float value, int idx)
 
 static float channel_failsafe_value(int idx)
 {
-	switch (get_mixer_type(idx)) {
+	switch (mixer.type[idx]) {
 	case MIXERSETTINGS_MIXER1TYPE_MOTOR:
 		return actuatorSettings.ChannelMin[idx];
 	case MIXERSETTINGS_MIXER1TYPE_SERVO:
@@ -724,10 +710,13 @@ static void actuator_set_servo_mode(void)
 			actuatorSettings.ChannelMin);
 }
 
-static float mix_channel(int ct, ActuatorDesiredData *desired,
-		float curve1, float curve2)
+/**
+ * Mix a channel that is not a motor or servo, those come from the
+ * mixer matrix
+ */
+static float mix_channel(int ct)
 {
-	MixerSettingsMixer1TypeOptions type = get_mixer_type(ct);
+	MixerSettingsMixer1TypeOptions type = mixer.type[ct];
 
 	switch (type) {
 	case MIXERSETTINGS_MIXER1TYPE_DISABLED:
@@ -736,14 +725,8 @@ static float mix_channel(int ct, ActuatorDesiredData *desired,
 		break;
 
 	case MIXERSETTINGS_MIXER1TYPE_SERVO:
-		return process_mixer(ct, curve1, curve2, desired);
-		break;
-
 	case MIXERSETTINGS_MIXER1TYPE_MOTOR:
-		(void) 0;               // nil statement
-		float val = process_mixer(ct, curve1, curve2, desired);
-
-		return val;
+		// Mixed by mixer_matrix_mix()
 		break;
 	// If an accessory channel is selected for direct bypass mode
 	// In this configuration the accessory channel is scaled and
@@ -792,85 +775,8 @@ static float mix_channel(int ct, ActuatorDesiredData *desired,
 	return -1;
 }
 
-static MixerSettingsMixer1TypeOptions get_mixer_type(int idx)
-{
-	switch (idx) {
-	case 0:
-		return mixerSettings.Mixer1Type;
-		break;
-	case 1:
-		return mixerSettings.Mixer2Type;
-		break;
-	case 2:
-		return mixerSettings.Mixer3Type;
-		break;
-	case 3:
-		return mixerSettings.Mixer4Type;
-		break;
-	case 4:
-		return mixerSettings.Mixer5Type;
-		break;
-	case 5:
-		return mixerSettings.Mixer6Type;
-		break;
-	case 6:
-		return mixerSettings.Mixer7Type;
-		break;
-	case 7:
-		return mixerSettings.Mixer8Type;
-		break;
-	case 8:
-		return mixerSettings.Mixer9Type;
-		break;
-	case 9:
-		return mixerSettings.Mixer10Type;
-		break;
-	default:
-		// We can never get here unless there are mixer channels not handled in the above. Fail out.
-		PIOS_Assert(0);
-	}
-}
-
-static typeof(mixerSettings.Mixer1Vector) *get_mixer_vec(int idx)
-{
-	switch (idx) {
-	case 0:
-		return &mixerSettings.Mixer1Vector;
-		break;
-	case 1:
-		return &mixerSettings.Mixer2Vector;
-		break;
-	case 2:
-		return &mixerSettings.Mixer3Vector;
-		break;
-	case 3:
-		return &mixerSettings.Mixer4Vector;
-		break;
-	case 4:
-		return &mixerSettings.Mixer5Vector;
-		break;
-	case 5:
-		return &mixerSettings.Mixer6Vector;
-		break;
-	case 6:
-		return &mixerSettings.Mixer7Vector;
-		break;
-	case 7:
-		return &mixerSettings.Mixer8Vector;
-		break;
-	case 8:
-		return &mixerSettings.Mixer9Vector;
-		break;
-	case 9:
-		return &mixerSettings.Mixer10Vector;
-		break;
-	default:
-		// We can never get here unless there are mixer channels not handled in the above. Fail out.
-		PIOS_Assert(0);
-	}
-}
-
 DONT_BUILD_IF(ACTUATORSETTINGS_TIMERUPDATEFREQ_NUMELEM > PIOS_SERVO_MAX_BANKS, TooManyServoBanks);
+DONT_BUILD_IF(MAX_MIX_ACTUATORS != MIXER_MAX_CHANNELS, MixerChannelCount);
 
 /**
  * @}
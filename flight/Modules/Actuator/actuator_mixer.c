@@ -0,0 +1,144 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules Tau Labs Modules
+ * @{
+ * @addtogroup ActuatorModule Actuator Module
+ * @{
+ *
+ * @file       actuator_mixer.c
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ * @brief      Compile @ref MixerSettings into a matrix for the actuator loop
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "openpilot.h"
+#include "mixersettings.h"
+#include "actuator_mixer.h"
+
+#define MULTIROTOR_MIXER_UPPER_BOUND 128
+
+DONT_BUILD_IF(MIXERSETTINGS_MIXER1VECTOR_NUMELEM != MIXER_NUM_INPUTS, MixerInputCount);
+DONT_BUILD_IF((int) MIXERSETTINGS_MIXER1VECTOR_THROTTLECURVE1 != MIXER_INPUT_CURVE1, MixerInputCurve1);
+DONT_BUILD_IF((int) MIXERSETTINGS_MIXER1VECTOR_THROTTLECURVE2 != MIXER_INPUT_CURVE2, MixerInputCurve2);
+DONT_BUILD_IF((int) MIXERSETTINGS_MIXER1VECTOR_ROLL != MIXER_INPUT_ROLL, MixerInputRoll);
+DONT_BUILD_IF((int) MIXERSETTINGS_MIXER1VECTOR_PITCH != MIXER_INPUT_PITCH, MixerInputPitch);
+DONT_BUILD_IF((int) MIXERSETTINGS_MIXER1VECTOR_YAW != MIXER_INPUT_YAW, MixerInputYaw);
+
+static MixerSettingsMixer1TypeOptions get_mixer_type(const MixerSettingsData *settings, int idx)
+{
+	switch (idx) {
+	case 0:
+		return settings->Mixer1Type;
+	case 1:
+		return settings->Mixer2Type;
+	case 2:
+		return settings->Mixer3Type;
+	case 3:
+		return settings->Mixer4Type;
+	case 4:
+		return settings->Mixer5Type;
+	case 5:
+		return settings->Mixer6Type;
+	case 6:
+		return settings->Mixer7Type;
+	case 7:
+		return settings->Mixer8Type;
+	case 8:
+		return settings->Mixer9Type;
+	case 9:
+		return settings->Mixer10Type;
+	default:
+		// We can never get here unless there are mixer channels not handled in the above. Fail out.
+		PIOS_Assert(0);
+	}
+}
+
+static const int8_t *get_mixer_vec(const MixerSettingsData *settings, int idx)
+{
+	switch (idx) {
+	case 0:
+		return settings->Mixer1Vector;
+	case 1:
+		return settings->Mixer2Vector;
+	case 2:
+		return settings->Mixer3Vector;
+	case 3:
+		return settings->Mixer4Vector;
+	case 4:
+		return settings->Mixer5Vector;
+	case 5:
+		return settings->Mixer6Vector;
+	case 6:
+		return settings->Mixer7Vector;
+	case 7:
+		return settings->Mixer8Vector;
+	case 8:
+		return settings->Mixer9Vector;
+	case 9:
+		return settings->Mixer10Vector;
+	default:
+		// We can never get here unless there are mixer channels not handled in the above. Fail out.
+		PIOS_Assert(0);
+	}
+}
+
+/**
+ * Build the matrix from the mixer settings
+ * @param[out] m The compiled mixer
+ * @param[in] settings The mixer settings
+ */
+void mixer_matrix_compile(struct mixer_matrix *m, const MixerSettingsData *settings)
+{
+	m->num_rows = 0;
+	m->motor_mask = 0;
+	m->num_enabled = 0;
+
+	for (int ct = 0; ct < MIXER_MAX_CHANNELS; ct++) {
+		MixerSettingsMixer1TypeOptions type = get_mixer_type(settings, ct);
+
+		m->type[ct] = type;
+
+		if (type != MIXERSETTINGS_MIXER1TYPE_DISABLED)
+			m->num_enabled++;
+
+		if (type != MIXERSETTINGS_MIXER1TYPE_MOTOR &&
+				type != MIXERSETTINGS_MIXER1TYPE_SERVO)
+			continue;
+
+		if (type == MIXERSETTINGS_MIXER1TYPE_MOTOR)
+			m->motor_mask |= 1 << ct;
+
+		/* Scaling by a power of two is exact, so this gives the same
+		 * result as scaling the sum */
+		const int8_t *vector = get_mixer_vec(settings, ct);
+		float *row = m->row[m->num_rows];
+
+		for (int i = 0; i < MIXER_NUM_INPUTS; i++)
+			row[i] = vector[i] * (1.0f / MULTIROTOR_MIXER_UPPER_BOUND);
+
+		m->row_channel[m->num_rows] = ct;
+		m->num_rows++;
+	}
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,99 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules Tau Labs Modules
+ * @{
+ * @addtogroup ActuatorModule Actuator Module
+ * @{
+ *
+ * @file       actuator_mixer.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ * @brief      Mixer settings compiled into a matrix for the actuator loop
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef ACTUATOR_MIXER_H
+#define ACTUATOR_MIXER_H
+
+#include "openpilot.h"
+#include "mixersettings.h"
+
+//! Number of mixers in MixerSettings
+#define MIXER_MAX_CHANNELS 10
+
+//! Inputs to the matrix, in the order of the MixerSettings vectors
+enum mixer_input {
+	MIXER_INPUT_CURVE1,
+	MIXER_INPUT_CURVE2,
+	MIXER_INPUT_ROLL,
+	MIXER_INPUT_PITCH,
+	MIXER_INPUT_YAW,
+	MIXER_NUM_INPUTS
+};
+
+/**
+ * MixerSettings as the actuator loop uses them, rebuilt only when the
+ * settings change.  Motor and servo channels become rows of a dense
+ * matrix, already scaled; the other channel types are looked up from
+ * type[] instead of the per-mixer settings fields.
+ */
+struct mixer_matrix {
+	float row[MIXER_MAX_CHANNELS][MIXER_NUM_INPUTS];
+	uint8_t row_channel[MIXER_MAX_CHANNELS];	/**< Output of each row */
+	uint8_t num_rows;
+
+	uint8_t type[MIXER_MAX_CHANNELS];	/**< MixerSettingsMixer1TypeOptions */
+	uint16_t motor_mask;			/**< Bit n set for motor channels */
+	uint8_t num_enabled;			/**< Channels not disabled */
+};
+
+void mixer_matrix_compile(struct mixer_matrix *m, const MixerSettingsData *settings);
+
+/**
+ * Mix the inputs into the motor and servo channels.  Other channels
+ * are left as they are.
+ * @param[in] m The compiled mixer
+ * @param[in] in The inputs, indexed by enum mixer_input
+ * @param[out] out The channel values, indexed by channel
+ */
+static inline void mixer_matrix_mix(const struct mixer_matrix *m,
+		const float in[MIXER_NUM_INPUTS], float out[MIXER_MAX_CHANNELS])
+{
+	for (int r = 0; r < m->num_rows; r++) {
+		const float *row = m->row[r];
+
+		out[m->row_channel[r]] = row[MIXER_INPUT_CURVE1] * in[MIXER_INPUT_CURVE1] +
+			row[MIXER_INPUT_CURVE2] * in[MIXER_INPUT_CURVE2] +
+			row[MIXER_INPUT_ROLL] * in[MIXER_INPUT_ROLL] +
+			row[MIXER_INPUT_PITCH] * in[MIXER_INPUT_PITCH] +
+			row[MIXER_INPUT_YAW] * in[MIXER_INPUT_YAW];
+	}
+}
+
+static inline bool mixer_matrix_is_motor(const struct mixer_matrix *m, int idx)
+{
+	return m->motor_mask & (1 << idx);
+}
+
+#endif /* ACTUATOR_MIXER_H */
+
+/**
+  * @}
+  * @}
+  */
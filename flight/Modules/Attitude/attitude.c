@@ -55,6 +55,7 @@
 #include "physical_constants.h"
 #include "coordinate_conversions.h"
 #include "WorldMagModel.h"
+#include "attitude_samples.h"
 
 // UAVOs
 #include "accels.h"
@@ -83,6 +84,7 @@
 #define STACK_SIZE_BYTES 2504
 #define TASK_PRIORITY PIOS_THREAD_PRIO_HIGH
 #define FAILSAFE_TIMEOUT_MS 10
+#define SAMPLE_QUEUE_DEPTH 32
 
 // Private types
 
@@ -114,6 +116,10 @@ struct complementary_filter_state {
 	//! Indicate if currently acquiring gyro samples
 	bool       accumulating_gyro;
 
+	//! Yaw error from the last magnetometer update, until it is fused with a
+	//! gyro sample
+	float      mag_err_z;
+
 	//! Store when the function is initialized to time arming and convergence
 	uint32_t   reset_timeval;
 
@@ -143,6 +149,10 @@ static struct pios_queue *baroQueue;
 static struct pios_queue *gpsQueue;
 static struct pios_queue *gpsVelQueue;
 
+//! The gyro and accel samples for each estimator to integrate
+static struct attitude_samples cf_samples;
+static struct attitude_samples ins_samples;
+
 static AttitudeSettingsData attitudeSettings;
 static HomeLocationData homeLocation;
 static INSSettingsData insSettings;
@@ -168,6 +178,7 @@ static int32_t updateAttitudeComplementary(bool first_run, bool secondary, bool
 //! Set the @ref AttitudeActual to the complementary filter estimate
 static int32_t setAttitudeComplementary();
 
+static void rotate_ned_accel(float *q, const float *accels, float *accel_ned);
 static float calc_ned_accel(float *q, float *accels);
 static void cfvert_reset(struct cfvert *cf, float baro, float time_constant);
 static void cfvert_predict_pos(struct cfvert *cf, float z_accel, float dt);
@@ -181,6 +192,7 @@ static int32_t setAttitudeINSGPS();
 static int32_t setNavigationINSGPS();
 static void updateNedAccel();
 static void settingsUpdatedCb(UAVObjEvent * objEv, void *ctx, void *obj, int len);
+static void gyrosUpdatedCb(UAVObjEvent * objEv, void *ctx, void *obj, int len);
 
 //! A low pass filter on the accels which helps with vibration resistance
 static void apply_accel_filter(const float * raw, float * filtered);
@@ -193,7 +205,7 @@ static void accumulate_gyro_compute();
 static void accumulate_gyro_zero();
 
 //! Store a gyro sample
-static void accumulate_gyro(GyrosData *gyrosData);
+static void accumulate_gyro(const float *gyros, const float *bias);
 
 //! Set alarm and alarm code
 static void set_state_estimation_error(SystemAlarmsStateEstimationOptions error_code);
@@ -259,6 +271,10 @@ int32_t AttitudeStart(void)
 	gpsQueue = PIOS_Queue_Create(1, sizeof(UAVObjEvent));
 	gpsVelQueue = PIOS_Queue_Create(1, sizeof(UAVObjEvent));
 
+	if (attitude_samples_init(&cf_samples, SAMPLE_QUEUE_DEPTH) != 0 ||
+	    attitude_samples_init(&ins_samples, SAMPLE_QUEUE_DEPTH) != 0)
+		return -1;
+
 	// Initialize quaternion
 	AttitudeActualData attitude;
 	AttitudeActualGet(&attitude);
@@ -276,6 +292,8 @@ int32_t AttitudeStart(void)
 	gyrosBias.z = 0;
 	GyrosBiasSet(&gyrosBias);
 
+	// Queue the samples before the task is woken up for them
+	GyrosConnectCallback(gyrosUpdatedCb);
 	GyrosConnectQueue(gyroQueue);
 	AccelsConnectQueue(accelQueue);
 	if (MagnetometerHandle())
@@ -412,9 +430,7 @@ static float cf_q[4];
 static int32_t updateAttitudeComplementary(bool first_run, bool secondary, bool raw_gps)
 {
 	UAVObjEvent ev;
-	GyrosData gyrosData;
 	AccelsData accelsData;
-	static int32_t timeval;
 	float dT;
 
 	// If this is the primary estimation filter, wait until the accel and
@@ -491,9 +507,10 @@ static int32_t updateAttitudeComplementary(bool first_run, bool secondary, bool
 
 		complementary_filter_state.initialization = CF_POWERON;
 		complementary_filter_state.reset_timeval = PIOS_DELAY_GetRaw();
-		timeval = PIOS_DELAY_GetRaw();
+		attitude_samples_restart(&cf_samples, PIOS_DELAY_GetRaw());
 
 		complementary_filter_state.arming_count = 0;
+		complementary_filter_state.mag_err_z = 0;
 
 		float baro;
 		BaroAltitudeAltitudeGet(&baro);
@@ -578,60 +595,10 @@ static int32_t updateAttitudeComplementary(bool first_run, bool secondary, bool
 
 	}
 
-	GyrosGet(&gyrosData);
-	accumulate_gyro(&gyrosData);
-
-	// Compute the dT using the cpu clock
-	dT = PIOS_DELAY_DiffuS(timeval) / 1000000.0f;
-	timeval = PIOS_DELAY_GetRaw();
-
-	// This should only happen at start up or at mode switches
-	if(dT > 0.01f)
-		dT = 0.01f;
-	else if(dT <= 0.0005f)
-		dT = 0.0005f;
-
-	float grot[3];
-	float accel_err[3];
 	float *grot_filtered = complementary_filter_state.grot_filtered;
 	float *accels_filtered = complementary_filter_state.accels_filtered;
 
-	// Apply smoothing to accel values, to reduce vibration noise before main calculations.
-	apply_accel_filter(&accelsData.x,accels_filtered);
-
-	// Rotate gravity to body frame and cross with accels
-	grot[0] = -(2 * (cf_q[1] * cf_q[3] - cf_q[0] * cf_q[2]));
-	grot[1] = -(2 * (cf_q[2] * cf_q[3] + cf_q[0] * cf_q[1]));
-	grot[2] = -(cf_q[0]*cf_q[0] - cf_q[1]*cf_q[1] - cf_q[2]*cf_q[2] + cf_q[3]*cf_q[3]);
-	CrossProduct((const float *) &accelsData.x, (const float *) grot, accel_err);
-
-	// Apply same filtering to the rotated attitude to match delays
-	apply_accel_filter(grot,grot_filtered);
-
-	// Compute the error between the predicted direction of gravity and smoothed acceleration
-	CrossProduct((const float *) accels_filtered, (const float *) grot_filtered, accel_err);
-
-	float grot_mag;
-	if (complementary_filter_state.accel_filter_enabled)
-		grot_mag = sqrtf(grot_filtered[0]*grot_filtered[0] + grot_filtered[1]*grot_filtered[1] + grot_filtered[2]*grot_filtered[2]);
-	else
-		grot_mag = 1.0f;
-
-	// Account for accel magnitude
-	float accel_mag;
-	accel_mag = accels_filtered[0]*accels_filtered[0] + accels_filtered[1]*accels_filtered[1] + accels_filtered[2]*accels_filtered[2];
-	accel_mag = sqrtf(accel_mag);
-	if (grot_mag > 1.0e-3f && accel_mag > 1.0e-3f) {
-		accel_err[0] /= (accel_mag * grot_mag);
-		accel_err[1] /= (accel_mag * grot_mag);
-		accel_err[2] /= (accel_mag * grot_mag);
-	} else {
-		accel_err[0] = 0;
-		accel_err[1] = 0;
-		accel_err[2] = 0;
-	}
-
-	float mag_err[3];
+	float mag_err[3] = {0, 0, 0};
 	if (secondary || PIOS_Queue_Receive(magQueue, &ev, 0) == true)
 	{
 		MagnetometerData mag;
@@ -673,69 +640,134 @@ static int32_t updateAttitudeComplementary(bool first_run, bool secondary, bool
 				mag_err[2] = 0;
 		} else
 			mag_err[2] = 0;
-	} else {
-		mag_err[2] = 0;
+
+		// Kept until a pass has a gyro sample to fuse it with
+		complementary_filter_state.mag_err_z = mag_err[2];
 	}
 
 	// Accumulate integral of error.  Scale here so that units are (deg/s) but Ki has units of s
 	GyrosBiasData gyrosBias;
 	GyrosBiasGet(&gyrosBias);
-	gyrosBias.x -= accel_err[0] * attitudeSettings.AccelKi;
-	gyrosBias.y -= accel_err[1] * attitudeSettings.AccelKi;
-	gyrosBias.z -= mag_err[2] * attitudeSettings.MagKi;
-	GyrosBiasSet(&gyrosBias);
 
-	// Correct rates based on error, integral component dealt with in updateSensors
-	gyrosData.x += accel_err[0] * attitudeSettings.AccelKp / dT;
-	gyrosData.y += accel_err[1] * attitudeSettings.AccelKp / dT;
-	gyrosData.z += accel_err[2] * attitudeSettings.AccelKp / dT + mag_err[2] * attitudeSettings.MagKp / dT;
-
-	// Work out time derivative from INSAlgo writeup
-	// Also accounts for the fact that gyros are in deg/s
-	float qdot[4];
-	qdot[0] = (-cf_q[1] * gyrosData.x - cf_q[2] * gyrosData.y - cf_q[3] * gyrosData.z) * dT * DEG2RAD / 2;
-	qdot[1] = (cf_q[0] * gyrosData.x - cf_q[3] * gyrosData.y + cf_q[2] * gyrosData.z) * dT * DEG2RAD / 2;
-	qdot[2] = (cf_q[3] * gyrosData.x + cf_q[0] * gyrosData.y - cf_q[1] * gyrosData.z) * dT * DEG2RAD / 2;
-	qdot[3] = (-cf_q[2] * gyrosData.x + cf_q[1] * gyrosData.y + cf_q[0] * gyrosData.z) * dT * DEG2RAD / 2;
-
-	// Take a time step
-	cf_q[0] = cf_q[0] + qdot[0];
-	cf_q[1] = cf_q[1] + qdot[1];
-	cf_q[2] = cf_q[2] + qdot[2];
-	cf_q[3] = cf_q[3] + qdot[3];
-
-	if(cf_q[0] < 0) {
-		cf_q[0] = -cf_q[0];
-		cf_q[1] = -cf_q[1];
-		cf_q[2] = -cf_q[2];
-		cf_q[3] = -cf_q[3];
-	}
+	// Integrate every sample published since the last pass, each over the
+	// time since the one before it
+	struct attitude_sample sample;
+	uint32_t samples = 0;
+	while (attitude_samples_take(&cf_samples, &sample, &dT)) {
+		float *gyros = sample.gyro;
+		float *accels = sample.accel;
+
+		accumulate_gyro(gyros, &gyrosBias.x);
+
+		float grot[3];
+		float accel_err[3];
+
+		// Apply smoothing to accel values, to reduce vibration noise before main calculations.
+		apply_accel_filter(accels, accels_filtered);
+
+		// Rotate gravity to body frame and cross with accels
+		grot[0] = -(2 * (cf_q[1] * cf_q[3] - cf_q[0] * cf_q[2]));
+		grot[1] = -(2 * (cf_q[2] * cf_q[3] + cf_q[0] * cf_q[1]));
+		grot[2] = -(cf_q[0]*cf_q[0] - cf_q[1]*cf_q[1] - cf_q[2]*cf_q[2] + cf_q[3]*cf_q[3]);
+
+		// Apply same filtering to the rotated attitude to match delays
+		apply_accel_filter(grot,grot_filtered);
 
-	// Renomalize
-	float qmag;
-	qmag = sqrtf(cf_q[0]*cf_q[0] + cf_q[1]*cf_q[1] + cf_q[2]*cf_q[2] + cf_q[3]*cf_q[3]);
-	cf_q[0] = cf_q[0] / qmag;
-	cf_q[1] = cf_q[1] / qmag;
-	cf_q[2] = cf_q[2] / qmag;
-	cf_q[3] = cf_q[3] / qmag;
-
-	// If quaternion has become inappropriately short or has become Nan reinit.
-	// THIS SHOULD NEVER ACTUALLY HAPPEN
-	if((fabsf(qmag) < 1.0e-3f) || IS_NOT_FINITE(qmag)) {
-		cf_q[0] = 1;
-		cf_q[1] = 0;
-		cf_q[2] = 0;
-		cf_q[3] = 0;
+		// Compute the error between the predicted direction of gravity and smoothed acceleration
+		CrossProduct((const float *) accels_filtered, (const float *) grot_filtered, accel_err);
+
+		float grot_mag;
+		if (complementary_filter_state.accel_filter_enabled)
+			grot_mag = sqrtf(grot_filtered[0]*grot_filtered[0] + grot_filtered[1]*grot_filtered[1] + grot_filtered[2]*grot_filtered[2]);
+		else
+			grot_mag = 1.0f;
+
+		// Account for accel magnitude
+		float accel_mag;
+		accel_mag = accels_filtered[0]*accels_filtered[0] + accels_filtered[1]*accels_filtered[1] + accels_filtered[2]*accels_filtered[2];
+		accel_mag = sqrtf(accel_mag);
+		if (grot_mag > 1.0e-3f && accel_mag > 1.0e-3f) {
+			accel_err[0] /= (accel_mag * grot_mag);
+			accel_err[1] /= (accel_mag * grot_mag);
+			accel_err[2] /= (accel_mag * grot_mag);
+		} else {
+			accel_err[0] = 0;
+			accel_err[1] = 0;
+			accel_err[2] = 0;
+		}
+
+		gyrosBias.x -= accel_err[0] * attitudeSettings.AccelKi;
+		gyrosBias.y -= accel_err[1] * attitudeSettings.AccelKi;
+		gyrosBias.z -= complementary_filter_state.mag_err_z * attitudeSettings.MagKi;
+
+		// Correct rates based on error, integral component dealt with in updateSensors
+		gyros[0] += accel_err[0] * attitudeSettings.AccelKp / dT;
+		gyros[1] += accel_err[1] * attitudeSettings.AccelKp / dT;
+		gyros[2] += accel_err[2] * attitudeSettings.AccelKp / dT +
+			complementary_filter_state.mag_err_z * attitudeSettings.MagKp / dT;
+
+		// The magnetometer reading is only fused with the first sample
+		complementary_filter_state.mag_err_z = 0;
+
+		// Work out time derivative from INSAlgo writeup
+		// Also accounts for the fact that gyros are in deg/s
+		float qdot[4];
+		qdot[0] = (-cf_q[1] * gyros[0] - cf_q[2] * gyros[1] - cf_q[3] * gyros[2]) * dT * DEG2RAD / 2;
+		qdot[1] = (cf_q[0] * gyros[0] - cf_q[3] * gyros[1] + cf_q[2] * gyros[2]) * dT * DEG2RAD / 2;
+		qdot[2] = (cf_q[3] * gyros[0] + cf_q[0] * gyros[1] - cf_q[1] * gyros[2]) * dT * DEG2RAD / 2;
+		qdot[3] = (-cf_q[2] * gyros[0] + cf_q[1] * gyros[1] + cf_q[0] * gyros[2]) * dT * DEG2RAD / 2;
+
+		// Take a time step
+		cf_q[0] = cf_q[0] + qdot[0];
+		cf_q[1] = cf_q[1] + qdot[1];
+		cf_q[2] = cf_q[2] + qdot[2];
+		cf_q[3] = cf_q[3] + qdot[3];
+
+		if(cf_q[0] < 0) {
+			cf_q[0] = -cf_q[0];
+			cf_q[1] = -cf_q[1];
+			cf_q[2] = -cf_q[2];
+			cf_q[3] = -cf_q[3];
+		}
+
+		// Renomalize
+		float qmag;
+		qmag = sqrtf(cf_q[0]*cf_q[0] + cf_q[1]*cf_q[1] + cf_q[2]*cf_q[2] + cf_q[3]*cf_q[3]);
+		cf_q[0] = cf_q[0] / qmag;
+		cf_q[1] = cf_q[1] / qmag;
+		cf_q[2] = cf_q[2] / qmag;
+		cf_q[3] = cf_q[3] / qmag;
+
+		// If quaternion has become inappropriately short or has become Nan reinit.
+		// THIS SHOULD NEVER ACTUALLY HAPPEN
+		if((fabsf(qmag) < 1.0e-3f) || IS_NOT_FINITE(qmag)) {
+			cf_q[0] = 1;
+			cf_q[1] = 0;
+			cf_q[2] = 0;
+			cf_q[3] = 0;
+		}
+
+		// When this is the only filter compute the vertical state from baro data
+		if (!secondary) {
+			float accel_ned[3];
+			rotate_ned_accel(cf_q, accels, accel_ned);
+			cfvert_predict_pos(&cfvert, accel_ned[2], dT);
+		}
+
+		samples++;
 	}
 
+	if (samples == 0)
+		return 0;
+
+	GyrosBiasSet(&gyrosBias);
+
 	if (!secondary) {
 
-		// Calculate the NED acceleration and get the z-component
-		float z_accel = calc_ned_accel(cf_q, &accelsData.x);
+		// Publish the NED acceleration for the altitude controller
+		calc_ned_accel(cf_q, &accelsData.x);
 
-		// When this is the only filter compute th vertical state from baro data
 		// Reset the filter for barometric data
-		cfvert_predict_pos(&cfvert, z_accel, dT);
 		if (PIOS_Queue_Receive(baroQueue, &ev, 0) == true) {
 			float baro;
 			BaroAltitudeAltitudeGet(&baro);
@@ -743,6 +775,7 @@ static int32_t updateAttitudeComplementary(bool first_run, bool secondary, bool
 		}
 
 	}
+
 	if (!secondary && !raw_gps) {
 		// When in raw GPS mode, it will set the error to none if
 		// reception is good
@@ -752,6 +785,16 @@ static int32_t updateAttitudeComplementary(bool first_run, bool secondary, bool
 	return 0;
 }
 
+//! Rotate the accels into the NED frame and remove the influence of gravity
+static void rotate_ned_accel(float *q, const float *accels, float *accel_ned)
+{
+	float Rbe[3][3];
+
+	Quaternion2R(q, Rbe);
+	rot_mult(Rbe, accels, accel_ned, true);
+	accel_ned[2] += GRAVITY;
+}
+
 /**
  * Calculate the acceleration in the NED frame. This is used
  * by the altitude controller. Returns the down component for
@@ -760,13 +803,7 @@ static int32_t updateAttitudeComplementary(bool first_run, bool secondary, bool
 static float calc_ned_accel(float *q, float *accels)
 {
 	float accel_ned[3];
-	float Rbe[3][3];
-
-	// rotate the accels into the NED frame and remove
-	// the influence of gravity
-	Quaternion2R(q, Rbe);
-	rot_mult(Rbe, accels, accel_ned, true);
-	accel_ned[2] += GRAVITY;
+	rotate_ned_accel(q, accels, accel_ned);
 
 	NedAccelData nedAccel;
 	nedAccel.North = accel_ned[0];
@@ -939,9 +976,10 @@ static void accumulate_gyro_zero()
 /**
  * Accumulate a set of gyro samples for computing the
  * bias
- * @param [in] gyrosData The samples of data to accumulate
+ * @param [in] gyros The sample to accumulate, in deg/s
+ * @param [in] bias The bias the sensors module removed from it
  */
-static void accumulate_gyro(GyrosData *gyrosData)
+static void accumulate_gyro(const float *gyros, const float *bias)
 {
 	if (!complementary_filter_state.accumulating_gyro)
 		return;
@@ -951,16 +989,13 @@ static void accumulate_gyro(GyrosData *gyrosData)
 	// bias_correct_gyro
 	if (true) {
 		// Apply bias correction to the gyros from the state estimator
-		GyrosBiasData gyrosBias;
-		GyrosBiasGet(&gyrosBias);
-
-		complementary_filter_state.accumulated_gyro[0] += gyrosData->x + gyrosBias.x;
-		complementary_filter_state.accumulated_gyro[1] += gyrosData->y + gyrosBias.y;
-		complementary_filter_state.accumulated_gyro[2] += gyrosData->z + gyrosBias.z;
+		complementary_filter_state.accumulated_gyro[0] += gyros[0] + bias[0];
+		complementary_filter_state.accumulated_gyro[1] += gyros[1] + bias[1];
+		complementary_filter_state.accumulated_gyro[2] += gyros[2] + bias[2];
 	} else {
-		complementary_filter_state.accumulated_gyro[0] += gyrosData->x;
-		complementary_filter_state.accumulated_gyro[1] += gyrosData->y;
-		complementary_filter_state.accumulated_gyro[2] += gyrosData->z;
+		complementary_filter_state.accumulated_gyro[0] += gyros[0];
+		complementary_filter_state.accumulated_gyro[1] += gyros[1];
+		complementary_filter_state.accumulated_gyro[2] += gyros[2];
 	}
 }
 
@@ -976,7 +1011,6 @@ static bool home_location_updated;
 static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 {
 	UAVObjEvent ev;
-	GyrosData gyrosData;
 	AccelsData accelsData;
 	MagnetometerData magData;
 	GPSVelocityData gpsVelData;
@@ -990,10 +1024,11 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 	static bool baro_updated;
 	static bool gps_updated;
 	static bool gps_vel_updated;
+	static uint32_t gps_pos_rx_time;
+	static uint32_t gps_vel_rx_time;
 
 	static float baro_offset = 0;
 
-	static uint32_t ins_last_time = 0;
 	static uint32_t ins_init_time = 0;
 
 	static enum {INS_INIT, INS_WARMUP, INS_RUNNING} ins_state;
@@ -1018,15 +1053,23 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 
 		home_location_updated = false;
 
-		ins_last_time = PIOS_DELAY_GetRaw();
+		attitude_samples_restart(&ins_samples, PIOS_DELAY_GetRaw());
 
 		return 0;
 	}
 
 	mag_updated = mag_updated || PIOS_Queue_Receive(magQueue, &ev, 0);
 	baro_updated = baro_updated || PIOS_Queue_Receive(baroQueue, &ev, 0);
-	gps_updated = gps_updated || (PIOS_Queue_Receive(gpsQueue, &ev, 0) && outdoor_mode);
-	gps_vel_updated = gps_vel_updated || (PIOS_Queue_Receive(gpsVelQueue, &ev, 0) && outdoor_mode);
+
+	// Timestamp GPS data as it arrives, so its age is known when it is fused
+	if (!gps_updated && PIOS_Queue_Receive(gpsQueue, &ev, 0) && outdoor_mode) {
+		gps_updated = true;
+		gps_pos_rx_time = PIOS_DELAY_GetRaw();
+	}
+	if (!gps_vel_updated && PIOS_Queue_Receive(gpsVelQueue, &ev, 0) && outdoor_mode) {
+		gps_vel_updated = true;
+		gps_vel_rx_time = PIOS_DELAY_GetRaw();
+	}
 
 	// Wait until the gyro and accel object is updated, if a timeout then go to failsafe
 	if (PIOS_Queue_Receive(gyroQueue, &ev, FAILSAFE_TIMEOUT_MS) != true ||
@@ -1036,7 +1079,6 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 	}
 
 	// Get most recent data
-	GyrosGet(&gyrosData);
 	AccelsGet(&accelsData);
 	GyrosBiasGet(&gyrosBias);
 
@@ -1154,8 +1196,8 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 		// state to make sure filter converges
 		ins_state = INS_WARMUP;
 
-		ins_last_time = PIOS_DELAY_GetRaw();	
-		ins_init_time = ins_last_time;
+		ins_init_time = PIOS_DELAY_GetRaw();
+		attitude_samples_restart(&ins_samples, ins_init_time);
 
 		return 0;
 	} else if (ins_state == INS_INIT)
@@ -1174,15 +1216,6 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 	// Have a minimum requirement for gps usage a little more liberal than during initialization
 	gps_updated &= (gpsData.Satellites >= 6) && (gpsData.PDOP <= 4.0f) && (homeLocation.Set == HOMELOCATION_SET_TRUE);
 
-	dT = PIOS_DELAY_DiffuS(ins_last_time) / 1.0e6f;
-	ins_last_time = PIOS_DELAY_GetRaw();
-
-	// This should only happen at start up or at mode switches
-	if(dT > 0.01f)
-		dT = 0.01f;
-	else if(dT <= 0.0005f)
-		dT = 0.0005f;
-
 	// When the sensor settings are updated, reset the biases. Also
 	// while warming up, lock these at zero.
 	if (gyroBiasSettingsUpdated || ins_state == INS_WARMUP) {
@@ -1191,25 +1224,34 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 		INSSetAccelBias(zeros);
 	}
 
-	// Because the sensor module remove the bias we need to add it
-	// back in here so that the INS algorithm can track it correctly
-	// this effectively means the INS is observing the "raw" data.
-	float gyros[3];
-	if (attitudeSettings.BiasCorrectGyro == ATTITUDESETTINGS_BIASCORRECTGYRO_TRUE) {
-		gyros[0] = (gyrosData.x + gyrosBias.x) * DEG2RAD;
-		gyros[1] = (gyrosData.y + gyrosBias.y) * DEG2RAD;
-		gyros[2] = (gyrosData.z + gyrosBias.z) * DEG2RAD;
-	} else {
-		gyros[0] = gyrosData.x * DEG2RAD;
-		gyros[1] = gyrosData.y * DEG2RAD;
-		gyros[2] = gyrosData.z * DEG2RAD;
-	}
+	// Advance the state estimate with every sample published since the
+	// last pass, each over the time since the one before it
+	struct attitude_sample sample;
+	float dT_total = 0;
+	while (attitude_samples_take(&ins_samples, &sample, &dT)) {
+		// Because the sensor module remove the bias we need to add it
+		// back in here so that the INS algorithm can track it correctly
+		// this effectively means the INS is observing the "raw" data.
+		float gyros[3];
+		if (attitudeSettings.BiasCorrectGyro == ATTITUDESETTINGS_BIASCORRECTGYRO_TRUE) {
+			gyros[0] = (sample.gyro[0] + gyrosBias.x) * DEG2RAD;
+			gyros[1] = (sample.gyro[1] + gyrosBias.y) * DEG2RAD;
+			gyros[2] = (sample.gyro[2] + gyrosBias.z) * DEG2RAD;
+		} else {
+			gyros[0] = sample.gyro[0] * DEG2RAD;
+			gyros[1] = sample.gyro[1] * DEG2RAD;
+			gyros[2] = sample.gyro[2] * DEG2RAD;
+		}
 
-	// Advance the state estimate
-	INSStatePrediction(gyros, &accelsData.x, dT);
+		INSStatePrediction(gyros, sample.accel, dT);
+		dT_total += dT;
+	}
 
-	// Advance the covariance estimate
-	INSCovariancePrediction(dT);
+	// Advance the covariance estimate.  It changes slowly next to the
+	// state and is most of the cost of a prediction, so it takes one
+	// step over all the samples.
+	if (dT_total > 0)
+		INSCovariancePrediction(dT_total);
 
 	if(mag_updated) {
 		sensors |= MAG_SENSORS;
@@ -1286,6 +1328,16 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 		NED[2] = -(baroData.Altitude + baro_offset);
 	}
 
+	// The GPS solution describes where the vehicle was when it was measured,
+	// which is the receiver latency before it arrived here
+	if (outdoor_mode) {
+		float latency = insSettings.GpsLatency / 1000.0f;
+		INSSetPosVelAge(latency + PIOS_DELAY_DiffuS(gps_pos_rx_time) / 1.0e6f,
+				latency + PIOS_DELAY_DiffuS(gps_vel_rx_time) / 1.0e6f);
+	} else {
+		INSSetPosVelAge(0, 0);
+	}
+
 	/*
 	 * TODO: Need to add a general sanity check for all the inputs to make sure their kosher
 	 * although probably should occur within INS itself
@@ -1472,6 +1524,27 @@ static void check_home_location()
 	}
 }
 
+/**
+ * Queue each gyro sample, with the accels the sensors task published
+ * just before it, for the estimators to integrate.  This runs in the
+ * sensors task whenever it sets @ref Gyros.
+ */
+static void gyrosUpdatedCb(UAVObjEvent * ev, void *ctx, void *obj, int len)
+{
+	(void) ev; (void) ctx;
+
+	GyrosData *gyros = obj;
+
+	PIOS_Assert(len == sizeof(*gyros));
+
+	AccelsData accels;
+	AccelsGet(&accels);
+
+	uint32_t now = PIOS_DELAY_GetRaw();
+	attitude_samples_push(&cf_samples, now, &gyros->x, &accels.x);
+	attitude_samples_push(&ins_samples, now, &gyros->x, &accels.x);
+}
+
 static void settingsUpdatedCb(UAVObjEvent * ev, void *ctx, void *obj, int len)
 {
 	(void) ctx; (void) obj; (void) len;
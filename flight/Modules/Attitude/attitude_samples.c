@@ -0,0 +1,100 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules TauLabs Modules
+ * @{
+ * @addtogroup AttitudeModule Attitude and state estimation module
+ * @{
+ *
+ * @file       attitude_samples.c
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @brief      Queues the gyro and accel samples for the attitude estimators
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#include "pios.h"
+#include "attitude_samples.h"
+
+int32_t attitude_samples_init(struct attitude_samples *s, uint16_t depth)
+{
+	// The queue holds one element less than it is made with
+	s->queue = circ_queue_new(sizeof(struct attitude_sample), depth + 1);
+	if (!s->queue)
+		return -1;
+
+	s->last_raw = 0;
+	s->spilled = 0;
+
+	return 0;
+}
+
+void attitude_samples_push(struct attitude_samples *s, uint32_t raw_time,
+		const float gyro[3], const float accel[3])
+{
+	uint16_t avail;
+	struct attitude_sample *sample = circ_queue_write_pos(s->queue, NULL, &avail);
+
+	if (avail == 0) {
+		s->spilled++;
+		return;
+	}
+
+	sample->raw_time = raw_time;
+	for (int i = 0; i < 3; i++) {
+		sample->gyro[i] = gyro[i];
+		sample->accel[i] = accel[i];
+	}
+
+	circ_queue_advance_write(s->queue);
+}
+
+bool attitude_samples_take(struct attitude_samples *s,
+		struct attitude_sample *sample, float *dt)
+{
+	struct attitude_sample *queued = circ_queue_read_pos(s->queue, NULL, NULL);
+
+	if (!queued)
+		return false;
+
+	*sample = *queued;
+	circ_queue_read_completed(s->queue);
+
+	// Samples lost to a full queue leave a gap, which the next one spans
+	*dt = PIOS_DELAY_DiffuS2(s->last_raw, sample->raw_time) * 1.0e-6f;
+	s->last_raw = sample->raw_time;
+
+	if (*dt > ATTITUDE_SAMPLES_MAX_DT)
+		*dt = ATTITUDE_SAMPLES_MAX_DT;
+	else if (*dt < ATTITUDE_SAMPLES_MIN_DT)
+		*dt = ATTITUDE_SAMPLES_MIN_DT;
+
+	return true;
+}
+
+void attitude_samples_restart(struct attitude_samples *s, uint32_t raw_time)
+{
+	circ_queue_clear(s->queue);
+	s->last_raw = raw_time;
+}
+
+/**
+ * @}
+ * @}
+ */
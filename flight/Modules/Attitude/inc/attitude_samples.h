@@ -0,0 +1,92 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules TauLabs Modules
+ * @{
+ * @addtogroup AttitudeModule Attitude and state estimation module
+ * @{
+ *
+ * @file       attitude_samples.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @brief      Queues the gyro and accel samples for the attitude estimators
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#ifndef ATTITUDE_SAMPLES_H
+#define ATTITUDE_SAMPLES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "circqueue.h"
+
+//! Shortest time a sample is integrated over, below the period of a
+//! jittery 8 kHz gyro but keeping clear of dividing by zero
+#define ATTITUDE_SAMPLES_MIN_DT 0.00005f
+
+//! Longest time a sample is integrated over, e.g. after a mode switch
+#define ATTITUDE_SAMPLES_MAX_DT 0.01f
+
+/**
+ * The gyros, and the accels measured with them, as published by the
+ * sensors task.  The UAVOs only hold the latest values, so the samples are
+ * queued by value as they are published and the estimators integrate all
+ * of them when they run, each over its own time step.
+ */
+struct attitude_sample {
+	uint32_t raw_time;	/**< When it was published, PIOS_DELAY raw time */
+	float gyro[3];		/**< deg/s */
+	float accel[3];		/**< m/s^2 */
+};
+
+struct attitude_samples {
+	circ_queue_t queue;
+	uint32_t last_raw;	/**< When the last sample taken was published */
+	volatile uint32_t spilled;	/**< Samples lost to a full queue */
+};
+
+int32_t attitude_samples_init(struct attitude_samples *s, uint16_t depth);
+
+/**
+ * Queue a sample.  Only the sensors task calls this, and only the task
+ * of the estimator takes samples, so it needs no locking.
+ * @param[in] raw_time When it was measured, from PIOS_DELAY_GetRaw()
+ */
+void attitude_samples_push(struct attitude_samples *s, uint32_t raw_time,
+		const float gyro[3], const float accel[3]);
+
+/**
+ * Take the oldest queued sample.
+ * @param[out] sample The sample
+ * @param[out] dt The time since the sample before it, in seconds
+ * @return false when none is queued
+ */
+bool attitude_samples_take(struct attitude_samples *s,
+		struct attitude_sample *sample, float *dt);
+
+//! Drop the queued samples, and time the next one from now
+void attitude_samples_restart(struct attitude_samples *s, uint32_t raw_time);
+
+#endif /* ATTITUDE_SAMPLES_H */
+
+/**
+ * @}
+ * @}
+ */
@@ -92,12 +92,14 @@ static void panel_draw(charosd_state_t state, uint8_t panel, uint8_t x, uint8_t
 
 static void screen_draw(charosd_state_t state, CharOnScreenDisplaySettingsData *page)
 {
-	PIOS_MAX7456_clear (state->dev);
+	PIOS_MAX7456_begin_frame (state->dev);
 
 	for (uint8_t i = 0; i < CHARONSCREENDISPLAYSETTINGS_PANELTYPE_NUMELEM;
 		       i++) {
 		panel_draw(state, page->PanelType[i], page->X[i], page->Y[i]);
 	}
+
+	PIOS_MAX7456_end_frame (state->dev);
 }
 
 static const uint8_t charosd_font_data[] = {
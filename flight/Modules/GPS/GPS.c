@@ -70,6 +70,7 @@ static void updateSettings();
 
 #define GPS_TIMEOUT_MS                  750
 #define GPS_COM_TIMEOUT_MS              100
+#define GPS_READ_BUFFER                 32
 
 
 #if defined(PIOS_GPS_MINIMAL)
@@ -90,6 +91,9 @@ static struct pios_thread *gpsTaskHandle;
 
 static char* gps_rx_buffer;
 
+// COM reads are handed to the parsers a block at a time
+static uint8_t gps_com_buffer[GPS_READ_BUFFER];
+
 static struct GPS_RX_STATS gpsRxStats;
 
 // ****************
@@ -274,21 +278,21 @@ static void gpsTask(void *parameters)
 			continue;
 		}
 
-		uint8_t c;
+		uint16_t received;
 
 		// This blocks the task until there is something on the buffer
-		while (PIOS_COM_ReceiveBuffer(gpsPort, &c, 1, xDelay) > 0)
+		while ((received = PIOS_COM_ReceiveBuffer(gpsPort, gps_com_buffer, sizeof(gps_com_buffer), xDelay)) > 0)
 		{
 			int res;
 			switch (gpsProtocol) {
 #if defined(PIOS_INCLUDE_GPS_NMEA_PARSER)
 				case MODULESETTINGS_GPSDATAPROTOCOL_NMEA:
-					res = parse_nmea_stream (c,gps_rx_buffer, &gpsposition, &gpsRxStats);
+					res = parse_nmea_buffer (gps_com_buffer, received, gps_rx_buffer, &gpsposition, &gpsRxStats);
 					break;
 #endif
 #if defined(PIOS_INCLUDE_GPS_UBX_PARSER)
 				case MODULESETTINGS_GPSDATAPROTOCOL_UBX:
-					res = parse_ubx_stream (c,gps_rx_buffer, &gpsposition, &gpsRxStats);
+					res = parse_ubx_buffer (gps_com_buffer, received, gps_rx_buffer, &gpsposition, &gpsRxStats);
 					break;
 #endif
 				default:
@@ -107,86 +107,105 @@ const static struct nmea_parser nmea_parsers[] = {
 #endif //PIOS_GPS_MINIMAL
 };
 
+// Sentence framing state, kept between calls as sentences span COM reads
+static uint8_t rx_count = 0;
+static bool start_flag = false;
+
 int parse_nmea_stream (uint8_t c, char *gps_rx_buffer, GPSPositionData *GpsData, struct GPS_RX_STATS *gpsRxStats)
 {
-	static uint8_t rx_count = 0;
-	static bool start_flag = false;
-	static bool found_cr = false;
+	return parse_nmea_buffer(&c, 1, gps_rx_buffer, GpsData, gpsRxStats);
+}
 
-	// detect start while acquiring stream
-	if (!start_flag && (c == '$')) // NMEA identifier found
-	{
-		start_flag = true;
-		found_cr = false;
-		rx_count = 0;
-	}
-	else
-	if (!start_flag)
-		return PARSER_ERROR;
+/**
+ * Parse a block of received bytes, such as a whole COM read, for NMEA
+ * sentences. The start and end of each sentence are found with memchr and
+ * the sentence is copied to the buffer in one piece.
+ * \param[in] rx received bytes
+ * \param[in] len number of received bytes
+ * \return PARSER_COMPLETE if at least one sentence passed its checksum and was processed
+ * \return PARSER_OVERRUN if a sentence overflowed the buffer
+ * \return PARSER_INCOMPLETE if the block ended part way through a sentence
+ * \return PARSER_ERROR if none of the bytes could be used
+ */
+int parse_nmea_buffer (const uint8_t *rx, uint16_t len, char *gps_rx_buffer, GPSPositionData *GpsData, struct GPS_RX_STATS *gpsRxStats)
+{
+	bool completed = false;
+	bool overrun = false;
+	uint16_t i = 0;
+
+	while (i < len) {
+		// detect start while acquiring stream
+		if (!start_flag) {
+			const uint8_t *start = memchr(&rx[i], '$', len - i);
+			if (start == NULL)
+				break;
 
-	if (rx_count >= NMEA_MAX_PACKET_LENGTH)
-	{
-		// The buffer is already full and we haven't found a valid NMEA sentence.
-		// Flush the buffer and note the overflow event.
-		gpsRxStats->gpsRxOverflow++;
-		start_flag = false;
-		found_cr = false;
-		rx_count = 0;
-		return PARSER_OVERRUN;
-	}
-	else
-	{
-		gps_rx_buffer[rx_count] = c;
-		rx_count++;
-	}
+			// NMEA identifier found
+			i = start - rx;
+			start_flag = true;
+			rx_count = 0;
+		}
+
+		// Take everything up to and including the next linefeed
+		const uint8_t *lf = memchr(&rx[i], '\n', len - i);
+		uint16_t n = (lf != NULL) ? (lf - &rx[i] + 1) : (len - i);
+
+		if (n > NMEA_MAX_PACKET_LENGTH - rx_count) {
+			// The buffer fills before we find the end of the sentence.
+			// Drop it, along with the byte that would have overflowed,
+			// and note the overflow event.
+			gpsRxStats->gpsRxOverflow++;
+			start_flag = false;
+			i += NMEA_MAX_PACKET_LENGTH - rx_count + 1;
+			overrun = true;
+			continue;
+		}
+
+		memcpy(&gps_rx_buffer[rx_count], &rx[i], n);
+		rx_count += n;
+		i += n;
+
+		// look for ending '\r\n' sequence
+		if (lf == NULL || rx_count < 2 || gps_rx_buffer[rx_count-2] != '\r')
+			continue;
 
-	// look for ending '\r\n' sequence
-	if (!found_cr && (c == '\r') )
-		found_cr = true;
-	else
-	if (found_cr && (c != '\n') )
-		found_cr = false;  // false end flag
-	else
-	if (found_cr && (c == '\n') )
-	{
 		// The NMEA functions require a zero-terminated string
 		// As we detected \r\n, the string as for sure 2 bytes long, we will also strip the \r\n
 		gps_rx_buffer[rx_count-2] = 0;
 
 		// prepare to parse next sentence
 		start_flag = false;
-		found_cr = false;
 		rx_count = 0;
 		// Our rxBuffer must look like this now:
 		//   [0]           = '$'
 		//   ...           = zero or more bytes of sentence payload
-		//   [end_pos - 1] = '\r'
-		//   [end_pos]     = '\n'
 		//
 		// Prepare to consume the sentence from the buffer
 
 		// Validate the checksum over the sentence
 		if (!NMEA_checksum(&gps_rx_buffer[1]))
 		{	// Invalid checksum.  May indicate dropped characters on Rx.
-			//PIOS_DEBUG_PinHigh(2);
 			gpsRxStats->gpsRxChkSumError++;
-			//PIOS_DEBUG_PinLow(2);
-			return PARSER_ERROR;
 		}
 		else
 		{	// Valid checksum, use this packet to update the GPS position
-			if (!NMEA_update_position(&gps_rx_buffer[1], GpsData)) {
-				//PIOS_DEBUG_PinHigh(2);
+			if (!NMEA_update_position(&gps_rx_buffer[1], GpsData))
 				gpsRxStats->gpsRxParserError++;
-				//PIOS_DEBUG_PinLow(2);
-			}
 			else
-				gpsRxStats->gpsRxReceived++;;
+				gpsRxStats->gpsRxReceived++;
 
-			return PARSER_COMPLETE;
+			completed = true;
 		}
 	}
-	return PARSER_INCOMPLETE;
+
+	if (completed)
+		return PARSER_COMPLETE;
+	else if (overrun)
+		return PARSER_OVERRUN;
+	else if (start_flag)
+		return PARSER_INCOMPLETE;
+
+	return PARSER_ERROR;
 }
 
 const static struct nmea_parser *NMEA_find_parser_by_prefix(const char *prefix)
@@ -267,7 +286,7 @@ static bool NMEA_parse_real(int32_t * whole, uint32_t * fract, uint8_t * fract_u
 
 	*whole = strtol(field_w, NULL, 10);
 
-	if (field_w) {
+	if (field_f) {
 		/* decimal was found so we may have a fractional part */
 		*fract = strtoul(field_f, NULL, 10);
 		*fract_units = strlen(field_f);
@@ -42,94 +42,121 @@ static uint32_t parse_errors;
 static bool checksum_ubx_message(const struct UBXPacket *);
 static uint32_t parse_ubx_message(const struct UBXPacket *, GPSPositionData *);
 
+// UBX framing state, kept between calls as messages span COM reads
+static enum proto_states {
+	START,
+	UBX_SY2,
+	UBX_CLASS,
+	UBX_ID,
+	UBX_LEN1,
+	UBX_LEN2,
+	UBX_PAYLOAD,
+	UBX_CHK1,
+	UBX_CHK2,
+} proto_state = START;
+
+static uint16_t rx_count = 0;
+
 // parse incoming character stream for messages in UBX binary format
 
 int parse_ubx_stream (uint8_t c, char *gps_rx_buffer, GPSPositionData *GpsData, struct GPS_RX_STATS *gpsRxStats)
 {
-	enum proto_states {
-		START,
-		UBX_SY2,
-		UBX_CLASS,
-		UBX_ID,
-		UBX_LEN1,
-		UBX_LEN2,
-		UBX_PAYLOAD,
-		UBX_CHK1,
-		UBX_CHK2,
-		FINISHED
-	};
-
-	static enum proto_states proto_state = START;
-	static uint16_t rx_count = 0;
-	struct UBXPacket *ubx = (struct UBXPacket *)gps_rx_buffer;
+	return parse_ubx_buffer(&c, 1, gps_rx_buffer, GpsData, gpsRxStats);
+}
 
-	switch (proto_state) {
-		case START: // detect protocol
-			if (c ==  UBX_SYNC1) // first UBX sync char found
-				proto_state = UBX_SY2;
-			break;
-		case UBX_SY2:
-			if (c == UBX_SYNC2) // second UBX sync char found
-				proto_state = UBX_CLASS;
-			else
-				proto_state = START; // reset state
-			break;
-		case UBX_CLASS:
-			ubx->header.class = c;
-			proto_state = UBX_ID;
-			break;
-		case UBX_ID:
-			ubx->header.id = c;
-			proto_state = UBX_LEN1;
-			break;
-		case UBX_LEN1:
-			ubx->header.len = c;
-			proto_state = UBX_LEN2;
-			break;
-		case UBX_LEN2:
-			ubx->header.len += (c << 8);
-			if (ubx->header.len > sizeof(UBXPayload)) {
-				gpsRxStats->gpsRxOverflow++;
-				proto_state = START;
-			} else {
-				rx_count = 0;
-				proto_state = UBX_PAYLOAD;
+/**
+ * Parse a block of received bytes, such as a whole COM read, for messages
+ * in UBX binary format. Sync bytes are found with memchr and payloads are
+ * copied in one piece; the checksum is computed over the complete message.
+ * \param[in] rx received bytes
+ * \param[in] len number of received bytes
+ * \return PARSER_COMPLETE if at least one message was completed and processed
+ * \return PARSER_INCOMPLETE if the block ended part way through a message
+ * \return PARSER_ERROR if none of the bytes could be used
+ */
+int parse_ubx_buffer (const uint8_t *rx, uint16_t len, char *gps_rx_buffer, GPSPositionData *GpsData, struct GPS_RX_STATS *gpsRxStats)
+{
+	struct UBXPacket *ubx = (struct UBXPacket *)gps_rx_buffer;
+	bool completed = false;
+	uint16_t i = 0;
+
+	while (i < len) {
+		switch (proto_state) {
+			case START: // detect protocol
+			{
+				const uint8_t *sync = memchr(&rx[i], UBX_SYNC1, len - i);
+				if (sync == NULL) {
+					i = len;
+				} else {
+					i = sync - rx + 1; // first UBX sync char found
+					proto_state = UBX_SY2;
+				}
+				break;
 			}
-			break;
-		case UBX_PAYLOAD:
-			if (rx_count < ubx->header.len) {
-				ubx->payload.payload[rx_count] = c;
-				if (++rx_count == ubx->header.len)
+			case UBX_SY2:
+				if (rx[i++] == UBX_SYNC2) // second UBX sync char found
+					proto_state = UBX_CLASS;
+				else
+					proto_state = START; // reset state
+				break;
+			case UBX_CLASS:
+				ubx->header.class = rx[i++];
+				proto_state = UBX_ID;
+				break;
+			case UBX_ID:
+				ubx->header.id = rx[i++];
+				proto_state = UBX_LEN1;
+				break;
+			case UBX_LEN1:
+				ubx->header.len = rx[i++];
+				proto_state = UBX_LEN2;
+				break;
+			case UBX_LEN2:
+				ubx->header.len += (rx[i++] << 8);
+				if (ubx->header.len > sizeof(UBXPayload)) {
+					gpsRxStats->gpsRxOverflow++;
+					proto_state = START;
+				} else {
+					rx_count = 0;
+					proto_state = (ubx->header.len > 0) ? UBX_PAYLOAD : UBX_CHK1;
+				}
+				break;
+			case UBX_PAYLOAD:
+			{
+				uint16_t n = ubx->header.len - rx_count;
+				if (n > len - i)
+					n = len - i;
+
+				memcpy(&ubx->payload.payload[rx_count], &rx[i], n);
+				rx_count += n;
+				i += n;
+
+				if (rx_count == ubx->header.len)
 					proto_state = UBX_CHK1;
-			} else {
-				gpsRxStats->gpsRxOverflow++;
-				proto_state = START;
+				break;
 			}
-			break;
-		case UBX_CHK1:
-			ubx->header.ck_a = c;
-			proto_state = UBX_CHK2;
-			break;
-		case UBX_CHK2:
-			ubx->header.ck_b = c;
-			if (checksum_ubx_message(ubx)) { // message complete and valid
-				parse_ubx_message(ubx, GpsData);
-				proto_state = FINISHED;
-			} else {
-				gpsRxStats->gpsRxChkSumError++;
+			case UBX_CHK1:
+				ubx->header.ck_a = rx[i++];
+				proto_state = UBX_CHK2;
+				break;
+			case UBX_CHK2:
+				ubx->header.ck_b = rx[i++];
+				if (checksum_ubx_message(ubx)) { // message complete and valid
+					parse_ubx_message(ubx, GpsData);
+					gpsRxStats->gpsRxReceived++;
+					completed = true;
+				} else {
+					gpsRxStats->gpsRxChkSumError++;
+				}
 				proto_state = START;
-			}
-			break;
-		default: break;
+				break;
+		}
 	}
 
-	if (proto_state == START)
-		return PARSER_ERROR;	// parser couldn't use this byte
-	else if (proto_state == FINISHED) {
-		gpsRxStats->gpsRxReceived++;
-		proto_state = START;
+	if (completed)
 		return PARSER_COMPLETE;	// message complete & processed
-	}
+	else if (proto_state == START)
+		return PARSER_ERROR;	// parser couldn't use these bytes
 
 	return PARSER_INCOMPLETE; // message not (yet) complete
 }
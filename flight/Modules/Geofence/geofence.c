@@ -7,9 +7,12 @@
  *
  * @file       geofence.c
  * @author     Tau Labs, http://taulabs.org, Copyright (C) 2012-2014
- * @author     dRonin, http://dronin.org Copyright (C) 2015
+ * @author     dRonin, http://dronin.org Copyright (C) 2015-2016
  * @brief      Check the UAV is within the geofence boundaries
  *
+ * Both the radius in @ref GeoFenceSettings and the polygons in
+ * @ref GeoFencePolygons are checked, and the worse of the two is alarmed.
+ *
  * @see        The GNU Public License (GPL) Version 3
  *
  *****************************************************************************/
@@ -34,7 +37,10 @@
 #include "misc_math.h"
 #include "physical_constants.h"
 
+#include "geofence_polygon.h"
+
 #include "geofencesettings.h"
+#include "geofencepolygons.h"
 #include "positionactual.h"
 #include "modulesettings.h"
 
@@ -46,14 +52,28 @@
 
 // Private types
 
+//! What a rebuild works from, too large for the callback stacks
+struct polygon_scratch {
+	GeoFencePolygonsData polygons;
+	float north[GEOFENCEPOLYGONS_NORTH_NUMELEM];
+	float east[GEOFENCEPOLYGONS_EAST_NUMELEM];
+	struct geofence_polygon list[GEOFENCEPOLYGONS_TYPE_NUMELEM];
+};
+
 // Private variables
 
 // Private functions
 static void settingsUpdated(UAVObjEvent* ev, void *ctx, void *obj, int len);
 static void checkPosition(UAVObjEvent* ev, void *ctx, void *obj, int len);
+static void polygonsUpdated(UAVObjEvent* ev, void *ctx, void *obj, int len);
+static void rebuildPolygons(void);
 
 // Private variables
 static GeoFenceSettingsData *geofenceSettings;
+static struct geofence *polygonFence;
+static struct polygon_scratch *polygonScratch;
+static volatile bool polygonsDirty;
+static bool polygonsInvalid;
 
 /**
  * Initialise the module, called on startup
@@ -80,6 +100,11 @@ int32_t GeofenceInitialize(void)
 		return -1;
 	}
 
+	if (GeoFencePolygonsInitialize() == -1) {
+		module_enabled = false;
+		return -1;
+	}
+
 	if (module_enabled) {
 		// allocate and initialize the static data storage only if module is enabled
 		geofenceSettings = (GeoFenceSettingsData *) PIOS_malloc(sizeof(GeoFenceSettingsData));
@@ -88,9 +113,24 @@ int32_t GeofenceInitialize(void)
 			return -1;
 		}
 
+		polygonFence = (struct geofence *) PIOS_malloc(sizeof(*polygonFence));
+		if (polygonFence == NULL) {
+			module_enabled = false;
+			return -1;
+		}
+
+		polygonScratch = (struct polygon_scratch *) PIOS_malloc(sizeof(*polygonScratch));
+		if (polygonScratch == NULL) {
+			module_enabled = false;
+			return -1;
+		}
+
 		GeoFenceSettingsConnectCallback(settingsUpdated);
 		settingsUpdated(NULL, NULL, NULL, 0);
 
+		GeoFencePolygonsConnectCallback(polygonsUpdated);
+		rebuildPolygons();
+
 		return 0;
 	}
 
@@ -124,17 +164,37 @@ MODULE_INITCALL(GeofenceInitialize, GeofenceStart);
 static void checkPosition(UAVObjEvent* ev, void *ctx, void *obj, int len)
 {
 	(void) ev; (void) ctx; (void) obj; (void) len;
+
+	if (polygonsDirty) {
+		polygonsDirty = false;
+		rebuildPolygons();
+	}
+
 	if (PositionActualHandle()) {
 		PositionActualData positionActual;
 		PositionActualGet(&positionActual);
 
 		const float distance2 = powf(positionActual.North, 2) + powf(positionActual.East, 2);
 
+		SystemAlarmsAlarmOptions severity = SYSTEMALARMS_ALARM_OK;
+
 		// ErrorRadius is squared when it is fetched, so this is correct
 		if (distance2 > geofenceSettings->ErrorRadius) {
-			AlarmsSet(SYSTEMALARMS_ALARM_GEOFENCE, SYSTEMALARMS_ALARM_ERROR);
+			severity = SYSTEMALARMS_ALARM_ERROR;
 		} else if (distance2 > geofenceSettings->WarningRadius) {
-			AlarmsSet(SYSTEMALARMS_ALARM_GEOFENCE, SYSTEMALARMS_ALARM_WARNING);
+			severity = SYSTEMALARMS_ALARM_WARNING;
+		}
+
+		// Only the edges near the position are looked at
+		bool near;
+		if (!geofence_allowed(polygonFence, positionActual.North, positionActual.East, &near)) {
+			severity = SYSTEMALARMS_ALARM_ERROR;
+		} else if ((near || polygonsInvalid) && severity < SYSTEMALARMS_ALARM_WARNING) {
+			severity = SYSTEMALARMS_ALARM_WARNING;
+		}
+
+		if (severity != SYSTEMALARMS_ALARM_OK) {
+			AlarmsSet(SYSTEMALARMS_ALARM_GEOFENCE, severity);
 		} else {
 			AlarmsClear(SYSTEMALARMS_ALARM_GEOFENCE);
 		}
@@ -154,6 +214,69 @@ static void settingsUpdated(UAVObjEvent* ev, void *ctx, void *obj, int len)
 	geofenceSettings->ErrorRadius = powf(geofenceSettings->ErrorRadius, 2);
 }
 
+/**
+ * Note the polygons changed; the fence is rebuilt on the next check,
+ * as there is no room for it on the callback stack
+ */
+static void polygonsUpdated(UAVObjEvent* ev, void *ctx, void *obj, int len)
+{
+	(void) ev; (void) ctx; (void) obj; (void) len;
+
+	polygonsDirty = true;
+}
+
+/**
+ * Rebuild the polygon fence and its index
+ */
+static void rebuildPolygons(void)
+{
+	GeoFencePolygonsData *polygons = &polygonScratch->polygons;
+	GeoFencePolygonsGet(polygons);
+
+	float *north = polygonScratch->north;
+	float *east = polygonScratch->east;
+	struct geofence_polygon *list = polygonScratch->list;
+	uint8_t num_polygons = 0;
+	uint16_t vertex = 0;
+
+	for (int i = 0; i < GEOFENCEPOLYGONS_NORTH_NUMELEM; i++) {
+		north[i] = polygons->North[i];
+		east[i] = polygons->East[i];
+	}
+
+	polygonsInvalid = false;
+
+	// Disabled polygons keep their vertices, so the others do not move
+	for (int i = 0; i < GEOFENCEPOLYGONS_TYPE_NUMELEM; i++) {
+		uint8_t count = polygons->NumVertices[i];
+
+		if (vertex + count > GEOFENCEPOLYGONS_NORTH_NUMELEM) {
+			polygonsInvalid = true;
+			break;
+		}
+
+		if (polygons->Type[i] != GEOFENCEPOLYGONS_TYPE_DISABLED) {
+			list[num_polygons].first_vertex = vertex;
+			list[num_polygons].num_vertices = count;
+			list[num_polygons].exclusion = polygons->Type[i] == GEOFENCEPOLYGONS_TYPE_EXCLUSION;
+			num_polygons++;
+		}
+
+		vertex += count;
+	}
+
+	if (polygonsInvalid ||
+			geofence_build(polygonFence, north, east, list, num_polygons,
+				polygons->WarningDistance) < 0) {
+		// Fall back to the radius alone, with a warning
+		polygonsInvalid = true;
+		geofence_build(polygonFence, north, east, list, 0, 0);
+	}
+}
+
+DONT_BUILD_IF(GEOFENCEPOLYGONS_NORTH_NUMELEM > GEOFENCE_MAX_VERTICES, GeofenceVertices);
+DONT_BUILD_IF(GEOFENCEPOLYGONS_TYPE_NUMELEM > GEOFENCE_MAX_POLYGONS, GeofencePolygons);
+
 /**
  * @}
  * @}
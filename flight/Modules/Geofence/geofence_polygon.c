@@ -0,0 +1,299 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules Tau Labs Modules
+ * @{
+ * @addtogroup GeoFence GeoFence Module
+ * @{
+ *
+ * @file       geofence_polygon.c
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @brief      Polygonal geofence with a grid index over its edges
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <math.h>
+
+#include "geofence_polygon.h"
+
+#define NUM_CELLS (GEOFENCE_GRID * GEOFENCE_GRID)
+
+//! Twice the signed area of the triangle a, b, c
+static inline float orient(float an, float ae, float bn, float be, float cn, float ce)
+{
+	return (bn - an) * (ce - ae) - (be - ae) * (cn - an);
+}
+
+/**
+ * Whether the way from a to b crosses the edge.  Points exactly on a
+ * line count as being on its left, so a way through a vertex crosses
+ * exactly one of the two edges meeting there, or neither.
+ */
+static bool crosses(const struct geofence_edge *edge, float an, float ae, float bn, float be)
+{
+	if ((orient(an, ae, bn, be, edge->n0, edge->e0) > 0) ==
+			(orient(an, ae, bn, be, edge->n1, edge->e1) > 0))
+		return false;
+
+	return (orient(edge->n0, edge->e0, edge->n1, edge->e1, an, ae) > 0) !=
+		(orient(edge->n0, edge->e0, edge->n1, edge->e1, bn, be) > 0);
+}
+
+//! Squared distance from a point to an edge
+static float distance2(const struct geofence_edge *edge, float n, float e)
+{
+	float dn = edge->n1 - edge->n0;
+	float de = edge->e1 - edge->e0;
+	float len2 = dn * dn + de * de;
+	float t = 0;
+
+	if (len2 > 0) {
+		t = ((n - edge->n0) * dn + (e - edge->e0) * de) / len2;
+		t = fminf(fmaxf(t, 0), 1);
+	}
+
+	dn = edge->n0 + t * dn - n;
+	de = edge->e0 + t * de - e;
+
+	return dn * dn + de * de;
+}
+
+//! Whether the edge passes through a box, by clipping it to the box
+static bool edge_in_box(const struct geofence_edge *edge,
+		float min_n, float min_e, float max_n, float max_e)
+{
+	const float d[2] = { edge->n1 - edge->n0, edge->e1 - edge->e0 };
+	const float lo[2] = { min_n - edge->n0, min_e - edge->e0 };
+	const float hi[2] = { max_n - edge->n0, max_e - edge->e0 };
+	float t0 = 0, t1 = 1;
+
+	for (int i = 0; i < 2; i++) {
+		if (d[i] == 0) {
+			if (lo[i] > 0 || hi[i] < 0)
+				return false;
+			continue;
+		}
+
+		float ta = lo[i] / d[i], tb = hi[i] / d[i];
+		if (ta > tb) {
+			float tmp = ta; ta = tb; tb = tmp;
+		}
+
+		t0 = fmaxf(t0, ta);
+		t1 = fminf(t1, tb);
+		if (t0 > t1)
+			return false;
+	}
+
+	return true;
+}
+
+//! The box of a cell, grown by the margin
+static void cell_box(const struct geofence *g, int cell, float box[4])
+{
+	int row = cell / GEOFENCE_GRID, col = cell % GEOFENCE_GRID;
+
+	box[0] = g->min_north + row * g->cell_north - g->margin;
+	box[1] = g->min_east + col * g->cell_east - g->margin;
+	box[2] = g->min_north + (row + 1) * g->cell_north + g->margin;
+	box[3] = g->min_east + (col + 1) * g->cell_east + g->margin;
+}
+
+static void cell_centre(const struct geofence *g, int cell, float *n, float *e)
+{
+	*n = g->min_north + (cell / GEOFENCE_GRID + 0.5f) * g->cell_north;
+	*e = g->min_east + (cell % GEOFENCE_GRID + 0.5f) * g->cell_east;
+}
+
+//! Polygons a point is inside of, counting crossings on the way from
+//! a point whose polygons are known
+static uint16_t inside_from(const struct geofence *g, uint16_t inside,
+		float from_n, float from_e, float n, float e)
+{
+	for (int i = 0; i < g->num_edges; i++)
+		if (crosses(&g->edges[i], from_n, from_e, n, e))
+			inside ^= 1 << g->edges[i].polygon;
+
+	return inside;
+}
+
+/**
+ * Build the fence from its polygons
+ * @param[out] g The fence
+ * @param[in] north,east The vertices, in m from home
+ * @param[in] polygons Which vertices make up each polygon
+ * @param[in] num_polygons How many polygons there are, 0 for no fence
+ * @param[in] margin Distance from the boundary to warn at, in m
+ * @return 0 if indexed, 1 if too big to index, -1 for invalid polygons
+ */
+int32_t geofence_build(struct geofence *g, const float *north, const float *east,
+		const struct geofence_polygon *polygons, uint8_t num_polygons, float margin)
+{
+	g->num_polygons = 0;
+	g->num_edges = 0;
+	g->exclusion_mask = 0;
+	g->inclusion_mask = 0;
+	g->indexed = false;
+	g->margin = fmaxf(margin, 0);
+
+	if (num_polygons > GEOFENCE_MAX_POLYGONS)
+		return -1;
+
+	float max_north = -INFINITY, max_east = -INFINITY;
+	g->min_north = INFINITY;
+	g->min_east = INFINITY;
+
+	for (int p = 0; p < num_polygons; p++) {
+		const struct geofence_polygon *poly = &polygons[p];
+
+		if (poly->num_vertices < 3 ||
+				g->num_edges + poly->num_vertices > GEOFENCE_MAX_VERTICES)
+			return -1;
+
+		for (int i = 0; i < poly->num_vertices; i++) {
+			int a = poly->first_vertex + i;
+			int b = poly->first_vertex + (i + 1) % poly->num_vertices;
+			struct geofence_edge *edge = &g->edges[g->num_edges++];
+
+			edge->n0 = north[a];
+			edge->e0 = east[a];
+			edge->n1 = north[b];
+			edge->e1 = east[b];
+			edge->polygon = p;
+
+			g->min_north = fminf(g->min_north, north[a]);
+			g->min_east = fminf(g->min_east, east[a]);
+			max_north = fmaxf(max_north, north[a]);
+			max_east = fmaxf(max_east, east[a]);
+		}
+
+		if (poly->exclusion)
+			g->exclusion_mask |= 1 << p;
+		else
+			g->inclusion_mask |= 1 << p;
+	}
+
+	g->num_polygons = num_polygons;
+
+	if (num_polygons == 0)
+		return 0;
+
+	// Outside the grid nothing is inside a polygon or near an edge
+	g->min_north -= g->margin + 1;
+	g->min_east -= g->margin + 1;
+	g->cell_north = (max_north + g->margin + 1 - g->min_north) / GEOFENCE_GRID;
+	g->cell_east = (max_east + g->margin + 1 - g->min_east) / GEOFENCE_GRID;
+
+	// Count the edges of each cell, then list them
+	uint16_t total = 0;
+
+	for (int c = 0; c < NUM_CELLS; c++) {
+		float box[4];
+		cell_box(g, c, box);
+
+		g->cell_start[c] = total;
+
+		for (int i = 0; i < g->num_edges; i++) {
+			if (!edge_in_box(&g->edges[i], box[0], box[1], box[2], box[3]))
+				continue;
+
+			if (total >= GEOFENCE_MAX_CELL_EDGES)
+				return 1;
+
+			g->cell_edges[total++] = i;
+		}
+	}
+
+	g->cell_start[NUM_CELLS] = total;
+
+	// The corner of the grid is outside all polygons
+	for (int c = 0; c < NUM_CELLS; c++) {
+		float n, e;
+		cell_centre(g, c, &n, &e);
+
+		g->cell_inside[c] = inside_from(g, 0, g->min_north, g->min_east, n, e);
+	}
+
+	g->indexed = true;
+
+	return 0;
+}
+
+/**
+ * Check a position against the fence
+ * @param[in] g The fence
+ * @param[in] north,east The position, in m from home
+ * @param[out] near Set when allowed but within the margin of a boundary
+ * @return true if the position is allowed: inside an inclusion polygon
+ * if there are any, and outside all exclusion polygons
+ */
+bool geofence_allowed(const struct geofence *g, float north, float east, bool *near)
+{
+	const float margin2 = g->margin * g->margin;
+	uint16_t inside = 0;
+	bool close = false;
+
+	*near = false;
+
+	if (g->num_polygons == 0)
+		return true;
+
+	if (g->indexed) {
+		float row = floorf((north - g->min_north) / g->cell_north);
+		float col = floorf((east - g->min_east) / g->cell_east);
+
+		if (row >= 0 && row < GEOFENCE_GRID && col >= 0 && col < GEOFENCE_GRID) {
+			int c = row * GEOFENCE_GRID + col;
+			float n, e;
+			cell_centre(g, c, &n, &e);
+
+			inside = g->cell_inside[c];
+
+			for (int i = g->cell_start[c]; i < g->cell_start[c + 1]; i++) {
+				const struct geofence_edge *edge = &g->edges[g->cell_edges[i]];
+
+				if (crosses(edge, n, e, north, east))
+					inside ^= 1 << edge->polygon;
+
+				if (!close && distance2(edge, north, east) < margin2)
+					close = true;
+			}
+		}
+	} else {
+		inside = inside_from(g, 0, g->min_north, g->min_east, north, east);
+
+		for (int i = 0; i < g->num_edges && !close; i++)
+			close = distance2(&g->edges[i], north, east) < margin2;
+	}
+
+	if (g->inclusion_mask && !(inside & g->inclusion_mask))
+		return false;
+
+	if (inside & g->exclusion_mask)
+		return false;
+
+	*near = close;
+
+	return true;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,112 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules Tau Labs Modules
+ * @{
+ * @addtogroup GeoFence GeoFence Module
+ * @{
+ *
+ * @file       geofence_polygon.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @brief      Polygonal geofence with a grid index over its edges
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef GEOFENCE_POLYGON_H
+#define GEOFENCE_POLYGON_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//! Vertices of all polygons together. GeoFencePolygons holds 56, which
+//! is the limit in the firmware; only host builds make room for more
+#ifndef GEOFENCE_MAX_VERTICES
+#define GEOFENCE_MAX_VERTICES 56
+#endif
+
+//! As many as GeoFencePolygons holds; at most 16, one bit each in the
+//! cell states
+#define GEOFENCE_MAX_POLYGONS 8
+
+//! Cells along each side of the grid
+#ifndef GEOFENCE_GRID
+#define GEOFENCE_GRID 8
+#endif
+
+//! Edge references over all cells; without room for them the fence
+//! is still checked, but against every edge
+#ifndef GEOFENCE_MAX_CELL_EDGES
+#define GEOFENCE_MAX_CELL_EDGES 512
+#endif
+
+struct geofence_polygon {
+	uint16_t first_vertex;
+	uint16_t num_vertices;
+	bool exclusion;		/**< Keep out, rather than keep in */
+};
+
+struct geofence_edge {
+	float n0, e0, n1, e1;
+	uint8_t polygon;
+};
+
+/**
+ * The fence, built by geofence_build() whenever the polygons change.
+ *
+ * The bounding box of the polygons, grown by the warning margin, is
+ * cut into a grid.  Each cell lists the edges that come within the
+ * margin of it and records which polygons its centre is inside of.  A
+ * position is then inside a polygon if the centre of its cell is and
+ * the way from there crosses its edges an even number of times; only
+ * the edges listed in that cell can be crossed.
+ */
+struct geofence {
+	struct geofence_edge edges[GEOFENCE_MAX_VERTICES];
+	uint16_t num_edges;
+
+	uint8_t num_polygons;
+	uint16_t exclusion_mask;	/**< Bit n set for exclusion polygons */
+	uint16_t inclusion_mask;
+
+	float margin;
+
+	bool indexed;
+	float min_north, min_east;
+	float cell_north, cell_east;	/**< Cell size */
+	uint16_t cell_inside[GEOFENCE_GRID * GEOFENCE_GRID];	/**< Polygons the centre is in */
+	uint16_t cell_start[GEOFENCE_GRID * GEOFENCE_GRID + 1];
+	uint16_t cell_edges[GEOFENCE_MAX_CELL_EDGES];
+};
+
+int32_t geofence_build(struct geofence *g, const float *north, const float *east,
+		const struct geofence_polygon *polygons, uint8_t num_polygons, float margin);
+bool geofence_allowed(const struct geofence *g, float north, float east, bool *near);
+
+//! Whether there is any fence at all
+static inline bool geofence_active(const struct geofence *g)
+{
+	return g->num_polygons > 0;
+}
+
+#endif /* GEOFENCE_POLYGON_H */
+
+/**
+ * @}
+ * @}
+ */
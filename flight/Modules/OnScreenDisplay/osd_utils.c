@@ -57,14 +57,212 @@ extern uint8_t *draw_buffer;
 extern uint8_t *disp_buffer;
 #endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
 
+// Spans are written a 32 bit word at a time; the buffers are accessed as bytes elsewhere
+typedef uint32_t __attribute__((may_alias)) osd_word_t;
 
+/*
+ * Most of the screen is transparent, so rather than clearing whole buffers
+ * every frame, clearGraphics() only clears the tiles drawn on since the
+ * buffer was last cleared.  The video driver swaps the buffers at vsync even
+ * when a frame is still being drawn, so which buffer a primitive lands on
+ * is not known for certain; every drawn tile is therefore recorded for both
+ * buffers.  A HUD draws much the same tiles every frame, so this costs little.
+ *
+ * Tiles are one word wide in the split buffers, and each column of tiles is
+ * a bitmap of its rows, so most primitives mark a single word.
+ */
+#define DIRTY_BUFFERS      2	// The video driver double buffers
+#define DIRTY_TILE_WIDTH   32	// Pixels; a whole number of words in either format
+#define DIRTY_TILE_HEIGHT  16	// Enough that a column of tiles fits in 32 bits
+#define DIRTY_TILE_BYTES   (DIRTY_TILE_WIDTH / PIXELS_PER_BIT)
+#define DIRTY_TILE_COLUMNS ((BUFFER_WIDTH + DIRTY_TILE_BYTES - 1) / DIRTY_TILE_BYTES)
+#define DIRTY_TILE_ROWS    ((BUFFER_HEIGHT + DIRTY_TILE_HEIGHT - 1) / DIRTY_TILE_HEIGHT)
+
+struct dirty_region {
+	const uint8_t *buffer;			// Draw buffer the region belongs to, NULL if unclaimed
+	bool full;				// Clear the whole buffer next time
+	uint32_t tiles[DIRTY_TILE_COLUMNS];	// One bit per tile row
+};
+
+static struct dirty_region dirty[DIRTY_BUFFERS];
+static uint8_t dirty_next_claim;
+
+/**
+ * mark_dirty: record that a rectangle of the draw buffer has been drawn on,
+ * so that the next clearGraphics() of either buffer clears it. Coordinates
+ * may be in any order, and are clipped to the buffer rather than the
+ * graphics area as some primitives spill past the right edge.
+ */
+static void mark_dirty(int x0, int y0, int x1, int y1)
+{
+	if (x0 > x1) {
+		SWAP(x0, x1);
+	}
+	if (y0 > y1) {
+		SWAP(y0, y1);
+	}
+	if (x1 < 0 || y1 < 0 || x0 >= BUFFER_WIDTH * PIXELS_PER_BIT || y0 >= BUFFER_HEIGHT) {
+		return;
+	}
+
+	x0 = MAX(x0, 0) / DIRTY_TILE_WIDTH;
+	y0 = MAX(y0, 0) / DIRTY_TILE_HEIGHT;
+	x1 = MIN(x1, BUFFER_WIDTH * PIXELS_PER_BIT - 1) / DIRTY_TILE_WIDTH;
+	y1 = MIN(y1, BUFFER_HEIGHT - 1) / DIRTY_TILE_HEIGHT;
+
+	uint32_t rows = (2u << y1) - (1u << y0);
+	for (int col = x0; col <= x1; col++) {
+		for (int i = 0; i < DIRTY_BUFFERS; i++) {
+			dirty[i].tiles[col] |= rows;
+		}
+	}
+}
+
+/*
+ * Every write to the buffers is (byte & keep) ^ fill for the pixels being
+ * written, which covers clearing, setting and toggling in the split buffers
+ * and replacing with a packed value in the 2 bit per pixel buffer.
+ */
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+/**
+ * mode_op: the keep and fill bytes for a mode
+ *
+ * @param       mode    0 = clear, 1 = set, 2 = toggle; anything else leaves the pixels
+ */
+static inline void mode_op(int mode, uint8_t *keep, uint8_t *fill)
+{
+	*keep = (mode == 0 || mode == 1) ? 0x00 : 0xff;
+	*fill = (mode == 1 || mode == 2) ? 0xff : 0x00;
+}
+#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+
+static inline uint8_t byte_op(uint8_t byte, uint8_t mask, uint8_t keep, uint8_t fill)
+{
+	return (byte & (keep | ~mask)) ^ (fill & mask);
+}
+
+/**
+ * write_span: write whole bytes from addr0 to addr1 inclusive, using aligned
+ * 32 bit words for the middle of the span.
+ *
+ * @param       buff    pointer to buffer to write in
+ * @param       addr0   first byte
+ * @param       addr1   last byte
+ * @param       keep    bits of each byte to keep
+ * @param       fill    bits to XOR into each byte
+ */
+__attribute__((always_inline)) static inline void write_span(uint8_t *buff, int addr0, int addr1, uint8_t keep, uint8_t fill)
+{
+	uint8_t *p = buff + addr0;
+	uint8_t *end = buff + addr1 + 1;
+	uint32_t keep_word = keep * 0x01010101u;
+	uint32_t fill_word = fill * 0x01010101u;
+
+	for (; p < end && ((uintptr_t)p & 3); p++) {
+		*p = (*p & keep) ^ fill;
+	}
+	if (keep == 0) {
+		for (; end - p >= 4; p += 4) {
+			*(osd_word_t *)p = fill_word;
+		}
+	} else {
+		for (; end - p >= 4; p += 4) {
+			*(osd_word_t *)p = (*(osd_word_t *)p & keep_word) ^ fill_word;
+		}
+	}
+	for (; p < end; p++) {
+		*p = (*p & keep) ^ fill;
+	}
+}
+
+/**
+ * clearGraphics: clear the draw buffer. Only what was drawn since the
+ * buffer was last cleared is cleared; a buffer not seen before is cleared
+ * completely.
+ */
 void clearGraphics()
 {
 #if defined(PIOS_VIDEO_SPLITBUFFER)
-	memset((uint8_t *)draw_buffer_mask, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
-	memset((uint8_t *)draw_buffer_level, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
+	uint8_t *level = draw_buffer_level;
+	uint8_t *mask = draw_buffer_mask;
+	const uint8_t *key = level;
 #else
-	memset((uint8_t *)draw_buffer, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
+	uint8_t *buff = draw_buffer;
+	const uint8_t *key = buff;
+#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+	struct dirty_region *region = NULL;
+
+	for (int i = 0; i < DIRTY_BUFFERS; i++) {
+		if (dirty[i].buffer == key) {
+			region = &dirty[i];
+		}
+	}
+
+	if (region == NULL) {
+		region = &dirty[dirty_next_claim];
+		dirty_next_claim = (dirty_next_claim + 1) % DIRTY_BUFFERS;
+		region->buffer = key;
+		region->full = true;
+	}
+
+	if (region->full) {
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+		memset(mask, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
+		memset(level, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
+#else
+		memset(buff, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
+#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+		memset(region->tiles, 0, sizeof(region->tiles));
+		region->full = false;
+		return;
+	}
+
+	// Clear each row of tiles a run of adjacent dirty tiles at a time
+	for (int row = 0; row < DIRTY_TILE_ROWS; row++) {
+		uint32_t bit = 1u << row;
+		int y0 = row * DIRTY_TILE_HEIGHT;
+		int y1 = MIN(y0 + DIRTY_TILE_HEIGHT, BUFFER_HEIGHT);
+
+		for (int col = 0; col < DIRTY_TILE_COLUMNS; col++) {
+			if (!(region->tiles[col] & bit)) {
+				continue;
+			}
+			int first = col;
+			while (col + 1 < DIRTY_TILE_COLUMNS && (region->tiles[col + 1] & bit)) {
+				col++;
+			}
+			int addr0 = first * DIRTY_TILE_BYTES;
+			int addr1 = MIN((col + 1) * DIRTY_TILE_BYTES, BUFFER_WIDTH) - 1;
+
+			for (int offset = y0 * BUFFER_WIDTH; offset < y1 * BUFFER_WIDTH; offset += BUFFER_WIDTH) {
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+				write_span(mask + offset, addr0, addr1, 0, 0);
+				write_span(level + offset, addr0, addr1, 0, 0);
+#else
+				write_span(buff + offset, addr0, addr1, 0, 0);
+#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+			}
+		}
+	}
+	memset(region->tiles, 0, sizeof(region->tiles));
+}
+
+/**
+ * pixel_lm: write_pixel_lm() for callers that have marked the area dirty
+ */
+static inline void pixel_lm(int x, int y, int mmode, int lmode)
+{
+	CHECK_COORDS(x, y);
+	// Determine the bit in the word to be set and the word
+	// index to set it in.
+	int addr   = CALC_BUFF_ADDR(x, y);
+	uint8_t mask = CALC_BIT_MASK(x);
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+	WRITE_WORD_MODE(draw_buffer_mask, addr, mask, mmode);
+	WRITE_WORD_MODE(draw_buffer_level, addr, mask, lmode);
+#else
+	uint8_t value = PACK_BITS(mmode, lmode);
+	WRITE_WORD(draw_buffer, addr, mask, value);
 #endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
 }
 
@@ -72,6 +270,7 @@ void draw_image(uint16_t x, uint16_t y, const struct Image * image)
 {
 #if defined(PIOS_VIDEO_SPLITBUFFER)
 	CHECK_COORDS(x + image->width, y + image->height);
+	mark_dirty(x, y, x + image->width + 7, y + image->height - 1);
 	uint8_t byte_width = image->width / 8;
 	uint8_t pixel_offset = x % 8;
 	uint8_t mask1 = 0xFF;
@@ -98,6 +297,7 @@ void draw_image(uint16_t x, uint16_t y, const struct Image * image)
 	}
 #else
 	CHECK_COORDS(x + image->width, y + image->height);
+	mark_dirty(x, y, x + image->width + 7, y + image->height - 1);
 	uint8_t byte_width = image->width / 4;
 	uint8_t pixel_offset = 2 * (x % 4);
 	uint8_t mask1 = 0xFF;
@@ -134,12 +334,18 @@ void draw_image(uint16_t x, uint16_t y, const struct Image * image)
 /// \param deltaX the difference between the centerX coordinate and each pixel drawn
 /// \param deltaY the difference between the centerY coordinate and each pixel drawn
 /// \param color the color to draw the pixels with.
+static inline void plot_four_quadrants(int32_t centerX, int32_t centerY, int32_t deltaX, int32_t deltaY)
+{
+	pixel_lm(centerX + deltaX, centerY + deltaY, 1, 1); // Ist      Quadrant
+	pixel_lm(centerX - deltaX, centerY + deltaY, 1, 1); // IInd     Quadrant
+	pixel_lm(centerX - deltaX, centerY - deltaY, 1, 1); // IIIrd    Quadrant
+	pixel_lm(centerX + deltaX, centerY - deltaY, 1, 1); // IVth     Quadrant
+}
+
 void plotFourQuadrants(int32_t centerX, int32_t centerY, int32_t deltaX, int32_t deltaY)
 {
-	write_pixel_lm(centerX + deltaX, centerY + deltaY, 1, 1); // Ist      Quadrant
-	write_pixel_lm(centerX - deltaX, centerY + deltaY, 1, 1); // IInd     Quadrant
-	write_pixel_lm(centerX - deltaX, centerY - deltaY, 1, 1); // IIIrd    Quadrant
-	write_pixel_lm(centerX + deltaX, centerY - deltaY, 1, 1); // IVth     Quadrant
+	mark_dirty(centerX - deltaX, centerY - deltaY, centerX + deltaX, centerY + deltaY);
+	plot_four_quadrants(centerX, centerY, deltaX, deltaY);
 }
 
 /// Implements the midpoint ellipse drawing algorithm which is a bresenham
@@ -162,7 +368,10 @@ void ellipse(int centerX, int centerY, int horizontalRadius, int verticalRadius)
 	int deltaX = 0;
 	int deltaY = (doubleHorizontalRadius << 1) * y;
 
-	plotFourQuadrants(centerX, centerY, x, y);
+	mark_dirty(centerX - abs(horizontalRadius) - 2, centerY - abs(verticalRadius) - 2,
+			centerX + abs(horizontalRadius) + 2, centerY + abs(verticalRadius) + 2);
+
+	plot_four_quadrants(centerX, centerY, x, y);
 
 	while (deltaY >= deltaX) {
 		x++;
@@ -176,7 +385,7 @@ void ellipse(int centerX, int centerY, int horizontalRadius, int verticalRadius)
 
 			error  -= deltaY;
 		}
-		plotFourQuadrants(centerX, centerY, x, y);
+		plot_four_quadrants(centerX, centerY, x, y);
 	}
 
 	error = (int64_t)(doubleVerticalRadius * (x + 1 / 2.0f) * (x + 1 / 2.0f) + doubleHorizontalRadius * (y - 1) * (y - 1) - doubleHorizontalRadius * doubleVerticalRadius);
@@ -193,7 +402,7 @@ void ellipse(int centerX, int centerY, int horizontalRadius, int verticalRadius)
 			error  += deltaX;
 		}
 
-		plotFourQuadrants(centerX, centerY, x, y);
+		plot_four_quadrants(centerX, centerY, x, y);
 	}
 }
 
@@ -261,18 +470,87 @@ void write_pixel(int x, int y, uint8_t value)
  */
 void write_pixel_lm(int x, int y, int mmode, int lmode)
 {
-	CHECK_COORDS(x, y);
-	// Determine the bit in the word to be set and the word
-	// index to set it in.
-	int addr   = CALC_BUFF_ADDR(x, y);
-	uint8_t mask = CALC_BIT_MASK(x);
+	mark_dirty(x, y, x, y);
+	pixel_lm(x, y, mmode, lmode);
+}
+
+/*
+ * A run of pixels within a row, as drawn by horizontal lines and each row
+ * of a filled rectangle: partial bytes at either end, and whole bytes in
+ * between which are written a word at a time.
+ */
+struct hspan {
+	int addr0, addr1;	// First and last byte, from the start of the row
+	uint8_t mask_l;		// Pixels of the first byte, or of the only byte
+	uint8_t mask_r;		// Pixels of the last byte
+};
+
+static inline void hspan_init(struct hspan *span, int x0, int x1, int addr0_bit, int addr1_bit)
+{
+	span->addr0 = x0 / PIXELS_PER_BIT;
+	span->addr1 = x1 / PIXELS_PER_BIT;
+	if (span->addr0 == span->addr1) {
+		span->mask_l = COMPUTE_HLINE_ISLAND_MASK(addr0_bit, addr1_bit);
+	} else {
+		span->mask_l = COMPUTE_HLINE_EDGE_L_MASK(addr0_bit);
+		span->mask_r = COMPUTE_HLINE_EDGE_R_MASK(addr1_bit);
+	}
+}
+
+/**
+ * hline_span: clip a horizontal line and compute its span
+ * @return false if there is nothing to draw
+ */
+static bool hline_span(int x0, int x1, int y, struct hspan *span)
+{
+	if (y < GRAPHICS_TOP || y > GRAPHICS_BOTTOM) {
+		return false;
+	}
+	CLIP_COORD_X(x0);
+	CLIP_COORD_X(x1);
+	if (x0 > x1) {
+		SWAP(x0, x1);
+	}
+	if (x0 == x1) {
+		return false;
+	}
 #if defined(PIOS_VIDEO_SPLITBUFFER)
-	WRITE_WORD_MODE(draw_buffer_mask, addr, mask, mmode);
-	WRITE_WORD_MODE(draw_buffer_level, addr, mask, lmode);
+	hspan_init(span, x0, x1, CALC_BIT_IN_WORD(x0), CALC_BIT_IN_WORD(x1));
 #else
-	uint8_t value = PACK_BITS(mmode, lmode);
-	WRITE_WORD(draw_buffer, addr, mask, value);
+	hspan_init(span, x0, x1, CALC_BIT1_IN_WORD(x0), CALC_BIT0_IN_WORD(x1));
 #endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+	return true;
+}
+
+/**
+ * rectangle_span: check a filled rectangle and compute the span of its rows
+ * @return false if there is nothing to draw
+ */
+static bool rectangle_span(int x, int y, int width, int height, struct hspan *span)
+{
+	if (x < GRAPHICS_LEFT || x > GRAPHICS_RIGHT || y < GRAPHICS_TOP || y > GRAPHICS_BOTTOM) {
+		return false;
+	}
+	if (x + width < GRAPHICS_LEFT || x + width > GRAPHICS_RIGHT ||
+			y + height < GRAPHICS_TOP || y + height > GRAPHICS_BOTTOM) {
+		return false;
+	}
+	if (width <= 0 || height <= 0) {
+		return false;
+	}
+	hspan_init(span, x, x + width, CALC_BIT_IN_WORD(x), CALC_BIT_IN_WORD(x + width));
+	return true;
+}
+
+__attribute__((always_inline)) static inline void hspan_write(uint8_t *row, const struct hspan *span, uint8_t keep, uint8_t fill)
+{
+	if (span->addr0 == span->addr1) {
+		row[span->addr0] = byte_op(row[span->addr0], span->mask_l, keep, fill);
+	} else {
+		row[span->addr0] = byte_op(row[span->addr0], span->mask_l, keep, fill);
+		row[span->addr1] = byte_op(row[span->addr1], span->mask_r, keep, fill);
+		write_span(row, span->addr0 + 1, span->addr1 - 1, keep, fill);
+	}
 }
 
 /**
@@ -287,75 +565,21 @@ void write_pixel_lm(int x, int y, int mmode, int lmode)
 #if defined(PIOS_VIDEO_SPLITBUFFER)
 void write_hline(uint8_t *buff, int x0, int x1, int y, int mode)
 {
-	CHECK_COORD_Y(y);
-	CLIP_COORD_X(x0);
-	CLIP_COORD_X(x1);
-	if (x0 > x1) {
-		SWAP(x0, x1);
-	}
-	if (x0 == x1) {
-		return;
-	}
-	/* This is an optimised algorithm for writing horizontal lines.
-	 * We begin by finding the addresses of the x0 and x1 points. */
-	int addr0     = CALC_BUFF_ADDR(x0, y);
-	int addr1     = CALC_BUFF_ADDR(x1, y);
-	int addr0_bit = CALC_BIT_IN_WORD(x0);
-	int addr1_bit = CALC_BIT_IN_WORD(x1);
-	int mask, mask_l, mask_r, i;
-	/* If the addresses are equal, we only need to write one word
-	 * which is an island. */
-	if (addr0 == addr1) {
-		mask = COMPUTE_HLINE_ISLAND_MASK(addr0_bit, addr1_bit);
-		WRITE_WORD_MODE(buff, addr0, mask, mode);
-	} else {
-		/* Otherwise we need to write the edges and then the middle. */
-		mask_l = COMPUTE_HLINE_EDGE_L_MASK(addr0_bit);
-		mask_r = COMPUTE_HLINE_EDGE_R_MASK(addr1_bit);
-		WRITE_WORD_MODE(buff, addr0, mask_l, mode);
-		WRITE_WORD_MODE(buff, addr1, mask_r, mode);
-		// Now write 0xffff words from start+1 to end-1.
-		for (i = addr0 + 1; i <= addr1 - 1; i++) {
-			uint8_t m = 0xff;
-			WRITE_WORD_MODE(buff, i, m, mode);
-		}
+	struct hspan span;
+	uint8_t keep, fill;
+
+	if (hline_span(x0, x1, y, &span)) {
+		mode_op(mode, &keep, &fill);
+		hspan_write(buff + y * BUFFER_WIDTH, &span, keep, fill);
 	}
 }
 #else
 void write_hline(int x0, int x1, int y, uint8_t value)
 {
-	CHECK_COORD_Y(y);
-	CLIP_COORD_X(x0);
-	CLIP_COORD_X(x1);
-	if (x0 > x1) {
-		SWAP(x0, x1);
-	}
-	if (x0 == x1) {
-		return;
-	}
-	/* This is an optimised algorithm for writing horizontal lines.
-	 * We begin by finding the addresses of the x0 and x1 points. */
-	int addr0     = CALC_BUFF_ADDR(x0, y);
-	int addr1     = CALC_BUFF_ADDR(x1, y);
-	int addr0_bit = CALC_BIT1_IN_WORD(x0);
-	int addr1_bit = CALC_BIT0_IN_WORD(x1);
-	int mask, mask_l, mask_r, i;
-	/* If the addresses are equal, we only need to write one word
-	 * which is an island. */
-	if (addr0 == addr1) {
-		mask = COMPUTE_HLINE_ISLAND_MASK(addr0_bit, addr1_bit);
-		WRITE_WORD(draw_buffer, addr0, mask, value);
-	} else {
-		/* Otherwise we need to write the edges and then the middle. */
-		mask_l = COMPUTE_HLINE_EDGE_L_MASK(addr0_bit);
-		mask_r = COMPUTE_HLINE_EDGE_R_MASK(addr1_bit);
-		WRITE_WORD(draw_buffer, addr0, mask_l, value);
-		WRITE_WORD(draw_buffer, addr1, mask_r, value);
-		// Now write 0xffff words from start+1 to end-1.
-		for (i = addr0 + 1; i <= addr1 - 1; i++) {
-			uint8_t m = 0xff;
-			WRITE_WORD(draw_buffer, i, m, value);
-		}
+	struct hspan span;
+
+	if (hline_span(x0, x1, y, &span)) {
+		hspan_write(draw_buffer + y * BUFFER_WIDTH, &span, 0, value);
 	}
 }
 #endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
@@ -372,14 +596,20 @@ void write_hline(int x0, int x1, int y, uint8_t value)
  */
 void write_hline_lm(int x0, int x1, int y, int lmode, int mmode)
 {
+	struct hspan span;
+
+	if (!hline_span(x0, x1, y, &span)) {
+		return;
+	}
+	mark_dirty(x0, y, x1, y);
 #if defined(PIOS_VIDEO_SPLITBUFFER)
-	// TODO: an optimisation would compute the masks and apply to
-	// both buffers simultaneously.
-	write_hline(draw_buffer_level, x0, x1, y, lmode);
-	write_hline(draw_buffer_mask, x0, x1, y, mmode);
+	uint8_t lkeep, lfill, mkeep, mfill;
+	mode_op(lmode, &lkeep, &lfill);
+	mode_op(mmode, &mkeep, &mfill);
+	hspan_write(draw_buffer_level + y * BUFFER_WIDTH, &span, lkeep, lfill);
+	hspan_write(draw_buffer_mask + y * BUFFER_WIDTH, &span, mkeep, mfill);
 #else
-	uint8_t value = PACK_BITS(mmode, lmode);
-	write_hline(x0, x1, y, value);
+	hspan_write(draw_buffer + y * BUFFER_WIDTH, &span, 0, PACK_BITS(mmode, lmode));
 #endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
 }
 
@@ -403,6 +633,7 @@ void write_hline_outlined(int x0, int x1, int y, int endcap0, int endcap1, int m
 	if (x0 > x1) {
 		SWAP(x0, x1);
 	}
+	mark_dirty(x0, y - 1, x1, y + 1);
 	// Draw the main body of the line.
 	write_hline_lm(x0 + 1, x1 - 1, y - 1, stroke, mmode);
 	write_hline_lm(x0 + 1, x1 - 1, y + 1, stroke, mmode);
@@ -483,6 +714,7 @@ void write_vline(int x, int y0, int y1, uint8_t value)
  */
 void write_vline_lm(int x, int y0, int y1, int lmode, int mmode)
 {
+	mark_dirty(x, y0, x, y1);
 #if defined(PIOS_VIDEO_SPLITBUFFER)
 	// TODO: an optimisation would compute the masks and apply to
 	// both buffers simultaneously.
@@ -514,6 +746,7 @@ void write_vline_outlined(int x, int y0, int y1, int endcap0, int endcap1, int m
 		SWAP(y0, y1);
 	}
 	SETUP_STROKE_FILL(stroke, fill, mode);
+	mark_dirty(x - 1, y0, x + 1, y1);
 	// Draw the main body of the line.
 	write_vline_lm(x - 1, y0 + 1, y1 - 1, stroke, mmode);
 	write_vline_lm(x + 1, y0 + 1, y1 - 1, stroke, mmode);
@@ -540,109 +773,29 @@ void write_vline_outlined(int x, int y0, int y1, int endcap0, int endcap1, int m
 #if defined(PIOS_VIDEO_SPLITBUFFER)
 void write_filled_rectangle(uint8_t *buff, int x, int y, int width, int height, int mode)
 {
-	int yy, addr0_old, addr1_old;
+	struct hspan span;
+	uint8_t keep, fill;
 
-	CHECK_COORDS(x, y);
-	CHECK_COORDS(x + width, y + height);
-	if (width <= 0 || height <= 0) {
+	if (!rectangle_span(x, y, width, height, &span)) {
 		return;
 	}
-	// Calculate as if the rectangle was only a horizontal line. We then
-	// step these addresses through each row until we iterate `height` times.
-	int addr0     = CALC_BUFF_ADDR(x, y);
-	int addr1     = CALC_BUFF_ADDR(x + width, y);
-	int addr0_bit = CALC_BIT_IN_WORD(x);
-	int addr1_bit = CALC_BIT_IN_WORD(x + width);
-	int mask, mask_l, mask_r, i;
-	// If the addresses are equal, we need to write one word vertically.
-	if (addr0 == addr1) {
-		mask = COMPUTE_HLINE_ISLAND_MASK(addr0_bit, addr1_bit);
-		while (height--) {
-			WRITE_WORD_MODE(buff, addr0, mask, mode);
-			addr0 += BUFFER_WIDTH;
-		}
-	} else {
-		// Otherwise we need to write the edges and then the middle repeatedly.
-		mask_l    = COMPUTE_HLINE_EDGE_L_MASK(addr0_bit);
-		mask_r    = COMPUTE_HLINE_EDGE_R_MASK(addr1_bit);
-		// Write edges first.
-		yy        = 0;
-		addr0_old = addr0;
-		addr1_old = addr1;
-		while (yy < height) {
-			WRITE_WORD_MODE(buff, addr0, mask_l, mode);
-			WRITE_WORD_MODE(buff, addr1, mask_r, mode);
-			addr0 += BUFFER_WIDTH;
-			addr1 += BUFFER_WIDTH;
-			yy++;
-		}
-		// Now write 0xffff words from start+1 to end-1 for each row.
-		yy    = 0;
-		addr0 = addr0_old;
-		addr1 = addr1_old;
-		while (yy < height) {
-			for (i = addr0 + 1; i <= addr1 - 1; i++) {
-				uint8_t m = 0xff;
-				WRITE_WORD_MODE(buff, i, m, mode);
-			}
-			addr0 += BUFFER_WIDTH;
-			addr1 += BUFFER_WIDTH;
-			yy++;
-		}
+	mode_op(mode, &keep, &fill);
+	// Every row is the same span, so step it down the buffer.
+	for (uint8_t *row = buff + y * BUFFER_WIDTH; height--; row += BUFFER_WIDTH) {
+		hspan_write(row, &span, keep, fill);
 	}
 }
 #else
 void write_filled_rectangle(int x, int y, int width, int height, uint8_t value)
 {
-	int yy, addr0_old, addr1_old;
+	struct hspan span;
 
-	CHECK_COORDS(x, y);
-	CHECK_COORDS(x + width, y + height);
-	if (width <= 0 || height <= 0) {
+	if (!rectangle_span(x, y, width, height, &span)) {
 		return;
 	}
-	// Calculate as if the rectangle was only a horizontal line. We then
-	// step these addresses through each row until we iterate `height` times.
-	int addr0     = CALC_BUFF_ADDR(x, y);
-	int addr1     = CALC_BUFF_ADDR(x + width, y);
-	int addr0_bit = CALC_BIT_IN_WORD(x);
-	int addr1_bit = CALC_BIT_IN_WORD(x + width);
-	int mask, mask_l, mask_r, i;
-	// If the addresses are equal, we need to write one word vertically.
-	if (addr0 == addr1) {
-		mask = COMPUTE_HLINE_ISLAND_MASK(addr0_bit, addr1_bit);
-		while (height--) {
-			WRITE_WORD(draw_buffer, addr0, mask, value);
-			addr0 += BUFFER_WIDTH;
-		}
-	} else {
-		// Otherwise we need to write the edges and then the middle repeatedly.
-		mask_l    = COMPUTE_HLINE_EDGE_L_MASK(addr0_bit);
-		mask_r    = COMPUTE_HLINE_EDGE_R_MASK(addr1_bit);
-		// Write edges first.
-		yy        = 0;
-		addr0_old = addr0;
-		addr1_old = addr1;
-		while (yy < height) {
-			WRITE_WORD(draw_buffer, addr0, mask_l, value);
-			WRITE_WORD(draw_buffer, addr1, mask_r, value);
-			addr0 += BUFFER_WIDTH;
-			addr1 += BUFFER_WIDTH;
-			yy++;
-		}
-		// Now write 0xffff words from start+1 to end-1 for each row.
-		yy    = 0;
-		addr0 = addr0_old;
-		addr1 = addr1_old;
-		while (yy < height) {
-			for (i = addr0 + 1; i <= addr1 - 1; i++) {
-				uint8_t m = 0xff;
-				WRITE_WORD(draw_buffer, i, m, value);
-			}
-			addr0 += BUFFER_WIDTH;
-			addr1 += BUFFER_WIDTH;
-			yy++;
-		}
+	// Every row is the same span, so step it down the buffer.
+	for (uint8_t *row = draw_buffer + y * BUFFER_WIDTH; height--; row += BUFFER_WIDTH) {
+		hspan_write(row, &span, 0, value);
 	}
 }
 #endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
@@ -659,13 +812,29 @@ void write_filled_rectangle(int x, int y, int width, int height, uint8_t value)
  */
 void write_filled_rectangle_lm(int x, int y, int width, int height, int lmode, int mmode)
 {
+	struct hspan span;
+
+	if (!rectangle_span(x, y, width, height, &span)) {
+		return;
+	}
+	mark_dirty(x, y, x + width, y + height - 1);
+
 #if defined(PIOS_VIDEO_SPLITBUFFER)
-	write_filled_rectangle(draw_buffer_mask, x, y, width, height, mmode);
-	write_filled_rectangle(draw_buffer_level, x, y, width, height, lmode);
+	uint8_t lkeep, lfill, mkeep, mfill;
+	mode_op(lmode, &lkeep, &lfill);
+	mode_op(mmode, &mkeep, &mfill);
 #else
 	uint8_t value = PACK_BITS(mmode, lmode);
-	write_filled_rectangle(x, y, width, height, value);
 #endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+
+	for (int offset = y * BUFFER_WIDTH; height--; offset += BUFFER_WIDTH) {
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+		hspan_write(draw_buffer_mask + offset, &span, mkeep, mfill);
+		hspan_write(draw_buffer_level + offset, &span, lkeep, lfill);
+#else
+		hspan_write(draw_buffer + offset, &span, 0, value);
+#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+	}
 }
 
 /**
@@ -681,6 +850,7 @@ void write_filled_rectangle_lm(int x, int y, int width, int height, int lmode, i
  */
 void write_rectangle_outlined(int x, int y, int width, int height, int mode, int mmode)
 {
+	mark_dirty(MIN(x, x + width) - 1, MIN(y, y + height) - 1, MAX(x, x + width) + 1, MAX(y, y + height) + 1);
 	write_hline_outlined(x, x + width, y, ENDCAP_ROUND, ENDCAP_ROUND, mode, mmode);
 	write_hline_outlined(x, x + width, y + height, ENDCAP_ROUND, ENDCAP_ROUND, mode, mmode);
 	write_vline_outlined(x, y, y + height, ENDCAP_ROUND, ENDCAP_ROUND, mode, mmode);
@@ -702,6 +872,7 @@ void write_rectangle_outlined(int x, int y, int width, int height, int mode, int
 void write_circle(uint8_t *buff, int cx, int cy, int r, int dashp, int mode)
 {
 	CHECK_COORDS(cx, cy);
+	mark_dirty(cx - r, cy - r, cx + r, cy + r);
 	int error = -r, x = r, y = 0;
 	while (x >= y) {
 		if (dashp == 0 || (y % dashp) < (dashp / 2)) {
@@ -733,6 +904,7 @@ void write_circle_outlined(int cx, int cy, int r, int dashp, int bmode, int mode
 
 	CHECK_COORDS(cx, cy);
 	SETUP_STROKE_FILL(stroke, fill, mode);
+	mark_dirty(cx - r - 2, cy - r - 2, cx + r + 2, cy + r + 2);
 	// This is a two step procedure. First, we draw the outline of the
 	// circle, then we draw the inner part.
 	int error = -r, x = r, y = 0;
@@ -789,6 +961,7 @@ void write_circle_outlined(int cx, int cy, int r, int dashp, int bmode, int mode
 void write_circle_filled(uint8_t *buff, int cx, int cy, int r, int mode)
 {
 	CHECK_COORDS(cx, cy);
+	mark_dirty(cx - r, cy - r, cx + r, cy + r);
 	int error = -r, x = r, y = 0, xch = 0;
 	// It turns out that filled circles can take advantage of the midpoint
 	// circle algorithm. We simply draw very fast horizontal lines across each
@@ -922,6 +1095,7 @@ void write_line(int x0, int y0, int x1, int y1, uint8_t value)
  */
 void write_line_lm(int x0, int y0, int x1, int y1, int mmode, int lmode)
 {
+	mark_dirty(x0, y0, x1, y1);
 #if defined(PIOS_VIDEO_SPLITBUFFER)
 	write_line(draw_buffer_mask, x0, y0, x1, y1, mmode);
 	write_line(draw_buffer_level, x0, y0, x1, y1, lmode);
@@ -958,6 +1132,7 @@ void write_line_outlined(int x0, int y0, int x1, int y1,
 		omode = 1;
 		imode = 0;
 	}
+	mark_dirty(MIN(x0, x1) - 1, MIN(y0, y1) - 1, MAX(x0, x1) + 1, MAX(y0, y1) + 1);
 	int steep = abs(y1 - y0) > abs(x1 - x0);
 	if (steep) {
 		SWAP(x0, y0);
@@ -981,15 +1156,15 @@ void write_line_outlined(int x0, int y0, int x1, int y1,
 	// Draw the outline.
 	for (x = x0; x < x1; x++) {
 		if (steep) {
-			write_pixel_lm(y - 1, x, mmode, omode);
-			write_pixel_lm(y + 1, x, mmode, omode);
-			write_pixel_lm(y, x - 1, mmode, omode);
-			write_pixel_lm(y, x + 1, mmode, omode);
+			pixel_lm(y - 1, x, mmode, omode);
+			pixel_lm(y + 1, x, mmode, omode);
+			pixel_lm(y, x - 1, mmode, omode);
+			pixel_lm(y, x + 1, mmode, omode);
 		} else {
-			write_pixel_lm(x - 1, y, mmode, omode);
-			write_pixel_lm(x + 1, y, mmode, omode);
-			write_pixel_lm(x, y - 1, mmode, omode);
-			write_pixel_lm(x, y + 1, mmode, omode);
+			pixel_lm(x - 1, y, mmode, omode);
+			pixel_lm(x + 1, y, mmode, omode);
+			pixel_lm(x, y - 1, mmode, omode);
+			pixel_lm(x, y + 1, mmode, omode);
 		}
 		error -= deltay;
 		if (error < 0) {
@@ -1002,9 +1177,9 @@ void write_line_outlined(int x0, int y0, int x1, int y1,
 	y     = y0;
 	for (x = x0; x < x1; x++) {
 		if (steep) {
-			write_pixel_lm(y, x, mmode, imode);
+			pixel_lm(y, x, mmode, imode);
 		} else {
-			write_pixel_lm(x, y, mmode, imode);
+			pixel_lm(x, y, mmode, imode);
 		}
 		error -= deltay;
 		if (error < 0) {
@@ -1042,6 +1217,7 @@ void write_line_outlined_dashed(int x0, int y0, int x1, int y1,
 		omode = 1;
 		imode = 0;
 	}
+	mark_dirty(MIN(x0, x1) - 1, MIN(y0, y1) - 1, MAX(x0, x1) + 1, MAX(y0, y1) + 1);
 	int steep = abs(y1 - y0) > abs(x1 - x0);
 	if (steep) {
 		SWAP(x0, y0);
@@ -1071,15 +1247,15 @@ void write_line_outlined_dashed(int x0, int y0, int x1, int y1,
 		}
 		if (draw % 2) {
 			if (steep) {
-				write_pixel_lm(y - 1, x, mmode, omode);
-				write_pixel_lm(y + 1, x, mmode, omode);
-				write_pixel_lm(y, x - 1, mmode, omode);
-				write_pixel_lm(y, x + 1, mmode, omode);
+				pixel_lm(y - 1, x, mmode, omode);
+				pixel_lm(y + 1, x, mmode, omode);
+				pixel_lm(y, x - 1, mmode, omode);
+				pixel_lm(y, x + 1, mmode, omode);
 			} else {
-				write_pixel_lm(x - 1, y, mmode, omode);
-				write_pixel_lm(x + 1, y, mmode, omode);
-				write_pixel_lm(x, y - 1, mmode, omode);
-				write_pixel_lm(x, y + 1, mmode, omode);
+				pixel_lm(x - 1, y, mmode, omode);
+				pixel_lm(x + 1, y, mmode, omode);
+				pixel_lm(x, y - 1, mmode, omode);
+				pixel_lm(x, y + 1, mmode, omode);
 			}
 		}
 		error -= deltay;
@@ -1099,9 +1275,9 @@ void write_line_outlined_dashed(int x0, int y0, int x1, int y1,
 		}
 		if (draw % 2) {
 			if (steep) {
-				write_pixel_lm(y, x, mmode, imode);
+				pixel_lm(y, x, mmode, imode);
 			} else {
-				write_pixel_lm(x, y, mmode, imode);
+				pixel_lm(x, y, mmode, imode);
 			}
 		}
 		error -= deltay;
@@ -1196,6 +1372,54 @@ void write_word_misaligned_MASKED(uint8_t *buff, uint16_t word, uint16_t mask, u
 }
 
 
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+/**
+ * blit_glyph_row: draw one row of a glyph on both draw buffers in a single
+ * pass. This is what ORing the glyph into both buffers and then NANDing
+ * its dark pixels out of the level buffer does, a byte at a time.
+ *
+ * @param       addr    address of the first byte
+ * @param       mask    pixels of the glyph, from the MSB
+ * @param       dark    pixels of the glyph to clear in the level buffer
+ * @param       xoff    x offset within the first byte (0-7)
+ */
+static inline void blit_glyph_row(int addr, uint16_t mask, uint16_t dark, int xoff)
+{
+	uint32_t m = ((uint32_t)mask << 8) >> xoff;
+	uint32_t d = ((uint32_t)dark << 8) >> xoff;
+	uint8_t *pm = draw_buffer_mask + addr;
+	uint8_t *pl = draw_buffer_level + addr;
+
+	pm[0] |= m >> 16;
+	pm[1] |= m >> 8;
+	pm[2] |= m;
+	pl[0] = (pl[0] | (m >> 16)) & ~(d >> 16);
+	pl[1] = (pl[1] | (m >> 8)) & ~(d >> 8);
+	pl[2] = (pl[2] | m) & ~d;
+}
+#else
+/**
+ * blit_glyph_row: draw 8 pixels of a row of a glyph on the draw buffer,
+ * replacing the pixels under the glyph. This is what the masked misaligned
+ * word write does, without the separate shifts for each byte.
+ *
+ * @param       addr    address of the first byte
+ * @param       data    pixels of the glyph, from the MSB
+ * @param       xoff    x offset within the first byte (0, 2, 4 or 6)
+ */
+static inline void blit_glyph_row(int addr, uint16_t data, int xoff)
+{
+	uint16_t mask = data | (data << 1);
+	uint32_t d = ((uint32_t)data << 8) >> xoff;
+	uint32_t m = ((uint32_t)mask << 8) >> xoff;
+	uint8_t *p = draw_buffer + addr;
+
+	p[0] = (p[0] & ~(m >> 16)) | ((d & m) >> 16);
+	p[1] = (p[1] & ~(m >> 8)) | ((d & m) >> 8);
+	p[2] = (p[2] & ~m) | (d & m);
+}
+#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+
 /**
  * write_char: Draw a character on the current draw buffer.
  *
@@ -1207,13 +1431,7 @@ void write_word_misaligned_MASKED(uint8_t *buff, uint16_t word, uint16_t mask, u
 void write_char(uint8_t ch, int x, int y, const struct FontEntry *font_info)
 {
 	int yy, row;
-#if defined(PIOS_VIDEO_SPLITBUFFER)
-	uint16_t levels;
-#else
-	uint16_t data16;
-#endif
 
-	uint16_t mask;
 	ch = font_info->lookup[ch];
 	if (ch == 255)
 		return;
@@ -1225,60 +1443,39 @@ void write_char(uint8_t ch, int x, int y, const struct FontEntry *font_info)
 		return;
 	}
 
+	// Rows are written as up to 24 pixels from the byte containing x
+	mark_dirty(x, y, x + 23, y + font_info->height - 1);
+
 	// Compute starting address of character
 	int addr = CALC_BUFF_ADDR(x, y);
 	int wbit = CALC_BIT_IN_WORD(x);
 	row = ch * font_info->height;
 
-	if (font_info->width > 8) {
-		uint32_t data;
-		for (yy = y; yy < y + font_info->height; yy++) {
-			if (!partly_out || ((x >= GRAPHICS_LEFT) && (x + font_info->width <= GRAPHICS_RIGHT) && (yy >= GRAPHICS_TOP) && (yy <= GRAPHICS_BOTTOM))) {
-				data = ((uint32_t*)font_info->data)[row];
+	for (yy = y; yy < y + font_info->height; yy++) {
+		if (!partly_out || ((x >= GRAPHICS_LEFT) && (x + font_info->width <= GRAPHICS_RIGHT) && (yy >= GRAPHICS_TOP) && (yy <= GRAPHICS_BOTTOM))) {
+			if (font_info->width > 8) {
+				uint32_t data = ((uint32_t*)font_info->data)[row];
 #if defined(PIOS_VIDEO_SPLITBUFFER)
-				mask = data & 0xFFFF;
-				levels   = (data >> 16) & 0xFFFF;
-				// mask
-				write_word_misaligned_OR(draw_buffer_mask, mask, addr, wbit);
-				// level
-				write_word_misaligned_OR(draw_buffer_level, mask, addr, wbit);
-				mask = (mask & levels);
-				write_word_misaligned_NAND(draw_buffer_level, mask, addr, wbit);
+				uint16_t mask = data & 0xFFFF;
+				uint16_t levels = (data >> 16) & 0xFFFF;
+				blit_glyph_row(addr, mask, mask & levels, wbit);
 #else
-				data16 = (data & 0xFFFF0000) >> 16;
-				mask = data16 | (data16 << 1);
-				write_word_misaligned_MASKED(draw_buffer, data16, mask, addr, wbit);
-				data16 = (data & 0x0000FFFF);
-				mask = data16 | (data16 << 1);
-				write_word_misaligned_MASKED(draw_buffer, data16, mask, addr + 2, wbit);
+				blit_glyph_row(addr, data >> 16, wbit);
+				blit_glyph_row(addr + 2, data & 0xFFFF, wbit);
 #endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
-			}
-			addr += BUFFER_WIDTH;
-			row++;
-		}
-	}
-	else {
-		uint16_t data;
-		for (yy = y; yy < y + font_info->height; yy++) {
-			if (!partly_out || ((x >= GRAPHICS_LEFT) && (x + font_info->width <= GRAPHICS_RIGHT) && (yy >= GRAPHICS_TOP) && (yy <= GRAPHICS_BOTTOM))) {
-				data = font_info->data[row];
+			} else {
+				uint16_t data = font_info->data[row];
 #if defined(PIOS_VIDEO_SPLITBUFFER)
-				levels = data & 0xFF00;
-				mask = (data & 0x00FF) << 8;
-				// mask
-				write_word_misaligned_OR(draw_buffer_mask, mask, addr, wbit);
-				// level
-				write_word_misaligned_OR(draw_buffer_level, mask, addr, wbit);
-				mask = (mask & levels);
-				write_word_misaligned_NAND(draw_buffer_level, mask, addr, wbit);
+				uint16_t levels = data & 0xFF00;
+				uint16_t mask = (data & 0x00FF) << 8;
+				blit_glyph_row(addr, mask, mask & levels, wbit);
 #else
-				mask = data | (data << 1);
-				write_word_misaligned_MASKED(draw_buffer, data, mask, addr, wbit);
+				blit_glyph_row(addr, data, wbit);
 #endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
 			}
-			addr += BUFFER_WIDTH;
-			row++;
 		}
+		addr += BUFFER_WIDTH;
+		row++;
 	}
 }
 
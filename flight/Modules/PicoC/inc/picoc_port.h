@@ -63,6 +63,23 @@ size_t PlatformHeapSize();
 void PlatformDebug(const char *format, ...);
 int picoc(const char *source, size_t stack_size);
 
+/* pre-tokenised scripts */
+#define PICOC_IMAGE_MAGIC	0x50434931	/* "PCI1" */
+
+struct picoc_image {
+	uint32_t magic;
+	uint8_t ptr_size;	/* sizeof(char *), tokens depend on it */
+	uint8_t long_size;	/* sizeof(long), tokens depend on it */
+	uint16_t reserved;
+	uint32_t source_len;	/* length of the source it was made from */
+	uint32_t token_len;	/* token bytes that follow this header */
+	uint32_t pool_len;	/* string pool bytes that follow the tokens */
+};
+
+int32_t picoc_compile(const char *source, size_t stack_size, void *image, size_t image_size);
+bool picoc_image_valid(const void *image, size_t image_size, const char *source);
+int picoc_run(const void *image, const char *source, size_t stack_size);
+
 /* get all picoc definitions */
 #include "picoc.h"
 
@@ -73,12 +73,16 @@ static uintptr_t picocPort;
 static bool module_enabled;
 static char *sourcebuffer;
 static uint32_t sourcebuffer_size;
+static void *image;		/* tokenised source, kept behind it in sourcebuffer */
+static uint32_t image_size;
 static PicoCSettingsData picocsettings;
 static PicoCStatusData picocstatus;
 
 // Private functions
 static void picocTask(void *parameters);
 static void updateSettings();
+static void compile_source();
+static int run_source();
 int32_t usart_cmd(char *buffer, uint32_t buffer_size);
 int32_t get_sector(uint16_t sector, char *buffer, uint32_t buffer_size);
 int32_t set_sector(uint16_t sector, char *buffer, uint32_t buffer_size);
@@ -174,6 +178,7 @@ static void picocTask(void *parameters) {
 	PicoCSettingsGet(&picocsettings);
 	picocstatus.CommandError = load_file(picocsettings.BootFileID, sourcebuffer, sourcebuffer_size);
 	PicoCStatusCommandErrorSet(&picocstatus.CommandError);
+	compile_source();
 
 	while (1) {
 		PicoCSettingsGet(&picocsettings);
@@ -187,7 +192,7 @@ static void picocTask(void *parameters) {
 				// external start request
 				picocstatus.ExitValue = 0;
 				PicoCStatusExitValueSet(&picocstatus.ExitValue);
-				picocstatus.ExitValue = picoc(sourcebuffer, picocsettings.PicoCStackSize);
+				picocstatus.ExitValue = run_source();
 				PicoCStatusExitValueSet(&picocstatus.ExitValue);
 				picocstatus.CommandError = 0;
 				picocstatus.Command = PICOCSTATUS_COMMAND_IDLE;
@@ -195,6 +200,7 @@ static void picocTask(void *parameters) {
 				break;
 			case PICOCSTATUS_COMMAND_USARTMODE:
 				// handle commands via USART
+				image = NULL;
 				picocstatus.CommandError = usart_cmd(sourcebuffer, sourcebuffer_size);
 				if (picocstatus.CommandError) {
 					picocstatus.Command = PICOCSTATUS_COMMAND_IDLE;
@@ -208,12 +214,14 @@ static void picocTask(void *parameters) {
 				break;
 			case PICOCSTATUS_COMMAND_SETSECTOR:
 				// fill buffer from uavo to selected sector
+				image = NULL;
 				picocstatus.CommandError = set_sector(picocstatus.SectorID, sourcebuffer, sourcebuffer_size);
 				picocstatus.Command = PICOCSTATUS_COMMAND_IDLE;
 				break;
 			case PICOCSTATUS_COMMAND_LOADFILE:
 				// fill buffer from flash file
 				picocstatus.CommandError = load_file(picocstatus.FileID, sourcebuffer, sourcebuffer_size);
+				compile_source();
 				picocstatus.Command = PICOCSTATUS_COMMAND_IDLE;
 				break;
 			case PICOCSTATUS_COMMAND_SAVEFILE:
@@ -275,10 +283,8 @@ static void picocTask(void *parameters) {
 				picocstatus.ExitValue = picoc(NULL, picocsettings.PicoCStackSize);
 				break;
 			case PICOCSETTINGS_SOURCE_FILE:
-				// terminate source for security.
-				sourcebuffer[sourcebuffer_size - 1] = 0;
 				// start picoc in file mode.
-				picocstatus.ExitValue = picoc(sourcebuffer, picocsettings.PicoCStackSize);
+				picocstatus.ExitValue = run_source();
 				started = true;
 				break;
 			default:
@@ -305,6 +311,50 @@ static void updateSettings()
 	}
 }
 
+/**
+ * tokenise the source buffer once, so starting it does not lex it again.
+ * the tokens are kept in the free space behind the source. if they do not
+ * fit or the source does not lex, it is run from source as before.
+ */
+static void compile_source()
+{
+	// terminate source for security.
+	sourcebuffer[sourcebuffer_size - 1] = 0;
+
+	uint32_t offset = (strlen(sourcebuffer) + 1 + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+
+	image = NULL;
+	if (offset >= sourcebuffer_size) {
+		return;
+	}
+
+	int32_t len = picoc_compile(sourcebuffer, picocsettings.PicoCStackSize,
+			&sourcebuffer[offset], sourcebuffer_size - offset);
+	if (len > 0) {
+		image = &sourcebuffer[offset];
+		image_size = len;
+	}
+}
+
+/**
+ * run the source buffer, from its tokens if possible
+ * returns the exit() value
+ */
+static int run_source()
+{
+	if (image == NULL) {
+		compile_source();
+	}
+
+	if (picoc_image_valid(image, image_size, sourcebuffer)) {
+		return picoc_run(image, sourcebuffer, picocsettings.PicoCStackSize);
+	}
+
+	// terminate source for security.
+	sourcebuffer[sourcebuffer_size - 1] = 0;
+	return picoc(sourcebuffer, picocsettings.PicoCStackSize);
+}
+
 /**
  * usart command
  */
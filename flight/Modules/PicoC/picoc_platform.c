@@ -91,6 +91,188 @@ int picoc(const char * source, size_t stack_size)
 	return pc.PicocExitValue;
 }
 
+/**
+ * add a string to the string pool of an image, once
+ * returns its offset in the pool or -1 if the pool is full
+ */
+static int32_t image_pool_add(char *pool, uint32_t *pool_len, size_t pool_size, const char *str)
+{
+	uint32_t offset;
+	size_t len = strlen(str) + 1;
+
+	for (offset = 0; offset < *pool_len; offset += strlen(&pool[offset]) + 1)
+	{
+		if (strcmp(&pool[offset], str) == 0)
+			return offset;
+	}
+
+	if (*pool_len + len > pool_size)
+		return -1;
+
+	memcpy(&pool[offset], str, len);
+	*pool_len += len;
+	return offset;
+}
+
+/**
+ * tokenise a script once, so it can be run again and again without lexing
+ * it. the tokens are those of LexAnalyse(), except that identifiers and
+ * string constants refer to a string pool in the image instead of to the
+ * string table of the instance that lexed them.
+ * returns the image length, -1 if the script does not lex or -2 if the
+ * image does not fit
+ */
+int32_t picoc_compile(const char *source, size_t stack_size, void *image, size_t image_size)
+{
+	struct picoc_image *header = (struct picoc_image *)image;
+	unsigned char *tokens = (unsigned char *)(header + 1);
+	unsigned char *pos;
+	void *lexed;
+	int token_len;
+	char *pool;
+	uint32_t pool_len = 0;
+	Picoc pc;
+
+	if (image_size < sizeof(*header))
+		return -2;
+
+	PicocInitialise(&pc, stack_size);
+
+	if (PicocPlatformSetExitPoint(&pc))
+	{	/* we get here, if the script does not lex */
+		PicocCleanup(&pc);
+		return -1;
+	}
+
+	lexed = LexAnalyse(&pc, TableStrRegister(&pc, "nofile"), source, strlen(source), &token_len);
+
+	if (sizeof(*header) + token_len > image_size)
+	{
+		PicocCleanup(&pc);
+		return -2;
+	}
+
+	memcpy(tokens, lexed, token_len);
+	pool = (char *)tokens + token_len;
+
+	/* replace the string pointers by pool offsets of the same size */
+	for (pos = tokens; *pos != TokenEOF; pos += TOKEN_DATA_OFFSET + LexTokenSize(*pos))
+	{
+		char *str;
+		uintptr_t offset;
+		int32_t pool_offset;
+
+		if (*pos != TokenIdentifier && *pos != TokenStringConstant)
+			continue;
+
+		memcpy(&str, pos + TOKEN_DATA_OFFSET, sizeof(str));
+		pool_offset = image_pool_add(pool, &pool_len, image_size - sizeof(*header) - token_len, str);
+		if (pool_offset < 0)
+		{
+			PicocCleanup(&pc);
+			return -2;
+		}
+
+		offset = pool_offset;
+		memcpy(pos + TOKEN_DATA_OFFSET, &offset, sizeof(offset));
+	}
+
+	PicocCleanup(&pc);
+
+	header->magic = PICOC_IMAGE_MAGIC;
+	header->ptr_size = sizeof(char *);
+	header->long_size = sizeof(long);
+	header->reserved = 0;
+	header->source_len = strlen(source);
+	header->token_len = token_len;
+	header->pool_len = pool_len;
+
+	return sizeof(*header) + token_len + pool_len;
+}
+
+/**
+ * check that an image was made from this source, on this platform
+ */
+bool picoc_image_valid(const void *image, size_t image_size, const char *source)
+{
+	const struct picoc_image *header = (const struct picoc_image *)image;
+
+	if (image == NULL || image_size < sizeof(*header))
+		return false;
+
+	return header->magic == PICOC_IMAGE_MAGIC &&
+		header->ptr_size == sizeof(char *) &&
+		header->long_size == sizeof(long) &&
+		header->source_len == strlen(source) &&
+		sizeof(*header) + header->token_len + header->pool_len <= image_size;
+}
+
+/**
+ * run a script tokenised by picoc_compile()
+ * the source is only used to show where errors are, it may be NULL
+ * returns the exit() value
+ */
+int picoc_run(const void *image, const char *source, size_t stack_size)
+{
+	const struct picoc_image *header = (const struct picoc_image *)image;
+	const char *pool = (const char *)(header + 1) + header->token_len;
+	struct ParseState Parser;
+	enum ParseResult Ok;
+	unsigned char *tokens;
+	unsigned char *pos;
+	Picoc pc;
+
+	PicocInitialise(&pc, stack_size);
+
+	if (PicocPlatformSetExitPoint(&pc))
+	{	/* we get here, if an error occures or 'exit();' was called. */
+		PicocCleanup(&pc);
+		return pc.PicocExitValue;
+	}
+
+	tokens = HeapAllocMem(&pc, header->token_len);
+	if (tokens == NULL)
+		ProgramFailNoParser(&pc, "out of memory");
+
+	memcpy(tokens, header + 1, header->token_len);
+
+	/* link the strings into the string table of this instance */
+	for (pos = tokens; *pos != TokenEOF; pos += TOKEN_DATA_OFFSET + LexTokenSize(*pos))
+	{
+		char *str;
+		uintptr_t offset;
+
+		if (*pos != TokenIdentifier && *pos != TokenStringConstant)
+			continue;
+
+		memcpy(&offset, pos + TOKEN_DATA_OFFSET, sizeof(offset));
+		str = TableStrRegister(&pc, &pool[offset]);
+
+		if (*pos == TokenStringConstant && VariableStringLiteralGet(&pc, str) == NULL)
+		{	/* as LexGetStringConstant() would have done */
+			struct Value *ArrayValue = VariableAllocValueAndData(&pc, NULL, 0, FALSE, NULL, TRUE);
+			ArrayValue->Typ = pc.CharArrayType;
+			ArrayValue->Val = (union AnyValue *)str;
+			VariableStringLiteralDefine(&pc, str, ArrayValue);
+		}
+
+		memcpy(pos + TOKEN_DATA_OFFSET, &str, sizeof(str));
+	}
+
+	LexInitParser(&Parser, &pc, source, tokens, TableStrRegister(&pc, "nofile"), TRUE, FALSE);
+
+	do {
+		Ok = ParseStatement(&Parser, TRUE);
+	} while (Ok == ParseResultOk);
+
+	if (Ok == ParseResultError)
+		ProgramFail(&Parser, "parse error");
+
+	HeapFreeMem(&pc, tokens);
+	PicocCleanup(&pc);
+	return pc.PicocExitValue;
+}
+
 /**
  * PicoC platform depending system functions
  * normaly stored in platform_xxx.c
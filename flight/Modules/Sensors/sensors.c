@@ -59,6 +59,14 @@ extern uintptr_t external_i2c_adapter_id;
 #include "magbias.h"
 #include "coordinate_conversions.h"
 
+#if !defined(SMALLF1)
+#define HITL_LOCKSTEP
+#include "actuatordesired.h"
+#include "hitlactuators.h"
+#include "hitlsensors.h"
+#include "hitl_lockstep.h"
+#endif /* !defined(SMALLF1) */
+
 // Private constants
 #define STACK_SIZE_BYTES 1000
 #define TASK_PRIORITY PIOS_THREAD_PRIO_HIGH
@@ -94,6 +102,9 @@ static void mag_calibration_prelemari(MagnetometerData *mag);
 static void mag_calibration_fix_length(MagnetometerData *mag);
 
 static void updateTemperatureComp(float temperature, float *temp_bias);
+#if defined(HITL_LOCKSTEP)
+static bool hitl_lockstep_step(void);
+#endif /* HITL_LOCKSTEP */
 
 // Private variables
 static struct pios_thread *sensorsTaskHandle;
@@ -123,6 +134,20 @@ static int8_t rotate = 0;
 //! Select the algorithm to try and null out the magnetometer bias error
 static enum mag_calibration_algo mag_calibration_algo = MAG_CALIBRATION_PRELEMARI;
 
+#if defined(HITL_LOCKSTEP)
+//! Lockstep HITL: updates of HitlSensors and ActuatorDesired
+static struct pios_queue *hitlSensorsQueue;
+static struct pios_queue *actuatorDesiredQueue;
+static struct hitl_lockstep_fc hitl_lockstep;
+static HitlActuatorsData hitl_answer;
+//! The clock the estimators and control loops run on
+static const struct hitl_lockstep_clock hitl_clock = {
+	.get_raw = PIOS_DELAY_GetRaw,
+	.diff_us = PIOS_DELAY_DiffuS,
+	.skip_us = PIOS_DELAY_SkipuS,
+};
+#endif /* HITL_LOCKSTEP */
+
 /**
  * API for sensor fusion algorithms:
  * Configure(struct pios_queue *gyro, struct pios_queue *accel, struct pios_queue *mag, struct pios_queue *baro)
@@ -187,6 +212,19 @@ int32_t SensorsInitialize(void)
 	}
 #endif /* PIOS_INCLUDE_RANGEFINDER */
 
+#if defined(HITL_LOCKSTEP)
+	if (HitlSensorsInitialize() == -1 || HitlActuatorsInitialize() == -1 ||
+			ActuatorDesiredInitialize() == -1) {
+		return -1;
+	}
+
+	hitlSensorsQueue = PIOS_Queue_Create(1, sizeof(UAVObjEvent));
+	actuatorDesiredQueue = PIOS_Queue_Create(1, sizeof(UAVObjEvent));
+	HitlSensorsConnectQueue(hitlSensorsQueue);
+	ActuatorDesiredConnectQueue(actuatorDesiredQueue);
+	hitl_lockstep_fc_reset(&hitl_lockstep);
+#endif /* HITL_LOCKSTEP */
+
 	rotate = 0;
 
 	AttitudeSettingsConnectCallback(&settingsUpdatedCb);
@@ -235,6 +273,13 @@ static void SensorsTask(void *parameters)
 	uint32_t last_baro_update_time = PIOS_DELAY_GetRaw();
 
 	while (1) {
+#if defined(HITL_LOCKSTEP)
+		if (hitl_lockstep_step()) {
+			lastSysTime = PIOS_Thread_Systime();
+			continue;
+		}
+#endif /* HITL_LOCKSTEP */
+
 		if (good_runs == 0) {
 			PIOS_WDG_UpdateFlag(PIOS_WDG_SENSORS);
 			lastSysTime = PIOS_Thread_Systime();
@@ -345,6 +390,92 @@ static void SensorsTask(void *parameters)
 	}
 }
 
+#if defined(HITL_LOCKSTEP)
+/**
+ * Run one step of lockstep hardware in the loop simulation, if the GCS is
+ * stepping.  The simulated sensors are published in place of the hardware
+ * ones, then the task waits for the control loop to act on them and answers
+ * with its output.  While steps keep coming the hardware sensors are not
+ * read at all.
+ * @return true if a step was handled, false to read the hardware sensors
+ */
+static bool hitl_lockstep_step(void)
+{
+	UAVObjEvent ev;
+	bool stepping = hitl_lockstep.last_step != 0;
+
+	if (PIOS_Queue_Receive(hitlSensorsQueue, &ev,
+			stepping ? HITL_LOCKSTEP_TIMEOUT_MS : 0) == false) {
+		if (stepping) {
+			// The simulator stopped, go back to the hardware
+			hitl_lockstep_fc_reset(&hitl_lockstep);
+			AlarmsSet(SYSTEMALARMS_ALARM_SENSORS, SYSTEMALARMS_ALARM_CRITICAL);
+		}
+		return false;
+	}
+
+	HitlSensorsData step;
+	HitlSensorsGet(&step);
+
+	switch (hitl_lockstep_fc_receive(&hitl_lockstep, step.Step)) {
+	case HITL_STEP_NEW:
+		break;
+	case HITL_STEP_REPEAT:
+		// Our answer was lost; the control loop already ran on this step
+		HitlActuatorsSet(&hitl_answer);
+		return true;
+	case HITL_STEP_STALE:
+		return hitl_lockstep.last_step != 0;
+	}
+
+	// Forget control loop updates that belong to an earlier step
+	while (PIOS_Queue_Receive(actuatorDesiredQueue, &ev, 0));
+
+	// Run the estimators and control loops on simulated time: the step
+	// is published DeltaTime after the last one on the PIOS_DELAY clock
+	hitl_lockstep_fc_advance(&hitl_lockstep, &hitl_clock, step.DeltaTime);
+
+	accelsData.x = step.Accel[HITLSENSORS_ACCEL_X];
+	accelsData.y = step.Accel[HITLSENSORS_ACCEL_Y];
+	accelsData.z = step.Accel[HITLSENSORS_ACCEL_Z];
+	AccelsSet(&accelsData);
+
+	// The rest of the code expects the accels to be available first
+	GyrosData gyrosData;
+	GyrosGet(&gyrosData);
+	gyrosData.x = step.Gyro[HITLSENSORS_GYRO_X];
+	gyrosData.y = step.Gyro[HITLSENSORS_GYRO_Y];
+	gyrosData.z = step.Gyro[HITLSENSORS_GYRO_Z];
+	GyrosSet(&gyrosData);
+
+	if (!IS_NOT_FINITE(step.BaroAltitude)) {
+		BaroAltitudeData baroAltitude;
+		BaroAltitudeGet(&baroAltitude);
+		baroAltitude.Altitude = step.BaroAltitude;
+		BaroAltitudeSet(&baroAltitude);
+	}
+
+	AlarmsClear(SYSTEMALARMS_ALARM_SENSORS);
+	PIOS_WDG_UpdateFlag(PIOS_WDG_SENSORS);
+
+	// Answer once the control loop has run on this step.  Without a
+	// stabilization output (e.g. disarmed) answer with the last one.
+	PIOS_Queue_Receive(actuatorDesiredQueue, &ev, SENSOR_PERIOD);
+
+	ActuatorDesiredData actuatorDesired;
+	ActuatorDesiredGet(&actuatorDesired);
+
+	hitl_answer.Step = step.Step;
+	hitl_answer.Roll = actuatorDesired.Roll;
+	hitl_answer.Pitch = actuatorDesired.Pitch;
+	hitl_answer.Yaw = actuatorDesired.Yaw;
+	hitl_answer.Thrust = actuatorDesired.Thrust;
+	HitlActuatorsSet(&hitl_answer);
+
+	return true;
+}
+#endif /* HITL_LOCKSTEP */
+
 /**
  * @brief Apply calibration and rotation to the raw accel data
  * @param[in] accels The raw accel data
@@ -38,6 +38,7 @@
 #include "pios_thread.h"
 #include "pios_mutex.h"
 #include "pios_queue.h"
+#include "pios_trace.h"
 #include "misc_math.h"
 #include "morsel.h"
 
@@ -50,6 +51,7 @@
 #include "stateestimation.h"
 #include "systemsettings.h"
 #include "systemstats.h"
+#include "tracebuffer.h"
 #include "watchdogstatus.h"
 
 #if defined(PIOS_INCLUDE_DEBUG_CONSOLE) && defined(DEBUG_THIS_FILE)
@@ -77,6 +79,14 @@
  * bad beat frequencies. */
 #define SYSTEM_UPDATE_PERIOD_MS 113
 
+/* Empties the trace ring into TraceBuffer, 20 records per update, each
+ * period.  The 512 record ring then holds about 25000 records/s; beyond that,
+ * or if a flood of new records outruns the drain, they are dropped and
+ * counted, not queued.  TRACE_DRAIN_MAX_UPDATES bounds the time spent in one
+ * pass, since each update itself adds callback and queue records. */
+#define TRACE_DRAIN_PERIOD_MS 20
+#define TRACE_DRAIN_MAX_UPDATES 32
+
 // Private types
 
 /**
@@ -115,6 +125,9 @@ static volatile bool config_check_needed;
 
 // Private functions
 static void systemPeriodicCb(UAVObjEvent *ev, void *ctx, void *obj_data, int len);
+#if defined(PIOS_INCLUDE_TRACE)
+static void traceDrainCb(UAVObjEvent *ev, void *ctx, void *obj_data, int len);
+#endif
 static void objectUpdatedCb(UAVObjEvent * ev, void *ctx, void *obj, int len);
 static uint32_t processPeriodicUpdates();
 static int32_t eventPeriodicCreate(UAVObjEvent* ev, UAVObjEventCallback cb, struct pios_queue *queue, uint16_t periodMs);
@@ -143,6 +156,10 @@ int32_t SystemModStart(void)
 	memset(&ev, 0, sizeof(UAVObjEvent));
 	EventPeriodicCallbackCreate(&ev, systemPeriodicCb, SYSTEM_UPDATE_PERIOD_MS);
 
+#if defined(PIOS_INCLUDE_TRACE)
+	EventPeriodicCallbackCreate(&ev, traceDrainCb, TRACE_DRAIN_PERIOD_MS);
+#endif
+
 	EventClearStats();
 
 	// Create system task
@@ -180,6 +197,10 @@ int32_t SystemModInitialize(void)
 	if (WatchdogStatusInitialize() == -1)
 		return -1;
 #endif
+#if defined(PIOS_INCLUDE_TRACE)
+	if (TraceBufferInitialize() == -1)
+		return -1;
+#endif
 
 	objectPersistenceQueue = PIOS_Queue_Create(1, sizeof(UAVObjEvent));
 	if (objectPersistenceQueue == NULL)
@@ -371,6 +392,47 @@ static inline void consider_annunc(AnnunciatorSettingsData *annunciatorSettings,
 }
 #endif
 
+#if defined(PIOS_INCLUDE_TRACE)
+/**
+ * Empty the trace ring into TraceBuffer, and describe the threads
+ * and the timer about once a second so the host can decode them.
+ */
+static void traceDrainCb(UAVObjEvent *ev, void *ctx, void *obj_data, int len) {
+	(void) ev; (void) ctx; (void) obj_data; (void) len;
+
+	static unsigned int counter = 0;
+	static uint16_t sequence = 0;
+
+	if ((counter++ % (1000 / TRACE_DRAIN_PERIOD_MS)) == 0) {
+		PIOS_TRACE_Threads();
+		PIOS_TRACE_Sync();
+	}
+
+	struct pios_trace_record records[TRACEBUFFER_DATA_NUMELEM /
+		sizeof(struct pios_trace_record)];
+
+	/* The logger is a synchronous callback on TraceBuffer, so every update
+	 * made here reaches the log; telemetry sends a throttled sample. */
+	for (int i = 0; i < TRACE_DRAIN_MAX_UPDATES; i++) {
+		int n = PIOS_TRACE_Read(records, NELEMENTS(records));
+		if (n == 0)
+			break;
+
+		TraceBufferData trace;
+		trace.Sequence = sequence++;
+		trace.Count = n;
+		memcpy(trace.Data, records, n * sizeof(struct pios_trace_record));
+		memset(trace.Data + n * sizeof(struct pios_trace_record), 0,
+			sizeof(trace.Data) - n * sizeof(struct pios_trace_record));
+
+		TraceBufferSet(&trace);
+
+		if (n < (int) NELEMENTS(records))
+			break;
+	}
+}
+#endif /* PIOS_INCLUDE_TRACE */
+
 static void systemPeriodicCb(UAVObjEvent *ev, void *ctx, void *obj_data, int len) {
 	(void) ev; (void) ctx; (void) obj_data; (void) len;
 
@@ -38,6 +38,7 @@
 #include "gcstelemetrystats.h"
 #include "modulesettings.h"
 #include "sessionmanaging.h"
+#include "settingssnapshot.h"
 #include "pios_thread.h"
 #include "pios_queue.h"
 
@@ -64,6 +65,14 @@ static uint32_t txRetries;
 static uint32_t timeOfLastObjectUpdate;
 static UAVTalkConnection uavTalkCon;
 
+// Set when the GCS requests a snapshot, until the transmit task sends it
+static volatile bool snapshotRequested;
+
+// State of the settings snapshot being sent, for the UAVObjIterate callbacks
+static uint32_t snapshotHash;
+static uint16_t snapshotCount;
+static bool snapshotUnchanged;
+
 #if defined(PIOS_INCLUDE_USB)
 static volatile uint32_t usb_timeout_time;
 #endif
@@ -83,6 +92,9 @@ static uintptr_t getComPort();
 static void session_managing_updated(UAVObjEvent * ev, void *ctx, void *obj,
 		int len);
 static void update_object_instances(uint32_t obj_id, uint32_t inst_id);
+static void settings_snapshot_updated(UAVObjEvent * ev, void *ctx, void *obj,
+		int len);
+static void sendSettingsSnapshot();
 
 /**
  * Initialise the telemetry module
@@ -139,6 +151,12 @@ int32_t TelemetryInitialize(void)
 	
 	SessionManagingConnectCallback(session_managing_updated);
 
+	if (SettingsSnapshotInitialize() == -1) {
+		return -1;
+	}
+
+	SettingsSnapshotConnectCallback(settings_snapshot_updated);
+
 	//register the new uavo instance callback function in the uavobjectmanager
 	UAVObjRegisterNewInstanceCB(update_object_instances);
 
@@ -253,6 +271,8 @@ static void processObjEvent(UAVObjEvent * ev)
 		updateTelemetryStats();
 	} else if (ev->obj == GCSTelemetryStatsHandle()) {
 		gcsTelemetryStatsUpdated();
+	} else if (ev->obj == SettingsSnapshotHandle() && ev->event == EV_UNPACKED) {
+		// Only wakes the task; the request is sent from telemetryTxTask()
 	} else {
 		FlightTelemetryStatsGet(&flightStats);
 		// Get object metadata
@@ -300,6 +320,12 @@ static void telemetryTxTask(void *parameters)
 			// Process event
 			processObjEvent(&ev);
 		}
+
+		// Send a snapshot the GCS requested, even if its event was dropped
+		if (snapshotRequested) {
+			snapshotRequested = false;
+			sendSettingsSnapshot();
+		}
 	}
 }
 
@@ -587,6 +613,170 @@ static void session_managing_updated(UAVObjEvent * ev, void *ctx, void *obj, int
 	}
 }
 
+/**
+ * SettingsSnapshot object updated callback.  The snapshot is sent from the
+ * transmit task, as it waits on the port until every object has been queued.
+ * The event only wakes the task if it is idle; it may be dropped when the
+ * queue is full, and the task still finds the flag after its next event.
+ */
+static void settings_snapshot_updated(UAVObjEvent * ev, void *ctx, void *obj, int len)
+{
+	(void) ctx; (void) obj; (void) len;
+	if (ev->event == EV_UNPACKED) {
+		uint8_t status;
+		SettingsSnapshotStatusGet(&status);
+
+		if (status == SETTINGSSNAPSHOT_STATUS_REQUEST) {
+			snapshotRequested = true;
+
+			UAVObjEvent snapshotEv = {
+				.obj    = SettingsSnapshotHandle(),
+				.instId = 0,
+				.event  = EV_UNPACKED,
+			};
+
+			PIOS_Queue_Send(queue, &snapshotEv, 0);
+		}
+	}
+}
+
+/**
+ * Whether an object is part of the settings snapshot, and if so whether it
+ * is covered by the hash.  Metadata and settings are hashed; data objects
+ * that are only sent on change are included, as the GCS would otherwise
+ * request them one at a time, but not hashed.  The objects that negotiate
+ * the connection are left out, as the GCS does not retrieve them.
+ * \param[in] obj The object
+ * \param[out] hashed True if the object is covered by the hash
+ * \return true if the object is sent with the snapshot
+ */
+static bool inSettingsSnapshot(UAVObjHandle obj, bool *hashed)
+{
+	UAVObjHandle data = UAVObjIsMetaobject(obj) ? UAVObjGetLinkedObj(obj) : obj;
+
+	if (data == SessionManagingHandle() || data == SettingsSnapshotHandle()) {
+		return false;
+	}
+
+	*hashed = UAVObjIsMetaobject(obj) || UAVObjIsSettings(obj);
+	if (*hashed) {
+		return true;
+	}
+
+	UAVObjMetadata metadata;
+	UAVObjGetMetadata(obj, &metadata);
+
+	return UAVObjGetTelemetryUpdateMode(&metadata) == UPDATEMODE_ONCHANGE;
+}
+
+/**
+ * Add every instance of an object to the snapshot hash.  Each instance is
+ * hashed separately, with its object and instance IDs, and the results
+ * combined so that the order objects are registered in does not matter.
+ */
+static void hashSnapshotObject(UAVObjHandle obj)
+{
+	bool hashed;
+
+	if (!inSettingsSnapshot(obj, &hashed) || !hashed) {
+		return;
+	}
+
+	uint32_t objId = UAVObjGetID(obj);
+	uint32_t numBytes = UAVObjGetNumBytes(obj);
+	uint16_t numInstances = UAVObjIsMetaobject(obj) ? 1 : UAVObjGetNumInstances(obj);
+
+	for (uint16_t instId = 0; instId < numInstances; instId++) {
+		uint8_t chunk[16] = {
+			objId, objId >> 8, objId >> 16, objId >> 24,
+			instId, instId >> 8,
+		};
+		uint32_t crc = PIOS_CRC32_updateCRC(0, chunk, 6);
+
+		for (uint32_t offset = 0; offset < numBytes; offset += sizeof(chunk)) {
+			uint32_t len = numBytes - offset;
+			if (len > sizeof(chunk)) {
+				len = sizeof(chunk);
+			}
+
+			UAVObjGetInstanceDataField(obj, instId, chunk, offset, len);
+			crc = PIOS_CRC32_updateCRC(crc, chunk, len);
+		}
+
+		snapshotHash ^= crc;
+	}
+}
+
+/**
+ * Send every instance of an object that is part of the snapshot, unacked so
+ * that the objects follow each other without waiting on the link
+ */
+static void sendSnapshotObject(UAVObjHandle obj)
+{
+	bool hashed;
+
+	if (!inSettingsSnapshot(obj, &hashed) || (hashed && snapshotUnchanged)) {
+		return;
+	}
+
+	uint16_t numInstances = UAVObjIsMetaobject(obj) ? 1 : UAVObjGetNumInstances(obj);
+
+	for (uint16_t instId = 0; instId < numInstances; instId++) {
+		if (UAVTalkSendObject(uavTalkCon, obj, instId, false, 0) == 0) {
+			snapshotCount++;
+		} else {
+			++txErrors;
+		}
+	}
+}
+
+/**
+ * Send the settings snapshot requested by the GCS.  If the hash of the
+ * settings and metadata matches the one the GCS holds they are not sent
+ * again.  The SettingsSnapshot object is then updated with what was sent,
+ * which tells the GCS the snapshot is complete.
+ *
+ * Only the hash is taken under UAVObjIterate().  The objects are sent one
+ * at a time outside of it, as that holds the object lock, and every other
+ * task would wait on it for as long as the link takes to carry them.
+ */
+static void sendSettingsSnapshot()
+{
+	SettingsSnapshotData snapshot;
+	SettingsSnapshotGet(&snapshot);
+
+	snapshotHash = 0;
+	UAVObjIterate(&hashSnapshotObject);
+
+	snapshotUnchanged = (snapshotHash == snapshot.Hash);
+	snapshotCount = 0;
+
+	// Objects are never removed, so the handles stay valid between lookups
+	uint8_t numObjects = UAVObjCount();
+	for (uint8_t index = 0; index < numObjects; index++) {
+		UAVObjHandle obj = UAVObjGetByID(UAVObjIDByIndex(index));
+		if (obj == NULL) {
+			continue;
+		}
+
+		sendSnapshotObject(obj);
+		sendSnapshotObject(UAVObjGetLinkedObj(obj));
+	}
+
+	snapshot.Hash = snapshotHash;
+	snapshot.ObjectCount = snapshotCount;
+	snapshot.Status = snapshotUnchanged ?
+		SETTINGSSNAPSHOT_STATUS_UNCHANGED : SETTINGSSNAPSHOT_STATUS_SENT;
+	SettingsSnapshotSet(&snapshot);
+
+	// Sent here rather than queued on change, where it could be dropped
+	// like the request.  Unacked as the objects before it; the GCS times
+	// out and retrieves what is missing if it is lost.
+	if (UAVTalkSendObject(uavTalkCon, SettingsSnapshotHandle(), 0, false, 0) == -1) {
+		++txErrors;
+	}
+}
+
 /**
  * New UAVO object instance callback
  * This is called from the uavobjectmanager
@@ -0,0 +1,96 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules TauLabs Modules
+ * @{
+ * @addtogroup UAVOMavlinkBridge UAVO to Mavlink Bridge Module
+ * @{
+ *
+ * @file       mavlink_scheduler.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @brief      Sends Mavlink messages within the bandwidth of the link
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef MAVLINK_SCHEDULER_H
+#define MAVLINK_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//! Streams a scheduler can handle, one bit each in the pending mask
+#define MAVLINK_SCHED_MAX_STREAMS 16
+
+/**
+ * One message sent periodically.  It is sent when its data changed, but
+ * not more often than every min_interval_ms, and at least every
+ * max_interval_ms even when nothing changed.
+ */
+struct mavlink_stream {
+	uint16_t length;		/**< Bytes on the wire */
+	uint16_t min_interval_ms;	/**< Fastest rate */
+	uint16_t max_interval_ms;	/**< Slowest rate, 0 for none */
+	uint8_t priority;		/**< 0 is sent most often on a full link */
+};
+
+struct mavlink_scheduler {
+	const struct mavlink_stream *streams;
+	uint8_t num_streams;
+
+	uint32_t budget;	/**< Bytes per second */
+	int32_t credit;		/**< Bytes that may be sent now, in 1/1000 */
+	int32_t max_credit;	/**< Largest burst, in 1/1000 bytes */
+	uint32_t last_ms;
+
+	uint16_t pending;	/**< Streams whose data changed */
+	uint32_t last_sent_ms[MAVLINK_SCHED_MAX_STREAMS];
+};
+
+void mavlink_sched_init(struct mavlink_scheduler *s,
+		const struct mavlink_stream *streams, uint8_t num_streams,
+		uint32_t budget, uint32_t now_ms);
+
+void mavlink_sched_set_budget(struct mavlink_scheduler *s, uint32_t budget);
+
+/**
+ * Pick the next message to send.  The link is assumed to be busy with it
+ * once it is returned, so call this until it returns -1 and send each.
+ * @param[in] now_ms The current time
+ * @return The stream to send, or -1 if none should be sent now
+ */
+int mavlink_sched_next(struct mavlink_scheduler *s, uint32_t now_ms);
+
+//! Mark that the data of a stream changed, so it is sent again
+static inline void mavlink_sched_changed(struct mavlink_scheduler *s, int stream)
+{
+	s->pending |= 1 << stream;
+}
+
+//! Bytes per second a serial port carries, with 8N1 framing
+static inline uint32_t mavlink_sched_link_budget(uint32_t baud, uint8_t percent)
+{
+	return baud / 10 * percent / 100;
+}
+
+#endif /* MAVLINK_SCHEDULER_H */
+
+/**
+ * @}
+ * @}
+ */
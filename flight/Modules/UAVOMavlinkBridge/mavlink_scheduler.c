@@ -0,0 +1,141 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules TauLabs Modules
+ * @{
+ * @addtogroup UAVOMavlinkBridge UAVO to Mavlink Bridge Module
+ * @{
+ *
+ * @file       mavlink_scheduler.c
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @brief      Sends Mavlink messages within the bandwidth of the link
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "mavlink_scheduler.h"
+
+//! Time a burst may catch up on, e.g. after the task was held up
+#define BURST_MS 50
+
+void mavlink_sched_init(struct mavlink_scheduler *s,
+		const struct mavlink_stream *streams, uint8_t num_streams,
+		uint32_t budget, uint32_t now_ms)
+{
+	if (num_streams > MAVLINK_SCHED_MAX_STREAMS)
+		num_streams = MAVLINK_SCHED_MAX_STREAMS;
+
+	s->streams = streams;
+	s->num_streams = num_streams;
+	s->last_ms = now_ms;
+
+	/* Everything is sent once at the start, in order of priority */
+	s->pending = (1 << num_streams) - 1;
+
+	for (int i = 0; i < num_streams; i++)
+		s->last_sent_ms[i] = now_ms - UINT16_MAX;
+
+	/* The link is idle, so start with a full burst */
+	s->credit = INT32_MAX;
+	mavlink_sched_set_budget(s, budget);
+}
+
+void mavlink_sched_set_budget(struct mavlink_scheduler *s, uint32_t budget)
+{
+	int32_t largest = 0;
+
+	for (int i = 0; i < s->num_streams; i++)
+		if (s->streams[i].length > largest)
+			largest = s->streams[i].length;
+
+	s->budget = budget;
+
+	/* Let the largest message through even when the budget is tiny */
+	s->max_credit = budget * BURST_MS;
+	if (s->max_credit < largest * 1000)
+		s->max_credit = largest * 1000;
+
+	if (s->credit > s->max_credit)
+		s->credit = s->max_credit;
+}
+
+int mavlink_sched_next(struct mavlink_scheduler *s, uint32_t now_ms)
+{
+	uint32_t elapsed = now_ms - s->last_ms;
+	s->last_ms = now_ms;
+
+	if (elapsed > BURST_MS)
+		elapsed = BURST_MS;
+
+	s->credit += elapsed * s->budget;
+	if (s->credit > s->max_credit)
+		s->credit = s->max_credit;
+
+	/*
+	 * Streams overdue for their slowest rate go first, so that a link
+	 * full of attitude still carries the heartbeat.  Then the changed
+	 * one that waited longest, the wait halved for each priority level:
+	 * on a full link each level is sent about twice as often as the
+	 * next, rather than the first taking it all.
+	 */
+	int best = -1;
+	bool best_overdue = false;
+	uint32_t best_urgency = 0;
+
+	for (int i = 0; i < s->num_streams; i++) {
+		const struct mavlink_stream *st = &s->streams[i];
+		uint32_t waited = now_ms - s->last_sent_ms[i];
+
+		if (waited < st->min_interval_ms)
+			continue;
+
+		bool overdue = st->max_interval_ms && waited >= st->max_interval_ms;
+
+		if (!overdue && !(s->pending & (1 << i)))
+			continue;
+
+		uint32_t urgency = waited >> st->priority;
+
+		if (best >= 0) {
+			if (best_overdue && !overdue)
+				continue;
+
+			if (best_overdue == overdue && urgency <= best_urgency)
+				continue;
+		}
+
+		best = i;
+		best_overdue = overdue;
+		best_urgency = urgency;
+	}
+
+	/* Wait for the bandwidth rather than let others jump the queue */
+	if (best < 0 || s->credit < s->streams[best].length * 1000)
+		return -1;
+
+	s->credit -= s->streams[best].length * 1000;
+	s->pending &= ~(1 << best);
+	s->last_sent_ms[best] = now_ms;
+
+	return best;
+}
+
+/**
+ * @}
+ * @}
+ */
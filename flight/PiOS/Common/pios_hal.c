@@ -983,6 +983,7 @@ void PIOS_HAL_ConfigureHID(HwSharedUSB_HIDPortOptions port_type,
  * @param[in] board_rev Target board revision
  * @param[in] max_power Maximum configured output power
  * @param[in] max_speed Maximum configured speed
+ * @param[in] link_mode How the link uses the air
  * @param[in] openlrs_cfg Configuration for radio in openlrs mode
  * @param[in] rfm22b_cfg Configuration for radio in TauLink mode
  * @param[in] min_chan Minimum channel id.
@@ -994,6 +995,7 @@ void PIOS_HAL_ConfigureRFM22B(HwSharedRadioPortOptions radio_type,
 		uint8_t board_type, uint8_t board_rev,
 		HwSharedMaxRfPowerOptions max_power,
 		HwSharedMaxRfSpeedOptions max_speed,
+		HwSharedRfLinkModeOptions link_mode,
 		HwSharedRfBandOptions rf_band,
 		const struct pios_openlrs_cfg *openlrs_cfg,
 		const struct pios_rfm22b_cfg *rfm22b_cfg,
@@ -1078,7 +1080,7 @@ void PIOS_HAL_ConfigureRFM22B(HwSharedRadioPortOptions radio_type,
 		rfm22bstatus.LinkState = RFM22BSTATUS_LINKSTATE_ENABLED;
 
 		/* Set the radio configuration parameters. */
-		PIOS_RFM22B_Config(pios_rfm22b_id, max_speed, min_chan, max_chan, coord_id, is_oneway, ppm_mode, ppm_only);
+		PIOS_RFM22B_Config(pios_rfm22b_id, max_speed, link_mode, min_chan, max_chan, coord_id, is_oneway, ppm_mode, ppm_only);
 
 		// XXX TODO: Factor these power switches out.
 		/* Set the modem Tx poer level */
@@ -1137,30 +1139,58 @@ void PIOS_HAL_ConfigureRFM22B(HwSharedRadioPortOptions radio_type,
 
 #define BT_COMMAND_QDELAY 350
 
+/**
+ * @brief The baud rate a port runs at once configured for a speed
+ *
+ * The Bluetooth module init options leave the module, and the port,
+ * at 115200.
+ *
+ * @param[in] speed the speed option from HwShared
+ * @returns the baud rate, or 0 for an unknown option
+ */
+uint32_t PIOS_HAL_SerialSpeedBaud(HwSharedSpeedBpsOptions speed) {
+	switch (speed) {
+		case HWSHARED_SPEEDBPS_1200:
+			return 1200;
+		case HWSHARED_SPEEDBPS_2400:
+			return 2400;
+		case HWSHARED_SPEEDBPS_4800:
+			return 4800;
+		case HWSHARED_SPEEDBPS_9600:
+			return 9600;
+		case HWSHARED_SPEEDBPS_19200:
+			return 19200;
+		case HWSHARED_SPEEDBPS_38400:
+			return 38400;
+		case HWSHARED_SPEEDBPS_57600:
+			return 57600;
+		case HWSHARED_SPEEDBPS_INITHM10:
+		case HWSHARED_SPEEDBPS_INITHC06:
+		case HWSHARED_SPEEDBPS_INITHC05:
+		case HWSHARED_SPEEDBPS_115200:
+			return 115200;
+		case HWSHARED_SPEEDBPS_230400:
+			return 230400;
+	}
+
+	return 0;
+}
+
 void PIOS_HAL_ConfigureSerialSpeed(uintptr_t com_id,
 		HwSharedSpeedBpsOptions speed) {
 	switch (speed) {
 		case HWSHARED_SPEEDBPS_1200:
-			PIOS_COM_ChangeBaud(com_id, 2400);
-			break;
 		case HWSHARED_SPEEDBPS_2400:
-			PIOS_COM_ChangeBaud(com_id, 2400);
-			break;
 		case HWSHARED_SPEEDBPS_4800:
-			PIOS_COM_ChangeBaud(com_id, 4800);
-			break;
 		case HWSHARED_SPEEDBPS_9600:
-			PIOS_COM_ChangeBaud(com_id, 9600);
-			break;
 		case HWSHARED_SPEEDBPS_19200:
-			PIOS_COM_ChangeBaud(com_id, 19200);
-			break;
 		case HWSHARED_SPEEDBPS_38400:
-			PIOS_COM_ChangeBaud(com_id, 38400);
-			break;
 		case HWSHARED_SPEEDBPS_57600:
-			PIOS_COM_ChangeBaud(com_id, 57600);
+		case HWSHARED_SPEEDBPS_115200:
+		case HWSHARED_SPEEDBPS_230400:
+			PIOS_COM_ChangeBaud(com_id, PIOS_HAL_SerialSpeedBaud(speed));
 			break;
+
 		case HWSHARED_SPEEDBPS_INITHM10:
 			PIOS_COM_ChangeBaud(com_id, 9600);
 
@@ -1221,14 +1251,6 @@ void PIOS_HAL_ConfigureSerialSpeed(uintptr_t com_id,
 			PIOS_Thread_Sleep(BT_COMMAND_DELAY/2);
 
 			break;
-
-		case HWSHARED_SPEEDBPS_115200:
-			PIOS_COM_ChangeBaud(com_id, 115200);
-			break;
-
-		case HWSHARED_SPEEDBPS_230400:
-			PIOS_COM_ChangeBaud(com_id, 230400);
-			break;
 	}
 }
 
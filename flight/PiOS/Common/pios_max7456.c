@@ -70,6 +70,27 @@
 #define SYNC_INTERVAL_NTSC 33366
 #define SYNC_INTERVAL_PAL  40000
 
+#define MAX7456_CELLS (MAX7456_PAL_ROWS * MAX7456_COLUMNS)
+
+/* A cell of display memory: attributes in the high byte, as in DMM[5:3] */
+#define CELL(chr, attr) ((uint16_t) (((attr) & 0x07) << 11 | (chr)))
+#define CELL_CHR(cell)  ((uint8_t) (cell))
+#define CELL_DMM(cell)  ((uint8_t) ((cell) >> 8))
+
+/* Never a real cell, so a cell marked with it is rewritten by the next frame */
+#define CELL_STALE 0xffff
+
+/* One row is rewritten every this many frames, whether it changed or not;
+ * the whole screen in about 2.6s on PAL, 1.7s on NTSC.
+ */
+#define REFRESH_ROW_FRAMES 4
+
+/* Starting a run costs DMAH, DMAL, DMM and the final DMDI, two bytes each;
+ * rewriting an unchanged cell within a run costs two.  So gaps of up to
+ * three unchanged cells are cheaper to write through than to skip.
+ */
+#define MAX_RUN_GAP 3
+
 ///////////////////////////////////////////////////////////////////////////////
 
 struct max7456_dev_s {
@@ -87,6 +108,12 @@ struct max7456_dev_s {
 	uint8_t det_mode_fallback;
 
 	uint32_t next_sync_expected;
+
+	bool drawing;
+	uint16_t frame[MAX7456_CELLS];	/* Being drawn, between begin and end */
+	uint16_t shown[MAX7456_CELLS];	/* What display memory holds */
+	uint8_t refresh_frame;
+	uint8_t refresh_row;		/* Rewritten next, regardless */
 };
 
 static bool poll_vsync_spi (max7456_dev_t dev);
@@ -331,6 +358,12 @@ void PIOS_MAX7456_clear(max7456_dev_t dev)
 	while (MAX7456_DMM_CLR_R(dmm) != MAX7456_DMM_CLR_READY) {
 		dmm = read_register_sel(dev, MAX7456_REG_DMM);
 	}
+
+	memset(dev->shown, 0, sizeof(dev->shown));
+
+	if (dev->drawing) {
+		memset(dev->frame, 0, sizeof(dev->frame));
+	}
 }
 
 void PIOS_MAX7456_upload_char (max7456_dev_t dev, uint8_t char_index,
@@ -408,21 +441,47 @@ void PIOS_MAX7456_download_char (max7456_dev_t dev, uint8_t char_index,
 	enable_osd(dev);
 }
 
-/* Assumes you have already selected */
-static inline void set_offset (max7456_dev_t dev, uint8_t col, uint8_t row)
+static inline uint16_t cell_offset(uint8_t col, uint8_t row)
 {
-	PIOS_Assert(dev->magic == MAX7456_MAGIC);
-
 	if (col > 29) {
 		// Still will wrap to next line...
 		col = 29;
 	}
 
-	uint16_t offset = (row * 30 + col) & 0x1ff;
+	return (row * 30 + col) & 0x1ff;
+}
+
+/* Assumes you have already selected */
+static inline void set_address(max7456_dev_t dev, uint16_t offset)
+{
 	write_register(dev, MAX7456_REG_DMAH, offset >> 8);
 	write_register(dev, MAX7456_REG_DMAL,(uint8_t) offset);
 }
 
+/* Assumes you have already selected */
+static inline void set_offset (max7456_dev_t dev, uint8_t col, uint8_t row)
+{
+	PIOS_Assert(dev->magic == MAX7456_MAGIC);
+
+	set_address(dev, cell_offset(col, row));
+}
+
+/* Record a character written to display memory, or to the frame */
+static inline void store_cell(max7456_dev_t dev, uint16_t offset, uint16_t cell)
+{
+	if (offset >= MAX7456_CELLS) {
+		return;
+	}
+
+	if (dev->drawing) {
+		dev->frame[offset] = cell;
+	} else {
+		dev->shown[offset] = cell;
+	}
+}
+
+#define valid_char(c) (c == MAX7456_DMDI_AUTOINCREMENT_STOP ? 0x00 : c)
+
 static bool poll_vsync_spi (max7456_dev_t dev)
 {
 	uint8_t status = read_register_sel(dev, MAX7456_REG_STAT);
@@ -437,6 +496,13 @@ void PIOS_MAX7456_put (max7456_dev_t dev,
 
 	PIOS_Assert(!dev->opened);
 
+	if (dev->drawing) {
+		store_cell(dev, cell_offset(col, row), CELL(valid_char(chr), attr));
+		return;
+	}
+
+	store_cell(dev, cell_offset(col, row), CELL(chr, attr));
+
 	chip_select(dev);
 	set_offset(dev, col, row);
 	write_register(dev, MAX7456_REG_DMM,(attr & 0x07) << 3);
@@ -473,7 +539,6 @@ static void PIOS_MAX7456_close (max7456_dev_t dev)
 	dev->opened = false;
 }
 
-#define valid_char(c) (c == MAX7456_DMDI_AUTOINCREMENT_STOP ? 0x00 : c)
 void PIOS_MAX7456_puts(max7456_dev_t dev, uint8_t col, uint8_t row, const char *s, uint8_t attr)
 {
 	PIOS_Assert(dev->magic == MAX7456_MAGIC);
@@ -481,15 +546,115 @@ void PIOS_MAX7456_puts(max7456_dev_t dev, uint8_t col, uint8_t row, const char *
 	if (col == MAX7456_FMT_H_CENTER) {
 		col = ((MAX7456_COLUMNS - strlen(s)) / 2);
 	}
+
+	uint16_t offset = cell_offset(col > dev->right ? 0 : col,
+			row > dev->bottom ? 0 : row);
+
+	if (dev->drawing) {
+		for (; *s; s++, offset++) {
+			store_cell(dev, offset, CELL(valid_char((uint8_t) *s), attr));
+		}
+
+		return;
+	}
+
 	PIOS_MAX7456_open(dev, col, row, attr);
 	while (*s)
 	{
+		store_cell(dev, offset++, CELL(valid_char((uint8_t) *s), attr));
 		write_register(dev, MAX7456_REG_DMDI, valid_char(*s));
 		s++;
 	}
 	PIOS_MAX7456_close(dev);
 }
 
+void PIOS_MAX7456_begin_frame(max7456_dev_t dev)
+{
+	PIOS_Assert(dev->magic == MAX7456_MAGIC);
+	PIOS_Assert(!dev->drawing);
+
+	memset(dev->frame, 0, sizeof(dev->frame));
+	dev->drawing = true;
+}
+
+void PIOS_MAX7456_end_frame(max7456_dev_t dev)
+{
+	PIOS_Assert(dev->magic == MAX7456_MAGIC);
+	PIOS_Assert(dev->drawing);
+	PIOS_Assert(!dev->opened);
+
+	dev->drawing = false;
+
+	/* Display memory can be corrupted behind our back, by noise on the
+	 * bus or a brown out that leaves the OSD enabled.  Now and then
+	 * rewrite a row whatever it is thought to hold, so a bad cell heals
+	 * even on a screen that does not change.
+	 */
+	if (dev->refresh_frame++ % REFRESH_ROW_FRAMES == 0) {
+		if (dev->refresh_row > dev->bottom) {
+			dev->refresh_row = 0;
+		}
+
+		for (uint16_t i = 0; i < MAX7456_COLUMNS; i++) {
+			dev->shown[dev->refresh_row * MAX7456_COLUMNS + i] = CELL_STALE;
+		}
+
+		dev->refresh_row++;
+	}
+
+	uint16_t cells = (dev->bottom + 1) * MAX7456_COLUMNS;
+	bool selected = false;
+
+	for (uint16_t i = 0; i < cells; i++) {
+		if (dev->frame[i] == dev->shown[i]) {
+			continue;
+		}
+
+		/* Extend the run over the changed cells with the same
+		 * attributes, and over short gaps between them.
+		 */
+		uint8_t dmm = CELL_DMM(dev->frame[i]);
+		uint16_t end = i + 1;
+
+		for (uint16_t j = end; j < cells && j - end <= MAX_RUN_GAP; j++) {
+			if (CELL_DMM(dev->frame[j]) != dmm) {
+				break;
+			}
+
+			if (dev->frame[j] != dev->shown[j]) {
+				end = j + 1;
+			}
+		}
+
+		if (!selected) {
+			chip_select(dev);
+			selected = true;
+		}
+
+		set_address(dev, i);
+
+		// 16 bits operating mode, char attributes, autoincrement
+		write_register(dev, MAX7456_REG_DMM, dmm | 0x01);
+
+		for (; i < end; i++) {
+			write_register(dev, MAX7456_REG_DMDI, CELL_CHR(dev->frame[i]));
+			dev->shown[i] = dev->frame[i];
+		}
+
+		// terminate autoincrement mode
+		write_register(dev, MAX7456_REG_DMDI, MAX7456_DMDI_AUTOINCREMENT_STOP);
+
+		/* The loop increment moves past the cell after the run,
+		 * which was unchanged or had other attributes; check it.
+		 */
+		i--;
+	}
+
+	if (selected) {
+		chip_unselect(dev);
+	}
+}
+
 void PIOS_MAX7456_get_extents(max7456_dev_t dev, 
 		uint8_t *mode, uint8_t *right, uint8_t *bottom,
 		uint8_t *hcenter, uint8_t *vcenter)
@@ -26,6 +26,7 @@
 
 #include "pios.h"
 #include "pios_queue.h"
+#include "pios_trace.h"
 
 #if !defined(PIOS_INCLUDE_FREERTOS) && !defined(PIOS_INCLUDE_CHIBIOS)
 #error "pios_queue.c requires PIOS_INCLUDE_FREERTOS or PIOS_INCLUDE_CHIBIOS"
@@ -194,8 +195,10 @@ void PIOS_Queue_Delete(struct pios_queue *queuep)
 bool PIOS_Queue_Send(struct pios_queue *queuep, const void *itemp, uint32_t timeout_ms)
 {
 	void *buf = chPoolAlloc(&queuep->mp);
-	if (buf == NULL)
+	if (buf == NULL) {
+		PIOS_TRACE(PIOS_TRACE_QUEUE_SEND, false, queuep);
 		return false;
+	}
 
 	memcpy(buf, itemp, queuep->mp.mp_object_size);
 
@@ -209,6 +212,8 @@ bool PIOS_Queue_Send(struct pios_queue *queuep, const void *itemp, uint32_t time
 
 	msg_t result = chMBPost(&queuep->mb, (msg_t)buf, timeout);
 
+	PIOS_TRACE(PIOS_TRACE_QUEUE_SEND, result == RDY_OK, queuep);
+
 	if (result != RDY_OK)
 	{
 		chPoolFree(&queuep->mp, buf);
@@ -280,6 +285,8 @@ bool PIOS_Queue_Receive(struct pios_queue *queuep, void *itemp, uint32_t timeout
 
 	msg_t result = chMBFetch(&queuep->mb, &buf, timeout);
 
+	PIOS_TRACE(PIOS_TRACE_QUEUE_RECEIVE, result == RDY_OK, queuep);
+
 	if (result != RDY_OK)
 		return false;
 
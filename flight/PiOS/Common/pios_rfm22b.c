@@ -96,6 +96,7 @@
 #include <pios_rfm22b_priv.h>
 #include <pios_rfm22b_rcvr_priv.h>
 #include <ecc.h>
+#include <rfm22b_link.h>
 
 /* Local Defines */
 #define STACK_SIZE_BYTES                 800
@@ -225,6 +226,8 @@ static uint8_t rfm22_calcChannelFromClock(struct pios_rfm22b_dev *rfm22b_dev);
 static bool rfm22_changeChannel(struct pios_rfm22b_dev *rfm22b_dev);
 static void rfm22_clearLEDs();
 static bool rfm22_InRxWait(struct pios_rfm22b_dev * rfb22b_id);
+static void rfm22_setLinkRate(struct pios_rfm22b_dev *rfm22b_dev, uint8_t rate);
+static bool rfm22_updateLinkRate(struct pios_rfm22b_dev *rfm22b_dev);
 
 // Utility functions.
 static uint32_t pios_rfm22_time_difference_ms(uint32_t start_time, uint32_t end_time);
@@ -333,19 +336,7 @@ static const struct pios_rfm22b_transition
 				     },
 };
 
-// xtal 10 ppm, 434MHz
-static const uint32_t data_rate[] = {
-	9600,			// 96 kbps, 433 HMz, 30 khz freq dev
-	19200,			// 19.2 kbps, 433 MHz, 45 khz freq dev
-	32000,			// 32 kbps, 433 MHz, 45 khz freq dev
-	57600,			// 57.6 kbps, 433 MHz, 45 khz freq dev
-	64000,			// 64 kbps, 433 MHz, 45 khz freq dev
-	100000,			// 100 kbps, 433 MHz, 60 khz freq dev
-	128000,			// 128 kbps, 433 MHz, 90 khz freq dev
-	192000,			// 192 kbps, 433 MHz, 128 khz freq dev
-	256000,			// 256 kbps, 433 MHz, 150 khz freq dev
-};
-
+// Register values for each rate in rfm22b_link.c, xtal 10 ppm, 434MHz
 static const uint8_t reg_1C[] = { 0x01, 0x05, 0x06, 0x95, 0x95, 0x81, 0x88, 0x8B, 0x8D };	// rfm22_if_filter_bandwidth
 
 static const uint8_t reg_1D[] = { 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40 };	// rfm22_afc_loop_gearshift_override
@@ -371,10 +362,6 @@ static const uint8_t reg_71[] = { 0x23, 0x23, 0x23, 0x23, 0x23, 0x23, 0x23, 0x23
 
 static const uint8_t reg_72[] = { 0x30, 0x48, 0x48, 0x48, 0x48, 0x60, 0x90, 0xCD, 0x0F };	// rfm22_frequency_deviation
 
-static const uint8_t packet_time[] = { 80, 40, 25, 15, 13, 10, 8, 6, 5 };
-static const uint8_t packet_time_ppm[] = { 26, 25, 25, 15, 13, 10, 8, 6, 5 };
-static const uint8_t num_channels[] = { 4, 4, 4, 6, 8, 8, 10, 12, 16 };
-
 static struct pios_rfm22b_dev *g_rfm22b_dev = NULL;
 
 /*****************************************************************************
@@ -471,6 +458,7 @@ int32_t PIOS_RFM22B_Init(uint32_t * rfm22b_id, uint32_t spi_id,
 	// Initialize the channels.
 	PIOS_RFM22B_Config(*rfm22b_id,
 				     RFM22B_DEFAULT_RX_DATARATE,
+				     HWSHARED_RFLINKMODE_LEGACY,
 				     RFM22B_DEFAULT_MIN_CHANNEL,
 				     RFM22B_DEFAULT_MAX_CHANNEL,
 				     0, false, false, false);
@@ -636,7 +624,8 @@ void PIOS_RFM22B_SetTxPower(uint32_t rfm22b_id,
  * The channel spacing is 10MHz / 250 = 40kHz
  *
  * @param[in] rfm22b_id  The RFM22B device index.
- * @param[in] datarate  The desired datarate.
+ * @param[in] datarate  The desired datarate, the highest on an adaptive link.
+ * @param[in] link_mode  How the link uses the air; both ends must match.
  * @param[in] min_chan  The minimum channel.
  * @param[in] max_chan  The maximum channel.
  * @param[in] chan_set  The "seed" for selecting a channel sequence.
@@ -646,6 +635,7 @@ void PIOS_RFM22B_SetTxPower(uint32_t rfm22b_id,
  */
 void PIOS_RFM22B_Config(uint32_t rfm22b_id,
 				  HwSharedMaxRfSpeedOptions datarate,
+				  HwSharedRfLinkModeOptions link_mode,
 				  uint8_t min_chan, uint8_t max_chan,
 				  uint32_t coordinator_id,
 				  bool oneway, bool ppm_mode,
@@ -673,15 +663,26 @@ void PIOS_RFM22B_Config(uint32_t rfm22b_id,
 	if (ppm_only) {
 		rfm22b_dev->one_way_link = true;
 		datarate = RFM22B_PPM_ONLY_DATARATE;
-		rfm22b_dev->datarate = RFM22B_PPM_ONLY_DATARATE;
 	} else {
 		rfm22b_dev->one_way_link = false;
-		rfm22b_dev->datarate = datarate;
 	}
 
-	rfm22b_dev->packet_time = (ppm_mode ? packet_time_ppm[datarate] : packet_time[datarate]);
-	if (!rfm22b_dev->one_way_link)
-		rfm22b_dev->packet_time *= 2;  // double the time to allow a send and receive in each slice
+	// Links carrying PPM keep a fixed rate, so the control latency never
+	// changes.  On an adaptive link the configured rate is the highest the
+	// link adapts up to.
+	rfm22b_dev->link_mode = (enum rfm22b_link_mode) link_mode;
+	if (ppm_mode && rfm22b_dev->link_mode == RFM22B_LINK_ADAPTIVE) {
+		rfm22b_dev->link_mode = RFM22B_LINK_AGGREGATED;
+	}
+
+	uint8_t min_rate = datarate;
+	if (rfm22b_dev->link_mode == RFM22B_LINK_ADAPTIVE) {
+		min_rate = 0;
+	}
+	rfm22b_link_rate_init(&rfm22b_dev->link_rate, min_rate, datarate,
+			PIOS_Thread_Systime());
+	rfm22b_link_quality_reset(&rfm22b_dev->link_quality);
+	rfm22b_dev->link_rate_changed = false;
 
 	// Find the first N channels that meet the min/max criteria out of the random channel list.
 	uint32_t crc = 0;
@@ -692,8 +693,10 @@ void PIOS_RFM22B_Config(uint32_t rfm22b_id,
 		crc = PIOS_CRC_updateByte(rfm22b_dev->coordinatorID, CRC_INC);
 	}
 
+	// Enough channels for the fastest rate; slower rates use the first few
 	uint8_t num_found = 0;
-	while (num_found < num_channels[datarate]) {
+	while (num_found < rfm22b_link_num_channels(rfm22b_dev->link_mode,
+				rfm22b_dev->link_rate.max_rate)) {
 		crc = PIOS_CRC_updateByte(crc, CRC_INC);
 		uint8_t chan = min_chan + (crc % (max_chan - min_chan));
 
@@ -707,17 +710,7 @@ void PIOS_RFM22B_Config(uint32_t rfm22b_id,
 		}
 	}
 
-	// Calculate the maximum packet length from the datarate.
-	float bytes_per_period =
-	    (float)data_rate[datarate] * (float)(rfm22b_dev->packet_time -
-						 2) / 9000;
-
-	rfm22b_dev->max_packet_len =
-	    bytes_per_period - TX_PREAMBLE_NIBBLES / 2 - SYNC_BYTES -
-	    HEADER_BYTES - LENGTH_BYTES;
-	if (rfm22b_dev->max_packet_len > RFM22B_MAX_PACKET_LEN) {
-		rfm22b_dev->max_packet_len = RFM22B_MAX_PACKET_LEN;
-	}
+	rfm22_setLinkRate(rfm22b_dev, rfm22b_dev->link_rate.rate);
 }
 
 /**
@@ -1243,6 +1236,11 @@ static void pios_rfm22_task(void *parameters)
 			rfm22_process_event(rfm22b_dev, RADIO_EVENT_RX_MODE);
 		}
 
+		// Follow the adaptive air rate.
+		if (rfm22_updateLinkRate(rfm22b_dev)) {
+			rfm22_process_event(rfm22b_dev, RADIO_EVENT_RX_MODE);
+		}
+
 		// Update the connected status
 		rfm22_setConnected(rfm22b_dev, rfm22b_dev->sync_pulses_missed < RADIO_SYNC_PULSES_DISCONNECT);
 
@@ -1824,6 +1822,7 @@ static enum pios_radio_event radio_txStart(struct pios_rfm22b_dev
 	uint8_t max_data_len =
 	    radio_dev->max_packet_len -
 	    (radio_dev->ppm_only_mode ? 0 : RS_ECC_NPARITY);
+	uint8_t header_len = 0;
 
 	// Don't send if it's not our turn, or if we're receiving a packet.
 	if (!rfm22_timeToSend(radio_dev) || !rfm22_InRxWait(radio_dev)) {
@@ -1835,6 +1834,17 @@ static enum pios_radio_event radio_txStart(struct pios_rfm22b_dev
 		return RADIO_EVENT_RX_MODE;
 	}
 
+	// Adaptive link packets start with the air rate control byte.
+	if (radio_dev->link_mode == RFM22B_LINK_ADAPTIVE) {
+		p[0] = rfm22b_link_rate_tx_control(&radio_dev->link_rate,
+				rfm22_isCoordinator(radio_dev), radio_dev->link_quality.quality,
+				radio_dev->packet_time,
+				rfm22_coordinatorTime(radio_dev, PIOS_Thread_Systime()));
+		p++;
+		max_data_len--;
+		header_len = 1;
+	}
+
 	// Should we append PPM data to the packet?
 	if (radio_dev->ppm_send_mode) {
 		len = RFM22B_PPM_NUM_CHANNELS + (radio_dev->ppm_only_mode ? 2 : 1);
@@ -1883,10 +1893,14 @@ static enum pios_radio_event radio_txStart(struct pios_rfm22b_dev
 		return RADIO_EVENT_RX_MODE;
 	}
 
+	// Include the control byte
+	p -= header_len;
+	len += header_len;
+
 	// Add the error correcting code.
 	if (!radio_dev->ppm_only_mode) {
 		if (len != 0) {
-			encode_data((unsigned char *)p, len, (unsigned char *)p);
+			rs_encode(p, len, p);
 		} else {
 			for (uint32_t i = 0; i < RS_ECC_NPARITY; i++)
 				p[i] = EMPTY_PACKET + i;
@@ -1972,12 +1986,13 @@ static enum pios_radio_event radio_receivePacket(struct pios_rfm22b_dev
 
 		// Attempt to correct any errors in the packet.
 		if (data_len > 0) {
-			decode_data((unsigned char *)p, rx_len);
-			good_packet = check_syndrome() == 0;
+			struct rs_decoder *dec = &radio_dev->rs_dec;
+
+			good_packet = rs_syndrome(dec, p, rx_len);
 
 			// We have an error.  Try to correct it.
 			if (!good_packet &&
-			    (correct_errors_erasures((unsigned char *)p, rx_len, 0, 0) != 0)) {
+			    (rs_correct(dec, p, rx_len, 0, NULL) != 0)) {
 				// We corrected it
 				corrected_packet = true;
 			}
@@ -1992,6 +2007,20 @@ static enum pios_radio_event radio_receivePacket(struct pios_rfm22b_dev
 		good_packet = true;
 	}
 
+	// Strip the air rate control byte, which only the linked modem's packets
+	// may act on.
+	if ((good_packet || corrected_packet) && (data_len > 0) &&
+			(radio_dev->link_mode == RFM22B_LINK_ADAPTIVE)) {
+		if (radio_dev->rx_destination_id == rfm22_destinationID(radio_dev)) {
+			rfm22b_link_rate_rx_control(&radio_dev->link_rate,
+					rfm22_isCoordinator(radio_dev), p[0],
+					radio_dev->packet_time,
+					rfm22_coordinatorTime(radio_dev, PIOS_Thread_Systime()));
+		}
+		p++;
+		data_len--;
+	}
+
 	uint8_t ppm_len = RFM22B_PPM_NUM_CHANNELS + (radio_dev->ppm_only_mode ? 2 : 1);
 
 	// Parse PPM data from the packet when expecting it
@@ -2180,6 +2209,60 @@ static void rfm22_calculateLinkQuality(struct pios_rfm22b_dev *rfm22b_dev)
 
 }
 
+/**
+ * Switch to an air data rate, and size the slots and packets for it.  The
+ * radio registers are written separately, by pios_rfm22_setDatarate.
+ *
+ * @param[in] rfm22b_dev  The device structure
+ * @param[in] rate  The air data rate index
+ */
+static void rfm22_setLinkRate(struct pios_rfm22b_dev *rfm22b_dev, uint8_t rate)
+{
+	bool ppm_mode = rfm22b_dev->ppm_send_mode || rfm22b_dev->ppm_recv_mode;
+
+	rfm22b_dev->datarate = rate;
+	rfm22b_dev->packet_time = rfm22b_link_packet_time(rfm22b_dev->link_mode,
+			rate, ppm_mode, rfm22b_dev->one_way_link);
+
+	rfm22b_dev->max_packet_len = rfm22b_link_max_packet_len(rfm22b_dev->link_mode, rate,
+			rfm22b_dev->packet_time, rfm22b_dev->one_way_link);
+}
+
+/**
+ * Follow the adaptive air rate.  A rate change is applied once the radio is
+ * not sending or receiving a packet.  Every adaptive rate shares the hop
+ * cycle, so the link stays synchronized across the change.
+ *
+ * @param[in] rfm22b_dev  The device structure
+ * @return true if the radio was switched to a new rate and must reenter RX mode
+ */
+static bool rfm22_updateLinkRate(struct pios_rfm22b_dev *rfm22b_dev)
+{
+	if (rfm22b_dev->link_mode != RFM22B_LINK_ADAPTIVE) {
+		return false;
+	}
+
+	if (rfm22b_link_rate_update(&rfm22b_dev->link_rate,
+			rfm22_isCoordinator(rfm22b_dev), rfm22_isConnected(rfm22b_dev),
+			rfm22b_dev->link_quality.quality, rfm22b_dev->packet_time,
+			rfm22_coordinatorTime(rfm22b_dev, PIOS_Thread_Systime()))) {
+		rfm22b_dev->link_rate_changed = true;
+	}
+
+	if (!rfm22b_dev->link_rate_changed || !rfm22_InRxWait(rfm22b_dev)) {
+		return false;
+	}
+
+	rfm22b_dev->link_rate_changed = false;
+	rfm22_setLinkRate(rfm22b_dev, rfm22b_dev->link_rate.rate);
+	pios_rfm22_setDatarate(rfm22b_dev);
+
+	// The quality describes the old rate
+	rfm22b_link_quality_reset(&rfm22b_dev->link_quality);
+
+	return true;
+}
+
 /**
  * Add a status value to the RX packet status array.
  *
@@ -2197,6 +2280,22 @@ static void rfm22b_add_rx_status(struct pios_rfm22b_dev *rfm22b_dev,
 	uint32_t rx_status_address = (rx_status_count / 8) % RFM22B_RX_PACKET_STATS_LEN;
 	uint32_t rx_status_offset = rx_status_count % 8;
 
+	// Rate the link for the adaptive air rate
+	switch (status) {
+	case RADIO_GOOD_RX_PACKET:
+		rfm22b_link_quality_add(&rfm22b_dev->link_quality, RFM22B_LINK_RX_GOOD);
+		break;
+	case RADIO_CORRECTED_RX_PACKET:
+		rfm22b_link_quality_add(&rfm22b_dev->link_quality, RFM22B_LINK_RX_CORRECTED);
+		break;
+	case RADIO_ERROR_RX_PACKET:
+	case RADIO_ERROR_RX_SYNC_MISSED:
+		rfm22b_link_quality_add(&rfm22b_dev->link_quality, RFM22B_LINK_RX_LOST);
+		break;
+	default:
+		break;
+	}
+
 	// replace that value in the ring buffer with new status
 	rfm22b_dev->rx_packet_stats[rx_status_address] &= ~(0x0000000F << (rx_status_offset * 4));
 	rfm22b_dev->rx_packet_stats[rx_status_address] |= ((status & 0x0000000F) << (rx_status_offset * 4));
@@ -2255,12 +2354,12 @@ static void rfm22_synchronizeClock(struct pios_rfm22b_dev *rfm22b_dev)
 	uint32_t start_time = rfm22b_dev->packet_start_ticks;
 
 	// This packet was transmitted on channel 0, calculate the time delta that will force us to transmit on channel 0 at the time this packet started.
-	uint8_t num_chan = num_channels[rfm22b_dev->datarate];
+	uint8_t num_chan = rfm22b_link_num_channels(rfm22b_dev->link_mode, rfm22b_dev->datarate);
 	uint16_t frequency_hop_cycle_time = rfm22b_dev->packet_time * num_chan;
 	uint16_t time_delta = start_time % frequency_hop_cycle_time;
 
 	// Calculate the adjustment for the preamble
-	uint8_t offset = (uint8_t) ceilf(35000.0F / data_rate[rfm22b_dev->datarate]);
+	uint8_t offset = (uint8_t) ceilf(35000.0F / rfm22b_link_bps(rfm22b_dev->datarate));
 
 	rfm22b_dev->time_delta = frequency_hop_cycle_time - time_delta + offset;
 }
@@ -2319,7 +2418,7 @@ static uint8_t rfm22_calcChannel(struct pios_rfm22b_dev *rfm22b_dev,
 				 uint8_t index)
 {
 	// Make sure we don't index outside of the range.
-	uint8_t num_chan = num_channels[rfm22b_dev->datarate];
+	uint8_t num_chan = rfm22b_link_num_channels(rfm22b_dev->link_mode, rfm22b_dev->datarate);
 	uint8_t idx = index % num_chan;
 
 	// Are we switching to a new channel?
@@ -2354,7 +2453,7 @@ static uint8_t rfm22_calcChannelFromClock(struct pios_rfm22b_dev *rfm22b_dev)
 
 	// Divide time into slices based on the packet_time (determine from the data rate).
 	// Coordinator sends in the first half and the non-coordinator in the second half.
-	uint8_t num_chan = num_channels[rfm22b_dev->datarate];
+	uint8_t num_chan = rfm22b_link_num_channels(rfm22b_dev->link_mode, rfm22b_dev->datarate);
 	uint8_t n = (time / rfm22b_dev->packet_time) % num_chan;
 
 	return rfm22_calcChannel(rfm22b_dev, n);
@@ -0,0 +1,189 @@
+/**
+ ******************************************************************************
+ * @file       pios_trace.c
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_Trace Scheduler trace
+ * @{
+ * @brief Records context switches, object callbacks and queue operations
+ *        with raw timer timestamps, for timeline analysis on the host
+ *
+ * Records are kept in a fixed ring that is drained by the system module into
+ * the TraceBuffer object.  Recording never blocks and never allocates; when
+ * the ring is full new records are dropped and counted, and the count is
+ * reported in a LOST record the next time the ring is read.
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "pios.h"
+#include "pios_trace.h"
+
+#if defined(PIOS_INCLUDE_TRACE)
+
+#if !defined(PIOS_INCLUDE_CHIBIOS)
+#error "pios_trace.c requires PIOS_INCLUDE_CHIBIOS"
+#endif
+
+#if !CH_USE_REGISTRY
+#error "pios_trace.c requires CH_USE_REGISTRY to name the threads"
+#endif
+
+//! Number of records buffered, which must be a power of two
+#if !defined(PIOS_TRACE_LEN)
+#define PIOS_TRACE_LEN 512
+#endif
+
+#if (PIOS_TRACE_LEN & (PIOS_TRACE_LEN - 1)) != 0
+#error "PIOS_TRACE_LEN must be a power of two"
+#endif
+
+static struct pios_trace_record trace_ring[PIOS_TRACE_LEN];
+static uint32_t trace_head;	/**< Records written, free running */
+static uint32_t trace_tail;	/**< Records read, free running */
+static uint32_t trace_lost;	/**< Records dropped since the last read */
+
+/**
+ * Append a record to the ring.  Must be called with the kernel locked, or from
+ * a kernel hook which already runs locked.
+ * @param[in] event One of @ref pios_trace_event
+ * @param[in] arg Event specific argument
+ * @param[in] data Event specific data
+ */
+void PIOS_TRACE_RecordI(uint8_t event, uint16_t arg, uint32_t data)
+{
+	if (trace_head - trace_tail >= PIOS_TRACE_LEN) {
+		trace_lost++;
+		return;
+	}
+
+	struct pios_trace_record *r = &trace_ring[trace_head & (PIOS_TRACE_LEN - 1)];
+
+	r->time = PIOS_DELAY_GetRaw();
+	r->data = data;
+	r->arg = arg;
+	r->event = event;
+	r->reserved = 0;
+
+	trace_head++;
+}
+
+/**
+ * Append a record to the ring from thread context.
+ * @param[in] event One of @ref pios_trace_event
+ * @param[in] arg Event specific argument
+ * @param[in] data Event specific data
+ */
+void PIOS_TRACE_Record(uint8_t event, uint16_t arg, uint32_t data)
+{
+	chSysLock();
+	PIOS_TRACE_RecordI(event, arg, data);
+	chSysUnlock();
+}
+
+/**
+ * Record a context switch.  Called from THREAD_CONTEXT_SWITCH_HOOK.
+ * @param[in] thread The thread being switched in
+ */
+void PIOS_TRACE_SwitchI(const void *thread)
+{
+	PIOS_TRACE_RecordI(PIOS_TRACE_SWITCH, 0, (uint32_t) (uintptr_t) thread);
+}
+
+/**
+ * Record the name of every thread, so that the host can label the threads
+ * referred to by the switch records.
+ */
+void PIOS_TRACE_Threads(void)
+{
+	for (Thread *tp = chRegFirstThread(); tp != NULL; tp = chRegNextThread(tp)) {
+		PIOS_TRACE_Record(PIOS_TRACE_THREAD, 0, (uint32_t) (uintptr_t) tp);
+
+		const char *name = chRegGetThreadName(tp);
+		if (name == NULL)
+			continue;
+
+		// Four characters per record, the last one zero padded
+		uint16_t index = 0;
+		bool done = false;
+
+		while (!done) {
+			uint32_t chars = 0;
+
+			for (int i = 0; i < 4; i++) {
+				if (!done && name[index * 4 + i] != '\0')
+					chars |= (uint32_t) (uint8_t) name[index * 4 + i] << (8 * i);
+				else
+					done = true;
+			}
+
+			PIOS_TRACE_Record(PIOS_TRACE_THREAD_NAME, index++, chars);
+		}
+	}
+}
+
+/**
+ * Record the raw timer against the microsecond clock, so that the host can
+ * convert raw timestamps to time.
+ */
+void PIOS_TRACE_Sync(void)
+{
+	chSysLock();
+	PIOS_TRACE_RecordI(PIOS_TRACE_SYNC, 0, PIOS_DELAY_GetuS());
+	chSysUnlock();
+}
+
+/**
+ * Remove the oldest records from the ring.  If records were dropped since the
+ * last read, a LOST record with their number comes first.
+ * @param[out] records Where to store the records
+ * @param[in] max_records Capacity of records
+ * @return The number of records stored
+ */
+int PIOS_TRACE_Read(struct pios_trace_record *records, int max_records)
+{
+	int n = 0;
+
+	chSysLock();
+
+	if (trace_lost > 0 && n < max_records) {
+		records[n].time = PIOS_DELAY_GetRaw();
+		records[n].data = trace_lost;
+		records[n].arg = 0;
+		records[n].event = PIOS_TRACE_LOST;
+		records[n].reserved = 0;
+		n++;
+
+		trace_lost = 0;
+	}
+
+	while (n < max_records && trace_tail != trace_head) {
+		records[n++] = trace_ring[trace_tail & (PIOS_TRACE_LEN - 1)];
+		trace_tail++;
+	}
+
+	chSysUnlock();
+
+	return n;
+}
+
+#endif /* PIOS_INCLUDE_TRACE */
+
+/**
+ * @}
+ * @}
+ */
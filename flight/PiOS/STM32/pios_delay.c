@@ -39,6 +39,9 @@
 static uint32_t us_ticks;
 static uint32_t us_modulo;
 
+/* Time the raw clock was moved forward by, in lockstep simulation */
+static volatile uint32_t raw_skipped;
+
 /**
  * Initialises the Timer used by PIOS_DELAY functions.
  *
@@ -168,7 +171,7 @@ uint32_t PIOS_DELAY_GetRaw()
 {
 	/* turn on access to the DWT registers */
 	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
-	return DWT->CYCCNT;
+	return DWT->CYCCNT + raw_skipped;
 }
 
 /**
@@ -180,7 +183,7 @@ uint32_t PIOS_DELAY_DiffuS(uint32_t raw)
 	/* turn on access to the DWT registers */
 	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
 
-	return PIOS_DELAY_DiffuS2(raw, DWT->CYCCNT);
+	return PIOS_DELAY_DiffuS2(raw, DWT->CYCCNT + raw_skipped);
 }
 
 /**
@@ -192,6 +195,17 @@ uint32_t PIOS_DELAY_DiffuS2(uint32_t raw, uint32_t later) {
 	return diff / us_ticks;
 }
 
+/**
+ * @brief Move the raw clock forward, for lockstep simulation.
+ * Only PIOS_DELAY_GetRaw and PIOS_DELAY_DiffuS see it; the waits and
+ * PIOS_DELAY_GetuS keep to real time.
+ * @param[in] uS how far to move it
+ */
+void PIOS_DELAY_SkipuS(uint32_t uS)
+{
+	raw_skipped += uS * us_ticks;
+}
+
 /**
   * @}
   * @}
@@ -119,6 +119,7 @@ void PIOS_HAL_ConfigureRFM22B(HwSharedRadioPortOptions radio_type,
 		uint8_t board_type, uint8_t board_rev,
 		HwSharedMaxRfPowerOptions max_power,
 		HwSharedMaxRfSpeedOptions max_speed,
+		HwSharedRfLinkModeOptions link_mode,
 		HwSharedRfBandOptions rf_band,
 		const struct pios_openlrs_cfg *openlrs_cfg,
 		const struct pios_rfm22b_cfg *rfm22b_cfg,
@@ -126,6 +127,8 @@ void PIOS_HAL_ConfigureRFM22B(HwSharedRadioPortOptions radio_type,
 		int status_inst);
 #endif /* PIOS_INCLUDE_RFM22B */
 
+uint32_t PIOS_HAL_SerialSpeedBaud(HwSharedSpeedBpsOptions speed);
+
 void PIOS_HAL_ConfigureSerialSpeed(uintptr_t com_id,
 		                HwSharedSpeedBpsOptions speed);
 
@@ -63,8 +63,6 @@
 
 typedef struct max7456_dev_s *max7456_dev_t;
 
-void PIOS_MAX7456_wait_vsync ();
-
 /**
  * @brief Allocate and initialise MAX7456 device
  * @param[out] dev_out Device handle, only valid when return value is success
@@ -121,6 +119,13 @@ void PIOS_MAX7456_put (max7456_dev_t dev, uint8_t col, uint8_t row,
 void PIOS_MAX7456_puts (max7456_dev_t dev, uint8_t col, uint8_t row,
 		const char *s, uint8_t attr);
 
+/* Between these, put and puts draw into a blank frame in RAM; ending the
+ * frame writes only the characters that differ from the last one.
+ */
+void PIOS_MAX7456_begin_frame (max7456_dev_t dev);
+
+void PIOS_MAX7456_end_frame (max7456_dev_t dev);
+
 /**
  * @brief Gets the extents of the screen.
  * @param[in] dev The max7456 device handle
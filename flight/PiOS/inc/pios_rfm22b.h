@@ -94,6 +94,7 @@ extern void PIOS_RFM22B_SetTxPower(uint32_t rfm22b_id,
 				   enum rfm22b_tx_power tx_pwr);
 extern void PIOS_RFM22B_Config(uint32_t rfm22b_id,
 					 HwSharedMaxRfSpeedOptions datarate,
+					 HwSharedRfLinkModeOptions link_mode,
 					 uint8_t min_chan,
 					 uint8_t max_chan,
 					 uint32_t coordinator_id, bool oneway,
@@ -40,6 +40,8 @@
 #include "pios_rfm22b_regs.h"
 #include "pios_semaphore.h"
 #include "pios_thread.h"
+#include "rfm22b_link.h"
+#include "ecc.h"
 
 // External type definitions
 
@@ -245,6 +247,9 @@ struct pios_rfm22b_dev {
 	uint8_t rx_packet[RFM22B_MAX_PACKET_LEN];
 	// The rx data packet
 	uint8_t *rx_packet_handle;
+	// The Reed-Solomon decoder state, kept here rather than on the
+	// task's stack
+	struct rs_decoder rs_dec;
 	// The receive buffer write index
 	uint16_t rx_buffer_wr;
 	// The receive buffer write index
@@ -271,6 +276,15 @@ struct pios_rfm22b_dev {
 	// Are we sending / receiving only PPM data?
 	bool ppm_only_mode;
 
+	// How the link uses the air
+	enum rfm22b_link_mode link_mode;
+	// The adaptive air rate state
+	struct rfm22b_link_rate link_rate;
+	// Our receive quality, as reported to the other modem
+	struct rfm22b_link_quality link_quality;
+	// A rate change waiting for the radio to be idle
+	bool link_rate_changed;
+
 	// The channel list
 	uint8_t channels[RFM22B_NUM_CHANNELS];
 	// The number of frequency hopping channels.
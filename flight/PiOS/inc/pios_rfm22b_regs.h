@@ -34,7 +34,7 @@
 
 // ************************************
 
-#define RFM22B_MAX_PACKET_LEN                     64
+#define RFM22B_MAX_PACKET_LEN                     255
 #define RFM22B_NUM_CHANNELS                       250
 
 // ************************************
@@ -0,0 +1,78 @@
+/**
+ ******************************************************************************
+ * @file       pios_trace.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_Trace Scheduler trace
+ * @{
+ * @brief Records context switches, object callbacks and queue operations
+ *        with raw timer timestamps, for timeline analysis on the host
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PIOS_TRACE_H_
+#define PIOS_TRACE_H_
+
+#include <stdint.h>
+
+//! Trace events.  Keep in step with python/dronin-tracetimeline
+enum pios_trace_event {
+	PIOS_TRACE_SWITCH = 1,		/**< data = thread switched in */
+	PIOS_TRACE_CALLBACK_ENTER,	/**< arg = event type, data = object id */
+	PIOS_TRACE_CALLBACK_EXIT,	/**< data = callback address */
+	PIOS_TRACE_QUEUE_SEND,		/**< arg = success, data = queue */
+	PIOS_TRACE_QUEUE_RECEIVE,	/**< arg = success, data = queue */
+	PIOS_TRACE_THREAD,		/**< data = thread, followed by its name */
+	PIOS_TRACE_THREAD_NAME,		/**< data = next 4 characters of the name */
+	PIOS_TRACE_SYNC,		/**< data = PIOS_DELAY_GetuS() at time */
+	PIOS_TRACE_LOST,		/**< data = records dropped since the last read */
+};
+
+//! One trace record, as it is packed into the TraceBuffer object
+struct pios_trace_record {
+	uint32_t time;		/**< PIOS_DELAY_GetRaw() */
+	uint32_t data;
+	uint16_t arg;
+	uint8_t event;
+	uint8_t reserved;
+} __attribute__((packed));
+
+#if defined(PIOS_INCLUDE_TRACE)
+
+void PIOS_TRACE_RecordI(uint8_t event, uint16_t arg, uint32_t data);
+void PIOS_TRACE_Record(uint8_t event, uint16_t arg, uint32_t data);
+void PIOS_TRACE_SwitchI(const void *thread);
+void PIOS_TRACE_Threads(void);
+void PIOS_TRACE_Sync(void);
+int PIOS_TRACE_Read(struct pios_trace_record *records, int max_records);
+
+#define PIOS_TRACE(event, arg, data) \
+	PIOS_TRACE_Record((event), (arg), (uint32_t) (uintptr_t) (data))
+
+#else
+
+#define PIOS_TRACE(event, arg, data) do { } while (0)
+
+#endif /* PIOS_INCLUDE_TRACE */
+
+#endif /* PIOS_TRACE_H_ */
+
+/**
+ * @}
+ * @}
+ */
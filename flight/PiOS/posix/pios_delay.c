@@ -175,3 +175,13 @@ uint32_t PIOS_DELAY_DiffuS2(uint32_t raw, uint32_t later) {
 	return diff;
 }
 
+/**
+ * Move the raw clock forward, for lockstep simulation.  The waits keep to
+ * real time.
+ * \param[in] uS how far to move it
+ */
+void PIOS_DELAY_SkipuS(uint32_t uS)
+{
+	base_time -= uS;
+}
+
@@ -39,8 +39,15 @@
 #include "pios_heap.h"		/* PIOS_malloc_no_dma */
 #include "pios_mutex.h"
 #include "pios_queue.h"
+#include "pios_trace.h"
 #include "misc_math.h"
 
+// Objects are packed by copying their packed structures, which only matches
+// the little-endian telemetry format on a little-endian target
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error "The UAVObject manager requires a little-endian target"
+#endif
+
 extern uintptr_t pios_uavo_settings_fs_id;
 
 // Constants
@@ -1737,7 +1744,10 @@ static int32_t pumpOneEvent(UAVObjEvent msg, void *obj_data, int len) {
 			// Invoke callback (from event task) if a valid one is registered
 			if (event->cb) {
 				// invoke callback directly; callbacks must be well behaved
+				PIOS_TRACE(PIOS_TRACE_CALLBACK_ENTER, msg.event,
+						UAVObjGetID(msg.obj));
 				invokeCallback(event, &msg, obj_data, len);
+				PIOS_TRACE(PIOS_TRACE_CALLBACK_EXIT, 0, event->cb);
 			} else if (event->cbInfo.queue) {
 				// Send to queue if a valid queue is registered
 				// will not block
@@ -43,6 +43,9 @@
 #include "uavobjectmanager.h"
 #include "$(NAMELC).h"
 
+// UAVObjPack() and UAVObjUnpack() copy the packed structure as is, so check
+// at build time that its fields are where the telemetry format puts them
+$(LAYOUTCHECKS)
 // Private variables
 static UAVObjHandle handle = NULL;
 
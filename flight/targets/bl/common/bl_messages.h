@@ -49,6 +49,10 @@ enum bl_commands {
 	BL_MSG_STATUS_REQ,
 	BL_MSG_STATUS_REP,
 	BL_MSG_WIPE_PARTITION,
+	BL_MSG_BLOCK_CRC_REQ,
+	BL_MSG_BLOCK_CRC_REP,
+	BL_MSG_WRITE_START_DIFF,
+	BL_MSG_WRITE_ACK,
 
 	BL_MSG_WRITE_START = 0x27,
 };
@@ -117,6 +121,8 @@ struct bl_messages {
 #define BL_CAP_EXTENSION_MAGIC 0x3456
 			uint16_t cap_extension_magic;
 			uint32_t partition_sizes[10];
+#define BL_XFER_FEATURE_DIFFERENTIAL 0x01 /* BLOCK_CRC_REQ, WRITE_START_DIFF */
+			uint8_t xfer_features;
 #endif	/* BL_INCLUDE_CAP_EXTENSIONS */
 		} cap_rep_specific;
 
@@ -169,6 +175,38 @@ struct bl_messages {
 			enum dfu_partition_label label;
 		} wipe_partition;
 
+		struct msg_block_crc_req {
+			enum dfu_partition_label label;
+			uint16_t first_block;
+		} block_crc_req;
+
+#define BL_BLOCK_CRCS_PER_PACKET 7
+		struct msg_block_crc_rep {
+			enum dfu_partition_label label;
+			uint16_t first_block;
+			uint16_t total_blocks;
+			uint8_t num_blocks;
+			struct msg_block_crc {
+				uint32_t size;
+				uint32_t crc;
+			} blocks[BL_BLOCK_CRCS_PER_PACKET];
+		} block_crc_rep;
+
+#define BL_MAX_DIFF_BLOCKS 384
+		struct msg_xfer_start_diff {
+			uint32_t packets_in_transfer;
+			enum dfu_partition_label label;
+			uint8_t words_in_last_packet;
+			uint32_t expected_crc;
+			uint8_t window; /* packets sent ahead of an ack, 0 for no acks */
+			uint8_t block_map[BL_MAX_DIFF_BLOCKS / 8]; /* blocks to rewrite */
+		} xfer_start_diff;
+
+		struct msg_write_ack {
+			uint32_t next_packet_number;
+			uint8_t rejected; /* a packet was out of sequence */
+		} write_ack;
+
 		uint8_t pad[62];
 	} __attribute__((aligned(1)))v;
 } __attribute__((packed));
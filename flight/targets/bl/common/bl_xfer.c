@@ -182,22 +182,24 @@ bool bl_xfer_send_next_read_packet(struct xfer_state * xfer)
 	return true;
 }
 
-bool bl_xfer_write_start(struct xfer_state * xfer, const struct msg_xfer_start *xfer_start)
+/**
+ * Find the flash region that a write to a partition label goes to
+ * @param[out] xfer transfer state to fill in with the region
+ * @param[in] label the partition label
+ * @param[out] needs_erase whether the region is erased before writing
+ * @returns false if the label cannot be written
+ */
+static bool bl_xfer_find_write_region(struct xfer_state * xfer, enum dfu_partition_label label, bool * needs_erase)
 {
-	/* Disable any previous transfer */
-	xfer->in_progress = false;
-
 	/* Recover a pointer to the bootloader board info blob */
 	const struct pios_board_info * bdinfo = &pios_board_info_blob;
 
-	/* Set up the transfer */
-	bool partition_needs_erase = true;
+	*needs_erase = true;
 
 	xfer->check_crc = true;
-	xfer->crc  = ntohl(xfer_start->expected_crc);
 	xfer->original_partition_offset = 0;
 
-	switch (xfer_start->label) {
+	switch (label) {
 #ifdef F1_UPGRADER
 	case DFU_PARTITION_BL:
 		PIOS_FLASH_find_partition_id(FLASH_PARTITION_LABEL_BL, &xfer->partition_id);
@@ -215,7 +217,7 @@ bool bl_xfer_write_start(struct xfer_state * xfer, const struct msg_xfer_start *
 		PIOS_FLASH_get_partition_size(xfer->partition_id, &xfer->partition_size);
 		xfer->original_partition_offset = bdinfo->desc_base - bdinfo->fw_base;
 		xfer->check_crc        = false;
-		partition_needs_erase  = false;
+		*needs_erase           = false;
 		break;
 	case DFU_PARTITION_SETTINGS:
 		PIOS_FLASH_find_partition_id(FLASH_PARTITION_LABEL_SETTINGS, &xfer->partition_id);
@@ -233,6 +235,23 @@ bool bl_xfer_write_start(struct xfer_state * xfer, const struct msg_xfer_start *
 		return false;
 	}
 
+	return true;
+}
+
+bool bl_xfer_write_start(struct xfer_state * xfer, const struct msg_xfer_start *xfer_start)
+{
+	/* Disable any previous transfer */
+	xfer->in_progress = false;
+	xfer->differential = false;
+	xfer->window = 0;
+
+	/* Set up the transfer */
+	bool partition_needs_erase;
+	if (!bl_xfer_find_write_region(xfer, xfer_start->label, &partition_needs_erase))
+		return false;
+
+	xfer->crc = ntohl(xfer_start->expected_crc);
+
 	/* How many bytes is the host trying to transfer? */
 	uint32_t bytes_to_xfer = (ntohl(xfer_start->packets_in_transfer) - 1) * XFER_BYTES_PER_PACKET +
 		xfer_start->words_in_last_packet * sizeof(uint32_t);
@@ -259,6 +278,8 @@ bool bl_xfer_write_start(struct xfer_state * xfer, const struct msg_xfer_start *
 	return true;
 }
 
+static bool bl_xfer_write_cont_diff(struct xfer_state * xfer, const struct msg_xfer_cont *xfer_cont);
+
 bool bl_xfer_write_cont(struct xfer_state * xfer, const struct msg_xfer_cont *xfer_cont)
 {
 	if (!xfer->in_progress) {
@@ -266,6 +287,10 @@ bool bl_xfer_write_cont(struct xfer_state * xfer, const struct msg_xfer_cont *xf
 		return false;
 	}
 
+	if (xfer->differential) {
+		return bl_xfer_write_cont_diff(xfer, xfer_cont);
+	}
+
 	if (ntohl(xfer_cont->current_packet_number) != xfer->next_packet_number) {
 		/* packet is out of sequence */
 		return false;
@@ -303,6 +328,320 @@ bool bl_xfer_write_cont(struct xfer_state * xfer, const struct msg_xfer_cont *xf
 	return true;
 }
 
+static bool bl_xfer_block_marked(const struct xfer_state * xfer, uint16_t block)
+{
+	return xfer->block_map[block / 8] & (1 << (block % 8));
+}
+
+/**
+ * Find the extents of a block, which is the flash sector holding an offset
+ * clipped to the region that the host may write
+ */
+static bool bl_xfer_get_block(const struct xfer_state * xfer, uint32_t offset,
+		uint32_t * block_start, uint32_t * block_end)
+{
+	uint32_t sector_size;
+
+	if (PIOS_FLASH_get_sector_extents(xfer->partition_id, offset, block_start, &sector_size) != 0)
+		return false;
+
+	*block_end = MIN(*block_start + sector_size, xfer->partition_size);
+
+	return true;
+}
+
+/**
+ * Move the block cursor of a differential transfer forward to the block
+ * holding an offset.  Offsets only ever increase during a transfer.
+ */
+static bool bl_xfer_seek_block(struct xfer_state * xfer, uint32_t offset)
+{
+	while (offset >= xfer->block_end) {
+		if (xfer->block_end >= xfer->partition_size)
+			return false;
+		if (!bl_xfer_get_block(xfer, xfer->block_end, &xfer->block_start, &xfer->block_end))
+			return false;
+
+		xfer->block_index++;
+	}
+
+	return true;
+}
+
+bool bl_xfer_write_start_diff(struct xfer_state * xfer, const struct msg_xfer_start_diff *xfer_start)
+{
+	/* Disable any previous transfer */
+	xfer->in_progress = false;
+
+	bool partition_needs_erase;
+	if (!bl_xfer_find_write_region(xfer, xfer_start->label, &partition_needs_erase))
+		return false;
+
+	if (!partition_needs_erase || xfer->original_partition_offset != 0) {
+		/* Only whole partitions are made of erase blocks */
+		return false;
+	}
+
+	uint32_t packets_in_transfer = ntohl(xfer_start->packets_in_transfer);
+	if (packets_in_transfer == 0)
+		return false;
+
+	uint32_t image_bytes = (packets_in_transfer - 1) * XFER_BYTES_PER_PACKET +
+		xfer_start->words_in_last_packet * sizeof(uint32_t);
+
+	if (image_bytes > xfer->partition_size)
+		return false;
+
+	xfer->crc = ntohl(xfer_start->expected_crc);
+	xfer->differential = true;
+	xfer->window = xfer_start->window;
+	memcpy(xfer->block_map, xfer_start->block_map, sizeof(xfer->block_map));
+
+	/* The transfer ends with the last byte of the image in a rewritten block */
+	uint32_t block_start = 0, block_end = 0;
+	uint16_t num_blocks = 0;
+	bool last_marked = false;
+	uint32_t end = 0;
+
+	for (uint32_t offset = 0; offset < xfer->partition_size; offset = block_end) {
+		if (num_blocks >= BL_MAX_DIFF_BLOCKS)
+			return false;
+		if (!bl_xfer_get_block(xfer, offset, &block_start, &block_end))
+			return false;
+
+		last_marked = bl_xfer_block_marked(xfer, num_blocks);
+		if (last_marked && block_start < image_bytes)
+			end = MIN(block_end, image_bytes);
+
+		num_blocks++;
+	}
+
+	/*
+	 * Anything past the writable region (the firmware description) shares
+	 * its sector with the last block or starts a sector of its own.  The
+	 * description is rewritten after the firmware and needs erased flash
+	 * either way, so the last block can't be kept if it shares the sector.
+	 */
+	uint32_t full_size;
+	PIOS_FLASH_get_partition_size(xfer->partition_id, &full_size);
+
+	uint32_t tail_start = 0, tail_size = 0;
+	if (full_size > xfer->partition_size) {
+		if (PIOS_FLASH_get_sector_extents(xfer->partition_id, xfer->partition_size,
+					&tail_start, &tail_size) != 0)
+			return false;
+
+		if (tail_start < xfer->partition_size) {
+			if (!last_marked)
+				return false;
+			tail_size = 0;
+		}
+	}
+
+	/* Erase the blocks that the host is going to rewrite */
+	PIOS_FLASH_start_transaction(xfer->partition_id);
+
+	int32_t ret = 0;
+	uint16_t block = 0;
+	for (uint32_t offset = 0; offset < xfer->partition_size && ret == 0; block++) {
+		uint32_t sector_start, sector_size;
+
+		ret = PIOS_FLASH_get_sector_extents(xfer->partition_id, offset, &sector_start, &sector_size);
+		if (ret == 0 && bl_xfer_block_marked(xfer, block))
+			ret = PIOS_FLASH_erase_range(xfer->partition_id, sector_start, sector_size);
+
+		offset = sector_start + sector_size;
+	}
+
+	if (ret == 0 && tail_size)
+		ret = PIOS_FLASH_erase_range(xfer->partition_id, tail_start, tail_size);
+
+	PIOS_FLASH_end_transaction(xfer->partition_id);
+
+	if (ret != 0)
+		return false;
+
+	xfer->block_index = 0;
+	if (!bl_xfer_get_block(xfer, 0, &xfer->block_start, &xfer->block_end))
+		return false;
+
+	xfer->current_partition_offset = 0;
+	xfer->bytes_to_xfer = end;
+	xfer->next_packet_number = 0;
+	xfer->unacked_packets = 0;
+	xfer->nak_sent = false;
+	xfer->last_duplicate = UINT32_MAX;
+	xfer->in_progress = true;
+
+	return true;
+}
+
+static void bl_xfer_send_ack(const struct xfer_state * xfer, bool rejected)
+{
+	struct bl_messages msg = {
+		.flags_command = BL_MSG_WRITE_ACK,
+		.v.write_ack = {
+			.next_packet_number = htonl(xfer->next_packet_number),
+			.rejected = rejected,
+		},
+	};
+
+	PIOS_COM_MSG_Send(PIOS_COM_TELEM_USB, (uint8_t *)&msg, sizeof(msg));
+}
+
+/**
+ * Refuse an out of sequence packet.  With a window the host is told where
+ * to resume from and the transfer carries on, otherwise the transfer fails.
+ */
+static bool bl_xfer_reject(struct xfer_state * xfer)
+{
+	if (!xfer->window)
+		return false;
+
+	/* Everything in flight after a lost packet is refused, report it once */
+	if (!xfer->nak_sent) {
+		bl_xfer_send_ack(xfer, true);
+		xfer->nak_sent = true;
+		xfer->unacked_packets = 0;
+	}
+
+	return true;
+}
+
+static bool bl_xfer_write_cont_diff(struct xfer_state * xfer, const struct msg_xfer_cont *xfer_cont)
+{
+	uint32_t packet_number = ntohl(xfer_cont->current_packet_number);
+
+	if (packet_number < xfer->next_packet_number) {
+		/* Sent again after a rewind, it has been written already */
+		if (!xfer->window)
+			return false;
+
+		/*
+		 * The host rewound because an ack was lost, tell it where to
+		 * resume.  Once per rewind: the packets of one rewind come in
+		 * increasing order, a later rewind starts again at or before
+		 * the previous duplicate.
+		 */
+		if (packet_number <= xfer->last_duplicate) {
+			bl_xfer_send_ack(xfer, false);
+			xfer->unacked_packets = 0;
+		}
+		xfer->last_duplicate = packet_number;
+
+		return true;
+	}
+
+	uint32_t offset = packet_number * XFER_BYTES_PER_PACKET;
+
+	if (offset - xfer->current_partition_offset >= xfer->bytes_to_xfer) {
+		/* Past the end of the transfer */
+		return bl_xfer_reject(xfer);
+	}
+
+	/* The host only skips packets that fall entirely in kept blocks */
+	for (uint32_t skip = xfer->current_partition_offset; skip < offset; skip = xfer->block_end) {
+		if (!bl_xfer_seek_block(xfer, skip))
+			return false;
+		if (bl_xfer_block_marked(xfer, xfer->block_index))
+			return bl_xfer_reject(xfer);
+	}
+
+	uint32_t bytes_this_xfer = MIN(XFER_BYTES_PER_PACKET,
+			xfer->bytes_to_xfer - (offset - xfer->current_partition_offset));
+
+	/* Fix up the endian of the data words */
+	for (uint8_t i = 0; i < bytes_this_xfer / sizeof(uint32_t); i++) {
+		uint32_t *data = &((uint32_t *)xfer_cont->data)[i];
+		*data = ntohl(*data);
+	}
+
+	/* Write the parts of the packet that fall in rewritten blocks */
+	PIOS_FLASH_start_transaction(xfer->partition_id);
+
+	for (uint32_t pos = offset; pos < offset + bytes_this_xfer; pos = xfer->block_end) {
+		if (!bl_xfer_seek_block(xfer, pos)) {
+			PIOS_FLASH_end_transaction(xfer->partition_id);
+			return false;
+		}
+
+		if (bl_xfer_block_marked(xfer, xfer->block_index)) {
+			uint32_t end = MIN(xfer->block_end, offset + bytes_this_xfer);
+
+			PIOS_FLASH_write_data(xfer->partition_id, pos,
+					&xfer_cont->data[pos - offset], end - pos);
+		}
+	}
+
+	PIOS_FLASH_end_transaction(xfer->partition_id);
+
+	/* Update accounting, including any packets skipped over */
+	xfer->bytes_to_xfer            -= offset + bytes_this_xfer - xfer->current_partition_offset;
+	xfer->current_partition_offset  = offset + bytes_this_xfer;
+
+	xfer->next_packet_number = packet_number + 1;
+	xfer->nak_sent = false;
+	xfer->last_duplicate = UINT32_MAX;
+
+	if (xfer->window) {
+		xfer->unacked_packets++;
+
+		/* Ack twice per window so the host never runs dry */
+		if (xfer->unacked_packets >= (xfer->window + 1) / 2 || xfer->bytes_to_xfer == 0) {
+			bl_xfer_send_ack(xfer, false);
+			xfer->unacked_packets = 0;
+		}
+	}
+
+	return true;
+}
+
+bool bl_xfer_send_block_crcs(const struct msg_block_crc_req *block_crc_req)
+{
+	struct xfer_state region;
+
+	bool partition_needs_erase;
+	if (!bl_xfer_find_write_region(&region, block_crc_req->label, &partition_needs_erase))
+		return false;
+
+	if (!partition_needs_erase || region.original_partition_offset != 0)
+		return false;
+
+	struct bl_messages msg = {
+		.flags_command = BL_MSG_BLOCK_CRC_REP,
+		.v.block_crc_rep = {
+			.label       = block_crc_req->label,
+			.first_block = block_crc_req->first_block,
+		},
+	};
+
+	uint16_t first_block = ntohs(block_crc_req->first_block);
+	uint16_t block = 0;
+	uint8_t num_blocks = 0;
+	uint32_t block_start, block_end;
+
+	for (uint32_t offset = 0; offset < region.partition_size; offset = block_end, block++) {
+		if (!bl_xfer_get_block(&region, offset, &block_start, &block_end))
+			return false;
+
+		if (block >= first_block && num_blocks < BL_BLOCK_CRCS_PER_PACKET) {
+			uint32_t size = block_end - block_start;
+			uint32_t crc = bl_compute_partition_crc(region.partition_id, block_start, size);
+
+			msg.v.block_crc_rep.blocks[num_blocks].size = htonl(size);
+			msg.v.block_crc_rep.blocks[num_blocks].crc  = htonl(crc);
+			num_blocks++;
+		}
+	}
+
+	msg.v.block_crc_rep.total_blocks = htons(block);
+	msg.v.block_crc_rep.num_blocks   = num_blocks;
+
+	PIOS_COM_MSG_Send(PIOS_COM_TELEM_USB, (uint8_t *)&msg, sizeof(msg));
+
+	return true;
+}
+
 bool bl_xfer_wipe_partition(const struct msg_wipe_partition *wipe_partition)
 {
 	enum pios_flash_partition_labels flash_label;
@@ -366,6 +705,7 @@ bool bl_xfer_send_capabilities_self(void)
 #if defined(BL_INCLUDE_CAP_EXTENSIONS)
 	/* Fill in capabilities extensions */
 	msg.v.cap_rep_specific.cap_extension_magic = BL_CAP_EXTENSION_MAGIC;
+	msg.v.cap_rep_specific.xfer_features = BL_XFER_FEATURE_DIFFERENTIAL;
 
 	uintptr_t partition_id;
 	uint32_t partition_size;
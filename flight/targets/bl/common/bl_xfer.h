@@ -45,6 +45,19 @@ struct xfer_state {
 	uint32_t crc;
 
 	uint32_t bytes_to_xfer;
+
+	/* Differential writes only rewrite the blocks marked in block_map */
+	bool     differential;
+	uint8_t  block_map[BL_MAX_DIFF_BLOCKS / 8];
+	uint16_t block_index;
+	uint32_t block_start;
+	uint32_t block_end;
+
+	/* Windowed writes are acked every half window */
+	uint8_t  window;
+	uint8_t  unacked_packets;
+	bool     nak_sent;
+	uint32_t last_duplicate;
 };
 
 extern bool bl_xfer_completed_p(const struct xfer_state * xfer);
@@ -53,6 +66,8 @@ extern bool bl_xfer_read_start(struct xfer_state * xfer, const struct msg_xfer_s
 extern bool bl_xfer_send_next_read_packet(struct xfer_state * xfer);
 extern bool bl_xfer_write_start(struct xfer_state * xfer, const struct msg_xfer_start *xfer_start);
 extern bool bl_xfer_write_cont(struct xfer_state * xfer, const struct msg_xfer_cont *xfer_cont);
+extern bool bl_xfer_write_start_diff(struct xfer_state * xfer, const struct msg_xfer_start_diff *xfer_start);
+extern bool bl_xfer_send_block_crcs(const struct msg_block_crc_req *block_crc_req);
 extern bool bl_xfer_wipe_partition(const struct msg_wipe_partition *wipe_partition);
 extern bool bl_xfer_send_capabilities_self(void);
 
@@ -623,6 +623,13 @@ static void process_packet_rx(struct bl_fsm_context * context, const struct bl_m
 			/* Failed to start the write */
 		}
 		break;
+	case BL_MSG_WRITE_START_DIFF:
+		if (bl_xfer_write_start_diff(&context->xfer, &(msg->v.xfer_start_diff))) {
+			bl_fsm_inject_event(context, BL_EVENT_WRITE_START);
+		} else {
+			/* Failed to start the write */
+		}
+		break;
 	case BL_MSG_WRITE_CONT:
 		if (bl_fsm_get_state(context) == BL_STATE_DFU_WRITE_IN_PROGRESS) {
 			if (!bl_xfer_write_cont(&context->xfer, &(msg->v.xfer_cont))) {
@@ -662,9 +669,15 @@ static void process_packet_rx(struct bl_fsm_context * context, const struct bl_m
 		bl_xfer_wipe_partition(&(msg->v.wipe_partition));
 		break;
 
+	case BL_MSG_BLOCK_CRC_REQ:
+		bl_xfer_send_block_crcs(&(msg->v.block_crc_req));
+		break;
+
 	case BL_MSG_CAP_REP:
 	case BL_MSG_STATUS_REP:
 	case BL_MSG_READ_CONT:
+	case BL_MSG_BLOCK_CRC_REP:
+	case BL_MSG_WRITE_ACK:
 		/* We've received a *reply* packet when we expected a request. */
 		break;
 	case BL_MSG_RESERVED:
@@ -516,6 +516,7 @@ void PIOS_Board_Init(void) {
 					bdinfo->board_type, bdinfo->board_rev,
 					hwRevoMini.MaxRfPower,
 					hwRevoMini.MaxRfSpeed,
+					hwRevoMini.RfLinkMode,
 					hwRevoMini.RfBand,
 					openlrs_cfg, rfm22b_cfg,
 					hwRevoMini.MinChannel,
@@ -514,10 +514,20 @@ halrtcnt_t hal_lld_get_counter_value(void);
  * @brief   Context switch hook.
  * @details This hook is invoked just before switching between threads.
  */
+#if defined(PIOS_INCLUDE_TRACE)
+#define TRACE_CONTEXT_SWITCH(ntp) {                                         \
+  extern void PIOS_TRACE_SwitchI(const void *thread);                       \
+  PIOS_TRACE_SwitchI(ntp);                                                  \
+}
+#else
+#define TRACE_CONTEXT_SWITCH(ntp) {}
+#endif
+
 #if !defined(THREAD_CONTEXT_SWITCH_HOOK) || defined(__DOXYGEN__)
 #define THREAD_CONTEXT_SWITCH_HOOK(ntp, otp) {                              \
   ntp->ticks_switched_in = halGetCounterValue();                            \
   otp->ticks_total += ntp->ticks_switched_in - otp->ticks_switched_in;      \
+  TRACE_CONTEXT_SWITCH(ntp);                                                \
   /* System halt code here.*/                                               \
 }
 #endif
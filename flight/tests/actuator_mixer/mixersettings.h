@@ -0,0 +1,99 @@
+/**
+ ******************************************************************************
+ * @file       mixersettings.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Stand-in for the generated MixerSettings UAVObject
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef MIXERSETTINGS_H
+#define MIXERSETTINGS_H
+
+#include <stdint.h>
+
+typedef enum {
+	MIXERSETTINGS_CURVE2SOURCE_THROTTLE = 0,
+	MIXERSETTINGS_CURVE2SOURCE_ROLL = 1,
+	MIXERSETTINGS_CURVE2SOURCE_PITCH = 2,
+	MIXERSETTINGS_CURVE2SOURCE_YAW = 3,
+	MIXERSETTINGS_CURVE2SOURCE_COLLECTIVE = 4,
+	MIXERSETTINGS_CURVE2SOURCE_ACCESSORY0 = 5,
+	MIXERSETTINGS_CURVE2SOURCE_ACCESSORY1 = 6,
+	MIXERSETTINGS_CURVE2SOURCE_ACCESSORY2 = 7,
+	MIXERSETTINGS_CURVE2SOURCE_ACCESSORY3 = 8,
+	MIXERSETTINGS_CURVE2SOURCE_ACCESSORY4 = 9,
+	MIXERSETTINGS_CURVE2SOURCE_ACCESSORY5 = 10
+} MixerSettingsCurve2SourceOptions;
+
+typedef enum {
+	MIXERSETTINGS_MIXER1TYPE_DISABLED = 0,
+	MIXERSETTINGS_MIXER1TYPE_MOTOR = 1,
+	MIXERSETTINGS_MIXER1TYPE_SERVO = 2,
+	MIXERSETTINGS_MIXER1TYPE_CAMERAROLL = 3,
+	MIXERSETTINGS_MIXER1TYPE_CAMERAPITCH = 4,
+	MIXERSETTINGS_MIXER1TYPE_CAMERAYAW = 5,
+	MIXERSETTINGS_MIXER1TYPE_ACCESSORY0 = 6,
+	MIXERSETTINGS_MIXER1TYPE_ACCESSORY1 = 7,
+	MIXERSETTINGS_MIXER1TYPE_ACCESSORY2 = 8,
+	MIXERSETTINGS_MIXER1TYPE_ACCESSORY3 = 9,
+	MIXERSETTINGS_MIXER1TYPE_ACCESSORY4 = 10,
+	MIXERSETTINGS_MIXER1TYPE_ACCESSORY5 = 11
+} MixerSettingsMixer1TypeOptions;
+
+typedef enum {
+	MIXERSETTINGS_MIXER1VECTOR_THROTTLECURVE1 = 0,
+	MIXERSETTINGS_MIXER1VECTOR_THROTTLECURVE2 = 1,
+	MIXERSETTINGS_MIXER1VECTOR_ROLL = 2,
+	MIXERSETTINGS_MIXER1VECTOR_PITCH = 3,
+	MIXERSETTINGS_MIXER1VECTOR_YAW = 4
+} MixerSettingsMixer1VectorElem;
+
+#define MIXERSETTINGS_MIXER1VECTOR_NUMELEM 5
+#define MIXERSETTINGS_THROTTLECURVE1_NUMELEM 5
+#define MIXERSETTINGS_THROTTLECURVE2_NUMELEM 5
+
+typedef struct {
+	float ThrottleCurve1[5];
+	float ThrottleCurve2[5];
+	uint8_t Curve2Source;
+	uint8_t Mixer1Type;
+	int8_t Mixer1Vector[5];
+	uint8_t Mixer2Type;
+	int8_t Mixer2Vector[5];
+	uint8_t Mixer3Type;
+	int8_t Mixer3Vector[5];
+	uint8_t Mixer4Type;
+	int8_t Mixer4Vector[5];
+	uint8_t Mixer5Type;
+	int8_t Mixer5Vector[5];
+	uint8_t Mixer6Type;
+	int8_t Mixer6Vector[5];
+	uint8_t Mixer7Type;
+	int8_t Mixer7Vector[5];
+	uint8_t Mixer8Type;
+	int8_t Mixer8Vector[5];
+	uint8_t Mixer9Type;
+	int8_t Mixer9Vector[5];
+	uint8_t Mixer10Type;
+	int8_t Mixer10Vector[5];
+} MixerSettingsData;
+
+#endif /* MIXERSETTINGS_H */
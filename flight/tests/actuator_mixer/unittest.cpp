@@ -0,0 +1,364 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test and benchmark for the compiled actuator mixer
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <math.h>		/* sinf */
+#include <vector>
+#include <stdio.h>		/* printf */
+#include <stdint.h>		/* uint*_t */
+#include <string.h>		/* memset */
+#include <time.h>		/* clock_gettime */
+
+extern "C" {
+
+#include "actuator_mixer.h"
+
+}
+
+/* The mixing as the actuator loop did it, for every channel every cycle */
+#define MULTIROTOR_MIXER_UPPER_BOUND 128
+
+static MixerSettingsData mixerSettings;
+
+static MixerSettingsMixer1TypeOptions get_mixer_type(int idx)
+{
+  switch (idx) {
+  case 0: return (MixerSettingsMixer1TypeOptions) mixerSettings.Mixer1Type;
+  case 1: return (MixerSettingsMixer1TypeOptions) mixerSettings.Mixer2Type;
+  case 2: return (MixerSettingsMixer1TypeOptions) mixerSettings.Mixer3Type;
+  case 3: return (MixerSettingsMixer1TypeOptions) mixerSettings.Mixer4Type;
+  case 4: return (MixerSettingsMixer1TypeOptions) mixerSettings.Mixer5Type;
+  case 5: return (MixerSettingsMixer1TypeOptions) mixerSettings.Mixer6Type;
+  case 6: return (MixerSettingsMixer1TypeOptions) mixerSettings.Mixer7Type;
+  case 7: return (MixerSettingsMixer1TypeOptions) mixerSettings.Mixer8Type;
+  case 8: return (MixerSettingsMixer1TypeOptions) mixerSettings.Mixer9Type;
+  case 9: return (MixerSettingsMixer1TypeOptions) mixerSettings.Mixer10Type;
+  default: abort();
+  }
+}
+
+static int8_t (*get_mixer_vec(int idx))[5]
+{
+  switch (idx) {
+  case 0: return &mixerSettings.Mixer1Vector;
+  case 1: return &mixerSettings.Mixer2Vector;
+  case 2: return &mixerSettings.Mixer3Vector;
+  case 3: return &mixerSettings.Mixer4Vector;
+  case 4: return &mixerSettings.Mixer5Vector;
+  case 5: return &mixerSettings.Mixer6Vector;
+  case 6: return &mixerSettings.Mixer7Vector;
+  case 7: return &mixerSettings.Mixer8Vector;
+  case 8: return &mixerSettings.Mixer9Vector;
+  case 9: return &mixerSettings.Mixer10Vector;
+  default: abort();
+  }
+}
+
+static float __attribute__((noinline)) process_mixer(const int index, const float curve1,
+    const float curve2, const float roll, const float pitch, const float yaw)
+{
+  int8_t (*vector)[5] = get_mixer_vec(index);
+
+  float result = (((*vector)[MIXERSETTINGS_MIXER1VECTOR_THROTTLECURVE1] * curve1) +
+      ((*vector)[MIXERSETTINGS_MIXER1VECTOR_THROTTLECURVE2] * curve2) +
+      ((*vector)[MIXERSETTINGS_MIXER1VECTOR_ROLL] * roll) +
+      ((*vector)[MIXERSETTINGS_MIXER1VECTOR_PITCH] * pitch) +
+      ((*vector)[MIXERSETTINGS_MIXER1VECTOR_YAW] * yaw)) * (1.0f / MULTIROTOR_MIXER_UPPER_BOUND);
+
+  return (result);
+}
+
+static void reference_mix(const float in[MIXER_NUM_INPUTS], float out[MIXER_MAX_CHANNELS])
+{
+  for (int ct = 0; ct < MIXER_MAX_CHANNELS; ct++) {
+    switch (get_mixer_type(ct)) {
+    case MIXERSETTINGS_MIXER1TYPE_SERVO:
+    case MIXERSETTINGS_MIXER1TYPE_MOTOR:
+      out[ct] = process_mixer(ct, in[MIXER_INPUT_CURVE1], in[MIXER_INPUT_CURVE2],
+          in[MIXER_INPUT_ROLL], in[MIXER_INPUT_PITCH], in[MIXER_INPUT_YAW]);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+/* Mixers for each airframe type, roughly as the vehicle setup wizard
+ * writes them */
+struct airframe {
+  const char *name;
+  int num;
+  uint8_t type[MIXER_MAX_CHANNELS];
+  int8_t vec[MIXER_MAX_CHANNELS][5];
+};
+
+#define M MIXERSETTINGS_MIXER1TYPE_MOTOR
+#define S MIXERSETTINGS_MIXER1TYPE_SERVO
+#define D MIXERSETTINGS_MIXER1TYPE_DISABLED
+
+static void add_multirotor(struct airframe *a, const char *name, int motors,
+    float first_deg, bool coax)
+{
+  a->name = name;
+  a->num = motors;
+
+  for (int i = 0; i < motors; i++) {
+    int arm = coax ? i / 2 : i;
+    float angle = (first_deg + arm * 360.0f / (coax ? motors / 2 : motors)) * (float) M_PI / 180;
+    int dir = coax ? ((i & 1) ? 1 : -1) : ((i & 1) ? -1 : 1);
+
+    a->type[i] = M;
+    a->vec[i][0] = 127;
+    a->vec[i][1] = 0;
+    a->vec[i][2] = (int8_t) lrintf(-sinf(angle) * 100);
+    a->vec[i][3] = (int8_t) lrintf(cosf(angle) * 100);
+    a->vec[i][4] = dir * 64;
+  }
+}
+
+static std::vector<struct airframe> airframes()
+{
+  std::vector<struct airframe> v;
+  struct airframe a;
+
+  memset(&a, 0, sizeof(a)); add_multirotor(&a, "QuadX", 4, 45, false); v.push_back(a);
+  memset(&a, 0, sizeof(a)); add_multirotor(&a, "QuadP", 4, 0, false); v.push_back(a);
+  memset(&a, 0, sizeof(a)); add_multirotor(&a, "Hexa", 6, 0, false); v.push_back(a);
+  memset(&a, 0, sizeof(a)); add_multirotor(&a, "HexaX", 6, 30, false); v.push_back(a);
+  memset(&a, 0, sizeof(a)); add_multirotor(&a, "HexaCoax", 6, 0, true); v.push_back(a);
+  memset(&a, 0, sizeof(a)); add_multirotor(&a, "Octo", 8, 0, false); v.push_back(a);
+  memset(&a, 0, sizeof(a)); add_multirotor(&a, "OctoV", 8, 22.5f, false); v.push_back(a);
+  memset(&a, 0, sizeof(a)); add_multirotor(&a, "OctoCoaxP", 8, 0, true); v.push_back(a);
+  memset(&a, 0, sizeof(a)); add_multirotor(&a, "OctoCoaxX", 8, 45, true); v.push_back(a);
+
+  /* Tri: three motors and a yaw servo, on channel 5 behind a gap */
+  memset(&a, 0, sizeof(a)); add_multirotor(&a, "Tri", 3, 60, false);
+  for (int i = 0; i < 3; i++)
+    a.vec[i][4] = 0;
+  a.num = 5;
+  a.type[4] = S;
+  a.vec[4][4] = 127;
+  v.push_back(a);
+
+  struct airframe fixed[] = {
+    { "FixedWing", 4, { M, S, S, S },
+      { { 127 }, { 0, 0, 127 }, { 0, 0, 0, 127 }, { 0, 0, 0, 0, 127 } } },
+    { "FixedWingElevon", 3, { M, S, S },
+      { { 127 }, { 0, 0, 127, 127 }, { 0, 0, -127, 127 } } },
+    { "FixedWingVtail", 4, { M, S, S, S },
+      { { 127 }, { 0, 0, 127 }, { 0, 0, 0, 127, 127 }, { 0, 0, 0, 127, -127 } } },
+    { "VTOL", 6, { M, M, M, M, S, S },
+      { { 127, 0, -64, 64, 64 }, { 127, 0, -64, -64, -64 }, { 127, 0, 64, -64, 64 },
+        { 127, 0, 64, 64, -64 }, { 0, 0, 127 }, { 0, 0, 0, 127 } } },
+    /* Swashplate servos on the collective curve, tail on yaw */
+    { "HeliCP", 5, { M, S, S, S, S },
+      { { 127 }, { 0, 127, 127, 64 }, { 0, 127, -127, 64 }, { 0, 127, 0, -127 },
+        { 0, 0, 0, 0, 127 } } },
+    { "GroundVehicleCar", 2, { S, M },
+      { { 0, 0, 0, 0, 127 }, { 127 } } },
+    { "GroundVehicleDifferential", 2, { M, M },
+      { { 127, 0, 0, 0, 127 }, { 127, 0, 0, 0, -127 } } },
+    { "GroundVehicleMotorcycle", 2, { S, M },
+      { { 0, 0, 0, 0, 127 }, { 127, 0, 0, 0, 64 } } },
+    /* Everything at once, extremes included */
+    { "Custom", 10, { M, D, S, MIXERSETTINGS_MIXER1TYPE_CAMERAPITCH, M,
+        MIXERSETTINGS_MIXER1TYPE_ACCESSORY2, S, M, D, S },
+      { { 127, -128, 127, -128, 1 }, { 50, 50, 50, 50, 50 }, { -1, 1, -1, 1, -1 },
+        { 127 }, { 0, 127, 0, 0, 0 }, { 127 }, { 3, 5, 7, 11, 13 },
+        { -128, -128, -128, -128, -128 }, { 1 }, { 0, 0, 0, 0, 0 } } },
+  };
+
+  for (unsigned int i = 0; i < sizeof(fixed) / sizeof(*fixed); i++)
+    v.push_back(fixed[i]);
+
+  return v;
+}
+
+static void load_airframe(const struct airframe *a)
+{
+  memset(&mixerSettings, 0, sizeof(mixerSettings));
+
+  for (int ct = 0; ct < MIXER_MAX_CHANNELS; ct++) {
+    int8_t (*vec)[5] = get_mixer_vec(ct);
+
+    memcpy(*vec, a->vec[ct], sizeof(*vec));
+
+    /* The type fields are not an array either */
+    uint8_t *type = (uint8_t *) *vec - 1;
+    *type = a->type[ct];
+  }
+}
+
+static uint32_t next_random(uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 16;
+}
+
+static float random_input(uint32_t *seed, float lo, float hi)
+{
+  return lo + (hi - lo) * (next_random(seed) % 10001) / 10000.0f;
+}
+
+static void random_inputs(uint32_t *seed, float in[MIXER_NUM_INPUTS])
+{
+  in[MIXER_INPUT_CURVE1] = random_input(seed, 0, 1);
+  in[MIXER_INPUT_CURVE2] = random_input(seed, -1, 1);
+  in[MIXER_INPUT_ROLL] = random_input(seed, -1, 1);
+  in[MIXER_INPUT_PITCH] = random_input(seed, -1, 1);
+  in[MIXER_INPUT_YAW] = random_input(seed, -1, 1);
+}
+
+static double now_s()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+class ActuatorMixer : public testing::Test {
+};
+
+TEST_F(ActuatorMixer, StubLayout) {
+  /* load_airframe() relies on each type preceding its vector */
+  EXPECT_EQ((uint8_t *) mixerSettings.Mixer1Vector - 1, &mixerSettings.Mixer1Type);
+  EXPECT_EQ((uint8_t *) mixerSettings.Mixer10Vector - 1, &mixerSettings.Mixer10Type);
+}
+
+TEST_F(ActuatorMixer, Compile) {
+  std::vector<struct airframe> all = airframes();
+  struct mixer_matrix m;
+
+  for (unsigned int i = 0; i < all.size(); i++) {
+    load_airframe(&all[i]);
+    mixer_matrix_compile(&m, &mixerSettings);
+
+    int enabled = 0, rows = 0;
+    uint16_t motors = 0;
+
+    for (int ct = 0; ct < MIXER_MAX_CHANNELS; ct++) {
+      EXPECT_EQ(get_mixer_type(ct), m.type[ct]);
+
+      if (m.type[ct] != D)
+        enabled++;
+      if (m.type[ct] == M)
+        motors |= 1 << ct;
+      if (m.type[ct] == M || m.type[ct] == S) {
+        EXPECT_EQ(ct, m.row_channel[rows++]) << all[i].name;
+      }
+
+      EXPECT_EQ(m.type[ct] == M, mixer_matrix_is_motor(&m, ct));
+    }
+
+    EXPECT_EQ(enabled, m.num_enabled) << all[i].name;
+    EXPECT_EQ(rows, m.num_rows) << all[i].name;
+    EXPECT_EQ(motors, m.motor_mask) << all[i].name;
+  }
+}
+
+TEST_F(ActuatorMixer, SameAsPerChannelMixing) {
+  std::vector<struct airframe> all = airframes();
+  struct mixer_matrix m;
+  uint32_t seed = 1;
+
+  for (unsigned int i = 0; i < all.size(); i++) {
+    load_airframe(&all[i]);
+    mixer_matrix_compile(&m, &mixerSettings);
+
+    for (int n = 0; n < 10000; n++) {
+      float in[MIXER_NUM_INPUTS];
+      float expected[MIXER_MAX_CHANNELS], actual[MIXER_MAX_CHANNELS];
+
+      random_inputs(&seed, in);
+
+      /* Full scale inputs as well */
+      if (n < 32) {
+        for (int k = 0; k < MIXER_NUM_INPUTS; k++)
+          in[k] = (n & (1 << k)) ? 1 : (k == MIXER_INPUT_CURVE1 ? 0 : -1);
+      }
+
+      for (int ct = 0; ct < MIXER_MAX_CHANNELS; ct++)
+        expected[ct] = actual[ct] = -42;
+
+      reference_mix(in, expected);
+      mixer_matrix_mix(&m, in, actual);
+
+      /* Bit for bit, and other channels are left alone */
+      ASSERT_EQ(0, memcmp(expected, actual, sizeof(actual))) << all[i].name;
+    }
+  }
+}
+
+TEST_F(ActuatorMixer, Benchmark) {
+  std::vector<struct airframe> all = airframes();
+  struct mixer_matrix m;
+  const int cycles = 200000;
+  static float inputs[256][MIXER_NUM_INPUTS];
+  uint32_t seed = 2;
+  volatile float sink = 0;
+
+  for (int n = 0; n < 256; n++)
+    random_inputs(&seed, inputs[n]);
+
+  for (unsigned int i = 0; i < all.size(); i++) {
+    float out[MIXER_MAX_CHANNELS] = {};
+
+    load_airframe(&all[i]);
+
+    double start = now_s();
+    for (int n = 0; n < cycles; n++) {
+      reference_mix(inputs[n & 255], out);
+      sink += out[n % MIXER_MAX_CHANNELS];
+    }
+    double per_channel_s = now_s() - start;
+
+    start = now_s();
+    for (int n = 0; n < cycles; n++) {
+      if ((n & 4095) == 0)
+        mixer_matrix_compile(&m, &mixerSettings);	/* Compiling is rare */
+      mixer_matrix_mix(&m, inputs[n & 255], out);
+      sink += out[n % MIXER_MAX_CHANNELS];
+    }
+    double matrix_s = now_s() - start;
+
+    printf("%-26s %6.1f ns per cycle per channel, %6.1f ns matrix\n",
+        all[i].name, per_channel_s / cycles * 1e9, matrix_s / cycles * 1e9);
+  }
+}
+
+/**
+ * @}
+ * @}
+ */
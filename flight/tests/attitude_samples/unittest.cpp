@@ -0,0 +1,334 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for queueing gyro samples to the attitude estimators
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdint.h>		/* uint*_t */
+#include <math.h>		/* sinf */
+#include <pthread.h>		/* pthread_create */
+#include <unistd.h>		/* usleep */
+
+extern "C" {
+
+#include "attitude_samples.h"
+
+}
+
+/* As the attitude module makes them */
+#define DEPTH 32
+
+/*
+ * The sensors task publishes gyro samples at a fixed rate with some jitter,
+ * and the attitude task wakes up at irregular intervals to integrate what
+ * was published since it last ran.  Time is in microseconds, as the raw
+ * time of the simulator.
+ */
+
+/* A roll rate in deg/s, and the angle it integrates to */
+static float roll_rate(double t)
+{
+  return 50 + 200 * sin(2 * M_PI * 3 * t);
+}
+
+static double roll_angle(double t)
+{
+  return 50 * t + 200 / (2 * M_PI * 3) * (1 - cos(2 * M_PI * 3 * t));
+}
+
+struct sim_result {
+  uint32_t published;
+  uint32_t integrated;
+  uint32_t spilled;
+  double elapsed;	/* Between the first and the last sample integrated */
+  double integrated_dt;
+  double angle_error;
+  double latest_only_angle_error;	/* Integrating the UAVO on each wakeup */
+};
+
+class AttitudeSamples : public testing::Test {
+protected:
+  virtual void SetUp() {
+    seed = 1;
+    ASSERT_EQ(0, attitude_samples_init(&samples, DEPTH));
+  }
+
+  uint32_t next_random() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+  }
+
+  void push(uint32_t now, float rate) {
+    const float gyro[3] = { rate, 0, 0 };
+    const float accel[3] = { 0, 0, -9.81f };
+    attitude_samples_push(&samples, now, gyro, accel);
+  }
+
+  /*
+   * Run the producer at rate_hz for seconds, the consumer waking up
+   * every wake_min_us to wake_max_us and stalling for stall_us every
+   * 100 ms.
+   */
+  struct sim_result simulate(uint32_t rate_hz, double seconds, uint32_t start,
+      uint32_t wake_min_us, uint32_t wake_max_us, uint32_t stall_us) {
+    struct sim_result r = { 0, 0, 0, 0, 0, 0, 0 };
+
+    const uint32_t period = 1000000 / rate_hz;
+    const uint32_t end = (uint32_t) (seconds * 1e6);
+
+    attitude_samples_restart(&samples, start);
+
+    uint32_t next_sample = period;
+    uint32_t next_wake = wake_min_us;
+    uint32_t next_stall = 100000;
+    uint32_t last_wake = 0;
+
+    double angle = 0, latest_only_angle = 0;
+    float latest = roll_rate(0);
+
+    for (uint32_t t = 0; t < end; t++) {
+      if (t == next_sample) {
+        latest = roll_rate(t * 1e-6);
+        push(start + t, latest);
+        r.published++;
+
+        /* Up to 10% jitter */
+        next_sample += period - period / 20 + next_random() % (period / 10 + 1);
+      }
+
+      if (t == next_wake) {
+        struct attitude_sample sample;
+        float dt;
+
+        while (attitude_samples_take(&samples, &sample, &dt)) {
+          angle += sample.gyro[0] * dt;
+          r.integrated_dt += dt;
+          r.elapsed = (sample.raw_time - start) * 1e-6;
+          r.integrated++;
+        }
+
+        /* What one UAVO read per wakeup would have integrated */
+        latest_only_angle += latest * (t - last_wake) * 1e-6;
+        last_wake = t;
+
+        next_wake += wake_min_us + next_random() % (wake_max_us - wake_min_us + 1);
+
+        if (next_wake >= next_stall) {
+          next_wake += stall_us;
+          next_stall += 100000;
+        }
+      }
+    }
+
+    r.spilled = samples.spilled;
+    r.angle_error = fabs(angle - roll_angle(r.elapsed));
+    r.latest_only_angle_error = fabs(latest_only_angle - roll_angle(last_wake * 1e-6));
+
+    return r;
+  }
+
+  struct attitude_samples samples;
+  uint32_t seed;
+};
+
+TEST_F(AttitudeSamples, NoSamplesLost) {
+  const uint32_t rates[] = { 500, 1000, 2000, 4000, 8000 };
+
+  for (unsigned int i = 0; i < sizeof(rates) / sizeof(*rates); i++) {
+    samples.spilled = 0;
+
+    struct sim_result r = simulate(rates[i], 5, 1000, 500, 3000, 0);
+
+    EXPECT_EQ(0U, r.spilled) << rates[i] << " Hz";
+
+    /* Only what was published after the last wakeup is left */
+    EXPECT_GE(r.published, r.integrated);
+    EXPECT_LE(r.published - r.integrated, rates[i] * 3 / 1000 + 1) << rates[i] << " Hz";
+
+    /* Each sample is integrated over its own time step */
+    EXPECT_NEAR(r.elapsed, r.integrated_dt, 1e-4) << rates[i] << " Hz";
+    EXPECT_LT(r.angle_error, 0.5) << rates[i] << " Hz";
+
+    printf("%4u Hz: %6u samples, angle error %.3f deg, %.3f deg when "
+        "integrating the latest sample per wakeup\n", rates[i], r.integrated,
+        r.angle_error, r.latest_only_angle_error);
+  }
+}
+
+TEST_F(AttitudeSamples, Stalls) {
+  /* A 4 ms stall fits in the queue at 8 kHz */
+  struct sim_result r = simulate(8000, 2, 1000, 500, 1000, 3000);
+  EXPECT_EQ(0U, r.spilled);
+  EXPECT_NEAR(r.elapsed, r.integrated_dt, 1e-4);
+
+  /* A 10 ms stall does not, but the time of the lost samples is still
+   * integrated over by the next one */
+  samples.spilled = 0;
+  r = simulate(8000, 2, 1000, 500, 1000, 9000);
+  EXPECT_GT(r.spilled, 0U);
+  EXPECT_LE(r.integrated + r.spilled, r.published);
+  EXPECT_GE(r.integrated + r.spilled + 8, r.published);
+  EXPECT_NEAR(r.elapsed, r.integrated_dt, 1e-4);
+  EXPECT_LT(r.angle_error, 2.0);
+}
+
+TEST_F(AttitudeSamples, Wraparound) {
+  struct sim_result r = simulate(2000, 1, 0xfffc0000, 500, 3000, 0);
+
+  EXPECT_EQ(0U, r.spilled);
+  EXPECT_NEAR(r.elapsed, r.integrated_dt, 1e-4);
+  EXPECT_LT(r.angle_error, 0.5);
+}
+
+TEST_F(AttitudeSamples, TimeSteps) {
+  struct attitude_sample sample;
+  float dt;
+
+  attitude_samples_restart(&samples, 1000);
+  EXPECT_FALSE(attitude_samples_take(&samples, &sample, &dt));
+
+  push(1500, 1);
+  push(1500, 2);
+  push(1625, 3);
+  push(100000, 4);
+
+  ASSERT_TRUE(attitude_samples_take(&samples, &sample, &dt));
+  EXPECT_EQ(1500U, sample.raw_time);
+  EXPECT_EQ(1, sample.gyro[0]);
+  EXPECT_FLOAT_EQ(0.0005f, dt);
+
+  /* Too short, or too long, e.g. after a mode switch */
+  ASSERT_TRUE(attitude_samples_take(&samples, &sample, &dt));
+  EXPECT_FLOAT_EQ(ATTITUDE_SAMPLES_MIN_DT, dt);
+  ASSERT_TRUE(attitude_samples_take(&samples, &sample, &dt));
+  EXPECT_FLOAT_EQ(0.000125f, dt);
+  ASSERT_TRUE(attitude_samples_take(&samples, &sample, &dt));
+  EXPECT_EQ(4, sample.gyro[0]);
+  EXPECT_FLOAT_EQ(ATTITUDE_SAMPLES_MAX_DT, dt);
+
+  EXPECT_FALSE(attitude_samples_take(&samples, &sample, &dt));
+}
+
+TEST_F(AttitudeSamples, Restart) {
+  struct attitude_sample sample;
+  float dt;
+
+  for (int i = 0; i < DEPTH + 5; i++)
+    push(i * 100, i);
+
+  EXPECT_EQ(5U, samples.spilled);
+
+  /* A filter being reinitialized drops what was queued for it */
+  attitude_samples_restart(&samples, 20000);
+  EXPECT_FALSE(attitude_samples_take(&samples, &sample, &dt));
+
+  push(20250, 7);
+  ASSERT_TRUE(attitude_samples_take(&samples, &sample, &dt));
+  EXPECT_EQ(7, sample.gyro[0]);
+  EXPECT_FLOAT_EQ(0.00025f, dt);
+}
+
+/* The sensors and attitude tasks, on threads of their own */
+struct threaded_run {
+  struct attitude_samples *samples;
+  uint32_t count;
+  volatile bool done;
+};
+
+static void *threaded_producer(void *arg)
+{
+  struct threaded_run *run = (struct threaded_run *) arg;
+
+  for (uint32_t i = 1; i <= run->count; i++) {
+    const float gyro[3] = { (float) i, (float) -i, 0.5f * i };
+    const float accel[3] = { 0, (float) i, -9.81f };
+    attitude_samples_push(run->samples, i * 125, gyro, accel);
+
+    if (i % 8 == 0)
+      usleep(1000);
+  }
+
+  run->done = true;
+
+  return NULL;
+}
+
+TEST_F(AttitudeSamples, Threaded) {
+  struct threaded_run run = { &samples, 4000, false };
+
+  attitude_samples_restart(&samples, 0);
+
+  pthread_t producer;
+  ASSERT_EQ(0, pthread_create(&producer, NULL, threaded_producer, &run));
+
+  uint32_t integrated = 0, last = 0;
+  double integrated_dt = 0;
+  bool intact = true;
+
+  while (true) {
+    bool done = run.done;
+
+    struct attitude_sample sample;
+    float dt;
+
+    while (attitude_samples_take(&samples, &sample, &dt)) {
+      uint32_t i = sample.raw_time / 125;
+
+      /* In order, and never torn by the producer */
+      intact = intact && i > last && sample.raw_time == i * 125 &&
+        sample.gyro[0] == (float) i && sample.gyro[1] == (float) -i &&
+        sample.gyro[2] == 0.5f * i && sample.accel[1] == (float) i;
+
+      last = i;
+      integrated++;
+      integrated_dt += dt;
+    }
+
+    if (done)
+      break;
+
+    usleep(500);
+  }
+
+  pthread_join(producer, NULL);
+
+  EXPECT_TRUE(intact);
+  EXPECT_EQ(run.count, integrated + samples.spilled);
+  EXPECT_EQ(run.count, last);
+  EXPECT_NEAR(run.count * 125e-6, integrated_dt, 1e-4);
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,13 @@
+/* PIOS Feature Selection */
+#include "pios_config.h"
+
+#if defined(PIOS_INCLUDE_FLASH)
+#include <pios_flash.h>
+#endif
+
+#define PIOS_COM_TELEM_USB 0
+
+/* The STM32 CRC unit, implemented in unittest_init.c */
+extern void CRC_ResetDR(void);
+extern uint32_t CRC_CalcBlockCRC(uint32_t *buf, uint32_t len);
+extern uint32_t CRC_GetCRC(void);
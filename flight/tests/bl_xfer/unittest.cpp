@@ -0,0 +1,672 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for the bootloader transfer protocol
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdint.h>		/* uint*_t */
+#include <string.h>		/* memcpy */
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+extern "C" {
+
+#include "bl_messages.h"
+
+extern uint8_t sim_flash[];
+extern uint32_t sim_flash_erases;
+extern uint32_t sim_flash_bytes_written;
+extern uint32_t sim_flash_bad_writes;
+extern uint32_t sim_flash_busy_us;
+
+uint32_t sim_crc32(uint32_t crc, const uint32_t *buf, uint32_t len);
+void sim_bl_init(void);
+void sim_bl_process(const struct bl_messages *msg);
+
+}
+
+/* Must match the layout in unittest_init.c */
+#define FW_BASE      (64 * 1024)
+#define FW_REGION    (64 * 1024 + 3 * 128 * 1024 - 100)
+#define FW_BLOCKS    4
+#define SETTINGS_BASE   (32 * 1024)
+#define SETTINGS_REGION (32 * 1024)
+
+/* Legacy DFU states reported by STATUS_REQ */
+#define DFU_IDLE            0
+#define DFU_WRITING         1
+#define DFU_LAST_OP_SUCCESS 5
+#define DFU_LAST_OP_FAILED  8
+
+/*
+ * A full speed USB HID link: each direction carries one 64 byte report per
+ * 1ms frame, and the bootloader doesn't take reports while the flash is busy.
+ */
+class SimHid {
+public:
+  SimHid() : now_ms(0), busy_until_ms(0), drop_cont(-1), conts_sent(0),
+      drop_ack(-1), acks_sent(0), reports_sent(0) {}
+
+  uint32_t now_ms;
+  uint32_t busy_until_ms;
+  int drop_cont;		/* index of a WRITE_CONT report to lose */
+  int conts_sent;
+  int drop_ack;			/* index of a WRITE_ACK report to lose */
+  int acks_sent;
+  uint32_t reports_sent;
+
+  std::deque<bl_messages> to_device;
+  std::deque<std::pair<uint32_t, bl_messages> > to_host;
+
+  void frame() {
+    now_ms++;
+
+    if (!to_device.empty() && busy_until_ms <= now_ms) {
+      bl_messages msg = to_device.front();
+      to_device.pop_front();
+
+      uint32_t busy_us = sim_flash_busy_us;
+      sim_bl_process(&msg);
+      busy_until_ms = now_ms + (sim_flash_busy_us - busy_us + 999) / 1000;
+    }
+  }
+
+  /* Blocks while the bootloader hasn't taken the previous report */
+  void write(const bl_messages &msg) {
+    while (!to_device.empty())
+      frame();
+
+    reports_sent++;
+
+    bool lost = false;
+    if ((msg.flags_command & BL_MSG_COMMAND_MASK) == BL_MSG_WRITE_CONT)
+      lost = (conts_sent++ == drop_cont);
+
+    if (!lost)
+      to_device.push_back(msg);
+
+    frame();
+  }
+
+  bool read(bl_messages &msg, uint32_t timeout_ms) {
+    uint32_t deadline = now_ms + timeout_ms;
+
+    while (to_host.empty() || to_host.front().first > now_ms) {
+      if (now_ms >= deadline)
+        return false;
+      frame();
+    }
+
+    msg = to_host.front().second;
+    to_host.pop_front();
+
+    return true;
+  }
+
+  /* Called by the bootloader, the reply reaches the host in the next frame */
+  void send(const bl_messages &msg) {
+    if ((msg.flags_command & BL_MSG_COMMAND_MASK) == BL_MSG_WRITE_ACK &&
+        acks_sent++ == drop_ack)
+      return;
+
+    to_host.push_back(std::make_pair(now_ms + 1, msg));
+  }
+};
+
+static SimHid *hid;
+
+extern "C" int32_t PIOS_COM_MSG_Send(uint32_t, const uint8_t *msg, uint16_t msg_len)
+{
+  bl_messages m;
+
+  memset(&m, 0, sizeof(m));
+  memcpy(&m, msg, std::min<size_t>(msg_len, sizeof(m)));
+  hid->send(m);
+
+  return 0;
+}
+
+/*
+ * The host side of the protocol, as DFUObject::UploadPartition in the GCS
+ * does it.
+ */
+class SimHost {
+public:
+  SimHost(SimHid &hid) : hid(hid), naks(0) {}
+
+  SimHid &hid;
+  int naks;
+
+  uint8_t status() {
+    bl_messages msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.flags_command = BL_MSG_STATUS_REQ;
+    hid.write(msg);
+
+    while (hid.read(msg, 10000)) {
+      if (msg.flags_command == BL_MSG_STATUS_REP)
+        return msg.v.status_rep.current_state;
+    }
+
+    return 0xFF;
+  }
+
+  static uint32_t num_packets(uint32_t len) {
+    return (len + XFER_BYTES_PER_PACKET - 1) / XFER_BYTES_PER_PACKET;
+  }
+
+  static uint8_t words_in_last_packet(uint32_t len) {
+    uint32_t rem = len % XFER_BYTES_PER_PACKET;
+    return (rem ? rem : XFER_BYTES_PER_PACKET) / 4;
+  }
+
+  /* CRC of the image padded with erased flash up to size bytes */
+  static uint32_t crc(const std::vector<uint8_t> &image, uint32_t start, uint32_t size) {
+    std::vector<uint32_t> words(size / 4, 0xFFFFFFFF);
+
+    for (uint32_t i = start; i < start + size && i < image.size(); i++)
+      ((uint8_t *) &words[0])[i - start] = image[i];
+
+    return sim_crc32(0xFFFFFFFF, &words[0], words.size());
+  }
+
+  void send_packet(const std::vector<uint8_t> &image, uint32_t packet) {
+    bl_messages msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.flags_command = BL_MSG_WRITE_CONT;
+    msg.v.xfer_cont.current_packet_number = htonl(packet);
+
+    /* Words are sent most significant byte first */
+    for (uint32_t i = 0; i < XFER_BYTES_PER_PACKET; i++) {
+      uint32_t pos = packet * XFER_BYTES_PER_PACKET + (i & ~3) + 3 - (i & 3);
+      msg.v.xfer_cont.data[i] = pos < image.size() ? image[pos] : 0;
+    }
+
+    hid.write(msg);
+  }
+
+  bool end_operation() {
+    bl_messages msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.flags_command = BL_MSG_OP_END;
+    hid.write(msg);
+
+    return status() == DFU_LAST_OP_SUCCESS;
+  }
+
+  /* Erase everything, then stream every packet */
+  bool upload(const std::vector<uint8_t> &image, dfu_partition_label label, uint32_t region) {
+    bl_messages msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.flags_command = BL_MSG_WRITE_START;
+    msg.v.xfer_start.packets_in_transfer = htonl(num_packets(image.size()));
+    msg.v.xfer_start.label = label;
+    msg.v.xfer_start.words_in_last_packet = words_in_last_packet(image.size());
+    msg.v.xfer_start.expected_crc = htonl(crc(image, 0, region));
+    hid.write(msg);
+
+    if (status() != DFU_WRITING)
+      return false;
+
+    for (uint32_t packet = 0; packet < num_packets(image.size()); packet++)
+      send_packet(image, packet);
+
+    return end_operation();
+  }
+
+  /* Sizes and CRCs of the blocks currently in the partition */
+  std::vector<std::pair<uint32_t, uint32_t> > block_crcs(dfu_partition_label label) {
+    std::vector<std::pair<uint32_t, uint32_t> > blocks;
+    uint16_t total = 1;
+
+    while (blocks.size() < total) {
+      bl_messages msg;
+
+      memset(&msg, 0, sizeof(msg));
+      msg.flags_command = BL_MSG_BLOCK_CRC_REQ;
+      msg.v.block_crc_req.label = label;
+      msg.v.block_crc_req.first_block = htons(blocks.size());
+      hid.write(msg);
+
+      if (!hid.read(msg, 10000) || msg.flags_command != BL_MSG_BLOCK_CRC_REP ||
+          msg.v.block_crc_rep.num_blocks == 0) {
+        blocks.clear();
+        break;
+      }
+
+      total = ntohs(msg.v.block_crc_rep.total_blocks);
+
+      for (int i = 0; i < msg.v.block_crc_rep.num_blocks; i++)
+        blocks.push_back(std::make_pair(ntohl(msg.v.block_crc_rep.blocks[i].size),
+                                        ntohl(msg.v.block_crc_rep.blocks[i].crc)));
+    }
+
+    return blocks;
+  }
+
+  /* Rewrite the blocks that differ, with up to window packets unacked */
+  bool upload_diff(const std::vector<uint8_t> &image, dfu_partition_label label,
+                   uint32_t region, uint8_t window, bool rewrite_all = false) {
+    std::vector<std::pair<uint32_t, uint32_t> > blocks = block_crcs(label);
+    if (blocks.empty() || blocks.size() > BL_MAX_DIFF_BLOCKS)
+      return false;
+
+    bl_messages msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.flags_command = BL_MSG_WRITE_START_DIFF;
+    msg.v.xfer_start_diff.packets_in_transfer = htonl(num_packets(image.size()));
+    msg.v.xfer_start_diff.label = label;
+    msg.v.xfer_start_diff.words_in_last_packet = words_in_last_packet(image.size());
+    msg.v.xfer_start_diff.expected_crc = htonl(crc(image, 0, region));
+    msg.v.xfer_start_diff.window = window;
+
+    std::vector<uint32_t> packets;
+    uint32_t start = 0;
+
+    for (uint32_t i = 0; i < blocks.size(); i++) {
+      uint32_t size = blocks[i].first;
+
+      /* The description follows the firmware, in its last block */
+      bool rewrite = rewrite_all || crc(image, start, size) != blocks[i].second ||
+          (label == DFU_PARTITION_FW && i == blocks.size() - 1);
+
+      if (rewrite) {
+        msg.v.xfer_start_diff.block_map[i / 8] |= 1 << (i % 8);
+
+        uint32_t end = std::min<uint32_t>(start + size, image.size());
+        for (uint32_t p = start / XFER_BYTES_PER_PACKET;
+             start < end && p <= (end - 1) / XFER_BYTES_PER_PACKET; p++) {
+          if (packets.empty() || packets.back() < p)
+            packets.push_back(p);
+        }
+      }
+
+      start += size;
+    }
+
+    hid.write(msg);
+
+    if (status() != DFU_WRITING)
+      return false;
+
+    if (!window) {
+      for (uint32_t i = 0; i < packets.size(); i++)
+        send_packet(image, packets[i]);
+
+      return end_operation();
+    }
+
+    /* Go back to the first unacked packet on a NAK or a timeout */
+    size_t next = 0, acked = 0;
+    int retries = 0;
+
+    while (acked < packets.size()) {
+      if (next < packets.size() && next - acked < window) {
+        send_packet(image, packets[next++]);
+
+        if (!hid.to_host.empty() && hid.to_host.front().first <= hid.now_ms)
+          handle_ack(packets, next, acked);
+      } else if (handle_ack(packets, next, acked)) {
+        retries = 0;
+      } else if (++retries > 10) {
+        return false;
+      } else {
+        next = acked;
+      }
+    }
+
+    return end_operation();
+  }
+
+  bool handle_ack(const std::vector<uint32_t> &packets, size_t &next, size_t &acked) {
+    bl_messages msg;
+
+    if (!hid.read(msg, 100) || msg.flags_command != BL_MSG_WRITE_ACK)
+      return false;
+
+    uint32_t next_packet = ntohl(msg.v.write_ack.next_packet_number);
+    size_t first_unacked = std::lower_bound(packets.begin(), packets.end(), next_packet) - packets.begin();
+
+    acked = std::max(acked, first_unacked);
+
+    /* An ack for packets resent after a rewind can get ahead of next */
+    next = std::max(next, acked);
+
+    if (msg.v.write_ack.rejected) {
+      naks++;
+      next = acked;
+    }
+
+    return true;
+  }
+};
+
+static std::vector<uint8_t> make_image(uint32_t len, uint32_t seed)
+{
+  std::vector<uint8_t> image(len);
+
+  for (uint32_t i = 0; i < len; i++) {
+    seed = seed * 1103515245 + 12345;
+    image[i] = seed >> 16;
+  }
+
+  return image;
+}
+
+class BlXfer : public testing::Test {
+protected:
+  virtual void SetUp() {
+    memset(sim_flash, 0xFF, FW_BASE + 64 * 1024 + 3 * 128 * 1024);
+    sim_bl_init();
+
+    hid = &link;
+  }
+
+  void reset_counters() {
+    sim_flash_erases = 0;
+    sim_flash_bytes_written = 0;
+    sim_flash_bad_writes = 0;
+    link = SimHid();
+  }
+
+  bool fw_matches(const std::vector<uint8_t> &image) {
+    for (uint32_t i = 0; i < FW_REGION; i++) {
+      uint8_t expected = i < image.size() ? image[i] : 0xFF;
+      if (sim_flash[FW_BASE + i] != expected)
+        return false;
+    }
+
+    return true;
+  }
+
+  SimHid link;
+};
+
+/* Reports the protocol extension in the capabilities */
+TEST_F(BlXfer, CapabilitiesAdvertiseDifferentialWrites) {
+  bl_messages msg;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.flags_command = BL_MSG_CAP_REQ;
+  msg.v.cap_req.device_number = 1;
+  link.write(msg);
+
+  ASSERT_TRUE(link.read(msg, 10000));
+  ASSERT_EQ(BL_MSG_CAP_REP, msg.flags_command);
+  EXPECT_EQ(BL_CAP_EXTENSION_MAGIC, msg.v.cap_rep_specific.cap_extension_magic);
+  EXPECT_TRUE(msg.v.cap_rep_specific.xfer_features & BL_XFER_FEATURE_DIFFERENTIAL);
+}
+
+/* Blocks follow the flash sectors, the last one stopping at the description */
+TEST_F(BlXfer, BlockCrcsDescribeThePartition) {
+  SimHost host(link);
+  std::vector<uint8_t> image = make_image(300000, 1);
+
+  ASSERT_TRUE(host.upload(image, DFU_PARTITION_FW, FW_REGION));
+
+  std::vector<std::pair<uint32_t, uint32_t> > blocks = host.block_crcs(DFU_PARTITION_FW);
+  ASSERT_EQ((size_t) FW_BLOCKS, blocks.size());
+
+  EXPECT_EQ(64u * 1024, blocks[0].first);
+  EXPECT_EQ(128u * 1024, blocks[1].first);
+  EXPECT_EQ(128u * 1024, blocks[2].first);
+  EXPECT_EQ(128u * 1024 - 100, blocks[3].first);
+
+  uint32_t start = 0;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    EXPECT_EQ(SimHost::crc(image, start, blocks[i].first), blocks[i].second);
+    start += blocks[i].first;
+  }
+
+  /* The description can't be rewritten block by block */
+  EXPECT_TRUE(host.block_crcs(DFU_PARTITION_DESC).empty());
+}
+
+/* The original protocol still erases the partition and writes everything */
+TEST_F(BlXfer, FullUploadStillWorks) {
+  SimHost host(link);
+  std::vector<uint8_t> image = make_image(200001 & ~3, 2);
+
+  reset_counters();
+  ASSERT_TRUE(host.upload(image, DFU_PARTITION_FW, FW_REGION));
+
+  EXPECT_EQ((uint32_t) FW_BLOCKS, sim_flash_erases);
+  EXPECT_EQ(image.size(), sim_flash_bytes_written);
+  EXPECT_EQ(0u, sim_flash_bad_writes);
+  EXPECT_TRUE(fw_matches(image));
+}
+
+/* An unchanged settings partition isn't touched at all */
+TEST_F(BlXfer, UnchangedImageIsNotRewritten) {
+  SimHost host(link);
+  std::vector<uint8_t> image = make_image(20000, 3);
+
+  ASSERT_TRUE(host.upload(image, DFU_PARTITION_SETTINGS, SETTINGS_REGION));
+
+  reset_counters();
+  ASSERT_TRUE(host.upload_diff(image, DFU_PARTITION_SETTINGS, SETTINGS_REGION, 16));
+
+  EXPECT_EQ(0u, sim_flash_erases);
+  EXPECT_EQ(0u, sim_flash_bytes_written);
+  EXPECT_EQ(0, memcmp(&sim_flash[SETTINGS_BASE], &image[0], image.size()));
+}
+
+/* Only the changed block and the one holding the description are rewritten */
+TEST_F(BlXfer, ChangedBlockIsRewritten) {
+  SimHost host(link);
+  std::vector<uint8_t> image = make_image(400000, 4);
+
+  ASSERT_TRUE(host.upload(image, DFU_PARTITION_FW, FW_REGION));
+
+  image[70000] ^= 0x55;
+
+  reset_counters();
+  ASSERT_TRUE(host.upload_diff(image, DFU_PARTITION_FW, FW_REGION, 16));
+
+  EXPECT_EQ(2u, sim_flash_erases);
+  EXPECT_EQ(128u * 1024 + (400000 - 64 * 1024 - 2 * 128 * 1024), sim_flash_bytes_written);
+  EXPECT_EQ(0u, sim_flash_bad_writes);
+  EXPECT_TRUE(fw_matches(image));
+}
+
+/* Blocks past the end of a shorter image are left erased */
+TEST_F(BlXfer, ShorterImageErasesTheRest) {
+  SimHost host(link);
+  std::vector<uint8_t> image = make_image(400000, 5);
+
+  ASSERT_TRUE(host.upload(image, DFU_PARTITION_FW, FW_REGION));
+
+  image.resize(100000);
+
+  reset_counters();
+  ASSERT_TRUE(host.upload_diff(image, DFU_PARTITION_FW, FW_REGION, 16));
+
+  EXPECT_EQ(3u, sim_flash_erases);
+  EXPECT_EQ(100000u - 64 * 1024, sim_flash_bytes_written);
+  EXPECT_TRUE(fw_matches(image));
+}
+
+/* A lost packet is refused, and resent from the NAK without failing */
+TEST_F(BlXfer, LostPacketIsResent) {
+  SimHost host(link);
+  std::vector<uint8_t> image = make_image(150000, 6);
+
+  ASSERT_TRUE(host.upload(image, DFU_PARTITION_FW, FW_REGION));
+
+  image[1000] ^= 0x55;
+  image[140000] ^= 0x55;
+
+  reset_counters();
+  link.drop_cont = 500;
+  ASSERT_TRUE(host.upload_diff(image, DFU_PARTITION_FW, FW_REGION, 16));
+
+  EXPECT_GE(host.naks, 1);
+  EXPECT_EQ(0u, sim_flash_bad_writes);
+  EXPECT_TRUE(fw_matches(image));
+}
+
+/* The last packet of the transfer has no successor to expose its loss */
+TEST_F(BlXfer, LostLastPacketIsResentOnTimeout) {
+  SimHost host(link);
+  std::vector<uint8_t> image = make_image(30000, 7);
+
+  image[100] ^= 0x55;
+
+  link.drop_cont = SimHost::num_packets(30000) - 1;
+  ASSERT_TRUE(host.upload_diff(image, DFU_PARTITION_FW, FW_REGION, 16));
+
+  EXPECT_TRUE(fw_matches(image));
+}
+
+/*
+ * With a window of one each packet waits for its own ack, so a lost ack
+ * makes the host rewind, and the packet it resends must be acked again
+ */
+TEST_F(BlXfer, LostAckIsResent) {
+  SimHost host(link);
+  std::vector<uint8_t> image = make_image(150000, 10);
+
+  ASSERT_TRUE(host.upload(image, DFU_PARTITION_FW, FW_REGION));
+
+  image[1000] ^= 0x55;
+  image[140000] ^= 0x55;
+
+  reset_counters();
+  link.drop_ack = 20;
+  ASSERT_TRUE(host.upload_diff(image, DFU_PARTITION_FW, FW_REGION, 1));
+
+  EXPECT_LT(20, link.acks_sent);
+  EXPECT_EQ(0u, sim_flash_bad_writes);
+  EXPECT_TRUE(fw_matches(image));
+}
+
+/* Losing the final ack leaves the host waiting with nothing new to send */
+TEST_F(BlXfer, LostLastAckIsResent) {
+  SimHost host(link);
+  std::vector<uint8_t> image = make_image(30000, 11);
+
+  ASSERT_TRUE(host.upload_diff(image, DFU_PARTITION_FW, FW_REGION, 16, true));
+  int acks = link.acks_sent;
+
+  image[100] ^= 0x55;
+
+  reset_counters();
+  link.drop_ack = acks - 1;
+  ASSERT_TRUE(host.upload_diff(image, DFU_PARTITION_FW, FW_REGION, 16, true));
+
+  EXPECT_LT(acks, link.acks_sent);
+  EXPECT_TRUE(fw_matches(image));
+}
+
+/* Without a window there are no acks, so a lost packet fails the transfer */
+TEST_F(BlXfer, LostPacketFailsWithoutWindow) {
+  SimHost host(link);
+  std::vector<uint8_t> image = make_image(150000, 8);
+
+  link.drop_cont = 500;
+  EXPECT_FALSE(host.upload_diff(image, DFU_PARTITION_FW, FW_REGION, 0));
+  EXPECT_EQ(DFU_LAST_OP_FAILED, host.status());
+}
+
+/* The firmware's last block shares its sector with the description */
+TEST_F(BlXfer, DescriptionBlockMustBeRewritten) {
+  SimHost host(link);
+  bl_messages msg;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.flags_command = BL_MSG_WRITE_START_DIFF;
+  msg.v.xfer_start_diff.packets_in_transfer = htonl(10);
+  msg.v.xfer_start_diff.label = DFU_PARTITION_FW;
+  msg.v.xfer_start_diff.words_in_last_packet = 14;
+  msg.v.xfer_start_diff.block_map[0] = 0x01;
+  link.write(msg);
+
+  EXPECT_EQ(DFU_IDLE, host.status());
+
+  msg.v.xfer_start_diff.block_map[0] = 0x09;
+  link.write(msg);
+
+  EXPECT_EQ(DFU_WRITING, host.status());
+}
+
+/* Time to flash a small change to a mostly full firmware partition */
+TEST_F(BlXfer, Benchmark) {
+  SimHost host(link);
+  std::vector<uint8_t> original = make_image(440000, 9);
+  std::vector<uint8_t> image = original;
+
+  image[20000] ^= 0x55;
+
+  struct {
+    const char *name;
+    bool diff;
+    uint8_t window;
+    bool rewrite_all;
+  } modes[] = {
+    { "full erase, streamed", false, 0, false },
+    { "full erase, window 32", true, 32, true },
+    { "changed blocks, stop-and-wait", true, 1, false },
+    { "changed blocks, window 32", true, 32, false },
+  };
+
+  uint32_t time_ms[4];
+
+  for (int m = 0; m < 4; m++) {
+    ASSERT_TRUE(host.upload(original, DFU_PARTITION_FW, FW_REGION));
+
+    reset_counters();
+    sim_flash_busy_us = 0;
+
+    bool ok = modes[m].diff ?
+        host.upload_diff(image, DFU_PARTITION_FW, FW_REGION, modes[m].window, modes[m].rewrite_all) :
+        host.upload(image, DFU_PARTITION_FW, FW_REGION);
+    ASSERT_TRUE(ok);
+    ASSERT_TRUE(fw_matches(image));
+
+    time_ms[m] = link.now_ms;
+
+    printf("[   BENCH  ] %-30s %6u ms, %u erases, %6u bytes written, %u reports\n",
+           modes[m].name, time_ms[m], sim_flash_erases, sim_flash_bytes_written,
+           link.reports_sent);
+  }
+
+  EXPECT_LT(time_ms[3], time_ms[0]);
+  EXPECT_LT(time_ms[3], time_ms[2]);
+}
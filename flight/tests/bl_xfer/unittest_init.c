@@ -0,0 +1,312 @@
+/**
+ ******************************************************************************
+ * @file       unittest_init.c
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Simulated flash and bootloader message handling for the bl_xfer test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * These need to be defined in a .c file so that we can use
+ * designated initializer syntax which c++ doesn't support (yet).
+ */
+
+#include <string.h>		/* memset */
+
+#include "pios.h"
+#include "pios_flash_priv.h"	/* struct pios_flash_partition */
+#include "pios_board_info.h"	/* struct pios_board_info */
+#include "pios_com_msg.h"	/* PIOS_COM_MSG_Send */
+#include "bl_xfer.h"
+
+#define NELEMENTS(x) (sizeof(x) / sizeof(*(x)))
+
+/*
+ * Laid out like the start of an STM32F4, so that the firmware partition is
+ * made of erase blocks of different sizes.
+ */
+static const struct pios_flash_sector_range sim_flash_sectors[] = {
+	{
+		.base_sector = 0,
+		.last_sector = 3,
+		.sector_size = FLASH_SECTOR_16KB,
+	},
+	{
+		.base_sector = 4,
+		.last_sector = 4,
+		.sector_size = FLASH_SECTOR_64KB,
+	},
+	{
+		.base_sector = 5,
+		.last_sector = 7,
+		.sector_size = FLASH_SECTOR_128KB,
+	},
+};
+
+#define SIM_FLASH_SIZE (4 * FLASH_SECTOR_16KB + FLASH_SECTOR_64KB + 3 * FLASH_SECTOR_128KB)
+#define SIM_FW_BASE    (4 * FLASH_SECTOR_16KB)
+#define SIM_FW_SIZE    (FLASH_SECTOR_64KB + 3 * FLASH_SECTOR_128KB)
+#define SIM_DESC_SIZE  100
+
+uint8_t sim_flash[SIM_FLASH_SIZE];
+
+/* Accounting of the flash operations, for the test to check */
+uint32_t sim_flash_erases;
+uint32_t sim_flash_bytes_written;
+uint32_t sim_flash_bad_writes;	/* writes to bits that were not erased */
+uint32_t sim_flash_busy_us;	/* time the operations take on an STM32F4 */
+
+static int32_t sim_flash_erase_sector(uintptr_t chip_id, uint32_t chip_sector, uint32_t chip_offset)
+{
+	uint32_t sector_size = 0;
+
+	for (uint32_t i = 0; i < NELEMENTS(sim_flash_sectors); i++) {
+		if (chip_sector >= sim_flash_sectors[i].base_sector &&
+				chip_sector <= sim_flash_sectors[i].last_sector)
+			sector_size = sim_flash_sectors[i].sector_size;
+	}
+
+	if (sector_size == 0 || chip_offset + sector_size > SIM_FLASH_SIZE)
+		return -1;
+
+	memset(&sim_flash[chip_offset], 0xFF, sector_size);
+
+	/* Typical sector erase times from the STM32F4 datasheet */
+	switch (sector_size) {
+	case FLASH_SECTOR_16KB:
+		sim_flash_busy_us += 250000;
+		break;
+	case FLASH_SECTOR_64KB:
+		sim_flash_busy_us += 550000;
+		break;
+	default:
+		sim_flash_busy_us += 1000000;
+		break;
+	}
+
+	sim_flash_erases++;
+
+	return 0;
+}
+
+static int32_t sim_flash_write_data(uintptr_t chip_id, uint32_t chip_offset, const uint8_t *data, uint16_t len)
+{
+	if (chip_offset + len > SIM_FLASH_SIZE)
+		return -1;
+
+	for (uint16_t i = 0; i < len; i++) {
+		/* Programming can only clear bits */
+		if (data[i] & ~sim_flash[chip_offset + i])
+			sim_flash_bad_writes++;
+
+		sim_flash[chip_offset + i] &= data[i];
+	}
+
+	sim_flash_bytes_written += len;
+	sim_flash_busy_us += len / sizeof(uint32_t) * 16;
+
+	return 0;
+}
+
+static int32_t sim_flash_read_data(uintptr_t chip_id, uint32_t chip_offset, uint8_t *data, uint16_t len)
+{
+	if (chip_offset + len > SIM_FLASH_SIZE)
+		return -1;
+
+	memcpy(data, &sim_flash[chip_offset], len);
+
+	sim_flash_busy_us += len / 64;
+
+	return 0;
+}
+
+static const struct pios_flash_driver sim_flash_driver = {
+	.erase_sector = sim_flash_erase_sector,
+	.write_data   = sim_flash_write_data,
+	.read_data    = sim_flash_read_data,
+};
+
+static uintptr_t sim_flash_id;
+static const struct pios_flash_chip sim_flash_chip = {
+	.driver        = &sim_flash_driver,
+	.chip_id       = &sim_flash_id,
+	.page_size     = 256,
+	.sector_blocks = sim_flash_sectors,
+	.num_blocks    = NELEMENTS(sim_flash_sectors),
+};
+
+const struct pios_flash_partition pios_flash_partition_table[] = {
+	{
+		.label        = FLASH_PARTITION_LABEL_BL,
+		.chip_desc    = &sim_flash_chip,
+		.first_sector = 0,
+		.last_sector  = 1,
+		.chip_offset  = 0,
+		.size         = 2 * FLASH_SECTOR_16KB,
+	},
+
+	{
+		.label        = FLASH_PARTITION_LABEL_SETTINGS,
+		.chip_desc    = &sim_flash_chip,
+		.first_sector = 2,
+		.last_sector  = 3,
+		.chip_offset  = 2 * FLASH_SECTOR_16KB,
+		.size         = 2 * FLASH_SECTOR_16KB,
+	},
+
+	{
+		.label        = FLASH_PARTITION_LABEL_FW,
+		.chip_desc    = &sim_flash_chip,
+		.first_sector = 4,
+		.last_sector  = 7,
+		.chip_offset  = SIM_FW_BASE,
+		.size         = SIM_FW_SIZE,
+	},
+};
+
+uint32_t pios_flash_partition_table_size = NELEMENTS(pios_flash_partition_table);
+
+const struct pios_board_info pios_board_info_blob = {
+	.magic      = PIOS_BOARD_INFO_BLOB_MAGIC,
+	.board_type = 0x7F,
+	.board_rev  = 1,
+	.bl_rev     = 1,
+	.hw_type    = 0,
+	.fw_base    = 0x08000000 + SIM_FW_BASE,
+	.fw_size    = SIM_FW_SIZE - SIM_DESC_SIZE,
+	.desc_base  = 0x08000000 + SIM_FW_BASE + SIM_FW_SIZE - SIM_DESC_SIZE,
+	.desc_size  = SIM_DESC_SIZE,
+};
+
+/* The STM32 CRC unit: CRC-32 over whole words, most significant bit first */
+static uint32_t sim_crc;
+
+uint32_t sim_crc32(uint32_t crc, const uint32_t *buf, uint32_t len)
+{
+	static const uint32_t crc_table[16] = {
+		0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9, 0x130476DC, 0x17C56B6B, 0x1A864DB2, 0x1E475005,
+		0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61, 0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD,
+	};
+
+	while (len--) {
+		crc ^= *buf++;
+
+		for (int i = 0; i < 8; i++)
+			crc = (crc << 4) ^ crc_table[crc >> 28];
+	}
+
+	return crc;
+}
+
+void CRC_ResetDR(void)
+{
+	sim_crc = 0xFFFFFFFF;
+}
+
+uint32_t CRC_CalcBlockCRC(uint32_t *buf, uint32_t len)
+{
+	sim_crc = sim_crc32(sim_crc, buf, len);
+
+	return sim_crc;
+}
+
+uint32_t CRC_GetCRC(void)
+{
+	return sim_crc;
+}
+
+/*
+ * The transfer related part of the bootloader message handling in
+ * bl/common/main.c, with the legacy DFU state that STATUS_REQ reports.
+ */
+enum sim_bl_state {
+	SIM_BL_IDLE    = 0,	/* DFU_IDLE */
+	SIM_BL_WRITING = 1,	/* DFU_WRITING */
+	SIM_BL_OK      = 5,	/* DFU_LAST_OP_SUCCESS */
+	SIM_BL_FAILED  = 8,	/* DFU_LAST_OP_FAILED */
+};
+
+static struct xfer_state sim_xfer;
+static enum sim_bl_state sim_bl_state;
+
+void sim_bl_init(void)
+{
+	memset(&sim_xfer, 0, sizeof(sim_xfer));
+	sim_bl_state = SIM_BL_IDLE;
+
+	PIOS_FLASH_register_partition_table(pios_flash_partition_table,
+			pios_flash_partition_table_size);
+}
+
+void sim_bl_process(const struct bl_messages *msg)
+{
+	switch (msg->flags_command & BL_MSG_COMMAND_MASK) {
+	case BL_MSG_CAP_REQ:
+		bl_xfer_send_capabilities_self();
+		break;
+	case BL_MSG_WRITE_START:
+		if (bl_xfer_write_start(&sim_xfer, &msg->v.xfer_start))
+			sim_bl_state = SIM_BL_WRITING;
+		break;
+	case BL_MSG_WRITE_START_DIFF:
+		if (bl_xfer_write_start_diff(&sim_xfer, &msg->v.xfer_start_diff))
+			sim_bl_state = SIM_BL_WRITING;
+		break;
+	case BL_MSG_WRITE_CONT:
+		if (sim_bl_state == SIM_BL_WRITING) {
+			if (!bl_xfer_write_cont(&sim_xfer, &msg->v.xfer_cont))
+				sim_bl_state = SIM_BL_FAILED;
+		}
+		break;
+	case BL_MSG_OP_END:
+		if (sim_bl_state == SIM_BL_WRITING) {
+			if (bl_xfer_completed_p(&sim_xfer)) {
+				if (bl_xfer_crc_ok_p(&sim_xfer))
+					sim_bl_state = SIM_BL_OK;
+				else
+					sim_bl_state = SIM_BL_FAILED;
+			}
+		}
+		break;
+	case BL_MSG_STATUS_REQ:
+	{
+		struct bl_messages rep = {
+			.flags_command = BL_MSG_STATUS_REP,
+			.v.status_rep = {
+				.current_state = sim_bl_state,
+			},
+		};
+
+		PIOS_COM_MSG_Send(PIOS_COM_TELEM_USB, (uint8_t *)&rep, sizeof(rep));
+		break;
+	}
+	case BL_MSG_BLOCK_CRC_REQ:
+		bl_xfer_send_block_crcs(&msg->v.block_crc_req);
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -37,6 +37,7 @@
 #include <stdlib.h>		/* abort */
 #include <string.h>		/* memset */
 #include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
 
 extern "C" {
 
@@ -104,3 +105,268 @@ TEST_F(EncodeDecode, Recover) {
     EXPECT_EQ(p[i], p2[i]);
 
 };
+
+/*
+ * A plain implementation straight from the definitions, to check the
+ * table driven one against: bitwise multiplication in GF(2^8) with
+ * x^8 + x^4 + x^3 + x^2 + 1, the generator as the product of (x + a^i).
+ */
+static uint8_t ref_mult(uint8_t a, uint8_t b)
+{
+  uint8_t p = 0;
+
+  while (b) {
+    if (b & 1)
+      p ^= a;
+    a = (a << 1) ^ ((a & 0x80) ? 0x1d : 0);
+    b >>= 1;
+  }
+
+  return p;
+}
+
+static uint8_t ref_pow(uint8_t a, int n)
+{
+  uint8_t p = 1;
+
+  while (n-- > 0)
+    p = ref_mult(p, a);
+
+  return p;
+}
+
+static void ref_encode(const uint8_t *msg, int nbytes, uint8_t *parity)
+{
+  uint8_t gen[RS_ECC_NPARITY + 1] = { 1 };
+
+  for (int i = 1; i <= RS_ECC_NPARITY; i++) {
+    uint8_t root = ref_pow(2, i);
+    for (int j = i; j > 0; j--)
+      gen[j] = gen[j - 1] ^ ref_mult(gen[j], root);
+    gen[0] = ref_mult(gen[0], root);
+  }
+
+  /* Remainder of msg * x^NPAR divided by the generator */
+  uint8_t rem[RS_ECC_NPARITY] = {};
+
+  for (int i = 0; i < nbytes; i++) {
+    uint8_t f = msg[i] ^ rem[0];
+    for (int j = 0; j < RS_ECC_NPARITY - 1; j++)
+      rem[j] = rem[j + 1] ^ ref_mult(f, gen[RS_ECC_NPARITY - 1 - j]);
+    rem[RS_ECC_NPARITY - 1] = ref_mult(f, gen[0]);
+  }
+
+  memcpy(parity, rem, RS_ECC_NPARITY);
+}
+
+static void ref_syndrome(const uint8_t *data, int nbytes, int *syn)
+{
+  for (int j = 0; j < RS_ECC_NPARITY; j++) {
+    uint8_t root = ref_pow(2, j + 1), sum = 0;
+    for (int i = 0; i < nbytes; i++)
+      sum = data[i] ^ ref_mult(root, sum);
+    syn[j] = sum;
+  }
+}
+
+static uint32_t next_random(uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 16;
+}
+
+/* Flips nerr distinct bytes of a codeword to other values */
+static void damage(uint8_t *p, int len, int nerr, uint32_t *seed)
+{
+  bool hit[256] = {};
+
+  for (int e = 0; e < nerr; e++) {
+    int pos;
+    do {
+      pos = next_random(seed) % len;
+    } while (hit[pos]);
+    hit[pos] = true;
+
+    p[pos] ^= 1 + next_random(seed) % 255;
+  }
+}
+
+TEST_F(EncodeDecode, MatchesReference) {
+  uint32_t seed = 1;
+  uint8_t p[255], parity[RS_ECC_NPARITY];
+
+  for (int len = 0; len <= 255 - RS_ECC_NPARITY; len++) {
+    for (int n = 0; n < 8; n++) {
+      for (int i = 0; i < len; i++)
+        p[i] = (n == 0) ? 0 : (n == 1) ? 0xff : next_random(&seed);
+
+      ref_encode(p, len, parity);
+      rs_encode(p, len, p);
+      ASSERT_EQ(0, memcmp(parity, p + len, RS_ECC_NPARITY)) << "length " << len;
+
+      /* Syndromes, of codewords and of damaged ones */
+      struct rs_decoder dec;
+      int syn[RS_ECC_NPARITY];
+
+      damage(p, len + RS_ECC_NPARITY, n % 3, &seed);
+      ref_syndrome(p, len + RS_ECC_NPARITY, syn);
+      EXPECT_EQ(n % 3 == 0, rs_syndrome(&dec, p, len + RS_ECC_NPARITY));
+      for (int j = 0; j < RS_ECC_NPARITY; j++)
+        ASSERT_EQ(syn[j], dec.syndrome[j]) << "length " << len;
+    }
+  }
+}
+
+TEST_F(EncodeDecode, CorrectsUpToHalfParity) {
+  uint32_t seed = 2;
+  uint8_t p[255], orig[255];
+
+  for (int len = 1; len <= 255 - RS_ECC_NPARITY; len += 7) {
+    int csize = len + RS_ECC_NPARITY;
+
+    for (int nerr = 1; nerr <= RS_ECC_NPARITY / 2; nerr++) {
+      for (int n = 0; n < 20; n++) {
+        for (int i = 0; i < len; i++)
+          p[i] = next_random(&seed);
+        rs_encode(p, len, p);
+        memcpy(orig, p, csize);
+
+        damage(p, csize, nerr, &seed);
+
+        struct rs_decoder dec;
+        ASSERT_FALSE(rs_syndrome(&dec, p, csize));
+        ASSERT_EQ(1, rs_correct(&dec, p, csize, 0, NULL));
+        EXPECT_EQ(nerr, dec.nerrors);
+        ASSERT_EQ(0, memcmp(orig, p, csize)) << "length " << len << " errors " << nerr;
+      }
+    }
+  }
+}
+
+TEST_F(EncodeDecode, NeverReturnsInvalidCodeword) {
+  uint32_t seed = 3;
+  uint8_t p[64], before[64];
+  const int len = 60, csize = len + RS_ECC_NPARITY;
+  int rejected = 0;
+
+  for (int n = 0; n < 2000; n++) {
+    for (int i = 0; i < len; i++)
+      p[i] = next_random(&seed);
+    rs_encode(p, len, p);
+
+    damage(p, csize, RS_ECC_NPARITY / 2 + 1 + n % 3, &seed);
+    memcpy(before, p, csize);
+
+    /* Too many errors: either rejected and untouched, or "corrected"
+     * into some other valid codeword, never anything else */
+    struct rs_decoder dec;
+    if (rs_syndrome(&dec, p, csize))
+      continue;
+
+    if (rs_correct(&dec, p, csize, 0, NULL)) {
+      EXPECT_TRUE(rs_syndrome(&dec, p, csize));
+    } else {
+      rejected++;
+      EXPECT_EQ(0, memcmp(before, p, csize));
+    }
+  }
+
+  EXPECT_GT(rejected, 1500);
+}
+
+TEST_F(EncodeDecode, Reentrant) {
+  uint8_t a[40], b[40], a_orig[40], b_orig[40];
+
+  for (int i = 0; i < 36; i++) {
+    a[i] = i * 7;
+    b[i] = 255 - i * 3;
+  }
+  rs_encode(a, 36, a);
+  rs_encode(b, 36, b);
+  memcpy(a_orig, a, sizeof(a));
+  memcpy(b_orig, b, sizeof(b));
+
+  a[3] ^= 0x55;
+  b[20] ^= 0x01;
+  b[39] ^= 0x80;
+
+  /* Interleaved, as two radios decoding at once would */
+  struct rs_decoder dec_a, dec_b;
+  EXPECT_FALSE(rs_syndrome(&dec_a, a, 40));
+  EXPECT_FALSE(rs_syndrome(&dec_b, b, 40));
+  EXPECT_EQ(1, rs_correct(&dec_b, b, 40, 0, NULL));
+  EXPECT_EQ(1, rs_correct(&dec_a, a, 40, 0, NULL));
+
+  EXPECT_EQ(0, memcmp(a_orig, a, sizeof(a)));
+  EXPECT_EQ(0, memcmp(b_orig, b, sizeof(b)));
+}
+
+#if !defined(__x86_64__) && !defined(__i386__)
+static uint64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+static uint64_t cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  return now_ns();
+#endif
+}
+
+TEST_F(EncodeDecode, Benchmark) {
+  /* A full radio packet */
+  const int len = 64 - RS_ECC_NPARITY, csize = 64, packets = 20000;
+  static uint8_t p[packets][64];
+  uint32_t seed = 4;
+
+  for (int n = 0; n < packets; n++)
+    for (int i = 0; i < len; i++)
+      p[n][i] = next_random(&seed);
+
+  uint64_t start = cycles();
+  for (int n = 0; n < packets; n++)
+    rs_encode(p[n], len, p[n]);
+  uint64_t encode = cycles() - start;
+
+  printf("%-12s %8.0f per packet\n", "encode", (double) encode / packets);
+
+  /* Percent of packets damaged, with one or two errors */
+  const int rates[] = { 0, 1, 10, 50 };
+  static uint8_t rx[packets][64];
+
+  for (unsigned int r = 0; r < sizeof(rates) / sizeof(*rates); r++) {
+    memcpy(rx, p, sizeof(rx));
+    for (int n = 0; n < packets; n++)
+      if ((int) (next_random(&seed) % 100) < rates[r])
+        damage(rx[n], csize, 1 + n % 2, &seed);
+
+    int failed = 0;
+
+    start = cycles();
+    for (int n = 0; n < packets; n++) {
+      struct rs_decoder dec;
+      if (!rs_syndrome(&dec, rx[n], csize) &&
+          !rs_correct(&dec, rx[n], csize, 0, NULL))
+        failed++;
+    }
+    uint64_t decode = cycles() - start;
+
+    EXPECT_EQ(0, failed);
+    EXPECT_EQ(0, memcmp(p, rx, sizeof(rx)));
+
+    printf("decode %3d%% %8.0f per packet\n", rates[r], (double) decode / packets);
+  }
+
+#if defined(__x86_64__) || defined(__i386__)
+  printf("(in TSC cycles)\n");
+#else
+  printf("(in ns)\n");
+#endif
+}
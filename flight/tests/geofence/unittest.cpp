@@ -0,0 +1,404 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test and benchmark for the polygonal geofence
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <math.h>		/* sinf */
+#include <stdio.h>		/* printf */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+
+#include <vector>
+
+extern "C" {
+
+#include "geofence_polygon.h"
+
+}
+
+/* A fence under construction, and the plain way of checking it */
+struct shape {
+  std::vector<float> north, east;
+  std::vector<struct geofence_polygon> polygons;
+
+  void begin(bool exclusion) {
+    struct geofence_polygon p = { (uint16_t) north.size(), 0, exclusion };
+    polygons.push_back(p);
+  }
+
+  void add(float n, float e) {
+    north.push_back(n);
+    east.push_back(e);
+    polygons.back().num_vertices++;
+  }
+
+  int32_t build(struct geofence *g, float margin) const {
+    return geofence_build(g, &north[0], &east[0], &polygons[0], polygons.size(), margin);
+  }
+
+  /* W. Randolph Franklin's even-odd test */
+  bool in_polygon(const struct geofence_polygon &p, float n, float e) const {
+    bool c = false;
+
+    for (int i = 0, j = p.num_vertices - 1; i < p.num_vertices; j = i++) {
+      float ni = north[p.first_vertex + i], ei = east[p.first_vertex + i];
+      float nj = north[p.first_vertex + j], ej = east[p.first_vertex + j];
+
+      if (((ni > n) != (nj > n)) && (e < (ej - ei) * (n - ni) / (nj - ni) + ei))
+        c = !c;
+    }
+
+    return c;
+  }
+
+  bool allowed(float n, float e, float *distance) const {
+    bool any_inclusion = false, included = false, excluded = false;
+
+    *distance = INFINITY;
+
+    for (unsigned int p = 0; p < polygons.size(); p++) {
+      const struct geofence_polygon &poly = polygons[p];
+      bool in = in_polygon(poly, n, e);
+
+      if (poly.exclusion) {
+        excluded |= in;
+      } else {
+        any_inclusion = true;
+        included |= in;
+      }
+
+      for (int i = 0; i < poly.num_vertices; i++) {
+        int a = poly.first_vertex + i;
+        int b = poly.first_vertex + (i + 1) % poly.num_vertices;
+        float dn = north[b] - north[a], de = east[b] - east[a];
+        float t = ((n - north[a]) * dn + (e - east[a]) * de) / (dn * dn + de * de);
+        t = fminf(fmaxf(t, 0), 1);
+        *distance = fminf(*distance, hypotf(north[a] + t * dn - n, east[a] + t * de - e));
+      }
+    }
+
+    return (!any_inclusion || included) && !excluded;
+  }
+};
+
+static uint32_t next_random(uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 16;
+}
+
+static float random_coord(uint32_t *seed, float lo, float hi)
+{
+  return lo + (hi - lo) * (next_random(seed) % 65536) / 65535.0f;
+}
+
+/* Vertices of complex_shape() other than the star's */
+#define OTHER_VERTICES 37
+
+/* The largest star that still fits, in GeoFencePolygons unless this is
+ * built with room for more vertices */
+#define MAX_STAR_POINTS (GEOFENCE_MAX_VERTICES - OTHER_VERTICES)
+
+/* A field to fly in: a jagged star, a comb cut into its west side, holes
+ * punched in it, and a second area overlapping the first; all eight
+ * polygons there is room for */
+static struct shape complex_shape(int star_points, uint32_t seed)
+{
+  struct shape s;
+
+  s.begin(false);
+  for (int i = 0; i < star_points; i++) {
+    float a = 2 * (float) M_PI * i / star_points;
+    float r = ((i & 1) ? 600 : 1000) + random_coord(&seed, -50, 50);
+    s.add(r * cosf(a), r * sinf(a));
+  }
+
+  /* A comb, very concave: teeth pointing north */
+  s.begin(false);
+  for (int t = 0; t < 3; t++) {
+    s.add(-1500, -2000 + t * 400);
+    s.add(-900, -2000 + t * 400);
+    s.add(-900, -2000 + t * 400 + 200);
+    s.add(-1500, -2000 + t * 400 + 200);
+  }
+  s.add(-1600, -2000 + 3 * 400);
+  s.add(-1600, -2000);
+
+  /* Overlapping the star */
+  s.begin(false);
+  s.add(800, 800);
+  s.add(800, 1600);
+  s.add(1600, 1600);
+  s.add(1600, 800);
+
+  /* Holes, one across the edge of the star */
+  for (int h = 0; h < 4; h++) {
+    float cn = -400 + h * 260, ce = -300 + h * 160;
+    s.begin(true);
+    for (int i = 0; i < 4; i++) {
+      float a = 2 * (float) M_PI * (i + 0.5f) / 4;
+      s.add(cn + 80 * cosf(a), ce + 80 * sinf(a));
+    }
+  }
+
+  s.begin(true);
+  s.add(950, -100);
+  s.add(1100, 0);
+  s.add(950, 100);
+
+  return s;
+}
+
+static double now_s()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+class Geofence : public testing::Test {
+protected:
+  virtual void SetUp() {
+    g = new struct geofence;
+  }
+
+  virtual void TearDown() {
+    delete g;
+  }
+
+  /* Random positions over the fence and a bit beyond it */
+  void compare(const struct shape &s, float margin, int points, uint32_t seed) {
+    int mismatches = 0, allowed = 0, near = 0;
+
+    for (int i = 0; i < points; i++) {
+      float n = random_coord(&seed, -2500, 2500);
+      float e = random_coord(&seed, -2500, 2500);
+
+      /* Every so often right on a vertex's line */
+      if (i % 16 == 0)
+        n = s.north[next_random(&seed) % s.north.size()];
+
+      float distance;
+      bool expect = s.allowed(n, e, &distance);
+      bool is_near;
+      bool actual = geofence_allowed(g, n, e, &is_near);
+
+      /* Positions right on the boundary could go either way */
+      if (distance < 1e-2f)
+        continue;
+
+      if (expect != actual) {
+        if (mismatches++ < 10)
+          ADD_FAILURE() << "at " << n << ", " << e;
+        continue;
+      }
+
+      if (actual) {
+        allowed++;
+        if (fabsf(distance - margin) > 1e-2f) {
+          EXPECT_EQ(distance < margin, is_near) << "at " << n << ", " << e;
+        }
+        near += is_near;
+      } else {
+        EXPECT_FALSE(is_near);
+      }
+    }
+
+    EXPECT_EQ(0, mismatches);
+
+    /* The shape gives a fair mix of each */
+    EXPECT_GT(allowed, points / 10);
+    EXPECT_LT(allowed, points * 9 / 10);
+    EXPECT_GT(near, points / 100);
+  }
+
+  struct geofence *g;
+};
+
+TEST_F(Geofence, NoFence) {
+  ASSERT_EQ(0, geofence_build(g, NULL, NULL, NULL, 0, 20));
+  EXPECT_FALSE(geofence_active(g));
+
+  bool near = true;
+  EXPECT_TRUE(geofence_allowed(g, 12345, -6789, &near));
+  EXPECT_FALSE(near);
+}
+
+TEST_F(Geofence, Square) {
+  struct shape s;
+  s.begin(false);
+  s.add(-100, -100);
+  s.add(-100, 100);
+  s.add(100, 100);
+  s.add(100, -100);
+
+  ASSERT_EQ(0, s.build(g, 20));
+  EXPECT_TRUE(geofence_active(g));
+  EXPECT_TRUE(g->indexed);
+
+  bool near;
+  EXPECT_TRUE(geofence_allowed(g, 0, 0, &near));
+  EXPECT_FALSE(near);
+  EXPECT_TRUE(geofence_allowed(g, 90, 0, &near));
+  EXPECT_TRUE(near);
+  EXPECT_TRUE(geofence_allowed(g, -95, -95, &near));
+  EXPECT_TRUE(near);
+  EXPECT_FALSE(geofence_allowed(g, 110, 0, &near));
+  EXPECT_FALSE(near);
+  EXPECT_FALSE(geofence_allowed(g, 0, -5000, &near));
+
+  /* An exclusion zone only, around the same square */
+  s.polygons[0].exclusion = true;
+  ASSERT_EQ(0, s.build(g, 20));
+  EXPECT_FALSE(geofence_allowed(g, 0, 0, &near));
+  EXPECT_TRUE(geofence_allowed(g, 110, 0, &near));
+  EXPECT_TRUE(near);
+  EXPECT_TRUE(geofence_allowed(g, 0, -5000, &near));
+  EXPECT_FALSE(near);
+}
+
+TEST_F(Geofence, Invalid) {
+  struct shape s;
+  s.begin(false);
+  s.add(0, 0);
+  s.add(100, 0);
+
+  EXPECT_EQ(-1, s.build(g, 20));
+  EXPECT_FALSE(geofence_active(g));
+
+  /* More vertices than there is room for */
+  s.polygons.clear();
+  s.north.clear();
+  s.east.clear();
+  s.begin(false);
+  for (int i = 0; i < GEOFENCE_MAX_VERTICES + 1; i++)
+    s.add(100 * cosf(i * 0.01f), 100 * sinf(i * 0.01f));
+
+  EXPECT_EQ(-1, s.build(g, 20));
+  EXPECT_FALSE(geofence_active(g));
+}
+
+TEST_F(Geofence, ComplexShapes) {
+  static const int star_points[] = { 8, 12, 16, MAX_STAR_POINTS };
+
+  for (unsigned int i = 0; i < sizeof(star_points) / sizeof(star_points[0]); i++) {
+    int points = star_points[i];
+    struct shape s = complex_shape(points, points);
+
+    ASSERT_EQ(points + OTHER_VERTICES, (int) s.north.size());
+    ASSERT_EQ(GEOFENCE_MAX_POLYGONS, (int) s.polygons.size());
+
+    ASSERT_EQ(0, s.build(g, 25)) << points << " point star";
+    EXPECT_TRUE(g->indexed);
+
+    compare(s, 25, 20000, points);
+  }
+}
+
+TEST_F(Geofence, TooBigToIndex) {
+  struct shape s = complex_shape(MAX_STAR_POINTS, 1);
+
+  /* A margin this large puts every edge into every cell */
+  ASSERT_EQ(1, s.build(g, 3000));
+  EXPECT_FALSE(g->indexed);
+  EXPECT_TRUE(geofence_active(g));
+
+  uint32_t seed = 2;
+  for (int i = 0; i < 2000; i++) {
+    float n = random_coord(&seed, -2500, 2500);
+    float e = random_coord(&seed, -2500, 2500);
+    float distance;
+    bool near;
+
+    if (s.allowed(n, e, &distance)) {
+      EXPECT_TRUE(geofence_allowed(g, n, e, &near));
+      EXPECT_TRUE(near);
+    } else if (distance > 1e-2f) {
+      EXPECT_FALSE(geofence_allowed(g, n, e, &near));
+    }
+  }
+}
+
+/* At the sizes there is room for: those GeoFencePolygons holds here, and
+ * fences of hundreds of vertices in geofence_large */
+TEST_F(Geofence, Benchmark) {
+  static const int star_points[] = { 4, 64, 192, 640, MAX_STAR_POINTS };
+
+  for (unsigned int p = 0; p < sizeof(star_points) / sizeof(star_points[0]); p++) {
+    if (star_points[p] > MAX_STAR_POINTS)
+      continue;
+
+    struct shape s = complex_shape(star_points[p], 3);
+
+    double start = now_s();
+    ASSERT_EQ(0, s.build(g, 25));
+    double build_s = now_s() - start;
+
+    const int queries = 100000;
+    static float pos[queries][2];
+    uint32_t seed = 4;
+
+    for (int i = 0; i < queries; i++) {
+      pos[i][0] = random_coord(&seed, -2500, 2500);
+      pos[i][1] = random_coord(&seed, -2500, 2500);
+    }
+
+    volatile int sink = 0;
+
+    start = now_s();
+    for (int i = 0; i < queries; i++) {
+      float distance;
+      sink += s.allowed(pos[i][0], pos[i][1], &distance) && distance < 25;
+    }
+    double plain_s = now_s() - start;
+
+    start = now_s();
+    for (int i = 0; i < queries; i++) {
+      bool near;
+      sink += geofence_allowed(g, pos[i][0], pos[i][1], &near) && near;
+    }
+    double indexed_s = now_s() - start;
+
+    printf("%4u vertices: %7.2f us per check over all edges, %5.2f us indexed, "
+        "%6.1f us to build, %u edges in cells\n",
+        (unsigned int) s.north.size(), plain_s / queries * 1e6,
+        indexed_s / queries * 1e6, build_s * 1e6,
+        g->cell_start[GEOFENCE_GRID * GEOFENCE_GRID]);
+  }
+}
+
+/**
+ * @}
+ * @}
+ */
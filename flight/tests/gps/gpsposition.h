@@ -0,0 +1,59 @@
+/**
+ ******************************************************************************
+ * @file       gpsposition.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Stand-in for the generated GPSPosition UAVObject
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef GPSPOSITION_H
+#define GPSPOSITION_H
+
+#include <stdint.h>
+
+#define GPSPOSITION_OBJID 0x1
+
+typedef enum {
+	GPSPOSITION_STATUS_NOGPS = 0,
+	GPSPOSITION_STATUS_NOFIX = 1,
+	GPSPOSITION_STATUS_FIX2D = 2,
+	GPSPOSITION_STATUS_FIX3D = 3,
+	GPSPOSITION_STATUS_DIFF3D = 4
+} GPSPositionStatusOptions;
+
+typedef struct {
+	int32_t Latitude;
+	int32_t Longitude;
+	float Altitude;
+	float GeoidSeparation;
+	float Heading;
+	float Groundspeed;
+	float Accuracy;
+	float PDOP;
+	float HDOP;
+	float VDOP;
+	uint8_t Status;
+	uint8_t Satellites;
+} GPSPositionData;
+
+int32_t GPSPositionSet(const GPSPositionData *dataIn);
+
+#endif /* GPSPOSITION_H */
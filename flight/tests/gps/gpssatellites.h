@@ -0,0 +1,44 @@
+/**
+ ******************************************************************************
+ * @file       gpssatellites.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Stand-in for the generated GPSSatellites UAVObject
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef GPSSATELLITES_H
+#define GPSSATELLITES_H
+
+#include <stdint.h>
+
+#define GPSSATELLITES_PRN_NUMELEM 30
+
+typedef struct {
+	int16_t Azimuth[30];
+	uint8_t SatsInView;
+	uint8_t PRN[30];
+	int8_t Elevation[30];
+	int8_t SNR[30];
+} GPSSatellitesData;
+
+int32_t GPSSatellitesSet(const GPSSatellitesData *dataIn);
+
+#endif /* GPSSATELLITES_H */
@@ -0,0 +1,44 @@
+/**
+ ******************************************************************************
+ * @file       gpstime.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Stand-in for the generated GPSTime UAVObject
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef GPSTIME_H
+#define GPSTIME_H
+
+#include <stdint.h>
+
+typedef struct {
+	int16_t Year;
+	int8_t Month;
+	int8_t Day;
+	int8_t Hour;
+	int8_t Minute;
+	int8_t Second;
+} GPSTimeData;
+
+int32_t GPSTimeGet(GPSTimeData *dataOut);
+int32_t GPSTimeSet(const GPSTimeData *dataIn);
+
+#endif /* GPSTIME_H */
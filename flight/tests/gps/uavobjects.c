@@ -0,0 +1,87 @@
+/**
+ ******************************************************************************
+ * @file       uavobjects.c
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Records the UAVObject updates made by the GPS parsers
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <string.h>
+#include "uavobjects.h"
+
+struct uavo_updates uavo_updates;
+
+void uavo_updates_reset(void)
+{
+	memset(&uavo_updates, 0, sizeof(uavo_updates));
+}
+
+int32_t GPSPositionSet(const GPSPositionData *dataIn)
+{
+	uavo_updates.position = *dataIn;
+	uavo_updates.position_sets++;
+	return 0;
+}
+
+int32_t GPSVelocitySet(const GPSVelocityData *dataIn)
+{
+	uavo_updates.velocity = *dataIn;
+	uavo_updates.velocity_sets++;
+	return 0;
+}
+
+int32_t GPSSatellitesSet(const GPSSatellitesData *dataIn)
+{
+	uavo_updates.satellites = *dataIn;
+	uavo_updates.satellites_sets++;
+	return 0;
+}
+
+int32_t GPSTimeGet(GPSTimeData *dataOut)
+{
+	*dataOut = uavo_updates.time;
+	return 0;
+}
+
+int32_t GPSTimeSet(const GPSTimeData *dataIn)
+{
+	uavo_updates.time = *dataIn;
+	uavo_updates.time_sets++;
+	return 0;
+}
+
+int32_t UBloxInfoGet(UBloxInfoData *dataOut)
+{
+	*dataOut = uavo_updates.ublox;
+	return 0;
+}
+
+int32_t UBloxInfoSet(const UBloxInfoData *dataIn)
+{
+	uavo_updates.ublox = *dataIn;
+	return 0;
+}
+
+int32_t UBloxInfoParseErrorsSet(const uint32_t *newParseErrors)
+{
+	uavo_updates.ublox.ParseErrors = *newParseErrors;
+	return 0;
+}
@@ -0,0 +1,52 @@
+/**
+ ******************************************************************************
+ * @file       uavobjects.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Records the UAVObject updates made by the GPS parsers
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef UAVOBJECTS_H
+#define UAVOBJECTS_H
+
+#include "gpsposition.h"
+#include "gpsvelocity.h"
+#include "gpssatellites.h"
+#include "gpstime.h"
+#include "ubloxinfo.h"
+
+struct uavo_updates {
+	uint32_t position_sets;
+	uint32_t velocity_sets;
+	uint32_t satellites_sets;
+	uint32_t time_sets;
+	GPSPositionData position;
+	GPSVelocityData velocity;
+	GPSSatellitesData satellites;
+	GPSTimeData time;
+	UBloxInfoData ublox;
+};
+
+extern struct uavo_updates uavo_updates;
+
+void uavo_updates_reset(void);
+
+#endif /* UAVOBJECTS_H */
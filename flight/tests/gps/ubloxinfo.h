@@ -0,0 +1,42 @@
+/**
+ ******************************************************************************
+ * @file       ubloxinfo.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Stand-in for the generated UBloxInfo UAVObject
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef UBLOXINFO_H
+#define UBLOXINFO_H
+
+#include <stdint.h>
+
+typedef struct {
+	uint32_t swVersion;
+	uint32_t ParseErrors;
+	uint16_t hwVersion;
+} UBloxInfoData;
+
+int32_t UBloxInfoGet(UBloxInfoData *dataOut);
+int32_t UBloxInfoSet(const UBloxInfoData *dataIn);
+int32_t UBloxInfoParseErrorsSet(const uint32_t *newParseErrors);
+
+#endif /* UBLOXINFO_H */
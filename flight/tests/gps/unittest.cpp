@@ -0,0 +1,665 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test of the UBX and NMEA GPS parsers
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* rand_r */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+extern "C" {
+
+#include "GPS.h"
+#include "NMEA.h"
+#include "uavobjects.h"
+
+/* UBX.h can't be included from C++, as its header struct has a member named class */
+int parse_ubx_stream(uint8_t, char *, GPSPositionData *, struct GPS_RX_STATS *);
+int parse_ubx_buffer(const uint8_t *, uint16_t, char *, GPSPositionData *, struct GPS_RX_STATS *);
+
+}
+
+/* Large enough for any UBX message the parser accepts */
+#define RX_BUFFER_SIZE 512
+
+/* As GPS.c reads the COM port */
+#define COM_READ_SIZE 32
+
+/* A minute of data at 10Hz */
+#define REPLAY_EPOCHS 600
+
+typedef std::vector<uint8_t> Stream;
+
+/*
+ * Each stream starts at a later time of week than the last, as the UBX
+ * parser ignores navigation messages older than those it has seen.
+ */
+static uint32_t next_tow = 100000;
+
+static uint32_t take_tows(int epochs)
+{
+	uint32_t tow = next_tow;
+	next_tow += (epochs + 10) * 100;
+	return tow;
+}
+
+/* Feeds a stream to a parser in reads of the given size, as the GPS task does */
+typedef int (*bulk_parser)(const uint8_t *, uint16_t, char *, GPSPositionData *, struct GPS_RX_STATS *);
+typedef int (*byte_parser)(uint8_t, char *, GPSPositionData *, struct GPS_RX_STATS *);
+
+class ParserTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    uavo_updates_reset();
+    memset(&position, 0, sizeof(position));
+    memset(&stats, 0, sizeof(stats));
+    memset(rx_buffer, 0, sizeof(rx_buffer));
+  }
+
+  int feed(bulk_parser parser, const Stream &stream, size_t read_size) {
+    int completed = 0;
+    for (size_t i = 0; i < stream.size(); i += read_size) {
+      size_t n = std::min(read_size, stream.size() - i);
+      if (parser(&stream[i], n, rx_buffer, &position, &stats) == PARSER_COMPLETE)
+        completed++;
+    }
+    return completed;
+  }
+
+  int feed_bytes(byte_parser parser, const Stream &stream) {
+    int completed = 0;
+    for (size_t i = 0; i < stream.size(); i++) {
+      if (parser(stream[i], rx_buffer, &position, &stats) == PARSER_COMPLETE)
+        completed++;
+    }
+    return completed;
+  }
+
+  char rx_buffer[RX_BUFFER_SIZE];
+  GPSPositionData position;
+  struct GPS_RX_STATS stats;
+};
+
+/* Everything the parsers published, for comparing two runs */
+struct Outcome {
+  struct GPS_RX_STATS stats;
+  struct uavo_updates updates;
+};
+
+static void expect_same(const Outcome &a, const Outcome &b)
+{
+  EXPECT_EQ(a.stats.gpsRxReceived, b.stats.gpsRxReceived);
+  EXPECT_EQ(a.stats.gpsRxChkSumError, b.stats.gpsRxChkSumError);
+  EXPECT_EQ(a.stats.gpsRxOverflow, b.stats.gpsRxOverflow);
+  EXPECT_EQ(a.stats.gpsRxParserError, b.stats.gpsRxParserError);
+
+  EXPECT_EQ(a.updates.position_sets, b.updates.position_sets);
+  EXPECT_EQ(a.updates.velocity_sets, b.updates.velocity_sets);
+  EXPECT_EQ(a.updates.satellites_sets, b.updates.satellites_sets);
+  EXPECT_EQ(a.updates.time_sets, b.updates.time_sets);
+
+  EXPECT_EQ(a.updates.position.Status, b.updates.position.Status);
+  EXPECT_EQ(a.updates.position.Latitude, b.updates.position.Latitude);
+  EXPECT_EQ(a.updates.position.Longitude, b.updates.position.Longitude);
+  EXPECT_EQ(a.updates.position.Satellites, b.updates.position.Satellites);
+  EXPECT_EQ(a.updates.position.Altitude, b.updates.position.Altitude);
+  EXPECT_EQ(a.updates.position.Groundspeed, b.updates.position.Groundspeed);
+  EXPECT_EQ(a.updates.position.Heading, b.updates.position.Heading);
+  EXPECT_EQ(a.updates.position.PDOP, b.updates.position.PDOP);
+  EXPECT_EQ(a.updates.velocity.North, b.updates.velocity.North);
+  EXPECT_EQ(0, memcmp(a.updates.satellites.PRN, b.updates.satellites.PRN, sizeof(a.updates.satellites.PRN)));
+}
+
+/* Sizes of the chunks a stream is split into, including single bytes and odd sizes */
+static const size_t read_sizes[] = { 1, 2, 3, 7, 13, COM_READ_SIZE, 61, 256, 100000 };
+
+/*
+ * UBX
+ */
+
+static void put_u8(Stream &s, size_t offset, uint8_t v) { s[offset] = v; }
+static void put_u16(Stream &s, size_t offset, uint16_t v) { s[offset] = v; s[offset + 1] = v >> 8; }
+static void put_u32(Stream &s, size_t offset, uint32_t v) {
+  for (int i = 0; i < 4; i++)
+    s[offset + i] = v >> (8 * i);
+}
+
+static void ubx_append(Stream &out, uint8_t cls, uint8_t id, const Stream &payload, bool corrupt = false)
+{
+  Stream msg;
+  msg.push_back(cls);
+  msg.push_back(id);
+  msg.push_back(payload.size() & 0xff);
+  msg.push_back(payload.size() >> 8);
+  msg.insert(msg.end(), payload.begin(), payload.end());
+
+  uint8_t ck_a = 0, ck_b = 0;
+  for (size_t i = 0; i < msg.size(); i++) {
+    ck_a += msg[i];
+    ck_b += ck_a;
+  }
+  if (corrupt)
+    ck_b ^= 0x5a;
+
+  out.push_back(0xb5);
+  out.push_back(0x62);
+  out.insert(out.end(), msg.begin(), msg.end());
+  out.push_back(ck_a);
+  out.push_back(ck_b);
+}
+
+#define LATITUDE 473977418
+#define LONGITUDE 85455939
+
+/* One navigation epoch: SOL, POSLLH, VELNED and DOP, which make up a GPSPosition update */
+static void ubx_epoch(Stream &out, uint32_t tow, int epoch, bool corrupt = false)
+{
+  Stream sol(52, 0);
+  put_u32(sol, 0, tow);
+  put_u8(sol, 10, 0x03);		// 3D fix
+  put_u8(sol, 11, 0x01);		// fix OK
+  put_u32(sol, 24, 150);		// pAcc, cm
+  put_u16(sol, 44, 140);		// pDOP
+  put_u8(sol, 47, 12);		// numSV
+  ubx_append(out, 0x01, 0x06, sol);
+
+  Stream posllh(28, 0);
+  put_u32(posllh, 0, tow);
+  put_u32(posllh, 4, LONGITUDE - epoch);
+  put_u32(posllh, 8, LATITUDE + epoch);
+  put_u32(posllh, 12, 548000);	// height above ellipsoid, mm
+  put_u32(posllh, 16, 500000);	// height above MSL, mm
+  ubx_append(out, 0x01, 0x02, posllh, corrupt);
+
+  Stream velned(36, 0);
+  put_u32(velned, 0, tow);
+  put_u32(velned, 4, 120 + epoch % 7);	// velN, cm/s
+  put_u32(velned, 8, (uint32_t) -35);	// velE, cm/s
+  put_u32(velned, 12, 5);		// velD, cm/s
+  put_u32(velned, 20, 125);		// gSpeed, cm/s
+  put_u32(velned, 24, 34500000);	// heading, 1e-5 deg
+  put_u32(velned, 28, 40);		// sAcc
+  ubx_append(out, 0x01, 0x12, velned);
+
+  Stream dop(18, 0);
+  put_u32(dop, 0, tow);
+  put_u16(dop, 6, 140);		// pDOP
+  put_u16(dop, 10, 110);		// vDOP
+  put_u16(dop, 12, 80);		// hDOP
+  ubx_append(out, 0x01, 0x04, dop);
+}
+
+/* Once a second the receiver also sends the satellites and time */
+static void ubx_second(Stream &out, uint32_t tow)
+{
+  const int channels = 16;
+  Stream svinfo(8 + 12 * channels, 0);
+  put_u32(svinfo, 0, tow);
+  put_u8(svinfo, 4, channels);
+  for (int i = 0; i < channels; i++) {
+    size_t sv = 8 + 12 * i;
+    put_u8(svinfo, sv + 0, i);		// chn
+    put_u8(svinfo, sv + 1, 1 + 2 * i);	// svid
+    put_u8(svinfo, sv + 4, (i % 3) ? 30 + i : 0);	// cno
+    put_u8(svinfo, sv + 5, 10 + 4 * i);	// elev
+    put_u16(svinfo, sv + 6, 20 * i);	// azim
+  }
+  ubx_append(out, 0x01, 0x30, svinfo);
+
+  Stream timeutc(20, 0);
+  put_u32(timeutc, 0, tow);
+  put_u16(timeutc, 12, 2016);
+  put_u8(timeutc, 14, 7);
+  put_u8(timeutc, 15, 14);
+  put_u8(timeutc, 16, 12);
+  put_u8(timeutc, 17, 34);
+  put_u8(timeutc, 18, (tow / 1000) % 60);
+  put_u8(timeutc, 19, 0x07);		// valid TOW, WKN, UTC
+  ubx_append(out, 0x01, 0x21, timeutc);
+}
+
+/*
+ * A receiver stream as the GPS task sees it. With noise, there is line
+ * garbage between messages, some of it looking like the start of a message,
+ * and the odd message has a bad checksum.
+ */
+static Stream ubx_stream(int epochs, bool noise, unsigned int seed = 1)
+{
+  Stream out;
+  uint32_t tow = take_tows(epochs);
+
+  for (int epoch = 0; epoch < epochs; epoch++, tow += 100) {
+    if (epoch % 10 == 0)
+      ubx_second(out, tow);
+
+    bool corrupt = noise && (rand_r(&seed) % 50 == 0);
+    ubx_epoch(out, tow, epoch, corrupt);
+
+    if (noise && rand_r(&seed) % 4 == 0) {
+      int garbage = rand_r(&seed) % 20;
+      for (int i = 0; i < garbage; i++)
+        out.push_back((rand_r(&seed) % 8 == 0) ? 0xb5 : rand_r(&seed));
+    }
+  }
+
+  // Run out any message started by the garbage, so the next test starts clean
+  out.insert(out.end(), RX_BUFFER_SIZE + 8, 0);
+
+  return out;
+}
+
+class UbxTest : public ParserTest {
+protected:
+  Outcome replay(const Stream &stream, size_t read_size) {
+    SetUp();
+    feed(parse_ubx_buffer, stream, read_size);
+    Outcome outcome = { stats, uavo_updates };
+    return outcome;
+  }
+};
+
+TEST_F(UbxTest, CompleteEpochInOneRead) {
+  Stream stream;
+  uint32_t tow = take_tows(1);
+  ubx_epoch(stream, tow, 0);
+
+  EXPECT_EQ(PARSER_COMPLETE, parse_ubx_buffer(&stream[0], stream.size(), rx_buffer, &position, &stats));
+
+  EXPECT_EQ(4u, stats.gpsRxReceived);
+  EXPECT_EQ(0u, stats.gpsRxChkSumError);
+  EXPECT_EQ(1u, uavo_updates.position_sets);
+  EXPECT_EQ(1u, uavo_updates.velocity_sets);
+
+  EXPECT_EQ(GPSPOSITION_STATUS_FIX3D, uavo_updates.position.Status);
+  EXPECT_EQ(LATITUDE, uavo_updates.position.Latitude);
+  EXPECT_EQ(LONGITUDE, uavo_updates.position.Longitude);
+  EXPECT_FLOAT_EQ(500.0f, uavo_updates.position.Altitude);
+  EXPECT_FLOAT_EQ(48.0f, uavo_updates.position.GeoidSeparation);
+  EXPECT_EQ(12, uavo_updates.position.Satellites);
+  EXPECT_FLOAT_EQ(1.5f, uavo_updates.position.Accuracy);
+  EXPECT_FLOAT_EQ(1.4f, uavo_updates.position.PDOP);
+  EXPECT_FLOAT_EQ(0.8f, uavo_updates.position.HDOP);
+  EXPECT_FLOAT_EQ(1.25f, uavo_updates.position.Groundspeed);
+  EXPECT_FLOAT_EQ(345.0f, uavo_updates.position.Heading);
+  EXPECT_FLOAT_EQ(1.2f, uavo_updates.velocity.North);
+  EXPECT_FLOAT_EQ(-0.35f, uavo_updates.velocity.East);
+}
+
+TEST_F(UbxTest, ReturnValues) {
+  Stream stream;
+  ubx_epoch(stream, take_tows(1), 0);
+
+  // Partway through the first message
+  EXPECT_EQ(PARSER_INCOMPLETE, parse_ubx_buffer(&stream[0], 10, rx_buffer, &position, &stats));
+  // Finishes it
+  EXPECT_EQ(PARSER_COMPLETE, parse_ubx_buffer(&stream[10], stream.size() - 10, rx_buffer, &position, &stats));
+
+  // Nothing usable
+  const uint8_t garbage[] = { 0x00, 0x13, 0x62, 0xff };
+  EXPECT_EQ(PARSER_ERROR, parse_ubx_buffer(garbage, sizeof(garbage), rx_buffer, &position, &stats));
+}
+
+TEST_F(UbxTest, SplitAtEveryOffset) {
+  Stream stream;
+  ubx_epoch(stream, take_tows(1), 0);
+  Outcome whole = replay(stream, stream.size());
+  EXPECT_EQ(1u, whole.updates.position_sets);
+
+  for (size_t split = 1; split < stream.size(); split++) {
+    Stream epoch;
+    ubx_epoch(epoch, take_tows(1), 0);
+
+    SetUp();
+    parse_ubx_buffer(&epoch[0], split, rx_buffer, &position, &stats);
+    parse_ubx_buffer(&epoch[split], epoch.size() - split, rx_buffer, &position, &stats);
+
+    Outcome outcome = { stats, uavo_updates };
+    expect_same(whole, outcome);
+  }
+}
+
+TEST_F(UbxTest, ReadSizesAgree) {
+  Stream stream = ubx_stream(200, true);
+  Outcome bytewise = replay(stream, 1);
+
+  EXPECT_GT(bytewise.updates.position_sets, 150u);
+  EXPECT_GT(bytewise.stats.gpsRxChkSumError, 0u);
+  EXPECT_EQ(20u, bytewise.updates.satellites_sets);
+
+  for (size_t i = 0; i < sizeof(read_sizes) / sizeof(read_sizes[0]); i++) {
+    // Same data, later time of week
+    Stream again = ubx_stream(200, true);
+    expect_same(bytewise, replay(again, read_sizes[i]));
+  }
+}
+
+TEST_F(UbxTest, ByteAtATimeEntryPoint) {
+  Stream stream = ubx_stream(50, true, 7);
+  Outcome bulk = replay(stream, COM_READ_SIZE);
+
+  SetUp();
+  feed_bytes(parse_ubx_stream, ubx_stream(50, true, 7));
+  Outcome bytes = { stats, uavo_updates };
+
+  expect_same(bulk, bytes);
+}
+
+TEST_F(UbxTest, BadChecksumDropped) {
+  Stream stream;
+  ubx_epoch(stream, take_tows(1), 0, true);
+
+  feed(parse_ubx_buffer, stream, COM_READ_SIZE);
+
+  EXPECT_EQ(3u, stats.gpsRxReceived);
+  EXPECT_EQ(1u, stats.gpsRxChkSumError);
+  EXPECT_EQ(0u, uavo_updates.position_sets);
+}
+
+TEST_F(UbxTest, OversizeLengthResyncs) {
+  // A header claiming more payload than any message has
+  Stream stream = { 0xb5, 0x62, 0x01, 0x02, 0xff, 0x7f };
+  ubx_epoch(stream, take_tows(1), 0);
+
+  feed(parse_ubx_buffer, stream, COM_READ_SIZE);
+
+  EXPECT_EQ(1u, stats.gpsRxOverflow);
+  EXPECT_EQ(4u, stats.gpsRxReceived);
+  EXPECT_EQ(1u, uavo_updates.position_sets);
+}
+
+TEST_F(UbxTest, EmptyPayload) {
+  // Messages without payload, such as polls, go straight to the checksum
+  Stream stream;
+  ubx_append(stream, 0x0a, 0x04, Stream());
+  ubx_epoch(stream, take_tows(1), 0);
+
+  feed(parse_ubx_buffer, stream, COM_READ_SIZE);
+
+  EXPECT_EQ(0u, stats.gpsRxChkSumError);
+  EXPECT_EQ(5u, stats.gpsRxReceived);
+  EXPECT_EQ(1u, uavo_updates.position_sets);
+}
+
+/*
+ * NMEA
+ */
+
+static std::string nmea_sentence(const std::string &body, bool corrupt = false)
+{
+  uint8_t checksum = 0;
+  for (size_t i = 0; i < body.size(); i++)
+    checksum ^= body[i];
+  if (corrupt)
+    checksum ^= 0x11;
+
+  char tail[8];
+  snprintf(tail, sizeof(tail), "*%02X\r\n", checksum);
+  return "$" + body + tail;
+}
+
+static void nmea_append(Stream &out, const std::string &body, bool corrupt = false)
+{
+  std::string sentence = nmea_sentence(body, corrupt);
+  out.insert(out.end(), sentence.begin(), sentence.end());
+}
+
+/* One epoch: GGA, GSA, RMC and VTG */
+static void nmea_epoch(Stream &out, int epoch, bool corrupt = false)
+{
+  char body[100];
+  int seconds = epoch / 10;
+
+  snprintf(body, sizeof(body), "GPGGA,1234%02d.%d0,4807.%04d,N,01131.0000,E,1,08,0.9,545.4,M,46.9,M,,",
+           seconds % 60, epoch % 10, 380 + epoch % 1000);
+  nmea_append(out, body, corrupt);
+
+  nmea_append(out, "GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1");
+
+  snprintf(body, sizeof(body), "GPRMC,1234%02d.%d0,A,4807.%04d,N,01131.0000,E,022.4,084.4,140716,003.1,W,A",
+           seconds % 60, epoch % 10, 380 + epoch % 1000);
+  nmea_append(out, body);
+
+  nmea_append(out, "GPVTG,084.4,T,087.5,M,022.4,N,041.5,K,A");
+}
+
+/* Once a second, the satellites in view */
+static void nmea_second(Stream &out)
+{
+  nmea_append(out, "GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00");
+  nmea_append(out, "GPGSV,3,2,11,14,25,170,00,16,57,208,39,18,67,296,40,19,40,246,00");
+  nmea_append(out, "GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,");
+}
+
+static Stream nmea_stream(int epochs, bool noise, unsigned int seed = 1)
+{
+  Stream out;
+
+  for (int epoch = 0; epoch < epochs; epoch++) {
+    if (epoch % 10 == 0)
+      nmea_second(out);
+
+    bool corrupt = noise && (rand_r(&seed) % 50 == 0);
+    nmea_epoch(out, epoch, corrupt);
+
+    if (noise && rand_r(&seed) % 4 == 0) {
+      // Line noise, the odd stray start of sentence, and bare line endings
+      int garbage = rand_r(&seed) % 20;
+      for (int i = 0; i < garbage; i++) {
+        switch (rand_r(&seed) % 8) {
+        case 0: out.push_back('$'); break;
+        case 1: out.push_back('\r'); break;
+        case 2: out.push_back('\n'); break;
+        default: out.push_back(rand_r(&seed)); break;
+        }
+      }
+    }
+  }
+
+  // Overflow any sentence started by the garbage, so the next test starts clean
+  out.insert(out.end(), NMEA_MAX_PACKET_LENGTH + 1, 'x');
+
+  return out;
+}
+
+class NmeaTest : public ParserTest {
+protected:
+  Outcome replay(const Stream &stream, size_t read_size) {
+    SetUp();
+    feed(parse_nmea_buffer, stream, read_size);
+    Outcome outcome = { stats, uavo_updates };
+    return outcome;
+  }
+};
+
+TEST_F(NmeaTest, CompleteEpochInOneRead) {
+  Stream stream;
+  nmea_epoch(stream, 0);
+
+  EXPECT_EQ(PARSER_COMPLETE, parse_nmea_buffer(&stream[0], stream.size(), rx_buffer, &position, &stats));
+
+  EXPECT_EQ(4u, stats.gpsRxReceived);
+  EXPECT_EQ(0u, stats.gpsRxParserError);
+  EXPECT_EQ(1u, uavo_updates.position_sets);	// GGA only
+
+  // 48 deg 07.038 min N, 11 deg 31 min E
+  EXPECT_NEAR(481173000, uavo_updates.position.Latitude, 10);
+  EXPECT_NEAR(115166667, uavo_updates.position.Longitude, 10);
+  EXPECT_EQ(8, uavo_updates.position.Satellites);
+  EXPECT_FLOAT_EQ(545.4f, uavo_updates.position.Altitude);
+
+  // GSA and RMC came after the GGA, so show up in the next update
+  EXPECT_EQ(GPSPOSITION_STATUS_FIX3D, position.Status);
+  EXPECT_FLOAT_EQ(2.5f, position.PDOP);
+  EXPECT_NEAR(22.4f * 0.51444f, position.Groundspeed, 1e-4f);
+  EXPECT_EQ(2016, uavo_updates.time.Year);
+}
+
+TEST_F(NmeaTest, ReturnValues) {
+  Stream stream;
+  nmea_epoch(stream, 0);
+
+  EXPECT_EQ(PARSER_INCOMPLETE, parse_nmea_buffer(&stream[0], 10, rx_buffer, &position, &stats));
+  EXPECT_EQ(PARSER_COMPLETE, parse_nmea_buffer(&stream[10], stream.size() - 10, rx_buffer, &position, &stats));
+
+  const uint8_t garbage[] = "no sentence here\r\n";
+  EXPECT_EQ(PARSER_ERROR, parse_nmea_buffer(garbage, sizeof(garbage) - 1, rx_buffer, &position, &stats));
+}
+
+TEST_F(NmeaTest, SplitAtEveryOffset) {
+  Stream stream;
+  nmea_epoch(stream, 3);
+  Outcome whole = replay(stream, stream.size());
+  EXPECT_EQ(4u, whole.stats.gpsRxReceived);
+
+  for (size_t split = 1; split < stream.size(); split++) {
+    SetUp();
+    parse_nmea_buffer(&stream[0], split, rx_buffer, &position, &stats);
+    parse_nmea_buffer(&stream[split], stream.size() - split, rx_buffer, &position, &stats);
+
+    Outcome outcome = { stats, uavo_updates };
+    expect_same(whole, outcome);
+  }
+}
+
+TEST_F(NmeaTest, ReadSizesAgree) {
+  Stream stream = nmea_stream(200, true);
+  Outcome bytewise = replay(stream, 1);
+
+  EXPECT_GT(bytewise.updates.position_sets, 150u);
+  EXPECT_GT(bytewise.stats.gpsRxChkSumError, 0u);
+
+  for (size_t i = 0; i < sizeof(read_sizes) / sizeof(read_sizes[0]); i++)
+    expect_same(bytewise, replay(stream, read_sizes[i]));
+}
+
+TEST_F(NmeaTest, ByteAtATimeEntryPoint) {
+  Stream stream = nmea_stream(50, true, 7);
+  Outcome bulk = replay(stream, COM_READ_SIZE);
+
+  SetUp();
+  feed_bytes(parse_nmea_stream, stream);
+  Outcome bytes = { stats, uavo_updates };
+
+  expect_same(bulk, bytes);
+}
+
+TEST_F(NmeaTest, BadChecksumDropped) {
+  Stream stream;
+  nmea_epoch(stream, 0, true);
+
+  feed(parse_nmea_buffer, stream, COM_READ_SIZE);
+
+  EXPECT_EQ(1u, stats.gpsRxChkSumError);
+  EXPECT_EQ(3u, stats.gpsRxReceived);
+  EXPECT_EQ(0u, uavo_updates.position_sets);
+}
+
+TEST_F(NmeaTest, Overflow) {
+  // A sentence that never ends, then a good one
+  Stream stream(1, '$');
+  stream.insert(stream.end(), 2 * NMEA_MAX_PACKET_LENGTH, 'A');
+  nmea_epoch(stream, 0);
+
+  EXPECT_EQ(PARSER_OVERRUN, parse_nmea_buffer(&stream[0], NMEA_MAX_PACKET_LENGTH + 1, rx_buffer, &position, &stats));
+  feed(parse_nmea_buffer, Stream(stream.begin() + NMEA_MAX_PACKET_LENGTH + 1, stream.end()), COM_READ_SIZE);
+
+  EXPECT_EQ(1u, stats.gpsRxOverflow);
+  EXPECT_EQ(4u, stats.gpsRxReceived);
+  EXPECT_EQ(1u, uavo_updates.position_sets);
+}
+
+TEST_F(NmeaTest, SentenceFillingBuffer) {
+  // Exactly NMEA_MAX_PACKET_LENGTH bytes, including the line ending, still fits
+  std::string body = "GPTXT,01,01,02,";
+  std::string sentence = nmea_sentence(body);
+  body.append(NMEA_MAX_PACKET_LENGTH - sentence.size(), 'z');
+  sentence = nmea_sentence(body);
+  ASSERT_EQ((size_t) NMEA_MAX_PACKET_LENGTH, sentence.size());
+
+  Stream stream(sentence.begin(), sentence.end());
+  feed(parse_nmea_buffer, stream, COM_READ_SIZE);
+
+  EXPECT_EQ(0u, stats.gpsRxOverflow);
+  EXPECT_EQ(1u, stats.gpsRxParserError);	// no parser for TXT, but it was framed
+}
+
+/*
+ * Throughput of a minute of receiver output, fed a byte at a time as the
+ * GPS task used to, and in COM reads. This is reported rather than checked,
+ * as it depends on the machine and on the build flags.
+ */
+#define REPLAY_REPEATS 20
+
+template <class F>
+static double time_replay(F replay, size_t bytes)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < REPLAY_REPEATS; i++)
+    replay(i);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  return bytes * REPLAY_REPEATS / elapsed.count() / 1e6;
+}
+
+TEST_F(UbxTest, ReplayThroughput) {
+  // Each replay needs a later time of week, so generate them all up front
+  std::vector<Stream> bytewise_streams, bulk_streams;
+  for (int i = 0; i < REPLAY_REPEATS; i++)
+    bytewise_streams.push_back(ubx_stream(REPLAY_EPOCHS, false));
+  for (int i = 0; i < REPLAY_REPEATS; i++)
+    bulk_streams.push_back(ubx_stream(REPLAY_EPOCHS, false));
+  size_t size = bulk_streams[0].size();
+
+  double bytewise = time_replay([&](int i) { feed_bytes(parse_ubx_stream, bytewise_streams[i]); }, size);
+  double bulk = time_replay([&](int i) { feed(parse_ubx_buffer, bulk_streams[i], COM_READ_SIZE); }, size);
+
+  EXPECT_EQ((uint32_t) REPLAY_EPOCHS, uavo_updates.position_sets / (2 * REPLAY_REPEATS));
+
+  printf("[   BENCH  ] UBX %zu bytes: byte at a time %.1f MB/s, %d byte reads %.1f MB/s\n",
+         size, bytewise, COM_READ_SIZE, bulk);
+}
+
+TEST_F(NmeaTest, ReplayThroughput) {
+  Stream stream = nmea_stream(REPLAY_EPOCHS, false);
+
+  double bytewise = time_replay([&](int) { feed_bytes(parse_nmea_stream, stream); }, stream.size());
+  double bulk = time_replay([&](int) { feed(parse_nmea_buffer, stream, COM_READ_SIZE); }, stream.size());
+
+  printf("[   BENCH  ] NMEA %zu bytes: byte at a time %.1f MB/s, %d byte reads %.1f MB/s\n",
+         stream.size(), bytewise, COM_READ_SIZE, bulk);
+}
@@ -0,0 +1,438 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for the lockstep HITL step bookkeeping
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdint.h>		/* uint*_t */
+#include <math.h>		/* NAN */
+
+#include <deque>
+#include <map>
+#include <vector>
+
+extern "C" {
+
+#include "hitl_lockstep.h"
+
+}
+
+/*
+ * A scripted stand-in for the simulator and the autopilot: one roll axis
+ * with inertia and drag, stepped by the "GCS" only when the "autopilot" has
+ * answered with the output of its PI rate controller.  Both directions of the
+ * link lose frames with a fixed probability and delay them by a few ms.
+ */
+
+#define STEP_DT       0.002f	/* Simulated time per step */
+#define LINK_DELAY_MS 2
+
+struct frame {
+  uint32_t due_ms;
+  uint32_t step;
+  float value;		/* Gyro rate one way, roll command the other */
+};
+
+class Link {
+public:
+  Link(uint32_t seed, uint32_t loss_percent) : seed(seed), loss(loss_percent) {}
+
+  void send(uint32_t now_ms, uint32_t step, float value) {
+    if (next_random() % 100 < loss)
+      return;
+
+    struct frame f = { now_ms + LINK_DELAY_MS, step, value };
+    frames.push_back(f);
+  }
+
+  bool receive(uint32_t now_ms, struct frame *f) {
+    if (frames.empty() || frames.front().due_ms > now_ms)
+      return false;
+
+    *f = frames.front();
+    frames.pop_front();
+    return true;
+  }
+
+private:
+  uint32_t next_random() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+  }
+
+  std::deque<struct frame> frames;
+  uint32_t seed;
+  uint32_t loss;
+};
+
+struct run_result {
+  std::vector<float> rates;	/* Roll rate after each step */
+  std::map<uint32_t, int> runs;	/* Control loop runs per step */
+  uint32_t resends;
+  uint32_t lost;
+  uint32_t elapsed_ms;
+};
+
+static struct run_result run_lockstep(uint32_t steps, uint32_t loss_percent)
+{
+  struct run_result r;
+
+  Link to_fc(1, loss_percent), to_gcs(2, loss_percent);
+
+  struct hitl_lockstep_host host;
+  struct hitl_lockstep_fc fc;
+  hitl_lockstep_host_init(&host);
+  hitl_lockstep_fc_reset(&fc);
+
+  /* Physics */
+  const float inertia = 0.01f, drag = 0.02f, torque = 0.5f;
+  float rate = 0;
+
+  /* Rate controller; its integral must only see each step once */
+  const float target = 200, kp = 0.01f, ki = 0.05f;
+  float integral = 0, answer = 0;
+
+  uint32_t now = 0;
+  float sample = rate;
+
+  to_fc.send(now, hitl_lockstep_host_begin(&host, now), sample);
+
+  while (r.rates.size() < steps && now < 60000) {
+    now++;
+
+    struct frame f;
+
+    while (to_fc.receive(now, &f)) {
+      switch (hitl_lockstep_fc_receive(&fc, f.step)) {
+      case HITL_STEP_NEW:
+        r.runs[f.step]++;
+        integral += ki * (target - f.value) * STEP_DT;
+        answer = kp * (target - f.value) + integral;
+        to_gcs.send(now, f.step, answer);
+        break;
+      case HITL_STEP_REPEAT:
+        to_gcs.send(now, f.step, answer);
+        break;
+      case HITL_STEP_STALE:
+        break;
+      }
+    }
+
+    while (to_gcs.receive(now, &f)) {
+      if (!hitl_lockstep_host_ack(&host, f.step))
+        continue;
+
+      rate += (torque * f.value - drag * rate) / inertia * STEP_DT;
+      r.rates.push_back(rate);
+
+      sample = rate;
+      to_fc.send(now, hitl_lockstep_host_begin(&host, now), sample);
+    }
+
+    switch (hitl_lockstep_host_poll(&host, now)) {
+    case HITL_LOCKSTEP_WAIT:
+      break;
+    case HITL_LOCKSTEP_RESEND:
+      to_fc.send(now, host.step, sample);
+      break;
+    case HITL_LOCKSTEP_LOST:
+      to_fc.send(now, hitl_lockstep_host_begin(&host, now), sample);
+      break;
+    }
+  }
+
+  r.resends = host.resends;
+  r.lost = host.lost;
+  r.elapsed_ms = now;
+
+  return r;
+}
+
+class HitlLockstep : public testing::Test {
+};
+
+TEST_F(HitlLockstep, Lossless) {
+  struct run_result r = run_lockstep(1000, 0);
+
+  ASSERT_EQ(1000U, r.rates.size());
+  EXPECT_EQ(0U, r.resends);
+  EXPECT_EQ(0U, r.lost);
+
+  /* One round trip per step, and every step run exactly once */
+  EXPECT_EQ(1000U * 2 * LINK_DELAY_MS, r.elapsed_ms);
+  EXPECT_EQ(1000U, r.runs.size());
+  for (std::map<uint32_t, int>::iterator it = r.runs.begin(); it != r.runs.end(); ++it)
+    EXPECT_EQ(1, it->second) << "step " << it->first;
+
+  /* The controller settles the rate close to its target */
+  EXPECT_NEAR(200, r.rates.back(), 20);
+}
+
+TEST_F(HitlLockstep, LossyLinkKeepsTrajectory) {
+  struct run_result clean = run_lockstep(1000, 0);
+  struct run_result lossy = run_lockstep(1000, 10);
+
+  ASSERT_EQ(1000U, lossy.rates.size());
+  EXPECT_GT(lossy.resends, 0U);
+  EXPECT_EQ(0U, lossy.lost);
+
+  /* Lost frames and answers cost time, but no step runs twice... */
+  for (std::map<uint32_t, int>::iterator it = lossy.runs.begin(); it != lossy.runs.end(); ++it)
+    EXPECT_EQ(1, it->second) << "step " << it->first;
+
+  /* ...and the simulation is exactly the same as without losses */
+  for (unsigned int i = 0; i < clean.rates.size(); i++)
+    ASSERT_EQ(clean.rates[i], lossy.rates[i]) << "step " << i;
+
+  printf("Lossy link: %u resends, %u ms for %u steps (%u ms lossless)\n",
+      lossy.resends, lossy.elapsed_ms, (unsigned int) lossy.rates.size(),
+      clean.elapsed_ms);
+}
+
+TEST_F(HitlLockstep, StaleAndRepeatedFrames) {
+  struct hitl_lockstep_fc fc;
+  hitl_lockstep_fc_reset(&fc);
+
+  EXPECT_EQ(HITL_STEP_STALE, hitl_lockstep_fc_receive(&fc, 0));
+  EXPECT_EQ(HITL_STEP_NEW, hitl_lockstep_fc_receive(&fc, 5));
+  EXPECT_EQ(HITL_STEP_REPEAT, hitl_lockstep_fc_receive(&fc, 5));
+
+  /* A reordered older frame must not run the control loop again */
+  EXPECT_EQ(HITL_STEP_STALE, hitl_lockstep_fc_receive(&fc, 3));
+  EXPECT_EQ(5U, fc.last_step);
+
+  EXPECT_EQ(HITL_STEP_NEW, hitl_lockstep_fc_receive(&fc, 6));
+
+  /* After a reset, e.g. the simulator restarted, any step is new */
+  hitl_lockstep_fc_reset(&fc);
+  EXPECT_EQ(HITL_STEP_NEW, hitl_lockstep_fc_receive(&fc, 1));
+}
+
+TEST_F(HitlLockstep, LateAnswers) {
+  struct hitl_lockstep_host host;
+  hitl_lockstep_host_init(&host);
+
+  EXPECT_TRUE(hitl_lockstep_host_ready(&host));
+  uint32_t step = hitl_lockstep_host_begin(&host, 0);
+  EXPECT_EQ(1U, step);
+  EXPECT_FALSE(hitl_lockstep_host_ready(&host));
+
+  /* Answers to other steps do not complete it */
+  EXPECT_FALSE(hitl_lockstep_host_ack(&host, step + 1));
+  EXPECT_FALSE(hitl_lockstep_host_ready(&host));
+
+  EXPECT_TRUE(hitl_lockstep_host_ack(&host, step));
+  EXPECT_TRUE(hitl_lockstep_host_ready(&host));
+
+  /* Nor does a duplicate of the answer */
+  EXPECT_FALSE(hitl_lockstep_host_ack(&host, step));
+}
+
+TEST_F(HitlLockstep, GivesUp) {
+  struct hitl_lockstep_host host;
+  hitl_lockstep_host_init(&host);
+
+  uint32_t now = 1000;
+  uint32_t step = hitl_lockstep_host_begin(&host, now);
+
+  EXPECT_EQ(HITL_LOCKSTEP_WAIT, hitl_lockstep_host_poll(&host, now + HITL_LOCKSTEP_RESEND_MS - 1));
+
+  for (int i = 0; i < HITL_LOCKSTEP_MAX_RETRIES; i++) {
+    now += HITL_LOCKSTEP_RESEND_MS;
+    EXPECT_EQ(HITL_LOCKSTEP_RESEND, hitl_lockstep_host_poll(&host, now));
+    EXPECT_EQ(HITL_LOCKSTEP_WAIT, hitl_lockstep_host_poll(&host, now + 1));
+  }
+
+  now += HITL_LOCKSTEP_RESEND_MS;
+  EXPECT_EQ(HITL_LOCKSTEP_LOST, hitl_lockstep_host_poll(&host, now));
+  EXPECT_EQ((uint32_t) HITL_LOCKSTEP_MAX_RETRIES, host.resends);
+  EXPECT_EQ(1U, host.lost);
+  EXPECT_TRUE(hitl_lockstep_host_ready(&host));
+
+  /* Nothing is pending any more */
+  EXPECT_EQ(HITL_LOCKSTEP_WAIT, hitl_lockstep_host_poll(&host, now + 1000));
+  EXPECT_FALSE(hitl_lockstep_host_ack(&host, step));
+}
+
+/*
+ * The autopilot's PIOS_DELAY raw clock in lockstep: real time plus what
+ * hitl_lockstep_fc_advance() moved it forward by.
+ */
+static uint32_t clock_real_us;
+static uint32_t clock_skipped_us;
+
+static uint32_t clock_get_raw(void)
+{
+  return clock_real_us + clock_skipped_us;
+}
+
+static uint32_t clock_diff_us(uint32_t raw)
+{
+  return clock_get_raw() - raw;
+}
+
+static void clock_skip_us(uint32_t us)
+{
+  clock_skipped_us += us;
+}
+
+static const struct hitl_lockstep_clock fake_clock = {
+  clock_get_raw,
+  clock_diff_us,
+  clock_skip_us,
+};
+
+/*
+ * Steps of delta_time arrive every arrival_us of real time.  Each is
+ * published, and the control loop runs on it loop_us later, timing its dT
+ * on the clock as the stabilization loop does.
+ */
+static std::vector<uint32_t> run_clock(uint32_t steps, float delta_time,
+    uint32_t arrival_us, uint32_t loop_us, uint32_t start_us, uint32_t *real_us)
+{
+  std::vector<uint32_t> loop_dt;
+
+  struct hitl_lockstep_fc fc;
+  hitl_lockstep_fc_reset(&fc);
+
+  clock_real_us = start_us;
+  clock_skipped_us = 0;
+
+  uint32_t last_loop = 0;
+
+  for (uint32_t i = 0; i < steps; i++) {
+    EXPECT_EQ(HITL_STEP_NEW, hitl_lockstep_fc_receive(&fc, i + 1));
+    hitl_lockstep_fc_advance(&fc, &fake_clock, delta_time);
+    EXPECT_EQ(clock_get_raw(), fc.step_raw);
+
+    clock_real_us += loop_us;
+    if (i > 0)
+      loop_dt.push_back(clock_get_raw() - last_loop);
+    last_loop = clock_get_raw();
+
+    clock_real_us += arrival_us - loop_us;
+  }
+
+  *real_us = clock_real_us - start_us;
+
+  return loop_dt;
+}
+
+TEST_F(HitlLockstep, ClockStepsByDeltaTime) {
+  uint32_t real_us;
+
+  /* A simulator five times faster than real time */
+  std::vector<uint32_t> dt = run_clock(1000, STEP_DT, 400, 150, 1000, &real_us);
+
+  ASSERT_EQ(999U, dt.size());
+  for (unsigned int i = 0; i < dt.size(); i++)
+    ASSERT_EQ(2000U, dt[i]) << "step " << i;
+
+  EXPECT_EQ(400000U, real_us);
+
+  /* Also across the wraparound of the clock */
+  dt = run_clock(1000, STEP_DT, 400, 150, 0xfffc0000, &real_us);
+  for (unsigned int i = 0; i < dt.size(); i++)
+    ASSERT_EQ(2000U, dt[i]) << "step " << i;
+
+  /* Slower than real time the clock cannot go back, so it keeps to it */
+  dt = run_clock(100, STEP_DT, 3000, 150, 1000, &real_us);
+  for (unsigned int i = 0; i < dt.size(); i++)
+    ASSERT_EQ(3000U, dt[i]) << "step " << i;
+}
+
+TEST_F(HitlLockstep, ClockNotSkippedAfterReset) {
+  struct hitl_lockstep_fc fc;
+  hitl_lockstep_fc_reset(&fc);
+
+  clock_real_us = 1000;
+  clock_skipped_us = 0;
+
+  /* The first step only stamps the clock */
+  hitl_lockstep_fc_receive(&fc, 1);
+  hitl_lockstep_fc_advance(&fc, &fake_clock, STEP_DT);
+  EXPECT_EQ(0U, clock_skipped_us);
+  EXPECT_EQ(1000U, fc.step_raw);
+
+  clock_real_us += 400;
+  hitl_lockstep_fc_receive(&fc, 2);
+  hitl_lockstep_fc_advance(&fc, &fake_clock, STEP_DT);
+  EXPECT_EQ(1600U, clock_skipped_us);
+  EXPECT_EQ(3000U, fc.step_raw);
+
+  /* After the simulator stopped, the time without steps is not skipped */
+  hitl_lockstep_fc_reset(&fc);
+  clock_real_us += 400;
+  hitl_lockstep_fc_receive(&fc, 1);
+  hitl_lockstep_fc_advance(&fc, &fake_clock, STEP_DT);
+  EXPECT_EQ(1600U, clock_skipped_us);
+  EXPECT_EQ(3400U, fc.step_raw);
+}
+
+TEST_F(HitlLockstep, ClockSkip) {
+  EXPECT_EQ(1600U, hitl_lockstep_fc_skip(400, 0.002f));
+  EXPECT_EQ(0U, hitl_lockstep_fc_skip(2000, 0.002f));
+  EXPECT_EQ(0U, hitl_lockstep_fc_skip(2500, 0.002f));
+
+  /* Nonsense steps do not move the clock, nor do huge ones much */
+  EXPECT_EQ(0U, hitl_lockstep_fc_skip(0, 0));
+  EXPECT_EQ(0U, hitl_lockstep_fc_skip(0, -1));
+  EXPECT_EQ(0U, hitl_lockstep_fc_skip(0, NAN));
+  EXPECT_EQ((uint32_t) HITL_LOCKSTEP_MAX_STEP_US, hitl_lockstep_fc_skip(0, 1e9f));
+  EXPECT_EQ((uint32_t) HITL_LOCKSTEP_MAX_STEP_US, hitl_lockstep_fc_skip(0, INFINITY));
+}
+
+TEST_F(HitlLockstep, Wraparound) {
+  struct hitl_lockstep_host host;
+  struct hitl_lockstep_fc fc;
+  hitl_lockstep_host_init(&host);
+  hitl_lockstep_fc_reset(&fc);
+
+  host.step = 0xfffffffe;
+
+  uint32_t step = hitl_lockstep_host_begin(&host, 0);
+  EXPECT_EQ(0xffffffffU, step);
+  EXPECT_EQ(HITL_STEP_NEW, hitl_lockstep_fc_receive(&fc, step));
+  EXPECT_TRUE(hitl_lockstep_host_ack(&host, step));
+
+  /* Step 0 means "not stepping", so it is skipped */
+  step = hitl_lockstep_host_begin(&host, 0);
+  EXPECT_EQ(1U, step);
+  EXPECT_EQ(HITL_STEP_NEW, hitl_lockstep_fc_receive(&fc, step));
+  EXPECT_EQ(HITL_STEP_STALE, hitl_lockstep_fc_receive(&fc, 0xffffffff));
+}
+
+/**
+ * @}
+ * @}
+ */
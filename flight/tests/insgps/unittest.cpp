@@ -0,0 +1,313 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test of the INSGPS delayed GPS fusion
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <math.h>		/* sinf */
+
+#include <random>
+
+extern "C" {
+
+#include "insgps.h"
+#include "insgps_history.h"
+#include "physical_constants.h"
+
+}
+
+// Sensor rates, as the Attitude module sees them
+#define INS_DT 0.002f
+#define MAG_DIVIDER 10
+#define BARO_DIVIDER 10
+#define GPS_DIVIDER 100
+
+#define SIM_SECONDS 60.0f
+#define SETTLE_SECONDS 20.0f
+
+class InsHistory : public testing::Test {
+protected:
+  virtual void SetUp() {
+    ins_history_reset(&h);
+  }
+
+  struct ins_history h;
+};
+
+// A ramp of 1 per second in every state, stored at 500Hz for one second
+static void store_ramp(struct ins_history *h, float *current)
+{
+  float X[INS_HISTORY_STATES];
+
+  for (int n = 1; n <= 500; n++) {
+    for (int i = 0; i < INS_HISTORY_STATES; i++)
+      X[i] = n * INS_DT;
+    ins_history_store(h, X, INS_DT);
+  }
+
+  *current = 500 * INS_DT;
+}
+
+TEST_F(InsHistory, InterpolatesPastStates) {
+  float now;
+  store_ramp(&h, &now);
+
+  float X[INS_HISTORY_STATES], past[INS_HISTORY_STATES];
+  for (int i = 0; i < INS_HISTORY_STATES; i++)
+    X[i] = now;
+
+  const float ages[] = { 0.0f, 0.001f, 0.005f, 0.0125f, 0.1f, 0.153f, 0.3f };
+  for (float age : ages) {
+    ins_history_lookup(&h, X, age, past);
+    for (int i = 0; i < INS_HISTORY_STATES; i++)
+      EXPECT_NEAR(now - age, past[i], 1e-4f) << "age " << age;
+  }
+}
+
+TEST_F(InsHistory, ClampsToOldest) {
+  float now;
+  store_ramp(&h, &now);
+
+  float X[INS_HISTORY_STATES], past[INS_HISTORY_STATES], oldest[INS_HISTORY_STATES];
+  for (int i = 0; i < INS_HISTORY_STATES; i++)
+    X[i] = now;
+
+  // Anything beyond the span of the history gets its oldest state
+  float span = INS_HISTORY_LEN * INS_HISTORY_PERIOD_US / 1e6f;
+
+  ins_history_lookup(&h, X, span, oldest);
+  EXPECT_NEAR(now - span, oldest[0], INS_HISTORY_PERIOD_US / 1e6f);
+
+  ins_history_lookup(&h, X, 10.0f, past);
+  for (int i = 0; i < INS_HISTORY_STATES; i++)
+    EXPECT_EQ(oldest[i], past[i]);
+}
+
+TEST_F(InsHistory, EmptyReturnsCurrent) {
+  float X[INS_HISTORY_STATES] = { 1, 2, 3, 4, 5, 6 };
+  float past[INS_HISTORY_STATES];
+
+  ins_history_lookup(&h, X, 0.2f, past);
+  for (int i = 0; i < INS_HISTORY_STATES; i++)
+    EXPECT_EQ(X[i], past[i]);
+}
+
+TEST_F(InsHistory, ShiftMovesStoredStates) {
+  float now;
+  store_ramp(&h, &now);
+
+  float X[INS_HISTORY_STATES], past[INS_HISTORY_STATES];
+  float delta[INS_HISTORY_STATES] = { 1, -1, 2, -2, 3, -3 };
+  for (int i = 0; i < INS_HISTORY_STATES; i++)
+    X[i] = now + delta[i];
+
+  ins_history_shift(&h, delta);
+
+  ins_history_lookup(&h, X, 0.2f, past);
+  for (int i = 0; i < INS_HISTORY_STATES; i++)
+    EXPECT_NEAR(now - 0.2f + delta[i], past[i], 1e-4f);
+}
+
+TEST_F(InsHistory, PositionAndVelocityAges) {
+  float now;
+  store_ramp(&h, &now);
+
+  float X[INS_HISTORY_STATES], Y[INS_HISTORY_STATES];
+  for (int i = 0; i < INS_HISTORY_STATES; i++)
+    X[i] = Y[i] = now;
+
+  // Each measurement is looked up at its own epoch
+  h.pos_age = 0.15f;
+  h.vel_age = 0.05f;
+  ins_history_begin_correction(&h, X, Y, HORIZ_POS_SENSORS | HORIZ_VEL_SENSORS);
+  for (int i = 0; i < 3; i++)
+    EXPECT_NEAR(now - 0.15f, Y[i], 1e-4f);
+  for (int i = 3; i < 6; i++)
+    EXPECT_NEAR(now - 0.05f, Y[i], 1e-4f);
+
+  // Measurements not being fused are left alone
+  for (int i = 0; i < INS_HISTORY_STATES; i++)
+    Y[i] = now;
+  ins_history_begin_correction(&h, X, Y, HORIZ_VEL_SENSORS);
+  for (int i = 0; i < 3; i++)
+    EXPECT_EQ(now, Y[i]);
+
+  // The correction made is carried back through the history
+  for (int i = 0; i < INS_HISTORY_STATES; i++)
+    X[i] += 1;
+  ins_history_end_correction(&h, X);
+  ins_history_lookup(&h, X, 0.2f, Y);
+  for (int i = 0; i < INS_HISTORY_STATES; i++)
+    EXPECT_NEAR(now - 0.2f + 1, Y[i], 1e-4f);
+}
+
+/*
+ * Flies the filter around a 15m radius circle at about 12m/s, fed from
+ * noisy synthetic IMU, magnetometer and baro data and a 5Hz GPS whose
+ * solutions arrive latency seconds after the epoch they describe.
+ */
+class InsSimulation : public testing::Test {
+protected:
+  // Returns the RMS horizontal position error once the filter has settled
+  float fly(float latency, bool compensate) {
+    std::mt19937 rng(1234);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+
+    const float radius = 15.0f;
+    const float omega = 2 * M_PI / 8.0f;
+    const float Be[3] = { 400.0f, 0.0f, 900.0f };
+    const float zeros[3] = { 0, 0, 0 };
+    const float q[4] = { 1, 0, 0, 0 };
+
+    // As the Attitude module configures the filter, with the INSSettings defaults
+    const float accel_var[3] = { 0.003f, 0.003f, 0.003f };
+    const float gyro_var[3] = { 1e-5f, 1e-5f, 1e-4f };
+    const float mag_var[3] = { 10.0f, 10.0f, 100.0f };
+
+    INSGPSInit();
+    INSSetMagVar(mag_var);
+    INSSetAccelVar(accel_var);
+    INSSetGyroVar(gyro_var);
+    INSSetBaroVar(0.01f);
+    INSSetMagNorth(Be);
+    INSSetPosVelVar(0.25f, 0.01f, 1.0f);
+
+    float pos[3], vel[3];
+    truth(0, radius, omega, pos, vel, NULL);
+    INSSetState(pos, vel, q, zeros, zeros);
+
+    double sum_sq = 0;
+    int samples = 0;
+
+    int steps = SIM_SECONDS / INS_DT;
+    for (int n = 1; n <= steps; n++) {
+      float t = n * INS_DT;
+      float accel[3];
+      truth(t, radius, omega, pos, vel, accel);
+
+      float gyro_data[3], accel_data[3];
+      for (int i = 0; i < 3; i++) {
+        gyro_data[i] = 0.001f * noise(rng);
+        accel_data[i] = accel[i] + 0.05f * noise(rng);
+      }
+      accel_data[2] -= GRAVITY;
+
+      INSStatePrediction(gyro_data, accel_data, INS_DT);
+      INSCovariancePrediction(INS_DT);
+
+      uint16_t sensors = 0;
+      float mag[3] = { Be[0], Be[1], Be[2] };
+      float gps_pos[3] = { 0, 0, 0 };
+      float gps_vel[3] = { 0, 0, 0 };
+      float baro = -pos[2] + 0.3f * noise(rng);
+
+      if (n % MAG_DIVIDER == 0)
+        sensors |= MAG_SENSORS;
+      if (n % BARO_DIVIDER == 0)
+        sensors |= BARO_SENSOR;
+
+      if (n % GPS_DIVIDER == 0) {
+        float epoch_pos[3], epoch_vel[3];
+        truth(t - latency, radius, omega, epoch_pos, epoch_vel, NULL);
+
+        for (int i = 0; i < 3; i++) {
+          gps_pos[i] = epoch_pos[i] + 0.3f * noise(rng);
+          gps_vel[i] = epoch_vel[i] + 0.1f * noise(rng);
+        }
+
+        sensors |= HORIZ_POS_SENSORS | HORIZ_VEL_SENSORS | VERT_VEL_SENSORS;
+      }
+
+      INSSetPosVelAge(compensate ? latency : 0, compensate ? latency : 0);
+      INSCorrection(mag, gps_pos, gps_vel, baro, sensors);
+
+      if (t >= SETTLE_SECONDS) {
+        float est[3];
+        INSGetState(est, NULL, NULL, NULL, NULL);
+        sum_sq += powf(est[0] - pos[0], 2) + powf(est[1] - pos[1], 2);
+        samples++;
+      }
+    }
+
+    return sqrt(sum_sq / samples);
+  }
+
+private:
+  static void truth(float t, float radius, float omega,
+      float pos[3], float vel[3], float accel[3]) {
+    pos[0] = radius * cosf(omega * t);
+    pos[1] = radius * sinf(omega * t);
+    pos[2] = -10.0f;
+
+    vel[0] = -radius * omega * sinf(omega * t);
+    vel[1] = radius * omega * cosf(omega * t);
+    vel[2] = 0;
+
+    if (accel) {
+      accel[0] = -radius * omega * omega * cosf(omega * t);
+      accel[1] = -radius * omega * omega * sinf(omega * t);
+      accel[2] = 0;
+    }
+  }
+};
+
+TEST_F(InsSimulation, TracksCurrentGps) {
+  float error = fly(0.0f, false);
+  printf("RMS horizontal error, GPS without latency: %.3f m\n", error);
+
+  EXPECT_LT(error, 0.5f);
+}
+
+TEST_F(InsSimulation, AgeZeroUnchanged) {
+  // With no latency, telling the filter the age is zero changes nothing
+  EXPECT_EQ(fly(0.0f, false), fly(0.0f, true));
+}
+
+TEST_F(InsSimulation, LatencyCompensation) {
+  const float latencies[] = { 0.1f, 0.15f, 0.2f };
+
+  float current = fly(0.0f, false);
+
+  for (float latency : latencies) {
+    float uncompensated = fly(latency, false);
+    float compensated = fly(latency, true);
+
+    printf("RMS horizontal error, %3.0f ms latency: %.3f m uncompensated, %.3f m compensated\n",
+        latency * 1000, uncompensated, compensated);
+
+    EXPECT_LT(compensated, 0.5f * uncompensated);
+    EXPECT_LT(compensated, 1.5f * current + 0.1f);
+  }
+}
@@ -0,0 +1,338 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for the Mavlink bridge stream scheduler
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdint.h>		/* uint*_t */
+
+#include <vector>
+
+extern "C" {
+
+#include "mavlink_scheduler.h"
+
+}
+
+/* The streams of the bridge, with Mavlink 1 message sizes */
+enum {
+  ATTITUDE, GPS_RAW, VFR_HUD, RC_CHANNELS, HEARTBEAT, SYS_STATUS, GPS_ORIGIN,
+  NUM_STREAMS
+};
+
+static const char *stream_names[NUM_STREAMS] = {
+  "attitude", "gps_raw", "vfr_hud", "rc", "heartbeat", "sys_status", "origin"
+};
+
+static const struct mavlink_stream streams[NUM_STREAMS] = {
+  { 8 + 28, 20, 1000, 0 },
+  { 8 + 30, 100, 1000, 1 },
+  { 8 + 20, 100, 1000, 1 },
+  { 8 + 22, 100, 1000, 2 },
+  { 8 + 9, 200, 1000, 2 },
+  { 8 + 31, 500, 2000, 3 },
+  { 8 + 12, 1000, 5000, 3 },
+};
+
+/* How often the data of each stream changes in flight, 0 for never */
+static const uint32_t change_interval_ms[NUM_STREAMS] = {
+  2, 200, 2, 20, 0, 500, 0
+};
+
+#define TASK_PERIOD_MS 10
+#define TX_BUFFER 256		/* Bytes a serial port queues */
+
+/* A serial port, draining its transmit buffer at the baud rate */
+struct serial_sink {
+  uint32_t baud;
+  uint32_t queued_millibytes;
+  uint32_t max_queued;
+  uint32_t blocked;		/* Messages that did not fit in the buffer */
+  uint32_t bytes;
+
+  void tick_ms() {
+    uint32_t drained = baud / 10;
+
+    queued_millibytes = queued_millibytes > drained ? queued_millibytes - drained : 0;
+  }
+
+  void write(uint32_t len) {
+    queued_millibytes += len * 1000;
+    bytes += len;
+
+    if (queued_millibytes > TX_BUFFER * 1000)
+      blocked++;
+
+    if (queued_millibytes / 1000 > max_queued)
+      max_queued = queued_millibytes / 1000;
+  }
+};
+
+struct run_result {
+  double rate_hz[NUM_STREAMS];
+  uint32_t longest_gap_ms[NUM_STREAMS];
+  uint32_t max_queued;
+  uint32_t blocked;
+  double bytes_per_s;
+};
+
+static struct run_result run_link(uint32_t baud, uint8_t percent, uint32_t seconds)
+{
+  struct mavlink_scheduler sched;
+  struct serial_sink sink = { baud, 0, 0, 0, 0 };
+
+  uint32_t start = 12345;
+  mavlink_sched_init(&sched, streams, NUM_STREAMS,
+      mavlink_sched_link_budget(baud, percent), start);
+
+  uint32_t sent[NUM_STREAMS] = { 0 };
+  uint32_t last_sent[NUM_STREAMS];
+  struct run_result r = {};
+
+  for (int i = 0; i < NUM_STREAMS; i++)
+    last_sent[i] = start;
+
+  for (uint32_t t = start; t < start + seconds * 1000; t++) {
+    sink.tick_ms();
+
+    for (int i = 0; i < NUM_STREAMS; i++)
+      if (change_interval_ms[i] && t % change_interval_ms[i] == 0)
+        mavlink_sched_changed(&sched, i);
+
+    if (t % TASK_PERIOD_MS)
+      continue;
+
+    int s;
+    while ((s = mavlink_sched_next(&sched, t)) >= 0) {
+      sink.write(streams[s].length);
+      sent[s]++;
+
+      if (t - last_sent[s] > r.longest_gap_ms[s])
+        r.longest_gap_ms[s] = t - last_sent[s];
+      last_sent[s] = t;
+    }
+  }
+
+  for (int i = 0; i < NUM_STREAMS; i++)
+    r.rate_hz[i] = (double) sent[i] / seconds;
+
+  r.max_queued = sink.max_queued;
+  r.blocked = sink.blocked;
+  r.bytes_per_s = (double) sink.bytes / seconds;
+
+  return r;
+}
+
+/* What the bridge did before: fixed rates from a 10Hz loop, whatever the link */
+static struct run_result run_fixed(uint32_t baud, uint32_t seconds)
+{
+  static const uint32_t fixed_hz[NUM_STREAMS] = { 10, 2, 2, 5, 2, 2, 2 };
+  struct serial_sink sink = { baud, 0, 0, 0, 0 };
+  struct run_result r = {};
+
+  for (uint32_t t = 0; t < seconds * 1000; t++) {
+    sink.tick_ms();
+
+    if (t % 100)
+      continue;
+
+    for (int i = 0; i < NUM_STREAMS; i++)
+      if ((t / 100) % (10 / fixed_hz[i]) == 0)
+        sink.write(streams[i].length);
+  }
+
+  r.max_queued = sink.max_queued;
+  r.blocked = sink.blocked;
+  r.bytes_per_s = (double) sink.bytes / seconds;
+
+  return r;
+}
+
+static void print_rates(const char *name, const struct run_result &r)
+{
+  printf("%-14s", name);
+  for (int i = 0; i < NUM_STREAMS; i++)
+    printf(" %s %5.1f", stream_names[i], r.rate_hz[i]);
+  printf(" Hz, %6.0f B/s\n", r.bytes_per_s);
+}
+
+class MavlinkScheduler : public testing::Test {
+};
+
+TEST_F(MavlinkScheduler, FastLinkSendsAsDataChanges) {
+  struct run_result r = run_link(115200, 80, 60);
+
+  /* Each as often as it may, or as its data changes */
+  EXPECT_NEAR(50, r.rate_hz[ATTITUDE], 0.5);
+  EXPECT_NEAR(5, r.rate_hz[GPS_RAW], 0.1);
+  EXPECT_NEAR(10, r.rate_hz[VFR_HUD], 0.1);
+  EXPECT_NEAR(10, r.rate_hz[RC_CHANNELS], 0.1);
+  EXPECT_NEAR(2, r.rate_hz[SYS_STATUS], 0.1);
+
+  /* Unchanged data is only refreshed at the slowest rate */
+  EXPECT_NEAR(1, r.rate_hz[HEARTBEAT], 0.05);
+  EXPECT_NEAR(0.2, r.rate_hz[GPS_ORIGIN], 0.05);
+
+  EXPECT_EQ(0U, r.blocked);
+}
+
+TEST_F(MavlinkScheduler, SlowLinkStaysWithinBudget) {
+  const uint32_t seconds = 60;
+
+  for (uint32_t baud = 2400; baud <= 19200; baud *= 2) {
+    struct run_result r = run_link(baud, 80, seconds);
+
+    /* Never more than the budget, and the port never fills up */
+    EXPECT_LE(r.bytes_per_s, baud / 10 * 0.8 + 1) << baud;
+    EXPECT_EQ(0U, r.blocked) << baud;
+    EXPECT_LE(r.max_queued, TX_BUFFER / 2U) << baud;
+
+    /* Attitude gets most of it, and everything still gets through */
+    for (int i = 0; i < NUM_STREAMS; i++) {
+      if (i != ATTITUDE) {
+        EXPECT_GE(r.rate_hz[ATTITUDE], r.rate_hz[i]) << baud;
+      }
+
+      /* 2400 baud only just carries everything at the slowest rates */
+      if (baud == 2400) {
+        EXPECT_GE(r.rate_hz[i], 800.0 / streams[i].max_interval_ms)
+          << baud << " " << stream_names[i];
+      } else {
+        EXPECT_LE(r.longest_gap_ms[i], (uint32_t) streams[i].max_interval_ms + 10 * TASK_PERIOD_MS)
+          << baud << " " << stream_names[i];
+      }
+    }
+
+    /* The rest of the budget goes to attitude and position */
+    EXPECT_GT(r.bytes_per_s, baud / 10 * 0.7) << baud;
+  }
+}
+
+TEST_F(MavlinkScheduler, FixedRatesOverflowSlowLinks) {
+  struct run_result fixed = run_fixed(2400, 60);
+  struct run_result sched = run_link(2400, 80, 60);
+
+  /* The old fixed rates need more than a 2400 baud link carries */
+  EXPECT_GT(fixed.bytes_per_s, 240);
+  EXPECT_GT(fixed.blocked, 0U);
+  EXPECT_EQ(0U, sched.blocked);
+}
+
+TEST_F(MavlinkScheduler, NothingChanged) {
+  struct mavlink_scheduler sched;
+  mavlink_sched_init(&sched, streams, NUM_STREAMS, 100000, 0);
+
+  /* Everything once at the start */
+  std::vector<int> order;
+  int s;
+  while ((s = mavlink_sched_next(&sched, 0)) >= 0)
+    order.push_back(s);
+
+  ASSERT_EQ((size_t) NUM_STREAMS, order.size());
+  EXPECT_EQ(ATTITUDE, order[0]);
+  EXPECT_EQ(SYS_STATUS, order[5]);
+
+  /* Then nothing until the slowest rates are due */
+  for (uint32_t t = 10; t < 1000; t += 10)
+    EXPECT_EQ(-1, mavlink_sched_next(&sched, t)) << t;
+
+  order.clear();
+  while ((s = mavlink_sched_next(&sched, 1000)) >= 0)
+    order.push_back(s);
+
+  ASSERT_EQ(5U, order.size());
+
+  /* A change is sent right away, but not faster than its fastest rate */
+  mavlink_sched_changed(&sched, HEARTBEAT);
+  EXPECT_EQ(-1, mavlink_sched_next(&sched, 1100));
+  EXPECT_EQ(HEARTBEAT, mavlink_sched_next(&sched, 1200));
+  EXPECT_EQ(-1, mavlink_sched_next(&sched, 1210));
+}
+
+TEST_F(MavlinkScheduler, OverdueGoesFirst) {
+  struct mavlink_scheduler sched;
+
+  /* Only just enough for attitude at its fastest rate */
+  mavlink_sched_init(&sched, streams, NUM_STREAMS, 36 * 50, 0);
+
+  uint32_t heartbeats = 0;
+
+  for (uint32_t t = 0; t < 10000; t += 10) {
+    mavlink_sched_changed(&sched, ATTITUDE);
+
+    int s;
+    while ((s = mavlink_sched_next(&sched, t)) >= 0)
+      heartbeats += s == HEARTBEAT;
+  }
+
+  EXPECT_GE(heartbeats, 9U);
+}
+
+TEST_F(MavlinkScheduler, ChangeBudget) {
+  struct mavlink_scheduler sched;
+  mavlink_sched_init(&sched, streams, NUM_STREAMS, 10000, 0);
+
+  while (mavlink_sched_next(&sched, 0) >= 0);
+
+  /* Credit left over from before is cut down to the new burst... */
+  mavlink_sched_set_budget(&sched, 1);
+  EXPECT_EQ(39 * 1000, sched.max_credit);
+
+  mavlink_sched_changed(&sched, ATTITUDE);
+  EXPECT_EQ(ATTITUDE, mavlink_sched_next(&sched, 20));
+
+  /* ...after which there is none for a long time */
+  mavlink_sched_changed(&sched, ATTITUDE);
+  EXPECT_EQ(-1, mavlink_sched_next(&sched, 40));
+
+  mavlink_sched_set_budget(&sched, 10000);
+  EXPECT_EQ(ATTITUDE, mavlink_sched_next(&sched, 60));
+}
+
+TEST_F(MavlinkScheduler, RatesByLinkSpeed) {
+  print_rates("fixed 2400", run_fixed(2400, 60));
+
+  for (uint32_t baud = 2400; baud <= 115200; baud *= 2) {
+    char name[32];
+    snprintf(name, sizeof(name), "%u baud", baud);
+    print_rates(name, run_link(baud, 80, 60));
+
+    if (baud == 38400)
+      baud = 57600 / 2;
+  }
+}
+
+/**
+ * @}
+ * @}
+ */
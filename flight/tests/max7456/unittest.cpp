@@ -0,0 +1,417 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for the MAX7456 driver against a simulated chip
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdint.h>		/* uint*_t */
+#include <stdlib.h>		/* rand */
+
+#include <map>
+
+extern "C" {
+
+#include "pios.h"
+#include "pios_max7456.h"
+#include "pios_max7456_priv.h"
+
+}
+
+/*
+ * The display memory side of a MAX7456: register writes and reads over
+ * SPI, 16 bit mode with and without autoincrement, and clearing.  Cells
+ * are kept as the driver keeps them, attributes from DMM[5:3] in the high
+ * byte.
+ */
+struct mock_max7456 {
+  bool selected;
+  bool data_phase;		/* The next byte is the value of reg */
+  uint8_t reg;
+  uint8_t regs[0x80];
+  uint16_t addr;
+  uint16_t mem[512];
+  uint32_t bytes;		/* Transferred in total */
+
+  uint8_t transfer(uint8_t b) {
+    bytes++;
+
+    if (!selected) {
+      ADD_FAILURE() << "transfer without chip select";
+      return 0xff;
+    }
+
+    if (!data_phase) {
+      reg = b;
+      data_phase = true;
+      return 0;
+    }
+
+    data_phase = false;
+
+    if (reg & 0x80)
+      return read(reg & 0x7f);
+
+    write(reg, b);
+    return 0;
+  }
+
+  uint8_t read(uint8_t r) {
+    switch (r) {
+    case MAX7456_REG_STAT:
+      return 0x01;		/* PAL, in sync, memory ready */
+    default:
+      return regs[r];
+    }
+  }
+
+  void write(uint8_t r, uint8_t val) {
+    switch (r) {
+    case MAX7456_REG_VM0:
+      regs[r] = val & ~MAX7456_VM0_SRB_MASK;	/* Resets right away */
+      break;
+    case MAX7456_REG_DMAH:
+      addr = (addr & 0xff) | (val & 1) << 8;
+      break;
+    case MAX7456_REG_DMAL:
+      addr = (addr & 0x100) | val;
+      break;
+    case MAX7456_REG_DMM:
+      regs[r] = val;
+      if (val & MAX7456_DMM_CLR_MASK) {
+        memset(mem, 0, sizeof(mem));
+        regs[r] &= ~MAX7456_DMM_CLR_MASK;
+      }
+      break;
+    case MAX7456_REG_DMDI:
+      if (regs[MAX7456_REG_DMM] & 0x01) {
+        if (val == MAX7456_DMDI_AUTOINCREMENT_STOP) {
+          regs[MAX7456_REG_DMM] &= ~0x01;
+          break;
+        }
+        mem[addr] = (regs[MAX7456_REG_DMM] & 0x38) << 8 | val;
+        addr = (addr + 1) & 0x1ff;
+      } else {
+        mem[addr] = (regs[MAX7456_REG_DMM] & 0x38) << 8 | val;
+      }
+      break;
+    default:
+      regs[r] = val;
+      break;
+    }
+  }
+};
+
+static std::map<uint32_t, mock_max7456> chips;
+
+extern "C" {
+
+int32_t PIOS_SPI_ClaimBus(uint32_t spi_id) { (void) spi_id; return 0; }
+int32_t PIOS_SPI_ReleaseBus(uint32_t spi_id) { (void) spi_id; return 0; }
+int32_t PIOS_SPI_SetClockSpeed(uint32_t spi_id, uint32_t speed) { (void) spi_id; (void) speed; return 0; }
+
+int32_t PIOS_SPI_RC_PinSet(uint32_t spi_id, uint32_t slave_id, bool pin_value)
+{
+  (void) slave_id;
+
+  mock_max7456 &chip = chips[spi_id];
+
+  if (!pin_value) {
+    chip.data_phase = false;
+  } else if (chip.data_phase) {
+    ADD_FAILURE() << "chip deselected within a register access";
+  }
+
+  chip.selected = !pin_value;
+
+  return 0;
+}
+
+uint8_t PIOS_SPI_TransferByte(uint32_t spi_id, uint8_t b)
+{
+  return chips[spi_id].transfer(b);
+}
+
+int32_t PIOS_DELAY_WaituS(uint32_t us) { (void) us; return 0; }
+uint32_t PIOS_DELAY_GetuS() { return 0; }
+void PIOS_Thread_Sleep(uint32_t ms) { (void) ms; }
+
+}
+
+/* A screen laid out like a typical flight: status around the edges, an
+ * artificial horizon in the middle.  Only telemetry moves from frame to
+ * frame.
+ */
+static void draw_screen(max7456_dev_t dev, uint32_t frame, bool moving)
+{
+  uint32_t t = moving ? frame : 0;
+  char buf[32];
+
+  /* Compass ruler */
+  for (int i = 0; i < 13; i++)
+    buf[i] = (char) ((i + t / 4) % 4 ? 0xc0 : 0xc1);
+  buf[13] = 0;
+  PIOS_MAX7456_puts(dev, 8, 0, buf, 0);
+
+  snprintf(buf, sizeof(buf), "\x85%dm", 120 + (int) (t % 7));
+  PIOS_MAX7456_puts(dev, 1, 1, buf, 0);
+  snprintf(buf, sizeof(buf), "%c%d.%d\x8c", 0x06, (int) (t % 3), (int) (t % 10));
+  PIOS_MAX7456_puts(dev, 1, 2, buf, 0);
+
+  PIOS_MAX7456_puts(dev, 23, 1, "ACRO", 0);
+  PIOS_MAX7456_put(dev, 28, 1, 0xe0, 0);
+  snprintf(buf, sizeof(buf), "\xb4%d", 87 - (int) (t % 4));
+  PIOS_MAX7456_puts(dev, 24, 2, buf, 0);
+
+  /* Horizon, a line moving with the roll angle */
+  int roll = (int) (t % 9) - 4;
+  for (int row = 0; row < 5; row++) {
+    for (int col = 0; col < 12; col++)
+      buf[col] = (row - 2) * 3 == (col - 6) * roll / 4 ? (char) 0xb8 : ' ';
+    buf[12] = 0;
+    PIOS_MAX7456_puts(dev, 9, 5 + row, buf, 0);
+  }
+  PIOS_MAX7456_put(dev, 14, 7, 0xbd, 0);
+  PIOS_MAX7456_put(dev, 15, 7, 0xbf, 0);
+
+  snprintf(buf, sizeof(buf), "%c%d", 0x10, 9);
+  PIOS_MAX7456_puts(dev, 1, 10, buf, 0);
+  snprintf(buf, sizeof(buf), "\x83%d.%07d", 47, 1234567 + (int) t);
+  PIOS_MAX7456_puts(dev, 1, 11, buf, 0);
+  snprintf(buf, sizeof(buf), "\x84%d.%07d", 8, 7654321 - (int) t);
+  PIOS_MAX7456_puts(dev, 1, 12, buf, 0);
+
+  snprintf(buf, sizeof(buf), "%d.%dV", 15, 9 - (int) (t / 100 % 10));
+  PIOS_MAX7456_puts(dev, 1, 14, buf, 0);
+  snprintf(buf, sizeof(buf), "%d.%dA", 12 + (int) (t % 5), (int) (t % 10));
+  PIOS_MAX7456_puts(dev, 8, 14, buf, 0);
+  snprintf(buf, sizeof(buf), "%d\x82", 350 + (int) (t / 10));
+  PIOS_MAX7456_puts(dev, 15, 14, buf, 0);
+  snprintf(buf, sizeof(buf), "\xb3%02d:%02d", (int) (t / 25 / 60), (int) (t / 25 % 60));
+  PIOS_MAX7456_puts(dev, 22, 14, buf, 0);
+
+  PIOS_MAX7456_puts(dev, MAX7456_FMT_H_CENTER, 12, "LOW BATTERY", MAX7456_ATTR_BLINK);
+}
+
+class Max7456 : public testing::Test {
+protected:
+  virtual void SetUp() {
+    chips.clear();
+
+    ASSERT_EQ(0, PIOS_MAX7456_init(&dev, 1, 0));
+    ASSERT_EQ(0, PIOS_MAX7456_init(&legacy, 2, 0));
+  }
+
+  /* Each frame as the OSD module did: clear, then draw straight to the chip */
+  uint32_t draw_legacy(uint32_t frame, bool moving) {
+    uint32_t before = chips[2].bytes;
+
+    PIOS_MAX7456_clear(legacy);
+    draw_screen(legacy, frame, moving);
+
+    return chips[2].bytes - before;
+  }
+
+  uint32_t draw_frame(uint32_t frame, bool moving) {
+    uint32_t before = chips[1].bytes;
+
+    PIOS_MAX7456_begin_frame(dev);
+    draw_screen(dev, frame, moving);
+    PIOS_MAX7456_end_frame(dev);
+
+    return chips[1].bytes - before;
+  }
+
+  void expect_same_display() {
+    for (int i = 0; i < MAX7456_PAL_ROWS * MAX7456_COLUMNS; i++) {
+      ASSERT_EQ(chips[2].mem[i], chips[1].mem[i]) << "at cell " << i;
+    }
+  }
+
+  max7456_dev_t dev, legacy;
+};
+
+TEST_F(Max7456, StaticScreen) {
+  uint32_t first = draw_frame(0, false);
+  draw_legacy(0, false);
+  expect_same_display();
+
+  /* Nothing changed; at most a row being refreshed is sent, as one run */
+  for (uint32_t frame = 1; frame < 10; frame++) {
+    EXPECT_LE(draw_frame(frame, false), 2U * (4 + MAX7456_COLUMNS));
+    EXPECT_GT(draw_legacy(frame, false), first);
+  }
+
+  expect_same_display();
+}
+
+TEST_F(Max7456, MovingScreen) {
+  uint32_t bytes = 0, legacy_bytes = 0;
+  const uint32_t frames = 1000;
+
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    bytes += draw_frame(frame, true);
+    legacy_bytes += draw_legacy(frame, true);
+
+    expect_same_display();
+    if (HasFatalFailure())
+      return;
+  }
+
+  EXPECT_LT(bytes * 3, legacy_bytes);
+}
+
+TEST_F(Max7456, Attributes) {
+  PIOS_MAX7456_begin_frame(dev);
+  PIOS_MAX7456_puts(dev, 0, 0, "AAAA", 0);
+  PIOS_MAX7456_puts(dev, 4, 0, "BBBB", MAX7456_ATTR_INVERT);
+  PIOS_MAX7456_puts(dev, 8, 0, "CCCC", 0);
+  PIOS_MAX7456_end_frame(dev);
+
+  EXPECT_EQ('A', chips[1].mem[3]);
+  EXPECT_EQ((MAX7456_ATTR_INVERT << 11) | 'B', chips[1].mem[4]);
+  EXPECT_EQ('C', chips[1].mem[8]);
+
+  /* Only the attributes change */
+  PIOS_MAX7456_begin_frame(dev);
+  PIOS_MAX7456_puts(dev, 0, 0, "AAAA", 0);
+  PIOS_MAX7456_puts(dev, 4, 0, "BBBB", 0);
+  PIOS_MAX7456_puts(dev, 8, 0, "CCCC", MAX7456_ATTR_BLINK);
+  PIOS_MAX7456_end_frame(dev);
+
+  EXPECT_EQ('B', chips[1].mem[4]);
+  EXPECT_EQ((MAX7456_ATTR_BLINK << 11) | 'C', chips[1].mem[11]);
+
+  /* Gone when no longer drawn */
+  uint32_t before = chips[1].bytes;
+  PIOS_MAX7456_begin_frame(dev);
+  PIOS_MAX7456_puts(dev, 0, 0, "AAAA", 0);
+  PIOS_MAX7456_end_frame(dev);
+
+  EXPECT_EQ(0, chips[1].mem[4]);
+  EXPECT_EQ(0, chips[1].mem[11]);
+
+  /* One run over both, through the unchanged gap between them */
+  EXPECT_EQ(2U * (4 + 8), chips[1].bytes - before);
+}
+
+TEST_F(Max7456, RandomScreens) {
+  uint16_t expected[MAX7456_PAL_ROWS * MAX7456_COLUMNS];
+  srand(1);
+
+  for (int frame = 0; frame < 500; frame++) {
+    memset(expected, 0, sizeof(expected));
+    PIOS_MAX7456_begin_frame(dev);
+
+    /* A few strings in different places each frame */
+    int strings = rand() % 20;
+    for (int n = 0; n < strings; n++) {
+      char s[8];
+      int len = 1 + rand() % 7;
+      uint8_t col = rand() % MAX7456_COLUMNS, row = rand() % MAX7456_PAL_ROWS;
+      uint8_t attr = rand() % 3 == 0 ? rand() % 8 : 0;
+
+      for (int i = 0; i < len; i++)
+        s[i] = (char) (1 + rand() % 254);
+      s[len] = 0;
+
+      PIOS_MAX7456_puts(dev, col, row, s, attr);
+
+      for (int i = 0; i < len && row * 30 + col + i < MAX7456_PAL_ROWS * MAX7456_COLUMNS; i++)
+        expected[row * 30 + col + i] = (attr << 11) | (uint8_t) s[i];
+    }
+
+    PIOS_MAX7456_end_frame(dev);
+
+    for (int i = 0; i < MAX7456_PAL_ROWS * MAX7456_COLUMNS; i++) {
+      ASSERT_EQ(expected[i], chips[1].mem[i]) << "frame " << frame << " cell " << i;
+    }
+  }
+}
+
+TEST_F(Max7456, DirectWritesAndClear) {
+  draw_frame(0, false);
+
+  /* Written outside of a frame, e.g. a message over the screen */
+  PIOS_MAX7456_puts(dev, MAX7456_FMT_H_CENTER, 6, "... STALLED ...", 0);
+  PIOS_MAX7456_put(dev, 0, 0, 'X', 0);
+
+  /* The next frame puts the screen back as it was */
+  draw_frame(1, false);
+  draw_legacy(1, false);
+  expect_same_display();
+
+  /* After a clear everything is drawn again */
+  PIOS_MAX7456_clear(dev);
+  EXPECT_GT(draw_frame(2, false), 100U);
+  expect_same_display();
+}
+
+TEST_F(Max7456, CorruptedCellHeals) {
+  draw_frame(0, false);
+  draw_legacy(0, false);
+
+  /* A glitch on the bus lands on a blank cell and on one that is drawn,
+   * where the screen does not change */
+  chips[1].mem[3 * MAX7456_COLUMNS + 20] = 0xb8;
+  chips[1].mem[14 * MAX7456_COLUMNS + 2] ^= 0x40;
+
+  /* Every row is rewritten within a few seconds */
+  for (uint32_t frame = 1; frame <= 4 * MAX7456_PAL_ROWS; frame++) {
+    draw_frame(frame, false);
+  }
+
+  expect_same_display();
+}
+
+TEST_F(Max7456, BytesPerFrame) {
+  const uint32_t frames = 1000;
+
+  for (int moving = 0; moving < 2; moving++) {
+    uint32_t bytes = 0, legacy_bytes = 0;
+
+    for (uint32_t frame = 0; frame < frames; frame++) {
+      bytes += draw_frame(frame, moving);
+      legacy_bytes += draw_legacy(frame, moving);
+    }
+
+    printf("%s screen: %5.1f SPI bytes per frame, %5.1f clearing and redrawing "
+        "(%.0f us at 9MHz)\n", moving ? "moving" : "static",
+        (double) bytes / frames, (double) legacy_bytes / frames,
+        legacy_bytes * 8.0 / 9e6 / frames * 1e6);
+  }
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,61 @@
+/**
+ ******************************************************************************
+ * @file       pios_video.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Stubs for the OSD rasterizer unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PIOS_VIDEO_H
+#define PIOS_VIDEO_H
+
+#include <stdint.h>
+
+/* The buffer geometry of flight/PiOS/STM32F4xx/inc/pios_video.h */
+
+struct pios_video_type_boundary {
+	uint16_t graphics_right;
+	uint16_t graphics_bottom;
+};
+
+extern const struct pios_video_type_boundary *pios_video_type_boundary_act;
+#define GRAPHICS_LEFT        0
+#define GRAPHICS_TOP         0
+#define GRAPHICS_RIGHT       pios_video_type_boundary_act->graphics_right
+#define GRAPHICS_BOTTOM      pios_video_type_boundary_act->graphics_bottom
+
+#define GRAPHICS_X_MIDDLE	((GRAPHICS_RIGHT + 1) / 2)
+#define GRAPHICS_Y_MIDDLE	((GRAPHICS_BOTTOM + 1) / 2)
+
+#define GRAPHICS_WIDTH_REAL  376
+#define GRAPHICS_HEIGHT_REAL 266
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+#define BUFFER_WIDTH         (GRAPHICS_WIDTH_REAL / 8  + 1)
+#define BUFFER_HEIGHT        (GRAPHICS_HEIGHT_REAL)
+#else
+#define BUFFER_WIDTH_TMP     (GRAPHICS_WIDTH_REAL / (8 / PIOS_VIDEO_BITS_PER_PIXEL))
+#define BUFFER_WIDTH (BUFFER_WIDTH_TMP + BUFFER_WIDTH_TMP % 4)
+#define BUFFER_HEIGHT        (GRAPHICS_HEIGHT_REAL)
+#endif
+
+#define SWAP_BUFFS(tmp, a, b) { tmp = a; a = b; b = tmp; }
+
+#endif /* PIOS_VIDEO_H */
@@ -0,0 +1,427 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test of the OSD rasterizer
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* rand_r */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+
+#include <chrono>
+#include <vector>
+
+extern "C" {
+
+#include "osd_utils.h"
+#include "video.h"
+
+}
+
+/*
+ * The framebuffers are compared by their CRC-32 against the output of the
+ * byte-at-a-time rasterizer the word-wide one replaced.  A scene that fails
+ * here renders differently on the OSD.
+ */
+static uint32_t crc32(const uint8_t *data, size_t length)
+{
+  uint32_t crc = 0xffffffff;
+
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+  }
+
+  return ~crc;
+}
+
+static uint32_t frame_crc()
+{
+  static uint8_t frame[VIDEO_FRAME_SIZE];
+
+  video_get_frame(frame);
+  return crc32(frame, sizeof(frame));
+}
+
+static void scene_hlines()
+{
+  int y = 0;
+
+  for (int mmode = 0; mmode < 3; mmode++) {
+    for (int lmode = 0; lmode < 3; lmode++) {
+      for (int x0 = -3; x0 < 20; x0 += 3) {
+        write_hline_lm(x0, x0 + 1 + 7 * (y % 40), y, lmode, mmode);
+        write_hline_lm(GRAPHICS_RIGHT - x0, GRAPHICS_RIGHT - x0 - 2 * y, y + 1, lmode, mmode);
+        y += 2;
+      }
+    }
+  }
+
+  // Off screen and degenerate
+  write_hline_lm(-50, 400, 200, 1, 1);
+  write_hline_lm(10, 30, -1, 1, 1);
+  write_hline_lm(10, 30, GRAPHICS_BOTTOM + 1, 1, 1);
+  write_hline_lm(17, 17, 210, 1, 1);
+  write_hline_lm(16, 23, 211, 2, 2);
+}
+
+static void scene_vlines()
+{
+  int x = 0;
+
+  for (int mmode = 0; mmode < 3; mmode++) {
+    for (int lmode = 0; lmode < 3; lmode++) {
+      for (int y0 = -3; y0 < 40; y0 += 7) {
+        write_vline_lm(x, y0, y0 + 5 + 3 * x, lmode, mmode);
+        x += 3;
+      }
+    }
+  }
+
+  write_vline_lm(200, -50, 400, 1, 1);
+  write_vline_lm(-1, 10, 30, 1, 1);
+  write_vline_lm(GRAPHICS_RIGHT + 1, 10, 30, 1, 1);
+}
+
+static void scene_rectangles()
+{
+  int y = 0;
+
+  for (int mmode = 0; mmode < 3; mmode++) {
+    for (int lmode = 0; lmode < 3; lmode++) {
+      for (int x = 0; x < 9; x++) {
+        write_filled_rectangle_lm(x + 37 * x, y, 1 + 5 * x, 1 + x % 3, lmode, mmode);
+        write_filled_rectangle_lm(x + 1 + 37 * x, y + 3, 17 + x, 2, lmode, mmode);
+        y++;
+      }
+      y += 3;
+    }
+  }
+
+  write_filled_rectangle_lm(0, 150, GRAPHICS_RIGHT, 20, 2, 1);
+  write_filled_rectangle_lm(-1, 180, 10, 10, 1, 1);
+  write_filled_rectangle_lm(GRAPHICS_RIGHT - 5, 180, 10, 10, 1, 1);
+  write_filled_rectangle_lm(100, 200, 0, 10, 1, 1);
+
+  for (int mode = 0; mode < 2; mode++) {
+    write_rectangle_outlined(20 + 100 * mode, 200, 31, 13, mode, 1);
+    write_hline_outlined(10 + 100 * mode, 80 + 100 * mode, 230, ENDCAP_ROUND, ENDCAP_FLAT, mode, 1);
+    write_vline_outlined(90 + 100 * mode, 200, 250, ENDCAP_FLAT, ENDCAP_ROUND, mode, 1);
+  }
+}
+
+static void scene_lines()
+{
+  const int cx = GRAPHICS_X_MIDDLE, cy = GRAPHICS_Y_MIDDLE;
+
+  for (int i = 0; i < 24; i++) {
+    float angle = i * (float) M_PI / 12;
+    int x = cx + (int) (200 * cosf(angle));
+    int y = cy + (int) (200 * sinf(angle));
+
+    switch (i % 3) {
+    case 0:
+      write_line_lm(cx, cy, x, y, 1, i % 2);
+      break;
+    case 1:
+      write_line_outlined(cx + 10, cy, x, y, 2, 2, i % 2, 1);
+      break;
+    case 2:
+      write_line_outlined_dashed(cx, cy + 10, x, y, 2, 2, i % 2, 1, 1 + i % 4);
+      break;
+    }
+  }
+
+  for (int x = 0; x < 40; x++)
+    write_pixel_lm(x * 9 - 4, x * 7 - 4, x % 3, (x / 3) % 3);
+}
+
+static void scene_text()
+{
+  char charset[96];
+
+  for (int i = 0; i < 95; i++)
+    charset[i] = ' ' + i;
+  charset[95] = 0;
+
+  int y = -4;
+  for (int font = 0; font < NUM_FONTS; font++) {
+    for (int x = -3; x < 12; x += 5) {
+      write_string(charset, x, y, 0, 0, TEXT_VA_TOP, TEXT_HA_LEFT, 0, font);
+      y += get_font_info(font)->height + 1;
+    }
+  }
+
+  char multiline[] = "Line one\nLine 2\r3";
+  write_string(multiline, GRAPHICS_X_MIDDLE, GRAPHICS_Y_MIDDLE, 1, 2, TEXT_VA_MIDDLE, TEXT_HA_CENTER, 0, FONT12X18);
+  write_string(multiline, GRAPHICS_RIGHT, GRAPHICS_BOTTOM, 0, 0, TEXT_VA_BOTTOM, TEXT_HA_RIGHT, 0, FONT8X10);
+  write_string(multiline, GRAPHICS_RIGHT - 20, GRAPHICS_BOTTOM - 10, 0, 0, TEXT_VA_TOP, TEXT_HA_LEFT, 0, FONT_OUTLINED8X14);
+}
+
+static void scene_images()
+{
+  draw_image(3, 2, &image_brainfpv);
+  draw_image(GRAPHICS_RIGHT - image_dronin.width - 1, 5, &image_dronin);
+
+  for (int x = 0; x < 8; x++) {
+    draw_image(10 + 21 * x + x, 200, &image_home);
+    draw_image(10 + 21 * x + x, 225, &image_rssi);
+    draw_image(200 + 17 * x + x, 180, &image_gps);
+    draw_image(200 + 17 * x + x, 240, &image_menu_icon);
+  }
+}
+
+static void scene_shapes()
+{
+  static const point_t plane[] = {
+    { .x = 0, .y = -20 }, { .x = 12, .y = 15 }, { .x = 0, .y = 8 }, { .x = -12, .y = 15 },
+  };
+
+  for (int i = 0; i < 6; i++) {
+    draw_polygon(40 + 55 * i, 40, 37.0f * i, plane, NELEMENTS(plane), i % 2, 1);
+    drawArrow(40 + 55 * i, 110, 61 * i, 4 + 2 * i);
+    drawBox(20 + 55 * i, 140, 50 + 55 * i + i, 170 + 3 * i);
+    ellipse(45 + 55 * i, 210, 3 + 4 * i, 20 - 3 * i);
+  }
+
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+  for (int i = 0; i < 4; i++)
+    write_circle_outlined(60 + 80 * i, 245, 5 + 4 * i, 2 * i, i % 2, i / 2, 1);
+#endif
+}
+
+static void scene_random()
+{
+  unsigned int seed = 1234;
+  char text[] = "0123456789 ALT SPD";
+
+  for (int i = 0; i < 400; i++) {
+    int x0 = rand_r(&seed) % 420 - 30;
+    int y0 = rand_r(&seed) % 320 - 30;
+    int x1 = rand_r(&seed) % 420 - 30;
+    int y1 = rand_r(&seed) % 320 - 30;
+    int lmode = rand_r(&seed) % 3;
+    int mmode = rand_r(&seed) % 3;
+
+    switch (rand_r(&seed) % 6) {
+    case 0:
+      write_hline_lm(x0, x1, y0, lmode, mmode);
+      break;
+    case 1:
+      write_vline_lm(x0, y0, y1, lmode, mmode);
+      break;
+    case 2:
+      write_filled_rectangle_lm(x0, y0, abs(x1 - x0) / 4, abs(y1 - y0) / 4, lmode, mmode);
+      break;
+    case 3:
+      write_line_lm(x0, y0, x1, y1, mmode, lmode);
+      break;
+    case 4:
+      write_string(text + rand_r(&seed) % 10, x0, y0, 0, 0, TEXT_VA_TOP, TEXT_HA_LEFT, 0, rand_r(&seed) % NUM_FONTS);
+      break;
+    case 5:
+      write_rectangle_outlined(x0, y0, abs(x1 - x0) / 4, abs(y1 - y0) / 4, lmode % 2, 1);
+      break;
+    }
+  }
+}
+
+/*
+ * Roughly what a flight page draws: scales, a compass, a horizon, and a few
+ * dozen readouts
+ */
+static void render_hud(int frame)
+{
+  char buf[32];
+
+  // Vertical scales
+  for (int side = 0; side < 2; side++) {
+    int x = side ? GRAPHICS_RIGHT - 40 : 40;
+
+    write_vline_outlined(x, 40, 200, ENDCAP_FLAT, ENDCAP_FLAT, 0, 1);
+    for (int i = 0; i < 9; i++) {
+      int y = 40 + (i * 20 + frame) % 160;
+      write_hline_outlined(x, x + (side ? 8 : -8), y, ENDCAP_NONE, ENDCAP_NONE, 0, 1);
+      snprintf(buf, sizeof(buf), "%d", (frame + i) * 10);
+      write_string(buf, x + (side ? 12 : -12), y, 0, 0, TEXT_VA_MIDDLE, side ? TEXT_HA_LEFT : TEXT_HA_RIGHT, 0, FONT_OUTLINED8X8);
+    }
+    write_filled_rectangle_lm(side ? x + 10 : x - 50, 112, 40, 16, 0, 1);
+    write_rectangle_outlined(side ? x + 10 : x - 50, 112, 40, 16, 0, 1);
+    snprintf(buf, sizeof(buf), "%d", 100 + frame);
+    write_string(buf, side ? x + 30 : x - 30, 120, 0, 0, TEXT_VA_MIDDLE, TEXT_HA_CENTER, 0, FONT_OUTLINED8X14);
+  }
+
+  // Linear compass
+  write_hline_lm(80, GRAPHICS_RIGHT - 80, 20, 1, 1);
+  for (int i = 0; i < 16; i++)
+    write_vline_lm(80 + (i * 12 + frame) % (GRAPHICS_RIGHT - 160), 14, 20, 1, 1);
+
+  // Horizon
+  float roll = 0.1f * (frame % 10);
+  write_line_outlined(GRAPHICS_X_MIDDLE - 60 * cosf(roll), GRAPHICS_Y_MIDDLE - 60 * sinf(roll),
+      GRAPHICS_X_MIDDLE + 60 * cosf(roll), GRAPHICS_Y_MIDDLE + 60 * sinf(roll), 2, 2, 0, 1);
+
+  // Readouts
+  for (int i = 0; i < 6; i++) {
+    snprintf(buf, sizeof(buf), "%02d:%02d %4.1fV", frame / 60, frame % 60, 11.1f + i);
+    write_string(buf, 10 + (i % 2) * 250, 210 + (i / 2) * 16, 0, 0, TEXT_VA_TOP, TEXT_HA_LEFT, 0, FONT8X10);
+  }
+  draw_image(GRAPHICS_X_MIDDLE, 230, &image_home);
+  snprintf(buf, sizeof(buf), "%d", 250 + frame);
+  write_string(buf, GRAPHICS_X_MIDDLE, 50, 0, 0, TEXT_VA_TOP, TEXT_HA_CENTER, 0, FONT12X18);
+}
+
+static void scene_hud()
+{
+  render_hud(7);
+}
+
+struct Scene {
+  const char *name;
+  void (*render)();
+  uint8_t background;
+  uint32_t crc;
+};
+
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+static const Scene scenes[] = {
+  { "hlines", scene_hlines, 0x00, 0xde454118 },
+  { "hlines", scene_hlines, 0xa5, 0xc4e6fd7c },
+  { "vlines", scene_vlines, 0x00, 0x05c5f966 },
+  { "vlines", scene_vlines, 0xa5, 0x32448660 },
+  { "rectangles", scene_rectangles, 0x00, 0x4eb63cf0 },
+  { "rectangles", scene_rectangles, 0xa5, 0xab4ce717 },
+  { "lines", scene_lines, 0x00, 0x4d33060d },
+  { "text", scene_text, 0x00, 0x3dbc2601 },
+  { "text", scene_text, 0xa5, 0xaa84d87f },
+  { "images", scene_images, 0x00, 0x315634ed },
+  { "shapes", scene_shapes, 0x00, 0x0a57a0f1 },
+  { "random", scene_random, 0x00, 0xc6987d3b },
+  { "random", scene_random, 0x5a, 0xf9306e0b },
+  { "hud", scene_hud, 0x00, 0xdfcd62e4 },
+};
+#else
+static const Scene scenes[] = {
+  { "hlines", scene_hlines, 0x00, 0x6d8c540c },
+  { "hlines", scene_hlines, 0xa5, 0xcdd18ff9 },
+  { "vlines", scene_vlines, 0x00, 0x8a751cb0 },
+  { "vlines", scene_vlines, 0xa5, 0x697bd077 },
+  { "rectangles", scene_rectangles, 0x00, 0xa18e9ed5 },
+  { "rectangles", scene_rectangles, 0xa5, 0x1c03f79c },
+  { "lines", scene_lines, 0x00, 0xc14e8bc6 },
+  { "text", scene_text, 0x00, 0x243bd587 },
+  { "text", scene_text, 0xa5, 0x70d6cc02 },
+  { "images", scene_images, 0x00, 0x8e1e4b15 },
+  { "shapes", scene_shapes, 0x00, 0x73140df8 },
+  { "random", scene_random, 0x00, 0x660b1661 },
+  { "random", scene_random, 0x5a, 0x15f9cb3e },
+  { "hud", scene_hud, 0x00, 0xad3b2e89 },
+};
+#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+
+class OsdRender : public testing::Test {
+};
+
+TEST_F(OsdRender, MatchesReference) {
+  for (size_t i = 0; i < NELEMENTS(scenes); i++) {
+    video_fill_frame(scenes[i].background);
+    scenes[i].render();
+
+    char actual[16];
+    snprintf(actual, sizeof(actual), "0x%08x", frame_crc());
+    char expected[16];
+    snprintf(expected, sizeof(expected), "0x%08x", scenes[i].crc);
+    EXPECT_STREQ(expected, actual) << scenes[i].name << " on 0x" << std::hex << (int) scenes[i].background;
+  }
+}
+
+static bool frame_is_clear()
+{
+  static uint8_t frame[VIDEO_FRAME_SIZE];
+
+  video_get_frame(frame);
+  for (size_t i = 0; i < sizeof(frame); i++)
+    if (frame[i])
+      return false;
+
+  return true;
+}
+
+/*
+ * clearGraphics() only clears what was drawn since the buffer was last
+ * cleared, so check that nothing drawn is ever left behind, including when
+ * the buffers are swapped part way through a frame, as the vsync interrupt
+ * does when drawing overruns.
+ */
+TEST_F(OsdRender, ClearRemovesEverythingDrawn) {
+  unsigned int seed = 99;
+
+  for (int frame = 0; frame < 200; frame++) {
+    clearGraphics();
+    ASSERT_TRUE(frame_is_clear()) << "frame " << frame;
+
+    if (rand_r(&seed) % 4 == 0) {
+      video_swap_buffers();
+      scene_random();
+    } else {
+      render_hud(frame);
+    }
+
+    if (rand_r(&seed) % 8 == 0) {
+      render_hud(frame + 1);
+      video_swap_buffers();
+      scene_shapes();
+    }
+
+    video_swap_buffers();
+  }
+}
+
+/*
+ * Time to clear and draw a flight page. This is reported rather than checked,
+ * as it depends on the machine and on the build flags.
+ */
+#define BENCH_FRAMES 2000
+
+TEST_F(OsdRender, FrameRenderTime) {
+  auto start = std::chrono::steady_clock::now();
+  for (int frame = 0; frame < BENCH_FRAMES; frame++) {
+    clearGraphics();
+    render_hud(frame % 50);
+    video_swap_buffers();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  printf("[   BENCH  ] HUD frame: %.1f us\n", elapsed.count() / BENCH_FRAMES * 1e6);
+}
@@ -0,0 +1,102 @@
+/**
+ ******************************************************************************
+ * @file       video.c
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Stubs for the OSD rasterizer unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <string.h>
+#include "pios_video.h"
+#include "gpsposition.h"
+#include "homelocation.h"
+#include "video.h"
+
+static const struct pios_video_type_boundary pal_boundary = {
+	.graphics_right  = 359,
+	.graphics_bottom = 265,
+};
+
+const struct pios_video_type_boundary *pios_video_type_boundary_act = &pal_boundary;
+
+/* Two sets of buffers, swapped between frames as PIOS_Video does */
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+static uint8_t buffers[2][2][BUFFER_HEIGHT * BUFFER_WIDTH] __attribute__((aligned(4)));
+
+uint8_t *draw_buffer_level = buffers[0][0];
+uint8_t *draw_buffer_mask = buffers[0][1];
+uint8_t *disp_buffer_level = buffers[1][0];
+uint8_t *disp_buffer_mask = buffers[1][1];
+
+void video_swap_buffers(void)
+{
+	uint8_t *tmp;
+
+	SWAP_BUFFS(tmp, disp_buffer_mask, draw_buffer_mask);
+	SWAP_BUFFS(tmp, disp_buffer_level, draw_buffer_level);
+}
+
+void video_get_frame(uint8_t frame[VIDEO_FRAME_SIZE])
+{
+	memcpy(frame, draw_buffer_level, BUFFER_HEIGHT * BUFFER_WIDTH);
+	memcpy(frame + BUFFER_HEIGHT * BUFFER_WIDTH, draw_buffer_mask, BUFFER_HEIGHT * BUFFER_WIDTH);
+}
+
+void video_fill_frame(uint8_t value)
+{
+	memset(draw_buffer_level, value, BUFFER_HEIGHT * BUFFER_WIDTH);
+	memset(draw_buffer_mask, value, BUFFER_HEIGHT * BUFFER_WIDTH);
+}
+#else
+static uint8_t buffers[2][BUFFER_HEIGHT * BUFFER_WIDTH] __attribute__((aligned(4)));
+
+uint8_t *draw_buffer = buffers[0];
+uint8_t *disp_buffer = buffers[1];
+
+void video_swap_buffers(void)
+{
+	uint8_t *tmp;
+
+	SWAP_BUFFS(tmp, disp_buffer, draw_buffer);
+}
+
+void video_get_frame(uint8_t frame[VIDEO_FRAME_SIZE])
+{
+	memcpy(frame, draw_buffer, BUFFER_HEIGHT * BUFFER_WIDTH);
+}
+
+void video_fill_frame(uint8_t value)
+{
+	memset(draw_buffer, value, BUFFER_HEIGHT * BUFFER_WIDTH);
+}
+#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+
+int32_t GPSPositionGet(GPSPositionData *dataOut)
+{
+	memset(dataOut, 0, sizeof(*dataOut));
+	return 0;
+}
+
+int32_t HomeLocationGet(HomeLocationData *dataOut)
+{
+	memset(dataOut, 0, sizeof(*dataOut));
+	return 0;
+}
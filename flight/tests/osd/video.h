@@ -0,0 +1,48 @@
+/**
+ ******************************************************************************
+ * @file       video.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Stubs for the OSD rasterizer unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef VIDEO_H
+#define VIDEO_H
+
+#include <stdint.h>
+#include "pios_video.h"
+
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+#define VIDEO_FRAME_SIZE (2 * BUFFER_HEIGHT * BUFFER_WIDTH)
+#else
+#define VIDEO_FRAME_SIZE (BUFFER_HEIGHT * BUFFER_WIDTH)
+#endif
+
+//! Swap the draw and display buffers, as the vsync interrupt does
+void video_swap_buffers(void);
+
+//! Copy the draw buffer(s) out
+void video_get_frame(uint8_t frame[VIDEO_FRAME_SIZE]);
+
+//! Fill the draw buffer(s), behind the rasterizer's back
+void video_fill_frame(uint8_t value);
+
+#endif /* VIDEO_H */
@@ -0,0 +1,55 @@
+/**
+ ******************************************************************************
+ * @file       pios.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Stubs for the PicoC interpreter unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PIOS_H
+#define PIOS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <setjmp.h>
+#include <math.h>
+
+#define PIOS_INCLUDE_PICOC
+
+/* Script output is collected by the test */
+extern uintptr_t picoc_test_com;
+#define PIOS_COM_PICOC picoc_test_com
+
+#define PIOS_Assert(x) do { if (!(x)) abort(); } while (0)
+
+void *PIOS_malloc(size_t size);
+void PIOS_Thread_Sleep(uint32_t time_ms);
+
+int32_t PIOS_COM_SendChar(uintptr_t com_id, char c);
+int32_t PIOS_COM_SendString(uintptr_t com_id, const char *str);
+int32_t PIOS_COM_SendFormattedString(uintptr_t com_id, const char *format, ...);
+uint16_t PIOS_COM_ReceiveBuffer(uintptr_t com_id, uint8_t *buf, uint16_t buf_len, uint32_t timeout_ms);
+
+#endif /* PIOS_H */
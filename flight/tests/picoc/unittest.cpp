@@ -0,0 +1,218 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test and benchmark for pre-tokenised PicoC scripts
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdint.h>		/* uint*_t */
+#include <string.h>		/* memset */
+#include <time.h>		/* clock_gettime */
+
+#include <string>
+
+extern "C" {
+
+int picoc(const char *source, size_t stack_size);
+int32_t picoc_compile(const char *source, size_t stack_size, void *image, size_t image_size);
+bool picoc_image_valid(const void *image, size_t image_size, const char *source);
+int picoc_run(const void *image, const char *source, size_t stack_size);
+
+extern char picoc_test_output[];
+extern size_t picoc_test_output_len;
+
+}
+
+/* The platform allocates the heap once, so all runs use the same size */
+#define STACK_SIZE (64 * 1024)
+
+/* Representative scripts: short control snippets, as run on every arming */
+static const char *script_mixer =
+  "/* scale and limit some stick inputs */\n"
+  "float in[4];\n"
+  "float out[4];\n"
+  "float limit(float v, float lo, float hi) {\n"
+  "  if (v < lo) return lo;\n"
+  "  if (v > hi) return hi;\n"
+  "  return v;\n"
+  "}\n"
+  "in[0] = 0.25; in[1] = -0.75; in[2] = 1.5; in[3] = 0.5;\n"
+  "for (int i = 0; i < 4; i++)\n"
+  "  out[i] = limit(in[i] * 1.2 - 0.1, -1.0, 1.0);\n"
+  "for (int i = 0; i < 4; i++)\n"
+  "  printf(\"out%d=%d\\n\", i, (int) (out[i] * 1000));\n";
+
+static const char *script_filter =
+  "/* a first order filter over a synthetic signal */\n"
+  "float state = 0;\n"
+  "float alpha = 0.1;\n"
+  "int crossings = 0;\n"
+  "int last = 0;\n"
+  "for (int n = 0; n < 200; n++) {\n"
+  "  float x = (n % 40 < 20) ? 1.0 : -1.0;\n"
+  "  state = state + alpha * (x - state);\n"
+  "  int sign = state > 0;\n"
+  "  if (sign != last) crossings++;\n"
+  "  last = sign;\n"
+  "}\n"
+  "printf(\"state=%d crossings=%d\\n\", (int) (state * 1000), crossings);\n";
+
+static const char *script_strings =
+  "/* formatting and recursion */\n"
+  "char buf[64];\n"
+  "int fib(int n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }\n"
+  "sprintf(buf, \"%s-%d\", \"waypoint\", fib(12));\n"
+  "printf(\"%s\\n\", buf);\n"
+  "printf(\"%s\\n\", \"waypoint\");\n"
+  "exit(fib(5));\n";
+
+static const char *scripts[] = { script_mixer, script_filter, script_strings };
+
+static double now_s()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+class PicocImage : public testing::Test {
+protected:
+  virtual void SetUp() {
+    memset(image, 0xa5, sizeof(image));
+    picoc_test_output_len = 0;
+    picoc_test_output[0] = 0;
+  }
+
+  std::string take_output() {
+    std::string s(picoc_test_output, picoc_test_output_len);
+    picoc_test_output_len = 0;
+    picoc_test_output[0] = 0;
+    return s;
+  }
+
+  uint8_t image[16384];
+};
+
+TEST_F(PicocImage, SameResultsAsSource) {
+  for (unsigned int i = 0; i < sizeof(scripts) / sizeof(*scripts); i++) {
+    int from_source = picoc(scripts[i], STACK_SIZE);
+    std::string source_output = take_output();
+
+    int32_t len = picoc_compile(scripts[i], STACK_SIZE, image, sizeof(image));
+    ASSERT_GT(len, 0) << "script " << i;
+    ASSERT_TRUE(picoc_image_valid(image, len, scripts[i]));
+
+    /* The image does not depend on the instance that made it */
+    for (int run = 0; run < 3; run++) {
+      EXPECT_EQ(from_source, picoc_run(image, scripts[i], STACK_SIZE));
+      EXPECT_EQ(source_output, take_output()) << "script " << i;
+    }
+  }
+
+  EXPECT_EQ(5, picoc_run(image, NULL, STACK_SIZE));
+  EXPECT_EQ("waypoint-144\nwaypoint\n", take_output());
+}
+
+TEST_F(PicocImage, Validity) {
+  int32_t len = picoc_compile(script_mixer, STACK_SIZE, image, sizeof(image));
+  ASSERT_GT(len, 0);
+
+  /* Smaller than the tokens the lexer reserves while running from source */
+  EXPECT_LT((size_t) len, strlen(script_mixer) * 4);
+
+  EXPECT_FALSE(picoc_image_valid(image, len - 1, script_mixer));
+  EXPECT_FALSE(picoc_image_valid(image, len, script_filter));
+  EXPECT_FALSE(picoc_image_valid(NULL, len, script_mixer));
+
+  image[0] ^= 1;
+  EXPECT_FALSE(picoc_image_valid(image, len, script_mixer));
+}
+
+TEST_F(PicocImage, DoesNotFit) {
+  EXPECT_EQ(-2, picoc_compile(script_mixer, STACK_SIZE, image, 4));
+  EXPECT_EQ(-2, picoc_compile(script_mixer, STACK_SIZE, image, 64));
+
+  int32_t len = picoc_compile(script_mixer, STACK_SIZE, image, sizeof(image));
+  ASSERT_GT(len, 0);
+
+  /* The string pool has to fit too */
+  EXPECT_EQ(-2, picoc_compile(script_mixer, STACK_SIZE, image, len - 1));
+  EXPECT_EQ(len, picoc_compile(script_mixer, STACK_SIZE, image, len));
+}
+
+TEST_F(PicocImage, LexError) {
+  EXPECT_EQ(-1, picoc_compile("int a = 1;\nint b = a @ 2;\n", STACK_SIZE, image, sizeof(image)));
+  take_output();
+
+  /* Runtime errors are reported as from source */
+  const char *failing = "int a = 1;\nundefined_function(a);\n";
+  int from_source = picoc(failing, STACK_SIZE);
+  std::string source_output = take_output();
+
+  ASSERT_GT(picoc_compile(failing, STACK_SIZE, image, sizeof(image)), 0);
+  EXPECT_EQ(from_source, picoc_run(image, failing, STACK_SIZE));
+  EXPECT_EQ(source_output, take_output());
+}
+
+TEST_F(PicocImage, Benchmark) {
+  const int runs = 200;
+
+  for (unsigned int i = 0; i < sizeof(scripts) / sizeof(*scripts); i++) {
+    double start = now_s();
+    for (int run = 0; run < runs; run++)
+      picoc(scripts[i], STACK_SIZE);
+    double source_s = now_s() - start;
+
+    start = now_s();
+    int32_t len = picoc_compile(scripts[i], STACK_SIZE, image, sizeof(image));
+    double compile_s = now_s() - start;
+    ASSERT_GT(len, 0);
+
+    start = now_s();
+    for (int run = 0; run < runs; run++)
+      picoc_run(image, scripts[i], STACK_SIZE);
+    double image_s = now_s() - start;
+
+    take_output();
+
+    printf("script %u: %4u bytes source, %4d bytes image, "
+        "%7.1f us from source, %7.1f us from image, %7.1f us to compile\n",
+        i, (unsigned int) strlen(scripts[i]), len,
+        source_s / runs * 1e6, image_s / runs * 1e6, compile_s * 1e6);
+  }
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,98 @@
+/**
+ ******************************************************************************
+ * @file       unittest_init.c
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Platform for running PicoC on the host
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "pios.h"
+
+typedef struct Picoc_Struct Picoc;
+
+uintptr_t picoc_test_com = 1;
+
+char picoc_test_output[65536];
+size_t picoc_test_output_len;
+
+void *PIOS_malloc(size_t size)
+{
+	return malloc(size);
+}
+
+void PIOS_Thread_Sleep(uint32_t time_ms)
+{
+	(void) time_ms;
+}
+
+int32_t PIOS_COM_SendChar(uintptr_t com_id, char c)
+{
+	(void) com_id;
+
+	if (picoc_test_output_len < sizeof(picoc_test_output) - 1) {
+		picoc_test_output[picoc_test_output_len++] = c;
+		picoc_test_output[picoc_test_output_len] = 0;
+	}
+
+	return 0;
+}
+
+int32_t PIOS_COM_SendString(uintptr_t com_id, const char *str)
+{
+	while (*str) {
+		PIOS_COM_SendChar(com_id, *str++);
+	}
+
+	return 0;
+}
+
+int32_t PIOS_COM_SendFormattedString(uintptr_t com_id, const char *format, ...)
+{
+	char buffer[256];
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+	return PIOS_COM_SendString(com_id, buffer);
+}
+
+uint16_t PIOS_COM_ReceiveBuffer(uintptr_t com_id, uint8_t *buf, uint16_t buf_len, uint32_t timeout_ms)
+{
+	(void) com_id;
+	(void) buf;
+	(void) buf_len;
+	(void) timeout_ms;
+
+	return 0;
+}
+
+/* The flight library with its UAVObject access is not needed */
+void PlatformLibraryInit(Picoc *pc)
+{
+	(void) pc;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,647 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test of the RFM22B link timing and adaptive air rate, with a
+ *        model of the radio channel to measure throughput and latency
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdint.h>		/* uint*_t */
+#include <math.h>		/* erfc, log10 */
+
+#include <deque>
+#include <random>
+
+extern "C" {
+
+#include "rfm22b_link.h"
+
+}
+
+#define RS_ECC_NPARITY 4
+
+class LinkTiming : public testing::Test {
+};
+
+static const enum rfm22b_link_mode long_packet_modes[] = {
+  RFM22B_LINK_AGGREGATED, RFM22B_LINK_ADAPTIVE,
+};
+
+/* Each modem's packet, with its framing, fits in its half of the slot */
+TEST_F(LinkTiming, PacketsFitTheirSlot) {
+  for (enum rfm22b_link_mode mode : long_packet_modes) {
+    for (uint8_t rate = 0; rate < RFM22B_LINK_NUM_RATES; rate++) {
+      for (int ppm = 0; ppm < 2; ppm++) {
+        for (int one_way = 0; one_way < 2; one_way++) {
+          uint8_t period = rfm22b_link_packet_time(mode, rate, ppm, one_way);
+          uint8_t len = rfm22b_link_max_packet_len(mode, rate, period, one_way);
+          float tx_time = one_way ? period : period / 2;
+          float air_ms = (len + RFM22B_LINK_FRAMING_BYTES) * 8 * 1000.0f /
+            rfm22b_link_bps(rate);
+
+          EXPECT_LE(air_ms + 2, tx_time) << "mode " << mode << " rate " << (int) rate;
+        }
+      }
+    }
+  }
+}
+
+/* Data links carry more than the 64 bytes packets used to be limited to */
+TEST_F(LinkTiming, DataPacketsAggregate) {
+  for (enum rfm22b_link_mode mode : long_packet_modes) {
+    for (uint8_t rate = 0; rate < RFM22B_LINK_NUM_RATES; rate++) {
+      uint8_t period = rfm22b_link_packet_time(mode, rate, false, false);
+      EXPECT_GT(rfm22b_link_max_packet_len(mode, rate, period, false), 64);
+    }
+
+    // The faster rates carry close to the largest packet the radio sends
+    for (uint8_t rate = 5; rate < RFM22B_LINK_NUM_RATES; rate++) {
+      uint8_t period = rfm22b_link_packet_time(mode, rate, false, false);
+      EXPECT_GT(rfm22b_link_max_packet_len(mode, rate, period, false), 180);
+    }
+  }
+}
+
+/* The legacy link keeps the slots and packet lengths of older firmware */
+TEST_F(LinkTiming, LegacyMatchesOlderFirmware) {
+  static const uint8_t old_packet_time[] = { 80, 40, 25, 15, 13, 10, 8, 6, 5 };
+  static const uint8_t old_num_channels[] = { 4, 4, 4, 6, 8, 8, 10, 12, 16 };
+
+  for (uint8_t rate = 0; rate < RFM22B_LINK_NUM_RATES; rate++) {
+    uint8_t period = rfm22b_link_packet_time(RFM22B_LINK_LEGACY, rate, false, false);
+    EXPECT_EQ(2 * old_packet_time[rate], period);
+    EXPECT_EQ(old_num_channels[rate], rfm22b_link_num_channels(RFM22B_LINK_LEGACY, rate));
+
+    float old_len = (float) rfm22b_link_bps(rate) * (period - 2) / 9000 -
+      RFM22B_LINK_FRAMING_BYTES;
+    EXPECT_EQ(old_len > 64 ? 64 : (uint8_t) old_len,
+        rfm22b_link_max_packet_len(RFM22B_LINK_LEGACY, rate, period, false));
+  }
+}
+
+/* Every adaptive rate hops in the same cycle, so a change keeps the schedule */
+TEST_F(LinkTiming, AdaptiveRatesShareTheHopCycle) {
+  for (uint8_t rate = 0; rate < RFM22B_LINK_NUM_RATES; rate++) {
+    uint8_t period = rfm22b_link_packet_time(RFM22B_LINK_ADAPTIVE, rate, false, false);
+    EXPECT_EQ(RFM22B_LINK_HOP_CYCLE_MS,
+        period * rfm22b_link_num_channels(RFM22B_LINK_ADAPTIVE, rate));
+  }
+}
+
+TEST_F(LinkTiming, Quality) {
+  EXPECT_EQ(RFM22B_LINK_QUALITY_UNKNOWN, rfm22b_link_quality(10, 0, 0));
+  EXPECT_EQ(RFM22B_LINK_QUALITY_MAX, rfm22b_link_quality(256, 0, 0));
+  EXPECT_EQ(0, rfm22b_link_quality(0, 0, 256));
+  EXPECT_EQ(RFM22B_LINK_QUALITY_MAX / 2, rfm22b_link_quality(0, 256, 0));
+  EXPECT_EQ(RFM22B_LINK_QUALITY_MAX / 2, rfm22b_link_quality(128, 0, 128));
+}
+
+class LinkRate : public testing::Test {
+protected:
+  virtual void SetUp() {
+    rfm22b_link_rate_init(&coord, 2, 6, 0);
+    rfm22b_link_rate_init(&remote, 2, 6, 0);
+
+    // As after falling back
+    coord.rate = coord.next_rate = 2;
+    remote.rate = remote.next_rate = 2;
+  }
+
+  /* Let one evaluation period pass with the given quality at both ends */
+  bool evaluate(uint32_t *now, uint8_t quality) {
+    *now += RFM22B_LINK_EVAL_MS;
+    rfm22b_link_rate_rx_control(&coord, true,
+        rfm22b_link_rate_tx_control(&remote, false, quality, 20, *now), 20, *now);
+    return rfm22b_link_rate_update(&coord, true, true, quality, 20, *now);
+  }
+
+  struct rfm22b_link_rate coord;
+  struct rfm22b_link_rate remote;
+};
+
+TEST_F(LinkRate, StartsAtTheHighestRate) {
+  struct rfm22b_link_rate r;
+  rfm22b_link_rate_init(&r, 2, 6, 0);
+  EXPECT_EQ(6, r.rate);
+  EXPECT_EQ(6, r.next_rate);
+
+  rfm22b_link_rate_init(&r, 7, 3, 0);
+  EXPECT_EQ(3, r.rate);
+  EXPECT_EQ(3, r.min_rate);
+  EXPECT_EQ(3, r.max_rate);
+}
+
+TEST_F(LinkRate, StepsUpWhenClean) {
+  uint32_t now = 0;
+
+  EXPECT_FALSE(evaluate(&now, RFM22B_LINK_QUALITY_MAX));
+  EXPECT_FALSE(evaluate(&now, RFM22B_LINK_QUALITY_MAX));
+  EXPECT_FALSE(evaluate(&now, RFM22B_LINK_QUALITY_MAX));
+
+  // Announced, not yet taken
+  EXPECT_EQ(2, coord.rate);
+  EXPECT_EQ(3, coord.next_rate);
+
+  // The change waits for the start of a hop cycle, at least the announcement
+  // time away
+  uint32_t at = coord.switch_ms;
+  EXPECT_EQ(0u, at % RFM22B_LINK_HOP_CYCLE_MS);
+  EXPECT_GE(at, now + RFM22B_LINK_SWITCH_SLOTS * 20);
+  EXPECT_LT(at, now + RFM22B_LINK_SWITCH_SLOTS * 20 + RFM22B_LINK_HOP_CYCLE_MS);
+
+  uint8_t control = rfm22b_link_rate_tx_control(&coord, true, 0, 20, at - 141);
+  EXPECT_EQ(3, control & 0x0f);
+  EXPECT_EQ(8, control >> 4);
+
+  // The countdown shrinks as the change approaches, and says 15 while it is
+  // further away than that
+  control = rfm22b_link_rate_tx_control(&coord, true, 0, 20, at - 1);
+  EXPECT_EQ(1, control >> 4);
+  control = rfm22b_link_rate_tx_control(&coord, true, 0, 20, at - 400);
+  EXPECT_EQ(15, control >> 4);
+
+  EXPECT_FALSE(rfm22b_link_rate_update(&coord, true, true, 14, 20, at - 1));
+  EXPECT_TRUE(rfm22b_link_rate_update(&coord, true, true, 14, 20, at));
+  EXPECT_EQ(3, coord.rate);
+}
+
+TEST_F(LinkRate, StepsDownWhenEitherEndIsPoor) {
+  uint32_t now = 0;
+
+  coord.rate = coord.next_rate = 5;
+  remote.rate = remote.next_rate = 5;
+
+  // Only the remote is losing packets
+  now += RFM22B_LINK_EVAL_MS;
+  rfm22b_link_rate_rx_control(&coord, true,
+      rfm22b_link_rate_tx_control(&remote, false, 6, 20, now), 20, now);
+  rfm22b_link_rate_update(&coord, true, true, RFM22B_LINK_QUALITY_MAX, 20, now);
+  EXPECT_EQ(4, coord.next_rate);
+
+  rfm22b_link_rate_update(&coord, true, true, 14, 20, now + 1000);
+  EXPECT_EQ(4, coord.rate);
+
+  // It does not go below the lowest rate
+  coord.rate = coord.next_rate = 2;
+  now += 2000;
+  evaluate(&now, 3);
+  EXPECT_EQ(2, coord.next_rate);
+}
+
+TEST_F(LinkRate, NeedsBothQualities) {
+  uint32_t now = 0;
+
+  for (int i = 0; i < 5; i++) {
+    now += RFM22B_LINK_EVAL_MS;
+    EXPECT_FALSE(rfm22b_link_rate_update(&coord, true, true,
+          RFM22B_LINK_QUALITY_MAX, 20, now));
+  }
+  EXPECT_EQ(2, coord.next_rate);
+
+  // Quality reported from another rate is ignored
+  rfm22b_link_rate_rx_control(&coord, true, 3 | (RFM22B_LINK_QUALITY_MAX << 4), 20, now);
+  EXPECT_EQ(RFM22B_LINK_QUALITY_UNKNOWN, coord.peer_quality);
+}
+
+TEST_F(LinkRate, RemoteFollowsTheAnnouncement) {
+  uint32_t now = 0;
+
+  evaluate(&now, RFM22B_LINK_QUALITY_MAX);
+  evaluate(&now, RFM22B_LINK_QUALITY_MAX);
+  evaluate(&now, RFM22B_LINK_QUALITY_MAX);
+  ASSERT_EQ(3, coord.next_rate);
+
+  // Too far ahead to count in the control byte, so it is not taken yet
+  uint32_t sent = coord.switch_ms - 20 * 15 - 19;
+  rfm22b_link_rate_rx_control(&remote, false,
+      rfm22b_link_rate_tx_control(&coord, true, 0, 20, sent), 20, sent + 4);
+  EXPECT_EQ(2, remote.next_rate);
+
+  // The remote hears a later announcement a few ms after it was sent, in the
+  // same slot
+  sent = coord.switch_ms - 20 * 6 - 19;
+  rfm22b_link_rate_rx_control(&remote, false,
+      rfm22b_link_rate_tx_control(&coord, true, 0, 20, sent), 20, sent + 7);
+  EXPECT_EQ(3, remote.next_rate);
+
+  uint32_t t;
+  for (t = sent; !rfm22b_link_rate_update(&remote, false, true, 14, 20, t); t++)
+    ASSERT_LT(t, sent + 1000u);
+
+  EXPECT_EQ(3, remote.rate);
+  EXPECT_EQ(coord.switch_ms, t);
+
+  // The remote ignores rates outside its range
+  rfm22b_link_rate_rx_control(&remote, false, 8, 20, t);
+  EXPECT_EQ(3, remote.next_rate);
+}
+
+TEST_F(LinkRate, FallsBackWhenDisconnected) {
+  coord.rate = coord.next_rate = 5;
+
+  EXPECT_FALSE(rfm22b_link_rate_update(&coord, true, false, 14, 20, 100));
+  EXPECT_FALSE(rfm22b_link_rate_update(&coord, true, false, 14, 20,
+        100 + RFM22B_LINK_FALLBACK_MS - 1));
+  EXPECT_TRUE(rfm22b_link_rate_update(&coord, true, false, 14, 20,
+        100 + RFM22B_LINK_FALLBACK_MS));
+  EXPECT_EQ(2, coord.rate);
+
+  // Reconnecting in time keeps the rate
+  coord.rate = coord.next_rate = 5;
+  rfm22b_link_rate_update(&coord, true, false, 14, 20, 5000);
+  rfm22b_link_rate_update(&coord, true, true, 14, 20, 6000);
+  EXPECT_FALSE(rfm22b_link_rate_update(&coord, true, false, 14, 20, 7500));
+  EXPECT_EQ(5, coord.rate);
+}
+
+/*
+ * A model of the link: two modems taking turns in the slots, a channel whose
+ * bit error rate follows the margin over each rate's sensitivity, COM queues
+ * fed at a steady rate, and the rate control and synchronization rules of the
+ * driver.  Data in a packet that cannot be corrected is lost, as on the real
+ * link.
+ */
+#define COM_BUFFER_LEN 640
+#define STRONG_DBM -95
+#define SYNC_PULSES_DISCONNECT 3
+
+struct Chunk {
+  uint32_t time;
+  int len;
+};
+
+struct Modem {
+  bool coordinator;
+  struct rfm22b_link_rate r;
+  uint8_t rate;
+  uint8_t packet_time;
+  uint8_t max_len;
+
+  struct rfm22b_link_quality q;
+  int sync_missed;
+  bool heard_sync;
+
+  std::deque<Chunk> queue;
+  int queued;
+  double offered;
+};
+
+struct LinkResult {
+  double throughput;	/* Bytes per second delivered, both ways */
+  double latency;	/* Mean time from queueing to delivery (ms) */
+  double strong_latency;	/* The same, while the signal is above STRONG_DBM */
+  double dropped;	/* Fraction of the offered bytes never delivered */
+  double mean_rate;	/* Mean air rate (bps) */
+  double up;		/* Fraction of the time both modems were connected */
+  int disconnects;	/* Times a modem lost the link */
+  int rate_changes;	/* Times a modem changed rate */
+};
+
+class LinkModel {
+public:
+  LinkModel(enum rfm22b_link_mode mode, uint8_t max_rate, double load) :
+    mode(mode), load(load), rng(1234) {
+    setup(&coord, true, max_rate);
+    setup(&remote, false, max_rate);
+  }
+
+  /* Put both modems at a rate, as after falling back to the lowest */
+  void startAt(uint8_t rate) {
+    coord.r.rate = coord.r.next_rate = rate;
+    remote.r.rate = remote.r.next_rate = rate;
+    setRate(&coord, rate);
+    setRate(&remote, rate);
+  }
+
+  /* Run for duration ms with the received signal strength given over time */
+  template<typename F> LinkResult run(uint32_t duration, F rssi) {
+    delivered = 0;
+    latency_sum = 0;
+    strong_delivered = 0;
+    strong_latency_sum = 0;
+    offered = 0;
+    rate_sum = 0;
+    up = 0;
+    disconnects = 0;
+    rate_changes = 0;
+
+    for (uint32_t t = 0; t < duration; t++) {
+      double dbm = rssi(t);
+
+      feed(&coord, t);
+      feed(&remote, t);
+
+      update(&coord, t);
+      update(&remote, t);
+
+      if (t % coord.packet_time == 0)
+        slot(&coord, &remote, t, dbm);
+      if (t % coord.packet_time == coord.packet_time / 2u)
+        slot(&remote, &coord, t, dbm);
+
+      rate_sum += rfm22b_link_bps(coord.rate);
+      up += connected(&coord) && connected(&remote);
+    }
+
+    LinkResult res;
+    res.throughput = delivered * 1000.0 / duration;
+    res.latency = delivered > 0 ? latency_sum / delivered : 0;
+    res.strong_latency = strong_delivered > 0 ?
+      strong_latency_sum / strong_delivered : 0;
+    res.dropped = offered > 0 ? 1 - delivered / offered : 0;
+    res.mean_rate = rate_sum / duration;
+    res.up = up / duration;
+    res.disconnects = disconnects;
+    res.rate_changes = rate_changes;
+    return res;
+  }
+
+  Modem coord;
+  Modem remote;
+
+private:
+  void setup(Modem *m, bool coordinator, uint8_t max_rate) {
+    m->coordinator = coordinator;
+    rfm22b_link_rate_init(&m->r, mode == RFM22B_LINK_ADAPTIVE ? 0 : max_rate,
+        max_rate, 0);
+    m->sync_missed = coordinator ? 0 : SYNC_PULSES_DISCONNECT;
+    m->heard_sync = false;
+    m->queued = 0;
+    m->offered = 0;
+    setRate(m, m->r.rate);
+  }
+
+  void setRate(Modem *m, uint8_t rate) {
+    m->rate = rate;
+    rfm22b_link_quality_reset(&m->q);
+
+    m->packet_time = rfm22b_link_packet_time(mode, rate, false, false);
+    m->max_len = rfm22b_link_max_packet_len(mode, rate, m->packet_time, false);
+  }
+
+  bool connected(const Modem *m) {
+    return m->sync_missed < SYNC_PULSES_DISCONNECT;
+  }
+
+  void feed(Modem *m, uint32_t t) {
+    m->offered += load / 1000;
+    int len = (int) m->offered;
+    m->offered -= len;
+    offered += len;
+
+    if (m->queued + len > COM_BUFFER_LEN)
+      return;
+
+    m->queue.push_back({ t, len });
+    m->queued += len;
+  }
+
+  void update(Modem *m, uint32_t t) {
+    if (mode != RFM22B_LINK_ADAPTIVE)
+      return;
+
+    if (rfm22b_link_rate_update(&m->r, m->coordinator, connected(m),
+          m->q.quality, m->packet_time, t)) {
+      rate_changes++;
+      setRate(m, m->r.rate);
+    }
+  }
+
+  /* Chance of a bit error with the signal margin over the sensitivity */
+  double bitErrorRate(uint8_t rate, double dbm) {
+    // About -104dBm at 128kbps, 1e-3 BER, getting 3dB better per halving
+    double sensitivity = -104 + 10 * log10(rfm22b_link_bps(rate) / 128000.0);
+    double snr = 4.77 * pow(10, (dbm - sensitivity) / 10);
+
+    return 0.5 * erfc(sqrt(snr));
+  }
+
+  int byteErrors(int len, double ber) {
+    std::binomial_distribution<int> errors(len, 1 - pow(1 - ber, 8));
+    return errors(rng);
+  }
+
+  void slot(Modem *tx, Modem *rx, uint32_t t, double dbm) {
+    uint8_t channel = (t / tx->packet_time) %
+      rfm22b_link_num_channels(mode, tx->rate);
+    bool sync_channel = channel == 0;
+
+    // A disconnected remote waits on the sync channel, silent
+    if (!tx->coordinator && !connected(tx)) {
+      if (sync_channel)
+        sync_missed(rx);
+      return;
+    }
+    bool listening = rx->coordinator || connected(rx) || sync_channel;
+
+    int header = mode == RFM22B_LINK_ADAPTIVE ? 1 : 0;
+    int room = tx->max_len - RS_ECC_NPARITY - header;
+    int len = 0;
+    std::deque<Chunk> sent;
+
+    while (len < room && !tx->queue.empty()) {
+      Chunk &c = tx->queue.front();
+      int n = std::min(c.len, room - len);
+      sent.push_back({ c.time, n });
+      len += n;
+      c.len -= n;
+      tx->queued -= n;
+      if (c.len == 0)
+        tx->queue.pop_front();
+    }
+
+    if (len == 0 && !sync_channel)
+      return;
+
+    int packet_len = len + header + RS_ECC_NPARITY;
+    double ber = bitErrorRate(tx->rate, dbm);
+
+    bool received = listening && rx->rate == tx->rate &&
+      byteErrors(RFM22B_LINK_FRAMING_BYTES, ber) == 0;
+
+    if (!received) {
+      if (sync_channel)
+        sync_missed(rx);
+      return;
+    }
+
+    int errors = byteErrors(packet_len, ber);
+    if (errors > RS_ECC_NPARITY / 2) {
+      rfm22b_link_quality_add(&rx->q, RFM22B_LINK_RX_LOST);
+      if (sync_channel)
+        sync_missed(rx);
+      return;
+    }
+
+    rfm22b_link_quality_add(&rx->q, errors == 0 ?
+        RFM22B_LINK_RX_GOOD : RFM22B_LINK_RX_CORRECTED);
+
+    if (sync_channel)
+      rx->sync_missed = 0;
+
+    double air_ms = (packet_len + RFM22B_LINK_FRAMING_BYTES) * 8 * 1000.0 /
+      rfm22b_link_bps(tx->rate);
+
+    // The control byte is acted on once the whole packet is in
+    if (mode == RFM22B_LINK_ADAPTIVE) {
+      uint8_t control = rfm22b_link_rate_tx_control(&tx->r, tx->coordinator,
+          tx->q.quality, tx->packet_time, t);
+      rfm22b_link_rate_rx_control(&rx->r, rx->coordinator, control,
+          rx->packet_time, t + (uint32_t) ceil(air_ms));
+    }
+    for (const Chunk &c : sent) {
+      delivered += c.len;
+      latency_sum += c.len * (t + air_ms - c.time);
+      if (dbm > STRONG_DBM) {
+        strong_delivered += c.len;
+        strong_latency_sum += c.len * (t + air_ms - c.time);
+      }
+    }
+  }
+
+  void sync_missed(Modem *m) {
+    rfm22b_link_quality_add(&m->q, RFM22B_LINK_RX_LOST);
+    if (++m->sync_missed == SYNC_PULSES_DISCONNECT)
+      disconnects++;
+  }
+
+  enum rfm22b_link_mode mode;
+  double load;
+  std::mt19937 rng;
+
+  double delivered;
+  double latency_sum;
+  double strong_delivered;
+  double strong_latency_sum;
+  double offered;
+  double rate_sum;
+  double up;
+  int disconnects;
+  int rate_changes;
+};
+
+#define FASTEST_RATE (RFM22B_LINK_NUM_RATES - 1)
+#define MODEL_LOAD 8000
+
+/* Longer packets carry more of the same load on a clean link */
+TEST(LinkModelTest, AggregationRaisesThroughput) {
+  auto clean = [](uint32_t) { return -70.0; };
+
+  LinkResult fixed = LinkModel(RFM22B_LINK_LEGACY, FASTEST_RATE, MODEL_LOAD).run(20000, clean);
+  LinkResult aggregated = LinkModel(RFM22B_LINK_AGGREGATED, FASTEST_RATE, MODEL_LOAD).run(20000, clean);
+
+  EXPECT_GT(aggregated.throughput, 1.3 * fixed.throughput);
+  EXPECT_LT(aggregated.latency, fixed.latency);
+  EXPECT_LT(aggregated.dropped, fixed.dropped);
+}
+
+/* The adaptive link climbs back to the fastest rate when the signal is strong */
+TEST(LinkModelTest, AdaptiveClimbsOnCleanLink) {
+  LinkModel model(RFM22B_LINK_ADAPTIVE, FASTEST_RATE, MODEL_LOAD);
+  model.startAt(0);
+  LinkResult res = model.run(60000, [](uint32_t) { return -70.0; });
+
+  EXPECT_EQ(FASTEST_RATE, model.coord.rate);
+  EXPECT_EQ(FASTEST_RATE, model.remote.rate);
+
+  // Each step is taken by both ends without losing the link
+  EXPECT_EQ(2 * FASTEST_RATE, res.rate_changes);
+  EXPECT_EQ(0, res.disconnects);
+}
+
+/* Where the fastest rate cannot be decoded, the adaptive link still works */
+TEST(LinkModelTest, AdaptiveKeepsWeakLinkUp) {
+  auto weak = [](uint32_t) { return -103.0; };
+
+  LinkResult fixed = LinkModel(RFM22B_LINK_AGGREGATED, FASTEST_RATE, MODEL_LOAD).run(60000, weak);
+  LinkModel adaptive_model(RFM22B_LINK_ADAPTIVE, FASTEST_RATE, MODEL_LOAD);
+  LinkResult adaptive = adaptive_model.run(60000, weak);
+
+  EXPECT_LT(fixed.throughput, 100);
+  EXPECT_GT(adaptive.throughput, 1000);
+  EXPECT_LT(adaptive_model.coord.rate, FASTEST_RATE);
+  EXPECT_EQ(adaptive_model.coord.rate, adaptive_model.remote.rate);
+}
+
+/* The vehicle flies out until the signal is weak, and back, every 2 minutes */
+static double fade(uint32_t t)
+{
+  double x = (t % 120000) / 60000.0;
+  return -70.0 - 44.0 * (x < 1 ? x : 2 - x);
+}
+
+static const uint8_t bench_max_rates[] = { 4, FASTEST_RATE };
+static const double bench_loads[] = { 2000, MODEL_LOAD };
+
+/* Over the flight, the adaptive link carries more than the fixed rate */
+TEST(LinkModelTest, AdaptiveBeatsFixedRate) {
+  for (double load : bench_loads) {
+    for (uint8_t max_rate : bench_max_rates) {
+      LinkResult fixed = LinkModel(RFM22B_LINK_AGGREGATED, max_rate, load).run(240000, fade);
+      LinkResult adaptive = LinkModel(RFM22B_LINK_ADAPTIVE, max_rate, load).run(240000, fade);
+
+      EXPECT_GT(adaptive.throughput, fixed.throughput) << load << " " << (int) max_rate;
+      EXPECT_GT(adaptive.up, fixed.up);
+      EXPECT_LT(adaptive.disconnects, fixed.disconnects);
+    }
+  }
+}
+
+/*
+ * Throughput and latency of each link mode over the flight, with light and
+ * heavy telemetry.  These are reported rather than checked.
+ */
+TEST(LinkModelTest, Benchmark) {
+  static const struct {
+    enum rfm22b_link_mode mode;
+    const char *name;
+  } modes[] = {
+    { RFM22B_LINK_LEGACY, "legacy 64 byte packets" },
+    { RFM22B_LINK_AGGREGATED, "aggregated" },
+    { RFM22B_LINK_ADAPTIVE, "aggregated, adaptive rate" },
+  };
+
+  for (double load : bench_loads) {
+    for (uint8_t max_rate : bench_max_rates) {
+      for (const auto &m : modes) {
+        LinkResult res = LinkModel(m.mode, max_rate, load).run(240000, fade);
+
+        printf("[   BENCH  ] %.0f B/s each way, %u bps max, %s: %.0f B/s, "
+            "latency %.0f ms, %.0f ms while strong, %.0f%% lost, up %.0f%%, "
+            "mean rate %.0f bps, %d disconnects\n",
+            load, rfm22b_link_bps(max_rate), m.name, res.throughput,
+            res.latency, res.strong_latency, res.dropped * 100, res.up * 100,
+            res.mean_rate, res.disconnects);
+      }
+    }
+  }
+}
@@ -401,11 +401,14 @@ void PluginManager::startTests()
         const QMetaObject *mo = pluginSpec->plugin()->metaObject();
         QStringList methods;
         methods.append("arg0");
-        // We only want slots starting with "test"
+        // We only want slots starting with "test"; QTest runs the _data
+        // slots itself, and rejects them as test functions
         for (int i = mo->methodOffset(); i < mo->methodCount(); ++i) {
             if (QByteArray(mo->method(i).methodSignature()).startsWith("test")) {
                 QString method = QString::fromLatin1(mo->method(i).methodSignature());
-                methods.append(method.left(method.size()-2));
+                method.chop(2);
+                if (!method.endsWith(QLatin1String("_data")))
+                    methods.append(method);
             }
         }
         QTest::qExec(pluginSpec->plugin(), methods);
@@ -29,18 +29,109 @@
 #include <QDateTime>
 #include <QSettings>
 //#define DEBUG_PUREIMAGECACHE
+//! Memory given to recently used tiles, by default
+#define MEMORY_CACHE_MEGABYTES 32
 namespace core {
     qlonglong PureImageCache::ConnCounter=0;
 
+    /**
+     * A thread's connection to the tile database, with its statements
+     * prepared. Closed when the thread exits.
+     */
+    class PureImageCache::Connection
+    {
+    public:
+        Connection(const QString &name,const QString &file):name(name),file(file)
+        {
+            QSqlDatabase cn=QSqlDatabase::addDatabase("QSQLITE",name);
+            cn.setDatabaseName(file);
+            cn.setConnectOptions("QSQLITE_BUSY_TIMEOUT=1000");
+            if(!cn.open())
+                return;
+            // Databases created by older versions do not have this
+            QSqlQuery(cn).exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (X, Y, Zoom, Type)");
+            select=new QSqlQuery(cn);
+            select->prepare("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=? AND Y=? AND Zoom=? AND Type=?)");
+            insertTile=new QSqlQuery(cn);
+            insertTile->prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
+            insertData=new QSqlQuery(cn);
+            insertData->prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
+        }
+        ~Connection()
+        {
+            delete select;
+            delete insertTile;
+            delete insertData;
+            {
+                QSqlDatabase cn=QSqlDatabase::database(name,false);
+                cn.close();
+            }
+            QSqlDatabase::removeDatabase(name);
+        }
+        bool isOpen(){return select!=0;}
+        QSqlDatabase database(){return QSqlDatabase::database(name,false);}
+
+        QString name;
+        QString file;
+        QSqlQuery *select=0;
+        QSqlQuery *insertTile=0;
+        QSqlQuery *insertData=0;
+    };
+
     PureImageCache::PureImageCache()
     {
+        memory.setMaxCost(MEMORY_CACHE_MEGABYTES*1024);
+    }
 
+    PureImageCache::~PureImageCache()
+    {
+        // Connections of other threads are closed as those threads exit
+        connections.setLocalData(0);
+    }
+
+    /**
+     * Returns the calling thread's connection to the database, opening it if
+     * needed. Must be called with lock held.
+     */
+    PureImageCache::Connection *PureImageCache::connection()
+    {
+        QString db=gtilecache+"Data.qmdb";
+        Connection *cn=connections.localData();
+        if(cn && cn->file==db)
+            return cn->isOpen()?cn:0;
+        Mcounter.lock();
+        qlonglong id=++ConnCounter;
+        Mcounter.unlock();
+        // Replaces (and closes) any connection to a previous cache location
+        cn=new Connection(QString("PureImageCache%1").arg(id),db);
+        connections.setLocalData(cn);
+        return cn->isOpen()?cn:0;
+    }
+
+    void PureImageCache::addToMemory(const RawTile &key, const QByteArray &tile)
+    {
+        QMutexLocker locker(&memoryLock);
+        // Cost is in kilobytes
+        memory.insert(key,new QByteArray(tile),qMax(1,tile.size()/1024));
+    }
+
+    void PureImageCache::setMemoryCapacity(int const& megabytes)
+    {
+        QMutexLocker locker(&memoryLock);
+        memory.setMaxCost(megabytes*1024);
+    }
+
+    void PureImageCache::clearMemory()
+    {
+        QMutexLocker locker(&memoryLock);
+        memory.clear();
     }
 
     void PureImageCache::setGtileCache(const QString &value)
     {
         lock.lockForWrite();
         gtilecache=value;
+        clearMemory();
         QDir d;
         if(!d.exists(gtilecache))
         {
@@ -172,89 +263,87 @@ namespace core {
         QSqlDatabase::removeDatabase(QLatin1String("CreateConn"));
         return true;
     }
+    bool PureImageCache::insertTile(Connection *cn, const QByteArray &tile, const MapType::Types &type, const Point &pos, const int &zoom, const QString &date)
+    {
+        cn->insertTile->bindValue(0,pos.X());
+        cn->insertTile->bindValue(1,pos.Y());
+        cn->insertTile->bindValue(2,zoom);
+        cn->insertTile->bindValue(3,(int)type);
+        cn->insertTile->bindValue(4,date);
+        if(!cn->insertTile->exec())
+            return false;
+        cn->insertData->bindValue(0,tile);
+        return cn->insertData->exec();
+    }
     bool PureImageCache::PutImageToCache(const QByteArray &tile, const MapType::Types &type,const Point &pos,const int &zoom)
+    {
+        CacheItemQueue item(type,pos,tile,zoom);
+        return PutImagesToCache(QList<CacheItemQueue*>()<<&item);
+    }
+    /**
+     * Stores several tiles in a single transaction
+     */
+    bool PureImageCache::PutImagesToCache(const QList<CacheItemQueue*> &tiles)
     {
         if(gtilecache.isEmpty()|gtilecache.isNull())
             return false;
-        lock.lockForRead();
+        QReadLocker locker(&lock);
 #ifdef DEBUG_PUREIMAGECACHE
-        qDebug()<<"PutImageToCache Start:";//<<pos;
+        qDebug()<<"PutImagesToCache Start:"<<tiles.count();
 #endif //DEBUG_PUREIMAGECACHE
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
+        Connection *cn=connection();
+        if(!cn)
+            return false;
+        QSqlDatabase db=cn->database();
+        QString date=QDateTime::currentDateTime().toString();
+        bool ok=db.transaction();
+        foreach(CacheItemQueue *item,tiles)
         {
-            QSqlDatabase cn;
-            cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-            QString db=gtilecache+"Data.qmdb";
-            cn.setDatabaseName(db);
-            cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-            if(cn.open())
-            {
-                {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
-                    query.addBindValue(pos.X());
-                    query.addBindValue(pos.Y());
-                    query.addBindValue(zoom);
-
-                    query.addBindValue((int)type);
-                    query.addBindValue(QDateTime::currentDateTime().toString());
-                    query.exec();
-                }
-                {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
-                    query.addBindValue(tile);
-                    query.exec();
-                }
-                cn.close();
-            }
+            if(!ok)
+                break;
+            ok=insertTile(cn,item->GetImg(),item->GetMapType(),item->GetPosition(),item->GetZoom(),date);
         }
-        QSqlDatabase::removeDatabase(QString::number(id));
-        lock.unlock();
+        if(!ok || !db.commit())
+        {
+#ifdef DEBUG_PUREIMAGECACHE
+            qDebug()<<"PutImagesToCache: "<<db.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+            db.rollback();
+            return false;
+        }
+        foreach(CacheItemQueue *item,tiles)
+            addToMemory(RawTile(item->GetMapType(),item->GetPosition(),item->GetZoom()),item->GetImg());
         return true;
     }
     QByteArray PureImageCache::GetImageFromCache(MapType::Types type, Point pos, int zoom)
     {
-        lock.lockForRead();
         QByteArray ar;
+        RawTile key(type,pos,zoom);
+        {
+            QMutexLocker locker(&memoryLock);
+            QByteArray *tile=memory.object(key);
+            if(tile)
+                return *tile;
+        }
+        QReadLocker locker(&lock);
         if(gtilecache.isEmpty()|gtilecache.isNull())
             return ar;
-        QString dir=gtilecache;
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
 #ifdef DEBUG_PUREIMAGECACHE
-        qDebug()<<"Cache dir="<<dir<<" Try to GET:"<<pos.X()+","+pos.Y();
+        qDebug()<<"Cache dir="<<gtilecache<<" Try to GET:"<<pos.X()+","+pos.Y();
 #endif //DEBUG_PUREIMAGECACHE
-
-        {
-            QString db=dir+"Data.qmdb";
-            {
-                QSqlDatabase cn;
-
-                cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-
-                cn.setDatabaseName(db);
-                cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-                if(cn.open())
-                {
-                    {
-                        QSqlQuery query(cn);
-                        query.exec(QString("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=%1 AND Y=%2 AND Zoom=%3 AND Type=%4)").arg(pos.X()).arg(pos.Y()).arg(zoom).arg((int) type));
-                        query.next();
-                        if(query.isValid())
-                        {
-                            ar=query.value(0).toByteArray();
-                        }
-                    }
-                    cn.close();
-                }
-            }
-        }
-        QSqlDatabase::removeDatabase(QString::number(id));
-        lock.unlock();
+        Connection *cn=connection();
+        if(!cn)
+            return ar;
+        cn->select->bindValue(0,pos.X());
+        cn->select->bindValue(1,pos.Y());
+        cn->select->bindValue(2,zoom);
+        cn->select->bindValue(3,(int)type);
+        if(cn->select->exec() && cn->select->next())
+            ar=cn->select->value(0).toByteArray();
+        // Release the read lock on the database
+        cn->select->finish();
+        if(!ar.isEmpty())
+            addToMemory(key,ar);
         return ar;
     }
     void PureImageCache::deleteOlderTiles(int const& days)
@@ -262,41 +351,28 @@ namespace core {
         if(gtilecache.isEmpty()|gtilecache.isNull())
             return;
         QList<long> add;
-        bool ret=true;
-        QString dir=gtilecache;
         {
-            QString db=dir+"Data.qmdb";
-            ret=QFileInfo(db).exists();
-            if(ret)
+            QReadLocker locker(&lock);
+            if(!QFileInfo(gtilecache+"Data.qmdb").exists())
+                return;
+            Connection *cn=connection();
+            if(!cn)
+                return;
+            QSqlQuery query(cn->database());
+            query.exec(QString("SELECT id, X, Y, Zoom, Type, Date FROM Tiles"));
+            while(query.next())
             {
-                QSqlDatabase cn;
-                Mcounter.lock();
-                qlonglong id=++ConnCounter;
-                Mcounter.unlock();
-                cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-                cn.setDatabaseName(db);
-                cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-                if(cn.open())
-                {
-                    {
-                        QSqlQuery query(cn);
-                        query.exec(QString("SELECT id, X, Y, Zoom, Type, Date FROM Tiles"));
-                        while(query.next())
-                        {
-                            if(QDateTime::fromString(query.value(5).toString()).daysTo(QDateTime::currentDateTime())>days)
-                                add.append(query.value(0).toLongLong());
-                        }
-                        foreach(long i,add)
-                        {
-                            query.exec(QString("DELETE FROM Tiles WHERE id = %1;").arg(i));
-                        }
-                    }
-
-                    cn.close();
-                }
-                QSqlDatabase::removeDatabase(QString::number(id));
+                if(QDateTime::fromString(query.value(5).toString()).daysTo(QDateTime::currentDateTime())>days)
+                    add.append(query.value(0).toLongLong());
+            }
+            cn->database().transaction();
+            foreach(long i,add)
+            {
+                query.exec(QString("DELETE FROM Tiles WHERE id = %1;").arg(i));
             }
+            cn->database().commit();
         }
+        clearMemory();
     }
     // PureImageCache::ExportMapDataToDB("C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data.qmdb","C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data2.qmdb");
     bool PureImageCache::ExportMapDataToDB(QString sourceFile, QString destFile)
@@ -43,24 +43,46 @@
 #include <QList>
 #include <QMutex>
 #include <QReadWriteLock>
+#include <QCache>
+#include <QThreadStorage>
+#include "rawtile.h"
+#include "cacheitemqueue.h"
 namespace core {
+    /**
+     * The tile database. Each thread using the cache keeps its own SQLite
+     * connection open, with prepared statements, for as long as it runs.
+     * Lookups are served from a bounded in-memory LRU of recently used tiles
+     * where possible, and tiles can be stored in batches, in one transaction.
+     */
     class PureImageCache
     {
 
     public:
         PureImageCache();
+        ~PureImageCache();
         static bool CreateEmptyDB(const QString &file);
         bool PutImageToCache(const QByteArray &tile,const MapType::Types &type,const core::Point &pos, const int &zoom);
+        bool PutImagesToCache(const QList<CacheItemQueue*> &tiles);
         QByteArray GetImageFromCache(MapType::Types type, core::Point pos, int zoom);
         QString GtileCache();
         void setGtileCache(const QString &value);
         static bool ExportMapDataToDB(QString sourceFile, QString destFile);
         void deleteOlderTiles(int const& days);
+        void setMemoryCapacity(int const& megabytes);
+        void clearMemory();
     private:
+        class Connection;
+        Connection *connection();
+        bool insertTile(Connection *cn, const QByteArray &tile, const MapType::Types &type, const core::Point &pos, const int &zoom, const QString &date);
+        void addToMemory(const RawTile &key, const QByteArray &tile);
+
         QString gtilecache;
         QMutex Mcounter;
         QReadWriteLock lock;
         static qlonglong ConnCounter;
+        QThreadStorage<Connection*> connections;
+        QMutex memoryLock;
+        QCache<RawTile,QByteArray> memory;
 
     };
 
@@ -29,6 +29,9 @@
 
 
 //#define DEBUG_TILECACHEQUEUE
+
+//! Most tiles stored per database transaction
+#define CACHE_BATCH_SIZE 64
  
 namespace core {
 TileCacheQueue::TileCacheQueue()
@@ -45,14 +48,17 @@ void TileCacheQueue::EnqueueCacheTask(CacheItemQueue *task)
 #ifdef DEBUG_TILECACHEQUEUE
     qDebug()<<"DB Do I EnqueueCacheTask"<<task->GetPosition().X()<<","<<task->GetPosition().Y();
 #endif //DEBUG_TILECACHEQUEUE
-    if(!tileCacheQueue.contains(task))
+    // Tiles are now enqueued from several loader threads at once
+    mutex.lock();
+    bool queued=tileCacheQueue.contains(task);
+    if(!queued)
+        tileCacheQueue.enqueue(task);
+    mutex.unlock();
+    if(!queued)
     {
 #ifdef DEBUG_TILECACHEQUEUE
         qDebug()<<"EnqueueCacheTask"<<task->GetPosition().X()<<","<<task->GetPosition().Y();
 #endif //DEBUG_TILECACHEQUEUE
-        mutex.lock();
-        tileCacheQueue.enqueue(task);
-        mutex.unlock();
         if(this->isRunning())
         {
 #ifdef DEBUG_TILECACHEQUEUE
@@ -80,21 +86,23 @@ void TileCacheQueue::run()
 #endif //DEBUG_TILECACHEQUEUE
     while(true)
     {
-        CacheItemQueue *task;
+        QList<CacheItemQueue*> tasks;
 #ifdef DEBUG_TILECACHEQUEUE
         qDebug()<<"Cache";
 #endif //DEBUG_TILECACHEQUEUE
         if(tileCacheQueue.count()>0)
         {
+            // Store whatever has queued up in one transaction
             mutex.lock();
-            task=tileCacheQueue.dequeue();
+            while(!tileCacheQueue.isEmpty() && tasks.count()<CACHE_BATCH_SIZE)
+                tasks.append(tileCacheQueue.dequeue());
             mutex.unlock();
 #ifdef DEBUG_TILECACHEQUEUE
-            qDebug()<<"Cache engine Put:"<<task->GetPosition().X()<<","<<task->GetPosition().Y();
+            qDebug()<<"Cache engine Put:"<<tasks.count()<<"tiles";
 #endif //DEBUG_TILECACHEQUEUE
-            Cache::Instance()->ImageCache.PutImageToCache(task->GetImg(),task->GetMapType(),task->GetPosition(),task->GetZoom());
+            Cache::Instance()->ImageCache.PutImagesToCache(tasks);
             usleep(44);
-            delete task;
+            qDeleteAll(tasks);
         }
 
         else
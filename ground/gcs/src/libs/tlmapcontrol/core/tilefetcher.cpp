@@ -0,0 +1,286 @@
+/**
+******************************************************************************
+*
+* @file       tilefetcher.cpp
+* @author     dRonin, http://dronin.org Copyright (C) 2016
+* @brief      Shared, asynchronous download of map tiles
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   TLMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#include "tilefetcher.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+//#define DEBUG_TILEFETCHER
+
+//! Downloads in progress at once, by default
+#define TILE_FETCH_PARALLEL 8
+
+namespace core {
+    TileFetcher::TileFetcher():
+        network(0),proxyChanged(false),maxParallel(TILE_FETCH_PARALLEL),fetching(0),shuttingDown(false)
+    {
+        moveToThread(&thread);
+        thread.start();
+    }
+
+    TileFetcher::~TileFetcher()
+    {
+        {
+            QMutexLocker locker(&mutex);
+            shuttingDown=true;
+        }
+        thread.quit();
+        thread.wait();
+
+        {
+            QMutexLocker locker(&mutex);
+            QSet<Request*> remaining=requests.values().toSet();
+            remaining+=queued.toSet();
+            remaining+=active.values().toSet();
+            requests.clear();
+            foreach(Request *r,remaining)
+            {
+                r->reply=0;
+                finish(r,Cancelled);
+            }
+            queued.clear();
+            active.clear();
+
+            // The woken threads still use the mutex and their requests
+            while(fetching>0)
+                requestDone.wait(&mutex);
+        }
+
+        // Also deletes any replies still in progress
+        delete network;
+    }
+
+    /**
+     * Gets a tile, waiting until it has been downloaded. Must not be called
+     * from the fetcher's own thread.
+     * @param tile identifies the tile; requests for the same tile are shared
+     * @param request the request for the tile
+     * @param timeout how long to wait for it, in ms
+     * @param result if not null, whether the download succeeded
+     * @param owner identifies the map the tile is for, for CancelAllExcept()
+     * @return the tile, or an empty array if it could not be downloaded
+     */
+    QByteArray TileFetcher::Fetch(const RawTile &tile, const QNetworkRequest &request, int timeout, Result *result, const void *owner)
+    {
+        QMutexLocker locker(&mutex);
+        if(shuttingDown)
+        {
+            if(result)
+                *result=Cancelled;
+            return QByteArray();
+        }
+        fetching++;
+
+        Request *r=requests.value(tile);
+        if(r==0)
+        {
+            r=new Request(tile,request);
+            requests.insert(tile,r);
+            queued.enqueue(r);
+            schedule();
+        }
+#ifdef DEBUG_TILEFETCHER
+        else
+            qDebug()<<"TileFetcher: already fetching"<<request.url();
+#endif //DEBUG_TILEFETCHER
+        r->waiters.append(owner);
+
+        QElapsedTimer elapsed;
+        elapsed.start();
+        while(!r->done && elapsed.elapsed()<timeout)
+            requestDone.wait(&mutex,timeout-elapsed.elapsed());
+
+        Result res=r->done?r->result:Timeout;
+        QByteArray data=r->data;
+
+        r->waiters.removeOne(owner);
+        if(r->waiters.isEmpty())
+        {
+            if(r->done)
+                delete r;
+            else
+                cancel(r); // Nobody wants it any more
+        }
+
+        fetching--;
+        if(shuttingDown && fetching==0)
+            requestDone.wakeAll(); // The destructor waits for us to leave
+
+        if(result)
+            *result=res;
+        return data;
+    }
+
+    /**
+     * Cancels the downloads for a map that are not in a set of wanted tiles,
+     * typically those in view. Tiles that another map is also waiting for
+     * are still downloaded.
+     */
+    void TileFetcher::CancelAllExcept(const void *owner, const QSet<RawTile> &wanted)
+    {
+        QMutexLocker locker(&mutex);
+        foreach(Request *r,requests.values())
+        {
+            if(wanted.contains(r->tile))
+                continue;
+            if(r->waiters.count(owner)==r->waiters.count())
+                cancel(r);
+        }
+    }
+
+    int TileFetcher::MaxParallel()
+    {
+        QMutexLocker locker(&mutex);
+        return maxParallel;
+    }
+
+    void TileFetcher::setMaxParallel(const int &value)
+    {
+        QMutexLocker locker(&mutex);
+        maxParallel=qMax(1,value);
+        schedule();
+    }
+
+    void TileFetcher::setProxy(const QNetworkProxy &value)
+    {
+        QMutexLocker locker(&mutex);
+        if(proxy==value)
+            return;
+        proxy=value;
+        proxyChanged=true;
+        schedule();
+    }
+
+    /**
+     * Detaches a request, so it is no longer shared, and has the fetcher
+     * thread stop it. Called with the mutex held.
+     */
+    void TileFetcher::cancel(Request *request)
+    {
+        if(requests.value(request->tile)==request)
+            requests.remove(request->tile);
+        request->cancelled=true;
+        schedule();
+    }
+
+    /**
+     * Completes a request and wakes anyone waiting for it. Called with the
+     * mutex held.
+     */
+    void TileFetcher::finish(Request *request, Result result)
+    {
+        if(requests.value(request->tile)==request)
+            requests.remove(request->tile);
+        request->result=result;
+        request->done=true;
+        if(request->waiters.isEmpty())
+            delete request;
+        else
+            requestDone.wakeAll();
+    }
+
+    void TileFetcher::schedule()
+    {
+        QMetaObject::invokeMethod(this,"startRequests",Qt::QueuedConnection);
+    }
+
+    /**
+     * Starts queued downloads up to the parallel limit, and stops cancelled
+     * ones. Runs on the fetcher thread.
+     */
+    void TileFetcher::startRequests()
+    {
+        QList<QNetworkReply*> toAbort;
+        {
+            QMutexLocker locker(&mutex);
+            if(network==0)
+                network=new QNetworkAccessManager();
+            if(proxyChanged)
+            {
+                network->setProxy(proxy);
+                proxyChanged=false;
+            }
+
+            QQueue<Request*> stillQueued;
+            foreach(Request *r,queued)
+            {
+                if(r->cancelled)
+                    finish(r,Cancelled);
+                else
+                    stillQueued.enqueue(r);
+            }
+            queued.swap(stillQueued);
+
+            foreach(Request *r,active)
+            {
+                if(r->cancelled)
+                    toAbort.append(r->reply);
+            }
+
+            while(!queued.isEmpty() && active.count()<maxParallel)
+            {
+                Request *r=queued.dequeue();
+#ifdef DEBUG_TILEFETCHER
+                qDebug()<<"TileFetcher: get"<<r->request.url();
+#endif //DEBUG_TILEFETCHER
+                r->reply=network->get(r->request);
+                connect(r->reply,SIGNAL(finished()),this,SLOT(requestFinished()));
+                active.insert(r->reply,r);
+            }
+        }
+
+        // Outside the lock, as this can finish the reply right away
+        foreach(QNetworkReply *reply,toAbort)
+            reply->abort();
+    }
+
+    void TileFetcher::requestFinished()
+    {
+        QNetworkReply *reply=qobject_cast<QNetworkReply*>(sender());
+        if(reply==0)
+            return;
+        reply->deleteLater();
+
+        {
+            QMutexLocker locker(&mutex);
+            Request *r=active.take(reply);
+            if(r==0)
+                return;
+            r->reply=0;
+            if(r->cancelled)
+                finish(r,Cancelled);
+            else if(reply->error()!=QNetworkReply::NoError)
+                finish(r,NetworkError);
+            else
+            {
+                r->data=reply->readAll();
+                finish(r,Ok);
+            }
+        }
+
+        startRequests();
+    }
+}
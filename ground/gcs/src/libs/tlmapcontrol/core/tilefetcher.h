@@ -0,0 +1,107 @@
+/**
+******************************************************************************
+*
+* @file       tilefetcher.h
+* @author     dRonin, http://dronin.org Copyright (C) 2016
+* @brief      Shared, asynchronous download of map tiles
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   TLMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#ifndef TILEFETCHER_H
+#define TILEFETCHER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QSet>
+#include <QQueue>
+#include <QtNetwork/QNetworkAccessManager>
+#include <QtNetwork/QNetworkProxy>
+#include <QtNetwork/QNetworkReply>
+#include <QtNetwork/QNetworkRequest>
+#include "rawtile.h"
+
+namespace core {
+    /**
+     * Downloads tiles for the loader threads. All downloads go through one
+     * QNetworkAccessManager, on the fetcher's own thread, so connections to
+     * the tile servers are kept alive and reused. At most MaxParallel()
+     * downloads run at once, the rest wait their turn; a tile requested again
+     * while it is being fetched is only downloaded once, and tiles that are
+     * no longer wanted can be cancelled.
+     */
+    class TileFetcher: public QObject
+    {
+        Q_OBJECT
+    public:
+        enum Result { Ok, NetworkError, Timeout, Cancelled };
+
+        TileFetcher();
+        ~TileFetcher();
+
+        QByteArray Fetch(const RawTile &tile, const QNetworkRequest &request, int timeout, Result *result = 0, const void *owner = 0);
+        void CancelAllExcept(const void *owner, const QSet<RawTile> &wanted);
+
+        int MaxParallel();
+        void setMaxParallel(const int &value);
+        void setProxy(const QNetworkProxy &value);
+
+    private slots:
+        void startRequests();
+        void requestFinished();
+
+    private:
+        struct Request
+        {
+            Request(const RawTile &tile, const QNetworkRequest &request):
+                tile(tile), request(request), reply(0), result(Ok), done(false), cancelled(false) {}
+            RawTile tile;
+            QNetworkRequest request;
+            QNetworkReply *reply;
+            QByteArray data;
+            Result result;
+            QList<const void*> waiters;     // Owner of each thread waiting for the tile
+            bool done;
+            bool cancelled;
+        };
+
+        void cancel(Request *request);
+        void finish(Request *request, Result result);
+        void schedule();
+
+        QThread thread;
+        QNetworkAccessManager *network;
+        QNetworkProxy proxy;
+        bool proxyChanged;
+        int maxParallel;
+
+        // Guards everything below, and the Request contents
+        QMutex mutex;
+        QWaitCondition requestDone;
+        QHash<RawTile, Request*> requests;
+        QQueue<Request*> queued;
+        QHash<QNetworkReply*, Request*> active;
+        int fetching;                       // Threads inside Fetch()
+        bool shuttingDown;
+    };
+}
+#endif // TILEFETCHER_H
@@ -301,9 +301,10 @@ namespace core {
      * @param type Type of map (Google Satellite, Bing, ARCGIS...)
      * @param pos Quadtile to be drawn
      * @param zoom Quadtile zoom level
+     * @param owner Map the tile is for, so its downloads can be cancelled together
      * @return
      */
-    QByteArray TLMaps::GetImageFromServer(const MapType::Types &type,const Point &pos,const int &zoom)
+    QByteArray TLMaps::GetImageFromServer(const MapType::Types &type,const Point &pos,const int &zoom,const void *owner)
     {
         QMutexLocker locker(&settingsProtect);
 #ifdef DEBUG_TIMINGS
@@ -365,16 +366,7 @@ namespace core {
             if(accessmode!=AccessMode::CacheOnly)
             {
                 { //Otherwise, we're getting the tiles from the internet
-                    QEventLoop q;
-                    QNetworkReply *reply;
                     QNetworkRequest qheader;
-                    QNetworkAccessManager network;
-                    QTimer tT;
-                    tT.setSingleShot(true);
-                    connect(&network, SIGNAL(finished(QNetworkReply*)),
-                            &q, SLOT(quit()));
-                    connect(&tT, SIGNAL(timeout()), &q, SLOT(quit()));
-                    network.setProxy(Proxy);
     #ifdef DEBUG_GMAPS
                     qDebug()<<"Try Tile from the Internet";
     #endif //DEBUG_GMAPS
@@ -462,27 +454,32 @@ namespace core {
 #ifdef DEBUG_GMAPS
                     qDebug() << "qheader: " << qheader.url();
 #endif //DEBUG_GMAPS
-                    reply=network.get(qheader);
-                    tT.start(Timeout);
-                    q.exec();
+                    Fetcher.setProxy(Proxy);
+                    int timeout=Timeout;
 
-                    if(!tT.isActive()){
+                    // Only the URL needs the settings; downloads run concurrently
+                    locker.unlock();
+
+                    TileFetcher::Result result;
+                    ret=Fetcher.Fetch(RawTile(type,pos,zoom),qheader,timeout,&result,owner);
+
+                    if(result==TileFetcher::Timeout){
                         errorvars.lock();
                         ++diag.timeouts;
                         errorvars.unlock();
-                        return ret;
+                        return QByteArray();
                     }
-                    tT.stop();
-                    if( (reply->error()!=QNetworkReply::NoError))
+                    if(result!=TileFetcher::Ok)
                     {
-                        errorvars.lock();
-                        ++diag.networkerrors;
-                        errorvars.unlock();
-                        reply->deleteLater();
-                        return ret;
+                        // Tiles cancelled because they went out of view are not errors
+                        if(result==TileFetcher::NetworkError)
+                        {
+                            errorvars.lock();
+                            ++diag.networkerrors;
+                            errorvars.unlock();
+                        }
+                        return QByteArray();
                     }
-                    ret=reply->readAll();
-                    reply->deleteLater();//TODO can't this be global??
                     if(ret.isEmpty())
                     {
     #ifdef DEBUG_GMAPS
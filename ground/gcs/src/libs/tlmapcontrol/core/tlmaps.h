@@ -37,6 +37,7 @@
 #include "languagetype.h"
 #include "cacheitemqueue.h"
 #include "tilecachequeue.h"
+#include "tilefetcher.h"
 #include "pureimagecache.h"
 #include "alllayersoftype.h"
 #include "urlfactory.h"
@@ -66,7 +67,7 @@ namespace core {
         /// </summary>
 
 
-        QByteArray GetImageFromServer(const MapType::Types &type,const core::Point &pos,const int &zoom);
+        QByteArray GetImageFromServer(const MapType::Types &type,const core::Point &pos,const int &zoom,const void *owner = 0);
         QByteArray GetImageFromFile(const MapType::Types &type,const core::Point &pos,const int &zoom, double hScale, double vScale, QString userImageFileName, internals::PureProjection *projection);
         bool UseMemoryCache(){return useMemoryCache;}//TODO
         void setUseMemoryCache(const bool& value){useMemoryCache=value;}
@@ -81,6 +82,7 @@ namespace core {
         AccessMode::Types accessmode;
         //  PureImageCache ImageCacheLocal;//TODO Criar acesso Get Set
         TileCacheQueue TileDBcacheQueue;
+        TileFetcher Fetcher;
         TLMaps();
         TLMaps(const TLMaps &)  : MemoryCache(), AllLayersOfType(), UrlFactory() {}
 
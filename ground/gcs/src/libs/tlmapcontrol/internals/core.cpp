@@ -36,7 +36,7 @@ using namespace projections;
 
 namespace internals {
     Core::Core():started(false),MouseWheelZooming(false),currentPosition(0,0),currentPositionPixel(0,0),LastLocationInBounds(-1,-1),sizeOfMapArea(0,0)
-            ,minOfTiles(0,0),maxOfTiles(0,0),zoom(0),isDragging(false),TooltipTextPadding(10,10),mapType(MapType::None),loaderLimit(5),maxzoom(21),runningThreads(0)
+            ,minOfTiles(0,0),maxOfTiles(0,0),zoom(0),isDragging(false),TooltipTextPadding(10,10),mapType(MapType::None),loaderLimit(8),maxzoom(21),runningThreads(0)
     {
         mousewheelzoomtype=MouseWheelZoomType::MousePositionAndCenter;
         SetProjection(new MercatorProjection());
@@ -103,7 +103,8 @@ namespace internals {
                 {
                     Tile* m = Matrix.TileAt(task.Pos);
 
-                    if(m==0 || m->Overlays.count() == 0)
+                    // Skip tiles scrolled out of view while the task was queued
+                    if((m==0 || m->Overlays.count() == 0) && TileWanted(task))
                     {
 #ifdef DEBUG_CORE
                         qDebug()<<"Fill empty TileMatrix: " + task.ToString()<<" ID="<<debug;;
@@ -123,7 +124,7 @@ namespace internals {
                                 // tile number inversion(BottomLeft -> TopLeft) for pergo maps
                                 if(tl == MapType::PergoTurkeyMap)
                                 {
-                                    tileImage = TLMaps::Instance()->GetImageFromServer(tl, Point(task.Pos.X(), maxOfTiles.Height() - task.Pos.Y()), task.Zoom);
+                                    tileImage = TLMaps::Instance()->GetImageFromServer(tl, Point(task.Pos.X(), maxOfTiles.Height() - task.Pos.Y()), task.Zoom, this);
                                 }
                                 else if(tl == MapType::UserImage)
                                 {
@@ -134,7 +135,7 @@ namespace internals {
 #ifdef DEBUG_CORE
                                     qDebug()<<"start getting image"<<" ID="<<debug;
 #endif //DEBUG_CORE
-                                    tileImage = TLMaps::Instance()->GetImageFromServer(tl, task.Pos, task.Zoom);
+                                    tileImage = TLMaps::Instance()->GetImageFromServer(tl, task.Pos, task.Zoom, this);
 #ifdef DEBUG_CORE
                                     qDebug()<<"Core::run:gotimage size:"<<tileImage.count()<<" ID="<<debug;
 #endif //DEBUG_CORE
@@ -161,7 +162,7 @@ namespace internals {
 #endif //DEBUG_CORE
                                 }
                             }
-                            while(++retry < TLMaps::Instance()->RetryLoadTile);
+                            while(++retry < TLMaps::Instance()->RetryLoadTile && TileWanted(task));
                         }
 
                         if(t->Overlays.count() > 0)
@@ -657,6 +658,21 @@ namespace internals {
         {
             FindTilesAround(tileDrawingList);
 
+            // Stop downloading tiles that are no longer in view
+            QSet<RawTile> wanted;
+            QVector<MapType::Types> layers= TLMaps::Instance()->GetAllLayersOfType(GetMapType());
+            foreach(Point p,tileDrawingList)
+            {
+                foreach(MapType::Types tl,layers)
+                {
+                    if(tl == MapType::PergoTurkeyMap)
+                        wanted.insert(RawTile(tl, Point(p.X(), maxOfTiles.Height() - p.Y()), Zoom()));
+                    else
+                        wanted.insert(RawTile(tl, p, Zoom()));
+                }
+            }
+            TLMaps::Instance()->Fetcher.CancelAllExcept(this, wanted);
+
 #ifdef DEBUG_CORE
             qDebug()<<"OnTileLoadStart: " << tileDrawingList.count() << " tiles to load at zoom " << Zoom() << ", time: " << QDateTime::currentDateTime().date();
 #endif //DEBUG_CORE
@@ -690,6 +706,20 @@ namespace internals {
         MtileDrawingList.unlock();
         UpdateGroundResolution();
     }
+    /**
+     * Whether a tile is still in view, and so worth loading
+     */
+    bool Core::TileWanted(const LoadTask &task)
+    {
+        if(task.Zoom != Zoom())
+            return false;
+
+        MtileDrawingList.lock();
+        bool wanted = tileDrawingList.contains(task.Pos);
+        MtileDrawingList.unlock();
+
+        return wanted;
+    }
     void Core::FindTilesAround(QList<Point> &list)
     {
         list.clear();;
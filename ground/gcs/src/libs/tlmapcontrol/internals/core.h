@@ -190,6 +190,8 @@ namespace internals {
 
         void FindTilesAround(QList<core::Point> &list);
 
+        bool TileWanted(LoadTask const& task);
+
         void UpdateGroundResolution();
 
         TileMatrix Matrix;
@@ -0,0 +1,21 @@
+QT += sql testlib
+QT -= gui
+TEMPLATE = app
+TARGET = tst_pureimagecache
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+# Built against the cache sources directly, so no map widget is needed
+DEFINES += TLMAPWIDGET_LIBRARY
+CORE = ../../core
+INCLUDEPATH += $$CORE
+
+SOURCES += tst_pureimagecache.cpp \
+    $$CORE/pureimagecache.cpp \
+    $$CORE/rawtile.cpp \
+    $$CORE/point.cpp \
+    $$CORE/size.cpp \
+    $$CORE/cacheitemqueue.cpp
+
+HEADERS += $$CORE/pureimagecache.h \
+    $$CORE/maptype.h
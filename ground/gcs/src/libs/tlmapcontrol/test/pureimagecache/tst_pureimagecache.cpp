@@ -0,0 +1,158 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_pureimagecache.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @brief      Tests and lookup benchmarks for the tile database
+ * @see        The GNU Public License (GPL) Version 3
+ * @defgroup   TLMapWidget
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "pureimagecache.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QtTest>
+
+using namespace core;
+
+//! Tiles in the benchmark database: a 64x64 block at one zoom level
+#define TILES_PER_SIDE 64
+#define TILE_ZOOM 17
+#define TILE_SIZE 20000
+
+/**
+ * Lookups are reported per tile, so the rate is 1 / (msecs per iteration).
+ * "Hot" tiles are in the in-memory LRU; "cold" tiles must come from SQLite.
+ */
+class tst_PureImageCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void roundTrip();
+    void batchInsert();
+    void hotLookups();
+    void coldLookups();
+
+private:
+    QByteArray tileData(int x, int y);
+
+    QTemporaryDir dir;
+    PureImageCache cache;
+};
+
+QByteArray tst_PureImageCache::tileData(int x, int y)
+{
+    QByteArray tile(TILE_SIZE, 0);
+    for (int i = 0; i < tile.size(); i++)
+        tile[i] = (char) (x * 31 + y * 17 + i);
+
+    return tile;
+}
+
+void tst_PureImageCache::initTestCase()
+{
+    QVERIFY(dir.isValid());
+    cache.setGtileCache(dir.path() + QDir::separator());
+
+    QList<CacheItemQueue*> tiles;
+    for (int x = 0; x < TILES_PER_SIDE; x++)
+        for (int y = 0; y < TILES_PER_SIDE; y++)
+            tiles.append(new CacheItemQueue(MapType::GoogleSatellite, Point(x, y), tileData(x, y), TILE_ZOOM));
+
+    QVERIFY(cache.PutImagesToCache(tiles));
+    qDeleteAll(tiles);
+}
+
+void tst_PureImageCache::roundTrip()
+{
+    QVERIFY(cache.PutImageToCache(tileData(1000, 1000), MapType::GoogleMap, Point(1000, 1000), 3));
+    QCOMPARE(cache.GetImageFromCache(MapType::GoogleMap, Point(1000, 1000), 3), tileData(1000, 1000));
+
+    // ... and again once the tile has to come from the database
+    cache.clearMemory();
+    QCOMPARE(cache.GetImageFromCache(MapType::GoogleMap, Point(1000, 1000), 3), tileData(1000, 1000));
+
+    QVERIFY(cache.GetImageFromCache(MapType::GoogleMap, Point(1001, 1000), 3).isEmpty());
+    QVERIFY(cache.GetImageFromCache(MapType::GoogleSatellite, Point(1000, 1000), 3).isEmpty());
+}
+
+void tst_PureImageCache::batchInsert()
+{
+    QList<CacheItemQueue*> tiles;
+    for (int i = 0; i < 256; i++)
+        tiles.append(new CacheItemQueue(MapType::GoogleTerrain, Point(i, 0), tileData(i, 0), TILE_ZOOM));
+
+    QBENCHMARK_ONCE {
+        QVERIFY(cache.PutImagesToCache(tiles));
+    }
+    qDeleteAll(tiles);
+
+    cache.clearMemory();
+    QCOMPARE(cache.GetImageFromCache(MapType::GoogleTerrain, Point(255, 0), TILE_ZOOM), tileData(255, 0));
+}
+
+void tst_PureImageCache::hotLookups()
+{
+    // Few enough tiles to stay in memory
+    QVector<QByteArray> expected;
+    for (int x = 0; x < 8; x++) {
+        expected.append(tileData(x, 0));
+        QCOMPARE(cache.GetImageFromCache(MapType::GoogleSatellite, Point(x, 0), TILE_ZOOM), expected[x]);
+    }
+
+    // Comparing whole tiles would cost more than the lookup; the contents
+    // of the last one are checked below
+    int x = 0;
+    QByteArray tile;
+    QBENCHMARK {
+        tile = cache.GetImageFromCache(MapType::GoogleSatellite, Point(x, 0), TILE_ZOOM);
+        QCOMPARE(tile.size(), TILE_SIZE);
+        x = (x + 1) % 8;
+    }
+
+    QCOMPARE(tile, expected[(x + 7) % 8]);
+}
+
+void tst_PureImageCache::coldLookups()
+{
+    // Spread over the database, and built before timing
+    QVector<Point> points;
+    QVector<QByteArray> expected;
+    for (int n = 0; n < 64; n++) {
+        int x = (n * 7) % TILES_PER_SIDE, y = (n * 13) % TILES_PER_SIDE;
+        points.append(Point(x, y));
+        expected.append(tileData(x, y));
+    }
+
+    int n = 0;
+    QBENCHMARK {
+        cache.clearMemory();
+        QByteArray tile = cache.GetImageFromCache(MapType::GoogleSatellite, points[n], TILE_ZOOM);
+        QCOMPARE(tile, expected[n]);
+        n = (n + 1) % points.size();
+    }
+}
+
+QTEST_MAIN(tst_PureImageCache)
+
+#include "tst_pureimagecache.moc"
@@ -0,0 +1,20 @@
+QT += network concurrent testlib
+QT -= gui
+TEMPLATE = app
+TARGET = tst_tilefetcher
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+# Built against the fetcher sources directly, so no map widget is needed
+DEFINES += TLMAPWIDGET_LIBRARY
+CORE = ../../core
+INCLUDEPATH += $$CORE
+
+SOURCES += tst_tilefetcher.cpp \
+    $$CORE/tilefetcher.cpp \
+    $$CORE/rawtile.cpp \
+    $$CORE/point.cpp \
+    $$CORE/size.cpp
+
+HEADERS += $$CORE/tilefetcher.h \
+    $$CORE/maptype.h
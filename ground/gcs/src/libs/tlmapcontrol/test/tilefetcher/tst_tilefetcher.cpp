@@ -0,0 +1,365 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_tilefetcher.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @brief      Tests and cold load benchmarks for the tile fetcher
+ * @see        The GNU Public License (GPL) Version 3
+ * @defgroup   TLMapWidget
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "tilefetcher.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QSemaphore>
+#include <QtCore/QTimer>
+#include <QtConcurrent/QtConcurrent>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <QtTest/QtTest>
+
+using namespace core;
+
+//! Tiles loaded per benchmark iteration, as for a freshly opened map
+#define GRID_TILES 64
+//! Loader threads, as the map's thread pool
+#define LOADER_THREADS 8
+//! Server latency for the benchmarks, in ms
+#define BENCHMARK_LATENCY 20
+#define FETCH_TIMEOUT 5000
+
+/**
+ * Minimal keep-alive HTTP/1.1 tile server. GET /<x>/<y>/<z> returns
+ * "tile <x>/<y>/<z>" after a fixed latency; any other path is a 404.
+ */
+class TileServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    TileServer() : latency(0) {}
+
+    QAtomicInt latency;
+    QAtomicInt connections;
+    QAtomicInt requests;
+
+protected:
+    void incomingConnection(qintptr socketDescriptor)
+    {
+        QTcpSocket *socket = new QTcpSocket(this);
+        socket->setSocketDescriptor(socketDescriptor);
+        connections.ref();
+
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            pending[socket].append(socket->readAll());
+
+            int end;
+            while ((end = pending[socket].indexOf("\r\n\r\n")) >= 0) {
+                QByteArray head = pending[socket].left(end);
+                pending[socket].remove(0, end + 4);
+                requests.ref();
+
+                QByteArray path = head.split(' ').value(1);
+                QByteArray response;
+                if (path.count('/') == 3) {
+                    QByteArray body = "tile " + path.mid(1);
+                    response = "HTTP/1.1 200 OK\r\nContent-Type: image/png\r\nContent-Length: " +
+                            QByteArray::number(body.size()) + "\r\n\r\n" + body;
+                } else {
+                    response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+                }
+
+                QTimer::singleShot(latency.load(), socket, [socket, response]() {
+                    socket->write(response);
+                });
+            }
+        });
+        connect(socket, &QObject::destroyed, this, [this, socket]() {
+            pending.remove(socket);
+        });
+    }
+
+private:
+    QHash<QTcpSocket *, QByteArray> pending;
+};
+
+/**
+ * Runs the server on its own thread, so it keeps answering while the test
+ * thread is blocked in Fetch().
+ */
+class ServerThread : public QThread
+{
+public:
+    ServerThread() : server(0), port(0) {}
+
+    TileServer *server;
+    quint16 port;
+    QSemaphore ready;
+
+protected:
+    void run()
+    {
+        TileServer tileServer;
+        tileServer.listen(QHostAddress::LocalHost);
+        server = &tileServer;
+        port = tileServer.serverPort();
+        ready.release();
+
+        exec();
+        server = 0;
+    }
+};
+
+class tst_TileFetcher : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void fetchTile();
+    void notFound();
+    void sharedRequests();
+    void connectionReuse();
+    void timeout();
+    void cancelled();
+    void coldLoadFetcher();
+    void coldLoadPerTile();
+
+private:
+    RawTile tile(int x, int y, int zoom);
+    QNetworkRequest request(RawTile tile);
+    QNetworkRequest request(const QString &path);
+    QByteArray body(RawTile tile);
+    static QByteArray fetchPerTile(const QNetworkRequest &request);
+
+    ServerThread serverThread;
+    int zoom;
+};
+
+RawTile tst_TileFetcher::tile(int x, int y, int zoom)
+{
+    return RawTile(MapType::OpenStreetMap, Point(x, y), zoom);
+}
+
+QNetworkRequest tst_TileFetcher::request(RawTile tile)
+{
+    return request(QString("/%1/%2/%3").arg(tile.Pos().X()).arg(tile.Pos().Y()).arg(tile.Zoom()));
+}
+
+QNetworkRequest tst_TileFetcher::request(const QString &path)
+{
+    return QNetworkRequest(QUrl(QString("http://127.0.0.1:%1%2").arg(serverThread.port).arg(path)));
+}
+
+QByteArray tst_TileFetcher::body(RawTile tile)
+{
+    return QString("tile %1/%2/%3").arg(tile.Pos().X()).arg(tile.Pos().Y()).arg(tile.Zoom()).toLatin1();
+}
+
+void tst_TileFetcher::initTestCase()
+{
+    serverThread.start();
+    serverThread.ready.acquire();
+    QVERIFY(serverThread.port != 0);
+
+    QThreadPool::globalInstance()->setMaxThreadCount(LOADER_THREADS);
+    zoom = 0;
+}
+
+void tst_TileFetcher::cleanupTestCase()
+{
+    serverThread.quit();
+    serverThread.wait();
+}
+
+void tst_TileFetcher::init()
+{
+    serverThread.server->latency = 0;
+
+    // Every test and benchmark iteration uses tiles no one has fetched yet
+    ++zoom;
+}
+
+void tst_TileFetcher::fetchTile()
+{
+    TileFetcher fetcher;
+    TileFetcher::Result result;
+
+    QByteArray data = fetcher.Fetch(tile(1, 2, zoom), request(tile(1, 2, zoom)), FETCH_TIMEOUT, &result);
+    QCOMPARE(result, TileFetcher::Ok);
+    QCOMPARE(data, body(tile(1, 2, zoom)));
+}
+
+void tst_TileFetcher::notFound()
+{
+    TileFetcher fetcher;
+    TileFetcher::Result result;
+
+    QByteArray data = fetcher.Fetch(tile(1, 2, zoom), request("/missing"), FETCH_TIMEOUT, &result);
+    QCOMPARE(result, TileFetcher::NetworkError);
+    QVERIFY(data.isEmpty());
+}
+
+void tst_TileFetcher::sharedRequests()
+{
+    TileFetcher fetcher;
+    TileServer *server = serverThread.server;
+    server->latency = 200;
+    int before = server->requests.load();
+
+    RawTile shared = tile(3, 4, zoom);
+    QList<QFuture<QByteArray> > loads;
+    for (int i = 0; i < 4; i++)
+        loads.append(QtConcurrent::run([&]() {
+            return fetcher.Fetch(shared, request(shared), FETCH_TIMEOUT);
+        }));
+
+    foreach (QFuture<QByteArray> load, loads)
+        QCOMPARE(load.result(), body(shared));
+
+    QCOMPARE(server->requests.load() - before, 1);
+}
+
+void tst_TileFetcher::connectionReuse()
+{
+    TileFetcher fetcher;
+    TileServer *server = serverThread.server;
+    int connections = server->connections.load();
+    int requests = server->requests.load();
+
+    for (int i = 0; i < 2 * GRID_TILES; i++)
+        QCOMPARE(fetcher.Fetch(tile(i, 0, zoom), request(tile(i, 0, zoom)), FETCH_TIMEOUT), body(tile(i, 0, zoom)));
+
+    QCOMPARE(server->requests.load() - requests, 2 * GRID_TILES);
+    QVERIFY(server->connections.load() - connections <= fetcher.MaxParallel());
+}
+
+void tst_TileFetcher::timeout()
+{
+    TileFetcher fetcher;
+    TileFetcher::Result result;
+    serverThread.server->latency = 500;
+
+    QByteArray data = fetcher.Fetch(tile(5, 6, zoom), request(tile(5, 6, zoom)), 50, &result);
+    QCOMPARE(result, TileFetcher::Timeout);
+    QVERIFY(data.isEmpty());
+}
+
+void tst_TileFetcher::cancelled()
+{
+    TileFetcher fetcher;
+    serverThread.server->latency = 500;
+
+    int mapA, mapB;
+    RawTile onlyA = tile(7, 8, zoom), both = tile(9, 10, zoom);
+
+    TileFetcher::Result onlyAResult, bothResultA, bothResultB;
+    QFuture<QByteArray> loadOnlyA = QtConcurrent::run([&]() {
+        return fetcher.Fetch(onlyA, request(onlyA), FETCH_TIMEOUT, &onlyAResult, &mapA);
+    });
+    QFuture<QByteArray> loadBothA = QtConcurrent::run([&]() {
+        return fetcher.Fetch(both, request(both), FETCH_TIMEOUT, &bothResultA, &mapA);
+    });
+    QFuture<QByteArray> loadBothB = QtConcurrent::run([&]() {
+        return fetcher.Fetch(both, request(both), FETCH_TIMEOUT, &bothResultB, &mapB);
+    });
+
+    // Let the requests start, then scroll map A away from both tiles
+    QTest::qWait(100);
+    QElapsedTimer elapsed;
+    elapsed.start();
+    fetcher.CancelAllExcept(&mapA, QSet<RawTile>());
+
+    QVERIFY(loadOnlyA.result().isEmpty());
+    QCOMPARE(onlyAResult, TileFetcher::Cancelled);
+    QVERIFY(elapsed.elapsed() < 400);
+
+    // Map B still wants the other tile
+    QCOMPARE(loadBothA.result(), body(both));
+    QCOMPARE(loadBothB.result(), body(both));
+    QCOMPARE(bothResultA, TileFetcher::Ok);
+    QCOMPARE(bothResultB, TileFetcher::Ok);
+}
+
+/**
+ * Loads a grid of tiles from the loader threads, through the fetcher
+ */
+void tst_TileFetcher::coldLoadFetcher()
+{
+    TileFetcher fetcher;
+    serverThread.server->latency = BENCHMARK_LATENCY;
+
+    QVector<int> grid(GRID_TILES);
+    for (int i = 0; i < grid.size(); i++)
+        grid[i] = i;
+
+    QBENCHMARK {
+        ++zoom;
+        QtConcurrent::blockingMap(grid, [&](int i) {
+            RawTile t = tile(i % 8, i / 8, zoom);
+            QByteArray data = fetcher.Fetch(t, request(t), FETCH_TIMEOUT);
+            Q_ASSERT(data == body(t));
+            Q_UNUSED(data);
+        });
+    }
+}
+
+/**
+ * As it was done before the fetcher: every tile gets its own access manager,
+ * and so its own connection, and an event loop in the loader thread
+ */
+QByteArray tst_TileFetcher::fetchPerTile(const QNetworkRequest &request)
+{
+    QEventLoop q;
+    QNetworkAccessManager network;
+    connect(&network, SIGNAL(finished(QNetworkReply*)), &q, SLOT(quit()));
+
+    QNetworkReply *reply = network.get(request);
+    q.exec();
+
+    // The reply is deleted with the access manager
+    return reply->readAll();
+}
+
+void tst_TileFetcher::coldLoadPerTile()
+{
+    serverThread.server->latency = BENCHMARK_LATENCY;
+
+    QVector<int> grid(GRID_TILES);
+    for (int i = 0; i < grid.size(); i++)
+        grid[i] = i;
+
+    QBENCHMARK {
+        ++zoom;
+        QtConcurrent::blockingMap(grid, [&](int i) {
+            RawTile t = tile(i % 8, i / 8, zoom);
+            QByteArray data = fetchPerTile(request(t));
+            Q_ASSERT(data == body(t));
+            Q_UNUSED(data);
+        });
+    }
+}
+
+QTEST_MAIN(tst_TileFetcher)
+
+#include "tst_tilefetcher.moc"
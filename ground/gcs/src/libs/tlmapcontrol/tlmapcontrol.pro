@@ -27,6 +27,7 @@ SOURCES += mapwidget/mapgraphicitem.cpp \
     core/providerstrings.cpp \
     core/cacheitemqueue.cpp \
     core/tilecachequeue.cpp \
+    core/tilefetcher.cpp \
     core/alllayersoftype.cpp \
     core/urlfactory.cpp \
     core/point.cpp \
@@ -82,6 +83,7 @@ HEADERS += mapwidget/mapgraphicitem.h \
     core/providerstrings.h \
     core/cacheitemqueue.h \
     core/tilecachequeue.h \
+    core/tilefetcher.h \
     core/alllayersoftype.h \
     core/urlfactory.h \
     core/geodecoderstatus.h \
@@ -39,6 +39,7 @@ HITLConfiguration::HITLConfiguration(QString classId, QSettings* qSettings, QObj
     settings.manualControlEnabled = true;
     settings.startSim = false;
     settings.addNoise = false;
+    settings.lockstep = false;
     settings.hostAddress = "127.0.0.1";
     settings.remoteAddress = "127.0.0.1";
     settings.outPort = 0;
@@ -85,6 +86,7 @@ HITLConfiguration::HITLConfiguration(QString classId, QSettings* qSettings, QObj
         settings.longitude           = qSettings->value("longitude").toString();
         settings.startSim            = qSettings->value("startSim").toBool();
         settings.addNoise            = qSettings->value("noiseCheckBox").toBool();
+        settings.lockstep            = qSettings->value("lockstep").toBool();
 
         settings.inputCommand        = qSettings->value("inputCommand").toBool();
         if(settings.inputCommand){
@@ -152,6 +154,7 @@ void HITLConfiguration::saveConfig(QSettings* qSettings) const {
     qSettings->setValue("latitude", settings.latitude);
     qSettings->setValue("longitude", settings.longitude);
     qSettings->setValue("addNoise", settings.addNoise);
+    qSettings->setValue("lockstep", settings.lockstep);
     qSettings->setValue("startSim", settings.startSim);
 
     qSettings->setValue("inputCommand", settings.inputCommand);
@@ -53,6 +53,8 @@ Simulator::Simulator(const SimulatorSettings& params) :
 	simConnectionStatus(false),
 	txTimer(NULL),
 	simTimer(NULL),
+	lockstepTimer(NULL),
+	lockstepSampleReady(false),
 	name("")
 {
 	// move to thread
@@ -103,6 +105,12 @@ Simulator::~Simulator()
 		delete simTimer;
 		simTimer = NULL;
 	}
+
+	if(lockstepTimer)
+	{
+		delete lockstepTimer;
+		lockstepTimer = NULL;
+	}
 	// NOTE: Does not currently work, may need to send control+c to through the terminal
 	if (simProcess != NULL)
 	{
@@ -164,6 +172,8 @@ void Simulator::onStart()
     gpsVel = GPSVelocity::GetInstance(objManager);
     telStats = GCSTelemetryStats::GetInstance(objManager);
     groundTruth = GroundTruth::GetInstance(objManager);
+    hitlSensors = HitlSensors::GetInstance(objManager);
+    hitlActuators = HitlActuators::GetInstance(objManager);
 
     // Listen to autopilot connection events
     TelemetryManager* telMngr = pm->getObject<TelemetryManager>();
@@ -186,11 +196,22 @@ void Simulator::onStart()
 
 	connect(inSocket, SIGNAL(readyRead()), this, SLOT(receiveUpdate()),Qt::DirectConnection);
 
-	// Setup transmit timer
-	txTimer = new QTimer();
-	connect(txTimer, SIGNAL(timeout()), this, SLOT(transmitUpdate()),Qt::DirectConnection);
-	txTimer->setInterval(updatePeriod);
-	txTimer->start();
+	if (settings.lockstep) {
+		// The simulator is sent the actuators as each step is answered,
+		// the timer only resends steps that got no answer
+		hitl_lockstep_host_init(&lockstep);
+		connect(hitlActuators, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(onLockstepAnswer(UAVObject*)),Qt::DirectConnection);
+		lockstepTimer = new QTimer();
+		connect(lockstepTimer, SIGNAL(timeout()), this, SLOT(onLockstepTimer()),Qt::DirectConnection);
+		lockstepTimer->setInterval(HITL_LOCKSTEP_RESEND_MS / 5);
+		lockstepTimer->start();
+	} else {
+		// Setup transmit timer
+		txTimer = new QTimer();
+		connect(txTimer, SIGNAL(timeout()), this, SLOT(transmitUpdate()),Qt::DirectConnection);
+		txTimer->setInterval(updatePeriod);
+		txTimer->start();
+	}
 	// Setup simulator connection timer
 	simTimer = new QTimer();
 	connect(simTimer, SIGNAL(timeout()), this, SLOT(onSimulatorConnectionTimeout()),Qt::DirectConnection);
@@ -268,7 +289,11 @@ void Simulator::setupUAVObjects()
 
     // Most simulators use the flight controller's ActuatorDesired UAVO
     // for control output...
-    if (settings.simulatorId == "FG"  ||
+    if (settings.lockstep) {
+        // ...or, in lockstep, the answers to the steps. Both only go out
+        // when the other end has something new.
+        setupLockstepObjects();
+    } else if (settings.simulatorId == "FG"  ||
              settings.simulatorId == "X-Plane")
     {
         setupInputObject(actDesired, settings.minOutputPeriod);
@@ -290,12 +315,13 @@ void Simulator::setupUAVObjects()
         setupOutputObject(velActual, settings.groundTruthRate);
     }
 
-    if (settings.attRawEnabled) {
+    // In lockstep the sensors are part of each step
+    if (settings.attRawEnabled && !settings.lockstep) {
         setupOutputObject(accels, settings.attRawRate);
         setupOutputObject(gyros, settings.attRawRate);
     }
 
-    if (settings.attActualEnabled  && settings.attActHW) {
+    if (settings.attActualEnabled  && settings.attActHW && !settings.lockstep) {
         setupOutputObject(accels, settings.attRawRate);
         setupOutputObject(gyros, settings.attRawRate);
     }
@@ -308,7 +334,7 @@ void Simulator::setupUAVObjects()
     if(settings.airspeedActualEnabled)
         setupOutputObject(airspeedActual, settings.airspeedActualRate);
 
-    if(settings.baroAltitudeEnabled)
+    if(settings.baroAltitudeEnabled && !settings.lockstep)
         setupOutputObject(baroAlt, settings.baroAltRate);
 
     // Set new metadata
@@ -369,6 +395,32 @@ void Simulator::setupOutputObject(UAVObject* obj, quint32 updatePeriod)
     metaDataList.insert(obj->getName(), mdata);
 }
 
+/**
+ * @brief Simulator::setupLockstepObjects Sets metadata for the steps sent to
+ * the flight controller board and for its answers, so each is sent exactly
+ * once when it is set
+ */
+void Simulator::setupLockstepObjects()
+{
+    UAVObject::Metadata mdata = metaDataList.value(hitlSensors->getName());
+    UAVObject::SetGcsAccess(mdata, UAVObject::ACCESS_READWRITE);
+    UAVObject::SetGcsTelemetryAcked(mdata, false);
+    UAVObject::SetGcsTelemetryUpdateMode(mdata, UAVObject::UPDATEMODE_ONCHANGE);
+    mdata.gcsTelemetryUpdatePeriod = 0;
+    UAVObject::SetFlightAccess(mdata, UAVObject::ACCESS_READONLY);
+    UAVObject::SetFlightTelemetryUpdateMode(mdata, UAVObject::UPDATEMODE_MANUAL);
+    metaDataList.insert(hitlSensors->getName(), mdata);
+
+    mdata = metaDataList.value(hitlActuators->getName());
+    UAVObject::SetGcsAccess(mdata, UAVObject::ACCESS_READONLY);
+    UAVObject::SetGcsTelemetryUpdateMode(mdata, UAVObject::UPDATEMODE_MANUAL);
+    UAVObject::SetFlightAccess(mdata, UAVObject::ACCESS_READWRITE);
+    UAVObject::SetFlightTelemetryAcked(mdata, false);
+    UAVObject::SetFlightTelemetryUpdateMode(mdata, UAVObject::UPDATEMODE_ONCHANGE);
+    mdata.flightTelemetryUpdatePeriod = 0;
+    metaDataList.insert(hitlActuators->getName(), mdata);
+}
+
 void Simulator::onAutopilotConnect()
 {
 	autopilotConnectionStatus = true;
@@ -719,9 +771,29 @@ void Simulator::updateUAVOs(Output2Hardware out){
 //        }
 //    }
 
+    /*******************************/
+    // In lockstep the newest sensor sample makes the next step, sent as soon
+    // as the autopilot has answered the previous one
+    if (settings.lockstep) {
+        memset(&lockstepSample, 0, sizeof(HitlSensors::DataFields));
+        lockstepSample.DeltaTime = out.delT;
+        lockstepSample.Gyro[HitlSensors::GYRO_X] = out.rollRate + noise.gyroData.x;
+        lockstepSample.Gyro[HitlSensors::GYRO_Y] = out.pitchRate + noise.gyroData.y;
+        lockstepSample.Gyro[HitlSensors::GYRO_Z] = out.yawRate + noise.gyroData.z;
+        lockstepSample.Accel[HitlSensors::ACCEL_X] = out.accX + noise.accelData.x;
+        lockstepSample.Accel[HitlSensors::ACCEL_Y] = out.accY + noise.accelData.y;
+        lockstepSample.Accel[HitlSensors::ACCEL_Z] = out.accZ + noise.accelData.z;
+        lockstepSample.BaroAltitude = settings.baroAltitudeEnabled ?
+                    out.altitude + noise.baroAltData.Altitude : NAN;
+        lockstepSampleReady = true;
+
+        if (hitl_lockstep_host_ready(&lockstep))
+            sendLockstepStep();
+    }
+
     /*******************************/
     // Update BaroAltitude object
-    if (settings.baroAltitudeEnabled){
+    if (settings.baroAltitudeEnabled && !settings.lockstep){
         if (baroAltTime.msecsTo(currentTime) >= settings.baroAltRate) {
         BaroAltitude::DataFields baroAltData;
         memset(&baroAltData, 0, sizeof(BaroAltitude::DataFields));
@@ -752,7 +824,7 @@ void Simulator::updateUAVOs(Output2Hardware out){
 
     /*******************************/
     // Update raw attitude sensors
-    if (settings.attRawEnabled) {
+    if (settings.attRawEnabled && !settings.lockstep) {
         if (attRawTime.msecsTo(currentTime) >= settings.attRawRate) {
             //Update gyroscope sensor data
             Gyros::DataFields gyroData;
@@ -775,6 +847,63 @@ void Simulator::updateUAVOs(Output2Hardware out){
     }
 }
 
+/**
+ * @brief Simulator::sendLockstepStep Sends the newest sensor sample to the
+ * autopilot as the next step
+ */
+void Simulator::sendLockstepStep()
+{
+    lockstepSample.Step = hitl_lockstep_host_begin(&lockstep, time->elapsed());
+    lockstepSampleReady = false;
+
+    hitlSensors->setData(lockstepSample);
+}
+
+/**
+ * @brief Simulator::onLockstepAnswer Passes the actuators the autopilot
+ * computed for the pending step on to the simulator
+ */
+void Simulator::onLockstepAnswer(UAVObject* obj)
+{
+    Q_UNUSED(obj);
+
+    HitlActuators::DataFields answer = hitlActuators->getData();
+    if (!hitl_lockstep_host_ack(&lockstep, answer.Step))
+        return;
+
+    // Only kept locally, the simulators read their controls from it
+    ActuatorDesired::DataFields actData = actDesired->getData();
+    actData.Roll = answer.Roll;
+    actData.Pitch = answer.Pitch;
+    actData.Yaw = answer.Yaw;
+    actData.Thrust = answer.Thrust;
+    actDesired->setData(actData);
+
+    transmitUpdate();
+
+    if (lockstepSampleReady)
+        sendLockstepStep();
+}
+
+/**
+ * @brief Simulator::onLockstepTimer Resends a step that got no answer, or
+ * moves on to the newest sample when the autopilot stays silent
+ */
+void Simulator::onLockstepTimer()
+{
+    switch (hitl_lockstep_host_poll(&lockstep, time->elapsed())) {
+    case HITL_LOCKSTEP_WAIT:
+        break;
+    case HITL_LOCKSTEP_RESEND:
+        hitlSensors->updated();
+        break;
+    case HITL_LOCKSTEP_LOST:
+        if (lockstepSampleReady)
+            sendLockstepStep();
+        break;
+    }
+}
+
 /**
  * calculate air density from altitude. http://en.wikipedia.org/wiki/Density_of_air
  */
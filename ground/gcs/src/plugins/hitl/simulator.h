@@ -62,6 +62,8 @@
 #include "gpsvelocity.h"
 #include "groundtruth.h"
 #include "gyros.h"
+#include "hitlactuators.h"
+#include "hitlsensors.h"
 #include "homelocation.h"
 #include "manualcontrolcommand.h"
 #include "positionactual.h"
@@ -70,6 +72,7 @@
 
 #include "utils/coordinateconversions.h"
 #include "physical_constants.h"
+#include "hitl_lockstep.h"
 
 /**
  * just imagine this was a class without methods and all public properties
@@ -166,6 +169,8 @@ typedef struct _CONNECTION
     bool airspeedActualEnabled;
     quint16 airspeedActualRate;
 
+    bool lockstep; //Exchange one sensor step for one actuator answer
+
 } SimulatorSettings;
 
 
@@ -272,6 +277,8 @@ private slots:
     void onAutopilotConnect();
     void onAutopilotDisconnect();
     void onSimulatorConnectionTimeout();
+    void onLockstepAnswer(UAVObject* obj);
+    void onLockstepTimer();
     Q_INVOKABLE void onDeleteSimulator(void);
 
     virtual void transmitUpdate() = 0;
@@ -301,6 +308,8 @@ protected:
     GCSTelemetryStats* telStats;
     GCSReceiver* gcsReceiver;
     GroundTruth* groundTruth;
+    HitlSensors* hitlSensors;
+    HitlActuators* hitlActuators;
 
     SimulatorSettings settings;
 
@@ -319,6 +328,11 @@ private:
     volatile bool simConnectionStatus;
     QTimer* txTimer;
     QTimer* simTimer;
+    QTimer* lockstepTimer;
+
+    struct hitl_lockstep_host lockstep;
+    HitlSensors::DataFields lockstepSample;
+    bool lockstepSampleReady;
 
     QTime attRawTime;
     QTime gpsPosTime;
@@ -335,6 +349,8 @@ private:
     void setupOutputObject(UAVObject* obj, quint32 updatePeriod);
     void setupInputObject(UAVObject* obj, quint32 updatePeriod);
     void setupUAVObjects();
+    void setupLockstepObjects();
+    void sendLockstepStep();
     UAVObjectUtilManager* getObjectUtilManager();
     UAVObjectManager* getObjectManager();
 
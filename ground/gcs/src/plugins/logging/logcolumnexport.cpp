@@ -0,0 +1,386 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logcolumnexport.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @brief      Streaming export of logfiles to per-object columnar tables
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup   Logging
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "logcolumnexport.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent>
+#include <QtEndian>
+
+#include "uavobjectmanager.h"
+#include "uavobjectfield.h"
+#include <uavtalk/uavtalk.h>
+
+//! Number of rows buffered per column before a row group is compressed
+#define ROWS_PER_GROUP 16384
+
+#define DRCOL_MAGIC 0x4c4f4344
+#define DRCOL_VERSION 1
+
+//! Size of the logfile's per-record header: timestamp and record size
+#define LOG_RECORD_HEADER_SIZE (sizeof(quint32) + sizeof(qint64))
+
+/**
+ * Accumulates the rows of one object type and writes them as compressed
+ * row groups.
+ */
+class LogColumnExport::TableWriter
+{
+public:
+    TableWriter(const ObjectLayout &layout) :
+        layout(layout),
+        rows(0),
+        columns(layout.columns.size())
+    {
+    }
+
+    bool open(const QString &fileName)
+    {
+        file.setFileName(fileName);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return false;
+
+        out.setDevice(&file);
+        out.setByteOrder(QDataStream::LittleEndian);
+
+        out << (quint32) DRCOL_MAGIC << (quint32) DRCOL_VERSION;
+        out << layout.name << layout.objId << (quint8) layout.singleInstance;
+
+        out << (quint32) (layout.columns.size() + (layout.singleInstance ? 1 : 2));
+        out << QString("timestamp") << QString("uint32") << (quint32) 1 << (quint32) sizeof(quint32);
+        if (!layout.singleInstance)
+            out << QString("instance") << QString("uint16") << (quint32) 1 << (quint32) sizeof(quint16);
+        foreach (const Column &column, layout.columns)
+            out << column.name << column.type << column.elements << column.size;
+
+        return out.status() == QDataStream::Ok;
+    }
+
+    void append(quint32 timestamp, quint16 instId, const quint8 *data)
+    {
+        quint8 le[sizeof(timestamp)];
+
+        qToLittleEndian(timestamp, le);
+        timestamps.append((const char *) le, sizeof(timestamp));
+
+        if (!layout.singleInstance) {
+            qToLittleEndian(instId, le);
+            instances.append((const char *) le, sizeof(instId));
+        }
+
+        for (int i = 0; i < columns.size(); i++) {
+            const Column &column = layout.columns[i];
+            columns[i].append((const char *) data + column.offset, column.size);
+        }
+
+        if (++rows >= ROWS_PER_GROUP)
+            flush();
+    }
+
+    bool finish()
+    {
+        flush();
+        out << (quint32) 0;
+        file.close();
+
+        return out.status() == QDataStream::Ok && file.error() == QFile::NoError;
+    }
+
+private:
+    void flush()
+    {
+        if (rows == 0)
+            return;
+
+        out << rows;
+        out << qCompress(timestamps);
+        if (!layout.singleInstance)
+            out << qCompress(instances);
+        for (int i = 0; i < columns.size(); i++) {
+            out << qCompress(columns[i]);
+            columns[i].clear();
+        }
+
+        timestamps.clear();
+        instances.clear();
+        rows = 0;
+    }
+
+    const ObjectLayout &layout;
+    QFile file;
+    QDataStream out;
+    quint32 rows;
+    QByteArray timestamps;
+    QByteArray instances;
+    QVector<QByteArray> columns;
+};
+
+/**
+ * @brief LogColumnExport::LogColumnExport captures the layout of every
+ * object type known to the object manager.
+ */
+LogColumnExport::LogColumnExport(UAVObjectManager *objMngr)
+{
+    foreach (const QVector<UAVObject *> &instances, objMngr->getObjectsVector()) {
+        if (instances.isEmpty())
+            continue;
+
+        UAVObject *obj = instances.first();
+
+        ObjectLayout layout;
+        layout.name = obj->getName();
+        layout.objId = obj->getObjID();
+        layout.singleInstance = obj->isSingleInstance();
+        layout.numBytes = obj->getNumBytes();
+
+        foreach (UAVObjectField *field, obj->getFields()) {
+            Column column;
+            column.name = field->getName();
+            column.type = field->getTypeAsString();
+            column.elements = field->getNumElements();
+            column.offset = field->getDataOffset();
+            column.size = field->getNumBytes();
+            layout.columns.append(column);
+        }
+
+        layouts.insert(layout.objId, layout);
+    }
+}
+
+/**
+ * @brief LogColumnExport::outputDirName
+ * @return the directory the tables for a logfile are written to
+ */
+QString LogColumnExport::outputDirName(const QString &logFileName)
+{
+    QFileInfo info(logFileName);
+    return info.path() + QDir::separator() + info.completeBaseName() + "_columns";
+}
+
+/**
+ * @brief LogColumnExport::exportLog exports a single logfile in one pass
+ * @param[in] logFileName the .drlog to export
+ * @param[out] errorMessage why the export failed
+ * @return true if successful
+ */
+bool LogColumnExport::exportLog(const QString &logFileName, QString *errorMessage) const
+{
+    QFile file(logFileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *errorMessage = file.errorString();
+        return false;
+    }
+
+    // Skip the git hash header, as LogFile::open() does
+    file.readLine();
+    file.readLine();
+    file.readLine();
+    QString tmpLine = file.readLine();
+    int cnt = 0;
+    while (tmpLine != "##\n" && cnt < 10 && !file.atEnd()) {
+        tmpLine = file.readLine().trimmed();
+        cnt++;
+    }
+    if (cnt >= 10 || file.atEnd())
+        file.seek(0);
+
+    qint64 pos = file.pos();
+    qint64 size = file.size();
+
+    QByteArray fallback;
+    const uchar *log = file.map(0, size);
+    if (log == NULL) {
+        file.seek(0);
+        fallback = file.readAll();
+        log = (const uchar *) fallback.constData();
+    }
+
+    QDir outputDir(outputDirName(logFileName));
+    if (!outputDir.mkpath(".")) {
+        *errorMessage = QString("Unable to create %1").arg(outputDir.path());
+        return false;
+    }
+
+    QHash<quint32, TableWriter *> writers;
+    QByteArray pending;
+    bool ok = true;
+
+    while (ok && pos + (qint64) LOG_RECORD_HEADER_SIZE <= size) {
+        quint32 timestamp;
+        qint64 dataSize;
+        memcpy(&timestamp, log + pos, sizeof(timestamp));
+        memcpy(&dataSize, log + pos + sizeof(timestamp), sizeof(dataSize));
+
+        // Same resync rule as replay
+        if ((dataSize & 0xFFFFFFFFFFFF0000) != 0) {
+            pos++;
+            continue;
+        }
+
+        if (pos + (qint64) LOG_RECORD_HEADER_SIZE + dataSize > size)
+            break;
+
+        // Records hold whatever was written to the link, so UAVTalk frames
+        // may span records; frames are stamped with the record completing them
+        pending.append((const char *) log + pos + LOG_RECORD_HEADER_SIZE, dataSize);
+        pos += LOG_RECORD_HEADER_SIZE + dataSize;
+
+        const quint8 *buf = (const quint8 *) pending.constData();
+        int n = pending.size();
+        int i = 0;
+
+        while (true) {
+            while (i < n && buf[i] != UAVTalk::SYNC_VAL)
+                i++;
+
+            if (n - i < UAVTalk::MIN_HEADER_LENGTH)
+                break;
+
+            quint8 type = buf[i + 1];
+            quint16 packetSize = qFromLittleEndian<quint16>(buf + i + 2);
+            quint32 objId = qFromLittleEndian<quint32>(buf + i + 4);
+
+            if ((type & UAVTalk::TYPE_MASK) != UAVTalk::TYPE_VER ||
+                    packetSize < UAVTalk::MIN_HEADER_LENGTH ||
+                    packetSize > UAVTalk::MAX_HEADER_LENGTH + UAVTalk::MAX_PAYLOAD_LENGTH) {
+                i++;
+                continue;
+            }
+
+            QHash<quint32, ObjectLayout>::const_iterator layout = layouts.constFind(objId);
+            if (layout == layouts.constEnd()) {
+                i++;
+                continue;
+            }
+
+            quint32 dataLength = (type == UAVTalk::TYPE_OBJ_REQ || type == UAVTalk::TYPE_ACK ||
+                                  type == UAVTalk::TYPE_NACK) ? 0 : layout->numBytes;
+            quint32 instanceLength = layout->singleInstance ? 0 : 2;
+
+            if (dataLength >= UAVTalk::MAX_PAYLOAD_LENGTH ||
+                    UAVTalk::MIN_HEADER_LENGTH + instanceLength + dataLength != packetSize) {
+                i++;
+                continue;
+            }
+
+            // Wait for the rest of the frame
+            if (n - i < packetSize + 1)
+                break;
+
+            if (UAVTalk::updateCRC(0, buf + i, packetSize) != buf[i + packetSize]) {
+                i++;
+                continue;
+            }
+
+            if (type == UAVTalk::TYPE_OBJ || type == UAVTalk::TYPE_OBJ_ACK) {
+                TableWriter *writer = writers.value(objId);
+                if (writer == NULL) {
+                    writer = new TableWriter(*layout);
+                    if (!writer->open(outputDir.filePath(layout->name + ".drcol"))) {
+                        delete writer;
+                        *errorMessage = QString("Unable to write table for %1").arg(layout->name);
+                        ok = false;
+                        break;
+                    }
+                    writers.insert(objId, writer);
+                }
+
+                quint16 instId = instanceLength ? qFromLittleEndian<quint16>(buf + i + UAVTalk::MIN_HEADER_LENGTH) : 0;
+                writer->append(timestamp, instId, buf + i + UAVTalk::MIN_HEADER_LENGTH + instanceLength);
+            }
+
+            i += packetSize + 1;
+        }
+
+        pending.remove(0, i);
+    }
+
+    foreach (TableWriter *writer, writers) {
+        if (!writer->finish() && ok) {
+            *errorMessage = QString("Error writing tables to %1").arg(outputDir.path());
+            ok = false;
+        }
+        delete writer;
+    }
+
+    return ok;
+}
+
+namespace {
+//! Exports one logfile, for QtConcurrent::mapped()
+struct ExportOne {
+    typedef QString result_type;
+
+    const LogColumnExport *exporter;
+
+    QString operator()(const QString &logFileName) const
+    {
+        QString errorMessage;
+        if (!exporter->exportLog(logFileName, &errorMessage))
+            return QString("%1: %2").arg(logFileName).arg(errorMessage);
+        return QString();
+    }
+};
+}
+
+/**
+ * @brief LogColumnExport::startExport exports several logfiles concurrently,
+ * in the background. The exporter must outlive the returned future.
+ * @return a future with one result per logfile, an error message or an
+ * empty string if it was exported
+ */
+QFuture<QString> LogColumnExport::startExport(const QStringList &logFileNames) const
+{
+    ExportOne exportOne = { this };
+    return QtConcurrent::mapped(logFileNames, exportOne);
+}
+
+/**
+ * @brief LogColumnExport::exportLogs exports several logfiles concurrently
+ * and waits for them
+ * @return one error message per logfile that failed
+ */
+QStringList LogColumnExport::exportLogs(const QStringList &logFileNames) const
+{
+    QFuture<QString> future = startExport(logFileNames);
+    future.waitForFinished();
+
+    QStringList errors = future.results();
+    errors.removeAll(QString());
+
+    return errors;
+}
+
+/**
+ * @}
+ * @}
+ */
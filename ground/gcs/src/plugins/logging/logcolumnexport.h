@@ -0,0 +1,99 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logcolumnexport.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @brief      Streaming export of logfiles to per-object columnar tables
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup   Logging
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef LOGCOLUMNEXPORT_H
+#define LOGCOLUMNEXPORT_H
+
+#include <QFuture>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+
+class UAVObjectManager;
+
+/**
+ * Exports .drlog files to one compressed columnar table per UAVObject type.
+ *
+ * The log is read once, front to back; UAVTalk frames are parsed directly
+ * from the raw bytes and each field's bytes are appended to its column, so
+ * no UAVObject is updated, no QVariant is built and no signal is emitted.
+ * The object layouts are taken from the UAVObjectManager once, when the
+ * exporter is constructed, after which several logs can be exported
+ * concurrently.
+ *
+ * Each table is written to <log name>_columns/<object name>.drcol, as a
+ * little endian QDataStream:
+ *   quint32 magic, quint32 version, QString object name, quint32 object id,
+ *   quint8 single instance, quint32 column count, then per column:
+ *   QString name, QString type, quint32 elements, quint32 bytes per row.
+ * This is followed by row groups of quint32 row count (0 terminates) and,
+ * per column, a qCompress()ed QByteArray of the column's values as they
+ * appear on the wire. The first column is the GCS timestamp in ms (uint32),
+ * followed by the instance id (uint16) for multi-instance objects, and then
+ * one column per field.
+ */
+class LogColumnExport
+{
+public:
+    explicit LogColumnExport(UAVObjectManager *objMngr);
+
+    bool exportLog(const QString &logFileName, QString *errorMessage) const;
+    QFuture<QString> startExport(const QStringList &logFileNames) const;
+    QStringList exportLogs(const QStringList &logFileNames) const;
+
+    static QString outputDirName(const QString &logFileName);
+
+private:
+    class TableWriter;
+
+    struct Column {
+        QString name;
+        QString type;
+        quint32 elements;
+        quint32 offset;
+        quint32 size;
+    };
+
+    struct ObjectLayout {
+        QString name;
+        quint32 objId;
+        bool singleInstance;
+        quint32 numBytes;
+        QVector<Column> columns;
+    };
+
+    QHash<quint32, ObjectLayout> layouts;
+};
+
+#endif // LOGCOLUMNEXPORT_H
+
+/**
+ * @}
+ * @}
+ */
@@ -30,12 +30,38 @@
 #include <QtGlobal>
 #include <QTextStream>
 #include <QMessageBox>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDataStream>
+
+#include <algorithm>
 
 #include <coreplugin/coreconstants.h>
 
+//! Size of the per-packet header: timestamp followed by the packet size
+#define LOG_PACKET_HEADER_SIZE (sizeof(quint32) + sizeof(qint64))
+
+//! Number of packets covered by each entry of the replay index
+#define LOG_INDEX_BLOCK 64
+
+//! Number of packets indexed per timer tick while replay is running
+#define LOG_INDEX_PACKETS_PER_TICK 8192
+
+//! Magic and version of the cached index stored next to the log
+#define LOG_INDEX_MAGIC 0x64724c78
+#define LOG_INDEX_VERSION 1
+
 LogFile::LogFile(QObject *parent) :
     QIODevice(parent),
-    timestampBufferIdx(0)
+    logData(NULL),
+    logDataSize(0),
+    logDataStart(0),
+    indexScanPos(0),
+    indexPacketCount(0),
+    indexLastTimestamp(0),
+    indexComplete(false),
+    lastTimeStampPos(0),
+    firstTimestamp(0)
 {
     connect(&timer, SIGNAL(timeout()), this, SLOT(timerFired()));
 }
@@ -141,6 +167,14 @@ void LogFile::close()
 
     if (timer.isActive())
         timer.stop();
+
+    if (logData && logDataFallback.isEmpty())
+        file.unmap(const_cast<uchar *>(logData));
+    logData = NULL;
+    logDataSize = 0;
+    logDataFallback.clear();
+    blockIndex.clear();
+
     file.close();
     QIODevice::close();
 }
@@ -176,111 +210,237 @@ qint64 LogFile::bytesAvailable() const
 
 void LogFile::timerFired()
 {
-    qint64 dataSize;
+    // Keep building the index behind playback so that seeks stay cheap
+    if (!indexComplete)
+        extendIndex(LOG_INDEX_PACKETS_PER_TICK);
+
+    int time;
+    time = myTime.elapsed();
 
-    if(file.bytesAvailable() > 4)
+    //Read packets
+    while ((lastPlayTime + ((time - lastPlayTimeOffset)* playbackSpeed) > (lastTimeStamp-firstTimestamp)))
     {
+        lastPlayTime += ((time - lastPlayTimeOffset)* playbackSpeed);
 
-        int time;
-        time = myTime.elapsed();
+        qint64 packetPos;
+        qint64 dataSize;
+        quint32 timeStamp;
+        if (!parsePacket(lastTimeStampPos, &packetPos, &timeStamp, &dataSize)) {
+            stopReplay();
+            return;
+        }
+
+        if (dataSize<1 || dataSize>(1024*1024)) {
+            qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << dataSize << "\n";
+            stopReplay();
+            return;
+        }
 
-        //Read packets
-        while ((lastPlayTime + ((time - lastPlayTimeOffset)* playbackSpeed) > (lastTimeStamp-firstTimestamp)))
-        {
-            lastPlayTime += ((time - lastPlayTimeOffset)* playbackSpeed);
-            if(file.bytesAvailable() < 4) {
-                stopReplay();
-                return;
-            }
-
-            file.seek(lastTimeStampPos+sizeof(lastTimeStamp));
-
-            file.read((char *) &dataSize, sizeof(dataSize));
-
-            if (dataSize<1 || dataSize>(1024*1024)) {
-                qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << dataSize << "\n";
-                stopReplay();
-                return;
-            }
-            if(file.bytesAvailable() < dataSize) {
-                stopReplay();
-                return;
-            }
-
-            mutex.lock();
-            dataBuffer.append(file.read(dataSize));
-            mutex.unlock();
-            emit readyRead();
-
-            if(file.bytesAvailable() < 4) {
-                stopReplay();
-                return;
-            }
-
-            lastTimeStampPos = timestampPos[timestampBufferIdx];
-            lastTimeStamp = timestampBuffer[timestampBufferIdx];
-            timestampBufferIdx++;
-
-            lastPlayTimeOffset = time;
-            time = myTime.elapsed();
+        mutex.lock();
+        dataBuffer.append((const char *) logData + packetPos + LOG_PACKET_HEADER_SIZE, dataSize);
+        mutex.unlock();
+        emit readyRead();
 
+        // Advance to the following packet, the next one to be played
+        if (!parsePacket(packetPos + LOG_PACKET_HEADER_SIZE + dataSize, &lastTimeStampPos, &lastTimeStamp, &dataSize)) {
+            stopReplay();
+            return;
         }
-    } else {
-        stopReplay();
-    }
 
+        lastPlayTimeOffset = time;
+        time = myTime.elapsed();
+    }
 }
 
-bool LogFile::startReplay() {
-    dataBuffer.clear();
-    myTime.restart();
-    lastPlayTimeOffset = 0;
-    lastPlayTime = 0;
-    playbackSpeed = 1;
+/**
+ * @brief LogFile::mapLogData maps the log body into memory so that packets
+ * can be indexed and replayed without a read() per packet. Falls back to
+ * reading the whole file when mapping is not supported.
+ * @return true if the log contents are available
+ */
+bool LogFile::mapLogData()
+{
+    logDataSize = file.size();
+    logData = file.map(0, logDataSize);
 
-    //Read all log timestamps into array
-    timestampBuffer.clear(); //Save beginning of log for later use
-    timestampPos.clear();
-    quint64 logFileStartIdx = file.pos();
-    timestampBufferIdx = 0;
-    lastTimeStamp = 0;
+    if (logData == NULL) {
+        qint64 pos = file.pos();
+        file.seek(0);
+        logDataFallback = file.readAll();
+        file.seek(pos);
 
-    while (!file.atEnd()){
-        qint64 dataSize;
+        logDataSize = logDataFallback.size();
+        logData = (const uchar *) logDataFallback.constData();
+    }
 
-        //Get time stamp position
-        timestampPos.append(file.pos());
+    return logData != NULL && logDataSize > 0;
+}
 
-        //Read timestamp and logfile packet size
-        file.read((char *) &lastTimeStamp, sizeof(lastTimeStamp));
-        file.read((char *) &dataSize, sizeof(dataSize));
+/**
+ * @brief LogFile::parsePacket finds the next valid packet header at or after
+ * pos, skipping over bytes which do not look like a packet header.
+ * @param[in] pos offset to start searching from
+ * @param[out] packetPos offset of the packet header
+ * @param[out] timeStamp timestamp of the packet
+ * @param[out] dataSize size of the packet payload
+ * @return true if a complete packet was found
+ */
+bool LogFile::parsePacket(qint64 pos, qint64 *packetPos, quint32 *timeStamp, qint64 *dataSize) const
+{
+    while (pos + (qint64) LOG_PACKET_HEADER_SIZE <= logDataSize) {
+        memcpy(timeStamp, logData + pos, sizeof(*timeStamp));
+        memcpy(dataSize, logData + pos + sizeof(*timeStamp), sizeof(*dataSize));
 
         //Check if dataSize sync bytes are correct.
         //TODO: LIKELY AS NOT, THIS WILL FAIL TO RESYNC BECAUSE THERE IS TOO LITTLE INFORMATION IN THE STRING OF SIX 0x00
-        if ((dataSize & 0xFFFFFFFFFFFF0000)!=0){
-            qDebug() << "Wrong sync byte. At file location 0x"  << QString("%1").arg(file.pos(),0,16) << "Got 0x" << QString("%1").arg(dataSize & 0xFFFFFFFFFFFF0000,0,16) << ", but expected 0x""00"".";
-            file.seek(timestampPos.last()+1);
-            timestampPos.pop_back();
+        if ((*dataSize & 0xFFFFFFFFFFFF0000) != 0) {
+            qDebug() << "Wrong sync byte. At file location 0x"  << QString("%1").arg(pos + LOG_PACKET_HEADER_SIZE,0,16) << "Got 0x" << QString("%1").arg(*dataSize & 0xFFFFFFFFFFFF0000,0,16) << ", but expected 0x""00"".";
+            pos++;
             continue;
         }
 
-        //Check if timestamps are sequential.
-        if (!timestampBuffer.isEmpty() && lastTimeStamp < timestampBuffer.last()){
-            QMessageBox msgBox;
-            msgBox.setText("Corrupted file.");
-            msgBox.setInformativeText("Timestamps are not sequential. Playback may have unexpected behavior"); //<--TODO: add hyperlink to webpage with better description.
-            msgBox.exec();
+        if (pos + (qint64) LOG_PACKET_HEADER_SIZE + *dataSize > logDataSize)
+            return false;
 
-            qDebug() << "Timestamp: " << timestampBuffer.last() << " " << lastTimeStamp;
+        *packetPos = pos;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief LogFile::extendIndex scans up to maxPackets further packets and
+ * records one index entry per LOG_INDEX_BLOCK packets. Once the end of the
+ * log is reached the index is cached next to the log file.
+ */
+void LogFile::extendIndex(int maxPackets)
+{
+    while (!indexComplete && maxPackets-- > 0) {
+        qint64 packetPos;
+        qint64 dataSize;
+        quint32 timeStamp;
+
+        if (!parsePacket(indexScanPos, &packetPos, &timeStamp, &dataSize)) {
+            indexComplete = true;
+            saveIndex();
+            break;
         }
 
-        timestampBuffer.append(lastTimeStamp);
+        //Check if timestamps are sequential.
+        if (indexPacketCount > 0 && timeStamp < indexLastTimestamp)
+            qDebug() << "Timestamps are not sequential. Playback may have unexpected behavior. Timestamp: " << indexLastTimestamp << " " << timeStamp;
+
+        if ((indexPacketCount % LOG_INDEX_BLOCK) == 0) {
+            IndexEntry entry;
+            entry.timestamp = timeStamp;
+            entry.offset = packetPos;
+            blockIndex.append(entry);
+        }
 
-        file.seek(timestampPos.last()+sizeof(lastTimeStamp)+sizeof(dataSize)+dataSize);
+        indexLastTimestamp = timeStamp;
+        indexPacketCount++;
+        indexScanPos = packetPos + LOG_PACKET_HEADER_SIZE + dataSize;
     }
+}
+
+QString LogFile::indexFileName() const
+{
+    return file.fileName() + ".idx";
+}
+
+/**
+ * @brief LogFile::loadIndex loads the cached index for this log, if there is
+ * one and it was built from the log as it currently is.
+ * @return true if the complete index was loaded
+ */
+bool LogFile::loadIndex()
+{
+    QFile indexFile(indexFileName());
+    if (!indexFile.open(QIODevice::ReadOnly))
+        return false;
+
+    QFileInfo logInfo(file);
+    QDataStream in(&indexFile);
+
+    quint32 magic, version, blockSize, count;
+    qint64 size, modified, dataStart;
+    in >> magic >> version >> size >> modified >> dataStart >> blockSize >> count;
+
+    if (in.status() != QDataStream::Ok || magic != LOG_INDEX_MAGIC ||
+            version != LOG_INDEX_VERSION || size != logDataSize ||
+            modified != logInfo.lastModified().toMSecsSinceEpoch() ||
+            dataStart != logDataStart || blockSize != LOG_INDEX_BLOCK || count == 0)
+        return false;
+
+    QVector<IndexEntry> entries(count);
+    for (quint32 i = 0; i < count; i++)
+        in >> entries[i].timestamp >> entries[i].offset;
+
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    blockIndex = entries;
+    indexComplete = true;
+    return true;
+}
+
+/**
+ * @brief LogFile::saveIndex caches the complete index next to the log so
+ * that reopening the log does not need to scan it again. Failure to write
+ * the cache (e.g. a read-only directory) is not an error.
+ */
+void LogFile::saveIndex() const
+{
+    if (blockIndex.isEmpty())
+        return;
+
+    QFile indexFile(indexFileName());
+    if (!indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return;
+
+    QFileInfo logInfo(file);
+    QDataStream out(&indexFile);
+
+    out << (quint32) LOG_INDEX_MAGIC << (quint32) LOG_INDEX_VERSION
+        << logDataSize << (qint64) logInfo.lastModified().toMSecsSinceEpoch()
+        << logDataStart << (quint32) LOG_INDEX_BLOCK << (quint32) blockIndex.size();
+
+    foreach (const IndexEntry &entry, blockIndex)
+        out << entry.timestamp << entry.offset;
+}
+
+bool LogFile::startReplay() {
+    dataBuffer.clear();
+    myTime.restart();
+    lastPlayTimeOffset = 0;
+    lastPlayTime = 0;
+    playbackSpeed = 1;
+
+    blockIndex.clear();
+    logDataStart = file.pos();
+    indexScanPos = logDataStart;
+    indexPacketCount = 0;
+    indexLastTimestamp = 0;
+    indexComplete = false;
+
+    if (!mapLogData()) {
+        QMessageBox msgBox;
+        msgBox.setText("Unable to read logfile.");
+        msgBox.setInformativeText(file.errorString());
+        msgBox.exec();
+
+        stopReplay();
+        return false;
+    }
+
+    // Use the cached index when there is one, otherwise index only the
+    // first block here and the rest progressively while playing
+    if (!loadIndex())
+        extendIndex(LOG_INDEX_BLOCK);
 
     //Check if any timestamps were successfully read
-    if (timestampBuffer.size() == 0){
+    if (blockIndex.size() == 0){
         QMessageBox msgBox;
         msgBox.setText("Empty logfile.");
         msgBox.setInformativeText("No log data can be found.");
@@ -291,11 +451,9 @@ bool LogFile::startReplay() {
     }
 
     //Reset to log beginning.
-    file.seek(logFileStartIdx+sizeof(lastTimeStamp));
-    lastTimeStampPos = timestampPos[0];
-    lastTimeStamp = timestampBuffer[0];
-    firstTimestamp = timestampBuffer[0];
-    timestampBufferIdx = 1;
+    lastTimeStampPos = blockIndex[0].offset;
+    lastTimeStamp = blockIndex[0].timestamp;
+    firstTimestamp = blockIndex[0].timestamp;
 
     timer.setInterval(10);
     timer.start();
@@ -322,21 +480,44 @@ void LogFile::resumeReplay()
 
 /**
  * @brief LogFile::setReplayTime, sets the playback time
- * @param val, the time in
+ * @param val, the time in seconds
  */
 void LogFile::setReplayTime(double val)
 {
-    quint32 tmpIdx=0;
-    while(timestampBuffer[tmpIdx++] <= val*1000 && tmpIdx <= timestampBufferIdx){
+    if (blockIndex.isEmpty())
+        return;
+
+    quint32 target = val * 1000;
+
+    // Make sure the index covers the requested time
+    while (!indexComplete && indexLastTimestamp <= target)
+        extendIndex(LOG_INDEX_PACKETS_PER_TICK);
+
+    // Binary search for the last block starting at or before the target...
+    QVector<IndexEntry>::const_iterator block = std::upper_bound(
+                blockIndex.constBegin(), blockIndex.constEnd(), target,
+                [](quint32 t, const IndexEntry &entry) { return t < entry.timestamp; });
+    if (block != blockIndex.constBegin())
+        block--;
+
+    // ...then walk that block for the first packet after the target
+    qint64 pos = block->offset;
+    qint64 packetPos;
+    qint64 dataSize;
+    quint32 timeStamp;
+    while (parsePacket(pos, &packetPos, &timeStamp, &dataSize) && timeStamp <= target)
+        pos = packetPos + LOG_PACKET_HEADER_SIZE + dataSize;
+
+    if (!parsePacket(pos, &packetPos, &timeStamp, &dataSize)) {
+        stopReplay();
+        return;
     }
 
-    lastTimeStampPos=timestampPos[tmpIdx];
-    lastTimeStamp=timestampBuffer[tmpIdx];
-    timestampBufferIdx=tmpIdx;
+    lastTimeStampPos = packetPos;
+    lastTimeStamp = timeStamp;
 
     lastPlayTimeOffset = myTime.elapsed();
-    lastPlayTime=lastTimeStamp;
+    lastPlayTime = lastTimeStamp - firstTimestamp;
 
     qDebug() << "Replaying at: " << lastTimeStamp << ", but requestion at" << val*1000;
 }
-
@@ -34,6 +34,7 @@
 #include <QMutexLocker>
 #include <QDebug>
 #include <QBuffer>
+#include <QVector>
 #include "uavobjectmanager.h"
 #include <math.h>
 
@@ -81,10 +82,36 @@ protected:
     double playbackSpeed;
 
 private:
-    QList<quint32> timestampBuffer;
-    QList<quint32> timestampPos;
-    quint32 timestampBufferIdx;
-    quint32 lastTimeStampPos;
+    //! One entry of the sparse replay index, recorded every LOG_INDEX_BLOCK packets
+    struct IndexEntry {
+        quint32 timestamp;
+        qint64 offset;
+    };
+
+    bool mapLogData();
+    bool parsePacket(qint64 pos, qint64 *packetPos, quint32 *timeStamp, qint64 *dataSize) const;
+    void extendIndex(int maxPackets);
+    QString indexFileName() const;
+    bool loadIndex();
+    void saveIndex() const;
+
+    //! Memory-mapped (or, failing that, fully read) log contents
+    const uchar *logData;
+    qint64 logDataSize;
+    QByteArray logDataFallback;
+
+    //! Offset of the first packet after the header
+    qint64 logDataStart;
+
+    //! Sparse timestamp -> offset index, extended lazily during playback
+    QVector<IndexEntry> blockIndex;
+    qint64 indexScanPos;
+    quint32 indexPacketCount;
+    quint32 indexLastTimestamp;
+    bool indexComplete;
+
+    //! Offset of the next packet to be replayed
+    qint64 lastTimeStampPos;
     quint32 firstTimestamp;
 };
 
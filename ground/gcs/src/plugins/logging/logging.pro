@@ -1,7 +1,7 @@
 TEMPLATE = lib
 TARGET = LoggingGadget
 DEFINES += LOGGING_LIBRARY
-QT += svg
+QT += svg concurrent
 include(../../gcsplugin.pri)
 include(logging_dependencies.pri)
 HEADERS += loggingplugin.h \
@@ -10,7 +10,8 @@ HEADERS += loggingplugin.h \
     logginggadget.h \
     logginggadgetfactory.h \
     loggingdevice.h \
-    flightlogdownload.h
+    flightlogdownload.h \
+    logcolumnexport.h
 #    logginggadgetconfiguration.h
 #   logginggadgetoptionspage.h
 
@@ -20,7 +21,8 @@ SOURCES += loggingplugin.cpp \
     logginggadget.cpp \
     logginggadgetfactory.cpp \
     loggingdevice.cpp \
-    flightlogdownload.cpp
+    flightlogdownload.cpp \
+    logcolumnexport.cpp
 #    logginggadgetconfiguration.cpp \
 #    logginggadgetoptionspage.cpp
 OTHER_FILES += LoggingGadget.pluginspec \
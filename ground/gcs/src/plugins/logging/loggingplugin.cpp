@@ -32,6 +32,7 @@
 #include "loggingdevice.h"
 #include "logginggadgetfactory.h"
 #include "flightlogdownload.h"
+#include "logcolumnexport.h"
 
 #include <QDebug>
 #include <QtPlugin>
@@ -41,7 +42,11 @@
 #include <QFileDialog>
 #include <QList>
 #include <QErrorMessage>
+#include <QMessageBox>
+#include <QTimer>
+#include <QApplication>
 #include <QWriteLocker>
+#include <QProgressDialog>
 
 #include <extensionsystem/pluginmanager.h>
 #include <QKeySequence>
@@ -311,7 +316,11 @@ void LoggingThread::transactionCompleted(UAVObject* obj, bool success)
  ********************************/
 
 
-LoggingPlugin::LoggingPlugin() : state(IDLE)
+LoggingPlugin::LoggingPlugin() :
+    state(IDLE),
+    columnExport(NULL),
+    columnExportWatcher(NULL),
+    columnExportProgress(NULL)
 {
     logConnection = new LoggingConnection();
 }
@@ -330,11 +339,16 @@ LoggingPlugin::~LoggingPlugin()
   */
 bool LoggingPlugin::initialize(const QStringList& args, QString *errMsg)
 {
-    Q_UNUSED(args);
     Q_UNUSED(errMsg);
 
     loggingThread = NULL;
 
+    // -p exportcolumns=<logfile>, possibly repeated
+    for (int i = 0; i + 1 < args.length(); i++) {
+        if (args.at(i) == "exportcolumns")
+            exportOnStartup.append(args.at(++i));
+    }
+
 
     // Add Menu entry
     Core::ActionManager* am = Core::ICore::instance()->actionManager();
@@ -364,6 +378,15 @@ bool LoggingPlugin::initialize(const QStringList& args, QString *errMsg)
     ac->addAction(cmdDownload, "Logging");
     connect(cmdDownload->action(), SIGNAL(triggered(bool)), this, SLOT(downloadLog()));
 
+    // Command to export logs to columnar tables
+    cmdExportColumns = am->registerAction(new QAction(this),
+                                            "LoggingPlugin.ExportColumns",
+                                            QList<int>() <<
+                                            Core::Constants::C_GLOBAL_ID);
+    cmdExportColumns->action()->setText("Export logfiles to columnar tables...");
+    ac->addAction(cmdExportColumns, "Logging");
+    connect(cmdExportColumns->action(), SIGNAL(triggered(bool)), this, SLOT(exportColumns()));
+
 
     mf = new LoggingGadgetFactory(this);
     addAutoReleasedObject(mf);
@@ -381,6 +404,67 @@ void LoggingPlugin::downloadLog()
     download.exec();
 }
 
+/**
+  * Export the selected logfiles to per-object columnar tables,
+  * see @ref LogColumnExport. The export runs in the background, with
+  * a progress dialog, and exportColumnsFinished() reports the result.
+  */
+void LoggingPlugin::exportColumns()
+{
+    if (columnExport != NULL)
+        return;
+
+    QStringList fileNames = QFileDialog::getOpenFileNames(NULL, tr("Export logfiles"),
+                                    QDir::homePath(), tr("dRonin Log Files (*.drlog)"));
+    if (fileNames.isEmpty())
+        return;
+
+    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+    UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
+
+    columnExport = new LogColumnExport(objManager);
+    columnExportDir = LogColumnExport::outputDirName(fileNames.first());
+
+    columnExportProgress = new QProgressDialog(tr("Exporting logfiles..."), tr("Cancel"),
+                                               0, fileNames.size());
+    columnExportProgress->setWindowModality(Qt::ApplicationModal);
+    columnExportProgress->setMinimumDuration(0);
+
+    columnExportWatcher = new QFutureWatcher<QString>(this);
+    connect(columnExportWatcher, SIGNAL(progressValueChanged(int)),
+            columnExportProgress, SLOT(setValue(int)));
+    connect(columnExportProgress, SIGNAL(canceled()), columnExportWatcher, SLOT(cancel()));
+    connect(columnExportWatcher, SIGNAL(finished()), this, SLOT(exportColumnsFinished()));
+
+    columnExportWatcher->setFuture(columnExport->startExport(fileNames));
+}
+
+/**
+  * Report the result of the export started by exportColumns()
+  */
+void LoggingPlugin::exportColumnsFinished()
+{
+    bool canceled = columnExportWatcher->isCanceled();
+    QStringList errors = columnExportWatcher->future().results();
+    errors.removeAll(QString());
+
+    columnExportProgress->deleteLater();
+    columnExportProgress = NULL;
+    columnExportWatcher->deleteLater();
+    columnExportWatcher = NULL;
+    delete columnExport;
+    columnExport = NULL;
+
+    if (!errors.isEmpty())
+        QMessageBox::critical(NULL, tr("Export failed"), errors.join("\n"));
+    else if (canceled)
+        QMessageBox::information(NULL, tr("Export canceled"),
+                                 tr("Logfiles exported before canceling were written to %1").arg(columnExportDir));
+    else
+        QMessageBox::information(NULL, tr("Export complete"),
+                                 tr("Tables were written to %1").arg(columnExportDir));
+}
+
 /**
   * The action that is triggered by the menu item which opens the
   * file and begins logging if successful
@@ -480,10 +564,36 @@ void LoggingPlugin::replayStarted()
 void LoggingPlugin::extensionsInitialized()
 {
     addAutoReleasedObject(logConnection);
+
+    // Command line export: convert the logs, then quit
+    if (!exportOnStartup.isEmpty()) {
+        ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+        UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
+
+        QStringList errors = LogColumnExport(objManager).exportLogs(exportOnStartup);
+        foreach (const QString &error, errors)
+            qDebug() << "Logging: export failed:" << error;
+
+        QTimer::singleShot(0, qApp, SLOT(quit()));
+    }
 }
 
 void LoggingPlugin::shutdown()
 {
+    // The exporter has to outlive its worker threads
+    if (columnExportWatcher != NULL) {
+        disconnect(columnExportWatcher, 0, this, 0);
+        columnExportWatcher->cancel();
+        columnExportWatcher->waitForFinished();
+
+        delete columnExportWatcher;
+        columnExportWatcher = NULL;
+        delete columnExportProgress;
+        columnExportProgress = NULL;
+        delete columnExport;
+        columnExport = NULL;
+    }
+
     if (state == LOGGING) {
         stopLogging();
 
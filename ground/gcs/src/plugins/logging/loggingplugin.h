@@ -41,9 +41,12 @@
 #include <QThread>
 #include <QQueue>
 #include <QReadWriteLock>
+#include <QFutureWatcher>
 
 class LoggingPlugin;
 class LoggingGadgetFactory;
+class LogColumnExport;
+class QProgressDialog;
 
 /**
 *   Define a connection via the IConnection interface
@@ -144,6 +147,8 @@ protected:
 
 private slots:
     void downloadLog();
+    void exportColumns();
+    void exportColumnsFinished();
     void toggleLogging();
     void startLogging(QString file);
     void stopLogging();
@@ -155,6 +160,16 @@ private:
     LoggingGadgetFactory *mf;
     Core::Command* cmdLogging;
     Core::Command* cmdDownload;
+    Core::Command* cmdExportColumns;
+
+    //! Logs given on the command line to export before quitting
+    QStringList exportOnStartup;
+
+    //! The export started from the menu, while it runs
+    LogColumnExport *columnExport;
+    QFutureWatcher<QString> *columnExportWatcher;
+    QProgressDialog *columnExportProgress;
+    QString columnExportDir;
 
 };
 #endif /* LoggingPLUGIN_H_ */
@@ -41,9 +41,11 @@
  * @param p_uavFieldName The plotted UAVO field name
  */
 Plot2dData::Plot2dData(QString p_uavObject, QString p_uavFieldName):
-    yDataHistory(0),
     dataUpdated(false)
 {
+    fieldResolved = false;
+    fieldIndex = -1;
+    subFieldIndex = 0;
     uavObjectName = p_uavObject;
 
     if(p_uavFieldName.contains("-")) //For fields with multiple indices, '-' followed by an index indicates which one
@@ -61,13 +63,9 @@ Plot2dData::Plot2dData(QString p_uavObject, QString p_uavFieldName):
 
     xData = new QVector<double>();
     yData = new QVector<double>();
-    yDataHistory = new QVector<double>();
 
     scalePower = 0;
     meanSamples = 1;
-    meanSum = 0.0f;
-    correctionSum = 0.0f;
-    correctionCount = 0;
     yMinimum = 0;
     yMaximum = 120;
 
@@ -83,6 +81,9 @@ Plot2dData::Plot2dData(QString p_uavObject, QString p_uavFieldName):
 Plot3dData::Plot3dData(QString p_uavObject, QString p_uavFieldName):
     dataUpdated(false)
 {
+    fieldResolved = false;
+    fieldIndex = -1;
+    subFieldIndex = 0;
     uavObjectName = p_uavObject;
 
     if(p_uavFieldName.contains("-")) //For fields with multiple indices, '-' followed by an index indicates which one
@@ -106,9 +107,6 @@ Plot3dData::Plot3dData(QString p_uavObject, QString p_uavFieldName):
 
     scalePower = 0;
     meanSamples = 1;
-    meanSum = 0.0f;
-    correctionSum = 0.0f;
-    correctionCount = 0;
     xMinimum = 0;
     xMaximum = 16;
     yMinimum = 0;
@@ -124,8 +122,6 @@ Plot2dData::~Plot2dData()
         delete xData;
     if (yData != NULL)
         delete yData;
-    if (yDataHistory != NULL)
-        delete yDataHistory;
 }
 
 
@@ -145,23 +141,36 @@ Plot3dData::~Plot3dData()
 
 
 /**
- * @brief valueAsDouble Fetch the value from the UAVO and return it as a double
+ * @brief getPlottedField Get the plotted field of a UAVO instance. The field
+ * and element are looked up by name once, after which updates are served by
+ * index.
  * @param obj UAVO
- * @param field UAVO field
- * @param haveSubField TRUE if UAVO has subfield. FALSE if not.
- * @param uavSubFieldName UAVO subfield, if it exists
- * @return
+ * @return the field, or NULL if the UAVO has no such field
  */
-double PlotData::valueAsDouble(UAVObject* obj, UAVObjectField* field, bool haveSubField, QString uavSubFieldName)
+UAVObjectField* PlotData::getPlottedField(UAVObject* obj)
 {
-    Q_UNUSED(obj);
-    QVariant value;
+    if (!fieldResolved) {
+        fieldResolved = true;
+        fieldIndex = obj->getFieldIndex(uavFieldName);
+        subFieldIndex = 0;
+
+        UAVObjectField* field = obj->getFieldByIndex(fieldIndex);
+        if (field && haveSubField) {
+            int index = field->getElementNames().indexOf(uavSubFieldName);
+            subFieldIndex = index < 0 ? field->getNumElements() : index;
+        }
+    }
+
+    return obj->getFieldByIndex(fieldIndex);
+}
 
-    if(haveSubField){
-        int indexOfSubField = field->getElementNames().indexOf(QRegExp(uavSubFieldName, Qt::CaseSensitive, QRegExp::FixedString));
-        value = field->getValue(indexOfSubField);
-    }else
-        value = field->getValue();
 
-    return value.toDouble();
+/**
+ * @brief valueAsDouble Fetch the plotted element from the field and return it as a double
+ * @param field UAVO field, as returned by getPlottedField()
+ * @return
+ */
+double PlotData::valueAsDouble(UAVObjectField* field)
+{
+    return field->getDouble(subFieldIndex);
 }
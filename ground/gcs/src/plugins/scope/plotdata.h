@@ -46,7 +46,8 @@ class PlotData : public QObject
 {
     Q_OBJECT
 public:
-    double valueAsDouble(UAVObject* obj, UAVObjectField* field, bool haveSubField, QString uavSubFieldName);
+    UAVObjectField* getPlottedField(UAVObject* obj);
+    double valueAsDouble(UAVObjectField* field);
 
     //Setter functions
     void setXMinimum(double val){xMinimum=val;}
@@ -102,13 +103,14 @@ protected:
     QString uavSubFieldName;
     bool haveSubField;
 
+    // Resolved from the names above on the first update
+    bool fieldResolved;
+    int fieldIndex;
+    quint32 subFieldIndex;
+
     int scalePower; //This is the power to which each value must be raised
     unsigned int meanSamples;
     QString mathFunction;
-    double meanSum;
-
-    double correctionSum;
-    int correctionCount;
 
 private:
 
@@ -1,5 +1,5 @@
 TEMPLATE = lib
-QT+=widgets
+QT+=widgets testlib
 TARGET = ScopeGadget
 DEFINES += SCOPE_LIBRARY
 DEFINES += QWT_DLL
@@ -14,6 +14,7 @@ HEADERS += scopeplugin.h \
     scopes3d/spectrogramplotdata.h \
     scopes3d/spectrogramscopeconfig.h \
     scopes2d/plotdata2d.h \
+    scopes2d/plotringbuffer.h \
     scopes2d/scopes2dconfig.h \
     scopes3d/plotdata3d.h \
     scopes3d/scopes3dconfig.h \
@@ -30,6 +31,7 @@ SOURCES += scopeplugin.cpp \
     scopes2d/histogramscopeconfig.cpp \
     scopes2d/scatterplotdata.cpp \
     scopes2d/scatterplotscopeconfig.cpp \
+    scopes2d/plotringbuffer.cpp \
     scopes3d/spectrogramplotdata.cpp \
     scopes3d/spectrogramscopeconfig.cpp \
     plotdata.cpp
@@ -27,11 +27,21 @@
 
 #include "scopeplugin.h"
 #include "scopegadgetfactory.h"
+#include "scopegadgetwidget.h"
+#include "scopes2d/scatterplotscopeconfig.h"
+#include "uavobjectmanager.h"
+#include "uavdataobject.h"
 #include <QDebug>
 #include <QtPlugin>
 #include <QStringList>
+#include <QTest>
+#include <QScopedPointer>
+#include <math.h>
 #include <extensionsystem/pluginmanager.h>
 
+//! One second of telemetry at the fastest sensor rates
+#define SYNTHETIC_UPDATES 1000
+
 
 ScopePlugin::ScopePlugin()
 {
@@ -63,3 +73,73 @@ void ScopePlugin::shutdown()
 {
     // Do nothing
 }
+
+/**
+ * One second of synthetic 1 kHz ActuatorCommand telemetry, unpacked into the
+ * object and taken from there by a scope plotting each channel, as when it
+ * arrives over the link
+ * @param plotType the Scatterplot2dScopeConfig::Scatterplot2dType to plot with
+ */
+void ScopePlugin::benchmarkPlotUpdate(int plotType)
+{
+    UAVObjectManager *objMngr = ExtensionSystem::PluginManager::instance()->getObject<UAVObjectManager>();
+    UAVDataObject *obj = dynamic_cast<UAVDataObject *>(objMngr->getObject("ActuatorCommand"));
+    QVERIFY(obj);
+
+    // Each channel sweeps at its own rate, packed from a copy so no one sees it
+    QScopedPointer<UAVDataObject> source(obj->dirtyClone());
+    UAVObjectField *channel = source->getField("Channel");
+    QVector<QByteArray> telemetry(SYNTHETIC_UPDATES);
+
+    for (int i = 0; i < telemetry.size(); i++) {
+        for (quint32 j = 0; j < channel->getNumElements(); j++)
+            channel->setDouble(1500 + 500 * sin(i * 0.001 * (j + 1)), j);
+
+        telemetry[i] = QByteArray(source->getNumBytes(), 0);
+        source->pack((quint8 *) telemetry[i].data());
+    }
+
+    QScopedPointer<Scatterplot2dScopeConfig> scope(new Scatterplot2dScopeConfig());
+    scope->setScatterplot2dType((Scatterplot2dScopeConfig::Scatterplot2dType) plotType);
+    scope->setTimeHorizon(plotType == Scatterplot2dScopeConfig::SERIES2D ? SYNTHETIC_UPDATES : 60);
+
+    QList<Plot2dCurveConfiguration *> curves;
+    foreach (const QString &element, channel->getElementNames()) {
+        Plot2dCurveConfiguration *curve = new Plot2dCurveConfiguration();
+        curve->uavObjectName = obj->getName();
+        curve->uavFieldName = channel->getName() + "-" + element;
+        curve->yScalePower = 0;
+        curve->color = qRgb(0, 0, 0);
+        curve->yMeanSamples = 1;
+        curve->mathFunction = "None";
+
+        scope->addScatterplotDataSource(curve);
+        curves.append(curve);
+    }
+
+    QScopedPointer<ScopeGadgetWidget> widget(new ScopeGadgetWidget());
+    scope->loadConfiguration(widget.data());
+    QCOMPARE(widget->getDataSources().size(), curves.size());
+
+    QBENCHMARK {
+        foreach (const QByteArray &packet, telemetry)
+            obj->unpack((const quint8 *) packet.constData());
+    }
+
+    // The last update reached every curve
+    foreach (PlotData *plotData, widget->getDataSources().values())
+        QVERIFY(plotData->readAndResetUpdatedFlag());
+
+    widget.reset();
+    qDeleteAll(curves);
+}
+
+void ScopePlugin::testSeriesPlotUpdate()
+{
+    benchmarkPlotUpdate(Scatterplot2dScopeConfig::SERIES2D);
+}
+
+void ScopePlugin::testTimeSeriesPlotUpdate()
+{
+    benchmarkPlotUpdate(Scatterplot2dScopeConfig::TIMESERIES2D);
+}
@@ -47,6 +47,11 @@ public:
 private:
     ScopeGadgetFactory *mf;
 
+    void benchmarkPlotUpdate(int plotType);
+
+private slots:
+    void testSeriesPlotUpdate();
+    void testTimeSeriesPlotUpdate();
 
 };
 #endif /* SCOPEPLUGIN_H_ */
@@ -99,7 +99,7 @@ bool HistogramData::append(UAVObject* obj)
     if (uavObjectName == obj->getName()) {
 
         //Get the field of interest
-        UAVObjectField* field =  obj->getField(uavFieldName);
+        UAVObjectField* field =  getPlottedField(obj);
 
         //Bad place to do this
         double step = binWidth;
@@ -110,7 +110,7 @@ bool HistogramData::append(UAVObject* obj)
             numberOfBins = MAX_NUMBER_OF_INTERVALS;
 
         if (field) {
-            double currentValue = valueAsDouble(obj, field, haveSubField, uavSubFieldName) * pow(10, scalePower);
+            double currentValue = valueAsDouble(field) * pow(10, scalePower);
 
             // Extend interval, if necessary
             if(!histogramInterval->empty()){
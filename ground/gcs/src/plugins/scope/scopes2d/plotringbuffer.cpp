@@ -0,0 +1,275 @@
+/**
+ ******************************************************************************
+ *
+ * @file       plotringbuffer.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup ScopePlugin Scope Gadget Plugin
+ * @{
+ * @brief Sample storage and statistics for the 2D scatter plots
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "scopes2d/plotringbuffer.h"
+
+//! Smallest allocation made for a ring buffer
+#define MIN_RING_CAPACITY 256
+
+
+/**
+ * @brief PlotRingBuffer::append Append a sample, growing the buffer if it is full
+ * @param sample
+ */
+void PlotRingBuffer::append(const QPointF &sample)
+{
+    if (count == buffer.size()) {
+        QVector<QPointF> grown(qMax(MIN_RING_CAPACITY, 2 * buffer.size()));
+        for (int i = 0; i < count; i++)
+            grown[i] = at(i);
+
+        buffer.swap(grown);
+        head = 0;
+    }
+
+    buffer[(head + count) % buffer.size()] = sample;
+    count++;
+}
+
+
+/**
+ * @brief PlotRingBuffer::removeFirst Remove the oldest sample
+ */
+void PlotRingBuffer::removeFirst()
+{
+    if (count == 0)
+        return;
+
+    head = (head + 1) % buffer.size();
+    count--;
+}
+
+
+/**
+ * @brief RingBufferSeriesData::RingBufferSeriesData
+ * @param samples The buffer to present. It must outlive this object.
+ * @param indexAsX TRUE to plot samples against their position in the buffer
+ */
+RingBufferSeriesData::RingBufferSeriesData(const PlotRingBuffer *samples, bool indexAsX) :
+    samples(samples),
+    indexAsX(indexAsX),
+    decimated(false)
+{
+}
+
+
+/**
+ * @brief RingBufferSeriesData::update Refresh the bounding rectangle, and the
+ * decimated samples if there are more samples than pixels. Called once per
+ * replot rather than once per sample.
+ * @param pixels Width of the plot canvas
+ */
+void RingBufferSeriesData::update(int pixels)
+{
+    int n = samples->size();
+
+    indices.resize(0);
+    decimated = pixels > 0 && n > 2 * pixels;
+
+    if (n == 0) {
+        d_boundingRect = QRectF(0.0, 0.0, -1.0, -1.0);
+        return;
+    }
+
+    QPointF p = point(0);
+    double minX = p.x(), maxX = p.x();
+    double minY = p.y(), maxY = p.y();
+
+    if (!decimated) {
+        for (int i = 1; i < n; i++) {
+            p = point(i);
+            minX = qMin(minX, p.x());
+            maxX = qMax(maxX, p.x());
+            minY = qMin(minY, p.y());
+            maxY = qMax(maxY, p.y());
+        }
+    } else {
+        // Keep the extremes of each pixel column, in the order they occurred
+        for (int column = 0; column < pixels; column++) {
+            int start = (qint64) n * column / pixels;
+            int end = (qint64) n * (column + 1) / pixels;
+
+            int lowest = start, highest = start;
+            for (int i = start + 1; i < end; i++) {
+                double y = samples->at(i).y();
+                if (y < samples->at(lowest).y())
+                    lowest = i;
+                if (y > samples->at(highest).y())
+                    highest = i;
+            }
+
+            indices.append(qMin(lowest, highest));
+            if (lowest != highest)
+                indices.append(qMax(lowest, highest));
+
+            minY = qMin(minY, samples->at(lowest).y());
+            maxY = qMax(maxY, samples->at(highest).y());
+        }
+
+        minX = qMin(point(0).x(), point(n - 1).x());
+        maxX = qMax(point(0).x(), point(n - 1).x());
+    }
+
+    d_boundingRect = QRectF(minX, minY, maxX - minX, maxY - minY);
+}
+
+
+size_t RingBufferSeriesData::size() const
+{
+    if (samples->isEmpty())
+        return 0;
+
+    return decimated ? indices.size() : samples->size();
+}
+
+
+QPointF RingBufferSeriesData::sample(size_t i) const
+{
+    int index = decimated ? indices[i] : (int) i;
+
+    // Samples may have been dropped since the last update()
+    return point(qMin(index, samples->size() - 1));
+}
+
+
+QRectF RingBufferSeriesData::boundingRect() const
+{
+    return d_boundingRect;
+}
+
+
+QPointF RingBufferSeriesData::point(int i) const
+{
+    QPointF p = samples->at(i);
+    if (indexAsX)
+        p.setX(i);
+
+    return p;
+}
+
+
+/**
+ * @brief SlidingWindowStats::setWindowSize Set the number of values the
+ * statistics are taken over. Changing it discards the values seen so far.
+ * @param size
+ */
+void SlidingWindowStats::setWindowSize(unsigned int size)
+{
+    if (size == windowSize)
+        return;
+
+    windowSize = size;
+    history.resize(qMax(size, 1u));
+    clear();
+}
+
+
+void SlidingWindowStats::clear()
+{
+    head = 0;
+    count = 0;
+    runningMean = 0;
+    m2 = 0;
+    sinceRecompute = 0;
+}
+
+
+/**
+ * @brief SlidingWindowStats::append Add a value, dropping the oldest one once
+ * the window is full
+ * @param value
+ */
+void SlidingWindowStats::append(double value)
+{
+    int capacity = history.size();
+
+    if (capacity == 0)
+        setWindowSize(1);
+
+    capacity = history.size();
+
+    if (count < capacity) {
+        history[(head + count) % capacity] = value;
+        count++;
+
+        double delta = value - runningMean;
+        runningMean += delta / count;
+        m2 += delta * (value - runningMean);
+    } else {
+        double oldest = history[head];
+        double oldMean = runningMean;
+
+        history[head] = value;
+        head = (head + 1) % capacity;
+
+        runningMean += (value - oldest) / count;
+        m2 += (value - oldest) * (value - runningMean + oldest - oldMean);
+    }
+
+    // Rounding errors accumulate as values enter and leave the window, so
+    // resum once per window length, which keeps the cost O(1) per value
+    if (++sinceRecompute >= (unsigned int) capacity)
+        recompute();
+}
+
+
+/**
+ * @brief SlidingWindowStats::variance
+ * @return the sample variance (with Bessel's correction) of the window
+ */
+double SlidingWindowStats::variance() const
+{
+    if (count < 2)
+        return 0;
+
+    return qMax(0.0, m2 / (count - 1));
+}
+
+
+void SlidingWindowStats::recompute()
+{
+    int capacity = history.size();
+
+    double sum = 0;
+    for (int i = 0; i < count; i++)
+        sum += history[(head + i) % capacity];
+    runningMean = sum / count;
+
+    double squares = 0;
+    for (int i = 0; i < count; i++) {
+        double delta = history[(head + i) % capacity] - runningMean;
+        squares += delta * delta;
+    }
+    m2 = squares;
+
+    sinceRecompute = 0;
+}
+
+/**
+ * @}
+ * @}
+ */
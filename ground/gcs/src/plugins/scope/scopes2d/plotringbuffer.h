@@ -0,0 +1,123 @@
+/**
+ ******************************************************************************
+ *
+ * @file       plotringbuffer.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup ScopePlugin Scope Gadget Plugin
+ * @{
+ * @brief Sample storage and statistics for the 2D scatter plots
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PLOTRINGBUFFER_H
+#define PLOTRINGBUFFER_H
+
+#include "qwt/src/qwt_series_data.h"
+
+#include <QPointF>
+#include <QVector>
+
+
+/**
+ * @brief The PlotRingBuffer class Circular buffer of plot samples. Removing
+ * the oldest sample is O(1), and the storage is only reallocated when the
+ * buffer outgrows it, so a plot at steady state does not allocate.
+ */
+class PlotRingBuffer
+{
+public:
+    PlotRingBuffer() : head(0), count(0) {}
+
+    void append(const QPointF &sample);
+    void removeFirst();
+    void clear() {head = 0; count = 0;}
+
+    int size() const {return count;}
+    bool isEmpty() const {return count == 0;}
+
+    //! Sample i, counting from the oldest
+    const QPointF &at(int i) const {return buffer[(head + i) % buffer.size()];}
+    const QPointF &first() const {return at(0);}
+    const QPointF &last() const {return at(count - 1);}
+
+private:
+    QVector<QPointF> buffer;
+    int head;
+    int count;
+};
+
+
+/**
+ * @brief The RingBufferSeriesData class Presents a PlotRingBuffer to a
+ * QwtPlotCurve without copying it. When there are more samples than the
+ * curve has pixels, each pixel's worth of samples is reduced to its minimum
+ * and maximum, which draws the same envelope from far fewer points.
+ */
+class RingBufferSeriesData : public QwtSeriesData<QPointF>
+{
+public:
+    RingBufferSeriesData(const PlotRingBuffer *samples, bool indexAsX);
+
+    void update(int pixels);
+
+    virtual size_t size() const;
+    virtual QPointF sample(size_t i) const;
+    virtual QRectF boundingRect() const;
+
+private:
+    QPointF point(int i) const;
+
+    const PlotRingBuffer *samples;
+    bool indexAsX;              //!< Plot samples against their position rather than their x
+    bool decimated;
+    QVector<int> indices;       //!< Samples kept when decimated
+};
+
+
+/**
+ * @brief The SlidingWindowStats class Mean and variance of the last N values,
+ * updated in O(1) per value with Welford's method.
+ */
+class SlidingWindowStats
+{
+public:
+    SlidingWindowStats() : windowSize(0) {clear();}
+
+    void setWindowSize(unsigned int size);
+    unsigned int getWindowSize() const {return windowSize;}
+
+    void append(double value);
+    void clear();
+
+    double mean() const {return runningMean;}
+    double variance() const;
+
+private:
+    void recompute();
+
+    unsigned int windowSize;
+    QVector<double> history;
+    int head;
+    int count;
+    double runningMean;
+    double m2;                  //!< Sum of squared differences from the mean
+    unsigned int sinceRecompute;
+};
+
+#endif // PLOTRINGBUFFER_H
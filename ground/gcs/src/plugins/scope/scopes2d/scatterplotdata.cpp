@@ -47,11 +47,10 @@ void TimeSeriesPlotData::plotNewData(PlotData *plot2dData, ScopeConfig *scopeCon
 {
     Q_UNUSED(plot2dData);
     Q_UNUSED(scopeConfig);
-    Q_UNUSED(scopeGadgetWidget);
 
     //Plot new data
     if (readAndResetUpdatedFlag() == true)
-        curve->setSamples(*xData, *yData);
+        updateCurve(scopeGadgetWidget);
 
     QDateTime NOW = QDateTime::currentDateTime();
     double toTime = NOW.toTime_t();
@@ -69,11 +68,10 @@ void SeriesPlotData::plotNewData(PlotData *plot2dData, ScopeConfig *scopeConfig,
 {
     Q_UNUSED(plot2dData);
     Q_UNUSED(scopeConfig);
-    Q_UNUSED(scopeGadgetWidget);
 
     //Plot new data
     if (readAndResetUpdatedFlag() == true)
-        curve->setSamples(*xData, *yData);
+        updateCurve(scopeGadgetWidget);
 }
 
 
@@ -87,55 +85,17 @@ bool SeriesPlotData::append(UAVObject* obj)
     if (uavObjectName == obj->getName()) {
 
         //Get the field of interest
-        UAVObjectField* field =  obj->getField(uavFieldName);
+        UAVObjectField* field =  getPlottedField(obj);
 
         if (field) {
 
-            double currentValue = valueAsDouble(obj, field, haveSubField, uavSubFieldName) * pow(10, scalePower);
-
-            //Perform scope math, if necessary
-            if (mathFunction  == "Boxcar average" || mathFunction  == "Standard deviation"){
-                //Put the new value at the front
-                yDataHistory->append( currentValue );
-
-                // calculate average value
-                meanSum += currentValue;
-                if(yDataHistory->size() > (int)meanSamples) {
-                    meanSum -= yDataHistory->first();
-                    yDataHistory->pop_front();
-                }
-
-                // make sure to correct the sum every meanSamples steps to prevent it
-                // from running away due to floating point rounding errors
-                correctionSum+=currentValue;
-                if (++correctionCount >= (int)meanSamples) {
-                    meanSum = correctionSum;
-                    correctionSum = 0.0f;
-                    correctionCount = 0;
-                }
-
-                double boxcarAvg=meanSum/yDataHistory->size();
-
-                if ( mathFunction  == "Standard deviation" ){
-                    //Calculate square of sample standard deviation, with Bessel's correction
-                    double stdSum=0;
-                    for (int i=0; i < yDataHistory->size(); i++){
-                        stdSum+= pow(yDataHistory->at(i)- boxcarAvg,2)/(meanSamples-1);
-                    }
-                    yData->append(sqrt(stdSum));
-                }
-                else  {
-                    yData->append(boxcarAvg);
-                }
-            }
-            else{
-                yData->append( currentValue );
-            }
-
-            if (yData->size() > getXWindowSize()) { //If new data overflows the window, remove old data...
-                yData->pop_front();
-            } else //...otherwise, add a new y point at position xData
-                xData->insert(xData->size(), xData->size());
+            double currentValue = valueAsDouble(field) * pow(10, scalePower);
+
+            //Samples are plotted against their position, so only y is kept
+            samples.append(QPointF(0, applyMathFunction(currentValue)));
+
+            if (samples.size() > getXWindowSize()) //If new data overflows the window, remove old data
+                samples.removeFirst();
 
             return true;
         }
@@ -154,52 +114,14 @@ bool TimeSeriesPlotData::append(UAVObject* obj)
 {
     if (uavObjectName == obj->getName()) {
         //Get the field of interest
-        UAVObjectField* field =  obj->getField(uavFieldName);
+        UAVObjectField* field =  getPlottedField(obj);
 
         if (field) {
             QDateTime NOW = QDateTime::currentDateTime(); //THINK ABOUT REIMPLEMENTING THIS TO SHOW UAVO TIME, NOT SYSTEM TIME
-            double currentValue = valueAsDouble(obj, field, haveSubField, uavSubFieldName) * pow(10, scalePower);
-
-            //Perform scope math, if necessary
-            if (mathFunction  == "Boxcar average" || mathFunction  == "Standard deviation"){
-                //Put the new value at the back
-                yDataHistory->append( currentValue );
-
-                // calculate average value
-                meanSum += currentValue;
-                if(yDataHistory->size() > (int)meanSamples) {
-                    meanSum -= yDataHistory->first();
-                    yDataHistory->pop_front();
-                }
-                // make sure to correct the sum every meanSamples steps to prevent it
-                // from running away due to floating point rounding errors
-                correctionSum+=currentValue;
-                if (++correctionCount >= (int)meanSamples) {
-                    meanSum = correctionSum;
-                    correctionSum = 0.0f;
-                    correctionCount = 0;
-                }
-
-                double boxcarAvg=meanSum/yDataHistory->size();
-
-                if ( mathFunction  == "Standard deviation" ){
-                    //Calculate square of sample standard deviation, with Bessel's correction
-                    double stdSum=0;
-                    for (int i=0; i < yDataHistory->size(); i++){
-                        stdSum+= pow(yDataHistory->at(i)- boxcarAvg,2)/(meanSamples-1);
-                    }
-                    yData->append(sqrt(stdSum));
-                }
-                else  {
-                    yData->append(boxcarAvg);
-                }
-            }
-            else{
-                yData->append( currentValue );
-            }
+            double currentValue = valueAsDouble(field) * pow(10, scalePower);
 
             double valueX = NOW.toTime_t() + NOW.time().msec() / 1000.0;
-            xData->append(valueX);
+            samples.append(QPointF(valueX, applyMathFunction(currentValue)));
 
             //Remove stale data
             removeStaleData();
@@ -217,22 +139,8 @@ bool TimeSeriesPlotData::append(UAVObject* obj)
  */
 void TimeSeriesPlotData::removeStaleData()
 {
-    double newestValue;
-    double oldestValue;
-
-    while (1) {
-        if (xData->size() == 0)
-            break;
-
-        newestValue = xData->last();
-        oldestValue = xData->first();
-
-        if (newestValue - oldestValue > getXWindowSize()) {
-            yData->pop_front();
-            xData->pop_front();
-        } else
-            break;
-    }
+    while (!samples.isEmpty() && samples.last().x() - samples.first().x() > getXWindowSize())
+        samples.removeFirst();
 }
 
 
@@ -245,6 +153,51 @@ void TimeSeriesPlotData::removeStaleDataTimeout()
 }
 
 
+/**
+ * @brief ScatterplotData::setCurve Set the curve the data is plotted on. The
+ * curve reads the samples in place, through a RingBufferSeriesData.
+ * @param val
+ */
+void ScatterplotData::setCurve(QwtPlotCurve *val)
+{
+    curve = val;
+    seriesData = new RingBufferSeriesData(&samples, indexAsX);
+    curve->setData(seriesData);
+}
+
+
+/**
+ * @brief ScatterplotData::updateCurve Prepare the samples for drawing, and
+ * have the curve redrawn
+ */
+void ScatterplotData::updateCurve(ScopeGadgetWidget *scopeGadgetWidget)
+{
+    seriesData->update(scopeGadgetWidget->canvas()->width());
+    curve->itemChanged();
+}
+
+
+/**
+ * @brief ScatterplotData::applyMathFunction Apply the scope math to a new value
+ * @param value
+ * @return the value to plot
+ */
+double ScatterplotData::applyMathFunction(double value)
+{
+    if (mathFunction  == "Boxcar average" || mathFunction  == "Standard deviation"){
+        stats.setWindowSize(meanSamples);
+        stats.append(value);
+
+        if (mathFunction  == "Standard deviation")
+            return sqrt(stats.variance());
+
+        return stats.mean();
+    }
+
+    return value;
+}
+
+
 /**
  * @brief ScatterplotData::deletePlots Delete all plot data
  */
@@ -262,6 +215,6 @@ void ScatterplotData::deletePlots(PlotData *scatterplotData)
  */
 void ScatterplotData::clearPlots()
 {
-    yData->clear();
-    xData->clear();
+    samples.clear();
+    stats.clear();
 }
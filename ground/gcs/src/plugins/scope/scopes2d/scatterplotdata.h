@@ -29,6 +29,7 @@
 #define SCATTERPLOTDATA_H
 
 #include "scopes2d/plotdata2d.h"
+#include "scopes2d/plotringbuffer.h"
 #include "uavobject.h"
 #include "qwt/src/qwt_plot_curve.h"
 
@@ -44,17 +45,26 @@ class ScatterplotData : public Plot2dData
 {
     Q_OBJECT
 public:
-    ScatterplotData(QString uavObject, QString uavField):
-        Plot2dData(uavObject, uavField){curve = 0;}
+    ScatterplotData(QString uavObject, QString uavField, bool indexAsX):
+        Plot2dData(uavObject, uavField), indexAsX(indexAsX){curve = 0; seriesData = 0;}
     ~ScatterplotData(){}
 
     virtual void deletePlots(PlotData *);
     void clearPlots();
 
-    void setCurve(QwtPlotCurve *val){curve = val;}
+    void setCurve(QwtPlotCurve *val);
 
 protected:
+    double applyMathFunction(double value);
+    void updateCurve(ScopeGadgetWidget *scopeGadgetWidget);
+
     QwtPlotCurve* curve;
+    RingBufferSeriesData* seriesData; //Owned by the curve
+    PlotRingBuffer samples;
+    SlidingWindowStats stats;
+
+private:
+    bool indexAsX;
 };
 
 
@@ -68,7 +78,7 @@ class SeriesPlotData : public ScatterplotData
     Q_OBJECT
 public:
     SeriesPlotData(QString uavObject, QString uavField)
-            : ScatterplotData(uavObject, uavField) {}
+            : ScatterplotData(uavObject, uavField, true) {}
     ~SeriesPlotData() {}
 
     /*!
@@ -94,7 +104,7 @@ class TimeSeriesPlotData : public ScatterplotData
     Q_OBJECT
 public:
     TimeSeriesPlotData(QString uavObject, QString uavField)
-            : ScatterplotData(uavObject, uavField) {
+            : ScatterplotData(uavObject, uavField, false) {
         scalePower = 1;
     }
     ~TimeSeriesPlotData() {
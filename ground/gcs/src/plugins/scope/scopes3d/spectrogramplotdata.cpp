@@ -208,7 +208,7 @@ bool SpectrogramData::append(UAVObject* multiObj)
 
             // Get the field of interest
             foreach (UAVObject *obj, list) {
-                UAVObjectField* field = obj->getField(uavFieldName);
+                UAVObjectField* field = getPlottedField(obj);
                 int numElements = field->getNumElements();
 
                 double scale = 1;
@@ -234,16 +234,15 @@ bool SpectrogramData::append(UAVObject* multiObj)
                     }
                 }
 
-                for (int i = 0; i < numElements; i++) {
-                    double currentValue = field->getValue(i).toDouble() / scale;  // Get the value and scale it
-
-                    //Normally some math would go here, modifying currentValue before appending it to values
-                    // .
-                    // .
-                    // .
+                // Copy the whole field at once, then scale it in place
+                int first = plotData.size();
+                plotData.resize(first + numElements);
+                double *values = plotData.data() + first;
+                field->getDoubles(values, numElements);
 
-                    // Last step, assign value to vector
-                    plotData += currentValue;
+                for (int i = 0; i < numElements; i++) {
+                    //Normally some math would go here, modifying the value before it is plotted
+                    values[i] /= scale;
                 }
 
                 // Check if we got enough values
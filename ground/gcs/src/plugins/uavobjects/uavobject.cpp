@@ -87,8 +87,11 @@ void UAVObject::initializeFields(QList<UAVObjectField*>& fields, quint8* data, q
     this->fields = fields;
     // Initialize fields
     quint32 offset = 0;
+    fieldIndices.clear();
     for (int n = 0; n < fields.length(); ++n)
     {
+        if (!fieldIndices.contains(fields[n]->getName()))
+            fieldIndices.insert(fields[n]->getName(), n);
         fields[n]->initialize(data, offset, this);
         offset += fields[n]->getNumBytes();
         connect(fields[n], SIGNAL(fieldUpdated(UAVObjectField*)), this, SLOT(fieldUpdated(UAVObjectField*)));
@@ -255,24 +258,85 @@ QJsonObject UAVObject::getJsonRepresentation() {
  */
 UAVObjectField* UAVObject::getField(const QString& name)
 {
-    // Look for field
-    for (int n = 0; n < fields.length(); ++n)
+    int index = fieldIndices.value(name, -1);
+    if (index >= 0)
     {
-        if (name.compare(fields[n]->getName()) == 0)
-        {
-            return fields[n];
-        }
+        return fields[index];
     }
     // If this point is reached then the field was not found
     qWarning()<<"UAVObject::getField Non existant field "<<name<<" requested.  This indicates a bug.  Make sure you also have null checking for non-debug code.";
     return NULL;
 }
 
+/**
+ * Get the position of a field within the object, to be resolved once and
+ * then used with getFieldByIndex() on every update. The position is the
+ * same for all instances of the object.
+ * @returns The index of the field or -1 if not found
+ */
+int UAVObject::getFieldIndex(const QString& name)
+{
+    return fieldIndices.value(name, -1);
+}
+
+/**
+ * Get a field by its position, as returned by getFieldIndex()
+ * @returns The field or NULL if the index is out of range
+ */
+UAVObjectField* UAVObject::getFieldByIndex(int index)
+{
+    if (index < 0 || index >= fields.length())
+    {
+        return NULL;
+    }
+    return fields[index];
+}
+
 /**
  * Pack the object data into a byte array
  * @returns The number of bytes copied
  */
 qint32 UAVObject::pack(quint8* dataOut)
+{
+    packData(dataOut);
+    return numBytes;
+}
+
+/**
+ * Unpack the object data from a byte array
+ * @returns The number of bytes copied
+ */
+qint32 UAVObject::unpack(const quint8* dataIn)
+{
+    unpackData(dataIn);
+    emit objectUnpacked(this); // trigger object updated event
+    emit objectUpdated(this);
+
+    return numBytes;
+}
+
+/**
+ * Pack the object data into a byte array, without emitting any signals.
+ * Generated objects override this with code specialized for their fields.
+ */
+void UAVObject::packData(quint8* dataOut)
+{
+    packFields(dataOut);
+}
+
+/**
+ * Unpack the object data from a byte array, without emitting any signals.
+ * Generated objects override this with code specialized for their fields.
+ */
+void UAVObject::unpackData(const quint8* dataIn)
+{
+    unpackFields(dataIn);
+}
+
+/**
+ * Pack the object data field by field, for any object
+ */
+void UAVObject::packFields(quint8* dataOut)
 {
     qint32 offset = 0;
     for (QList<UAVObjectField*>::iterator iter = fields.begin(); iter != fields.end(); ++iter)
@@ -281,14 +345,12 @@ qint32 UAVObject::pack(quint8* dataOut)
         field->pack(&dataOut[offset]);
         offset += field->getNumBytes();
     }
-    return numBytes;
 }
 
 /**
- * Unpack the object data from a byte array
- * @returns The number of bytes copied
+ * Unpack the object data field by field, for any object
  */
-qint32 UAVObject::unpack(const quint8* dataIn)
+void UAVObject::unpackFields(const quint8* dataIn)
 {
     qint32 offset = 0;
     for (QList<UAVObjectField*>::iterator iter = fields.begin(); iter != fields.end(); ++iter)
@@ -297,10 +359,6 @@ qint32 UAVObject::unpack(const quint8* dataIn)
         field->unpack(&dataIn[offset]);
         offset += field->getNumBytes();
     }
-    emit objectUnpacked(this); // trigger object updated event
-    emit objectUpdated(this);
-
-    return numBytes;
 }
 
 /**
@@ -43,8 +43,10 @@
 #include <QObject>
 #include <QString>
 #include <QList>
+#include <QHash>
 #include <QFile>
 #include <qglobal.h>
+#include <string.h>
 #include "uavobjectfield.h"
 
 #ifdef _MSC_VER
@@ -122,12 +124,18 @@ public:
     quint32 getNumBytes(); 
     qint32 pack(quint8* dataOut);
     qint32 unpack(const quint8* dataIn);
+    virtual void packData(quint8* dataOut);
+    virtual void unpackData(const quint8* dataIn);
+    void packFields(quint8* dataOut);
+    void unpackFields(const quint8* dataIn);
     virtual void setMetadata(const Metadata& mdata) = 0;
     virtual Metadata getMetadata() = 0;
     virtual Metadata getDefaultMetadata() = 0;
     qint32 getNumFields();
     QList<UAVObjectField*> getFields();
     UAVObjectField* getField(const QString& name);
+    int getFieldIndex(const QString& name);
+    UAVObjectField* getFieldByIndex(int index);
     QString toString();
     QString toStringBrief();
     QString toStringData();
@@ -245,10 +253,15 @@ protected:
     quint32 numBytes;
     quint8* data;
     QList<UAVObjectField*> fields;
+    QHash<QString, int> fieldIndices;
     void initializeFields(QList<UAVObjectField*>& fields, quint8* data, quint32 numBytes);
     void setDescription(const QString& description);
     void setCategory(const QString& category);
 
+    // Used by the generated packData() and unpackData()
+    static quint32 floatToBits(float value) { quint32 bits; memcpy(&bits, &value, sizeof(bits)); return bits; }
+    static float floatFromBits(quint32 bits) { float value; memcpy(&value, &bits, sizeof(value)); return value; }
+
 };
 
 #endif // UAVOBJECT_H
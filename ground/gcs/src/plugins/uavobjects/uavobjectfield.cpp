@@ -1060,7 +1060,91 @@ void UAVObjectField::setValue(const QVariant& value, quint32 index)
 
 double UAVObjectField::getDouble(quint32 index)
 {
-    return getValue(index).toDouble();
+    switch (type)
+    {
+    case INT8:
+        return readElement<qint8>(index);
+    case INT16:
+        return readElement<qint16>(index);
+    case INT32:
+        return readElement<qint32>(index);
+    case UINT8:
+        return readElement<quint8>(index);
+    case UINT16:
+        return readElement<quint16>(index);
+    case UINT32:
+        return readElement<quint32>(index);
+    case FLOAT32:
+        return readElement<float>(index);
+    default:
+        // Enums convert from their option name, so keep the QVariant path
+        return getValue(index).toDouble();
+    }
+}
+
+/**
+ * Copy consecutive elements into a buffer, converted to double
+ * @param dataOut Buffer for at least maxElements values
+ * @param maxElements Most elements to copy
+ * @param first Index of the first element to copy
+ * @returns The number of elements copied
+ */
+quint32 UAVObjectField::getDoubles(double* dataOut, quint32 maxElements, quint32 first)
+{
+    if (first >= numElements)
+    {
+        return 0;
+    }
+    quint32 count = qMin(maxElements, numElements - first);
+    const quint8* src = &data[offset + numBytesPerElement*first];
+
+    switch (type)
+    {
+    case FLOAT32:
+        for (quint32 n = 0; n < count; ++n)
+        {
+            float value;
+            memcpy(&value, src + n*sizeof(value), sizeof(value));
+            dataOut[n] = value;
+        }
+        break;
+    case INT8:
+    case INT16:
+    case INT32:
+    case UINT8:
+    case UINT16:
+    case UINT32:
+        for (quint32 n = 0; n < count; ++n)
+        {
+            dataOut[n] = getDouble(first + n);
+        }
+        break;
+    default:
+        for (quint32 n = 0; n < count; ++n)
+        {
+            dataOut[n] = getValue(first + n).toDouble();
+        }
+        break;
+    }
+    return count;
+}
+
+/**
+ * Copy consecutive elements, in their native representation, into a buffer
+ * @param dataOut Buffer for at least maxElements elements of the field's type
+ * @param maxElements Most elements to copy
+ * @param first Index of the first element to copy
+ * @returns The number of elements copied; always 0 for bitfields
+ */
+quint32 UAVObjectField::getRawElements(void* dataOut, quint32 maxElements, quint32 first)
+{
+    if (type == BITFIELD || first >= numElements)
+    {
+        return 0;
+    }
+    quint32 count = qMin(maxElements, numElements - first);
+    memcpy(dataOut, &data[offset + numBytesPerElement*first], numBytesPerElement*count);
+    return count;
 }
 
 void UAVObjectField::setDouble(double value, quint32 index)
@@ -35,6 +35,7 @@
 #include <QVariant>
 #include <QList>
 #include <QMap>
+#include <string.h>
 
 class UAVObject;
 
@@ -74,6 +75,22 @@ public:
     bool checkValue(const QVariant& data, quint32 index = 0);
     void setValue(const QVariant& data, quint32 index = 0);
     double getDouble(quint32 index = 0);
+    quint32 getDoubles(double* dataOut, quint32 maxElements, quint32 first = 0);
+    quint32 getRawElements(void* dataOut, quint32 maxElements, quint32 first = 0);
+
+    /*
+     * Typed accessors, for reading values on every update without going
+     * through a QVariant. They must only be used on fields of the matching
+     * type (enums are read as their raw value with getU8()); an index out
+     * of range reads as 0.
+     */
+    float getFloat(quint32 index = 0) const { Q_ASSERT(type == FLOAT32); return readElement<float>(index); }
+    qint8 getI8(quint32 index = 0) const { Q_ASSERT(type == INT8); return readElement<qint8>(index); }
+    qint16 getI16(quint32 index = 0) const { Q_ASSERT(type == INT16); return readElement<qint16>(index); }
+    qint32 getI32(quint32 index = 0) const { Q_ASSERT(type == INT32); return readElement<qint32>(index); }
+    quint8 getU8(quint32 index = 0) const { Q_ASSERT(type == UINT8 || type == ENUM); return readElement<quint8>(index); }
+    quint16 getU16(quint32 index = 0) const { Q_ASSERT(type == UINT16); return readElement<quint16>(index); }
+    quint32 getU32(quint32 index = 0) const { Q_ASSERT(type == UINT32); return readElement<quint32>(index); }
     void setDouble(double value, quint32 index = 0);
     quint32 getDataOffset();
     quint32 getNumBytes();
@@ -121,6 +138,14 @@ protected:
                                const QString &description, const QList<QVariant> defaultValues);
     void limitsInitialize(const QString &limits);
 
+    template <typename T> T readElement(quint32 index) const
+    {
+        T value = 0;
+        if (index < numElements)
+            memcpy(&value, &data[offset + sizeof(T)*index], sizeof(T));
+        return value;
+    }
+
 
 };
 
@@ -56,42 +56,36 @@ bool UAVObjectManager::registerObject(UAVDataObject* obj)
 {
     // Check if this object type is already in the list
     quint32 objID = obj->getObjID();
-    if (objects.contains(objID))//Known object ID
+    int index = typeById.value(objID, -1);
+    if (index >= 0)//Known object ID
     {
-        if (objects.value(objID).contains(obj->getInstID()))//Instance already present
+        quint32 instID = obj->getInstID();
+        if (instID < (quint32)types.at(index).size())//Instance already present
             return false;
         if (obj->isSingleInstance())
             return false;
-        if (obj->getInstID() >= MAX_INSTANCES)
+        if (instID >= MAX_INSTANCES)
             return false;
-        UAVDataObject* refObj = dynamic_cast<UAVDataObject*>(objects.value(objID).first());
+        if (types.at(index).isEmpty())
+            return false;
+        UAVDataObject* refObj = dynamic_cast<UAVDataObject*>(types.at(index).first());
         if (refObj == NULL)
         {
             return false;
         }
         UAVMetaObject* mobj = refObj->getMetaObject();
-        if (objects.value(objID).last()->getInstID() < obj->getInstID())//Space between last existent instance and new one, lets fill the gaps
-        {
-            for (quint32 instidx = objects.value(objID).last()->getInstID() + 1 ; instidx < obj->getInstID(); ++instidx)
-            {
-                UAVDataObject* cobj = obj->clone(instidx);
-                cobj->initialize(instidx,mobj);
-                QMap<quint32,UAVObject*> ppp;
-                ppp.insert(instidx,cobj);
-                objects[objID].insert(instidx,cobj);
-                getObject(cobj->getObjID())->emitNewInstance(cobj);//TODO??
-                emit newInstance(cobj);
-            }
-        }
-        else if (obj->getInstID() == 0)
-            obj->initialize(objects.value(objID).last()->getObjID() + 1, mobj);
-        else
+        // Instances are kept contiguous, so fill any gap before the new one
+        for (quint32 instidx = types.at(index).size(); instidx < instID; ++instidx)
         {
-            return false;
+            UAVDataObject* cobj = obj->clone(instidx);
+            cobj->initialize(instidx,mobj);
+            types[index].append(cobj);
+            refObj->emitNewInstance(cobj);
+            emit newInstance(cobj);
         }
         // Add the actual object instance in the list
-        objects[objID].insert(obj->getInstID(),obj);
-        getObject(objID)->emitNewInstance(obj);
+        types[index].append(obj);
+        refObj->emitNewInstance(obj);
         emit newInstance(obj);
         return true;
     }
@@ -120,31 +114,45 @@ bool UAVObjectManager::registerObject(UAVDataObject* obj)
 bool UAVObjectManager::unRegisterObject(UAVDataObject* obj)
 {
     // Check if this object type is already in the list
-    quint32 objID = obj->getObjID();
     if(obj->isSingleInstance())
         return false;
-    quint32 instances = (quint32)objects.value(obj->getObjID()).count();
-    for(quint32 x = obj->getInstID(); x < instances; ++x)
+    int index = typeById.value(obj->getObjID(), -1);
+    if (index < 0)
+        return true;
+    // Copied, as the signals may register or remove other instances
+    QVector<UAVObject*> instances = types.at(index);
+    for(int x = obj->getInstID(); x < instances.size(); ++x)
     {
-        getObject(objects.value(objID).value(x)->getObjID())->emitInstanceRemoved(objects.value(objID).value(x));
-        emit instanceRemoved(objects.value(objID).value(x));
-        objects[objID].remove(x);
+        instances.first()->emitInstanceRemoved(instances.at(x));
+        emit instanceRemoved(instances.at(x));
     }
+    if ((int)obj->getInstID() < types.at(index).size())
+        types[index].resize(obj->getInstID());
     return true;
 }
 
 void UAVObjectManager::addObject(UAVObject* obj)
 {
     // Add to list
-    QMap<quint32,UAVObject*> list;
-    list.insert(obj->getInstID(),obj);
-    objects.insert(obj->getObjID(),list);
-
-    objectsByName.insert(obj->getName(), list);
+    int index = types.size();
+    types.append(QVector<UAVObject*>() << obj);
+    typeById.insert(obj->getObjID(), index);
+    typeByName.insert(obj->getName(), index);
 
     emit newObject(obj);
 }
 
+/**
+ * Get the instances of an object type given its index
+ * @returns The instances or NULL if the index is out of range
+ */
+const QVector<UAVObject*> *UAVObjectManager::getInstances(int index) const
+{
+    if (index < 0 || index >= types.size())
+        return NULL;
+    return &types.at(index);
+}
+
 /**
  * Get all objects. A two dimentional QVector is returned. Objects are grouped by
  * instances of the same object type.
@@ -152,16 +160,29 @@ void UAVObjectManager::addObject(UAVObject* obj)
 QVector< QVector<UAVObject*> > UAVObjectManager::getObjectsVector()
 {
     QVector< QVector<UAVObject*> > vector;
-    foreach (const ObjectMap &map,objects.values())
+    foreach (const QVector<UAVObject*> &instances, types)
     {
-        QVector<UAVObject*> vec = map.values().toVector();
-        vector.append(vec);
+        if (!instances.isEmpty())
+            vector.append(instances);
     }
     return vector;
 }
 
+/**
+ * Get all objects, keyed by object ID and then instance ID. This is built on
+ * each call, so prefer getObjectsVector() where the keys are not needed.
+ */
 QHash<quint32, QMap<quint32, UAVObject *> > UAVObjectManager::getObjects()
 {
+    QHash<quint32, ObjectMap> objects;
+    foreach (const QVector<UAVObject*> &instances, types)
+    {
+        if (instances.isEmpty())
+            continue;
+        ObjectMap &map = objects[instances.first()->getObjID()];
+        for (int i = 0; i < instances.size(); ++i)
+            map.insert(i, instances.at(i));
+    }
     return objects;
 }
 
@@ -171,21 +192,19 @@ QHash<quint32, QMap<quint32, UAVObject *> > UAVObjectManager::getObjects()
 QVector< QVector<UAVDataObject*> > UAVObjectManager::getDataObjectsVector()
 {
     QVector< QVector<UAVDataObject*> > vector;
-    foreach (const ObjectMap &map,objects.values())
+    foreach (const QVector<UAVObject*> &instances, types)
     {
-        UAVDataObject* obj = dynamic_cast<UAVDataObject*>(map.first());
-        if(obj!=NULL)
+        if (instances.isEmpty() || dynamic_cast<UAVDataObject*>(instances.first()) == NULL)
+            continue;
+        QVector<UAVDataObject*> vec;
+        foreach(UAVObject* o, instances)
         {
-            QVector<UAVDataObject*> vec;
-            foreach(UAVObject* o,map)
-            {
-                UAVDataObject* dobj = dynamic_cast<UAVDataObject*>(o);
-                if(dobj)
-                    vec.append(dobj);
-            }
-            vector.append(vec);
+            UAVDataObject* dobj = dynamic_cast<UAVDataObject*>(o);
+            if(dobj)
+                vec.append(dobj);
         }
-     }
+        vector.append(vec);
+    }
     return vector;
 }
 
@@ -195,21 +214,19 @@ QVector< QVector<UAVDataObject*> > UAVObjectManager::getDataObjectsVector()
 QVector <QVector<UAVMetaObject*> > UAVObjectManager::getMetaObjectsVector()
 {
     QVector< QVector<UAVMetaObject*> > vector;
-    foreach(const ObjectMap &map,objects.values())
+    foreach (const QVector<UAVObject*> &instances, types)
     {
-        UAVMetaObject* obj = dynamic_cast<UAVMetaObject*>(map.first());
-        if(obj!=NULL)
+        if (instances.isEmpty() || dynamic_cast<UAVMetaObject*>(instances.first()) == NULL)
+            continue;
+        QVector<UAVMetaObject*> vec;
+        foreach(UAVObject* o, instances)
         {
-            QVector<UAVMetaObject*> vec;
-            foreach(UAVObject* o,map)
-            {
-                UAVMetaObject* mobj = dynamic_cast<UAVMetaObject*>(o);
-                if(mobj)
-                    vec.append(mobj);
-            }
-            vector.append(vec);
+            UAVMetaObject* mobj = dynamic_cast<UAVMetaObject*>(o);
+            if(mobj)
+                vec.append(mobj);
         }
-     }
+        vector.append(vec);
+    }
     return vector;
 }
 
@@ -219,7 +236,10 @@ QVector <QVector<UAVMetaObject*> > UAVObjectManager::getMetaObjectsVector()
  */
 UAVObject* UAVObjectManager::getObject(const QString& name, quint32 instId)
 {
-    return getObject(name, 0, instId);
+    const QVector<UAVObject*> *instances = getInstances(typeByName.value(name, -1));
+    if (instances == NULL || instId >= (quint32)instances->size())
+        return NULL;
+    return instances->at(instId);
 }
 
 /**
@@ -228,25 +248,26 @@ UAVObject* UAVObjectManager::getObject(const QString& name, quint32 instId)
  */
 UAVObject* UAVObjectManager::getObject(quint32 objId, quint32 instId)
 {
-    return getObject(NULL, objId, instId);
+    const QVector<UAVObject*> *instances = getInstances(typeById.value(objId, -1));
+    if (instances == NULL || instId >= (quint32)instances->size())
+        return NULL;
+    return instances->at(instId);
 }
 
 /**
- * Helper function for the public getObject() functions.
+ * Get a specific object given the index it was registered at, as assigned by
+ * the generator (OBJINDEX), without hashing. Falls back to the ID lookup if
+ * the objects were registered in another order.
+ * @returns The object is found or NULL if not
  */
-UAVObject* UAVObjectManager::getObject(const QString& name, quint32 objId, quint32 instId)
+UAVObject* UAVObjectManager::getObjectByIndex(quint32 index, quint32 objId, quint32 instId)
 {
-    if(name != NULL)
-    {
-        if (objectsByName.contains(name)) {
-            return objectsByName.value(name).value(instId);
-        }
-
+    const QVector<UAVObject*> *instances = getInstances(index);
+    if (instances == NULL || instances->isEmpty() || instances->first()->getObjID() != objId)
+        return getObject(objId, instId);
+    if (instId >= (quint32)instances->size())
         return NULL;
-    }
-    else if(objects.contains(objId))
-        return objects.value(objId).value(instId);
-    return NULL;
+    return instances->at(instId);
 }
 
 /**
@@ -254,7 +275,10 @@ UAVObject* UAVObjectManager::getObject(const QString& name, quint32 objId, quint
  */
 QVector<UAVObject*> UAVObjectManager::getObjectInstancesVector(const QString& name)
 {
-    return getObjectInstancesVector(&name, 0);
+    const QVector<UAVObject*> *instances = getInstances(typeByName.value(name, -1));
+    if (instances == NULL)
+        return QVector<UAVObject*>();
+    return *instances;
 }
 
 /**
@@ -262,25 +286,10 @@ QVector<UAVObject*> UAVObjectManager::getObjectInstancesVector(const QString& na
  */
 QVector<UAVObject*> UAVObjectManager::getObjectInstancesVector(quint32 objId)
 {
-    return getObjectInstancesVector(NULL, objId);
-}
-
-/**
- * Helper function for the public getObjectInstances()
- */
-QVector<UAVObject*> UAVObjectManager::getObjectInstancesVector(const QString* name, quint32 objId)
-{
-    if(name != NULL)
-    {
-        foreach(const ObjectMap &map,objects)
-        {
-            if(map.first()->getName().compare(name) == 0)
-                return map.values().toVector();
-        }
-    }
-    else if(objects.contains(objId))
-        return objects.value(objId).values().toVector();
-    return  QVector<UAVObject*>();
+    const QVector<UAVObject*> *instances = getInstances(typeById.value(objId, -1));
+    if (instances == NULL)
+        return QVector<UAVObject*>();
+    return *instances;
 }
 
 /**
@@ -288,7 +297,10 @@ QVector<UAVObject*> UAVObjectManager::getObjectInstancesVector(const QString* na
  */
 qint32 UAVObjectManager::getNumInstances(const QString& name)
 {
-    return getNumInstances(&name, 0);
+    const QVector<UAVObject*> *instances = getInstances(typeByName.value(name, -1));
+    if (instances == NULL)
+        return -1;
+    return instances->size();
 }
 
 /**
@@ -296,23 +308,8 @@ qint32 UAVObjectManager::getNumInstances(const QString& name)
  */
 qint32 UAVObjectManager::getNumInstances(quint32 objId)
 {
-    return getNumInstances(NULL, objId);
-}
-
-/**
- * Helper function for public getNumInstances
- */
-qint32 UAVObjectManager::getNumInstances(const QString* name, quint32 objId)
-{
-    if(name != NULL)
-    {
-        foreach(const ObjectMap &map,objects)
-        {
-            if(map.first()->getName().compare(name) == 0)
-                return map.count();
-        }
-    }
-    else if(objects.contains(objId))
-        return objects.value(objId).count();
-    return -1;
+    const QVector<UAVObject*> *instances = getInstances(typeById.value(objId, -1));
+    if (instances == NULL)
+        return -1;
+    return instances->size();
 }
@@ -59,6 +59,7 @@ public:
     QVector< QVector<UAVMetaObject*> > getMetaObjectsVector();
     UAVObject* getObject(const QString& name, quint32 instId = 0);
     UAVObject* getObject(quint32 objId, quint32 instId = 0);
+    UAVObject* getObjectByIndex(quint32 index, quint32 objId, quint32 instId = 0);
     QVector<UAVObject*> getObjectInstancesVector(const QString& name);
     QVector<UAVObject*> getObjectInstancesVector(quint32 objId);
     qint32 getNumInstances(const QString& name);
@@ -70,13 +71,14 @@ signals:
     void instanceRemoved(UAVObject* obj);
 private:
     static const quint32 MAX_INSTANCES = 1000;
-    QHash<quint32, QMap<quint32,UAVObject*> > objects;
-    QHash<QString, QMap<quint32,UAVObject*> > objectsByName;
+    //! Instances of each object type, in order of registration. A data
+    //! object's metaobject is registered right after it.
+    QVector< QVector<UAVObject*> > types;
+    QHash<quint32, int> typeById;
+    QHash<QString, int> typeByName;
 
     void addObject(UAVObject* obj);
-    UAVObject* getObject(const QString& name, quint32 objId, quint32 instId);
-    QVector<UAVObject*> getObjectInstancesVector(const QString* name, quint32 objId);
-    qint32 getNumInstances(const QString* name, quint32 objId);
+    const QVector<UAVObject*> *getInstances(int index) const;
 };
 
 
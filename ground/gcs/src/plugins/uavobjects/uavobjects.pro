@@ -1,7 +1,7 @@
 TEMPLATE = lib
 TARGET = UAVObjects
 DEFINES += UAVOBJECTS_LIBRARY
-QT += qml
+QT += qml testlib
 include(../../gcsplugin.pri)
 include(uavobjects_dependencies.pri)
 
@@ -27,6 +27,9 @@
  */
 #include "uavobjectsplugin.h"
 #include "uavobjectsinit.h"
+#include <extensionsystem/pluginmanager.h>
+#include <QTest>
+#include <QScopedPointer>
 
 UAVObjectsPlugin::UAVObjectsPlugin()
 {
@@ -60,3 +63,121 @@ void UAVObjectsPlugin::shutdown()
 {
 
 }
+
+/**
+ * Clones every data object, and fills the clones with random data
+ * @returns the clones, which the caller must delete
+ */
+QList<UAVDataObject *> UAVObjectsPlugin::cloneAllObjects()
+{
+    UAVObjectManager *objMngr = ExtensionSystem::PluginManager::instance()->getObject<UAVObjectManager>();
+    QList<UAVDataObject *> clones;
+
+    qsrand(1);
+    foreach (const QVector<UAVDataObject *> &instances, objMngr->getDataObjectsVector()) {
+        UAVDataObject *obj = instances.first()->dirtyClone();
+
+        QByteArray data(obj->getNumBytes(), 0);
+        for (int i = 0; i < data.size(); i++)
+            data[i] = (char) qrand();
+        obj->unpackFields((const quint8 *) data.constData());
+
+        clones.append(obj);
+    }
+
+    return clones;
+}
+
+/**
+ * The generated packData() and unpackData() of every object must give the
+ * same telemetry format as packing field by field
+ */
+void UAVObjectsPlugin::testGeneratedPacking()
+{
+    QList<UAVDataObject *> objects = cloneAllObjects();
+    QVERIFY(!objects.isEmpty());
+
+    foreach (UAVDataObject *obj, objects) {
+        QByteArray wire(obj->getNumBytes(), 0);
+        obj->packFields((quint8 *) wire.data());
+
+        QByteArray packed(wire.size(), 0);
+        obj->packData((quint8 *) packed.data());
+        QVERIFY2(packed == wire, qPrintable(obj->getName()));
+
+        // Unpack into a fresh object, and pack that field by field
+        QScopedPointer<UAVDataObject> copy(obj->dirtyClone());
+        copy->unpackData((const quint8 *) wire.constData());
+
+        QByteArray repacked(wire.size(), 0);
+        copy->packFields((quint8 *) repacked.data());
+        QVERIFY2(repacked == wire, qPrintable(obj->getName()));
+    }
+
+    qDeleteAll(objects);
+}
+
+void UAVObjectsPlugin::testPack_data()
+{
+    QTest::addColumn<bool>("generated");
+
+    QTest::newRow("fields") << false;
+    QTest::newRow("generated") << true;
+}
+
+/**
+ * Packing every object once, field by field or with the generated code
+ */
+void UAVObjectsPlugin::testPack()
+{
+    QFETCH(bool, generated);
+    QList<UAVDataObject *> objects = cloneAllObjects();
+    int largest = 0;
+    foreach (UAVDataObject *obj, objects)
+        largest = qMax(largest, (int) obj->getNumBytes());
+    QByteArray buffer(largest, 0);
+
+    QBENCHMARK {
+        foreach (UAVDataObject *obj, objects) {
+            if (generated)
+                obj->packData((quint8 *) buffer.data());
+            else
+                obj->packFields((quint8 *) buffer.data());
+        }
+    }
+
+    qDeleteAll(objects);
+}
+
+void UAVObjectsPlugin::testUnpack_data()
+{
+    testPack_data();
+}
+
+/**
+ * Unpacking every object once, field by field or with the generated code
+ */
+void UAVObjectsPlugin::testUnpack()
+{
+    QFETCH(bool, generated);
+    QList<UAVDataObject *> objects = cloneAllObjects();
+    QVector<QByteArray> packets;
+
+    foreach (UAVDataObject *obj, objects) {
+        QByteArray packet(obj->getNumBytes(), 0);
+        obj->packFields((quint8 *) packet.data());
+        packets.append(packet);
+    }
+
+    QBENCHMARK {
+        for (int i = 0; i < objects.size(); i++) {
+            const quint8 *data = (const quint8 *) packets[i].constData();
+            if (generated)
+                objects[i]->unpackData(data);
+            else
+                objects[i]->unpackFields(data);
+        }
+    }
+
+    qDeleteAll(objects);
+}
@@ -46,6 +46,16 @@ public:
     void extensionsInitialized();
     bool initialize(const QStringList & arguments, QString * errorString);
     void shutdown();
+
+private:
+    QList<UAVDataObject *> cloneAllObjects();
+
+private slots:
+    void testGeneratedPacking();
+    void testPack_data();
+    void testPack();
+    void testUnpack_data();
+    void testUnpack();
 };
 
 #endif // UAVOBJECTSPLUGIN_H
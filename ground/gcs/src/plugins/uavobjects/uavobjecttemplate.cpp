@@ -38,6 +38,7 @@
 
 #include "$(NAMELC).h"
 #include "uavobjectfield.h"
+#include <QtEndian>
 
 const QString $(NAME)::NAME = QString("$(NAME)");
 const QString $(NAME)::DESCRIPTION = QString("$(DESCRIPTION)");
@@ -146,12 +147,27 @@ UAVDataObject* $(NAME)::dirtyClone()
     return obj;
 }
 
+/**
+ * Pack the object data in the telemetry format, little-endian in field order,
+ * as packFields() does through the generic fields
+ */
+void $(NAME)::packData(quint8* dataOut)
+{
+$(PACKFIELDS)}
+
+/**
+ * Unpack the object data from the telemetry format
+ */
+void $(NAME)::unpackData(const quint8* dataIn)
+{
+$(UNPACKFIELDS)}
+
 /**
  * Static function to retrieve an instance of the object.
  */
 $(NAME)* $(NAME)::GetInstance(UAVObjectManager* objMngr, quint32 instID)
 {
-    return dynamic_cast<$(NAME)*>(objMngr->getObject($(NAME)::OBJID, instID));
+    return dynamic_cast<$(NAME)*>(objMngr->getObjectByIndex($(NAME)::OBJINDEX, $(NAME)::OBJID, instID));
 }
 
 $(PROPERTIES_IMPL)
@@ -65,6 +65,7 @@ $(DATAFIELDINFO)
   
     // Constants
     static const quint32 OBJID = $(OBJIDHEX);
+    static const quint32 OBJINDEX = $(OBJINDEX);
     static const QString NAME;
     static const QString DESCRIPTION;
     static const QString CATEGORY;
@@ -81,6 +82,8 @@ $(DATAFIELDINFO)
     Metadata getDefaultMetadata();
     UAVDataObject* clone(quint32 instID);
     UAVDataObject* dirtyClone();
+    void packData(quint8* dataOut);
+    void unpackData(const quint8* dataIn);
 	
     static $(NAME)* GetInstance(UAVObjectManager* objMngr, quint32 instID = 0);
     static qint32 getNumInstances(UAVObjectManager* objMngr) {return objMngr->getNumInstances(OBJID);}
@@ -64,6 +64,7 @@ void TelemetryManager::onStart()
 {
     utalk = new UAVTalk(device, objMngr);
     telemetry = new Telemetry(utalk, objMngr);
+    connect(utalk, SIGNAL(frameReceived(quint32,QByteArray)), this, SIGNAL(frameReceived(quint32,QByteArray)));
     telemetryMon = new TelemetryMonitor(objMngr, telemetry, sessions);
     connect(telemetryMon, SIGNAL(connected()), this, SLOT(onConnect()));
     connect(telemetryMon, SIGNAL(disconnected()), this, SLOT(onDisconnect()));
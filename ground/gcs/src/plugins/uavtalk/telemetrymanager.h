@@ -56,6 +56,8 @@ signals:
     void disconnected();
     void myStart();
     void myStop();
+    //! Every validated frame received from the autopilot, see UAVTalk::frameReceived
+    void frameReceived(quint32 objId, const QByteArray &frame);
 
 private slots:
     void onConnect();
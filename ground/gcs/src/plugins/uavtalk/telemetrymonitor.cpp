@@ -49,6 +49,8 @@
 #define OBJECT_RETRIEVE_TIMEOUT             5000
 //IAP object is very important, retry if not able to get it the first time
 #define IAP_OBJECT_RETRIES                  3
+//Time without receiving any of the settings snapshot before retrieving what is missing one at a time
+#define SNAPSHOT_TIMEOUT                    2000
 
 #ifdef TELEMETRYMONITOR_DEBUG
   #define TELEMETRYMONITOR_QXTLOG_DEBUG(...) qDebug()<<__VA_ARGS__
@@ -66,7 +68,8 @@ TelemetryMonitor::TelemetryMonitor(UAVObjectManager* objMngr, Telemetry* tel, QH
     numberOfObjects(0),
     retries(0),
     isManaged(true),
-    sessions(sessions)
+    sessions(sessions),
+    snapshotRequest(0)
 {
     sessionID = QDateTime::currentDateTime().toTime_t();
     this->connectionTimer = new QTime();
@@ -75,6 +78,7 @@ TelemetryMonitor::TelemetryMonitor(UAVObjectManager* objMngr, Telemetry* tel, QH
     flightStatsObj = FlightTelemetryStats::GetInstance(objMngr);
 
     sessionObj = SessionManaging::GetInstance(objMngr);
+    snapshotObj = SettingsSnapshot::GetInstance(objMngr);
 
     // Listen for flight stats updates
     connect(flightStatsObj, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(flightStatsUpdated(UAVObject*)));
@@ -87,10 +91,13 @@ TelemetryMonitor::TelemetryMonitor(UAVObjectManager* objMngr, Telemetry* tel, QH
     objectRetrieveTimeout->setSingleShot(true);
     sessionInitialRetrieveTimeout = new QTimer(this);
     sessionInitialRetrieveTimeout->setSingleShot(true);
+    snapshotTimeout = new QTimer(this);
+    snapshotTimeout->setSingleShot(true);
     connect(statsTimer, SIGNAL(timeout()), this, SLOT(processStatsUpdates()));
     connect(sessionRetrieveTimeout,SIGNAL(timeout()),this,SLOT(sessionRetrieveTimeoutCB()));
     connect(sessionInitialRetrieveTimeout,SIGNAL(timeout()),this,SLOT(sessionInitialRetrieveTimeoutCB()));
     connect(objectRetrieveTimeout,SIGNAL(timeout()),this,SLOT(objectRetrieveTimeoutCB()));
+    connect(snapshotTimeout,SIGNAL(timeout()),this,SLOT(snapshotTimeoutCB()));
     statsTimer->start(STATS_CONNECT_PERIOD_MS);
 
     Core::ConnectionManager *cm = Core::ICore::instance()->connectionManager();
@@ -134,11 +141,10 @@ void TelemetryMonitor::startRetrievingObjects()
     // Get all objects, add metaobjects, settings and data objects with OnChange update mode to the queue
     queue.clear();
     retries = 0;
-    objectRetrieveTimeout->start(OBJECT_RETRIEVE_TIMEOUT);
     foreach(UAVObjectManager::ObjectMap map, objMngr->getObjects().values())
     {
         UAVObject* obj = map.first();
-        if(obj->getObjID() == SessionManaging::OBJID)
+        if(obj->getObjID() == SessionManaging::OBJID || obj->getObjID() == SettingsSnapshot::OBJID)
         {
             continue;
         }
@@ -171,12 +177,154 @@ void TelemetryMonitor::startRetrievingObjects()
             }
         }
     }
-    // Start retrieving
+    // Ask for everything in one pass if the autopilot supports it, otherwise start retrieving one at a time
+    if (startSnapshot())
+        return;
     TELEMETRYMONITOR_QXTLOG_DEBUG(QString(tr("Starting to retrieve meta and settings objects from the autopilot (%1 objects)"))
                                   .arg( queue.length()));
+    objectRetrieveTimeout->start(OBJECT_RETRIEVE_TIMEOUT);
     retrieveNextObject();
 }
 
+/**
+ * Request the settings snapshot, in which the autopilot sends all the queued
+ * objects back to back instead of waiting for a request for each.
+ * @return false if the autopilot does not support snapshots
+ */
+bool TelemetryMonitor::startSnapshot()
+{
+    if (!snapshotObj->getIsPresentOnHardware())
+        return false;
+
+    snapshotPending.clear();
+    foreach (UAVObject *obj, queue) {
+        foreach (UAVObject *inst, objMngr->getObjectInstancesVector(obj->getObjID())) {
+            snapshotPending.insert(inst);
+            connect(inst, SIGNAL(objectUnpacked(UAVObject*)), this, SLOT(snapshotObjectUnpacked(UAVObject*)), Qt::UniqueConnection);
+        }
+    }
+    connect(snapshotObj, SIGNAL(objectUnpacked(UAVObject*)), this, SLOT(snapshotUnpacked(UAVObject*)), Qt::UniqueConnection);
+
+    TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 requesting settings snapshot of %1 objects").arg(Q_FUNC_INFO).arg(snapshotPending.count()));
+    snapshotObj->setRequest(++snapshotRequest);
+    snapshotObj->setHash(snapshotHash());
+    snapshotObj->setObjectCount(0);
+    snapshotObj->setStatus(SettingsSnapshot::STATUS_REQUEST);
+    snapshotObj->updated();
+    snapshotTimeout->start(SNAPSHOT_TIMEOUT);
+
+    return true;
+}
+
+/**
+ * Stop collecting the snapshot and retrieve whatever it did not deliver one
+ * object at a time.
+ * @param unchanged TRUE if the autopilot skipped the settings and metadata
+ * because they match what the GCS holds
+ */
+void TelemetryMonitor::finishSnapshot(bool unchanged)
+{
+    snapshotTimeout->stop();
+    disconnect(snapshotObj, SIGNAL(objectUnpacked(UAVObject*)), this, SLOT(snapshotUnpacked(UAVObject*)));
+    foreach (UAVObject *obj, queue) {
+        foreach (UAVObject *inst, objMngr->getObjectInstancesVector(obj->getObjID()))
+            disconnect(inst, SIGNAL(objectUnpacked(UAVObject*)), this, SLOT(snapshotObjectUnpacked(UAVObject*)));
+    }
+
+    if (connectionStatus != CON_RETRIEVING_OBJECTS) {
+        snapshotPending.clear();
+        return;
+    }
+
+    // Keep the objects with an instance still outstanding, in their original order
+    QQueue<UAVObject *> missing;
+    foreach (UAVObject *obj, queue) {
+        UAVDataObject *dobj = dynamic_cast<UAVDataObject *>(obj);
+        if (unchanged && (dobj == NULL || dobj->isSettings()))
+            continue;
+
+        foreach (UAVObject *inst, objMngr->getObjectInstancesVector(obj->getObjID())) {
+            if (snapshotPending.contains(inst)) {
+                missing.enqueue(obj);
+                break;
+            }
+        }
+    }
+    snapshotPending.clear();
+
+    TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 snapshot finished, %1 of %2 objects missing").arg(Q_FUNC_INFO).arg(missing.length()).arg(queue.length()));
+    queue = missing;
+    objectRetrieveTimeout->start(OBJECT_RETRIEVE_TIMEOUT);
+    retrieveNextObject();
+}
+
+/**
+ * Hash of the settings and metadata the GCS holds for the queued objects,
+ * computed as the autopilot does: a CRC of each instance's ID and data,
+ * combined so that the order of the objects does not matter.
+ */
+quint32 TelemetryMonitor::snapshotHash()
+{
+    quint32 hash = 0;
+
+    foreach (UAVObject *obj, queue) {
+        UAVDataObject *dobj = dynamic_cast<UAVDataObject *>(obj);
+        if (dobj != NULL && !dobj->isSettings())
+            continue;
+
+        foreach (UAVObject *inst, objMngr->getObjectInstancesVector(obj->getObjID())) {
+            quint32 objId = inst->getObjID();
+            quint32 instId = inst->getInstID();
+            QByteArray data(6 + inst->getNumBytes(), 0);
+
+            data[0] = objId;
+            data[1] = objId >> 8;
+            data[2] = objId >> 16;
+            data[3] = objId >> 24;
+            data[4] = instId;
+            data[5] = instId >> 8;
+            inst->pack((quint8 *)data.data() + 6);
+
+            // CRC-32 with the 0x04C11DB7 polynomial, unreflected, as PIOS_CRC32_updateCRC()
+            quint32 crc = 0;
+            foreach (char byte, data) {
+                crc ^= (quint32)(quint8)byte << 24;
+                for (int bit = 0; bit < 8; bit++)
+                    crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+            }
+            hash ^= crc;
+        }
+    }
+
+    return hash;
+}
+
+void TelemetryMonitor::snapshotObjectUnpacked(UAVObject *obj)
+{
+    snapshotPending.remove(obj);
+    snapshotTimeout->start(SNAPSHOT_TIMEOUT);
+}
+
+/**
+ * Called when the autopilot reports the snapshot has been sent
+ */
+void TelemetryMonitor::snapshotUnpacked(UAVObject *obj)
+{
+    Q_UNUSED(obj);
+
+    if (snapshotObj->getRequest() != snapshotRequest || snapshotObj->getStatus() == SettingsSnapshot::STATUS_REQUEST)
+        return;
+
+    TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 autopilot sent %1 objects").arg(Q_FUNC_INFO).arg(snapshotObj->getObjectCount()));
+    finishSnapshot(snapshotObj->getStatus() == SettingsSnapshot::STATUS_UNCHANGED);
+}
+
+void TelemetryMonitor::snapshotTimeoutCB()
+{
+    TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 snapshot timed out").arg(Q_FUNC_INFO));
+    finishSnapshot(false);
+}
+
 void TelemetryMonitor::changeObjectInstances(quint32 objID, quint32 instID, bool delayed)
 {
     TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 OBJID:%1 INSTID:%2").arg(Q_FUNC_INFO).arg(objID).arg(instID));
@@ -38,6 +38,7 @@
 
 #include <QObject>
 #include <QQueue>
+#include <QSet>
 #include <QTimer>
 #include <QTime>
 #include "uavobjectmanager.h"
@@ -46,6 +47,7 @@
 #include "systemstats.h"
 #include "telemetry.h"
 #include "sessionmanaging.h"
+#include "settingssnapshot.h"
 #include <coreplugin/generalsettings.h>
 #include <extensionsystem/pluginmanager.h>
 
@@ -80,6 +82,9 @@ private slots:
     void sessionInitialRetrieveTimeoutCB();
     void saveSession();
     void newInstanceSlot(UAVObject*);
+    void snapshotObjectUnpacked(UAVObject *obj);
+    void snapshotUnpacked(UAVObject *obj);
+    void snapshotTimeoutCB();
 private:
     QList<UAVDataObject *> delayedUpdate;
     enum connectionStatusEnum {CON_DISCONNECTED, CON_INITIALIZING, CON_SESSION_INITIALIZING, CON_RETRIEVING_OBJECTS, CON_CONNECTED_UNMANAGED,CON_CONNECTED_MANAGED};
@@ -109,6 +114,13 @@ private:
     bool isManaged;
     QHash<quint16, QList<objStruc> > sessions;
     int sessionObjRetries;
+    SettingsSnapshot *snapshotObj;
+    QTimer *snapshotTimeout;
+    QSet<UAVObject *> snapshotPending;  //!< Instances not yet received in the snapshot
+    quint16 snapshotRequest;
+    bool startSnapshot();
+    void finishSnapshot(bool unchanged);
+    quint32 snapshotHash();
     Core::Internal::GeneralSettings *settings;
 };
 
@@ -46,7 +46,6 @@
   #define UAVTALK_QXTLOG_DEBUG(...)
 #endif	// UAVTALK_DEBUG
 
-#define SYNC_VAL 0x3C
 
 const quint8 UAVTalk::crc_table[256] = {
     0x00, 0x07, 0x0e, 0x09, 0x1c, 0x1b, 0x12, 0x15, 0x38, 0x3f, 0x36, 0x31, 0x24, 0x23, 0x2a, 0x2d,
@@ -445,13 +444,19 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
                 break;
             }
 
-                receiveObject(rxType, rxObjId, rxInstId, rxBuffer, rxLength);
+            {
+                static const QMetaMethod frameSignal = QMetaMethod::fromSignal(&UAVTalk::frameReceived);
+
+                bool accepted = receiveObject(rxType, rxObjId, rxInstId, rxBuffer, rxLength);
+                if (accepted && isSignalConnected(frameSignal))
+                    emit frameReceived(rxObjId, receivedFrame());
                 if(useUDPMirror)
                 {
                     udpSocketTx->writeDatagram(rxDataArray,QHostAddress::LocalHost,udpSocketRx->localPort());
                 }
                 stats.rxObjectBytes += rxLength;
                 stats.rxObjects++;
+            }
 
             rxState = STATE_SYNC;
             UAVTALK_QXTLOG_DEBUG("UAVTalk: CSum->Sync (OK)");
@@ -596,6 +601,29 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8*
     return !error;
 }
 
+/**
+ * Rebuild the frame that was just validated from the parsed header fields
+ * and payload, as it appeared on the link.
+ * \return The complete frame, including the checksum
+ */
+QByteArray UAVTalk::receivedFrame()
+{
+    qint32 headerLength = packetSize - rxLength;
+    QByteArray frame(packetSize + CHECKSUM_LENGTH, Qt::Uninitialized);
+    quint8 *buf = (quint8 *)frame.data();
+
+    buf[0] = SYNC_VAL;
+    buf[1] = rxType;
+    qToLittleEndian<quint16>(packetSize, &buf[2]);
+    qToLittleEndian<quint32>(rxObjId, &buf[4]);
+    if (headerLength == MAX_HEADER_LENGTH)
+        qToLittleEndian<quint16>(rxInstId, &buf[8]);
+    memcpy(&buf[headerLength], rxBuffer, rxLength);
+    buf[packetSize] = rxCSPacket;
+
+    return frame;
+}
+
 /**
  * Update the data of an object from a byte array (unpack).
  * If the object instance could not be found in the list, then a
@@ -744,6 +772,48 @@ bool UAVTalk::transmitNack(quint32 objId)
  * \return Success (true), Failure (false)
  */
 bool UAVTalk::transmitSingleObject(UAVObject* obj, quint8 type, bool allInstances)
+{
+    qint32 frameLength = packSingleObject(obj, type, allInstances, txBuffer);
+
+    if (frameLength < 0)
+    {
+        return false;
+    }
+
+    // Send buffer, check that the transmit backlog does not grow above limit
+    if (!io.isNull() && io->isWritable() && io->bytesToWrite() < TX_BUFFER_SIZE )
+    {
+        io->write((const char*)txBuffer, frameLength);
+        if(useUDPMirror)
+        {
+            udpSocketRx->writeDatagram((const char*)txBuffer,frameLength,QHostAddress::LocalHost,udpSocketTx->localPort());
+        }
+    }
+    else
+    {
+        ++stats.txErrors;
+        return false;
+    }
+
+    // Update stats
+    ++stats.txObjects;
+    stats.txBytes += frameLength;
+    stats.txObjectBytes += frameLength - CHECKSUM_LENGTH -
+            (obj->isSingleInstance() ? MIN_HEADER_LENGTH : MAX_HEADER_LENGTH);
+
+    // Done
+    return true;
+}
+
+/**
+ * Serialize an object into a frame, without sending it.
+ * \param[in] obj Object handle to pack
+ * \param[in] type Transaction type
+ * \param[in] allInstances True to address all instances (requests only)
+ * \param[out] buf Buffer of at least MAX_PACKET_LENGTH bytes
+ * \return The frame length including the checksum, or -1 on failure
+ */
+qint32 UAVTalk::packSingleObject(UAVObject* obj, quint8 type, bool allInstances, quint8* buf)
 {
     qint32 length;
     qint32 dataOffset;
@@ -753,9 +823,9 @@ bool UAVTalk::transmitSingleObject(UAVObject* obj, quint8 type, bool allInstance
 
     // Setup type and object id fields
     objId = obj->getObjID();
-    txBuffer[0] = SYNC_VAL;
-    txBuffer[1] = type;
-    qToLittleEndian<quint32>(objId, &txBuffer[4]);
+    buf[0] = SYNC_VAL;
+    buf[1] = type;
+    qToLittleEndian<quint32>(objId, &buf[4]);
 
     // Setup instance ID if one is required
     if ( obj->isSingleInstance() )
@@ -767,12 +837,12 @@ bool UAVTalk::transmitSingleObject(UAVObject* obj, quint8 type, bool allInstance
         // Check if all instances are requested
         if (allInstances)
         {
-            qToLittleEndian<quint16>(allInstId, &txBuffer[8]);
+            qToLittleEndian<quint16>(allInstId, &buf[8]);
         }
         else
         {
             instId = obj->getInstID();
-            qToLittleEndian<quint16>(instId, &txBuffer[8]);
+            qToLittleEndian<quint16>(instId, &buf[8]);
         }
         dataOffset = 10;
     }
@@ -790,45 +860,43 @@ bool UAVTalk::transmitSingleObject(UAVObject* obj, quint8 type, bool allInstance
     // Check length
     if (length >= MAX_PAYLOAD_LENGTH)
     {
-        return false;
+        return -1;
     }
 
     // Copy data (if any)
     if (length > 0)
     {
-        if ( !obj->pack(&txBuffer[dataOffset]) )
+        if ( !obj->pack(&buf[dataOffset]) )
         {
-            return false;
+            return -1;
         }
     }
 
-    qToLittleEndian<quint16>(dataOffset + length, &txBuffer[2]);
+    qToLittleEndian<quint16>(dataOffset + length, &buf[2]);
 
     // Calculate checksum
-    txBuffer[dataOffset+length] = updateCRC(0, txBuffer, dataOffset + length);
+    buf[dataOffset+length] = updateCRC(0, buf, dataOffset + length);
 
-    // Send buffer, check that the transmit backlog does not grow above limit
-    if (!io.isNull() && io->isWritable() && io->bytesToWrite() < TX_BUFFER_SIZE )
-    {
-        io->write((const char*)txBuffer, dataOffset+length+CHECKSUM_LENGTH);
-        if(useUDPMirror)
-        {
-            udpSocketRx->writeDatagram((const char*)txBuffer,dataOffset+length+CHECKSUM_LENGTH,QHostAddress::LocalHost,udpSocketTx->localPort());
-        }
-    }
-    else
+    return dataOffset + length + CHECKSUM_LENGTH;
+}
+
+/**
+ * Serialize the current data of an object as a TYPE_OBJ frame, e.g. to
+ * forward it on a link other than the one this instance talks on.
+ * \param[in] obj Object handle to pack
+ * \return The frame, or an empty array if the object can not be packed
+ */
+QByteArray UAVTalk::packObjectFrame(UAVObject* obj)
+{
+    quint8 buf[MAX_PACKET_LENGTH];
+    qint32 frameLength = packSingleObject(obj, TYPE_OBJ, false, buf);
+
+    if (frameLength < 0)
     {
-        ++stats.txErrors;
-        return false;
+        return QByteArray();
     }
 
-    // Update stats
-    ++stats.txObjects;
-    stats.txBytes += dataOffset+length+CHECKSUM_LENGTH;
-    stats.txObjectBytes += length;
-
-    // Done
-    return true;
+    return QByteArray((const char*)buf, frameLength);
 }
 
 /**
@@ -69,19 +69,12 @@ public:
 
     bool processInputByte(quint8 rxbyte);
 
-signals:
-    // The only signals we send to the upper level are when we
-    // either receive an ACK or a NACK for a request.
-    void ackReceived(UAVObject* obj);
-    void nackReceived(UAVObject* obj);
+    static QByteArray packObjectFrame(UAVObject* obj);
+    static quint8 updateCRC(quint8 crc, const quint8 data);
+    static quint8 updateCRC(quint8 crc, const quint8* data, qint32 length);
 
-private slots:
-    void processInputStream(void);
-    void dummyUDPRead();
-
-protected:
-
-    // Constants
+    // Framing constants, also used to parse frames from logs
+    static const quint8 SYNC_VAL = 0x3C;
     static const int TYPE_MASK = 0xF8;
     static const int TYPE_VER = 0x20;
     static const int TYPE_OBJ = (TYPE_VER | 0x00);
@@ -99,6 +92,24 @@ protected:
 
     static const int MAX_PACKET_LENGTH = (MAX_HEADER_LENGTH + MAX_PAYLOAD_LENGTH + CHECKSUM_LENGTH);
 
+signals:
+    // The only signals we send to the upper level are when we
+    // either receive an ACK or a NACK for a request.
+    void ackReceived(UAVObject* obj);
+    void nackReceived(UAVObject* obj);
+
+    //! Emitted with the raw bytes of each frame that passed validation and
+    //! was accepted by receiveObject(), so it can be forwarded unchanged.
+    //! The frame is only rebuilt when something is connected.
+    void frameReceived(quint32 objId, const QByteArray &frame);
+
+private slots:
+    void processInputStream(void);
+    void dummyUDPRead();
+
+protected:
+
+    // Constants
     static const quint16 ALL_INSTANCES = 0xFFFF;
     static const quint16 OBJID_NOTFOUND = 0x0000;
 
@@ -136,11 +147,11 @@ protected:
     bool objectTransaction(UAVObject* obj, quint8 type, bool allInstances);
     virtual bool receiveObject(quint8 type, quint32 objId, quint16 instId, quint8* data, qint32 length);
     UAVObject* updateObject(quint32 objId, quint16 instId, quint8* data);
+    QByteArray receivedFrame();
     bool transmitNack(quint32 objId);
     bool transmitObject(UAVObject* obj, quint8 type, bool allInstances);
     bool transmitSingleObject(UAVObject* obj, quint8 type, bool allInstances);
-    quint8 updateCRC(quint8 crc, const quint8 data);
-    quint8 updateCRC(quint8 crc, const quint8* data, qint32 length);
+    static qint32 packSingleObject(UAVObject* obj, quint8 type, bool allInstances, quint8* buf);
 };
 
 #endif // UAVTALK_H
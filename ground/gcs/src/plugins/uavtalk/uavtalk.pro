@@ -1,4 +1,4 @@
-QT += network
+QT += network testlib
 QT += widgets
 TEMPLATE = lib
 TARGET = UAVTalk
@@ -29,6 +29,46 @@
 #include <coreplugin/icore.h>
 #include <coreplugin/connectionmanager.h>
 
+#include <QBuffer>
+#include <QFile>
+#include <QTest>
+
+/**
+ * Reads the received UAVTalk stream out of a log saved by the logging
+ * plugin: a text header ending in "##", then packets of a timestamp, a size
+ * and the bytes received
+ * @returns the bytes received, empty if the log could not be read
+ */
+static QByteArray readLoggedTelemetry(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    QByteArray log = file.readAll();
+    int header = log.indexOf("\n##\n");
+    if (header < 0)
+        return QByteArray();
+
+    const qint64 packetHeaderSize = sizeof(quint32) + sizeof(qint64);
+    qint64 pos = header + 4;
+    QByteArray stream;
+
+    while (pos + packetHeaderSize <= log.size()) {
+        qint64 size;
+        memcpy(&size, log.constData() + pos + sizeof(quint32), sizeof(size));
+        pos += packetHeaderSize;
+
+        if (size < 1 || pos + size > log.size())
+            break;
+
+        stream.append(log.constData() + pos, size);
+        pos += size;
+    }
+
+    return stream;
+}
+
 UAVTalkPlugin::UAVTalkPlugin()
 {
 
@@ -84,3 +124,34 @@ void UAVTalkPlugin::onDeviceDisconnect()
 {
     telMngr->stop();
 }
+
+/**
+ * Decode and dispatch of a recorded telemetry stream, byte by byte through
+ * UAVTalk into the objects and whatever is connected to them, as when it
+ * arrives from a flight controller.  The stream is taken from a log saved
+ * by the logging plugin while connected at a high telemetry rate, named by
+ * UAVTALK_BENCHMARK_LOG; it must have been made with the same objects.
+ */
+void UAVTalkPlugin::testDecodeDispatch()
+{
+    QString path = QString::fromLocal8Bit(qgetenv("UAVTALK_BENCHMARK_LOG"));
+    if (path.isEmpty())
+        QSKIP("UAVTALK_BENCHMARK_LOG names no telemetry log to benchmark with");
+
+    QByteArray stream = readLoggedTelemetry(path);
+    QVERIFY2(!stream.isEmpty(), qPrintable(path));
+
+    // Nothing is read from the device, the stream is fed in directly
+    QBuffer device;
+    UAVTalk talk(&device, objMngr);
+
+    QBENCHMARK {
+        for (int i = 0; i < stream.size(); i++)
+            talk.processInputByte((quint8) stream.at(i));
+    }
+
+    UAVTalk::ComStats stats = talk.getStats();
+    qDebug() << stream.size() << "bytes," << stats.rxObjects << "objects dispatched,"
+             << stats.rxErrors << "errors";
+    QVERIFY(stats.rxObjects > 0);
+}
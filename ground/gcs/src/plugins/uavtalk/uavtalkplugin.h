@@ -56,6 +56,9 @@ protected slots:
 private:
     UAVObjectManager* objMngr;
     TelemetryManager* telMngr;
+
+private slots:
+    void testDecodeDispatch();
 };
 
 #endif // UAVTALKPLUGIN_H
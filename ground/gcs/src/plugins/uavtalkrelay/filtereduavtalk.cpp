@@ -31,23 +31,132 @@
 FilteredUavTalk::FilteredUavTalk(QIODevice *iodev, UAVObjectManager *objMngr,
                                  QHash<quint32,UavTalkRelayComon::accessType> rules,
                                  UavTalkRelayComon::accessType defaultRule) :
-    UAVTalk(iodev,objMngr),m_rules(rules),m_defaultRule(defaultRule)
+    UAVTalk(iodev,objMngr),m_rules(rules),m_defaultRule(defaultRule),m_droppedFrames(0),
+    m_applyingUpdate(false)
 {
+    connect(iodev, SIGNAL(bytesWritten(qint64)), this, SLOT(flushPending()));
 }
 
 /**
- * @brief FilteredUavTalk::sendObjectSlot Called whenever an object is updated by
- * the local GCS and sends it to the remote GCS is the rules allow it.
- * @param obj The UAVObject to possibly send
+ * @brief FilteredUavTalk::sendFrame Sends a frame received or packed elsewhere to the
+ * remote GCS if the rules allow it.  A slave which can not keep up does not queue without
+ * bound: only the latest frame of each object instance is held, and sent once the backlog
+ * clears.  Periodic updates are superseded in the meantime, and settings and on change
+ * objects still arrive in their latest state.
+ * @param objId The ID of the object in the frame
+ * @param frame The frame, as returned by toRelayedFrame
+ * @return True if the frame was queued or held, false if it was filtered
  */
-void FilteredUavTalk::sendObjectSlot(UAVObject *obj)
+bool FilteredUavTalk::sendFrame(quint32 objId, const QByteArray &frame)
 {
-    UavTalkRelayComon::accessType access=m_rules.value(obj->getObjID(),m_defaultRule);
+    UavTalkRelayComon::accessType access=m_rules.value(objId,m_defaultRule);
     if(access==UavTalkRelayComon::WriteOnly || access==UavTalkRelayComon::None)
+        return false;
+    if(objId==GCSTelemetryStats::OBJID)
+        return false;
+
+    if (io.isNull() || !io->isWritable())
+    {
+        ++stats.txErrors;
+        return false;
+    }
+
+    flushPending();
+
+    // Hold the frame while anything is held for the same instance too, so
+    // the slave never sees an older frame after a newer one
+    quint64 key = instanceKey(objId, frame);
+    if (io->bytesToWrite() > MAX_BACKLOG || m_pending.contains(key))
+    {
+        if (m_pending.contains(key))
+            ++m_droppedFrames;
+        else
+            m_pendingOrder.append(key);
+        m_pending.insert(key, frame);
+        return true;
+    }
+
+    io->write(frame);
+
+    ++stats.txObjects;
+    stats.txBytes += frame.size();
+
+    return true;
+}
+
+/**
+ * @brief FilteredUavTalk::flushPending Sends the held frames, oldest first, until the
+ * backlog is full again
+ */
+void FilteredUavTalk::flushPending()
+{
+    if (io.isNull() || !io->isWritable())
         return;
-    if(obj==GCSTelemetryStats::GetInstance(objMngr))
-        return;
-    sendObject(obj,false,false);
+
+    while (!m_pendingOrder.isEmpty() && io->bytesToWrite() <= MAX_BACKLOG)
+    {
+        QByteArray frame = m_pending.take(m_pendingOrder.takeFirst());
+
+        io->write(frame);
+
+        ++stats.txObjects;
+        stats.txBytes += frame.size();
+    }
+}
+
+/**
+ * @brief FilteredUavTalk::instanceKey Identifies the object instance a frame updates
+ * @param objId The ID of the object in the frame
+ * @param frame The frame
+ * @return The object ID and, for multi-instance objects, the instance ID
+ */
+quint64 FilteredUavTalk::instanceKey(quint32 objId, const QByteArray &frame)
+{
+    quint64 key = (quint64)objId << 16;
+
+    UAVObject *obj = objMngr->getObject(objId);
+    if (obj && !obj->isSingleInstance() && frame.size() >= MAX_HEADER_LENGTH)
+        key |= (quint8)frame.at(MIN_HEADER_LENGTH) |
+                ((quint8)frame.at(MIN_HEADER_LENGTH + 1) << 8);
+
+    return key;
+}
+
+/**
+ * @brief FilteredUavTalk::metaObjectUpdated Metadata changed by the slave is sent on
+ * to the autopilot as a manual update.  The other slaves already get the frame it came
+ * in, so the relay is kept from sending it to everyone again, the slave included.
+ * @param obj The metaobject the slave updated
+ */
+void FilteredUavTalk::metaObjectUpdated(UAVObject *obj)
+{
+    m_applyingUpdate = true;
+    obj->updated();
+    m_applyingUpdate = false;
+}
+
+/**
+ * @brief FilteredUavTalk::toRelayedFrame Object updates are relayed, everything else
+ * (requests, acks and nacks) is between the master and one peer only.  Acked updates
+ * are acknowledged by the master, so they reach the slaves as plain updates.
+ * @param frame A validated frame
+ * @return The frame to relay, or an empty array if it should not be relayed
+ */
+QByteArray FilteredUavTalk::toRelayedFrame(const QByteArray &frame)
+{
+    quint8 type = frame.at(1);
+
+    if (type == TYPE_OBJ)
+        return frame;
+    if (type != TYPE_OBJ_ACK)
+        return QByteArray();
+
+    QByteArray relayed(frame);
+    quint8 *buf = (quint8 *)relayed.data();
+    buf[1] = TYPE_OBJ;
+    buf[relayed.size() - CHECKSUM_LENGTH] = updateCRC(0, buf, relayed.size() - CHECKSUM_LENGTH);
+
+    return relayed;
 }
 
 /**
@@ -81,13 +190,10 @@ bool FilteredUavTalk::receiveObject(quint8 type, quint32 objId, quint16 instId,
         {
             // Get object and update its data
             UAVObject* tobj = objMngr->getObject(objId);
-            bool wasCon=disconnect(tobj, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(sendObjectSlot(UAVObject*)));
             obj = updateObject(objId, instId, data);
-            if(wasCon)
-                connect(tobj, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(sendObjectSlot(UAVObject*)));
             UAVMetaObject * mobj=dynamic_cast<UAVMetaObject*>(tobj);
             if(mobj)
-                tobj->updated();
+                metaObjectUpdated(tobj);
             if (obj == NULL)
                 error = true;
         }
@@ -102,13 +208,10 @@ bool FilteredUavTalk::receiveObject(quint8 type, quint32 objId, quint16 instId,
         {
             // Get object and update its data
             UAVObject* tobj = objMngr->getObject(objId);
-            bool wasCon=disconnect(tobj, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(sendObjectSlot(UAVObject*)));
             obj = updateObject(objId, instId, data);
-            if(wasCon)
-                connect(tobj, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(sendObjectSlot(UAVObject*)));
             UAVMetaObject * mobj=dynamic_cast<UAVMetaObject*>(tobj);
             if(mobj)
-                tobj->updated();
+                metaObjectUpdated(tobj);
             // Transmit ACK
             if ( obj != NULL )
             {
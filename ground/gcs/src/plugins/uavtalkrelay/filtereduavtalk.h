@@ -29,12 +29,16 @@
 
 #include "../uavtalk/uavtalk.h"
 #include <QHash>
+#include <QList>
 #include "uavtalkrelay_global.h"
 
 /**
  * @brief The FilteredUavTalk class An extension of the UAVTalk class to be run on the master
  * GCS (the one which also has a connection to the UAV) which will relay object updates to
  * a slave GCS subject to certain filtering rules which this class enforces.
+ *
+ * Updates are relayed as the raw frames they arrived in, so each one is validated and
+ * serialized once however many slaves are connected.
  */
 class UAVTALKRELAY_EXPORT FilteredUavTalk:public UAVTalk
 {
@@ -45,14 +49,39 @@ public:
     //! Called when an uavtalk packet is received from the slave.  Updates master based on filtering rules
     bool receiveObject(quint8 type, quint32 objId, quint16 instId, quint8* data, qint32 length);
 
-public slots:
-    //! Called whenever an object is updated either locally in the master GCS or from the main
-    //! telemetry connection, but NOT as a consquence of the receiveObject method
-    void sendObjectSlot(UAVObject *obj);
+    //! Sends a frame to the slave if the rules allow it, or holds it until the slave catches up
+    bool sendFrame(quint32 objId, const QByteArray &frame);
+
+    //! Number of frames superseded by a newer one while the slave was not keeping up
+    quint32 droppedFrames() const { return m_droppedFrames; }
+
+    //! Whether an update from the slave is being applied, it is relayed as the frame
+    //! it arrived in and must not be relayed again as a local update
+    bool applyingUpdate() const { return m_applyingUpdate; }
+
+    //! Converts a validated frame to the form it is relayed in, or an empty array if
+    //! it is not relayed at all
+    static QByteArray toRelayedFrame(const QByteArray &frame);
+
+private slots:
+    //! Sends the held frames as far as the backlog allows
+    void flushPending();
 
 private:
+    //! Most bytes queued for a slave before further frames to it are held
+    static const qint64 MAX_BACKLOG = 32*1024;
+
+    quint64 instanceKey(quint32 objId, const QByteArray &frame);
+    void metaObjectUpdated(UAVObject *obj);
+
     QHash<quint32,UavTalkRelayComon::accessType> m_rules;
     UavTalkRelayComon::accessType m_defaultRule;
+    quint32 m_droppedFrames;
+    bool m_applyingUpdate;
+
+    //! The latest held frame of each object instance, and the order they were first held in
+    QHash<quint64,QByteArray> m_pending;
+    QList<quint64> m_pendingOrder;
 };
 
 #endif // FILTEREDUAVTALK_H
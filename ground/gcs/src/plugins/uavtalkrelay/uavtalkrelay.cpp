@@ -27,11 +27,24 @@
 
 #include "uavtalkrelay.h"
 #include "QMessageBox"
-#include <QPointer>
 #include "filtereduavtalk.h"
+#include "../uavtalk/telemetrymanager.h"
 
 UavTalkRelay::UavTalkRelay(UAVObjectManager *ObjMngr, QString IpAdress, quint16 Port,QHash<QString,QHash<quint32,UavTalkRelayComon::accessType> > rules,UavTalkRelayComon::accessType defaultRule):m_IpAddress(IpAdress),m_Port(Port),m_ObjMngr(ObjMngr),m_rules(rules),m_DefaultRule(defaultRule)
 {
+    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+    TelemetryManager *telMngr = pm->getObject<TelemetryManager>();
+    if (telMngr)
+        connect(telMngr, SIGNAL(frameReceived(quint32,QByteArray)), this, SLOT(telemetryFrameReceived(quint32,QByteArray)));
+
+    // Updates from the autopilot and from slaves arrive as frames, only the ones
+    // made in this GCS have to be packed
+    connect(m_ObjMngr, SIGNAL(newObject(UAVObject*)), this, SLOT(newObject(UAVObject*)));
+    connect(m_ObjMngr, SIGNAL(newInstance(UAVObject*)), this, SLOT(newObject(UAVObject*)));
+    foreach (QVector<UAVObject*> instances, m_ObjMngr->getObjectsVector())
+        foreach (UAVObject *obj, instances)
+            newObject(obj);
+
     tcpServer = new QTcpServer(this);
     // if we did not find one, use IPv4 localhost
     if (m_IpAddress.isEmpty())
@@ -79,23 +92,75 @@ void UavTalkRelay::newConnection()
     qDebug()<<clientConnection->peerAddress().toString();
     QHash<quint32,UavTalkRelayComon::accessType> temp= m_rules.value(clientConnection->peerAddress().toString());
     temp.unite(m_rules.value("*"));
-    QPointer<FilteredUavTalk> uav=new FilteredUavTalk(clientConnection,m_ObjMngr,temp,m_DefaultRule);
-    uavTalkList.append(uav);
+    FilteredUavTalk *uav=new FilteredUavTalk(clientConnection,m_ObjMngr,temp,m_DefaultRule);
+    m_clients.append(uav);
+    connect(uav, SIGNAL(frameReceived(quint32,QByteArray)),
+            this, SLOT(clientFrameReceived(quint32,QByteArray)));
+    connect(uav, SIGNAL(destroyed(QObject*)),
+            this, SLOT(clientDestroyed(QObject*)));
     connect(clientConnection, SIGNAL(disconnected()),
             uav, SLOT(deleteLater()));
-    QVector< QVector<UAVObject*> > list = m_ObjMngr->getObjectsVector();
-    QVector< QVector<UAVObject*> >::const_iterator i;
-    QVector<UAVObject*>::const_iterator j;
-    int objects = 0;
+}
+
+void UavTalkRelay::clientDestroyed(QObject *client)
+{
+    // Only the address is compared, the object is already half destroyed
+    m_clients.removeAll(static_cast<FilteredUavTalk *>(client));
+}
+
+void UavTalkRelay::newObject(UAVObject *obj)
+{
+    connect(obj, SIGNAL(objectUpdatedAuto(UAVObject*)), this, SLOT(localObjectUpdated(UAVObject*)));
+    connect(obj, SIGNAL(objectUpdatedManual(UAVObject*)), this, SLOT(localObjectUpdated(UAVObject*)));
+}
+
+void UavTalkRelay::telemetryFrameReceived(quint32 objId, const QByteArray &frame)
+{
+    relayFrame(objId, frame, NULL);
+}
+
+void UavTalkRelay::clientFrameReceived(quint32 objId, const QByteArray &frame)
+{
+    relayFrame(objId, frame, qobject_cast<FilteredUavTalk *>(sender()));
+}
+
+void UavTalkRelay::localObjectUpdated(UAVObject *obj)
+{
+    if (m_clients.isEmpty())
+        return;
+
+    // Updates from a slave are relayed as the frames they arrived in
+    foreach (FilteredUavTalk *client, m_clients)
+    {
+        if (client->applyingUpdate())
+            return;
+    }
+
+    QByteArray frame = UAVTalk::packObjectFrame(obj);
+    if (!frame.isEmpty())
+        relayFrame(obj->getObjID(), frame, NULL);
+}
+
+/**
+ * @brief UavTalkRelay::relayFrame Forwards a validated frame to every slave but the
+ * one it came from.  Each slave applies its own rules and, when it falls behind, holds
+ * only the latest frame of each object, so a slow slave does not hold up the others.
+ * @param objId The ID of the object in the frame
+ * @param frame The frame as received
+ * @param origin The slave the frame came from, or NULL
+ */
+void UavTalkRelay::relayFrame(quint32 objId, const QByteArray &frame, FilteredUavTalk *origin)
+{
+    if (m_clients.isEmpty())
+        return;
+
+    QByteArray relayed = FilteredUavTalk::toRelayedFrame(frame);
+    if (relayed.isEmpty())
+        return;
 
-    const QVector< QVector<UAVObject*> >::iterator iEnd = list.end();
-    for (i = list.constBegin(); i != iEnd; ++i)
+    foreach (FilteredUavTalk *client, m_clients)
     {
-        QVector<UAVObject*>::const_iterator jEnd = (*i).constEnd();
-        for (j = (*i).constBegin(); j != jEnd; ++j)
-        {
-            connect(*j, SIGNAL(objectUpdated(UAVObject*)), uav.data(), SLOT(sendObjectSlot(UAVObject*)));
-            objects++;
-        }
+        if (client != origin)
+            client->sendFrame(objId, relayed);
     }
 }
@@ -35,6 +35,12 @@
 #include "uavtalkrelay_global.h"
 
 class FilteredUavTalk;
+
+/**
+ * @brief The UavTalkRelay class Accepts slave GCS connections and fans out the frames
+ * received from the autopilot, from the other slaves and the updates made locally to
+ * each of them, subject to that slave's rules.
+ */
 class UavTalkRelay: public QObject
 {
     Q_OBJECT
@@ -48,7 +54,14 @@ public:
     void restartServer();
 private slots:
     void newConnection();
+    void clientDestroyed(QObject *client);
+    void newObject(UAVObject *obj);
+    void telemetryFrameReceived(quint32 objId, const QByteArray &frame);
+    void clientFrameReceived(quint32 objId, const QByteArray &frame);
+    void localObjectUpdated(UAVObject *obj);
 private:
+    void relayFrame(quint32 objId, const QByteArray &frame, FilteredUavTalk *origin);
+
     QString m_IpAddress;
     quint16 m_Port;
     QTcpServer *tcpServer;
@@ -57,7 +70,7 @@ private:
     UAVObjectManager * m_ObjMngr;
     QHash<QString,QHash<quint32,UavTalkRelayComon::accessType> > m_rules;
     UavTalkRelayComon::accessType m_DefaultRule;
-    QList< QPointer<FilteredUavTalk> > uavTalkList;
+    QList<FilteredUavTalk *> m_clients;
 };
 
 #endif // UAVTALKRELAY_H
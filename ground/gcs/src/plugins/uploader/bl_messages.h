@@ -63,6 +63,10 @@ enum bl_commands {
     BL_MSG_STATUS_REQ,
     BL_MSG_STATUS_REP,
     BL_MSG_WIPE_PARTITION,
+    BL_MSG_BLOCK_CRC_REQ,
+    BL_MSG_BLOCK_CRC_REP,
+    BL_MSG_WRITE_START_DIFF,
+    BL_MSG_WRITE_ACK,
 
     BL_MSG_WRITE_START = 0x27, // f1 bl masks with 0b11111 so this looks like BL_MSG_WRITE_CONT there
                                // the 6th bit ends up being start flag
@@ -135,6 +139,8 @@ struct msg_capabilities_rep_specific {
 #define BL_CAP_EXTENSION_MAGIC 0x3456
 	uint16_t cap_extension_magic;
 	uint32_t partition_sizes[10];
+#define BL_XFER_FEATURE_DIFFERENTIAL 0x01 /* BLOCK_CRC_REQ, WRITE_START_DIFF */
+	uint8_t xfer_features;
 #endif	/* BL_INCLUDE_CAP_EXTENSIONS */
 };
 
@@ -187,6 +193,40 @@ struct msg_wipe_partition {
 	uint8_t label;
 };
 
+PACK(struct msg_block_crc_req {
+	uint8_t label;
+	uint16_t first_block;
+});
+
+struct msg_block_crc {
+	uint32_t size;
+	uint32_t crc;
+};
+
+#define BL_BLOCK_CRCS_PER_PACKET 7
+PACK(struct msg_block_crc_rep {
+	uint8_t label;
+	uint16_t first_block;
+	uint16_t total_blocks;
+	uint8_t num_blocks;
+	struct msg_block_crc blocks[BL_BLOCK_CRCS_PER_PACKET];
+});
+
+#define BL_MAX_DIFF_BLOCKS 384
+PACK(struct msg_xfer_start_diff {
+	uint32_t packets_in_transfer;
+	uint8_t label;
+	uint8_t words_in_last_packet;
+	uint32_t expected_crc;
+	uint8_t window; /* packets sent ahead of an ack, 0 for no acks */
+	uint8_t block_map[BL_MAX_DIFF_BLOCKS / 8]; /* blocks to rewrite */
+});
+
+PACK(struct msg_write_ack {
+	uint32_t next_packet_number;
+	uint8_t rejected; /* a packet was out of sequence */
+});
+
 PACK(union msg_contents {
     struct msg_capabilities_req cap_req;
     struct msg_capabilities_rep_all cap_rep_all;
@@ -201,6 +241,10 @@ PACK(union msg_contents {
     struct msg_status_req status_req;
     struct msg_status_rep status_rep;
     struct msg_wipe_partition wipe_partition;
+    struct msg_block_crc_req block_crc_req;
+    struct msg_block_crc_rep block_crc_rep;
+    struct msg_xfer_start_diff xfer_start_diff;
+    struct msg_write_ack write_ack;
     uint8_t pad[62];
 });
 
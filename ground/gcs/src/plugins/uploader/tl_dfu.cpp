@@ -36,6 +36,11 @@
 #include <QApplication>
 #include <QThread>
 
+#include <algorithm>
+
+// Packets sent ahead of the bootloader acknowledging them
+#define DIFF_UPLOAD_WINDOW 32
+
 #define TL_DFU_DEBUG
 #ifdef TL_DFU_DEBUG
 #define TL_DFU_QXTLOG_DEBUG(...) qDebug()<<__VA_ARGS__
@@ -45,7 +50,7 @@
 
 using namespace tl_dfu;
 
-DFUObject::DFUObject() : m_hidHandle(NULL)
+DFUObject::DFUObject() : m_hidHandle(NULL), m_xferFeatures(0)
 {
     qRegisterMetaType<tl_dfu::Status>("TL_DFU::Status");
 }
@@ -393,6 +398,7 @@ DFUObject::statusReport DFUObject::StatusRequest()
 device DFUObject::findCapabilities()
 {
     device currentDevice;
+    m_xferFeatures = 0;
     TL_DFU_QXTLOG_DEBUG("FINDDEVICES BEGIN");
     bl_messages message;
     message.flags_command = BL_MSG_CAP_REQ;
@@ -425,6 +431,7 @@ device DFUObject::findCapabilities()
         {
             currentDevice.PartitionSizes.append(ntohl(message.v.cap_rep_specific.partition_sizes[partition]));
         }
+        m_xferFeatures = message.v.cap_rep_specific.xfer_features;
     }
     {
         TL_DFU_QXTLOG_DEBUG(QString("Device ID=%0").arg(currentDevice.ID));
@@ -577,6 +584,14 @@ tl_dfu::Status DFUObject::UploadPartition(QByteArray &sourceArray, dfu_partition
     quint32 crc = DFUObject::CRCFromQBArray(sourceArray, threadJob.partition_size);
     TL_DFU_QXTLOG_DEBUG( QString("NEW FIRMWARE CRC=%0").arg(crc));
 
+    if ((m_xferFeatures & BL_XFER_FEATURE_DIFFERENTIAL) && partition != DFU_PARTITION_DESC) {
+        tl_dfu::Status status = UploadPartitionDiff(sourceArray, partition, crc);
+        if (status != tl_dfu::outsideDevCapabilities)
+            return status;
+
+        TL_DFU_QXTLOG_DEBUG("Differential upload not possible, uploading the whole partition");
+    }
+
     if( !StartUpload( sourceArray.length(), partition, crc) )
     {
         ret = StatusRequest();
@@ -633,6 +648,223 @@ tl_dfu::Status DFUObject::UploadPartition(QByteArray &sourceArray, dfu_partition
     return ret.status;
 }
 
+/**
+  Synchronously uploads a partition to the board, rewriting only the flash
+  blocks that differ and sending packets without waiting for each of them
+  @param sourceArray array containing the data to upload, padded to whole words
+  @param partition destination partition
+  @param crc crc value of the partition after the upload
+  @returns status of the board after upload, or outsideDevCapabilities if
+  the bootloader can't do this for the partition and nothing was sent
+  */
+tl_dfu::Status DFUObject::UploadPartitionDiff(QByteArray &sourceArray, dfu_partition_label partition, quint32 crc)
+{
+    DFUObject::statusReport ret;
+
+    QVector<blockCRC> blocks;
+    if (!BlockCRCs(partition, blocks) || blocks.size() > BL_MAX_DIFF_BLOCKS)
+        return tl_dfu::outsideDevCapabilities;
+
+    messagePackets msg = CalculatePadding(sourceArray.length());
+    bl_messages message;
+    memset(&message, 0, sizeof(message));
+    message.flags_command = BL_MSG_WRITE_START_DIFF;
+    message.v.xfer_start_diff.packets_in_transfer = ntohl(msg.numberOfPackets);
+    message.v.xfer_start_diff.label = partition;
+    message.v.xfer_start_diff.words_in_last_packet = msg.lastPacketCount;
+    message.v.xfer_start_diff.expected_crc = ntohl(crc);
+    message.v.xfer_start_diff.window = DIFF_UPLOAD_WINDOW;
+
+    // Send only the packets holding part of a block that is rewritten
+    QVector<quint32> packets;
+    quint32 start = 0;
+    int rewritten = 0;
+    for (int i = 0; i < blocks.size(); i++) {
+        quint32 size = blocks[i].size;
+
+        // The description is written after the firmware, into its last block,
+        // so that block has to be erased whether it changed or not
+        bool rewrite = CRCFromQBArray(sourceArray.mid(start, size), size) != blocks[i].crc ||
+                (partition == DFU_PARTITION_FW && i == blocks.size() - 1);
+
+        if (rewrite) {
+            message.v.xfer_start_diff.block_map[i / 8] |= 1 << (i % 8);
+            rewritten++;
+
+            quint32 end = qMin(start + size, (quint32)sourceArray.length());
+            for (quint32 p = start / XFER_BYTES_PER_PACKET; start < end && p <= (end - 1) / XFER_BYTES_PER_PACKET; p++) {
+                if (packets.isEmpty() || packets.last() < p)
+                    packets.append(p);
+            }
+        }
+
+        start += size;
+    }
+
+    TL_DFU_QXTLOG_DEBUG(QString("Rewriting %0 of %1 blocks, %2 of %3 packets").arg(rewritten)
+                        .arg(blocks.size()).arg(packets.size()).arg(msg.numberOfPackets));
+
+    emit operationProgress(QString("Erasing, please wait..."), -1);
+
+    if (SendData(message) < 1)
+        return tl_dfu::abort;
+
+    ret = StatusRequest();
+    if (ret.status != tl_dfu::uploading) {
+        qDebug() << QString("[tl_dfu] Couldn't start differential upload, status: %1, additional: 0x%2")
+                    .arg(StatusToString(ret.status)).arg(ret.additional, 8, 16, QChar('0'));
+        return ret.status;
+    }
+
+    emit operationProgress(QString(tr("Uploading %0 partition...")).arg(partitionStringFromLabel(partition)), -1);
+
+    if (!UploadDataWindowed(sourceArray, packets, DIFF_UPLOAD_WINDOW)) {
+        ret = StatusRequest();
+        qDebug() << QString("[tl_dfu] UploadDataWindowed failed, status: %1, additional: 0x%2")
+                    .arg(StatusToString(ret.status)).arg(ret.additional, 8, 16, QChar('0'));
+        return ret.status;
+    }
+
+    if (!EndOperation()) {
+        ret = StatusRequest();
+        return ret.status;
+    }
+
+    ret = StatusRequest();
+    if (ret.status != tl_dfu::Last_operation_Success) {
+        qDebug() << QString("[tl_dfu] Differential upload failed, status: %1, additional: 0x%2")
+                    .arg(StatusToString(ret.status)).arg(ret.additional, 8, 16, QChar('0'));
+    }
+
+    return ret.status;
+}
+
+/**
+  Asks the bootloader for the size and CRC of each erase block of a partition
+  @param label partition to describe
+  @param blocks receives the blocks, in order
+  @returns whether the whole partition was described
+  */
+bool DFUObject::BlockCRCs(dfu_partition_label label, QVector<blockCRC> &blocks)
+{
+    int total = 1;
+
+    blocks.clear();
+    while (blocks.size() < total) {
+        bl_messages message;
+        memset(&message, 0, sizeof(message));
+        message.flags_command = BL_MSG_BLOCK_CRC_REQ;
+        message.v.block_crc_req.label = label;
+        message.v.block_crc_req.first_block = ntohs((quint16)blocks.size());
+
+        if (SendData(message) < 1)
+            return false;
+
+        if (ReceiveData(message) < 1 || message.flags_command != BL_MSG_BLOCK_CRC_REP ||
+                message.v.block_crc_rep.num_blocks == 0)
+            return false;
+
+        total = ntohs(message.v.block_crc_rep.total_blocks);
+
+        for (int i = 0; i < message.v.block_crc_rep.num_blocks && i < BL_BLOCK_CRCS_PER_PACKET; i++) {
+            blockCRC block;
+            block.size = ntohl(message.v.block_crc_rep.blocks[i].size);
+            block.crc = ntohl(message.v.block_crc_rep.blocks[i].crc);
+            blocks.append(block);
+        }
+    }
+
+    return true;
+}
+
+/**
+  Sends one packet of an upload
+  @param data data to transfer, padded to whole words
+  @param packet number of the packet to send
+  @returns result of the requested operation
+  */
+bool DFUObject::SendPacket(QByteArray &data, quint32 packet)
+{
+    bl_messages message;
+    memset(&message, 0, sizeof(message));
+    message.flags_command = BL_MSG_WRITE_CONT;
+    message.v.xfer_cont.current_packet_number = ntohl(packet);
+
+    int offset = packet * XFER_BYTES_PER_PACKET;
+    CopyWords(data.data() + offset, (char*)message.v.xfer_cont.data,
+              qMin(XFER_BYTES_PER_PACKET, data.length() - offset));
+
+    return SendData(message) > 0;
+}
+
+/**
+  Sends packets with up to window of them waiting to be acknowledged. On a
+  lost packet, or no acknowledgement, it goes back to the first packet that
+  wasn't acknowledged.
+  @param data data to transfer, padded to whole words
+  @param packets numbers of the packets to send, in order
+  @param window number of packets sent ahead of the acknowledgements
+  @returns result of the requested operation
+  */
+bool DFUObject::UploadDataWindowed(QByteArray &data, QVector<quint32> const &packets, int window)
+{
+    int next = 0;
+    int acked = 0;
+    int retries = 0;
+    int lastPercentage = 0;
+
+    while (acked < packets.size()) {
+        if (next < packets.size() && next - acked < window) {
+            if (!SendPacket(data, packets[next++]))
+                return false;
+            continue;
+        }
+
+        if (ReceiveAck(packets, next, acked)) {
+            retries = 0;
+        } else if (++retries > 10) {
+            return false;
+        } else {
+            next = acked;
+        }
+
+        int percentage = acked * 100 / packets.size();
+        if (percentage != lastPercentage)
+            emit operationProgress("", percentage);
+        lastPercentage = percentage;
+    }
+
+    return true;
+}
+
+/**
+  Waits for the bootloader to acknowledge packets of a windowed upload
+  @param packets numbers of the packets being sent
+  @param next index of the next packet to send, moved back on a lost packet
+  @param acked index of the first packet not acknowledged yet
+  @returns whether an acknowledgement arrived
+  */
+bool DFUObject::ReceiveAck(QVector<quint32> const &packets, int &next, int &acked)
+{
+    bl_messages message;
+    if (ReceiveData(message, 1000) < 1 || message.flags_command != BL_MSG_WRITE_ACK)
+        return false;
+
+    quint32 nextPacket = ntohl(message.v.write_ack.next_packet_number);
+    int firstUnacked = std::lower_bound(packets.begin(), packets.end(), nextPacket) - packets.begin();
+    acked = qMax(acked, firstUnacked);
+
+    // An ack for packets resent after a rewind can get ahead of next
+    next = qMax(next, acked);
+
+    if (message.v.write_ack.rejected) {
+        qDebug() << QString("[tl_dfu] Packet %0 was lost, resending").arg(nextPacket);
+        next = acked;
+    }
+
+    return true;
+}
+
 /**
   Copies one array into another inverting endianess
   @param source source array
@@ -120,6 +120,7 @@ signals:
 private:
     bool DownloadPartition(QByteArray *fw, qint32 const & numberOfBytes, const dfu_partition_label &partition);
     tl_dfu::Status UploadPartition(QByteArray &sfile, dfu_partition_label partition);
+    tl_dfu::Status UploadPartitionDiff(QByteArray &sfile, dfu_partition_label partition, quint32 crc);
 
     // Helper functions:
     QString StatusToString(tl_dfu::Status  const & status);
@@ -141,6 +142,17 @@ private:
     bool StartUpload(qint32  const &numberOfBytes, const dfu_partition_label &label, quint32 crc);
     bool UploadData(qint32 const &numberOfPackets, QByteArray  &data);
 
+    // Differential uploads:
+    typedef struct blockCRC {
+        quint32 size;
+        quint32 crc;
+    } blockCRC;
+    bool BlockCRCs(dfu_partition_label label, QVector<blockCRC> &blocks);
+    bool SendPacket(QByteArray &data, quint32 packet);
+    bool UploadDataWindowed(QByteArray &data, QVector<quint32> const &packets, int window);
+    bool ReceiveAck(QVector<quint32> const &packets, int &next, int &acked);
+    quint8 m_xferFeatures;
+
     typedef struct ThreadJobStruc
     {
         enum Actions
@@ -154,6 +154,17 @@ bool UAVObjectGeneratorFlight::process_object(ObjectInfo* info)
     }
     outInclude.replace(QString("$(DATAFIELDS)"), fields);
 
+    // Replace the $(LAYOUTCHECKS) tag
+    QString layoutChecks;
+    int offset = 0;
+    for (int n = 0; n < info->fields.length(); ++n)
+    {
+        layoutChecks.append( QString("typedef char %1%2Offset[(offsetof(%1Data, %2) == %3) ? 1 : -1];\r\n")
+                             .arg(info->name).arg(info->fields[n]->name).arg(offset) );
+        offset += info->fields[n]->numBytes * info->fields[n]->numElements;
+    }
+    outCode.replace(QString("$(LAYOUTCHECKS)"), layoutChecks);
+
     // Replace the $(DATAFIELDINFO) tag
     QString enums;
     for (int n = 0; n < info->fields.length(); ++n)
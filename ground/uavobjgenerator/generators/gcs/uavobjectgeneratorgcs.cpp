@@ -65,7 +65,7 @@ bool UAVObjectGeneratorGCS::generate(UAVObjectParser* parser,QString templatepat
 
     for (int objidx = 0; objidx < parser->getNumObjects(); ++objidx) {
         ObjectInfo* info=parser->getObjectByIndex(objidx);
-        process_object(info);
+        process_object(info, objidx);
 
         gcsObjInit.append("    objMngr->registerObject( new " + info->name + "() );\n");
         gcsObjInit.append("    qmlRegisterType<" + info->name + ">(\"com.dronin.uavo\", 1, 0, \"" + info->name + "Class\");\n");
@@ -111,7 +111,7 @@ QString UAVObjectGeneratorGCS::form_enum_name(const QString& objectName,
 /**
  * Generate the GCS object files
  */
-bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
+bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info, int index)
 {
     if (info == NULL)
         return false;
@@ -124,6 +124,10 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
     replaceCommonTags(outInclude, info);
     replaceCommonTags(outCode, info);
 
+    // Replace the $(OBJINDEX) tag. Objects are registered in this order, each
+    // followed by its metaobject, which takes the next index.
+    outInclude.replace(QString("$(OBJINDEX)"), QString::number(2 * index));
+
     // Replace the $(PARENT_INCLUDES) tag
     QString parentIncludes;
 
@@ -153,6 +157,56 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
     }
     outInclude.replace(QString("$(DATAFIELDS)"), fields);
 
+    // Replace the $(PACKFIELDS) and $(UNPACKFIELDS) tags with code for each
+    // field's type and size, in the field order of the telemetry format
+    QString packFields;
+    QString unpackFields;
+    int offset = 0;
+    for (int n = 0; n < info->fields.length(); ++n)
+    {
+        FieldInfo *field = info->fields[n];
+        QString name = QString("data.%1").arg(field->name);
+
+        if (field->numBytes == 1) {
+            // Single bytes need no swapping
+            packFields.append( QString("    memcpy(&dataOut[%1], &%2, %3);\n")
+                               .arg(offset).arg(name).arg(field->numElements) );
+            unpackFields.append( QString("    memcpy(&%2, &dataIn[%1], %3);\n")
+                                 .arg(offset).arg(name).arg(field->numElements) );
+        } else {
+            QString out = QString("&dataOut[%1]").arg(offset);
+            QString in = QString("&dataIn[%1]").arg(offset);
+            QString indent = "    ";
+
+            if (field->numElements > 1) {
+                QString loop = QString("    for (int i = 0; i < %1; i++)\n").arg(field->numElements);
+                packFields.append(loop);
+                unpackFields.append(loop);
+                name.append("[i]");
+                out = QString("&dataOut[%1 + %2 * i]").arg(offset).arg(field->numBytes);
+                in = QString("&dataIn[%1 + %2 * i]").arg(offset).arg(field->numBytes);
+                indent = "        ";
+            }
+
+            if (field->type == FIELDTYPE_FLOAT32) {
+                packFields.append( QString("%1qToLittleEndian<quint32>(floatToBits(%2), %3);\n")
+                                   .arg(indent).arg(name).arg(out) );
+                unpackFields.append( QString("%1%2 = floatFromBits(qFromLittleEndian<quint32>(%3));\n")
+                                     .arg(indent).arg(name).arg(in) );
+            } else {
+                QString type = fieldTypeStrCPP[field->type];
+                packFields.append( QString("%1qToLittleEndian<%2>(%3, %4);\n")
+                                   .arg(indent).arg(type).arg(name).arg(out) );
+                unpackFields.append( QString("%1%2 = qFromLittleEndian<%3>(%4);\n")
+                                     .arg(indent).arg(name).arg(type).arg(in) );
+            }
+        }
+
+        offset += field->numBytes * field->numElements;
+    }
+    outCode.replace(QString("$(PACKFIELDS)"), packFields);
+    outCode.replace(QString("$(UNPACKFIELDS)"), unpackFields);
+
     // Replace $(PROPERTIES) and related tags
     QString properties;
     QString propertiesImpl;
@@ -0,0 +1,172 @@
+#!/usr/bin/env python
+"""
+Measures how long the connect phase takes to retrieve the settings from a
+running simulator (flight/targets/simulation) over a throttled link, one
+object at a time as older GCS versions did, and with a settings snapshot.
+
+Start the simulator first, then run e.g.
+
+    python/connect_benchmark.py --rate 4000 --latency 0.05
+
+Copyright (C) 2016 dRonin, http://dronin.org
+
+Licensed under the GNU LGPL version 2.1 or any later version (see COPYING.LESSER)
+"""
+
+import argparse
+import collections
+import os
+import socket
+import sys
+import threading
+import time
+
+sys.path.insert(1, os.path.dirname(os.path.abspath(__file__)))
+
+from dronin import telemetry
+
+class ThrottledLink(object):
+    """
+    A TCP proxy that limits each direction to rate bytes per second and
+    delays everything by latency seconds, like a telemetry radio.
+    """
+
+    def __init__(self, host, port, rate, latency):
+        self.rate = rate
+        self.latency = latency
+
+        self.listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.listener.bind(('127.0.0.1', 0))
+        self.listener.listen(1)
+        self.port = self.listener.getsockname()[1]
+
+        self.upstream = socket.create_connection((host, port))
+
+        t = threading.Thread(target=self._accept)
+        t.daemon = True
+        t.start()
+
+    def _accept(self):
+        client, _ = self.listener.accept()
+
+        self._pipe(client, self.upstream)
+        self._pipe(self.upstream, client)
+
+    def _pipe(self, src, dst):
+        pending = collections.deque()
+        cond = threading.Condition()
+
+        def receive():
+            free_at = time.time()
+
+            while True:
+                data = src.recv(256)
+                if not data:
+                    return
+
+                # Serialize at the link rate, then deliver after the latency
+                free_at = max(free_at, time.time()) + len(data) / float(self.rate)
+
+                with cond:
+                    pending.append((free_at + self.latency, data))
+                    cond.notify()
+
+        def send():
+            while True:
+                with cond:
+                    while not pending:
+                        cond.wait()
+                    deliver_at, data = pending.popleft()
+
+                time.sleep(max(0, deliver_at - time.time()))
+                dst.sendall(data)
+
+        for fn in (receive, send):
+            t = threading.Thread(target=fn)
+            t.daemon = True
+            t.start()
+
+def wait_for(t, cond_fn, timeout):
+    """ Waits until cond_fn() holds, with the telemetry lock held """
+    deadline = time.time() + timeout
+
+    with t.cond:
+        while not cond_fn():
+            remaining = deadline - time.time()
+            if remaining <= 0:
+                return False
+            t.cond.wait(remaining)
+
+    return True
+
+def retrieve_one_at_a_time(t):
+    """ Requests each settings object and waits for it before the next """
+    received = 0
+
+    for cls in t.uavo_defs.get_settings_objects():
+        if not cls._single:
+            continue
+
+        before = t.last_values.get(cls)
+        t.request_object(cls)
+
+        if wait_for(t, lambda: t.last_values.get(cls) is not before, 2.0):
+            received += 1
+
+    return received
+
+def retrieve_snapshot(t, request, known_hash):
+    """ Requests a settings snapshot and waits for the autopilot to finish """
+    snapshot = t.uavo_defs.find_by_name('SettingsSnapshot')
+
+    def finished():
+        s = t.last_values.get(snapshot)
+        return s is not None and s.Request == request and \
+                s.Status != snapshot.ENUM_Status['Request']
+
+    t.send_object(snapshot._make_to_send(Request=request, Hash=known_hash,
+        ObjectCount=0, Status=snapshot.ENUM_Status['Request']))
+
+    if not wait_for(t, finished, 60.0):
+        raise RuntimeError("No snapshot received; does the firmware support it?")
+
+    return t.last_values[snapshot]
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=9000)
+    parser.add_argument('--rate', type=int, default=4000,
+            help='link throughput in bytes per second, each way')
+    parser.add_argument('--latency', type=float, default=0.05,
+            help='one way link latency in seconds')
+    args = parser.parse_args()
+
+    link = ThrottledLink(args.host, args.port, args.rate, args.latency)
+
+    t = telemetry.NetworkTelemetry(port=link.port, service_in_iter=False)
+    t.start_thread()
+    t.wait_connection()
+
+    start = time.time()
+    received = retrieve_one_at_a_time(t)
+    print("One at a time: %d settings objects in %.2f s" % (received,
+            time.time() - start))
+
+    start = time.time()
+    snapshot = retrieve_snapshot(t, 1, 0)
+    print("Snapshot: %d objects in %.2f s" % (snapshot.ObjectCount,
+            time.time() - start))
+
+    # Nothing has changed since, so the second snapshot should be short
+    start = time.time()
+    snapshot = retrieve_snapshot(t, 2, snapshot.Hash)
+    print("Unchanged snapshot: %d objects in %.2f s (%s)" % (
+            snapshot.ObjectCount, time.time() - start,
+            'unchanged' if snapshot.Status == snapshot.ENUM_Status['Unchanged']
+                else 'resent'))
+
+#-------------------------------------------------------------------------------
+if __name__ == "__main__":
+    main()
@@ -3,6 +3,7 @@
 #-------------------------------------------------------------------------------
 __all__ = ()
 
+from . import logdecode
 from . import logfs
 from . import telemetry
 from . import uavo
@@ -0,0 +1,314 @@
+"""
+Columnar decoding of whole UAVTalk logs into numpy arrays.
+
+Copyright (C) 2016 dRonin, http://dronin.org
+
+Licensed under the GNU LGPL version 2.1 or any later version (see COPYING.LESSER)
+
+This is an alternative to iterating a telemetry object and calling
+as_numpy_array() on it, for when the entire log is available up front.
+Packets are framed by the native _logdecode module, which works on several
+chunks of the log concurrently; object data for each requested class is then
+copied straight into its numpy array without constructing a Python object
+per packet.
+
+If the native module is not available the generic uavtalk.process_stream()
+path is used instead, producing the same arrays more slowly.
+"""
+
+from . import uavtalk
+
+from six import indexbytes
+
+try:
+    from . import _logdecode
+except ImportError:
+    _logdecode = None
+
+__all__ = [ "decode_log" ]
+
+# Chunks smaller than this are not worth a thread
+MIN_CHUNK_SIZE = 4 * 1024 * 1024
+
+# Must match struct record in logdecodemodule.c
+RECORD_HAS_TS = 0x01
+
+def _record_dtype():
+    import numpy as np
+
+    return np.dtype([('top', '<u8'), ('offset', '<u8'), ('obj_idx', '<u4'),
+        ('timestamp', '<u4'), ('instance', '<u2'), ('flags', 'u1'),
+        ('reserved', 'V5')])
+
+def _packed_dtype(cls):
+    """ numpy dtype laid out exactly like the object's data on the wire """
+    import numpy as np
+
+    num_hdr = 3 if cls._single else 4
+
+    fields = []
+    for name, typ in cls._dtype[num_hdr:]:
+        dt = np.dtype(typ)
+
+        # _dtype widens floats to doubles, the wire format is single precision
+        if dt.base.kind == 'f':
+            base = np.dtype('<f4')
+        else:
+            base = dt.base.newbyteorder('<')
+
+        fields.append((name, base, dt.shape))
+
+    dtype = np.dtype(fields)
+
+    if dtype.itemsize != cls.get_size_of_data():
+        raise ValueError("Unexpected layout for %s" % (cls._name))
+
+    return dtype
+
+def _detect_gcs_timestamps(buf, pos):
+    """ Same heuristic as process_stream() uses when autodetecting.
+
+    Returns (gcs_timestamps, position of first packet) """
+
+    while pos + uavtalk.header_fmt.size + uavtalk.logheader_fmt.size <= len(buf):
+        overrideTimestamp, logHdrLen = uavtalk.logheader_fmt.unpack_from(buf, pos)
+
+        if (logHdrLen > 1000) or (overrideTimestamp > 100000000):
+            if indexbytes(buf, pos) == uavtalk.SYNC_VAL:
+                return False, pos
+        elif indexbytes(buf, pos + uavtalk.logheader_fmt.size) == uavtalk.SYNC_VAL:
+            return True, pos
+
+        pos += 1
+
+    return False, pos
+
+class _Scanner(object):
+    def __init__(self, buf, obj_table, gcs_timestamps):
+        import numpy as np
+
+        self.buf = buf
+        self.gcs_timestamps = gcs_timestamps
+
+        self.ids = np.array([o._id for o in obj_table], dtype='<u4').tobytes()
+        self.sizes = np.array([o.get_size_of_data() for o in obj_table],
+                dtype='<u2').tobytes()
+        self.singles = np.array([o._single for o in obj_table],
+                dtype='u1').tobytes()
+
+        self.dtype = _record_dtype()
+
+    def scan(self, start, end, max_records=None):
+        import numpy as np
+
+        if max_records is None:
+            max_records = len(self.buf)
+
+        next_pos, raw = _logdecode.scan(self.buf, start, end, max_records,
+                self.gcs_timestamps, self.ids, self.sizes, self.singles)
+
+        return next_pos, np.frombuffer(raw, dtype=self.dtype)
+
+def _map_threaded(fn, items, workers):
+    """ map() over a pool of threads; the native calls release the GIL """
+    from multiprocessing.pool import ThreadPool
+
+    pool = ThreadPool(max(1, workers))
+
+    try:
+        return pool.map(fn, items)
+    finally:
+        pool.close()
+
+def _scan_parallel(scanner, start, workers):
+    """ Frames the log from start on in chunks, one per worker.
+
+    A chunk's scan begins at an arbitrary offset, so its first packets may
+    be misframed.  Each chunk is therefore spliced onto the previous one at
+    the first packet both scans parsed from the same position; scanning is
+    deterministic from any position, so past that point both agree. Until
+    they do, the chunk is rescanned one packet at a time from where the
+    previous chunk stopped.
+    """
+
+    import numpy as np
+
+    length = len(scanner.buf)
+
+    num_chunks = max(1, min(workers, (length - start) // MIN_CHUNK_SIZE))
+    bounds = [start + (length - start) * i // num_chunks
+            for i in range(num_chunks)] + [length]
+
+    results = _map_threaded(lambda k: scanner.scan(bounds[k], bounds[k+1]),
+            range(num_chunks), num_chunks)
+
+    pos, records = results[0]
+    pieces = [records]
+
+    for k in range(1, num_chunks):
+        next_pos, records = results[k]
+
+        while pos < bounds[k+1]:
+            pos_after, first = scanner.scan(pos, bounds[k+1], 1)
+
+            if len(first) == 0:
+                pos = pos_after
+                break
+
+            idx = np.searchsorted(records['top'], first['top'][0])
+
+            if idx < len(records) and records['top'][idx] == first['top'][0]:
+                pieces.append(records[idx:])
+                pos = next_pos
+                break
+
+            pieces.append(first)
+            pos = pos_after
+
+    return np.concatenate(pieces)
+
+def _timestamps(records, gcs_timestamps):
+    """ Reproduces process_stream()'s timestamp bookkeeping, in ms """
+    import numpy as np
+
+    ts = records['timestamp'].astype(np.int64)
+
+    if gcs_timestamps:
+        return ts
+
+    has_ts = (records['flags'] & RECORD_HAS_TS) != 0
+    stamped = ts[has_ts]
+
+    if len(stamped) == 0:
+        return np.zeros(len(ts), dtype=np.int64)
+
+    # 16 bit timestamps wrap around
+    wraps = np.zeros(len(stamped), dtype=np.int64)
+    wraps[1:] = np.cumsum(stamped[1:] < stamped[:-1])
+    unwrapped = stamped + 65536 * wraps
+
+    # Unstamped packets take the last raw timestamp seen, as process_stream does
+    num_stamped = np.cumsum(has_ts)
+    last = np.maximum(num_stamped - 1, 0)
+    last_raw = np.where(num_stamped > 0, stamped[last], 0)
+
+    return np.where(has_ts, unwrapped[last], last_raw)
+
+def _empty_result(classes):
+    import numpy as np
+
+    return { cls : np.array([], dtype=cls._dtype) for cls in classes }
+
+def _decode_generic(buf, uavo_defs, classes, time_range, gcs_timestamps):
+    """ Fallback when the native module is unavailable """
+    import numpy as np
+
+    wanted = set(classes)
+    found = { cls : [] for cls in classes }
+
+    gen = uavtalk.process_stream(uavo_defs, use_walltime=False,
+            gcs_timestamps=gcs_timestamps)
+    gen.send(None)
+
+    def collect(obj):
+        if obj is None or obj.__class__ not in wanted:
+            return
+
+        if time_range is not None and not (time_range[0] <= obj.time <= time_range[1]):
+            return
+
+        found[obj.__class__].append(obj)
+
+    collect(gen.send(buf))
+
+    try:
+        while True:
+            collect(gen.send(None))
+    except StopIteration:
+        pass
+
+    return { cls : np.array(objs, dtype=cls._dtype)
+            for cls, objs in found.items() }
+
+def decode_log(buf, uavo_defs, classes=None, time_range=None,
+        gcs_timestamps=None, workers=None):
+    """ Decodes a complete log into one numpy array per UAVO class.
+
+     - buf: the log contents (after any header), as bytes or a memoryview
+     - uavo_defs: the UAVOCollection the log was written with
+     - classes: UAVO_* classes to decode; all of them if unspecified
+     - time_range: optional (start, end) in seconds; only instances with a
+       time within it (inclusive) are returned
+     - gcs_timestamps: as for TelemetryBase; None requests autodetection
+     - workers: number of chunks framed concurrently; defaults to the number
+       of CPUs
+
+    Returns a dict mapping each class to an array with the same dtype and
+    contents as as_numpy_array() would produce for that class.
+    """
+
+    import numpy as np
+
+    if classes is None:
+        classes = list(uavo_defs.values())
+
+    if _logdecode is None:
+        return _decode_generic(bytes(buf), uavo_defs, classes, time_range,
+                gcs_timestamps)
+
+    if workers is None:
+        import multiprocessing
+        workers = multiprocessing.cpu_count()
+
+    start = 0
+
+    if gcs_timestamps is None:
+        gcs_timestamps, start = _detect_gcs_timestamps(buf, 0)
+
+    # Every known object is framed (sizes are needed to keep sync, and
+    # timestamps depend on packets of all classes); filtering happens after.
+    obj_table = sorted(uavo_defs.values(), key=lambda o: o._id)
+
+    scanner = _Scanner(buf, obj_table, gcs_timestamps)
+    records = _scan_parallel(scanner, start, workers)
+
+    if len(records) == 0:
+        return _empty_result(classes)
+
+    times = _timestamps(records, gcs_timestamps) / 1000.0
+
+    if time_range is not None:
+        keep = (times >= time_range[0]) & (times <= time_range[1])
+        records = records[keep]
+        times = times[keep]
+
+    table_idx = { o : i for i, o in enumerate(obj_table) }
+
+    def decode_class(cls):
+        sel = records['obj_idx'] == table_idx[cls]
+        recs = records[sel]
+
+        out = np.zeros(len(recs), dtype=cls._dtype)
+
+        if len(recs) == 0:
+            return out
+
+        raw = _logdecode.gather(buf,
+                recs['offset'].astype('<u8').tobytes(), cls.get_size_of_data())
+        packed = np.frombuffer(raw, dtype=_packed_dtype(cls))
+
+        out['name'] = cls._name
+        out['time'] = times[sel]
+        out['uavo_id'] = cls._id
+
+        if not cls._single:
+            out['inst_id'] = recs['instance']
+
+        for name in packed.dtype.names:
+            out[name] = packed[name]
+
+        return out
+
+    arrays = _map_threaded(decode_class, classes, workers)
+
+    return dict(zip(classes, arrays))
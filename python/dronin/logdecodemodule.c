@@ -0,0 +1,416 @@
+/**
+ * Native helpers for dronin.logdecode: UAVTalk log framing and payload
+ * gathering.
+ *
+ * Copyright (C) 2016 dRonin, http://dronin.org
+ *
+ * Licensed under the GNU LGPL version 2.1 or any later version (see COPYING.LESSER)
+ *
+ * The framing logic mirrors uavtalk.process_stream() exactly, so that a
+ * scan started at a given position visits the same packets the generator
+ * would.  Neither function touches Python objects while scanning, and both
+ * release the GIL, so several chunks of a log can be handled concurrently
+ * from Python threads.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SYNC_VAL 0x3C
+#define TYPE_MASK 0x78
+#define TYPE_VER 0x20
+#define TYPE_OBJ_REQ 0x01
+#define TYPE_ACK 0x03
+#define TYPE_NACK 0x04
+#define TYPE_OBJ_TS 0x80
+#define TYPE_OBJ_ACK_TS 0x82
+
+#define HEADER_LEN 8
+#define LOGHEADER_LEN 12
+#define MIN_HEADER_LENGTH 8
+#define MAX_HEADER_LENGTH 12
+#define MAX_PAYLOAD_LENGTH (256 - 12)
+
+#define RECORD_HAS_TS 0x01
+
+/* Buffer and flag argument formats; bytes are str on python 2 */
+#if PY_MAJOR_VERSION >= 3
+#define BUF_FMT "y*"
+#define BYTES_FMT "y#"
+#define FLAG_FMT "p"
+#else
+#define BUF_FMT "s*"
+#define BYTES_FMT "s#"
+#define FLAG_FMT "i"
+#endif
+
+/* Must match RECORD_DTYPE in logdecode.py */
+struct record {
+	uint64_t top;		/* scan position the packet was parsed from */
+	uint64_t offset;	/* offset of the object data */
+	uint32_t obj_idx;	/* index into the object table */
+	uint32_t timestamp;	/* GCS timestamp, or raw 16 bit packet timestamp */
+	uint16_t instance;
+	uint8_t flags;
+	uint8_t reserved[5];
+};
+
+static const uint8_t crc_table[256] = {
+	0x00, 0x07, 0x0e, 0x09, 0x1c, 0x1b, 0x12, 0x15, 0x38, 0x3f, 0x36, 0x31, 0x24, 0x23, 0x2a, 0x2d,
+	0x70, 0x77, 0x7e, 0x79, 0x6c, 0x6b, 0x62, 0x65, 0x48, 0x4f, 0x46, 0x41, 0x54, 0x53, 0x5a, 0x5d,
+	0xe0, 0xe7, 0xee, 0xe9, 0xfc, 0xfb, 0xf2, 0xf5, 0xd8, 0xdf, 0xd6, 0xd1, 0xc4, 0xc3, 0xca, 0xcd,
+	0x90, 0x97, 0x9e, 0x99, 0x8c, 0x8b, 0x82, 0x85, 0xa8, 0xaf, 0xa6, 0xa1, 0xb4, 0xb3, 0xba, 0xbd,
+	0xc7, 0xc0, 0xc9, 0xce, 0xdb, 0xdc, 0xd5, 0xd2, 0xff, 0xf8, 0xf1, 0xf6, 0xe3, 0xe4, 0xed, 0xea,
+	0xb7, 0xb0, 0xb9, 0xbe, 0xab, 0xac, 0xa5, 0xa2, 0x8f, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9d, 0x9a,
+	0x27, 0x20, 0x29, 0x2e, 0x3b, 0x3c, 0x35, 0x32, 0x1f, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0d, 0x0a,
+	0x57, 0x50, 0x59, 0x5e, 0x4b, 0x4c, 0x45, 0x42, 0x6f, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7d, 0x7a,
+	0x89, 0x8e, 0x87, 0x80, 0x95, 0x92, 0x9b, 0x9c, 0xb1, 0xb6, 0xbf, 0xb8, 0xad, 0xaa, 0xa3, 0xa4,
+	0xf9, 0xfe, 0xf7, 0xf0, 0xe5, 0xe2, 0xeb, 0xec, 0xc1, 0xc6, 0xcf, 0xc8, 0xdd, 0xda, 0xd3, 0xd4,
+	0x69, 0x6e, 0x67, 0x60, 0x75, 0x72, 0x7b, 0x7c, 0x51, 0x56, 0x5f, 0x58, 0x4d, 0x4a, 0x43, 0x44,
+	0x19, 0x1e, 0x17, 0x10, 0x05, 0x02, 0x0b, 0x0c, 0x21, 0x26, 0x2f, 0x28, 0x3d, 0x3a, 0x33, 0x34,
+	0x4e, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5c, 0x5b, 0x76, 0x71, 0x78, 0x7f, 0x6a, 0x6d, 0x64, 0x63,
+	0x3e, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2c, 0x2b, 0x06, 0x01, 0x08, 0x0f, 0x1a, 0x1d, 0x14, 0x13,
+	0xae, 0xa9, 0xa0, 0xa7, 0xb2, 0xb5, 0xbc, 0xbb, 0x96, 0x91, 0x98, 0x9f, 0x8a, 0x8d, 0x84, 0x83,
+	0xde, 0xd9, 0xd0, 0xd7, 0xc2, 0xc5, 0xcc, 0xcb, 0xe6, 0xe1, 0xe8, 0xef, 0xfa, 0xfd, 0xf4, 0xf3
+};
+
+static inline uint32_t get_le32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline uint16_t get_le16(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+/**
+ * Find an object in the table of known objects.
+ * @param[in] ids sorted array of object ids
+ * @return index of the object, or -1 if unknown
+ */
+static int find_obj(const uint32_t *ids, int num_ids, uint32_t id)
+{
+	int lo = 0, hi = num_ids - 1;
+
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+
+		if (ids[mid] == id)
+			return mid;
+		else if (ids[mid] < id)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+
+	return -1;
+}
+
+struct scan_args {
+	const uint8_t *buf;
+	size_t len;
+	size_t pos;
+	size_t end;
+	size_t max_records;
+	int gcs_timestamps;
+
+	const uint32_t *ids;
+	const uint16_t *sizes;
+	const uint8_t *singles;
+	int num_ids;
+
+	struct record *records;
+	size_t num_records;
+	size_t alloc_records;
+};
+
+static int append_record(struct scan_args *s, const struct record *r)
+{
+	if (s->num_records == s->alloc_records) {
+		size_t alloc = s->alloc_records ? s->alloc_records * 2 : 4096;
+		struct record *records = realloc(s->records, alloc * sizeof(*records));
+
+		if (!records)
+			return -1;
+
+		s->records = records;
+		s->alloc_records = alloc;
+	}
+
+	s->records[s->num_records++] = *r;
+	return 0;
+}
+
+/**
+ * Scan packets whose parse starts before s->end, or until max_records
+ * packets of known objects have been found.  On return s->pos holds the
+ * position the next scan should start from.
+ * @return 0 on success, -1 if out of memory
+ */
+static int scan_packets(struct scan_args *s)
+{
+	const uint8_t *buf = s->buf;
+	size_t pos = s->pos;
+
+	while (pos < s->end && s->num_records < s->max_records) {
+		struct record r;
+		size_t top = pos;
+		uint32_t override_timestamp = 0;
+
+		if (s->gcs_timestamps) {
+			if (pos + HEADER_LEN + LOGHEADER_LEN > s->len)
+				break;
+
+			override_timestamp = get_le32(buf + pos);
+			pos += LOGHEADER_LEN;
+		}
+
+		while (pos + HEADER_LEN <= s->len && buf[pos] != SYNC_VAL)
+			pos++;
+
+		if (pos + HEADER_LEN > s->len)
+			break;
+
+		uint8_t pack_type = buf[pos + 1];
+		uint16_t pack_len = get_le16(buf + pos + 2);
+		uint32_t obj_id = get_le32(buf + pos + 4);
+
+		if ((pack_type & TYPE_MASK) != TYPE_VER) {
+			pos++;
+			continue;
+		}
+
+		pack_type &= ~TYPE_MASK;
+
+		if (pack_len < MIN_HEADER_LENGTH ||
+				pack_len > MAX_HEADER_LENGTH + MAX_PAYLOAD_LENGTH) {
+			pos++;
+			continue;
+		}
+
+		int obj_idx = find_obj(s->ids, s->num_ids, obj_id);
+		size_t obj_len, timestamp_len, instance_len;
+
+		if (pack_type == TYPE_OBJ_REQ || pack_type == TYPE_ACK ||
+				pack_type == TYPE_NACK) {
+			obj_len = 0;
+			timestamp_len = 0;
+			obj_idx = -1;
+		} else if (obj_idx >= 0) {
+			timestamp_len = (pack_type == TYPE_OBJ_TS ||
+					pack_type == TYPE_OBJ_ACK_TS) ? 2 : 0;
+			obj_len = s->sizes[obj_idx];
+		} else {
+			timestamp_len = 0;
+			obj_len = pack_len - HEADER_LEN;
+		}
+
+		instance_len = (obj_idx >= 0 && !s->singles[obj_idx]) ? 2 : 0;
+
+		if (obj_len >= MAX_PAYLOAD_LENGTH) {
+			pos++;
+			continue;
+		}
+
+		size_t calc_size = HEADER_LEN + instance_len + timestamp_len + obj_len;
+
+		if (calc_size != pack_len) {
+			pos++;
+			continue;
+		}
+
+		if (pos + calc_size + 1 > s->len)
+			break;
+
+		uint8_t cs = 0;
+		for (size_t i = 0; i < calc_size; i++)
+			cs = crc_table[cs ^ buf[pos + i]];
+
+		if (cs != buf[pos + calc_size]) {
+			pos++;
+			continue;
+		}
+
+		if (obj_idx >= 0) {
+			memset(&r, 0, sizeof(r));
+
+			r.top = top;
+			r.offset = pos + HEADER_LEN + instance_len + timestamp_len;
+			r.obj_idx = obj_idx;
+
+			if (instance_len)
+				r.instance = get_le16(buf + pos + HEADER_LEN);
+
+			if (s->gcs_timestamps) {
+				r.timestamp = override_timestamp;
+			} else if (timestamp_len) {
+				r.timestamp = get_le16(buf + pos + HEADER_LEN + instance_len);
+				r.flags |= RECORD_HAS_TS;
+			}
+
+			if (append_record(s, &r))
+				return -1;
+		}
+
+		pos += calc_size + 1;
+	}
+
+	s->pos = pos;
+	return 0;
+}
+
+PyDoc_STRVAR(scan_doc,
+"scan(buf, start, end, max_records, gcs_timestamps, ids, sizes, singles)\n"
+"\n"
+"Parse UAVTalk packets starting at offset start, stopping at the first\n"
+"parse position at or beyond end or after max_records packets of known\n"
+"objects.  ids is a buffer of sorted little endian uint32 object ids,\n"
+"sizes the matching uint16 data sizes and singles uint8 single instance\n"
+"flags.  Returns (next_pos, records) where records is a bytes object of\n"
+"packed records.");
+
+static PyObject *scan(PyObject *self, PyObject *args)
+{
+	Py_buffer buf, ids, sizes, singles;
+	Py_ssize_t start, end, max_records;
+	int gcs_timestamps;
+	struct scan_args s;
+	PyObject *ret = NULL;
+	int err;
+
+	if (!PyArg_ParseTuple(args, BUF_FMT "nnn" FLAG_FMT BUF_FMT BUF_FMT BUF_FMT,
+				&buf, &start, &end, &max_records, &gcs_timestamps,
+				&ids, &sizes, &singles))
+		return NULL;
+
+	if (sizes.len != ids.len / 2 || singles.len != ids.len / 4 ||
+			start < 0 || max_records < 0) {
+		PyErr_SetString(PyExc_ValueError, "Inconsistent scan arguments");
+		goto out;
+	}
+
+	memset(&s, 0, sizeof(s));
+	s.buf = buf.buf;
+	s.len = buf.len;
+	s.pos = start;
+	s.end = end < buf.len ? end : buf.len;
+	s.max_records = max_records;
+	s.gcs_timestamps = gcs_timestamps;
+	s.ids = ids.buf;
+	s.sizes = sizes.buf;
+	s.singles = singles.buf;
+	s.num_ids = ids.len / 4;
+
+	Py_BEGIN_ALLOW_THREADS
+	err = scan_packets(&s);
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		PyErr_NoMemory();
+	} else {
+		/* No records leaves s.records NULL, which would build None */
+		ret = Py_BuildValue("n" BYTES_FMT, (Py_ssize_t) s.pos,
+				s.records ? (const char *) s.records : "",
+				(Py_ssize_t) (s.num_records * sizeof(struct record)));
+	}
+
+	free(s.records);
+
+out:
+	PyBuffer_Release(&buf);
+	PyBuffer_Release(&ids);
+	PyBuffer_Release(&sizes);
+	PyBuffer_Release(&singles);
+
+	return ret;
+}
+
+PyDoc_STRVAR(gather_doc,
+"gather(buf, offsets, size)\n"
+"\n"
+"Concatenate size bytes from buf at each of the little endian uint64\n"
+"offsets, returning a bytes object.");
+
+static PyObject *gather(PyObject *self, PyObject *args)
+{
+	Py_buffer buf, offsets;
+	Py_ssize_t size;
+	PyObject *ret = NULL;
+
+	if (!PyArg_ParseTuple(args, BUF_FMT BUF_FMT "n", &buf, &offsets, &size))
+		return NULL;
+
+	Py_ssize_t count = offsets.len / sizeof(uint64_t);
+	const uint64_t *offs = offsets.buf;
+	int bad = 0;
+
+	if (size < 0) {
+		bad = 1;
+	} else {
+		for (Py_ssize_t i = 0; i < count; i++) {
+			if (offs[i] + size > (uint64_t) buf.len) {
+				bad = 1;
+				break;
+			}
+		}
+	}
+
+	if (bad) {
+		PyErr_SetString(PyExc_ValueError, "Offset out of range");
+		goto out;
+	}
+
+	ret = PyBytes_FromStringAndSize(NULL, count * size);
+	if (!ret)
+		goto out;
+
+	char *dst = PyBytes_AS_STRING(ret);
+	const char *src = buf.buf;
+
+	Py_BEGIN_ALLOW_THREADS
+	for (Py_ssize_t i = 0; i < count; i++)
+		memcpy(dst + i * size, src + offs[i], size);
+	Py_END_ALLOW_THREADS
+
+out:
+	PyBuffer_Release(&buf);
+	PyBuffer_Release(&offsets);
+
+	return ret;
+}
+
+static PyMethodDef LogDecodeMethods[] =
+{
+	{"scan", scan, METH_VARARGS, scan_doc},
+	{"gather", gather, METH_VARARGS, gather_doc},
+	{NULL, NULL, 0, NULL}
+};
+
+#define MODULE_DOC "Native UAVTalk log framing for dronin.logdecode"
+
+#if PY_MAJOR_VERSION >= 3
+static struct PyModuleDef logdecodemodule = {
+	PyModuleDef_HEAD_INIT,
+	"_logdecode",
+	MODULE_DOC,
+	-1,
+	LogDecodeMethods
+};
+
+PyMODINIT_FUNC
+PyInit__logdecode(void)
+{
+	return PyModule_Create(&logdecodemodule);
+}
+#else
+PyMODINIT_FUNC
+init_logdecode(void)
+{
+	Py_InitModule3("_logdecode", LogDecodeMethods, MODULE_DOC);
+}
+#endif
@@ -57,6 +57,7 @@ class TelemetryBase(with_metaclass(ABCMeta)):
             uavo_defs.from_uavo_xml_path(xml_path)
 
         self.githash = githash
+        self.gcs_timestamps = gcs_timestamps
 
         self.uavo_defs = uavo_defs
         self.uavtalk_generator = uavtalk.process_stream(uavo_defs,
@@ -549,6 +550,22 @@ class FileTelemetry(TelemetryBase):
 
         return buf
 
+    def decode_columns(self, classes=None, time_range=None, workers=None):
+        """ Decodes the rest of the file straight into numpy arrays.
+
+        Much faster than iterating and calling as_numpy_array() for each
+        class, but only usable instead of iterating this object, not in
+        addition to it.  See logdecode.decode_log() for the parameters.
+
+        Returns a dict mapping each UAVO_* class to its array.
+        """
+
+        from . import logdecode
+
+        return logdecode.decode_log(self.f.read(), self.uavo_defs,
+                classes=classes, time_range=time_range,
+                gcs_timestamps=self.gcs_timestamps, workers=workers)
+
 def get_telemetry_by_args(desc="Process telemetry", service_in_iter=True,
         iter_blocks=True):
     """ Parses command line to decide how to get a telemetry object. """
@@ -139,7 +139,7 @@ class UAVOCollection(dict):
         content_list = []
 
         for file_name in glob.glob(os.path.join(path, '*.xml')):
-            with open(file_name, 'rU') as f:
+            with open(file_name, 'r') as f:
                 content_list.append(f.read())
 
         self.from_file_contents(content_list)
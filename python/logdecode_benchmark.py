@@ -0,0 +1,130 @@
+#!/usr/bin/env python
+"""
+Compares dronin.logdecode.decode_log() against iterating a FileTelemetry and
+calling as_numpy_array(), on a synthetic GCS-format log.
+
+Copyright (C) 2016 dRonin, http://dronin.org
+
+Licensed under the GNU LGPL version 2.1 or any later version (see COPYING.LESSER)
+"""
+
+import io
+import random
+import struct
+import time
+
+from dronin import telemetry, uavtalk, logdecode
+
+# A typical high rate mix: sensors, attitude, actuators, plus a multi
+# instance object
+LOG_OBJECTS = [ ('Gyros', 5), ('Accels', 5), ('AttitudeActual', 3),
+        ('ActuatorCommand', 2), ('GPSPosition', 1), ('WaypointActive', 1),
+        ('PathDesired', 1) ]
+
+def _packet(cls, rng, timestamp, instance, corrupt=False):
+    """ One UAVTalk packet with random field contents """
+    data = bytes(bytearray(rng.getrandbits(8) for _ in range(cls.get_size_of_data())))
+
+    # Keep floats finite so arrays compare equal
+    data = cls._packstruct.pack(*[ v if v == v and abs(v) < 1e30 else 0.0
+        for v in cls._packstruct.unpack(data) ])
+
+    body = b''
+    if not cls._single:
+        body += uavtalk.instance_fmt.pack(instance)
+    body += uavtalk.timestamp_fmt.pack(timestamp & 0xffff) + data
+
+    hdr = uavtalk.header_fmt.pack(uavtalk.SYNC_VAL,
+            uavtalk.TYPE_OBJ_TS | uavtalk.TYPE_VER,
+            uavtalk.header_fmt.size + len(body), cls._id)
+
+    packet = hdr + body
+    crc = uavtalk.calcCRC(packet)
+    if corrupt:
+        crc ^= 0x55
+
+    return packet + struct.pack('<B', crc)
+
+def synthesize_log(uavo_defs, size, gcs_timestamps=True, seed=1):
+    """ Builds a log of roughly size bytes, with occasional corrupt packets """
+    rng = random.Random(seed)
+
+    classes = []
+    for name, weight in LOG_OBJECTS:
+        classes += [ uavo_defs.find_by_name(name) ] * weight
+
+    pieces = []
+    length = 0
+    t = 0
+
+    while length < size:
+        t += rng.randint(0, 3)
+        cls = rng.choice(classes)
+
+        packet = _packet(cls, rng, t, rng.randint(0, 2),
+                corrupt=(rng.random() < 0.001))
+
+        if gcs_timestamps:
+            packet = uavtalk.logheader_fmt.pack(t, len(packet)) + packet
+
+        pieces.append(packet)
+        length += len(packet)
+
+    return b''.join(pieces)
+
+def classes_in_log(uavo_defs):
+    return [ uavo_defs.find_by_name(name) for name, weight in LOG_OBJECTS ]
+
+def main():
+    import argparse
+    import numpy as np
+
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("-s", "--size", type=int, default=100,
+            help="size of the synthetic log in MB")
+    parser.add_argument("-w", "--workers", type=int, default=None,
+            help="number of concurrent chunks for decode_log")
+    parser.add_argument("--skip-reference", action="store_true",
+            help="do not time the as_numpy_array() path")
+    args = parser.parse_args()
+
+    # as_numpy_array() matches on classes from the telemetry's own collection,
+    # so generate the log with those
+    log_file = io.BytesIO()
+    t = telemetry.FileTelemetry(log_file, gcs_timestamps=True)
+    uavo_defs = t.uavo_defs
+
+    print("Generating %d MB log..." % args.size)
+    log = synthesize_log(uavo_defs, args.size * 1024 * 1024)
+    log_file.write(log)
+    log_file.seek(0)
+    classes = classes_in_log(uavo_defs)
+
+    if logdecode._logdecode is None:
+        print("Native _logdecode module unavailable; timing the fallback")
+
+    start = time.time()
+    columns = logdecode.decode_log(log, uavo_defs, classes,
+            gcs_timestamps=True, workers=args.workers)
+    elapsed = time.time() - start
+
+    total = sum(len(a) for a in columns.values())
+    print("decode_log:      %8.2f s, %9d objects, %7.1f MB/s" % (elapsed,
+        total, len(log) / elapsed / 1e6))
+
+    if args.skip_reference:
+        return
+
+    start = time.time()
+    reference = { cls : t.as_numpy_array(cls) for cls in classes }
+    ref_elapsed = time.time() - start
+
+    print("as_numpy_array:  %8.2f s, %7.1f MB/s, %.1fx slower" % (ref_elapsed,
+        len(log) / ref_elapsed / 1e6, ref_elapsed / elapsed))
+
+    for cls in classes:
+        if not np.array_equal(columns[cls], reference[cls]):
+            print("MISMATCH in %s" % (cls._name))
+
+if __name__ == "__main__":
+    main()
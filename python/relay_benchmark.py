@@ -0,0 +1,192 @@
+#!/usr/bin/env python
+"""
+Measures how the GCS UAVTalk relay keeps up when many slave GCSes are
+connected, by standing in for the autopilot and for the slaves.
+
+Start the GCS with the UAVTalk relay plugin enabled, run this, then connect
+the GCS to the autopilot with the IP connection (TCP to 127.0.0.1 and
+--port).  The recorded stream of a GCS log, or a synthetic one, is played to
+the GCS while --clients slaves connect to the relay, --slow of which never
+read what they are sent.  For example
+
+    python/relay_benchmark.py --clients 32 --slow 4 --gcs-pid $(pidof drgcs)
+
+Copyright (C) 2016 dRonin, http://dronin.org
+
+Licensed under the GNU LGPL version 2.1 or any later version (see COPYING.LESSER)
+"""
+
+import argparse
+import io
+import os
+import random
+import socket
+import struct
+import sys
+import threading
+import time
+
+sys.path.insert(1, os.path.dirname(os.path.abspath(__file__)))
+
+from dronin import telemetry, uavtalk, logdecode
+
+# A typical telemetry mix: attitude, sensors, actuators and status
+STREAM_OBJECTS = [ ('AttitudeActual', 5), ('Gyros', 5), ('Accels', 5),
+        ('ActuatorCommand', 3), ('GPSPosition', 1), ('FlightStatus', 1),
+        ('SystemAlarms', 1) ]
+
+def recorded_stream(path):
+    """ Returns the (timestamp in ms, frame bytes) records of a GCS log """
+    with open(path, 'rb') as f:
+        telemetry.FileTelemetry(f, parse_header=True)
+        buf = f.read()
+
+    gcs_timestamps, pos = logdecode._detect_gcs_timestamps(buf, 0)
+    if not gcs_timestamps:
+        raise ValueError("%s is not a log recorded by the GCS" % (path))
+
+    records = []
+    hdr = uavtalk.logheader_fmt
+
+    while pos + hdr.size <= len(buf):
+        timestamp, size = hdr.unpack_from(buf, pos)
+        pos += hdr.size
+        records.append((timestamp, buf[pos:pos + size]))
+        pos += size
+
+    return records
+
+def synthetic_stream(uavo_defs, seconds, rate, seed=1):
+    """ Returns rate frames per second of random contents for seconds """
+    rng = random.Random(seed)
+
+    classes = []
+    for name, weight in STREAM_OBJECTS:
+        classes += [ uavo_defs.find_by_name(name) ] * weight
+
+    records = []
+
+    for n in range(int(seconds * rate)):
+        cls = rng.choice(classes)
+
+        body = b''
+        if not cls._single:
+            body += uavtalk.instance_fmt.pack(0)
+        body += bytes(bytearray(rng.getrandbits(8)
+            for _ in range(cls.get_size_of_data())))
+
+        frame = uavtalk.header_fmt.pack(uavtalk.SYNC_VAL,
+                uavtalk.TYPE_OBJ | uavtalk.TYPE_VER,
+                uavtalk.header_fmt.size + len(body), cls._id) + body
+        frame += struct.pack('<B', uavtalk.calcCRC(frame))
+
+        records.append((n * 1000 // rate, frame))
+
+    return records
+
+def play(conn, records, speed, duration):
+    """ Sends the records at their recorded pace, looping until duration """
+    sent = 0
+    start = time.time()
+    offset = 0
+
+    while True:
+        for timestamp, frame in records:
+            due = start + (offset + timestamp - records[0][0]) / 1000.0 / speed
+            if due > start + duration:
+                return sent
+
+            time.sleep(max(0, due - time.time()))
+            conn.sendall(frame)
+            sent += len(frame)
+
+        offset += records[-1][0] - records[0][0] + 1
+
+class Slave(object):
+    """ A slave GCS connected to the relay, counting what it receives """
+
+    def __init__(self, port, slow):
+        self.sock = socket.create_connection(('127.0.0.1', port))
+        self.received = 0
+
+        if not slow:
+            t = threading.Thread(target=self._receive)
+            t.daemon = True
+            t.start()
+
+    def _receive(self):
+        while True:
+            data = self.sock.recv(65536)
+            if not data:
+                return
+            self.received += len(data)
+
+def cpu_seconds(pid):
+    """ User plus system CPU time used so far by a process """
+    with open('/proc/%d/stat' % (pid)) as f:
+        fields = f.read().rsplit(')', 1)[1].split()
+
+    return (int(fields[11]) + int(fields[12])) / float(os.sysconf('SC_CLK_TCK'))
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--port', type=int, default=9000,
+            help='port the GCS connects to as the autopilot')
+    parser.add_argument('--relay-port', type=int, default=2000,
+            help='port the UAVTalk relay listens on')
+    parser.add_argument('--log', help='GCS log to play, instead of a synthetic stream')
+    parser.add_argument('--rate', type=int, default=500,
+            help='frames per second of the synthetic stream')
+    parser.add_argument('--speed', type=float, default=1.0,
+            help='playback speed relative to the recording')
+    parser.add_argument('--duration', type=float, default=30.0,
+            help='seconds to play the stream for')
+    parser.add_argument('--clients', type=int, default=16)
+    parser.add_argument('--slow', type=int, default=2,
+            help='how many of the clients never read')
+    parser.add_argument('--gcs-pid', type=int,
+            help='report the CPU time the GCS uses while relaying')
+    args = parser.parse_args()
+
+    if args.log:
+        records = recorded_stream(args.log)
+    else:
+        uavo_defs = telemetry.FileTelemetry(io.BytesIO()).uavo_defs
+        records = synthetic_stream(uavo_defs, 10, args.rate)
+
+    listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    listener.bind(('127.0.0.1', args.port))
+    listener.listen(1)
+
+    print("Waiting for the GCS to connect on port %d..." % (args.port))
+    conn, _ = listener.accept()
+
+    slaves = [ Slave(args.relay_port, n < args.slow) for n in range(args.clients) ]
+    fast = slaves[args.slow:]
+
+    cpu_start = cpu_seconds(args.gcs_pid) if args.gcs_pid else None
+    start = time.time()
+
+    sent = play(conn, records, args.speed, args.duration)
+
+    # Let the relay drain what it has queued
+    time.sleep(1.0)
+    elapsed = time.time() - start
+
+    print("Stream:   %9d bytes, %7.1f kB/s" % (sent, sent / elapsed / 1e3))
+
+    if fast:
+        received = [ s.received for s in fast ]
+        print("Received: %9d bytes per fast client on average, min %d, "
+                "%.1f%% of the stream" % (sum(received) // len(received),
+                min(received), 100.0 * min(received) / max(sent, 1)))
+
+    if cpu_start is not None:
+        cpu = cpu_seconds(args.gcs_pid) - cpu_start
+        print("GCS CPU:  %.2f s over %.1f s (%.1f%%) for %d clients" % (cpu,
+                elapsed, 100.0 * cpu / elapsed, args.clients))
+
+#-------------------------------------------------------------------------------
+if __name__ == "__main__":
+    main()
@@ -5,7 +5,7 @@ https://github.com/pypa/sampleproject
 """
 
 # Always prefer setuptools over distutils
-from setuptools import setup, find_packages
+from setuptools import setup, find_packages, Extension
 # To use a consistent encoding
 from codecs import open
 from os import path
@@ -77,6 +77,15 @@ setup(
     # simple. Or you can use find_packages().
     packages = ['dronin', 'dronin.logviewer'],
 
+    # Native log framing for dronin.logdecode.  Optional: without it
+    # decode_log() falls back to the pure python parser.
+    ext_modules = [
+        Extension('dronin._logdecode',
+            sources = ['dronin/logdecodemodule.c'],
+            extra_compile_args = ['-std=gnu99'],
+            optional = True),
+    ],
+
     # Just requires the base python system to run
     install_requires=['six'],
 
@@ -0,0 +1,244 @@
+/**
+ ******************************************************************************
+ * @file       hitl_lockstep.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ * @addtogroup Shared API
+ * @{
+ * @addtogroup HITL lockstep
+ * @{
+ * @brief Step bookkeeping for lockstep hardware in the loop simulation.
+ *
+ * In lockstep mode the GCS sends one HitlSensors frame per simulator step
+ * and waits until the autopilot has run its control loop on it and answered
+ * with a HitlActuators frame carrying the same step number.  Frames or
+ * answers lost on the link are recovered by resending the same step; the
+ * autopilot answers a repeated step again without running it twice.  Both
+ * ends use these helpers so they agree on the numbering.
+ *
+ * The autopilot moves its clock forward by the simulated time of each step,
+ * so its estimators and control loops run on simulated time and a
+ * simulator faster than real time is not held back.
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef HITL_LOCKSTEP_H_
+#define HITL_LOCKSTEP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//! How long the GCS waits for an answer before sending the step again
+#define HITL_LOCKSTEP_RESEND_MS 50
+
+//! How often a step is sent again before the GCS gives up on it
+#define HITL_LOCKSTEP_MAX_RETRIES 5
+
+//! How long the autopilot waits for the next step before it goes back to
+//! its own sensors
+#define HITL_LOCKSTEP_TIMEOUT_MS 500
+
+//! Longest simulated step the autopilot's clock is moved forward for
+#define HITL_LOCKSTEP_MAX_STEP_US 100000
+
+enum hitl_lockstep_poll {
+	HITL_LOCKSTEP_WAIT,	/**< Nothing to do */
+	HITL_LOCKSTEP_RESEND,	/**< Send the pending step again */
+	HITL_LOCKSTEP_LOST,	/**< The pending step was given up on */
+};
+
+enum hitl_lockstep_frame {
+	HITL_STEP_NEW,		/**< Run the control loop on this step */
+	HITL_STEP_REPEAT,	/**< Answer again, the answer was lost */
+	HITL_STEP_STALE,	/**< Older than the last step, ignore it */
+};
+
+//! The GCS side: the step in flight and its retries
+struct hitl_lockstep_host {
+	uint32_t step;		/**< Last step sent, 0 before the first */
+	uint32_t sent_ms;	/**< When it was last sent */
+	uint8_t retries;	/**< Times it was sent again */
+	bool pending;		/**< Waiting for its answer */
+	uint32_t resends;	/**< Steps sent again in total */
+	uint32_t lost;		/**< Steps given up on in total */
+};
+
+//! The autopilot side: the last step the control loop ran on
+struct hitl_lockstep_fc {
+	uint32_t last_step;	/**< 0 when not stepping */
+	uint32_t step_raw;	/**< Clock when the last step was published */
+	bool clock_stamped;	/**< step_raw is set, i.e. stepping */
+};
+
+//! The autopilot's clock, PIOS_DELAY on the flight side
+struct hitl_lockstep_clock {
+	uint32_t (*get_raw)(void);		/**< Raw clock value */
+	uint32_t (*diff_us)(uint32_t raw);	/**< us since a raw value */
+	void (*skip_us)(uint32_t us);		/**< Move the clock forward */
+};
+
+static inline void hitl_lockstep_host_init(struct hitl_lockstep_host *h)
+{
+	h->step = 0;
+	h->sent_ms = 0;
+	h->retries = 0;
+	h->pending = false;
+	h->resends = 0;
+	h->lost = 0;
+}
+
+//! Whether the next step can be sent, i.e. the last one was answered
+static inline bool hitl_lockstep_host_ready(const struct hitl_lockstep_host *h)
+{
+	return !h->pending;
+}
+
+/**
+ * Start a new step.  Only call when hitl_lockstep_host_ready().
+ * @param[in] now_ms The current time
+ * @return The number to send the step with
+ */
+static inline uint32_t hitl_lockstep_host_begin(struct hitl_lockstep_host *h, uint32_t now_ms)
+{
+	h->step++;
+	if (h->step == 0)
+		h->step = 1;
+
+	h->sent_ms = now_ms;
+	h->retries = 0;
+	h->pending = true;
+
+	return h->step;
+}
+
+/**
+ * Handle an answer from the autopilot.
+ * @param[in] step The step number it carries
+ * @return true if it completes the pending step, false for late duplicates
+ */
+static inline bool hitl_lockstep_host_ack(struct hitl_lockstep_host *h, uint32_t step)
+{
+	if (!h->pending || step != h->step)
+		return false;
+
+	h->pending = false;
+
+	return true;
+}
+
+/**
+ * Check on the pending step, to be called periodically.
+ * @param[in] now_ms The current time
+ * @return Whether to send the pending step again or whether it was lost
+ */
+static inline enum hitl_lockstep_poll hitl_lockstep_host_poll(struct hitl_lockstep_host *h, uint32_t now_ms)
+{
+	if (!h->pending || now_ms - h->sent_ms < HITL_LOCKSTEP_RESEND_MS)
+		return HITL_LOCKSTEP_WAIT;
+
+	if (h->retries >= HITL_LOCKSTEP_MAX_RETRIES) {
+		h->pending = false;
+		h->lost++;
+		return HITL_LOCKSTEP_LOST;
+	}
+
+	h->retries++;
+	h->resends++;
+	h->sent_ms = now_ms;
+
+	return HITL_LOCKSTEP_RESEND;
+}
+
+//! Forget the last step, e.g. when the autopilot stops stepping
+static inline void hitl_lockstep_fc_reset(struct hitl_lockstep_fc *f)
+{
+	f->last_step = 0;
+	f->step_raw = 0;
+	f->clock_stamped = false;
+}
+
+/**
+ * Classify a step received by the autopilot.
+ * @param[in] step The step number it carries
+ * @return Whether to run it, answer it again or ignore it
+ */
+static inline enum hitl_lockstep_frame hitl_lockstep_fc_receive(struct hitl_lockstep_fc *f, uint32_t step)
+{
+	if (step == 0)
+		return HITL_STEP_STALE;
+
+	if (step == f->last_step)
+		return HITL_STEP_REPEAT;
+
+	// Compare with wraparound, the step counter never stops
+	if (f->last_step != 0 && (int32_t) (step - f->last_step) < 0)
+		return HITL_STEP_STALE;
+
+	f->last_step = step;
+
+	return HITL_STEP_NEW;
+}
+
+/**
+ * How far the autopilot moves its clock forward for a new step, so that
+ * the time between steps on its clock is the simulated time step rather
+ * than the time the step took to arrive.  The clock never goes back, so
+ * with a simulator slower than real time it keeps to real time.
+ * @param[in] elapsed_us Time on the autopilot's clock since the last step
+ * @param[in] delta_time The simulated time step, in s
+ * @return The time to move the clock forward by, in us
+ */
+static inline uint32_t hitl_lockstep_fc_skip(uint32_t elapsed_us, float delta_time)
+{
+	// Also rejects NAN
+	if (!(delta_time > 0))
+		return 0;
+
+	uint32_t step_us = HITL_LOCKSTEP_MAX_STEP_US;
+	if (delta_time < HITL_LOCKSTEP_MAX_STEP_US * 1e-6f)
+		step_us = (uint32_t) (delta_time * 1e6f + 0.5f);
+
+	if (elapsed_us >= step_us)
+		return 0;
+
+	return step_us - elapsed_us;
+}
+
+/**
+ * Move the autopilot's clock forward for a new step, before it is
+ * published.  The clock is skipped by hitl_lockstep_fc_skip() from when
+ * the last step was published, except for the first step after a reset,
+ * then the time of this step is kept for the next one.
+ * @param[in] clock The autopilot's clock
+ * @param[in] delta_time The simulated time step, in s
+ */
+static inline void hitl_lockstep_fc_advance(struct hitl_lockstep_fc *f,
+		const struct hitl_lockstep_clock *clock, float delta_time)
+{
+	if (f->clock_stamped)
+		clock->skip_us(hitl_lockstep_fc_skip(
+				clock->diff_us(f->step_raw), delta_time));
+
+	f->step_raw = clock->get_raw();
+	f->clock_stamped = true;
+}
+
+#endif /* HITL_LOCKSTEP_H_ */
+
+/**
+ * @}
+ * @}
+ */